@@ -0,0 +1,237 @@
+/// kbOctree.cpp
+///
+/// 2025 blk 1.0
+
+#include <algorithm>
+#include "blk_core.h"
+#include "blk_containers.h"
+#include "Matrix.h"
+#include "kbOctree.h"
+
+/// BruteForceInFrustum - Same per element test as kbOctree::TestBoundsAgainstFrustum()
+static bool BruteForceInFrustum(const kbBounds& bounds, const Plane3d frustumPlanes[6]) {
+	const Vec3 center = bounds.Center();
+	const Vec3 extents = (bounds.Max() - bounds.Min()) * 0.5f;
+	for (u32 i = 0; i < 6; i++) {
+		const Plane3d& plane = frustumPlanes[i];
+		const float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z - plane.w;
+		const float radius = fabs(plane.x) * extents.x + fabs(plane.y) * extents.y + fabs(plane.z) * extents.z;
+		if (dist > radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// BruteForceAlongRay - Slab test that divides by the direction instead of multiplying by its inverse
+static bool BruteForceAlongRay(const Vec3& origin, const Vec3& direction, const float maxDist, const kbBounds& bounds) {
+	float tMin = 0.0f;
+	float tMax = maxDist;
+	for (int i = 0; i < 3; i++) {
+		if (direction[i] == 0.0f) {
+			if (origin[i] < bounds.Min()[i] || origin[i] > bounds.Max()[i]) {
+				return false;
+			}
+			continue;
+		}
+
+		const float t0 = (bounds.Min()[i] - origin[i]) / direction[i];
+		const float t1 = (bounds.Max()[i] - origin[i]) / direction[i];
+		tMin = std::max(tMin, std::min(t0, t1));
+		tMax = std::min(tMax, std::max(t0, t1));
+		if (tMin > tMax) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// RandomElementBounds - Mostly small elements, some large ones and a few outside of the world bounds
+static kbBounds RandomElementBounds(const f32 worldExtent) {
+	const f32 sizeRoll = kbfrand();
+	const f32 halfSize = (sizeRoll < 0.8f) ? (kbfrand(0.1f, 2.0f)) : ((sizeRoll < 0.97f) ? (kbfrand(2.0f, 30.0f)) : (kbfrand(30.0f, 150.0f)));
+	const f32 centerExtent = (kbfrand() < 0.05f) ? (worldExtent * 1.5f) : (worldExtent);
+	const Vec3 center = Vec3Rand(Vec3(-centerExtent, -centerExtent, -centerExtent), Vec3(centerExtent, centerExtent, centerExtent));
+	return kbBounds(center - Vec3(halfSize, halfSize, halfSize), center + Vec3(halfSize, halfSize, halfSize));
+}
+
+/// BenchmarkOctree
+bool BenchmarkOctree(const u32 numElements, const u32 numFrames) {
+	if (numElements == 0 || numFrames == 0) {
+		return true;
+	}
+
+	const f32 worldExtent = 500.0f;
+	kbOctree<u32> octree(kbBounds(Vec3(-worldExtent, -worldExtent, -worldExtent), Vec3(worldExtent, worldExtent, worldExtent)));
+
+	// Brute force mirror of the octree.  liveHandles holds the handles that are currently in the tree
+	std::vector<kbBounds> elementBounds;
+	std::vector<u32> liveHandles;
+
+	const auto addElement = [&]() {
+		const kbBounds bounds = RandomElementBounds(worldExtent);
+		const u32 id = (u32)elementBounds.size();
+		elementBounds.push_back(bounds);
+		const kbOctree<u32>::handle_t handle = octree.AddElement(id, bounds);
+		liveHandles.push_back(handle);
+	};
+
+	kbTimer addTimer;
+	for (u32 i = 0; i < numElements; i++) {
+		addElement();
+	}
+	const f32 addMS = addTimer.TimeElapsedMS();
+
+	std::vector<u32> octreeResults;
+	std::vector<u32> bruteResults;
+	const auto resultsMatch = [&](const char* const pQueryName, const u32 frame) {
+		std::sort(octreeResults.begin(), octreeResults.end());
+		std::sort(bruteResults.begin(), bruteResults.end());
+		if (octreeResults != bruteResults) {
+			blk::warn("BenchmarkOctree() - %s query mismatch on frame %u.  Octree found %u elements, brute force found %u", pQueryName, frame, (u32)octreeResults.size(), (u32)bruteResults.size());
+			return false;
+		}
+		return true;
+	};
+
+	f32 updateMS = 0.0f;
+	f32 octreeQueryMS = 0.0f, bruteQueryMS = 0.0f;
+	u32 numQueries = 0, numNodesVisited = 0;
+	for (u32 frame = 0; frame < numFrames; frame++) {
+		kbTimer updateTimer;
+
+		// Move a fifth of the elements.  Most jitter in place and a few teleport
+		for (u32 i = 0; i < liveHandles.size() / 5; i++) {
+			const u32 handle = liveHandles[rand() % liveHandles.size()];
+			const u32 id = octree.GetElement(handle);
+			kbBounds newBounds = RandomElementBounds(worldExtent);
+			if (kbfrand() < 0.9f) {
+				const Vec3 offset = Vec3Rand(Vec3(-1.0f, -1.0f, -1.0f), Vec3(1.0f, 1.0f, 1.0f));
+				newBounds = kbBounds(elementBounds[id].Min() + offset, elementBounds[id].Max() + offset);
+			}
+			elementBounds[id] = newBounds;
+			octree.MoveElement(handle, newBounds);
+		}
+
+		// Churn a few percent of the elements
+		for (u32 i = 0; i < numElements / 20 && liveHandles.empty() == false; i++) {
+			const u32 liveIdx = rand() % liveHandles.size();
+			octree.RemoveElement(liveHandles[liveIdx]);
+			blk::std_remove_idx_swap(liveHandles, liveIdx);
+			addElement();
+		}
+		updateMS += updateTimer.TimeElapsedMS();
+
+		if (octree.NumElements() != liveHandles.size()) {
+			blk::warn("BenchmarkOctree() - Octree holds %u elements but %u were added on frame %u", (u32)octree.NumElements(), (u32)liveHandles.size(), frame);
+			return false;
+		}
+
+		for (u32 query = 0; query < 8; query++) {
+			numQueries++;
+
+			// Bounds
+			const kbBounds queryBounds = RandomElementBounds(worldExtent);
+			octreeResults.clear();
+			bruteResults.clear();
+
+			kbTimer octreeTimer;
+			numNodesVisited += octree.GetElementsWithinBounds(queryBounds, octreeResults);
+			octreeQueryMS += octreeTimer.TimeElapsedMS();
+
+			kbTimer bruteTimer;
+			for (size_t i = 0; i < liveHandles.size(); i++) {
+				const u32 id = octree.GetElement(liveHandles[i]);
+				if (queryBounds.IntersectsBounds(elementBounds[id])) {
+					bruteResults.push_back(id);
+				}
+			}
+			bruteQueryMS += bruteTimer.TimeElapsedMS();
+
+			if (resultsMatch("Bounds", frame) == false) {
+				return false;
+			}
+
+			// Frustum.  Outward facing planes around a random point
+			const Vec3 frustumCenter = Vec3Rand(Vec3(-worldExtent, -worldExtent, -worldExtent), Vec3(worldExtent, worldExtent, worldExtent));
+			Plane3d frustumPlanes[6];
+			for (u32 i = 0; i < 6; i++) {
+				Vec3 normal = Vec3Rand(Vec3(-1.0f, -1.0f, -1.0f), Vec3(1.0f, 1.0f, 1.0f));
+				normal[i / 2] = (i & 1) ? (-1.0f) : (1.0f);
+				normal.normalize_self();
+				frustumPlanes[i] = Plane3d(normal, normal.dot(frustumCenter) + kbfrand(10.0f, 200.0f));
+			}
+
+			octreeResults.clear();
+			bruteResults.clear();
+
+			octreeTimer.Reset();
+			numNodesVisited += octree.GetElementsInFrustum(frustumPlanes, octreeResults);
+			octreeQueryMS += octreeTimer.TimeElapsedMS();
+
+			bruteTimer.Reset();
+			for (size_t i = 0; i < liveHandles.size(); i++) {
+				const u32 id = octree.GetElement(liveHandles[i]);
+				if (BruteForceInFrustum(elementBounds[id], frustumPlanes)) {
+					bruteResults.push_back(id);
+				}
+			}
+			bruteQueryMS += bruteTimer.TimeElapsedMS();
+
+			if (resultsMatch("Frustum", frame) == false) {
+				return false;
+			}
+
+			// Ray.  Every other one starts on an element's face and runs parallel to it, which is the 0 * inf case
+			Vec3 rayOrigin = Vec3Rand(Vec3(-worldExtent, -worldExtent, -worldExtent), Vec3(worldExtent, worldExtent, worldExtent));
+			Vec3 rayDirection = Vec3Rand(Vec3(-1.0f, -1.0f, -1.0f), Vec3(1.0f, 1.0f, 1.0f));
+			if ((query & 1) != 0) {
+				const kbBounds& faceBounds = elementBounds[octree.GetElement(liveHandles[rand() % liveHandles.size()])];
+				const int faceAxis = rand() % 3;
+				rayOrigin = faceBounds.Center();
+				rayOrigin[faceAxis] = faceBounds.Min()[faceAxis];
+				rayDirection.set(0.0f, 0.0f, 0.0f);
+				rayDirection[(faceAxis + 1 + rand() % 2) % 3] = (rand() & 1) ? (1.0f) : (-1.0f);
+			}
+			rayDirection.normalize_self();
+			const f32 rayLength = kbfrand(10.0f, worldExtent * 2.0f);
+
+			octreeResults.clear();
+			bruteResults.clear();
+
+			octreeTimer.Reset();
+			numNodesVisited += octree.GetElementsAlongRay(rayOrigin, rayDirection, rayLength, octreeResults);
+			octreeQueryMS += octreeTimer.TimeElapsedMS();
+
+			bruteTimer.Reset();
+			for (size_t i = 0; i < liveHandles.size(); i++) {
+				const u32 id = octree.GetElement(liveHandles[i]);
+				if (BruteForceAlongRay(rayOrigin, rayDirection, rayLength, elementBounds[id])) {
+					bruteResults.push_back(id);
+				}
+			}
+			bruteQueryMS += bruteTimer.TimeElapsedMS();
+
+			if (resultsMatch("Ray", frame) == false) {
+				return false;
+			}
+		}
+	}
+
+	const u32 numNodes = (u32)octree.NumNodes();
+
+	// Emptying the tree should collapse it back down to the root
+	for (size_t i = 0; i < liveHandles.size(); i++) {
+		octree.RemoveElement(liveHandles[i]);
+	}
+
+	if (octree.NumElements() != 0 || octree.NumNodes() != 1) {
+		blk::warn("BenchmarkOctree() - %u elements and %u nodes were left after removing everything", (u32)octree.NumElements(), (u32)octree.NumNodes());
+		return false;
+	}
+
+	blk::log("Octree benchmark passed - %u elements, %u frames, %u nodes", numElements, numFrames, numNodes);
+	blk::log("	Add: %.3f ms.  Move and churn: %.3f ms a frame.  %u queries of each type: octree %.3f ms, brute force %.3f ms, %.1f nodes visited per query",
+			 addMS, updateMS / numFrames, numQueries, octreeQueryMS, bruteQueryMS, numNodesVisited / (3.0f * numQueries));
+	return true;
+}
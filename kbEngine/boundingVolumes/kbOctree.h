@@ -3,125 +3,614 @@
 /// 2016-2025 blk 1.0
 
 #pragma once
+
+#include <vector>
 #include "kbBounds.h"
+#include "Plane3d.h"
 
-template<class T>
-class kbOctreeHelper {
+/// kbOctree
+///
+/// Loose octree.  A node's loose bounds are its cell scaled by the looseness factor about the cell center, and an
+/// element lives in the deepest node whose loose bounds fully contain it.  Elements that straddle a cell boundary
+/// don't get pinned to the root, and most moves stay within the element's current node.
+///
+/// Nodes and elements are stored in flat pools recycled through free lists, so AddElement/RemoveElement/MoveElement
+/// don't allocate once the pools have warmed up.  Elements are referenced by the handle returned from AddElement.
+/// Elements that fall outside the world bounds are kept in the root node and are still returned by queries.
+template<typename T>
+class kbOctree {
 public:
-	bool IntersectsBounds(const kbBounds& bounds, const T* element) const {
-		return true;
-	}
+	typedef u32 handle_t;
+	static constexpr u32 INVALID_INDEX = 0xffffffff;
+	static constexpr u32 MAX_SUPPORTED_DEPTH = 16;
+
+	kbOctree(const kbBounds& worldBounds, const u32 maxDepth = 8, const u32 maxElementsPerNode = 16, const float looseness = 2.0f);
+
+	handle_t AddElement(const T& element, const kbBounds& bounds);
+	bool RemoveElement(const handle_t handle);
+	bool MoveElement(const handle_t handle, const kbBounds& newBounds);
+	void Clear();
+
+	bool IsValid(const handle_t handle) const { return handle < m_Elements.size() && m_Elements[handle].m_Node != INVALID_INDEX; }
+	const T& GetElement(const handle_t handle) const { return m_Elements[handle].m_Data; }
+	T& GetElement(const handle_t handle) { return m_Elements[handle].m_Data; }
+	const kbBounds& GetElementBounds(const handle_t handle) const { return m_Elements[handle].m_Bounds; }
+
+	size_t NumElements() const { return m_Nodes[0].m_NumSubtreeElements; }
+	size_t NumNodes() const { return m_Nodes.size() - m_FreeNodeBlocks.size() * 8; }
+	const kbBounds& GetWorldBounds() const { return m_WorldBounds; }
+
+	/// Queries append to outElements and return the number of nodes visited
+	u32 GetElementsWithinBounds(const kbBounds& bounds, std::vector<T>& outElements) const;
+	u32 GetElementsInFrustum(const Plane3d frustumPlanes[6], std::vector<T>& outElements) const;
+	u32 GetElementsAlongRay(const Vec3& origin, const Vec3& direction, const float maxDist, std::vector<T>& outElements) const;
+
+	/// drawFunc is called as drawFunc(const kbBounds& looseBounds, u32 depth) for every non-empty node
+	template<typename DrawFunc>
+	void DebugDraw(DrawFunc&& drawFunc) const;
+
+private:
+	struct node_t {
+		Vec3 m_Center;
+		Vec3 m_HalfSize;
+		u32 m_Parent;
+		u32 m_FirstChild;
+		u32 m_FirstElement;
+		u32 m_NumElements;
+		u32 m_NumSubtreeElements;
+		u32 m_Depth;
+	};
+
+	struct element_t {
+		T m_Data;
+		kbBounds m_Bounds;
+		u32 m_Node;
+		u32 m_Next;
+		u32 m_Prev;
+	};
+
+	enum FrustumTest_t {
+		Frustum_Outside,
+		Frustum_Intersects,
+		Frustum_Inside,
+	};
+
+	void InitNode(const u32 nodeIdx, const u32 parentIdx, const Vec3& center, const Vec3& halfSize, const u32 depth);
+	kbBounds GetLooseBounds(const u32 nodeIdx) const;
+	bool FitsInNode(const u32 nodeIdx, const kbBounds& bounds) const;
+	u32 GetChildForBounds(const u32 nodeIdx, const kbBounds& bounds) const;
+
+	void InsertElement(u32 nodeIdx, const u32 elemIdx);
+	void LinkElement(const u32 nodeIdx, const u32 elemIdx);
+	void UnlinkElement(const u32 elemIdx);
+	void SplitNode(const u32 nodeIdx);
+	void CollapseNode(const u32 nodeIdx);
+	void TryCollapse(u32 nodeIdx);
+
+	u32 AllocateNodeBlock();
+	void FreeNodeBlock(const u32 firstChild);
+
+	void AppendSubtree(const u32 nodeIdx, std::vector<T>& outElements) const;
+
+	static FrustumTest_t TestBoundsAgainstFrustum(const kbBounds& bounds, const Plane3d frustumPlanes[6]);
+	static bool RayIntersectsBounds(const Vec3& origin, const Vec3& direction, const Vec3& invDirection, const float maxDist, const kbBounds& bounds);
+
+	std::vector<node_t> m_Nodes;
+	std::vector<u32> m_FreeNodeBlocks;
+	std::vector<element_t> m_Elements;
+	u32 m_FirstFreeElement;
+
+	kbBounds m_WorldBounds;
+	u32 m_MaxDepth;
+	u32 m_MaxElementsPerNode;
+	float m_Looseness;
 };
 
-template<class T, const int MAX_DEPTH, const int MAX_ELEMENTS_PER_NODE >
-class kbOctree {
-public:
-	kbOctree() { children = NULL; currentDepth = 0; const float MaxExtent = 9999.0f; nodeBounds.Set(-MaxExtent, -MaxExtent, -MaxExtent, MaxExtent, MaxExtent, MaxExtent); }
-	~kbOctree() { DeleteTree(); }
+/// kbOctree::kbOctree
+template<typename T>
+kbOctree<T>::kbOctree(const kbBounds& worldBounds, const u32 maxDepth, const u32 maxElementsPerNode, const float looseness) :
+	m_FirstFreeElement(INVALID_INDEX),
+	m_WorldBounds(worldBounds),
+	m_MaxDepth(kbClamp(maxDepth, 0u, MAX_SUPPORTED_DEPTH)),
+	m_MaxElementsPerNode(max(maxElementsPerNode, 1u)),
+	m_Looseness(kbClamp(looseness, 1.0f, 4.0f)) {
 
-	bool AddElement(kbOctreeHelper<T>& octreeHelper, T& element) {
-		if (!octreeHelper.IntersectsBounds(nodeBounds, element)) {
-			return false;
+	blk::warn_check(maxDepth <= MAX_SUPPORTED_DEPTH, "kbOctree::kbOctree() - Max depth %u clamped to %u", maxDepth, MAX_SUPPORTED_DEPTH);
+	Clear();
+}
+
+/// kbOctree::Clear
+template<typename T>
+void kbOctree<T>::Clear() {
+	m_Nodes.clear();
+	m_FreeNodeBlocks.clear();
+	m_Elements.clear();
+	m_FirstFreeElement = INVALID_INDEX;
+
+	m_Nodes.resize(1);
+	InitNode(0, INVALID_INDEX, m_WorldBounds.Center(), (m_WorldBounds.Max() - m_WorldBounds.Min()) * 0.5f, 0);
+}
+
+/// kbOctree::AddElement
+template<typename T>
+typename kbOctree<T>::handle_t kbOctree<T>::AddElement(const T& element, const kbBounds& bounds) {
+	u32 elemIdx = m_FirstFreeElement;
+	if (elemIdx != INVALID_INDEX) {
+		m_FirstFreeElement = m_Elements[elemIdx].m_Next;
+	} else {
+		elemIdx = (u32)m_Elements.size();
+		m_Elements.push_back(element_t());
+	}
+
+	element_t& newElem = m_Elements[elemIdx];
+	newElem.m_Data = element;
+	newElem.m_Bounds = bounds;
+	InsertElement(0, elemIdx);
+
+	return elemIdx;
+}
+
+/// kbOctree::RemoveElement
+template<typename T>
+bool kbOctree<T>::RemoveElement(const handle_t handle) {
+	if (blk::warn_check(IsValid(handle), "kbOctree::RemoveElement() - Invalid handle %u", handle) == false) {
+		return false;
+	}
+
+	const u32 nodeIdx = m_Elements[handle].m_Node;
+	UnlinkElement(handle);
+	TryCollapse(nodeIdx);
+
+	element_t& elem = m_Elements[handle];
+	elem.m_Data = T();
+	elem.m_Next = m_FirstFreeElement;
+	m_FirstFreeElement = handle;
+	return true;
+}
+
+/// kbOctree::MoveElement
+template<typename T>
+bool kbOctree<T>::MoveElement(const handle_t handle, const kbBounds& newBounds) {
+	if (blk::warn_check(IsValid(handle), "kbOctree::MoveElement() - Invalid handle %u", handle) == false) {
+		return false;
+	}
+
+	element_t& elem = m_Elements[handle];
+	elem.m_Bounds = newBounds;
+
+	u32 nodeIdx = elem.m_Node;
+	if (FitsInNode(nodeIdx, newBounds)) {
+		const node_t& node = m_Nodes[nodeIdx];
+		if (node.m_FirstChild == INVALID_INDEX || FitsInNode(GetChildForBounds(nodeIdx, newBounds), newBounds) == false) {
+			return true;
+		}
+	}
+
+	// Re-insert from the nearest ancestor that still contains the element
+	const u32 prevNodeIdx = nodeIdx;
+	UnlinkElement(handle);
+	while (nodeIdx != 0 && FitsInNode(nodeIdx, newBounds) == false) {
+		nodeIdx = m_Nodes[nodeIdx].m_Parent;
+	}
+	InsertElement(nodeIdx, handle);
+
+	// Collapsing before the insert could free the ancestor it starts from
+	TryCollapse(prevNodeIdx);
+	return true;
+}
+
+/// kbOctree::GetElementsWithinBounds
+template<typename T>
+u32 kbOctree<T>::GetElementsWithinBounds(const kbBounds& bounds, std::vector<T>& outElements) const {
+	u32 nodeStack[MAX_SUPPORTED_DEPTH * 7 + 8];
+	u32 stackSize = 0;
+	u32 numNodesVisited = 0;
+
+	nodeStack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const u32 nodeIdx = nodeStack[--stackSize];
+		const node_t& node = m_Nodes[nodeIdx];
+		numNodesVisited++;
+
+		if (node.m_NumSubtreeElements == 0 || (nodeIdx != 0 && bounds.IntersectsBounds(GetLooseBounds(nodeIdx)) == false)) {
+			continue;
+		}
+
+		for (u32 elemIdx = node.m_FirstElement; elemIdx != INVALID_INDEX; elemIdx = m_Elements[elemIdx].m_Next) {
+			if (bounds.IntersectsBounds(m_Elements[elemIdx].m_Bounds)) {
+				outElements.push_back(m_Elements[elemIdx].m_Data);
+			}
 		}
 
-		if ((data.size() >= MAX_ELEMENTS_PER_NODE && currentDepth < MAX_DEPTH) || children != NULL) {
-			if (children == NULL) {
-				children = new kbOctree[8];
-
-				for (int i = 0; i < 8; i++) {
-					children[i].currentDepth = currentDepth + 1;
-				}
-
-				const Vec3 minPt = nodeBounds.Min();
-				const Vec3 midPt = nodeBounds.Center();
-				const Vec3 maxPt = nodeBounds.Max();
-
-				children[0].nodeBounds.Set(minPt.x, minPt.y, midPt.z, midPt.x, midPt.y, maxPt.z);
-				children[1].nodeBounds.Set(midPt.x, minPt.y, midPt.z, maxPt.x, midPt.y, maxPt.z);
-				children[2].nodeBounds.Set(minPt.x, midPt.y, midPt.z, midPt.x, maxPt.y, maxPt.z);
-				children[3].nodeBounds.Set(midPt.x, midPt.y, midPt.z, maxPt.x, maxPt.y, maxPt.z);
-				children[4].nodeBounds.Set(minPt.x, minPt.y, minPt.z, midPt.x, midPt.y, midPt.z);
-				children[5].nodeBounds.Set(midPt.x, minPt.y, minPt.z, maxPt.x, midPt.y, midPt.z);
-				children[6].nodeBounds.Set(minPt.x, midPt.y, minPt.z, midPt.x, maxPt.y, midPt.z);
-				children[7].nodeBounds.Set(midPt.x, midPt.y, minPt.z, maxPt.x, maxPt.y, midPt.z);
-
-				// push data down to leaves
-				for (unsigned int i = 0; i < data.size(); i++) {
-					for (int l = 0; l < 8; l++) {
-						if (children[l].AddElement(octreeHelper, data[i])) {
-							break;
-						}
-					}
-				}
-				data.clear();
+		if (node.m_FirstChild != INVALID_INDEX) {
+			for (u32 i = 0; i < 8; i++) {
+				nodeStack[stackSize++] = node.m_FirstChild + i;
 			}
+		}
+	}
+
+	return numNodesVisited;
+}
+
+/// kbOctree::GetElementsInFrustum
+template<typename T>
+u32 kbOctree<T>::GetElementsInFrustum(const Plane3d frustumPlanes[6], std::vector<T>& outElements) const {
+	u32 nodeStack[MAX_SUPPORTED_DEPTH * 7 + 8];
+	u32 stackSize = 0;
+	u32 numNodesVisited = 0;
+
+	nodeStack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const u32 nodeIdx = nodeStack[--stackSize];
+		const node_t& node = m_Nodes[nodeIdx];
+		numNodesVisited++;
+
+		if (node.m_NumSubtreeElements == 0) {
+			continue;
+		}
+
+		// The root also holds elements outside of the world bounds, so it's never rejected as a whole
+		FrustumTest_t nodeTest = Frustum_Intersects;
+		if (nodeIdx != 0) {
+			nodeTest = TestBoundsAgainstFrustum(GetLooseBounds(nodeIdx), frustumPlanes);
+			if (nodeTest == Frustum_Outside) {
+				continue;
+			}
+
+			if (nodeTest == Frustum_Inside) {
+				AppendSubtree(nodeIdx, outElements);
+				continue;
+			}
+		}
+
+		for (u32 elemIdx = node.m_FirstElement; elemIdx != INVALID_INDEX; elemIdx = m_Elements[elemIdx].m_Next) {
+			if (TestBoundsAgainstFrustum(m_Elements[elemIdx].m_Bounds, frustumPlanes) != Frustum_Outside) {
+				outElements.push_back(m_Elements[elemIdx].m_Data);
+			}
+		}
+
+		if (node.m_FirstChild != INVALID_INDEX) {
+			for (u32 i = 0; i < 8; i++) {
+				nodeStack[stackSize++] = node.m_FirstChild + i;
+			}
+		}
+	}
+
+	return numNodesVisited;
+}
+
+/// kbOctree::GetElementsAlongRay
+template<typename T>
+u32 kbOctree<T>::GetElementsAlongRay(const Vec3& origin, const Vec3& direction, const float maxDist, std::vector<T>& outElements) const {
+	const Vec3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
 
-			int i = 0;
-			for (i = 0; i < 8; i++) {
-				if (children[i].AddElement(octreeHelper, element)) {
-					break;
-				}
+	u32 nodeStack[MAX_SUPPORTED_DEPTH * 7 + 8];
+	u32 stackSize = 0;
+	u32 numNodesVisited = 0;
+
+	nodeStack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const u32 nodeIdx = nodeStack[--stackSize];
+		const node_t& node = m_Nodes[nodeIdx];
+		numNodesVisited++;
+
+		if (node.m_NumSubtreeElements == 0 || (nodeIdx != 0 && RayIntersectsBounds(origin, direction, invDirection, maxDist, GetLooseBounds(nodeIdx)) == false)) {
+			continue;
+		}
+
+		for (u32 elemIdx = node.m_FirstElement; elemIdx != INVALID_INDEX; elemIdx = m_Elements[elemIdx].m_Next) {
+			if (RayIntersectsBounds(origin, direction, invDirection, maxDist, m_Elements[elemIdx].m_Bounds)) {
+				outElements.push_back(m_Elements[elemIdx].m_Data);
 			}
+		}
 
-			if (i == 8) {
-				//idLib::Error( "Error, yo!" );
-				// error
+		if (node.m_FirstChild != INVALID_INDEX) {
+			for (u32 i = 0; i < 8; i++) {
+				nodeStack[stackSize++] = node.m_FirstChild + i;
 			}
-		} else {
-			data.push_back(element);
 		}
-		return true;
 	}
 
-	int GetElementsWithinBounds(const kbBounds& bounds, kbOctreeHelper<T>& octreeHelper, std::vector< T* >& items) {
-		int numTests = 1;
-		if (!bounds.IntersectsBounds(nodeBounds)) {
-			return numTests;
+	return numNodesVisited;
+}
+
+/// kbOctree::DebugDraw
+template<typename T>
+template<typename DrawFunc>
+void kbOctree<T>::DebugDraw(DrawFunc&& drawFunc) const {
+	u32 nodeStack[MAX_SUPPORTED_DEPTH * 7 + 8];
+	u32 stackSize = 0;
+
+	nodeStack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const u32 nodeIdx = nodeStack[--stackSize];
+		const node_t& node = m_Nodes[nodeIdx];
+		if (node.m_NumSubtreeElements == 0) {
+			continue;
 		}
 
-		if (children != NULL) {
-			for (int i = 0; i < 8; i++) {
-				numTests += children[i].GetElementsWithinBounds(bounds, octreeHelper, items);
+		drawFunc(GetLooseBounds(nodeIdx), node.m_Depth);
+		if (node.m_FirstChild != INVALID_INDEX) {
+			for (u32 i = 0; i < 8; i++) {
+				nodeStack[stackSize++] = node.m_FirstChild + i;
 			}
-		} else {
-			for (unsigned int i = 0; i < data.size(); i++) {
-				numTests++;
-				if (octreeHelper.IntersectsBounds(bounds, data[i])) {
-					items.push_back(&data[i]);
-				}
+		}
+	}
+}
+
+/// kbOctree::InitNode
+template<typename T>
+void kbOctree<T>::InitNode(const u32 nodeIdx, const u32 parentIdx, const Vec3& center, const Vec3& halfSize, const u32 depth) {
+	node_t& node = m_Nodes[nodeIdx];
+	node.m_Center = center;
+	node.m_HalfSize = halfSize;
+	node.m_Parent = parentIdx;
+	node.m_FirstChild = INVALID_INDEX;
+	node.m_FirstElement = INVALID_INDEX;
+	node.m_NumElements = 0;
+	node.m_NumSubtreeElements = 0;
+	node.m_Depth = depth;
+}
+
+/// kbOctree::GetLooseBounds
+template<typename T>
+kbBounds kbOctree<T>::GetLooseBounds(const u32 nodeIdx) const {
+	const node_t& node = m_Nodes[nodeIdx];
+	const Vec3 looseHalfSize = node.m_HalfSize * m_Looseness;
+	return kbBounds(node.m_Center - looseHalfSize, node.m_Center + looseHalfSize);
+}
+
+/// kbOctree::FitsInNode
+template<typename T>
+bool kbOctree<T>::FitsInNode(const u32 nodeIdx, const kbBounds& bounds) const {
+	const kbBounds looseBounds = GetLooseBounds(nodeIdx);
+	return bounds.Min().x >= looseBounds.Min().x && bounds.Min().y >= looseBounds.Min().y && bounds.Min().z >= looseBounds.Min().z &&
+		   bounds.Max().x <= looseBounds.Max().x && bounds.Max().y <= looseBounds.Max().y && bounds.Max().z <= looseBounds.Max().z;
+}
+
+/// kbOctree::GetChildForBounds - Picks the child octant containing the center of bounds
+template<typename T>
+u32 kbOctree<T>::GetChildForBounds(const u32 nodeIdx, const kbBounds& bounds) const {
+	const node_t& node = m_Nodes[nodeIdx];
+	const Vec3 center = bounds.Center();
+
+	u32 octant = 0;
+	octant |= (center.x >= node.m_Center.x) ? 1 : 0;
+	octant |= (center.y >= node.m_Center.y) ? 2 : 0;
+	octant |= (center.z >= node.m_Center.z) ? 4 : 0;
+	return node.m_FirstChild + octant;
+}
+
+/// kbOctree::InsertElement - Pushes the element down from nodeIdx to the deepest node that contains it
+template<typename T>
+void kbOctree<T>::InsertElement(u32 nodeIdx, const u32 elemIdx) {
+	const kbBounds& bounds = m_Elements[elemIdx].m_Bounds;
+
+	while (true) {
+		if (m_Nodes[nodeIdx].m_FirstChild == INVALID_INDEX) {
+			if (m_Nodes[nodeIdx].m_NumElements < m_MaxElementsPerNode || m_Nodes[nodeIdx].m_Depth >= m_MaxDepth) {
+				break;
 			}
+			SplitNode(nodeIdx);
+		}
+
+		const u32 childIdx = GetChildForBounds(nodeIdx, bounds);
+		if (FitsInNode(childIdx, bounds) == false) {
+			break;
 		}
+		nodeIdx = childIdx;
+	}
+
+	LinkElement(nodeIdx, elemIdx);
+}
+
+/// kbOctree::LinkElement
+template<typename T>
+void kbOctree<T>::LinkElement(const u32 nodeIdx, const u32 elemIdx) {
+	node_t& node = m_Nodes[nodeIdx];
+	element_t& elem = m_Elements[elemIdx];
+
+	elem.m_Node = nodeIdx;
+	elem.m_Prev = INVALID_INDEX;
+	elem.m_Next = node.m_FirstElement;
+	if (node.m_FirstElement != INVALID_INDEX) {
+		m_Elements[node.m_FirstElement].m_Prev = elemIdx;
+	}
+	node.m_FirstElement = elemIdx;
+	node.m_NumElements++;
+
+	for (u32 curNode = nodeIdx; curNode != INVALID_INDEX; curNode = m_Nodes[curNode].m_Parent) {
+		m_Nodes[curNode].m_NumSubtreeElements++;
+	}
+}
+
+/// kbOctree::UnlinkElement
+template<typename T>
+void kbOctree<T>::UnlinkElement(const u32 elemIdx) {
+	element_t& elem = m_Elements[elemIdx];
+	node_t& node = m_Nodes[elem.m_Node];
+
+	if (elem.m_Prev != INVALID_INDEX) {
+		m_Elements[elem.m_Prev].m_Next = elem.m_Next;
+	} else {
+		node.m_FirstElement = elem.m_Next;
+	}
+
+	if (elem.m_Next != INVALID_INDEX) {
+		m_Elements[elem.m_Next].m_Prev = elem.m_Prev;
+	}
+	node.m_NumElements--;
 
-		return numTests;
+	for (u32 curNode = elem.m_Node; curNode != INVALID_INDEX; curNode = m_Nodes[curNode].m_Parent) {
+		m_Nodes[curNode].m_NumSubtreeElements--;
 	}
 
-	void DeleteTree() {
-		delete[] children;
+	elem.m_Node = INVALID_INDEX;
+	elem.m_Next = INVALID_INDEX;
+	elem.m_Prev = INVALID_INDEX;
+}
+
+/// kbOctree::SplitNode - Creates the node's children and pushes down any elements that fit in them
+template<typename T>
+void kbOctree<T>::SplitNode(const u32 nodeIdx) {
+	const u32 firstChild = AllocateNodeBlock();
+
+	const Vec3 center = m_Nodes[nodeIdx].m_Center;
+	const Vec3 childHalfSize = m_Nodes[nodeIdx].m_HalfSize * 0.5f;
+	const u32 childDepth = m_Nodes[nodeIdx].m_Depth + 1;
+	for (u32 i = 0; i < 8; i++) {
+		const Vec3 childCenter(
+			center.x + ((i & 1) ? childHalfSize.x : -childHalfSize.x),
+			center.y + ((i & 2) ? childHalfSize.y : -childHalfSize.y),
+			center.z + ((i & 4) ? childHalfSize.z : -childHalfSize.z));
+		InitNode(firstChild + i, nodeIdx, childCenter, childHalfSize, childDepth);
 	}
+	m_Nodes[nodeIdx].m_FirstChild = firstChild;
 
-	void DebugDraw() {
-		if (children != NULL) {
-			for (int i = 0; i < 8; i++) {
-				children[i].DebugDraw();
+	u32 elemIdx = m_Nodes[nodeIdx].m_FirstElement;
+	while (elemIdx != INVALID_INDEX) {
+		const u32 nextElemIdx = m_Elements[elemIdx].m_Next;
+		const u32 childIdx = GetChildForBounds(nodeIdx, m_Elements[elemIdx].m_Bounds);
+		if (FitsInNode(childIdx, m_Elements[elemIdx].m_Bounds)) {
+			UnlinkElement(elemIdx);
+			LinkElement(childIdx, elemIdx);
+		}
+		elemIdx = nextElemIdx;
+	}
+}
+
+/// kbOctree::CollapseNode - Pulls all descendant elements into nodeIdx and releases its children
+template<typename T>
+void kbOctree<T>::CollapseNode(const u32 nodeIdx) {
+	const u32 firstChild = m_Nodes[nodeIdx].m_FirstChild;
+	if (firstChild == INVALID_INDEX) {
+		return;
+	}
+
+	for (u32 i = 0; i < 8; i++) {
+		const u32 childIdx = firstChild + i;
+		CollapseNode(childIdx);
+
+		while (m_Nodes[childIdx].m_FirstElement != INVALID_INDEX) {
+			const u32 elemIdx = m_Nodes[childIdx].m_FirstElement;
+			UnlinkElement(elemIdx);
+			LinkElement(nodeIdx, elemIdx);
+		}
+	}
+
+	m_Nodes[nodeIdx].m_FirstChild = INVALID_INDEX;
+	FreeNodeBlock(firstChild);
+}
+
+/// kbOctree::TryCollapse - Collapses the highest ancestor of nodeIdx whose subtree has become sparse
+template<typename T>
+void kbOctree<T>::TryCollapse(u32 nodeIdx) {
+	const u32 collapseThreshold = m_MaxElementsPerNode / 2;
+
+	u32 collapseIdx = INVALID_INDEX;
+	for (; nodeIdx != INVALID_INDEX; nodeIdx = m_Nodes[nodeIdx].m_Parent) {
+		if (m_Nodes[nodeIdx].m_FirstChild != INVALID_INDEX && m_Nodes[nodeIdx].m_NumSubtreeElements <= collapseThreshold) {
+			collapseIdx = nodeIdx;
+		}
+	}
+
+	if (collapseIdx != INVALID_INDEX) {
+		CollapseNode(collapseIdx);
+	}
+}
+
+/// kbOctree::AllocateNodeBlock
+template<typename T>
+u32 kbOctree<T>::AllocateNodeBlock() {
+	if (m_FreeNodeBlocks.empty() == false) {
+		const u32 firstChild = m_FreeNodeBlocks.back();
+		m_FreeNodeBlocks.pop_back();
+		return firstChild;
+	}
+
+	const u32 firstChild = (u32)m_Nodes.size();
+	m_Nodes.resize(m_Nodes.size() + 8);
+	return firstChild;
+}
+
+/// kbOctree::FreeNodeBlock
+template<typename T>
+void kbOctree<T>::FreeNodeBlock(const u32 firstChild) {
+	m_FreeNodeBlocks.push_back(firstChild);
+}
+
+/// kbOctree::AppendSubtree
+template<typename T>
+void kbOctree<T>::AppendSubtree(const u32 nodeIdx, std::vector<T>& outElements) const {
+	const node_t& node = m_Nodes[nodeIdx];
+	if (node.m_NumSubtreeElements == 0) {
+		return;
+	}
+
+	for (u32 elemIdx = node.m_FirstElement; elemIdx != INVALID_INDEX; elemIdx = m_Elements[elemIdx].m_Next) {
+		outElements.push_back(m_Elements[elemIdx].m_Data);
+	}
+
+	if (node.m_FirstChild != INVALID_INDEX) {
+		for (u32 i = 0; i < 8; i++) {
+			AppendSubtree(node.m_FirstChild + i, outElements);
+		}
+	}
+}
+
+/// kbOctree::TestBoundsAgainstFrustum - Frustum planes are expected to face outward, as returned by Mat4::*_clip_plane()
+template<typename T>
+typename kbOctree<T>::FrustumTest_t kbOctree<T>::TestBoundsAgainstFrustum(const kbBounds& bounds, const Plane3d frustumPlanes[6]) {
+	const Vec3 center = bounds.Center();
+	const Vec3 extents = (bounds.Max() - bounds.Min()) * 0.5f;
+
+	FrustumTest_t result = Frustum_Inside;
+	for (u32 i = 0; i < 6; i++) {
+		const Plane3d& plane = frustumPlanes[i];
+		const float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z - plane.w;
+		const float radius = fabs(plane.x) * extents.x + fabs(plane.y) * extents.y + fabs(plane.z) * extents.z;
+		if (dist > radius) {
+			return Frustum_Outside;
+		}
+
+		if (dist > -radius) {
+			result = Frustum_Intersects;
+		}
+	}
+
+	return result;
+}
+
+/// kbOctree::RayIntersectsBounds
+template<typename T>
+bool kbOctree<T>::RayIntersectsBounds(const Vec3& origin, const Vec3& direction, const Vec3& invDirection, const float maxDist, const kbBounds& bounds) {
+	float tMin = 0.0f;
+	float tMax = maxDist;
+	for (int i = 0; i < 3; i++) {
+		// A ray parallel to this slab would give 0 * inf = NaN when its origin lies on one of the slab's planes
+		if (direction[i] == 0.0f) {
+			if (origin[i] < bounds.Min()[i] || origin[i] > bounds.Max()[i]) {
+				return false;
 			}
-			assert(data.Num() == 0);
+			continue;
+		}
 
-		} else {
-			Vec4 color(gameLocal->random.RandomFloat(), gameLocal->random.RandomFloat(), gameLocal->random.RandomFloat(), 0.0f);
-			color.normalize_self();
-			color *= 0.5f;
-			color.w = 1;
-			//gameLocal->GetRenderDebug()->DebugBounds( color, nodeBounds, vec3_origin, 60000 );
+		float t0 = (bounds.Min()[i] - origin[i]) * invDirection[i];
+		float t1 = (bounds.Max()[i] - origin[i]) * invDirection[i];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
 
-		/*	for ( int i = 0; i < data.Num(); i++ ) {
-				gameLocal->GetRenderDebug()->DebugPoint( color, data[i].position, 60000 );
-			}*/
+		tMin = (t0 > tMin) ? t0 : tMin;
+		tMax = (t1 < tMax) ? t1 : tMax;
+		if (tMin > tMax) {
+			return false;
 		}
 	}
 
-private:
-	kbBounds nodeBounds;
-	kbOctree* children;
-	std::vector<T> data;
-	int	currentDepth;
-};
\ No newline at end of file
+	return true;
+}
+
+/// BenchmarkOctree - Checks adds, removes, moves and bounds, frustum and ray queries against a brute force search over
+/// the same elements, and times both.  Warns and returns false on the first mismatch
+bool BenchmarkOctree(const u32 numElements, const u32 numFrames);
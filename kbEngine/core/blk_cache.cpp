@@ -0,0 +1,54 @@
+/// blk_cache.cpp
+///
+/// 2025 blk 1.0
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include "blk_core.h"
+#include "blk_cache.h"
+#include "blk_file_system.h"
+
+/// GetCacheFileName
+std::string GetCacheFileName(const std::string& sourceFileName) {
+	const size_t namePos = sourceFileName.find_last_of("/\\");
+	const std::string name = (namePos == std::string::npos) ? (sourceFileName) : (sourceFileName.substr(namePos + 1));
+
+	char hashStr[32];
+	sprintf_s(hashStr, "%016llx", kbHashName(sourceFileName));
+	return "./cache/" + name + "." + hashStr + ".kbCache";
+}
+
+/// GetSourceStamp
+bool GetSourceStamp(const std::string& sourceFileName, u64& outSize, u64& outTime) {
+	return g_FileSystem.GetFileStamp(sourceFileName, outSize, outTime);
+}
+
+/// kbCacheWriter::Save
+bool kbCacheWriter::Save(const std::string& fileName) const {
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(fileName).parent_path(), error);
+
+	// Written under a temporary name and renamed into place, so a reader on another thread, process or machine sharing
+	// the directory never sees a partial file
+	char tempSuffix[32];
+	sprintf_s(tempSuffix, ".%016llx.tmp", (u64)std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (u64)std::chrono::steady_clock::now().time_since_epoch().count());
+	const std::string tempFileName = fileName + tempSuffix;
+	{
+		std::ofstream outFile(tempFileName, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+		outFile.write((const char*)m_Data.data(), m_Data.size());
+		if (outFile.good() == false) {
+			outFile.close();
+			std::filesystem::remove(tempFileName, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempFileName, fileName, error);
+	if (error) {
+		std::filesystem::remove(tempFileName, error);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+/// blk_cache.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+/// GetCacheFileName - Cooked files live outside the watched asset folders so writing them doesn't trigger a hot reload
+std::string GetCacheFileName(const std::string& sourceFileName);
+
+/// GetSourceStamp - A cooked file is only used while its source's size and write time match the ones it was cooked from.
+/// Sources are found through g_FileSystem, so ones that only ship in an archive are stamped with the archive's write time
+bool GetSourceStamp(const std::string& sourceFileName, u64& outSize, u64& outTime);
+
+/// kbCacheWriter
+class kbCacheWriter {
+public:
+	template<typename T>
+	void Write(const T& value) { Write(&value, sizeof(T)); }
+
+	template<typename T>
+	void WriteArray(const std::vector<T>& values) { Write(values.data(), values.size() * sizeof(T)); }
+
+	void Write(const void* const pData, const size_t size) {
+		m_Data.insert(m_Data.end(), (const byte*)pData, (const byte*)pData + size);
+		m_Data.resize((m_Data.size() + 3) & ~(size_t)3, 0);
+	}
+
+	void WriteString(const std::string& str) {
+		Write((u32)str.size());
+		Write(str.data(), str.size());
+	}
+
+	/// Creates the file's directory if needed
+	bool Save(const std::string& fileName) const;
+
+private:
+	std::vector<byte> m_Data;
+};
+
+/// kbCacheReader - Reads out of a mapped cooked file.  Every read is bounds checked, so a truncated file fails to load
+/// instead of reading past the view
+class kbCacheReader {
+public:
+	kbCacheReader(const byte* const pData, const size_t size) : m_pData(pData), m_Size(size), m_Pos(0) { }
+
+	template<typename T>
+	bool Read(T& outValue) { return Read(&outValue, sizeof(T)); }
+
+	template<typename T>
+	bool ReadArray(std::vector<T>& outValues, const size_t count) {
+		if (count > (m_Size - m_Pos) / sizeof(T)) {
+			return false;
+		}
+		outValues.resize(count);
+		return Read(outValues.data(), count * sizeof(T));
+	}
+
+	bool Read(void* const pOutData, const size_t size) {
+		if (size > m_Size - m_Pos) {
+			return false;
+		}
+		memcpy(pOutData, m_pData + m_Pos, size);
+		m_Pos = std::min(m_Size, (m_Pos + size + 3) & ~(size_t)3);
+		return true;
+	}
+
+	bool ReadString(std::string& outStr) {
+		u32 length = 0;
+		if (Read(length) == false || length > m_Size - m_Pos) {
+			return false;
+		}
+		outStr.assign((const char*)m_pData + m_Pos, length);
+		m_Pos = std::min(m_Size, (m_Pos + length + 3) & ~(size_t)3);
+		return true;
+	}
+
+private:
+	const byte* m_pData;
+	size_t m_Size;
+	size_t m_Pos;
+};
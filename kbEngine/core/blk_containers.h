@@ -31,4 +31,39 @@ namespace blk {
 	auto std_find(const T& list, B entry) {
 		return std::find(list.begin(), list.end(), entry);
 	}
+
+	/// find_key_index
+	///
+	/// Returns the index of the last key whose time is <= t, or -1 if t comes before the first key.  Keys must be sorted
+	/// by time.  cursor holds the result of the previous search on the same keys.  It's checked and stepped forward a few
+	/// keys before falling back to a binary search, so sampling with increasing times is O(1) amortized.  Out of range
+	/// cursors, such as UINT_MAX for "no cursor", go straight to the binary search
+	template<typename T, typename GetTime>
+	int find_key_index(const T* const keys, const int num_keys, const float t, u32& cursor, GetTime get_time) {
+		if (num_keys <= 0) {
+			return -1;
+		}
+
+		int key_idx = 0;
+		if (cursor < (u32)num_keys && get_time(keys[cursor]) <= t) {
+			key_idx = (int)cursor;
+			for (int step = 0; step < 4; step++, key_idx++) {
+				if (key_idx + 1 >= num_keys || t < get_time(keys[key_idx + 1])) {
+					cursor = (u32)key_idx;
+					return key_idx;
+				}
+			}
+		}
+
+		const T* const next_key = std::upper_bound(keys, keys + num_keys, t, [&get_time](const float time, const T& key) { return time < get_time(key); });
+		key_idx = (int)(next_key - keys) - 1;
+		cursor = (key_idx > 0) ? ((u32)key_idx) : (0);
+		return key_idx;
+	}
+
+	/// find_key_index
+	template<typename T, typename GetTime>
+	int find_key_index(const std::vector<T>& keys, const float t, u32& cursor, GetTime get_time) {
+		return find_key_index(keys.data(), (int)keys.size(), t, cursor, get_time);
+	}
 }
\ No newline at end of file
@@ -261,8 +261,11 @@ DECLARE_SCOPED_TIMER(GAME_THREAD, "Game Thread")
 DECLARE_SCOPED_TIMER(GAME_ENTITY_UPDATE, "   Entity Update")
 DECLARE_SCOPED_TIMER(COMPONENT_UPDATE, "      Component Update")
 DECLARE_SCOPED_TIMER(CLOTH_COMPONENT, "         Cloth Component")
+DECLARE_SCOPED_TIMER(SKELETAL_ANIMATION, "   Skeletal Animation")
+DECLARE_SCOPED_TIMER(CLOTH_SIMULATION, "   Cloth Simulation")
 DECLARE_SCOPED_TIMER(GAME_THREAD_IDLE, "   Game Thread Idle")
 DECLARE_SCOPED_TIMER(RENDER_THREAD, "Render Thread")
+DECLARE_SCOPED_TIMER(RENDER_CULL, "   Render Cull")
 DECLARE_SCOPED_TIMER(RENDER_THREAD_CLEAR_BUFFERS, "   Clear Buffers")
 DECLARE_SCOPED_TIMER(RENDER_G_BUFFER, "   Render G-Buffer")
 DECLARE_SCOPED_TIMER(RENDER_LIGHTING, "   Render Lighting")
@@ -324,3 +327,53 @@ void UpdateScopedTimers() {
 const kbScopedTimerData_t& GetScopedTimerData(const ScopedTimerList_t index) {
 	return *g_ScopedTimerMap[index];
 }
+
+/// kbMappedFile::Open
+bool kbMappedFile::Open(const std::string& fileName) {
+	Close();
+
+	m_hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(m_hFile, &fileSize) == FALSE || fileSize.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr) {
+		Close();
+		return false;
+	}
+
+	m_pData = (const byte*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == nullptr) {
+		Close();
+		return false;
+	}
+	m_Size = (size_t)fileSize.QuadPart;
+
+	return true;
+}
+
+/// kbMappedFile::Close
+void kbMappedFile::Close() {
+	if (m_pData != nullptr) {
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+
+	if (m_hMapping != nullptr) {
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_Size = 0;
+}
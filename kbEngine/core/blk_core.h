@@ -14,6 +14,7 @@
 #include <set>
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include "blk_string.h"
 
 void StringFromWString(std::string& outString, const std::wstring& srcString);
@@ -57,6 +58,16 @@ typedef uint64_t u64;
 
 typedef int32_t i32;
 
+/// kbHashName - 64 bit FNV-1a.  Used to look up names that are known ahead of time without comparing strings
+constexpr u64 kbHashName(const std::string_view name) {
+	u64 hash = 0xcbf29ce484222325ull;
+	for (const char c : name) {
+		hash ^= (u8)c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
 ///	kbGUID - Each kbGameEntity is given a GUID at construction that is saved out and referenced across multiple files
 struct kbGUID {
 	kbGUID() {
@@ -148,8 +159,11 @@ enum ScopedTimerList_t {
 	GAME_ENTITY_UPDATE,
 	COMPONENT_UPDATE,
 	CLOTH_COMPONENT,
+	SKELETAL_ANIMATION,
+	CLOTH_SIMULATION,
 	GAME_THREAD_IDLE,
 	RENDER_THREAD,
+	RENDER_CULL,
 	RENDER_THREAD_CLEAR_BUFFERS,
 	RENDER_G_BUFFER,
 	RENDER_LIGHTING,
@@ -326,3 +340,27 @@ struct kbTextParser {
 		}
 	}
 };
+
+/// kbMappedFile - Read only view of a whole file.  The view is valid until Close() or destruction
+class kbMappedFile {
+public:
+	kbMappedFile() : m_hFile(INVALID_HANDLE_VALUE), m_hMapping(nullptr), m_pData(nullptr), m_Size(0) { }
+	~kbMappedFile() { Close(); }
+
+	kbMappedFile(const kbMappedFile&) = delete;
+	kbMappedFile& operator=(const kbMappedFile&) = delete;
+
+	bool Open(const std::string& fileName);
+	void Close();
+	void Swap(kbMappedFile& other) { std::swap(m_hFile, other.m_hFile); std::swap(m_hMapping, other.m_hMapping); std::swap(m_pData, other.m_pData); std::swap(m_Size, other.m_Size); }
+
+	bool IsOpen() const { return m_pData != nullptr; }
+	const byte* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+	const byte* m_pData;
+	size_t m_Size;
+};
@@ -0,0 +1,696 @@
+/// blk_file_system.cpp
+///
+/// 2025 blk 1.0
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include "blk_core.h"
+#include "blk_console.h"
+#include "blk_file_system.h"
+
+kbFileSystem g_FileSystem;
+
+kbConsoleVariable g_VFSLooseFiles("vfsloosefiles", true, kbConsoleVariable::Console_Bool, "Read loose files from disk before looking in mounted archives.", "");
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(kbArchiveHeader_t) == 48, "kbArchiveHeader_t is written to disk");
+static_assert(sizeof(kbArchiveEntry_t) == 40, "kbArchiveEntry_t is written to disk");
+
+static const size_t g_LZ4MinMatch = 4;
+static const size_t g_LZ4LastLiterals = 5;		// The last five bytes are always literals
+static const size_t g_LZ4MatchSearchLimit = 12;	// The last match starts at least twelve bytes before the end
+static const size_t g_LZ4MaxOffset = 65535;
+
+/// LZ4WriteLength
+static void LZ4WriteLength(std::vector<byte>& out, size_t length) {
+	while (length >= 255) {
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back((byte)length);
+}
+
+/// LZ4ReadLength
+static bool LZ4ReadLength(const byte*& pIn, const byte* const pInEnd, size_t& length) {
+	byte nextByte = 255;
+	while (nextByte == 255) {
+		if (pIn >= pInEnd) {
+			return false;
+		}
+		nextByte = *pIn++;
+		length += nextByte;
+	}
+	return true;
+}
+
+/// LZ4Compress - Greedy compressor that writes the LZ4 block format
+static void LZ4Compress(const byte* const pSrc, const size_t srcSize, std::vector<byte>& out) {
+	out.clear();
+	out.reserve(srcSize);
+
+	std::vector<u32> hashTable(1 << 16, UINT32_MAX);
+
+	size_t anchor = 0;
+	size_t pos = 0;
+	if (srcSize > g_LZ4MatchSearchLimit) {
+		const size_t lastMatchStart = srcSize - g_LZ4MatchSearchLimit;
+		const size_t matchEndLimit = srcSize - g_LZ4LastLiterals;
+
+		while (pos <= lastMatchStart) {
+			u32 sequence;
+			memcpy(&sequence, pSrc + pos, sizeof(sequence));
+
+			const u32 hash = (sequence * 2654435761u) >> 16;
+			const u32 candidate = hashTable[hash];
+			hashTable[hash] = (u32)pos;
+
+			if (candidate == UINT32_MAX || pos - candidate > g_LZ4MaxOffset || memcmp(pSrc + candidate, pSrc + pos, g_LZ4MinMatch) != 0) {
+				pos++;
+				continue;
+			}
+
+			size_t matchLength = g_LZ4MinMatch;
+			while (pos + matchLength < matchEndLimit && pSrc[candidate + matchLength] == pSrc[pos + matchLength]) {
+				matchLength++;
+			}
+
+			const size_t literalLength = pos - anchor;
+			const size_t matchCode = matchLength - g_LZ4MinMatch;
+			out.push_back((byte)((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+			if (literalLength >= 15) {
+				LZ4WriteLength(out, literalLength - 15);
+			}
+			out.insert(out.end(), pSrc + anchor, pSrc + pos);
+
+			const size_t offset = pos - candidate;
+			out.push_back((byte)(offset & 0xff));
+			out.push_back((byte)(offset >> 8));
+			if (matchCode >= 15) {
+				LZ4WriteLength(out, matchCode - 15);
+			}
+
+			pos += matchLength;
+			anchor = pos;
+		}
+	}
+
+	// The last sequence is only literals
+	const size_t literalLength = srcSize - anchor;
+	out.push_back((byte)(std::min<size_t>(literalLength, 15) << 4));
+	if (literalLength >= 15) {
+		LZ4WriteLength(out, literalLength - 15);
+	}
+	out.insert(out.end(), pSrc + anchor, pSrc + srcSize);
+}
+
+/// LZ4Decompress - Fails on any sequence that would read or write out of bounds
+static bool LZ4Decompress(const byte* const pSrc, const size_t srcSize, byte* const pDst, const size_t dstSize) {
+	const byte* pIn = pSrc;
+	const byte* const pInEnd = pSrc + srcSize;
+	byte* pOut = pDst;
+	byte* const pOutEnd = pDst + dstSize;
+
+	while (pIn < pInEnd) {
+		const byte token = *pIn++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && LZ4ReadLength(pIn, pInEnd, literalLength) == false) {
+			return false;
+		}
+
+		if ((size_t)(pInEnd - pIn) < literalLength || (size_t)(pOutEnd - pOut) < literalLength) {
+			return false;
+		}
+		memcpy(pOut, pIn, literalLength);
+		pIn += literalLength;
+		pOut += literalLength;
+
+		if (pIn == pInEnd) {
+			break;
+		}
+
+		if (pInEnd - pIn < 2) {
+			return false;
+		}
+		const size_t offset = (size_t)pIn[0] | ((size_t)pIn[1] << 8);
+		pIn += 2;
+		if (offset == 0 || offset > (size_t)(pOut - pDst)) {
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && LZ4ReadLength(pIn, pInEnd, matchLength) == false) {
+			return false;
+		}
+		matchLength += g_LZ4MinMatch;
+
+		if ((size_t)(pOutEnd - pOut) < matchLength) {
+			return false;
+		}
+
+		// Matches can overlap the bytes they produce
+		const byte* const pMatch = pOut - offset;
+		for (size_t i = 0; i < matchLength; i++) {
+			pOut[i] = pMatch[i];
+		}
+		pOut += matchLength;
+	}
+
+	return pOut == pOutEnd;
+}
+
+/// kbFileData::Prefetch
+void kbFileData::Prefetch() const {
+	if (m_pData == nullptr || m_Buffer.empty() == false) {
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = (PVOID)m_pData;
+	range.NumberOfBytes = m_Size;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+/// kbFileData::Release
+void kbFileData::Release() {
+	m_MappedFile.Close();
+	m_pArchiveFile.reset();
+	std::vector<byte>().swap(m_Buffer);
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+/// kbFileData::Swap
+void kbFileData::Swap(kbFileData& other) {
+	m_MappedFile.Swap(other.m_MappedFile);
+	m_pArchiveFile.swap(other.m_pArchiveFile);
+	m_Buffer.swap(other.m_Buffer);
+	std::swap(m_pData, other.m_pData);
+	std::swap(m_Size, other.m_Size);
+}
+
+/// kbArchive::Open
+bool kbArchive::Open(const std::string& fileName) {
+	Close();
+
+	m_pFile = std::make_shared<kbMappedFile>();
+	if (m_pFile->Open(fileName) == false) {
+		m_pFile.reset();
+		blk::warn("kbArchive::Open() - Failed to map %s", fileName.c_str());
+		return false;
+	}
+	m_FileName = fileName;
+
+	const byte* const pData = m_pFile->GetData();
+	const size_t fileSize = m_pFile->GetSize();
+
+	const kbArchiveHeader_t* const pHeader = (const kbArchiveHeader_t*)pData;
+	bool bIsValid = fileSize >= sizeof(kbArchiveHeader_t) && pHeader->m_Magic == Magic && pHeader->m_Version == Version;
+	bIsValid = bIsValid && pHeader->m_Entries <= fileSize && (fileSize - pHeader->m_Entries) / sizeof(kbArchiveEntry_t) >= pHeader->m_NumEntries;
+	bIsValid = bIsValid && pHeader->m_NamesSize > 0 && pHeader->m_Names <= fileSize && fileSize - pHeader->m_Names >= pHeader->m_NamesSize;
+	bIsValid = bIsValid && pData[pHeader->m_Names + pHeader->m_NamesSize - 1] == '\0' && pHeader->m_MountPointName < pHeader->m_NamesSize;
+	if (bIsValid == false) {
+		blk::warn("kbArchive::Open() - %s is not a valid archive", fileName.c_str());
+		Close();
+		return false;
+	}
+
+	const kbArchiveEntry_t* const pEntries = (const kbArchiveEntry_t*)(pData + pHeader->m_Entries);
+	for (u32 i = 0; i < pHeader->m_NumEntries; i++) {
+		const kbArchiveEntry_t& entry = pEntries[i];
+		const bool bEntryIsValid = entry.m_Name < pHeader->m_NamesSize && entry.m_StoredSize <= fileSize && entry.m_Offset <= fileSize - entry.m_StoredSize &&
+								   (entry.m_Compression == kbArchiveEntry_t::Compression_LZ4 || (entry.m_Compression == kbArchiveEntry_t::Compression_None && entry.m_StoredSize == entry.m_Size));
+		if (bEntryIsValid == false) {
+			blk::warn("kbArchive::Open() - Entry %u of %s is corrupt", i, fileName.c_str());
+			Close();
+			return false;
+		}
+	}
+
+	m_pHeader = pHeader;
+	m_pEntries = pEntries;
+	m_pNames = (const char*)(pData + pHeader->m_Names);
+	return true;
+}
+
+/// kbArchive::Close
+void kbArchive::Close() {
+	m_pFile.reset();
+	m_FileName.clear();
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+	m_pNames = nullptr;
+}
+
+/// kbArchive::FindEntry
+const kbArchiveEntry_t* kbArchive::FindEntry(const std::string_view path) const {
+	if (m_pHeader == nullptr) {
+		return nullptr;
+	}
+
+	const u64 pathHash = kbHashName(path);
+	const kbArchiveEntry_t* const pEnd = m_pEntries + m_pHeader->m_NumEntries;
+	const kbArchiveEntry_t* pEntry = std::lower_bound(m_pEntries, pEnd, pathHash,
+		[](const kbArchiveEntry_t& entry, const u64 hash) { return entry.m_PathHash < hash; });
+
+	for (; pEntry < pEnd && pEntry->m_PathHash == pathHash; pEntry++) {
+		if (GetEntryName(*pEntry) == path) {
+			return pEntry;
+		}
+	}
+	return nullptr;
+}
+
+/// kbArchive::ReadEntry
+bool kbArchive::ReadEntry(const kbArchiveEntry_t& entry, kbFileData& outData) const {
+	outData.Release();
+
+	const byte* const pStoredData = m_pFile->GetData() + entry.m_Offset;
+	if (entry.m_Compression == kbArchiveEntry_t::Compression_None) {
+		outData.m_pArchiveFile = m_pFile;
+		outData.m_pData = pStoredData;
+		outData.m_Size = (size_t)entry.m_Size;
+		return true;
+	}
+
+	outData.m_Buffer.resize((size_t)entry.m_Size);
+	if (LZ4Decompress(pStoredData, (size_t)entry.m_StoredSize, outData.m_Buffer.data(), outData.m_Buffer.size()) == false) {
+		blk::warn("kbArchive::ReadEntry() - %s in %s is corrupt", GetEntryName(entry).data(), m_FileName.c_str());
+		outData.Release();
+		return false;
+	}
+
+	outData.m_pData = outData.m_Buffer.data();
+	outData.m_Size = outData.m_Buffer.size();
+	return true;
+}
+
+/// kbArchive::Build
+bool kbArchive::Build(const std::string& archiveFileName, const std::string& sourceDirectory, const std::string& mountPoint, const bool bCompress, const u32 alignment) {
+	if (alignment < 8 || (alignment & (alignment - 1)) != 0) {
+		blk::warn("kbArchive::Build() - Alignment %u is not a power of two of at least 8", alignment);
+		return false;
+	}
+
+	std::error_code error;
+	if (fs::is_directory(sourceDirectory, error) == false) {
+		blk::warn("kbArchive::Build() - %s is not a directory", sourceDirectory.c_str());
+		return false;
+	}
+
+	kbTimer buildTimer;
+
+	struct kbBuildEntry_t {
+		std::string m_Name;
+		std::string m_SourceFileName;
+		kbArchiveEntry_t m_Entry;
+	};
+
+	std::vector<kbBuildEntry_t> buildEntries;
+	for (fs::recursive_directory_iterator it(sourceDirectory, error), end; it != end; it.increment(error)) {
+		std::string extension = GetFileExtension(it->path().string());
+		StringToLower(extension);
+		if (it->is_regular_file(error) == false || extension == "kbarc") {
+			continue;
+		}
+
+		kbBuildEntry_t buildEntry;
+		buildEntry.m_Name = kbFileSystem::NormalizePath(fs::relative(it->path(), sourceDirectory, error).generic_string());
+		buildEntry.m_SourceFileName = it->path().string();
+		memset(&buildEntry.m_Entry, 0, sizeof(buildEntry.m_Entry));
+		buildEntry.m_Entry.m_PathHash = kbHashName(buildEntry.m_Name);
+		buildEntries.push_back(buildEntry);
+	}
+
+	std::sort(buildEntries.begin(), buildEntries.end(),
+		[](const kbBuildEntry_t& a, const kbBuildEntry_t& b) { return (a.m_Entry.m_PathHash != b.m_Entry.m_PathHash) ? (a.m_Entry.m_PathHash < b.m_Entry.m_PathHash) : (a.m_Name < b.m_Name); });
+
+	// The mount point is the first name
+	std::string normalizedMountPoint = kbFileSystem::NormalizePath(mountPoint);
+	if (normalizedMountPoint.empty() == false && normalizedMountPoint.back() != '/') {
+		normalizedMountPoint += '/';
+	}
+
+	std::string names = normalizedMountPoint;
+	names += '\0';
+	for (size_t i = 0; i < buildEntries.size(); i++) {
+		buildEntries[i].m_Entry.m_Name = (u32)names.size();
+		names += buildEntries[i].m_Name;
+		names += '\0';
+	}
+
+	kbArchiveHeader_t header;
+	memset(&header, 0, sizeof(header));
+	header.m_Magic = Magic;
+	header.m_Version = Version;
+	header.m_NumEntries = (u32)buildEntries.size();
+	header.m_Alignment = alignment;
+	header.m_Entries = sizeof(kbArchiveHeader_t);
+	header.m_Names = header.m_Entries + buildEntries.size() * sizeof(kbArchiveEntry_t);
+	header.m_NamesSize = names.size();
+	header.m_MountPointName = 0;
+
+	const std::string tempFileName = archiveFileName + "_tmp";
+	std::ofstream outFile(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (outFile.fail()) {
+		blk::warn("kbArchive::Build() - Failed to open %s for writing", tempFileName.c_str());
+		return false;
+	}
+
+	// The table of contents is written once every entry's offset is known
+	outFile.write((const char*)&header, sizeof(header));
+	outFile.seekp(header.m_Names);
+	outFile.write(names.data(), names.size());
+
+	u64 offset = header.m_Names + header.m_NamesSize;
+	u64 totalSize = 0;
+	u64 totalStoredSize = 0;
+
+	std::vector<byte> fileData;
+	std::vector<byte> compressedData;
+	const std::vector<byte> padding(alignment, 0);
+	for (size_t i = 0; i < buildEntries.size(); i++) {
+		kbBuildEntry_t& buildEntry = buildEntries[i];
+
+		std::ifstream inFile(buildEntry.m_SourceFileName, std::ios::in | std::ios::binary | std::ios::ate);
+		if (inFile.fail()) {
+			blk::warn("kbArchive::Build() - Failed to read %s", buildEntry.m_SourceFileName.c_str());
+			outFile.close();
+			fs::remove(tempFileName, error);
+			return false;
+		}
+
+		fileData.resize((size_t)inFile.tellg());
+		inFile.seekg(0, std::ios::beg);
+		inFile.read((char*)fileData.data(), fileData.size());
+
+		// Only keep the compressed copy if it saves at least an eighth
+		const std::vector<byte>* pStoredData = &fileData;
+		buildEntry.m_Entry.m_Compression = kbArchiveEntry_t::Compression_None;
+		if (bCompress && fileData.size() >= 64 && fileData.size() < UINT32_MAX) {
+			LZ4Compress(fileData.data(), fileData.size(), compressedData);
+			if (compressedData.size() <= fileData.size() - fileData.size() / 8) {
+				pStoredData = &compressedData;
+				buildEntry.m_Entry.m_Compression = kbArchiveEntry_t::Compression_LZ4;
+			}
+		}
+
+		const u64 alignedOffset = (offset + alignment - 1) & ~(u64)(alignment - 1);
+		outFile.write((const char*)padding.data(), (std::streamsize)(alignedOffset - offset));
+
+		buildEntry.m_Entry.m_Offset = alignedOffset;
+		buildEntry.m_Entry.m_Size = fileData.size();
+		buildEntry.m_Entry.m_StoredSize = pStoredData->size();
+		outFile.write((const char*)pStoredData->data(), pStoredData->size());
+
+		offset = alignedOffset + pStoredData->size();
+		totalSize += fileData.size();
+		totalStoredSize += pStoredData->size();
+	}
+
+	outFile.seekp(header.m_Entries);
+	for (size_t i = 0; i < buildEntries.size(); i++) {
+		outFile.write((const char*)&buildEntries[i].m_Entry, sizeof(kbArchiveEntry_t));
+	}
+
+	const bool bWritten = outFile.good();
+	outFile.close();
+	if (bWritten == false) {
+		blk::warn("kbArchive::Build() - Failed to write %s", tempFileName.c_str());
+		fs::remove(tempFileName, error);
+		return false;
+	}
+
+	fs::rename(tempFileName, archiveFileName, error);
+	if (error) {
+		blk::warn("kbArchive::Build() - Failed to replace %s", archiveFileName.c_str());
+		fs::remove(tempFileName, error);
+		return false;
+	}
+
+	blk::log("Built %s from %s in %.2f seconds - %u files, %.2f MB stored as %.2f MB", archiveFileName.c_str(), sourceDirectory.c_str(), buildTimer.TimeElapsedSeconds(),
+			 (u32)buildEntries.size(), totalSize / (1024.0 * 1024.0), totalStoredSize / (1024.0 * 1024.0));
+	return true;
+}
+
+/// kbFileSystem::~kbFileSystem
+kbFileSystem::~kbFileSystem() {
+	UnmountAll();
+}
+
+/// kbFileSystem::NormalizePath
+std::string kbFileSystem::NormalizePath(const std::string_view path) {
+	std::string normalizedPath(path);
+	std::replace(normalizedPath.begin(), normalizedPath.end(), '\\', '/');
+	std::transform(normalizedPath.begin(), normalizedPath.end(), normalizedPath.begin(), ::tolower);
+
+	size_t start = 0;
+	while (normalizedPath.compare(start, 2, "./") == 0) {
+		start += 2;
+	}
+	return normalizedPath.substr(start);
+}
+
+/// kbFileSystem::GetMountRelativePath
+const char* kbFileSystem::GetMountRelativePath(const kbMount_t& mount, const std::string& normalizedPath) {
+	if (normalizedPath.compare(0, mount.m_MountPoint.size(), mount.m_MountPoint) != 0) {
+		return nullptr;
+	}
+	return normalizedPath.c_str() + mount.m_MountPoint.size();
+}
+
+/// kbFileSystem::MountDirectory
+bool kbFileSystem::MountDirectory(const std::string& mountPoint, const std::string& directory) {
+	std::error_code error;
+	if (fs::is_directory(directory, error) == false) {
+		blk::warn("kbFileSystem::MountDirectory() - %s is not a directory", directory.c_str());
+		return false;
+	}
+
+	kbMount_t mount;
+	mount.m_MountPoint = NormalizePath(mountPoint);
+	if (mount.m_MountPoint.empty() == false && mount.m_MountPoint.back() != '/') {
+		mount.m_MountPoint += '/';
+	}
+
+	mount.m_Directory = directory;
+	if (mount.m_Directory.back() != '/' && mount.m_Directory.back() != '\\') {
+		mount.m_Directory += '/';
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_MountLock);
+	m_Directories.push_back(mount);
+
+	blk::log("Mounted %s at \"%s\"", directory.c_str(), mount.m_MountPoint.c_str());
+	return true;
+}
+
+/// kbFileSystem::MountArchive
+bool kbFileSystem::MountArchive(const std::string& archiveFileName) {
+	kbArchive* const pArchive = new kbArchive();
+	if (pArchive->Open(archiveFileName) == false) {
+		delete pArchive;
+		return false;
+	}
+
+	kbMount_t mount;
+	mount.m_MountPoint = pArchive->GetMountPoint();
+	mount.m_pArchive = pArchive;
+
+	std::unique_lock<std::shared_mutex> lock(m_MountLock);
+	m_Archives.push_back(mount);
+
+	blk::log("Mounted %s at \"%s\" - %u files", archiveFileName.c_str(), mount.m_MountPoint.c_str(), pArchive->NumEntries());
+	return true;
+}
+
+/// kbFileSystem::MountArchives
+void kbFileSystem::MountArchives(const std::string& directory) {
+	std::error_code error;
+	if (fs::is_directory(directory, error) == false) {
+		return;
+	}
+
+	std::vector<std::string> archiveFileNames;
+	for (fs::directory_iterator it(directory, error), end; it != end; it.increment(error)) {
+		std::string extension = GetFileExtension(it->path().string());
+		StringToLower(extension);
+		if (it->is_regular_file(error) && extension == "kbarc") {
+			archiveFileNames.push_back(it->path().string());
+		}
+	}
+	std::sort(archiveFileNames.begin(), archiveFileNames.end());
+
+	for (size_t i = 0; i < archiveFileNames.size(); i++) {
+		MountArchive(archiveFileNames[i]);
+	}
+}
+
+/// kbFileSystem::Unmount
+bool kbFileSystem::Unmount(const std::string& mountedName) {
+	const std::string normalizedName = NormalizePath(mountedName);
+
+	std::unique_lock<std::shared_mutex> lock(m_MountLock);
+	for (size_t i = 0; i < m_Directories.size(); i++) {
+		if (NormalizePath(m_Directories[i].m_Directory) == normalizedName || NormalizePath(m_Directories[i].m_Directory) == normalizedName + "/") {
+			m_Directories.erase(m_Directories.begin() + i);
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < m_Archives.size(); i++) {
+		if (NormalizePath(m_Archives[i].m_pArchive->GetFileName()) == normalizedName) {
+			delete m_Archives[i].m_pArchive;
+			m_Archives.erase(m_Archives.begin() + i);
+			return true;
+		}
+	}
+	return false;
+}
+
+/// kbFileSystem::UnmountAll
+void kbFileSystem::UnmountAll() {
+	std::unique_lock<std::shared_mutex> lock(m_MountLock);
+	for (size_t i = 0; i < m_Archives.size(); i++) {
+		delete m_Archives[i].m_pArchive;
+	}
+	m_Archives.clear();
+	m_Directories.clear();
+}
+
+/// kbFileSystem::ReadFile
+bool kbFileSystem::ReadFile(const std::string& fileName, kbFileData& outData) const {
+	outData.Release();
+
+	const std::string path = NormalizePath(fileName);
+	std::shared_lock<std::shared_mutex> lock(m_MountLock);
+
+	for (auto it = m_Directories.rbegin(); it != m_Directories.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath != nullptr && outData.m_MappedFile.Open(it->m_Directory + pRelativePath)) {
+			outData.m_pData = outData.m_MappedFile.GetData();
+			outData.m_Size = outData.m_MappedFile.GetSize();
+			return true;
+		}
+	}
+
+	if (g_VFSLooseFiles.GetBool() && outData.m_MappedFile.Open(fileName)) {
+		outData.m_pData = outData.m_MappedFile.GetData();
+		outData.m_Size = outData.m_MappedFile.GetSize();
+		return true;
+	}
+
+	for (auto it = m_Archives.rbegin(); it != m_Archives.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath == nullptr) {
+			continue;
+		}
+
+		const kbArchiveEntry_t* const pEntry = it->m_pArchive->FindEntry(pRelativePath);
+		if (pEntry != nullptr) {
+			return it->m_pArchive->ReadEntry(*pEntry, outData);
+		}
+	}
+
+	return false;
+}
+
+/// kbFileSystem::FileExists
+bool kbFileSystem::FileExists(const std::string& fileName) const {
+	const std::string path = NormalizePath(fileName);
+	std::shared_lock<std::shared_mutex> lock(m_MountLock);
+
+	std::error_code error;
+	for (auto it = m_Directories.rbegin(); it != m_Directories.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath != nullptr && fs::is_regular_file(it->m_Directory + pRelativePath, error)) {
+			return true;
+		}
+	}
+
+	if (g_VFSLooseFiles.GetBool() && fs::is_regular_file(fileName, error)) {
+		return true;
+	}
+
+	for (auto it = m_Archives.rbegin(); it != m_Archives.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath != nullptr && it->m_pArchive->FindEntry(pRelativePath) != nullptr) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/// GetDiskFileStamp
+static bool GetDiskFileStamp(const std::string& fileName, u64& outSize, u64& outTime) {
+	std::error_code error;
+	if (fs::is_regular_file(fileName, error) == false) {
+		return false;
+	}
+
+	const fs::file_time_type writeTime = fs::last_write_time(fileName, error);
+	if (error) {
+		return false;
+	}
+
+	outSize = (u64)fs::file_size(fileName, error);
+	outTime = (u64)writeTime.time_since_epoch().count();
+	return !error;
+}
+
+/// kbFileSystem::GetFileStamp
+bool kbFileSystem::GetFileStamp(const std::string& fileName, u64& outSize, u64& outTime) const {
+	const std::string path = NormalizePath(fileName);
+	std::shared_lock<std::shared_mutex> lock(m_MountLock);
+
+	for (auto it = m_Directories.rbegin(); it != m_Directories.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath != nullptr && GetDiskFileStamp(it->m_Directory + pRelativePath, outSize, outTime)) {
+			return true;
+		}
+	}
+
+	if (g_VFSLooseFiles.GetBool() && GetDiskFileStamp(fileName, outSize, outTime)) {
+		return true;
+	}
+
+	for (auto it = m_Archives.rbegin(); it != m_Archives.rend(); ++it) {
+		const char* const pRelativePath = GetMountRelativePath(*it, path);
+		if (pRelativePath == nullptr) {
+			continue;
+		}
+
+		const kbArchiveEntry_t* const pEntry = it->m_pArchive->FindEntry(pRelativePath);
+		if (pEntry == nullptr) {
+			continue;
+		}
+
+		// Entries don't record their own write time, so a rebuilt archive invalidates everything cooked from it
+		u64 archiveSize = 0;
+		if (GetDiskFileStamp(it->m_pArchive->GetFileName(), archiveSize, outTime) == false) {
+			return false;
+		}
+		outSize = pEntry->m_Size;
+		return true;
+	}
+
+	return false;
+}
+
+/// kbFileSystem::DumpMounts
+void kbFileSystem::DumpMounts() const {
+	std::shared_lock<std::shared_mutex> lock(m_MountLock);
+
+	blk::log("File system - %u directories, %u archives.  Loose files are %s", (u32)m_Directories.size(), (u32)m_Archives.size(), g_VFSLooseFiles.GetBool() ? "on" : "off");
+	for (size_t i = 0; i < m_Directories.size(); i++) {
+		blk::log("	\"%s\" -> %s", m_Directories[i].m_MountPoint.c_str(), m_Directories[i].m_Directory.c_str());
+	}
+
+	for (size_t i = 0; i < m_Archives.size(); i++) {
+		const kbArchive* const pArchive = m_Archives[i].m_pArchive;
+		blk::log("	\"%s\" -> %s (%u files)", m_Archives[i].m_MountPoint.c_str(), pArchive->GetFileName().c_str(), pArchive->NumEntries());
+	}
+}
@@ -0,0 +1,158 @@
+/// blk_file_system.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+
+/// kbFileData - Read only contents of a file opened through kbFileSystem
+///
+/// Loose files and uncompressed archive entries are views into a mapped file.  Compressed entries are decompressed into a
+/// buffer owned by the kbFileData.  A view into an archive holds a reference to the archive's mapping, so it stays valid
+/// after the archive is unmounted
+class kbFileData {
+	friend class kbArchive;
+	friend class kbFileSystem;
+
+public:
+	kbFileData() : m_pData(nullptr), m_Size(0) { }
+
+	kbFileData(const kbFileData&) = delete;
+	kbFileData& operator=(const kbFileData&) = delete;
+
+	bool IsValid() const { return m_pData != nullptr; }
+	const byte* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+	/// Asks the OS to page the whole view in so later reads don't fault
+	void Prefetch() const;
+
+	void Release();
+	void Swap(kbFileData& other);
+
+private:
+	kbMappedFile m_MappedFile;
+	std::shared_ptr<const kbMappedFile> m_pArchiveFile;
+	std::vector<byte> m_Buffer;
+	const byte* m_pData;
+	size_t m_Size;
+};
+
+/// kbArchiveHeader_t - Offsets are in bytes from the start of the file
+struct kbArchiveHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u32 m_NumEntries;
+	u32 m_Alignment;			// Of each entry's data
+	u64 m_Entries;				// Sorted by m_PathHash
+	u64 m_Names;				// Null terminated
+	u64 m_NamesSize;
+	u32 m_MountPointName;		// Offset into the names
+	u32 m_Pad;
+};
+
+/// kbArchiveEntry_t
+struct kbArchiveEntry_t {
+	enum kbCompression_t {
+		Compression_None,
+		Compression_LZ4,
+	};
+
+	u64 m_PathHash;				// kbHashName() of the path relative to the mount point
+	u64 m_Offset;
+	u64 m_Size;
+	u64 m_StoredSize;
+	u32 m_Name;					// Offset into the names
+	u32 m_Compression;
+};
+
+/// kbArchive
+///
+/// A single .kbArc file holding a directory tree.  Entries are found by hashing their path and binary searching the table of
+/// contents, and each entry's data starts on an m_Alignment boundary so uncompressed entries can be used straight out of
+/// the mapped archive.  Entries are compressed with the LZ4 block format when that saves at least an eighth of their size
+class kbArchive {
+public:
+	static const u32 Magic = 0x52414b42;		// "BKAR"
+	static const u32 Version = 1;
+
+	kbArchive() : m_pHeader(nullptr), m_pEntries(nullptr), m_pNames(nullptr) { }
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+	/// path is relative to the mount point and normalized by kbFileSystem::NormalizePath()
+	const kbArchiveEntry_t* FindEntry(const std::string_view path) const;
+	bool ReadEntry(const kbArchiveEntry_t& entry, kbFileData& outData) const;
+
+	const std::string& GetFileName() const { return m_FileName; }
+	std::string_view GetMountPoint() const { return &m_pNames[m_pHeader->m_MountPointName]; }
+	std::string_view GetEntryName(const kbArchiveEntry_t& entry) const { return &m_pNames[entry.m_Name]; }
+	u32 NumEntries() const { return (m_pHeader != nullptr) ? (m_pHeader->m_NumEntries) : (0); }
+
+	/// Packs every file under sourceDirectory.  The archive mounts its files under mountPoint, so building ./assets/ with a
+	/// mount point of "assets/" lets "./assets/models/foo.ms3d" be read out of it
+	static bool Build(const std::string& archiveFileName, const std::string& sourceDirectory, const std::string& mountPoint, const bool bCompress, const u32 alignment = 4096);
+
+private:
+	std::shared_ptr<kbMappedFile> m_pFile;		// Shared with any kbFileData that views an uncompressed entry
+	std::string m_FileName;
+
+	const kbArchiveHeader_t* m_pHeader;
+	const kbArchiveEntry_t* m_pEntries;
+	const char* m_pNames;
+};
+
+/// kbFileSystem
+///
+/// Every asset read goes through here.  A path is looked up in order in:
+///
+///	- Directories mounted with MountDirectory(), most recent first
+///	- The path itself on disk, unless "vfsloosefiles" is off
+///	- Archives mounted with MountArchive(), most recent first
+///
+/// so loose files overlay whatever is packed in archives.  Paths are matched without regard to case or slash direction.
+/// Reads are safe from any thread, and a kbFileData read out of an archive outlives the archive's mount
+class kbFileSystem {
+public:
+	~kbFileSystem();
+
+	bool MountDirectory(const std::string& mountPoint, const std::string& directory);
+	bool MountArchive(const std::string& archiveFileName);
+
+	/// Mounts every .kbArc in directory in name order, so later archives such as patches override earlier ones
+	void MountArchives(const std::string& directory);
+
+	/// mountedName is the directory or archive file that was mounted.  Returns false if it wasn't
+	bool Unmount(const std::string& mountedName);
+	void UnmountAll();
+
+	bool ReadFile(const std::string& fileName, kbFileData& outData) const;
+	bool FileExists(const std::string& fileName) const;
+
+	/// Size and last write time of the file ReadFile() would read.  Files in an archive have the archive's write time
+	bool GetFileStamp(const std::string& fileName, u64& outSize, u64& outTime) const;
+
+	/// Lower case, forward slashes and no leading "./"
+	static std::string NormalizePath(const std::string_view path);
+
+	void DumpMounts() const;
+
+private:
+	struct kbMount_t {
+		std::string m_MountPoint;		// Normalized, and ends in '/' unless it's the root
+		std::string m_Directory;
+		kbArchive* m_pArchive = nullptr;
+	};
+
+	/// Returns a mount's path for normalizedPath, or nullptr if the mount doesn't cover it
+	static const char* GetMountRelativePath(const kbMount_t& mount, const std::string& normalizedPath);
+
+	std::vector<kbMount_t> m_Directories;
+	std::vector<kbMount_t> m_Archives;
+	mutable std::shared_mutex m_MountLock;
+};
+
+extern kbFileSystem g_FileSystem;
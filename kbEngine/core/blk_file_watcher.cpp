@@ -0,0 +1,331 @@
+/// blk_file_watcher.cpp
+///
+/// 2025 blk 1.0
+
+#include <filesystem>
+#include <thread>
+#include "blk_core.h"
+#include "blk_file_watcher.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/// kbFileWatcher::AddChange
+void kbFileWatcher::AddChange(const std::string& fileName) {
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_PendingChanges[fileName] = kbClock_t::now();
+}
+
+/// kbFileWatcher::AddOverflow
+void kbFileWatcher::AddOverflow(const std::string& directory) {
+	std::lock_guard<std::mutex> lock(m_Lock);
+	if (std::find(m_OverflowedDirectories.begin(), m_OverflowedDirectories.end(), directory) == m_OverflowedDirectories.end()) {
+		m_OverflowedDirectories.push_back(directory);
+	}
+}
+
+/// kbFileWatcher::GetChanges
+void kbFileWatcher::GetChanges(std::vector<std::string>& outChangedFiles, std::vector<std::string>& outOverflowedDirectories, const float debounceMS) {
+	outChangedFiles.clear();
+	outOverflowedDirectories.clear();
+
+	const kbClock_t::time_point settledTime = kbClock_t::now() - std::chrono::microseconds((long long)(debounceMS * 1000.0f));
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	for (auto it = m_PendingChanges.begin(); it != m_PendingChanges.end();) {
+		if (it->second <= settledTime) {
+			outChangedFiles.push_back(it->first);
+			it = m_PendingChanges.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	outOverflowedDirectories.swap(m_OverflowedDirectories);
+}
+
+#if defined(_WIN32)
+
+/// kbFileWatcher::kbWatchState_t - One thread per directory, each waiting on its own overlapped read and the stop event
+struct kbFileWatcher::kbWatchState_t {
+	struct kbWatchedDirectory_t {
+		std::string m_Directory;
+		HANDLE m_hDirectory = INVALID_HANDLE_VALUE;
+		std::thread m_Thread;
+	};
+
+	void WatchThread(kbFileWatcher* const pWatcher, kbWatchedDirectory_t* const pWatchedDirectory);
+
+	std::vector<kbWatchedDirectory_t*> m_WatchedDirectories;
+	HANDLE m_hStopEvent = nullptr;
+};
+
+/// kbFileWatcher::kbFileWatcher
+kbFileWatcher::kbFileWatcher() :
+	m_bStopping(false),
+	m_pState(new kbWatchState_t()) {
+	m_pState->m_hStopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+}
+
+/// kbFileWatcher::~kbFileWatcher
+kbFileWatcher::~kbFileWatcher() {
+	Stop();
+	CloseHandle(m_pState->m_hStopEvent);
+	delete m_pState;
+}
+
+/// kbFileWatcher::Watch
+bool kbFileWatcher::Watch(const std::string& directory) {
+	const HANDLE hDirectory = CreateFileA(directory.c_str(),
+										  FILE_LIST_DIRECTORY,
+										  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+										  nullptr,
+										  OPEN_EXISTING,
+										  FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+										  nullptr);
+	if (hDirectory == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	kbWatchState_t::kbWatchedDirectory_t* const pWatchedDirectory = new kbWatchState_t::kbWatchedDirectory_t();
+	pWatchedDirectory->m_Directory = directory;
+	pWatchedDirectory->m_hDirectory = hDirectory;
+	pWatchedDirectory->m_Thread = std::thread(&kbWatchState_t::WatchThread, m_pState, this, pWatchedDirectory);
+	m_pState->m_WatchedDirectories.push_back(pWatchedDirectory);
+	return true;
+}
+
+/// kbFileWatcher::Stop
+void kbFileWatcher::Stop() {
+	m_bStopping = true;
+	SetEvent(m_pState->m_hStopEvent);
+
+	for (size_t i = 0; i < m_pState->m_WatchedDirectories.size(); i++) {
+		kbWatchState_t::kbWatchedDirectory_t* const pWatchedDirectory = m_pState->m_WatchedDirectories[i];
+		pWatchedDirectory->m_Thread.join();
+		CloseHandle(pWatchedDirectory->m_hDirectory);
+		delete pWatchedDirectory;
+	}
+	m_pState->m_WatchedDirectories.clear();
+
+	// Re-armed so directories can be watched again after stopping
+	m_bStopping = false;
+	ResetEvent(m_pState->m_hStopEvent);
+}
+
+/// kbFileWatcher::kbWatchState_t::WatchThread
+void kbFileWatcher::kbWatchState_t::WatchThread(kbFileWatcher* const pWatcher, kbWatchedDirectory_t* const pWatchedDirectory) {
+	// The old 2 KB buffer overflowed whenever more than a handful of files were saved at once
+	std::vector<DWORD> buffer(64 * 1024 / sizeof(DWORD));
+
+	OVERLAPPED overlapped;
+	ZeroMemory(&overlapped, sizeof(overlapped));
+	overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+	const HANDLE handles[] = { overlapped.hEvent, m_hStopEvent };
+	const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+	while (pWatcher->m_bStopping == false) {
+		ResetEvent(overlapped.hEvent);
+		if (ReadDirectoryChangesW(pWatchedDirectory->m_hDirectory, buffer.data(), (DWORD)(buffer.size() * sizeof(DWORD)), TRUE, filter, nullptr, &overlapped, nullptr) == FALSE) {
+			blk::warn("kbFileWatcher::WatchThread() - Stopped watching %s.  Error %u", pWatchedDirectory->m_Directory.c_str(), GetLastError());
+			break;
+		}
+
+		if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+			DWORD numBytes = 0;
+			CancelIoEx(pWatchedDirectory->m_hDirectory, &overlapped);
+			GetOverlappedResult(pWatchedDirectory->m_hDirectory, &overlapped, &numBytes, TRUE);
+			break;
+		}
+
+		DWORD numBytes = 0;
+		if (GetOverlappedResult(pWatchedDirectory->m_hDirectory, &overlapped, &numBytes, FALSE) == FALSE || numBytes == 0) {
+			// Changes were dropped because the buffer overflowed
+			pWatcher->AddOverflow(pWatchedDirectory->m_Directory);
+			continue;
+		}
+
+		const byte* pByteInfo = (const byte*)buffer.data();
+		while (true) {
+			const FILE_NOTIFY_INFORMATION* const pInfo = (const FILE_NOTIFY_INFORMATION*)pByteInfo;
+			if (pInfo->Action != FILE_ACTION_REMOVED && pInfo->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+				std::string fileName;
+				StringFromWString(fileName, std::wstring(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR)));
+				pWatcher->AddChange(pWatchedDirectory->m_Directory + fileName);
+			}
+
+			if (pInfo->NextEntryOffset == 0) {
+				break;
+			}
+			pByteInfo += pInfo->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+
+#elif defined(__linux__)
+
+/// kbFileWatcher::kbWatchState_t - One inotify instance and thread for every watched directory.  inotify isn't
+/// recursive, so each directory under a watched one gets its own watch
+struct kbFileWatcher::kbWatchState_t {
+	/// pWatcher->m_Lock must be held.  bReportFiles reports the files already in directories that were created after
+	/// their parent was watched, since they can be written before the new directory's watch is added
+	void AddWatches(kbFileWatcher* const pWatcher, const std::string& directory, const std::string& rootDirectory, const bool bReportFiles);
+	void WatchThread(kbFileWatcher* const pWatcher);
+
+	int m_InotifyFD = -1;
+	std::unordered_map<int, std::pair<std::string, std::string>> m_Watches;		// Directory and the root it was found under
+	std::thread m_Thread;
+};
+
+/// kbFileWatcher::kbFileWatcher
+kbFileWatcher::kbFileWatcher() :
+	m_bStopping(false),
+	m_pState(new kbWatchState_t()) {
+}
+
+/// kbFileWatcher::~kbFileWatcher
+kbFileWatcher::~kbFileWatcher() {
+	Stop();
+	delete m_pState;
+}
+
+/// kbFileWatcher::Watch
+bool kbFileWatcher::Watch(const std::string& directory) {
+	std::error_code error;
+	if (fs::is_directory(directory, error) == false) {
+		return false;
+	}
+
+	if (m_pState->m_InotifyFD < 0) {
+		m_pState->m_InotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_pState->m_InotifyFD < 0) {
+			blk::warn("kbFileWatcher::Watch() - Failed to initialize inotify");
+			return false;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_pState->AddWatches(this, directory, directory, false);
+	}
+
+	if (m_pState->m_Thread.joinable() == false) {
+		m_pState->m_Thread = std::thread(&kbWatchState_t::WatchThread, m_pState, this);
+	}
+	return true;
+}
+
+/// kbFileWatcher::Stop
+void kbFileWatcher::Stop() {
+	m_bStopping = true;
+	if (m_pState->m_Thread.joinable()) {
+		m_pState->m_Thread.join();
+	}
+
+	if (m_pState->m_InotifyFD >= 0) {
+		close(m_pState->m_InotifyFD);
+		m_pState->m_InotifyFD = -1;
+	}
+	m_pState->m_Watches.clear();
+
+	// Re-armed so directories can be watched again after stopping
+	m_bStopping = false;
+}
+
+/// kbFileWatcher::kbWatchState_t::AddWatches
+void kbFileWatcher::kbWatchState_t::AddWatches(kbFileWatcher* const pWatcher, const std::string& directory, const std::string& rootDirectory, const bool bReportFiles) {
+	const u32 mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+	const int watch = inotify_add_watch(m_InotifyFD, directory.c_str(), mask);
+	if (watch < 0) {
+		return;
+	}
+	m_Watches[watch] = std::make_pair(directory, rootDirectory);
+
+	std::error_code error;
+	for (fs::directory_iterator it(directory, error), end; it != end; it.increment(error)) {
+		std::string path = directory;
+		if (path.back() != '/') {
+			path += '/';
+		}
+		path += it->path().filename().string();
+
+		if (it->is_directory(error)) {
+			AddWatches(pWatcher, path, rootDirectory, bReportFiles);
+		} else if (bReportFiles) {
+			pWatcher->m_PendingChanges[path] = kbClock_t::now();
+		}
+	}
+}
+
+/// kbFileWatcher::kbWatchState_t::WatchThread
+void kbFileWatcher::kbWatchState_t::WatchThread(kbFileWatcher* const pWatcher) {
+	alignas(inotify_event) char buffer[64 * 1024];
+
+	while (pWatcher->m_bStopping == false) {
+		// Polled with a timeout so Stop() doesn't need a second fd to wake this up
+		pollfd pollFD = { m_InotifyFD, POLLIN, 0 };
+		if (poll(&pollFD, 1, 100) <= 0) {
+			continue;
+		}
+
+		const ssize_t numBytes = read(m_InotifyFD, buffer, sizeof(buffer));
+		if (numBytes <= 0) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(pWatcher->m_Lock);
+		for (const char* pEventBytes = buffer; pEventBytes < buffer + numBytes;) {
+			const inotify_event* const pEvent = (const inotify_event*)pEventBytes;
+			pEventBytes += sizeof(inotify_event) + pEvent->len;
+
+			if ((pEvent->mask & IN_Q_OVERFLOW) != 0) {
+				for (auto it = m_Watches.begin(); it != m_Watches.end(); ++it) {
+					std::vector<std::string>& overflowed = pWatcher->m_OverflowedDirectories;
+					if (std::find(overflowed.begin(), overflowed.end(), it->second.second) == overflowed.end()) {
+						overflowed.push_back(it->second.second);
+					}
+				}
+				continue;
+			}
+
+			auto watchIt = m_Watches.find(pEvent->wd);
+			if (watchIt == m_Watches.end()) {
+				continue;
+			}
+
+			if ((pEvent->mask & IN_IGNORED) != 0) {
+				m_Watches.erase(watchIt);
+				continue;
+			}
+
+			if (pEvent->len == 0) {
+				continue;
+			}
+
+			std::string path = watchIt->second.first;
+			if (path.back() != '/') {
+				path += '/';
+			}
+			path += pEvent->name;
+
+			if ((pEvent->mask & IN_ISDIR) != 0) {
+				if ((pEvent->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+					const std::string rootDirectory = watchIt->second.second;
+					AddWatches(pWatcher, path, rootDirectory, true);
+				}
+			} else if ((pEvent->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+				// IN_CREATE is skipped for files as IN_CLOSE_WRITE follows once they're written
+				pWatcher->m_PendingChanges[path] = kbClock_t::now();
+			}
+		}
+	}
+}
+
+#endif
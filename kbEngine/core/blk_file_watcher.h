@@ -0,0 +1,48 @@
+/// blk_file_watcher.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// kbFileWatcher
+///
+/// Watches directory trees on background threads, using ReadDirectoryChangesW on Windows and inotify on Linux.  Events are
+/// coalesced per file, and a file is only handed out once it has had no events for the debounce time, so a save that
+/// writes, renames and touches a file reports it once.  If the OS drops events because its queue overflowed, the watched
+/// directory is reported instead so the caller can rescan it
+class kbFileWatcher {
+public:
+	kbFileWatcher();
+	~kbFileWatcher();
+
+	kbFileWatcher(const kbFileWatcher&) = delete;
+	kbFileWatcher& operator=(const kbFileWatcher&) = delete;
+
+	/// Reported files are directory joined with their path under it
+	bool Watch(const std::string& directory);
+	void Stop();
+
+	void GetChanges(std::vector<std::string>& outChangedFiles, std::vector<std::string>& outOverflowedDirectories, const float debounceMS);
+
+private:
+	typedef std::chrono::steady_clock kbClock_t;
+
+	void AddChange(const std::string& fileName);
+	void AddOverflow(const std::string& directory);
+
+	std::mutex m_Lock;
+	std::unordered_map<std::string, kbClock_t::time_point> m_PendingChanges;
+	std::vector<std::string> m_OverflowedDirectories;
+	std::atomic<bool> m_bStopping;
+
+	/// The platform's watch handles and threads.  Defined in blk_file_watcher.cpp
+	struct kbWatchState_t;
+	kbWatchState_t* m_pState;
+};
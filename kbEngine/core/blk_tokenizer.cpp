@@ -0,0 +1,233 @@
+/// blk_tokenizer.cpp
+///
+/// 2025 blk 1.0
+
+#include <charconv>
+#include <cstdarg>
+#include "blk_core.h"
+#include "blk_tokenizer.h"
+
+/// kbTextTokenizer::Reset
+void kbTextTokenizer::Reset(const char* const pText, const size_t length, const std::string& sourceName) {
+	m_pText = pText;
+	m_Length = (pText != nullptr) ? length : 0;
+	m_Pos = 0;
+	m_LineStart = 0;
+	m_Line = 1;
+	m_NumErrors = 0;
+	m_SourceName = sourceName;
+}
+
+/// kbTextTokenizer::SkipWhitespace
+void kbTextTokenizer::SkipWhitespace() {
+	while (m_Pos < m_Length && (u8)m_pText[m_Pos] <= ' ') {
+		if (m_pText[m_Pos] == '\n') {
+			m_Line++;
+			m_LineStart = m_Pos + 1;
+		}
+		m_Pos++;
+	}
+}
+
+/// kbTextTokenizer::Next
+bool kbTextTokenizer::Next(kbTextToken_t& outToken) {
+	SkipWhitespace();
+
+	outToken.m_Line = m_Line;
+	outToken.m_Column = (u32)(m_Pos - m_LineStart) + 1;
+
+	if (m_Pos >= m_Length) {
+		outToken.m_Type = kbTextToken_t::TT_EndOfText;
+		outToken.m_Text = std::string_view();
+		return false;
+	}
+
+	const size_t start = m_Pos;
+	switch (m_pText[start]) {
+		case '{': outToken.m_Type = kbTextToken_t::TT_OpenBrace; m_Pos++; break;
+		case '}': outToken.m_Type = kbTextToken_t::TT_CloseBrace; m_Pos++; break;
+		case '=': outToken.m_Type = kbTextToken_t::TT_Equals; m_Pos++; break;
+
+		case '"': {
+			outToken.m_Type = kbTextToken_t::TT_String;
+			m_Pos++;
+			while (m_Pos < m_Length && m_pText[m_Pos] != '"') {
+				if (m_pText[m_Pos] == '\n') {
+					m_Line++;
+					m_LineStart = m_Pos + 1;
+				}
+				m_Pos++;
+			}
+
+			outToken.m_Text = std::string_view(m_pText + start + 1, m_Pos - start - 1);
+			if (m_Pos >= m_Length) {
+				Error(outToken, "Unterminated string");
+			} else {
+				m_Pos++;
+			}
+			return true;
+		}
+
+		default: {
+			outToken.m_Type = kbTextToken_t::TT_Word;
+			while (m_Pos < m_Length) {
+				const char c = m_pText[m_Pos];
+				if ((u8)c <= ' ' || c == '{' || c == '}' || c == '=') {
+					break;
+				}
+				m_Pos++;
+			}
+			break;
+		}
+	}
+
+	outToken.m_Text = std::string_view(m_pText + start, m_Pos - start);
+	return true;
+}
+
+/// kbTextTokenizer::Peek
+bool kbTextTokenizer::Peek(kbTextToken_t& outToken) {
+	const size_t pos = m_Pos;
+	const size_t lineStart = m_LineStart;
+	const u32 line = m_Line;
+
+	const bool bFound = Next(outToken);
+
+	m_Pos = pos;
+	m_LineStart = lineStart;
+	m_Line = line;
+	return bFound;
+}
+
+/// kbTextTokenizer::NextSkippingBraces
+bool kbTextTokenizer::NextSkippingBraces(kbTextToken_t& outToken) {
+	while (Next(outToken)) {
+		if (outToken.m_Type != kbTextToken_t::TT_OpenBrace && outToken.m_Type != kbTextToken_t::TT_CloseBrace) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// kbTextTokenizer::Expect
+bool kbTextTokenizer::Expect(const kbTextToken_t::Type_t type, kbTextToken_t& outToken) {
+	static const char* const typeNames[] = { "end of file", "a word", "a string", "'{'", "'}'", "'='" };
+
+	Next(outToken);
+	if (outToken.m_Type == type || (type == kbTextToken_t::TT_Word && outToken.m_Type == kbTextToken_t::TT_String)) {
+		return true;
+	}
+
+	Error(outToken, "Expected %s but found %s '%.*s'", typeNames[type], typeNames[outToken.m_Type], (int)outToken.m_Text.size(), outToken.m_Text.data());
+	return false;
+}
+
+/// kbTextTokenizer::ReadWord
+bool kbTextTokenizer::ReadWord(std::string_view& outWord) {
+	kbTextToken_t token;
+	if (Expect(kbTextToken_t::TT_Word, token) == false) {
+		return false;
+	}
+
+	outWord = token.m_Text;
+	return true;
+}
+
+/// kbTextTokenizer::ReadInt
+bool kbTextTokenizer::ReadInt(i32& outValue) {
+	kbTextToken_t token;
+	if (Expect(kbTextToken_t::TT_Word, token) == false) {
+		return false;
+	}
+
+	const char* const pEnd = token.m_Text.data() + token.m_Text.size();
+	const std::from_chars_result result = std::from_chars(token.m_Text.data(), pEnd, outValue);
+	if (result.ec != std::errc() || result.ptr != pEnd) {
+		Error(token, "Expected an integer but found '%.*s'", (int)token.m_Text.size(), token.m_Text.data());
+		return false;
+	}
+	return true;
+}
+
+/// kbTextTokenizer::ReadUInt
+bool kbTextTokenizer::ReadUInt(u32& outValue) {
+	kbTextToken_t token;
+	if (Expect(kbTextToken_t::TT_Word, token) == false) {
+		return false;
+	}
+
+	const char* const pEnd = token.m_Text.data() + token.m_Text.size();
+	const std::from_chars_result result = std::from_chars(token.m_Text.data(), pEnd, outValue);
+	if (result.ec != std::errc() || result.ptr != pEnd) {
+		Error(token, "Expected an unsigned integer but found '%.*s'", (int)token.m_Text.size(), token.m_Text.data());
+		return false;
+	}
+	return true;
+}
+
+/// kbTextTokenizer::ReadFloat
+bool kbTextTokenizer::ReadFloat(f32& outValue) {
+	kbTextToken_t token;
+	if (Expect(kbTextToken_t::TT_Word, token) == false) {
+		return false;
+	}
+
+	// from_chars doesn't take a leading '+'
+	const char* pStart = token.m_Text.data();
+	const char* const pEnd = pStart + token.m_Text.size();
+	if (pStart < pEnd && *pStart == '+') {
+		pStart++;
+	}
+
+	const std::from_chars_result result = std::from_chars(pStart, pEnd, outValue);
+	if (result.ec != std::errc() || result.ptr != pEnd) {
+		Error(token, "Expected a number but found '%.*s'", (int)token.m_Text.size(), token.m_Text.data());
+		return false;
+	}
+	return true;
+}
+
+/// kbTextTokenizer::SkipLine
+void kbTextTokenizer::SkipLine() {
+	while (m_Pos < m_Length && m_pText[m_Pos] != '\n') {
+		m_Pos++;
+	}
+
+	if (m_Pos < m_Length) {
+		m_Pos++;
+		m_Line++;
+		m_LineStart = m_Pos;
+	}
+}
+
+/// kbTextTokenizer::SkipBlock
+bool kbTextTokenizer::SkipBlock() {
+	int depth = 1;
+	kbTextToken_t token;
+	while (Next(token)) {
+		if (token.m_Type == kbTextToken_t::TT_OpenBrace) {
+			depth++;
+		} else if (token.m_Type == kbTextToken_t::TT_CloseBrace) {
+			depth--;
+			if (depth == 0) {
+				return true;
+			}
+		}
+	}
+
+	Error(token, "Unexpected end of file inside a block");
+	return false;
+}
+
+/// kbTextTokenizer::Error
+void kbTextTokenizer::Error(const kbTextToken_t& token, const char* const format, ...) {
+	char message[512];
+
+	va_list arguments;
+	va_start(arguments, format);
+	vsnprintf(message, sizeof(message), format, arguments);
+	va_end(arguments);
+
+	blk::warn("%s(%u,%u): %s", m_SourceName.c_str(), token.m_Line, token.m_Column, message);
+	m_NumErrors++;
+}
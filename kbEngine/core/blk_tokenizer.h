@@ -0,0 +1,77 @@
+/// blk_tokenizer.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/// kbTextToken_t - m_Text points into the tokenizer's text.  Quoted strings don't include their quotes
+struct kbTextToken_t {
+	enum Type_t {
+		TT_EndOfText,
+		TT_Word,
+		TT_String,
+		TT_OpenBrace,
+		TT_CloseBrace,
+		TT_Equals,
+	};
+
+	kbTextToken_t() : m_Type(TT_EndOfText), m_Line(0), m_Column(0) { }
+
+	bool IsWord() const { return m_Type == TT_Word || m_Type == TT_String; }
+
+	Type_t m_Type;
+	std::string_view m_Text;
+	u32 m_Line;
+	u32 m_Column;
+};
+
+/// kbTextTokenizer
+///
+/// Splits text into words, quoted strings, braces and equals signs in a single pass without copying or allocating.
+/// Words run until whitespace, a brace or an equals sign.  Line and column are tracked as the text is scanned so that
+/// errors can be reported as file(line,column), and numbers are parsed in place with from_chars
+class kbTextTokenizer {
+public:
+	kbTextTokenizer() { Reset(nullptr, 0, ""); }
+
+	/// The text must outlive the tokenizer and any tokens taken from it
+	void Reset(const char* const pText, const size_t length, const std::string& sourceName);
+
+	/// Returns false with a TT_EndOfText token once the text runs out
+	bool Next(kbTextToken_t& outToken);
+	bool Peek(kbTextToken_t& outToken);
+
+	/// Like Next() but steps over braces
+	bool NextSkippingBraces(kbTextToken_t& outToken);
+
+	/// Reads the next token and reports an error if it isn't the expected type
+	bool Expect(const kbTextToken_t::Type_t type, kbTextToken_t& outToken);
+	bool ReadWord(std::string_view& outWord);
+
+	bool ReadInt(i32& outValue);
+	bool ReadUInt(u32& outValue);
+	bool ReadFloat(f32& outValue);
+
+	/// Skips to the start of the next line
+	void SkipLine();
+
+	/// Skips to just past the '}' that closes an already read '{'
+	bool SkipBlock();
+
+	void Error(const kbTextToken_t& token, const char* const format, ...);
+	u32 NumErrors() const { return m_NumErrors; }
+
+private:
+	void SkipWhitespace();
+
+	const char* m_pText;
+	size_t m_Length;
+	size_t m_Pos;
+	size_t m_LineStart;
+	u32 m_Line;
+	u32 m_NumErrors;
+	std::string m_SourceName;
+};
@@ -609,11 +609,17 @@ void kbEditor::Update() {
 	for (int i = 0; i < m_GameEntities.size(); i++) {
 		m_GameEntities[i]->Update(DT);
 	}
+	SkeletalModelComponent::EvaluatePendingPoses();
+	kbClothComponent::SimulatePendingCloth();
 
 	if (m_pGame != nullptr && m_bGameUpdating) {
 		m_pGame->HackEditorUpdate(DT, m_pMainTab->GetEditorWindowCamera());
 	}
 
+	// UI callbacks can edit particle components before the next render sync, so don't leave the jobs running
+	g_pGame->GetParticleManager().KickParticleJobs();
+	g_pGame->GetParticleManager().WaitForParticleJobs();
+
 	// Update title bar dirty status
 	if (m_UndoIDAtLastSave != m_UndoStack.GetLastDirtyActionId()) {
 		SetWindowText(fl_xid(this), ("blk 1.0 - " + m_CurrentLevelFileName + "*").c_str());
@@ -10,6 +10,7 @@
 #include "kbPropertiesTab.h"
 #include "FL/FL_Scroll.h"
 #include "kbResourceTab.h"
+#include "kbTypeInfoSerializer.h"
 
 #pragma warning(push)
 #pragma warning(disable:4312)
@@ -169,8 +170,20 @@ void kbPropertiesTab::CheckButtonCB(Fl_Widget* widget, void* voidPtr) {
 	*/
 	const char buttonVal = pCheckButton->value();
 
+	// Snapshot the owning component so undo still works on elements of struct arrays
+	kbComponent* const pUndoComponent = (userData->m_pParentComponent != nullptr) ? (userData->m_pParentComponent) : (userData->m_pComponent);
+	std::vector<byte> snapshotBeforeChange;
+	kbTypeInfoSerializer::Serialize(pUndoComponent, snapshotBeforeChange);
+
 	*((bool*)userData->m_pVariablePtr) = (bool)buttonVal;
 
+	kbUndoComponentAction* const pUndoAction = new kbUndoComponentAction(pUndoComponent, snapshotBeforeChange);
+	if (pUndoAction->HasChanges()) {
+		g_Editor->PushUndoAction(pUndoAction);
+	} else {
+		delete pUndoAction;
+	}
+
 	userData->m_pComponent->editor_change(userData->m_VariableName.stl_str());
 
 
@@ -326,49 +339,37 @@ void kbPropertiesTab::TextFieldCB(Fl_Widget* widget, void* voidPtr) {
 		}
 	}
 
-	void* prevValuePtr = nullptr;
-	void* curValuePtr = nullptr;
+	// Snapshot the owning component so undo still works on elements of struct arrays
+	kbComponent* const pUndoComponent = (userData->m_pParentComponent != nullptr) ? (userData->m_pParentComponent) : (userData->m_pComponent);
+	std::vector<byte> snapshotBeforeChange;
+	kbTypeInfoSerializer::Serialize(pUndoComponent, snapshotBeforeChange);
 
 	const std::string currentValue = inputValue;
-	inputField->undo();
-	const std::string prevValue = inputValue;
-	inputField->value(currentValue.c_str());
 
 	const float divisor = (isByte) ? (255.0f) : (1.0f);
 	if (userData->m_VariableType == KBTYPEINFO_VECTOR4 || userData->m_VariableType == KBTYPEINFO_VECTOR) {
 		float& componentVar = *(float*)userData->m_pVariablePtr;
-
-		// [TODO][HACK] - Ehm...Are these news cleared up somewhere?
-		prevValuePtr = new float((float)atof(prevValue.c_str()));
-		curValuePtr = new float((float)atof(currentValue.c_str()) / divisor);
-
-		componentVar = *(float*)curValuePtr;
-
+		componentVar = (float)atof(currentValue.c_str()) / divisor;
 	}
 	else if (userData->m_VariableType == KBTYPEINFO_INT) {
 		int& componentVar = *(int*)userData->m_pVariablePtr;
-		prevValuePtr = new int(atoi(prevValue.c_str()));
-		curValuePtr = new int(atoi(currentValue.c_str()));
-
 		componentVar = (int)atoi(inputField->value());
 	}
 	else if (userData->m_VariableType == KBTYPEINFO_FLOAT) {
 		float& componentVar = *(float*)userData->m_pVariablePtr;
-		prevValuePtr = new float((float)atof(prevValue.c_str()));
-		curValuePtr = new float((float)atof(currentValue.c_str()) / divisor);
-
-		componentVar = *(float*)curValuePtr;
-
+		componentVar = (float)atof(currentValue.c_str()) / divisor;
 	}
 	else if (userData->m_VariableType == KBTYPEINFO_KBSTRING) {
 		kbString& curString = *(kbString*)userData->m_pVariablePtr;
 		curString = inputField->value();
-
-		prevValuePtr = new kbString(prevValue.c_str());
-		curValuePtr = new kbString(currentValue.c_str());
 	}
 
-	g_Editor->PushUndoAction(new kbUndoVariableAction(userData->m_VariableType, prevValuePtr, curValuePtr, userData->m_pVariablePtr));
+	kbUndoComponentAction* const pUndoAction = new kbUndoComponentAction(pUndoComponent, snapshotBeforeChange);
+	if (pUndoAction->HasChanges()) {
+		g_Editor->PushUndoAction(pUndoAction);
+	} else {
+		delete pUndoAction;
+	}
 
 	kbComponent* const pModifiedComponent = userData->m_pComponent;
 	kbGameEntity* const pGameEntity = (kbGameEntity*)(pModifiedComponent->IsA(kbGameComponent::GetType()) ? (pModifiedComponent->GetOwner()) : (nullptr));
@@ -394,9 +395,6 @@ void kbPropertiesTab::TextFieldCB(Fl_Widget* widget, void* voidPtr) {
 		userData->m_pParentComponent->editor_change(userData->m_VariableName.stl_str());
 	}
 
-	delete prevValuePtr;
-	delete curValuePtr;
-
 	PropertyChangedCB(userData->m_GameEntityPtr);
 }
 
@@ -554,17 +552,17 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 	}
 
 	std::sort(membersList.begin(), membersList.end(), [](kbTypeInfoHierarchyIterator::iteratorType a, kbTypeInfoHierarchyIterator::iteratorType b) {
-		return a->second.Offset() < b->second.Offset();
+		return a->Offset() < b->Offset();
 	});
 
 	// Iterate over the component's properties and display them
 	for (size_t j = 0; j < membersList.size(); j++) {
 
 		auto pNextField = membersList[j];
-		const char* const varName = pNextField->first.c_str();
+		const char* const varName = pNextField->GetName().c_str();
 
 		if (bIsStruct) {
-			if (pNextField->first == "Enabled") {
+			if (pNextField->GetName() == "Enabled") {
 				curY -= 2 * LineSpacing();
 				continue;
 			}
@@ -573,11 +571,11 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 		propertyNameLabel->labelsize(FontSize());
 		propertyNameLabel->align(FL_ALIGN_RIGHT);
 
-		const byte* const byteOffsetToVar = componentBytePtr + pNextField->second.Offset();
+		const byte* const byteOffsetToVar = componentBytePtr + pNextField->Offset();
 
-		if (pNextField->second.IsArray()) {
+		if (pNextField->IsArray()) {
 
-			varMetaData_t* const propertyMetaData = pEntity->GetPropertyMetaData(pComponent, pNextField->second.Offset());
+			varMetaData_t* const propertyMetaData = pEntity->GetPropertyMetaData(pComponent, pNextField->Offset());
 			if (propertyMetaData == nullptr) {
 				continue;
 			}
@@ -604,12 +602,12 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 			pArraySizeInput->labelsize(FontSize());
 			curY += LineSpacing();
 
-			propertiesTabCBData_t cbData(pEntity, nullptr, pComponent, pParentComponent, nullptr, pNextField->first, (void*)byteOffsetToVar, pNextField->second.Type(), pNextField->second.GetStructName(), nullptr, -1);
+			propertiesTabCBData_t cbData(pEntity, nullptr, pComponent, pParentComponent, nullptr, pNextField->GetName(), (void*)byteOffsetToVar, pNextField->Type(), pNextField->GetStructName(), nullptr, -1);
 			m_CallBackData.push_back(cbData);
 
 			pArraySizeInput->callback(&ArrayResizeCB, static_cast<void*>(&m_CallBackData[m_CallBackData.size() - 1]));
 
-			switch (pNextField->second.Type()) {
+			switch (pNextField->Type()) {
 
 			case KBTYPEINFO_SHADER:
 			{
@@ -621,7 +619,7 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 
 				if (propertyMetaData && propertyMetaData->bExpanded) {
 					for (int i = 0; i < shaderList->size(); i++) {
-						RefreshProperty(pEntity, pNextField->first, pNextField->second.Type(), pNextField->second.GetStructName(), pComponent, (byte*)&(*shaderList)[i], pParentComponent, startX, curY, inputHeight);
+						RefreshProperty(pEntity, pNextField->GetName(), pNextField->Type(), pNextField->GetStructName(), pComponent, (byte*)&(*shaderList)[i], pParentComponent, startX, curY, inputHeight);
 						curY += LineSpacing();
 					}
 				}
@@ -638,14 +636,14 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 
 				if (propertyMetaData && propertyMetaData->bExpanded) {
 					for (int i = 0; i < textureList->size(); i++) {
-						RefreshProperty(pEntity, pNextField->first, pNextField->second.Type(), pNextField->second.GetStructName(), pComponent, (byte*)&(*textureList)[i], pParentComponent, startX, curY, inputHeight);
+						RefreshProperty(pEntity, pNextField->GetName(), pNextField->Type(), pNextField->GetStructName(), pComponent, (byte*)&(*textureList)[i], pParentComponent, startX, curY, inputHeight);
 						curY += LineSpacing();
 					}
 				}
 				break;
 			}
 			default:
-				const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(byteOffsetToVar, pNextField->second.GetStructName());
+				const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(byteOffsetToVar, pNextField->GetStructNameHash());
 				pArraySizeInput->value(std::to_string(vectorSize).c_str());
 
 				static std::vector<std::string> indexText;
@@ -664,9 +662,9 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 
 					for (int i = 0; i < vectorSize; i++) {
 						Fl_Text_Display* propertyNameLabel = new Fl_Text_Display(startX + 24, curY + LineSpacing(), 0, inputHeight, indexText[i].c_str());
-						byte* curComponentByte = (byte*)g_NameToTypeInfoMap->GetVectorElement(byteOffsetToVar, pNextField->second.GetStructName(), i);
+						byte* curComponentByte = (byte*)g_NameToTypeInfoMap->GetVectorElement(byteOffsetToVar, pNextField->GetStructNameHash(), i);
 						startX += kbEditor::PanelBorderSize(5);
-						RefreshProperty(pEntity, pNextField->first, pNextField->second.Type(), pNextField->second.GetStructName(), pComponent, curComponentByte, pParentComponent, startX, curY, inputHeight, byteOffsetToVar, i);
+						RefreshProperty(pEntity, pNextField->GetName(), pNextField->Type(), pNextField->GetStructName(), pComponent, curComponentByte, pParentComponent, startX, curY, inputHeight, byteOffsetToVar, i);
 						curY += LineSpacing();
 						startX -= kbEditor::PanelBorderSize(5);
 					}
@@ -675,7 +673,7 @@ void kbPropertiesTab::RefreshComponent(kbEditorEntity* const pEntity, kbComponen
 			}
 		}
 		else {
-			RefreshProperty(pEntity, pNextField->first, pNextField->second.Type(), pNextField->second.GetStructName(), pComponent, byteOffsetToVar, pParentComponent, startX, curY, inputHeight);
+			RefreshProperty(pEntity, pNextField->GetName(), pNextField->Type(), pNextField->GetStructName(), pComponent, byteOffsetToVar, pParentComponent, startX, curY, inputHeight);
 			curY += LineSpacing();
 		}
 	}
@@ -7,6 +7,8 @@
 #include "kbEditor.h"
 #include "kbEditorEntity.h"
 #include "kbUndoAction.h"
+#include "kbPropertiesTab.h"
+#include "kbTypeInfoSerializer.h"
 
 #pragma warning(push)
 #pragma warning(disable:4312)
@@ -182,145 +184,49 @@ void kbUndoStack::DumpStack() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
-//	kbUndoVariableAction
+//	kbUndoComponentAction
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-kbUndoVariableAction::kbUndoVariableAction(kbTypeInfoType_t type, void* bytePtrToUndoVar, void* bytePtrToRedoVar, void* pVariable) {
+/// kbUndoComponentAction::kbUndoComponentAction
+kbUndoComponentAction::kbUndoComponentAction(kbComponent* const pComponent, const std::vector<byte>& snapshotBeforeChange) :
+	m_pComponent(pComponent) {
 
-	m_pVariable = pVariable;
-	m_VarType = type;
-
-	switch (type) {
-	case KBTYPEINFO_BOOL:
-	{
-		m_UndoBoolean = *(bool*)(bytePtrToUndoVar);
-		m_RedoBoolean = *(bool*)(bytePtrToRedoVar);
-		break;
-	}
-
-	case KBTYPEINFO_INT:
-	case KBTYPEINFO_ENUM:
-	{
-		m_UndoInt = *(const int*)(bytePtrToUndoVar);
-		m_RedoInt = *(const int*)(bytePtrToRedoVar);
-		break;
-	}
-
-	case KBTYPEINFO_VECTOR4:
-	case KBTYPEINFO_VECTOR:
-	case KBTYPEINFO_FLOAT:
-	{
-		m_UndoFloat = *(float*)(bytePtrToUndoVar);
-		m_RedoFloat = *(float*)(bytePtrToRedoVar);
-		break;
-	}
-
-	case KBTYPEINFO_KBSTRING:
-	{
-		m_UndoString = *(kbString*)(bytePtrToUndoVar);
-		m_RedoString = *(kbString*)(bytePtrToRedoVar);
-		break;
-	}
-
-	case KBTYPEINFO_PTR:
-	case KBTYPEINFO_STATICMODEL:
-	case KBTYPEINFO_SHADER:
-	case KBTYPEINFO_ANIMATION:
-	{
-		m_pUndoPtr = (void*)(bytePtrToUndoVar);
-		m_pRedoPtr = (void*)(bytePtrToRedoVar);
-		break;
-	}
-	}
+	std::vector<byte> snapshotAfterChange;
+	kbTypeInfoSerializer::Serialize(pComponent, snapshotAfterChange);
+	kbTypeInfoSerializer::Diff(snapshotBeforeChange, snapshotAfterChange, m_RedoDelta, &m_UndoDelta);
 }
 
-/// kbUndoVariableAction::UndoAction
-void kbUndoVariableAction::UndoAction() {
-
-	switch (m_VarType) {
-	case KBTYPEINFO_BOOL:
-	{
-
-		break;
-	}
-
-	case KBTYPEINFO_INT:
-	case KBTYPEINFO_ENUM:
-	{
-
-		break;
-	}
-
-	case KBTYPEINFO_VECTOR4:
-	case KBTYPEINFO_VECTOR:
-	case KBTYPEINFO_FLOAT:
-	{
-		float& floatVar = *(float*)m_pVariable;
-		floatVar = m_UndoFloat;
-		break;
-	}
-
-	case KBTYPEINFO_KBSTRING:
-	{
-		kbString& stringVar = *(kbString*)m_pVariable;
-		stringVar = m_UndoString;
-		break;
-	}
-
-	case KBTYPEINFO_PTR:
-	case KBTYPEINFO_STATICMODEL:
-	case KBTYPEINFO_SHADER:
-	case KBTYPEINFO_ANIMATION:
-	{
-
-		break;
-	}
-	}
+/// kbUndoComponentAction::UndoAction
+void kbUndoComponentAction::UndoAction() {
+	ApplyDelta(m_UndoDelta);
 }
 
+/// kbUndoComponentAction::RedoAction
+void kbUndoComponentAction::RedoAction() {
+	ApplyDelta(m_RedoDelta);
+}
 
-/// kbUndoVariableAction::RedoAction
-void kbUndoVariableAction::RedoAction() {
-	switch (m_VarType) {
-	case KBTYPEINFO_BOOL:
-	{
-
-		break;
-	}
-
-	case KBTYPEINFO_INT:
-	case KBTYPEINFO_ENUM:
-	{
-
-		break;
-	}
-
-	case KBTYPEINFO_VECTOR4:
-	case KBTYPEINFO_VECTOR:
-	case KBTYPEINFO_FLOAT:
-	{
-		float& floatVar = *(float*)m_pVariable;
-		floatVar = m_RedoFloat;
-		break;
-	}
-
-	case KBTYPEINFO_KBSTRING:
-	{
-		kbString& stringVar = *(kbString*)m_pVariable;
-		stringVar = m_RedoString;
-		break;
+/// kbUndoComponentAction::ApplyDelta
+void kbUndoComponentAction::ApplyDelta(const std::vector<byte>& delta) {
+	kbTypeInfoSerializer::Apply(delta, m_pComponent);
+
+	// Refresh all components if the transform component was modified
+	kbGameEntity* const pGameEntity = (kbGameEntity*)(m_pComponent->IsA(kbGameComponent::GetType()) ? (m_pComponent->GetOwner()) : (nullptr));
+	if (pGameEntity != nullptr && pGameEntity->GetComponent(0) == m_pComponent) {
+		for (int i = 0; i < pGameEntity->NumComponents(); i++) {
+			kbComponent* const pCurComp = pGameEntity->GetComponent(i);
+			if (pCurComp->IsEnabled()) {
+				pCurComp->Enable(false);
+				pCurComp->Enable(true);
+			}
+		}
+	} else if (m_pComponent->IsEnabled()) {
+		m_pComponent->Enable(false);
+		m_pComponent->Enable(true);
 	}
 
-	case KBTYPEINFO_PTR:
-	case KBTYPEINFO_STATICMODEL:
-	case KBTYPEINFO_SHADER:
-	case KBTYPEINFO_ANIMATION:
-	{
-
-		break;
-	}
-	}
+	g_pPropertiesTab->RequestRefreshNextUpdate();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
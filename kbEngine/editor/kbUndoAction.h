@@ -48,30 +48,24 @@ public:
 	bool m_bHasBeenRedone;
 };
 
-/// kbUndoVariableAction
-class kbUndoVariableAction : public kbUndoAction {
+/// kbUndoComponentAction - Holds kbTypeInfoSerializer deltas that take a component's changed fields back and forth
+class kbUndoComponentAction : public kbUndoAction {
 public:
-	kbUndoVariableAction(kbTypeInfoType_t type, void* bytePtrToUndoValue, void* bytePtrToRedoValue, void* pVariable);
+	/// snapshotBeforeChange is a kbTypeInfoSerializer::Serialize() of pComponent from before it was changed
+	kbUndoComponentAction(kbComponent* const pComponent, const std::vector<byte>& snapshotBeforeChange);
 
 	virtual void UndoAction() override;
 	virtual void RedoAction() override;
 	virtual bool MarksMapAsDirty() const override { return true; }
 
+	bool HasChanges() const { return m_RedoDelta.empty() == false; }
+
 private:
-	void* m_pVariable;
-	kbTypeInfoType_t				m_VarType;
-
-	bool							m_UndoBoolean;
-	int								m_UndoInt;
-	float							m_UndoFloat;
-	void* m_pUndoPtr;
-	kbString						m_UndoString;
-
-	bool							m_RedoBoolean;
-	int								m_RedoInt;
-	float							m_RedoFloat;
-	void* m_pRedoPtr;
-	kbString						m_RedoString;
+	void ApplyDelta(const std::vector<byte>& delta);
+
+	kbComponent* m_pComponent;
+	std::vector<byte> m_UndoDelta;
+	std::vector<byte> m_RedoDelta;
 };
 
 /// kbUndoDeleteComponent
@@ -0,0 +1,946 @@
+/// kbBinaryPackage.cpp
+///
+/// 2025 blk 1.0
+
+#include <fstream>
+#include <unordered_map>
+#include "blk_core.h"
+#include "kbGameEntityHeader.h"
+#include "kbFile.h"
+#include "kbBinaryPackage.h"
+
+static const u32 InvalidStringIdx = 0xffffffff;
+
+/// kbBinaryPackageWriter - Flattens a package into a string table, a schema and a u32 stream
+class kbBinaryPackageWriter {
+public:
+	void WritePackage(const kbPackage& package);
+	bool Save(const std::string& fileName) const;
+
+private:
+	u32 AddString(const std::string& string);
+	u32 AddClass(const kbComponent* const pComponent);
+
+	void WriteEntity(const kbGameEntity* const pEntity);
+	void WriteComponent(const kbComponent* const pComponent);
+	void WriteValue(const kbTypeInfoType_t type, const std::string& structName, const byte* const pValue);
+	void WriteWords(const void* const pSrc, const u32 numWords);
+
+	std::vector<std::string> m_Strings;
+	std::unordered_map<std::string, u32> m_StringIndices;
+	std::vector<kbBinaryPackageClass_t> m_Classes;
+	std::vector<kbBinaryPackageField_t> m_Fields;
+	std::unordered_map<std::string, u32> m_ClassIndices;
+	std::vector<u32> m_Data;
+};
+
+/// kbBinaryPackageWriter::AddString
+u32 kbBinaryPackageWriter::AddString(const std::string& string) {
+	std::unordered_map<std::string, u32>::const_iterator it = m_StringIndices.find(string);
+	if (it != m_StringIndices.end()) {
+		return it->second;
+	}
+
+	const u32 stringIdx = (u32)m_Strings.size();
+	m_Strings.push_back(string);
+	m_StringIndices[string] = stringIdx;
+	return stringIdx;
+}
+
+/// kbBinaryPackageWriter::AddClass
+u32 kbBinaryPackageWriter::AddClass(const kbComponent* const pComponent) {
+	const std::string className = pComponent->GetComponentClassName();
+	std::unordered_map<std::string, u32>::const_iterator it = m_ClassIndices.find(className);
+	if (it != m_ClassIndices.end()) {
+		return it->second;
+	}
+
+	kbBinaryPackageClass_t newClass;
+	newClass.m_NameIdx = AddString(className);
+	newClass.m_FirstField = (u32)m_Fields.size();
+	newClass.m_NumFields = 0;
+
+	kbTypeInfoHierarchyIterator iterator(pComponent);
+	for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField()) {
+		kbBinaryPackageField_t newField;
+		newField.m_NameIdx = AddString(pNextField->GetName());
+		newField.m_StructNameIdx = AddString(pNextField->GetStructName());
+		newField.m_Type = (u16)pNextField->Type();
+		newField.m_bIsArray = pNextField->IsArray() ? 1 : 0;
+		m_Fields.push_back(newField);
+		newClass.m_NumFields++;
+	}
+
+	const u32 classIdx = (u32)m_Classes.size();
+	m_Classes.push_back(newClass);
+	m_ClassIndices[className] = classIdx;
+	return classIdx;
+}
+
+/// kbBinaryPackageWriter::WriteWords
+void kbBinaryPackageWriter::WriteWords(const void* const pSrc, const u32 numWords) {
+	const size_t start = m_Data.size();
+	m_Data.resize(start + numWords);
+	memcpy(&m_Data[start], pSrc, numWords * sizeof(u32));
+}
+
+/// kbBinaryPackageWriter::WritePackage
+void kbBinaryPackageWriter::WritePackage(const kbPackage& package) {
+	m_Data.push_back((u32)package.NumFolders());
+	for (int i = 0; i < package.NumFolders(); i++) {
+		const std::vector<kbPrefab*>& prefabs = package.GetPrefabsForFolder(i);
+		m_Data.push_back(AddString(package.GetFolderName(i)));
+		m_Data.push_back((u32)prefabs.size());
+
+		for (int j = 0; j < prefabs.size(); j++) {
+			m_Data.push_back(AddString(prefabs[j]->GetPrefabName()));
+			m_Data.push_back((u32)prefabs[j]->NumGameEntities());
+
+			for (int l = 0; l < prefabs[j]->NumGameEntities(); l++) {
+				// Refresh guid table
+				kbGameEntityPtr entityPtr;
+				entityPtr.SetEntity(const_cast<kbGameEntity*>(prefabs[j]->GetGameEntity(l)));
+				WriteEntity(prefabs[j]->GetGameEntity(l));
+			}
+		}
+	}
+}
+
+/// kbBinaryPackageWriter::WriteEntity
+void kbBinaryPackageWriter::WriteEntity(const kbGameEntity* const pEntity) {
+	const kbGUID& guid = pEntity->GetGUID();
+	WriteWords(guid.m_iGuid, 4);
+
+	m_Data.push_back((u32)pEntity->NumComponents());
+	for (int i = 0; i < pEntity->NumComponents(); i++) {
+		WriteComponent(pEntity->GetComponent(i));
+	}
+}
+
+/// kbBinaryPackageWriter::WriteComponent
+void kbBinaryPackageWriter::WriteComponent(const kbComponent* const pComponent) {
+	m_Data.push_back(AddClass(pComponent));
+
+	const byte* const componentBytePtr = (const byte*)pComponent;
+	kbTypeInfoHierarchyIterator iterator(pComponent);
+	for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField()) {
+		const kbTypeInfoVar& var = *pNextField;
+		const byte* const pValue = componentBytePtr + var.Offset();
+
+		if (var.IsArray() == false) {
+			WriteValue(var.Type(), var.GetStructName(), pValue);
+			continue;
+		}
+
+		switch (var.Type()) {
+			case KBTYPEINFO_SHADER:
+			case KBTYPEINFO_TEXTURE: {
+				const std::vector<kbResource*>& resourceList = *(const std::vector<kbResource*>*)pValue;
+				m_Data.push_back((u32)resourceList.size());
+				for (int i = 0; i < resourceList.size(); i++) {
+					WriteValue(var.Type(), var.GetStructName(), (const byte*)&resourceList[i]);
+				}
+				break;
+			}
+
+			default: {
+				const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(pValue, var.GetStructNameHash());
+				m_Data.push_back((u32)vectorSize);
+				for (int i = 0; i < vectorSize; i++) {
+					const byte* const arrayElem = (const byte*)g_NameToTypeInfoMap->GetVectorElement(pValue, var.GetStructNameHash(), i);
+					if (var.Type() == KBTYPEINFO_STRUCT) {
+						WriteComponent((const kbComponent*)arrayElem);
+					} else {
+						WriteValue(var.Type(), var.GetStructName(), arrayElem);
+					}
+				}
+				break;
+			}
+		}
+	}
+}
+
+/// kbBinaryPackageWriter::WriteValue
+void kbBinaryPackageWriter::WriteValue(const kbTypeInfoType_t type, const std::string& structName, const byte* const pValue) {
+	switch (type) {
+		case KBTYPEINFO_BOOL: {
+			m_Data.push_back(*(const bool*)pValue ? 1 : 0);
+			break;
+		}
+
+		case KBTYPEINFO_INT:
+		case KBTYPEINFO_FLOAT: {
+			WriteWords(pValue, 1);
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR: {
+			WriteWords(pValue, 3);
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR4: {
+			WriteWords(pValue, 4);
+			break;
+		}
+
+		case KBTYPEINFO_STRING: {
+			m_Data.push_back(AddString(*(const std::string*)pValue));
+			break;
+		}
+
+		case KBTYPEINFO_KBSTRING: {
+			m_Data.push_back(AddString(((const kbString*)pValue)->stl_str()));
+			break;
+		}
+
+		case KBTYPEINFO_SOUNDWAVE:
+		case KBTYPEINFO_ANIMATION:
+		case KBTYPEINFO_PTR:
+		case KBTYPEINFO_TEXTURE:
+		case KBTYPEINFO_STATICMODEL:
+		case KBTYPEINFO_SHADER: {
+			const kbResource* const pResource = *(const kbResource* const*)pValue;
+			m_Data.push_back((pResource != nullptr) ? AddString(pResource->GetFullFileName()) : InvalidStringIdx);
+			break;
+		}
+
+		case KBTYPEINFO_GAMEENTITY: {
+			const kbGameEntityPtr& entityPtr = *(const kbGameEntityPtr*)pValue;
+			kbGUID entityGUID;
+			if (entityPtr.GetEntity() != nullptr) {
+				entityGUID = entityPtr.GetGUID();
+			}
+			WriteWords(entityGUID.m_iGuid, 4);
+			break;
+		}
+
+		case KBTYPEINFO_ENUM: {
+			const std::vector<std::string>* const enumList = g_NameToTypeInfoMap->GetEnum(structName);
+			int enumIntValue = *(const int*)pValue;
+			if (enumIntValue < 0 || enumIntValue >= enumList->size()) {
+				blk::warn("Enum value out of range! for %s", structName.c_str());
+				enumIntValue = 0;
+			}
+			m_Data.push_back(AddString((*enumList)[enumIntValue]));
+			break;
+		}
+	}
+}
+
+/// kbBinaryPackageWriter::Save
+bool kbBinaryPackageWriter::Save(const std::string& fileName) const {
+	kbBinaryPackageHeader_t header;
+	header.m_Magic = kbBinaryPackage::Magic;
+	header.m_Version = kbBinaryPackage::Version;
+	header.m_NumStrings = (u32)m_Strings.size();
+	header.m_NumClasses = (u32)m_Classes.size();
+	header.m_NumFields = (u32)m_Fields.size();
+	header.m_DataSize = (u32)m_Data.size();
+
+	std::vector<u32> stringOffsets(m_Strings.size() + 1);
+	u32 stringDataSize = 0;
+	for (size_t i = 0; i < m_Strings.size(); i++) {
+		stringOffsets[i] = stringDataSize;
+		stringDataSize += (u32)m_Strings[i].size() + 1;
+	}
+	stringOffsets[m_Strings.size()] = stringDataSize;
+	const u32 paddedStringDataSize = (stringDataSize + 3) & ~3u;
+
+	header.m_StringOffsets = sizeof(header);
+	header.m_StringData = header.m_StringOffsets + (u32)(stringOffsets.size() * sizeof(u32));
+	header.m_Classes = header.m_StringData + paddedStringDataSize;
+	header.m_Fields = header.m_Classes + header.m_NumClasses * sizeof(kbBinaryPackageClass_t);
+	header.m_Data = header.m_Fields + header.m_NumFields * sizeof(kbBinaryPackageField_t);
+	header.m_FileSize = header.m_Data + header.m_DataSize * sizeof(u32);
+
+	const std::string tempFileName = fileName + "_tmp";
+	std::ofstream outFile(tempFileName.c_str(), std::ios::out | std::ios::binary);
+	if (outFile.fail()) {
+		blk::warn("kbBinaryPackageWriter::Save() - Failed to open %s", tempFileName.c_str());
+		return false;
+	}
+
+	outFile.write((const char*)&header, sizeof(header));
+	outFile.write((const char*)stringOffsets.data(), stringOffsets.size() * sizeof(u32));
+	for (size_t i = 0; i < m_Strings.size(); i++) {
+		outFile.write(m_Strings[i].c_str(), m_Strings[i].size() + 1);
+	}
+
+	static const char padding[4] = { 0, 0, 0, 0 };
+	outFile.write(padding, paddedStringDataSize - stringDataSize);
+	outFile.write((const char*)m_Classes.data(), m_Classes.size() * sizeof(kbBinaryPackageClass_t));
+	outFile.write((const char*)m_Fields.data(), m_Fields.size() * sizeof(kbBinaryPackageField_t));
+	outFile.write((const char*)m_Data.data(), m_Data.size() * sizeof(u32));
+
+	const bool bWritten = outFile.good();
+	outFile.close();
+
+	if (bWritten == false) {
+		blk::warn("kbBinaryPackageWriter::Save() - Failed to write %s", tempFileName.c_str());
+		DeleteFile(tempFileName.c_str());
+		return false;
+	}
+
+	CopyFile(tempFileName.c_str(), fileName.c_str(), false);
+	DeleteFile(tempFileName.c_str());
+	return true;
+}
+
+/// kbBinaryPackageReader - Reads a package out of a mapped binary .kbPkg
+class kbBinaryPackageReader {
+public:
+	kbBinaryPackageReader(const byte* const pFileData, const size_t fileSize, const bool bLoadAssetsImmediately);
+
+	bool Validate(const std::string& fileName);
+	kbPackage* ReadPackage(const std::string& fileName);
+
+private:
+	u32 ReadWord();
+	void ReadWords(void* const pDst, const u32 numWords);
+
+	const char* GetString(const u32 stringIdx);
+	const kbString& GetKbString(const u32 stringIdx);
+	kbResource* GetResource(const u32 stringIdx);
+	const std::vector<const kbTypeInfoVar*>& GetFieldMap(const u32 classIdx, const kbComponent* const pComponent);
+
+	kbGameEntity* ReadEntity();
+	void ReadComponent(kbGameEntity* const pEntity, kbComponent* pComponent, kbComponent* const pOwningComponent);
+	void ReadField(const kbBinaryPackageField_t& field, const kbTypeInfoVar& var, byte* const pValue, kbGameEntity* const pEntity, kbComponent* const pComponent);
+	void ReadValue(const kbTypeInfoType_t type, const std::string& structName, byte* const pValue);
+
+	void SkipComponent(const u32 classIdx);
+	void SkipField(const kbBinaryPackageField_t& field);
+	void SkipValue(const kbTypeInfoType_t type);
+
+	const byte* m_pFileData;
+	size_t m_FileSize;
+	const kbBinaryPackageHeader_t* m_pHeader;
+	const u32* m_pStringOffsets;
+	const char* m_pStringData;
+	const kbBinaryPackageClass_t* m_pClasses;
+	const kbBinaryPackageField_t* m_pFields;
+	const u32* m_pCursor;
+	const u32* m_pDataEnd;
+
+	// Filled in the first time each string or class is used
+	std::vector<kbString> m_KbStrings;
+	std::vector<kbResource*> m_Resources;
+	std::vector<u8> m_bStringResolved;
+	std::vector<std::vector<const kbTypeInfoVar*>> m_FieldMaps;
+	std::vector<u8> m_bFieldMapBuilt;
+
+	bool m_bLoadAssetsImmediately;
+	bool m_bCorrupt;
+};
+
+/// kbBinaryPackageReader::kbBinaryPackageReader
+kbBinaryPackageReader::kbBinaryPackageReader(const byte* const pFileData, const size_t fileSize, const bool bLoadAssetsImmediately) :
+	m_pFileData(pFileData),
+	m_FileSize(fileSize),
+	m_pHeader(nullptr),
+	m_pStringOffsets(nullptr),
+	m_pStringData(nullptr),
+	m_pClasses(nullptr),
+	m_pFields(nullptr),
+	m_pCursor(nullptr),
+	m_pDataEnd(nullptr),
+	m_bLoadAssetsImmediately(bLoadAssetsImmediately),
+	m_bCorrupt(false) {
+}
+
+/// kbBinaryPackageReader::Validate
+bool kbBinaryPackageReader::Validate(const std::string& fileName) {
+	if (m_FileSize < sizeof(kbBinaryPackageHeader_t)) {
+		blk::warn("kbBinaryPackageReader::Validate() - %s is too small to be a package", fileName.c_str());
+		return false;
+	}
+
+	m_pHeader = (const kbBinaryPackageHeader_t*)m_pFileData;
+	if (m_pHeader->m_Magic != kbBinaryPackage::Magic) {
+		blk::warn("kbBinaryPackageReader::Validate() - %s is not a binary package", fileName.c_str());
+		return false;
+	}
+
+	if (m_pHeader->m_Version != kbBinaryPackage::Version) {
+		blk::warn("kbBinaryPackageReader::Validate() - %s is version %u but version %u is expected.  Convert it again from its text package", fileName.c_str(), m_pHeader->m_Version, kbBinaryPackage::Version);
+		return false;
+	}
+
+	const kbBinaryPackageHeader_t& header = *m_pHeader;
+	const u64 stringOffsetsEnd = (u64)header.m_StringOffsets + ((u64)header.m_NumStrings + 1) * sizeof(u32);
+	if (header.m_FileSize != m_FileSize ||
+		(header.m_StringOffsets & 3) != 0 || (header.m_Classes & 3) != 0 || (header.m_Fields & 3) != 0 || (header.m_Data & 3) != 0 ||
+		stringOffsetsEnd > header.m_StringData || header.m_StringData > header.m_Classes ||
+		(u64)header.m_Classes + (u64)header.m_NumClasses * sizeof(kbBinaryPackageClass_t) > header.m_Fields ||
+		(u64)header.m_Fields + (u64)header.m_NumFields * sizeof(kbBinaryPackageField_t) > header.m_Data ||
+		(u64)header.m_Data + (u64)header.m_DataSize * sizeof(u32) > m_FileSize) {
+		blk::warn("kbBinaryPackageReader::Validate() - %s has a corrupt header", fileName.c_str());
+		return false;
+	}
+
+	m_pStringOffsets = (const u32*)(m_pFileData + header.m_StringOffsets);
+	m_pStringData = (const char*)(m_pFileData + header.m_StringData);
+	m_pClasses = (const kbBinaryPackageClass_t*)(m_pFileData + header.m_Classes);
+	m_pFields = (const kbBinaryPackageField_t*)(m_pFileData + header.m_Fields);
+	m_pCursor = (const u32*)(m_pFileData + header.m_Data);
+	m_pDataEnd = m_pCursor + header.m_DataSize;
+
+	// Every string has to end inside the string data so that GetString() can hand out pointers into the view
+	const u32 stringDataSize = header.m_Classes - header.m_StringData;
+	for (u32 i = 0; i < header.m_NumStrings; i++) {
+		const u32 stringEnd = m_pStringOffsets[i + 1];
+		if (m_pStringOffsets[i] >= stringEnd || stringEnd > stringDataSize || m_pStringData[stringEnd - 1] != '\0') {
+			blk::warn("kbBinaryPackageReader::Validate() - %s has a corrupt string table", fileName.c_str());
+			return false;
+		}
+	}
+
+	for (u32 i = 0; i < header.m_NumClasses; i++) {
+		const kbBinaryPackageClass_t& schemaClass = m_pClasses[i];
+		if (schemaClass.m_NameIdx >= header.m_NumStrings || (u64)schemaClass.m_FirstField + schemaClass.m_NumFields > header.m_NumFields) {
+			blk::warn("kbBinaryPackageReader::Validate() - %s has a corrupt schema", fileName.c_str());
+			return false;
+		}
+	}
+
+	for (u32 i = 0; i < header.m_NumFields; i++) {
+		const kbBinaryPackageField_t& field = m_pFields[i];
+		if (field.m_NameIdx >= header.m_NumStrings || field.m_StructNameIdx >= header.m_NumStrings || field.m_Type > KBTYPEINFO_GAMEENTITY) {
+			blk::warn("kbBinaryPackageReader::Validate() - %s has a corrupt schema", fileName.c_str());
+			return false;
+		}
+	}
+
+	m_KbStrings.resize(header.m_NumStrings);
+	m_Resources.resize(header.m_NumStrings, nullptr);
+	m_bStringResolved.resize(header.m_NumStrings, 0);
+	m_FieldMaps.resize(header.m_NumClasses);
+	m_bFieldMapBuilt.resize(header.m_NumClasses, 0);
+
+	return true;
+}
+
+/// kbBinaryPackageReader::ReadWord
+u32 kbBinaryPackageReader::ReadWord() {
+	if (m_pCursor >= m_pDataEnd) {
+		m_bCorrupt = true;
+		return 0;
+	}
+	return *m_pCursor++;
+}
+
+/// kbBinaryPackageReader::ReadWords
+void kbBinaryPackageReader::ReadWords(void* const pDst, const u32 numWords) {
+	if ((u32)(m_pDataEnd - m_pCursor) < numWords) {
+		m_bCorrupt = true;
+		m_pCursor = m_pDataEnd;
+		return;
+	}
+	memcpy(pDst, m_pCursor, numWords * sizeof(u32));
+	m_pCursor += numWords;
+}
+
+/// kbBinaryPackageReader::GetString
+const char* kbBinaryPackageReader::GetString(const u32 stringIdx) {
+	if (stringIdx >= m_pHeader->m_NumStrings) {
+		m_bCorrupt = true;
+		return "";
+	}
+	return m_pStringData + m_pStringOffsets[stringIdx];
+}
+
+/// kbBinaryPackageReader::GetKbString
+const kbString& kbBinaryPackageReader::GetKbString(const u32 stringIdx) {
+	if (stringIdx >= m_pHeader->m_NumStrings) {
+		m_bCorrupt = true;
+		return kbString::EmptyString;
+	}
+
+	if (m_KbStrings[stringIdx].GetStringTableIndex() == INVALID_KBSTRING) {
+		m_KbStrings[stringIdx] = std::string(GetString(stringIdx));
+	}
+	return m_KbStrings[stringIdx];
+}
+
+/// kbBinaryPackageReader::GetResource
+kbResource* kbBinaryPackageReader::GetResource(const u32 stringIdx) {
+	if (stringIdx >= m_pHeader->m_NumStrings) {
+		m_bCorrupt = true;
+		return nullptr;
+	}
+
+	if (m_bStringResolved[stringIdx] == 0) {
+		m_Resources[stringIdx] = g_ResourceManager.GetResource(GetString(stringIdx), m_bLoadAssetsImmediately, true);
+		m_bStringResolved[stringIdx] = 1;
+	}
+	return m_Resources[stringIdx];
+}
+
+/// kbBinaryPackageReader::GetFieldMap - Returns the current kbTypeInfoVar for each of a schema class' fields, or null for
+/// fields that no longer exist or whose type changed
+const std::vector<const kbTypeInfoVar*>& kbBinaryPackageReader::GetFieldMap(const u32 classIdx, const kbComponent* const pComponent) {
+	std::vector<const kbTypeInfoVar*>& fieldMap = m_FieldMaps[classIdx];
+	if (m_bFieldMapBuilt[classIdx] != 0) {
+		return fieldMap;
+	}
+	m_bFieldMapBuilt[classIdx] = 1;
+
+	const kbBinaryPackageClass_t& schemaClass = m_pClasses[classIdx];
+	const std::vector<kbTypeInfoClass*>& typeInfo = pComponent->GetTypeInfo();
+
+	fieldMap.resize(schemaClass.m_NumFields, nullptr);
+	for (u32 i = 0; i < schemaClass.m_NumFields; i++) {
+		const kbBinaryPackageField_t& field = m_pFields[schemaClass.m_FirstField + i];
+		const std::string fieldName = GetString(field.m_NameIdx);
+
+		const kbTypeInfoVar* pVar = nullptr;
+		for (int j = 0; j < typeInfo.size() && pVar == nullptr; j++) {
+			pVar = typeInfo[j]->GetField(fieldName);
+		}
+
+		if (pVar != nullptr && (pVar->Type() != field.m_Type || pVar->IsArray() != (field.m_bIsArray != 0))) {
+			blk::warn("kbBinaryPackageReader::GetFieldMap() - %s::%s changed type since the package was saved.  Its saved values are skipped", GetString(schemaClass.m_NameIdx), fieldName.c_str());
+			pVar = nullptr;
+		}
+		fieldMap[i] = pVar;
+	}
+
+	return fieldMap;
+}
+
+/// kbBinaryPackageReader::ReadPackage
+kbPackage* kbBinaryPackageReader::ReadPackage(const std::string& fileName) {
+	kbPackage* const pPackage = new kbPackage();
+	const size_t packageNamePos = fileName.find_last_of("/");
+	pPackage->m_PackageName = fileName.substr(packageNamePos + 1);
+
+	const u32 numFolders = ReadWord();
+	for (u32 folderIdx = 0; folderIdx < numFolders && m_bCorrupt == false; folderIdx++) {
+		pPackage->m_Folders.push_back(kbPackage::kbFolder());
+		kbPackage::kbFolder& newFolder = pPackage->m_Folders.back();
+		newFolder.m_FolderName = GetString(ReadWord());
+
+		const u32 numPrefabsInFolder = ReadWord();
+		for (u32 prefabIdx = 0; prefabIdx < numPrefabsInFolder && m_bCorrupt == false; prefabIdx++) {
+			kbPrefab* const pPrefab = new kbPrefab();
+			pPrefab->m_PrefabName = GetString(ReadWord());
+			newFolder.m_pPrefabs.push_back(pPrefab);
+
+			const u32 numEntitiesInPrefab = ReadWord();
+			for (u32 entityIdx = 0; entityIdx < numEntitiesInPrefab && m_bCorrupt == false; entityIdx++) {
+				pPrefab->m_GameEntities.push_back(ReadEntity());
+			}
+		}
+	}
+
+	if (m_bCorrupt) {
+		blk::warn("kbBinaryPackageReader::ReadPackage() - %s is corrupt", fileName.c_str());
+		kbBinaryPackage::DeletePackage(pPackage);
+		return nullptr;
+	}
+
+	return pPackage;
+}
+
+/// kbBinaryPackageReader::ReadEntity
+kbGameEntity* kbBinaryPackageReader::ReadEntity() {
+	kbGUID entityGUID;
+	ReadWords(entityGUID.m_iGuid, 4);
+
+	kbGameEntity* const pGameEntity = new kbGameEntity(&entityGUID, true);
+
+	const u32 numComponents = ReadWord();
+	for (u32 i = 0; i < numComponents && m_bCorrupt == false; i++) {
+		ReadComponent(pGameEntity, nullptr, nullptr);
+	}
+
+	pGameEntity->post_load();
+	return pGameEntity;
+}
+
+/// kbBinaryPackageReader::ReadComponent - Constructs the component when pComponent is null
+void kbBinaryPackageReader::ReadComponent(kbGameEntity* const pEntity, kbComponent* pComponent, kbComponent* const pOwningComponent) {
+	const u32 classIdx = ReadWord();
+	if (classIdx >= m_pHeader->m_NumClasses) {
+		m_bCorrupt = true;
+		return;
+	}
+
+	const kbBinaryPackageClass_t& schemaClass = m_pClasses[classIdx];
+	if (pComponent == nullptr) {
+		const std::string className = GetString(schemaClass.m_NameIdx);
+		if (className == "kbTransformComponent") {
+			pComponent = pEntity->GetComponent(0);
+		} else {
+			pComponent = ConstructClassFromName(className);
+			if (pComponent == nullptr) {
+				blk::warn("kbBinaryPackageReader::ReadComponent() - %s no longer exists.  Skipping it", className.c_str());
+				SkipComponent(classIdx);
+				return;
+			}
+			pEntity->AddComponent(pComponent);
+		}
+	}
+
+	if (pOwningComponent != nullptr) {
+		pComponent->SetOwningComponent(pOwningComponent);
+	}
+
+	const std::vector<const kbTypeInfoVar*>& fieldMap = GetFieldMap(classIdx, pComponent);
+	byte* const componentBytePtr = (byte*)pComponent;
+	for (u32 i = 0; i < schemaClass.m_NumFields && m_bCorrupt == false; i++) {
+		const kbBinaryPackageField_t& field = m_pFields[schemaClass.m_FirstField + i];
+		if (fieldMap[i] == nullptr) {
+			SkipField(field);
+		} else {
+			ReadField(field, *fieldMap[i], componentBytePtr + fieldMap[i]->Offset(), pEntity, pComponent);
+		}
+	}
+}
+
+/// kbBinaryPackageReader::ReadField
+void kbBinaryPackageReader::ReadField(const kbBinaryPackageField_t& field, const kbTypeInfoVar& var, byte* const pValue, kbGameEntity* const pEntity, kbComponent* const pComponent) {
+	if (var.IsArray() == false) {
+		ReadValue(var.Type(), var.GetStructName(), pValue);
+		return;
+	}
+
+	const u32 arraySize = ReadWord();
+	if (arraySize > (u32)(m_pDataEnd - m_pCursor)) {
+		m_bCorrupt = true;
+		return;
+	}
+
+	switch (var.Type()) {
+		case KBTYPEINFO_SHADER:
+		case KBTYPEINFO_TEXTURE: {
+			std::vector<kbResource*>& resourceList = *(std::vector<kbResource*>*)pValue;
+			resourceList.resize(arraySize);
+			for (u32 i = 0; i < arraySize; i++) {
+				resourceList[i] = GetResource(ReadWord());
+			}
+			break;
+		}
+
+		default: {
+			g_NameToTypeInfoMap->ResizeVector(pValue, var.GetStructNameHash(), arraySize);
+			for (u32 i = 0; i < arraySize && m_bCorrupt == false; i++) {
+				byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(pValue, var.GetStructNameHash(), i);
+				if (var.Type() == KBTYPEINFO_STRUCT) {
+					ReadComponent(pEntity, (kbComponent*)arrayElem, pComponent);
+				} else {
+					ReadValue(var.Type(), var.GetStructName(), arrayElem);
+				}
+			}
+			break;
+		}
+	}
+}
+
+/// kbBinaryPackageReader::ReadValue
+void kbBinaryPackageReader::ReadValue(const kbTypeInfoType_t type, const std::string& structName, byte* const pValue) {
+	switch (type) {
+		case KBTYPEINFO_BOOL: {
+			*(bool*)pValue = ReadWord() != 0;
+			break;
+		}
+
+		case KBTYPEINFO_INT:
+		case KBTYPEINFO_FLOAT: {
+			ReadWords(pValue, 1);
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR: {
+			ReadWords(pValue, 3);
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR4: {
+			ReadWords(pValue, 4);
+			break;
+		}
+
+		case KBTYPEINFO_STRING: {
+			*(std::string*)pValue = GetString(ReadWord());
+			break;
+		}
+
+		case KBTYPEINFO_KBSTRING: {
+			*(kbString*)pValue = GetKbString(ReadWord());
+			break;
+		}
+
+		case KBTYPEINFO_SOUNDWAVE:
+		case KBTYPEINFO_ANIMATION:
+		case KBTYPEINFO_PTR:
+		case KBTYPEINFO_TEXTURE:
+		case KBTYPEINFO_STATICMODEL:
+		case KBTYPEINFO_SHADER: {
+			const u32 stringIdx = ReadWord();
+			if (stringIdx != InvalidStringIdx) {
+				*(kbResource**)pValue = GetResource(stringIdx);
+			}
+			break;
+		}
+
+		case KBTYPEINFO_GAMEENTITY: {
+			kbGUID entityGUID;
+			ReadWords(entityGUID.m_iGuid, 4);
+			((kbGameEntityPtr*)pValue)->SetEntity(entityGUID);
+			break;
+		}
+
+		case KBTYPEINFO_ENUM: {
+			const char* const enumValue = GetString(ReadWord());
+			const std::vector<std::string>* const enumList = g_NameToTypeInfoMap->GetEnum(structName);
+
+			int& enumIntValue = *(int*)pValue;
+			enumIntValue = 0;
+			int i = 0;
+			for (i = 0; i < enumList->size(); i++) {
+				if ((*enumList)[i] == enumValue) {
+					enumIntValue = i;
+					break;
+				}
+			}
+
+			if (i == enumList->size()) {
+				blk::warn("Enum value out of range");
+			}
+			break;
+		}
+	}
+}
+
+/// kbBinaryPackageReader::SkipComponent
+void kbBinaryPackageReader::SkipComponent(const u32 classIdx) {
+	if (classIdx >= m_pHeader->m_NumClasses) {
+		m_bCorrupt = true;
+		return;
+	}
+
+	const kbBinaryPackageClass_t& schemaClass = m_pClasses[classIdx];
+	for (u32 i = 0; i < schemaClass.m_NumFields && m_bCorrupt == false; i++) {
+		SkipField(m_pFields[schemaClass.m_FirstField + i]);
+	}
+}
+
+/// kbBinaryPackageReader::SkipField
+void kbBinaryPackageReader::SkipField(const kbBinaryPackageField_t& field) {
+	if (field.m_bIsArray == 0) {
+		SkipValue((kbTypeInfoType_t)field.m_Type);
+		return;
+	}
+
+	const u32 arraySize = ReadWord();
+	for (u32 i = 0; i < arraySize && m_bCorrupt == false; i++) {
+		if (field.m_Type == KBTYPEINFO_STRUCT) {
+			SkipComponent(ReadWord());
+		} else {
+			SkipValue((kbTypeInfoType_t)field.m_Type);
+		}
+	}
+}
+
+/// kbBinaryPackageReader::SkipValue - Structs outside of arrays have no saved value, same as in the text format
+void kbBinaryPackageReader::SkipValue(const kbTypeInfoType_t type) {
+	u32 numWords = 0;
+	switch (type) {
+		case KBTYPEINFO_BOOL:
+		case KBTYPEINFO_INT:
+		case KBTYPEINFO_FLOAT:
+		case KBTYPEINFO_STRING:
+		case KBTYPEINFO_KBSTRING:
+		case KBTYPEINFO_SOUNDWAVE:
+		case KBTYPEINFO_ANIMATION:
+		case KBTYPEINFO_PTR:
+		case KBTYPEINFO_TEXTURE:
+		case KBTYPEINFO_STATICMODEL:
+		case KBTYPEINFO_SHADER:
+		case KBTYPEINFO_ENUM: numWords = 1; break;
+		case KBTYPEINFO_VECTOR: numWords = 3; break;
+		case KBTYPEINFO_VECTOR4:
+		case KBTYPEINFO_GAMEENTITY: numWords = 4; break;
+	}
+
+	if ((u32)(m_pDataEnd - m_pCursor) < numWords) {
+		m_bCorrupt = true;
+		m_pCursor = m_pDataEnd;
+		return;
+	}
+	m_pCursor += numWords;
+}
+
+/// kbBinaryPackage::IsBinaryPackage
+bool kbBinaryPackage::IsBinaryPackage(const std::string& fileName) {
+	kbFileData fileData;
+	if (g_FileSystem.ReadFile(fileName, fileData) == false || fileData.GetSize() < sizeof(u32)) {
+		return false;
+	}
+
+	u32 magic = 0;
+	memcpy(&magic, fileData.GetData(), sizeof(magic));
+	return magic == Magic;
+}
+
+/// kbBinaryPackage::Write
+bool kbBinaryPackage::Write(const std::string& fileName, const kbPackage& package) {
+	if (package.NumFolders() == 0) {
+		blk::warn("kbBinaryPackage::Write() - Tried to write to file %s with no folders", fileName.c_str());
+		return false;
+	}
+
+	blk::log("Writing binary package %s", package.GetPackageName().c_str());
+
+	kbBinaryPackageWriter writer;
+	writer.WritePackage(package);
+	return writer.Save(fileName);
+}
+
+/// kbBinaryPackage::Read
+kbPackage* kbBinaryPackage::Read(const std::string& fileName, const bool bLoadAssetsImmediately) {
+	kbFileData fileData;
+	if (g_FileSystem.ReadFile(fileName, fileData) == false) {
+		blk::warn("kbBinaryPackage::Read() - Failed to read %s", fileName.c_str());
+		return nullptr;
+	}
+
+	kbBinaryPackageReader reader(fileData.GetData(), fileData.GetSize(), bLoadAssetsImmediately);
+	if (reader.Validate(fileName) == false) {
+		return nullptr;
+	}
+
+	return reader.ReadPackage(fileName);
+}
+
+/// kbBinaryPackage::ConvertTextToBinary
+bool kbBinaryPackage::ConvertTextToBinary(const std::string& textFileName, const std::string& binaryFileName) {
+	kbFile textFile;
+	if (IsBinaryPackage(textFileName) || textFile.Open(textFileName, kbFile::FT_Read) == false) {
+		blk::warn("kbBinaryPackage::ConvertTextToBinary() - %s is not a text package", textFileName.c_str());
+		return false;
+	}
+
+	kbPackage* const pPackage = textFile.ReadPackage(false);
+	textFile.Close();
+	if (pPackage == nullptr) {
+		return false;
+	}
+
+	const bool bWritten = Write(binaryFileName, *pPackage);
+	DeletePackage(pPackage);
+	return bWritten;
+}
+
+/// kbBinaryPackage::ConvertBinaryToText
+bool kbBinaryPackage::ConvertBinaryToText(const std::string& binaryFileName, const std::string& textFileName) {
+	kbPackage* const pPackage = Read(binaryFileName, false);
+	if (pPackage == nullptr) {
+		return false;
+	}
+
+	kbFile textFile;
+	bool bWritten = textFile.Open(textFileName, kbFile::FT_Write);
+	if (bWritten) {
+		bWritten = textFile.WritePackage(*pPackage);
+		textFile.Close();
+	}
+
+	DeletePackage(pPackage);
+	return bWritten;
+}
+
+/// kbBinaryPackage::DeletePackage
+void kbBinaryPackage::DeletePackage(kbPackage* const pPackage) {
+	if (pPackage == nullptr) {
+		return;
+	}
+
+	for (int i = 0; i < pPackage->m_Folders.size(); i++) {
+		const std::vector<kbPrefab*>& prefabs = pPackage->m_Folders[i].m_pPrefabs;
+		for (int j = 0; j < prefabs.size(); j++) {
+			for (int l = 0; l < prefabs[j]->m_GameEntities.size(); l++) {
+				delete prefabs[j]->m_GameEntities[l];
+			}
+			prefabs[j]->m_GameEntities.clear();
+		}
+	}
+	delete pPackage;
+}
+
+/// kbBinaryPackage::Benchmark
+void kbBinaryPackage::Benchmark(const std::string& textFileName, const u32 numLoads) {
+	if (numLoads == 0 || IsBinaryPackage(textFileName)) {
+		return;
+	}
+
+	const std::string binaryFileName = textFileName + "_benchmark_bin";
+	const std::string textFromTextFileName = textFileName + "_benchmark_txt0";
+	const std::string textFromBinaryFileName = textFileName + "_benchmark_txt1";
+
+	kbTimer convertTimer;
+	if (ConvertTextToBinary(textFileName, binaryFileName) == false) {
+		return;
+	}
+	const f32 convertMS = convertTimer.TimeElapsedMS();
+
+	// Both paths resolve the same resources, so the first load of each is left out of the timings
+	f32 textMS = 0.0f, binaryMS = 0.0f;
+	for (u32 i = 0; i <= numLoads; i++) {
+		kbTimer textTimer;
+		kbFile textFile;
+		textFile.Open(textFileName, kbFile::FT_Read);
+		kbPackage* const pTextPackage = textFile.ReadPackage(false);
+		textFile.Close();
+		const f32 textLoadMS = textTimer.TimeElapsedMS();
+		DeletePackage(pTextPackage);
+
+		kbTimer binaryTimer;
+		kbPackage* const pBinaryPackage = Read(binaryFileName, false);
+		const f32 binaryLoadMS = binaryTimer.TimeElapsedMS();
+		DeletePackage(pBinaryPackage);
+
+		if (i > 0) {
+			textMS += textLoadMS;
+			binaryMS += binaryLoadMS;
+		}
+	}
+
+	// Writing the text package out through both paths should give the same file if the binary copy lost nothing
+	bool bLossless = false;
+	kbFile textFile;
+	textFile.Open(textFileName, kbFile::FT_Read);
+	kbPackage* const pTextPackage = textFile.ReadPackage(false);
+	textFile.Close();
+	if (pTextPackage != nullptr) {
+		kbFile outFile;
+		outFile.Open(textFromTextFileName, kbFile::FT_Write);
+		outFile.WritePackage(*pTextPackage);
+		outFile.Close();
+		DeletePackage(pTextPackage);
+
+		if (ConvertBinaryToText(binaryFileName, textFromBinaryFileName)) {
+			std::ifstream fromText(textFromTextFileName.c_str(), std::ios::in | std::ios::binary);
+			std::ifstream fromBinary(textFromBinaryFileName.c_str(), std::ios::in | std::ios::binary);
+			const std::string fromTextContents((std::istreambuf_iterator<char>(fromText)), std::istreambuf_iterator<char>());
+			const std::string fromBinaryContents((std::istreambuf_iterator<char>(fromBinary)), std::istreambuf_iterator<char>());
+			bLossless = fromTextContents.empty() == false && fromTextContents == fromBinaryContents;
+		}
+	}
+
+	std::ifstream textSizeFile(textFileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	std::ifstream binarySizeFile(binaryFileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	const u64 textSize = (u64)textSizeFile.tellg();
+	const u64 binarySize = (u64)binarySizeFile.tellg();
+	textSizeFile.close();
+	binarySizeFile.close();
+
+	DeleteFile(binaryFileName.c_str());
+	DeleteFile(textFromTextFileName.c_str());
+	DeleteFile(textFromBinaryFileName.c_str());
+
+	blk::log("Package benchmark - %s, %u loads.  Text is %llu bytes, binary is %llu bytes.  Converting took %.3f ms", textFileName.c_str(), numLoads, textSize, binarySize, convertMS);
+	blk::log("	Text load: %.3f ms.  Binary load: %.3f ms.  %.1fx faster.  Round trip is %s", textMS / numLoads, binaryMS / numLoads, (binaryMS > 0.0f) ? (textMS / binaryMS) : (0.0f), bLossless ? "lossless" : "NOT lossless");
+}
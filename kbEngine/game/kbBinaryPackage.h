@@ -0,0 +1,75 @@
+/// kbBinaryPackage.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <string>
+
+class kbPackage;
+
+/// kbBinaryPackageHeader_t - Offsets are in bytes from the start of the file, and every section starts on a four byte boundary
+struct kbBinaryPackageHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u32 m_FileSize;
+	u32 m_NumStrings;
+	u32 m_StringOffsets;		// One u32 per string plus one, relative to m_StringData
+	u32 m_StringData;			// Null terminated
+	u32 m_NumClasses;
+	u32 m_Classes;
+	u32 m_NumFields;
+	u32 m_Fields;
+	u32 m_Data;
+	u32 m_DataSize;				// In u32s
+};
+
+/// kbBinaryPackageClass_t - A component class as it was when the package was saved
+struct kbBinaryPackageClass_t {
+	u32 m_NameIdx;
+	u32 m_FirstField;
+	u32 m_NumFields;
+};
+
+/// kbBinaryPackageField_t
+struct kbBinaryPackageField_t {
+	u32 m_NameIdx;
+	u32 m_StructNameIdx;
+	u16 m_Type;					// kbTypeInfoType_t
+	u16 m_bIsArray;
+};
+
+/// kbBinaryPackage
+///
+/// Binary .kbPkg files.  They hold the same folders, prefabs and entities as the text format in three parts:
+///
+///	- A string table with every name, resource path and enum value in the package, each stored once
+///	- A schema of each component class that was saved.  Its fields' names and types come from kbTypeInfo
+///	- A stream of u32s.  Components are a class index followed by each schema field's value, with POD values stored
+///	  as their raw bits and everything else as a string index
+///
+/// Loading maps the file and reads values straight out of the view.  Each schema class is matched against the current
+/// kbTypeInfo once by field name, so fields that were added, removed or reordered since the package was saved still
+/// load, and each string is turned into a kbString or resource pointer the first time it is used.  The format version
+/// only changes when the layout above does
+class kbBinaryPackage {
+public:
+	static const u32 Magic = 0x4b504b42;		// "BKPK"
+	static const u32 Version = 1;
+
+	/// Checks the magic number, so binary packages can keep the .kbPkg extension
+	static bool IsBinaryPackage(const std::string& fileName);
+
+	static bool Write(const std::string& fileName, const kbPackage& package);
+	static kbPackage* Read(const std::string& fileName, const bool bLoadAssetsImmediately = true);
+
+	static bool ConvertTextToBinary(const std::string& textFileName, const std::string& binaryFileName);
+	static bool ConvertBinaryToText(const std::string& binaryFileName, const std::string& textFileName);
+
+	/// Deletes a package loaded by Read() or kbFile::ReadPackage() along with its entities
+	static void DeletePackage(kbPackage* const pPackage);
+
+	/// Logs the cost of loading textFileName as text and as binary numLoads times each, and whether the binary copy writes
+	/// back out to the same text.  The package must not already be loaded, as its entities' GUIDs would collide
+	static void Benchmark(const std::string& textFileName, const u32 numLoads);
+};
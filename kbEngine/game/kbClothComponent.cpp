@@ -1,15 +1,20 @@
 /// kbClothComponent.cpp
 ///
 ///
+/// kbClothComponent.cpp
+///
+///
 /// 2016-2025 blk 1.0
 
 #include "blk_core.h"
+#include "blk_containers.h"
 #include "Matrix.h"
 #include "Quaternion.h"
 #include "kbGameEntityHeader.h"
 #include "kbComponent.h"
 #include "kbClothComponent.h"
 #include "blk_console.h"
+#include "kbJobManager.h"
 #include "DX11/kbRenderer_DX11.h"			// HACK
 
 KB_DEFINE_COMPONENT(kbClothBone)
@@ -19,6 +24,35 @@ kbConsoleVariable g_DebugCloth("debugcloth", false, kbConsoleVariable::Console_I
 kbConsoleVariable g_ClothGrav("clothgravity", 0.0f, kbConsoleVariable::Console_Float, "Cloth gravity", "");
 kbConsoleVariable g_ClothSpring("clothspring", 0.5f, kbConsoleVariable::Console_Float, "Cloth spring", "");
 kbConsoleVariable g_ClothFriction("clothFriction", 0.02f, kbConsoleVariable::Console_Float, "Cloth friction", "");
+kbConsoleVariable g_ClothTimeStep("clothtimestep", 1.0f / 60.0f, kbConsoleVariable::Console_Float, "Length of a cloth simulation step in seconds.  Frame time is run as whole steps, up to four per frame.", "");
+kbConsoleVariable g_ParallelCloth("parallelcloth", true, kbConsoleVariable::Console_Bool, "Simulate cloth on the job threads after all entities have updated.", "");
+
+static std::vector<kbClothComponent*> g_PendingClothComponents;
+
+/// kbPendingClothSkeleton_t - A run of g_PendingClothComponents that share a skeleton
+struct kbPendingClothSkeleton_t {
+	kbClothComponent* const* m_pComponents;
+	size_t m_NumComponents;
+};
+static std::vector<kbPendingClothSkeleton_t> g_PendingClothSkeletons;
+
+/// kbClothMeshCacheEntry_t
+struct kbClothMeshCacheEntry_t {
+	kbClothMeshCacheEntry_t() : m_NumRefs(0) { }
+
+	kbClothMeshCollider m_Collider;
+	u32 m_NumRefs;
+};
+
+/// kbClothWorldCollider_t
+struct kbClothWorldCollider_t {
+	const kbStaticModelComponent* m_pComponent;
+	const kbModel* m_pModel;
+	const kbClothMeshCollider* m_pCollider;
+};
+
+static std::map<const kbModel*, kbClothMeshCacheEntry_t> g_ClothMeshCache;
+static std::vector<kbClothWorldCollider_t> g_ClothWorldColliders;
 
 /// kbClothBone::Constructor
 void kbClothBone::Constructor() {
@@ -30,8 +64,18 @@ void kbBoneCollisionSphere::Constructor() {
 	m_Sphere.set(0.0f, 0.0f, 0.0f, 10.0f);
 }
 
+/// kbBoneCollisionCapsule::Constructor
+void kbBoneCollisionCapsule::Constructor() {
+	m_Start.set(0.0f, 0.0f, 0.0f);
+	m_End.set(0.0f, 10.0f, 0.0f);
+	m_Radius = 5.0f;
+}
+
 /// kbClothComponent::~kbClothComponent
 kbClothComponent::~kbClothComponent() {
+	if (m_bSimulationPending) {
+		blk::std_remove_swap(g_PendingClothComponents, this);
+	}
 }
 
 /// kbClothComponent::Constructor
@@ -40,7 +84,11 @@ void kbClothComponent::Constructor() {
 	m_Width = 0;
 	m_Height = 0;
 	m_pSkeletalModel = nullptr;
+	m_pSkelComponent = nullptr;
 	m_NumConstrainIterations = 1;
+	m_CollisionThickness = 0.0f;
+	m_SelfCollisionDistance = 0.0f;
+	m_bCollideWithWorld = false;
 
 	m_gravity.set(0.0f, -100.0f, 0.0f);
 	m_MaxWindVelocity.set(20.0f, 160.0f, -9.0f);
@@ -54,16 +102,14 @@ void kbClothComponent::Constructor() {
 	m_NextWindChangeTime = 0;
 
 	m_CurrentTickFrame = 0;
+	m_PendingDeltaTime = 0.0f;
+	m_bSimulationPending = false;
 }
 
 /// kbClothComponent::update_internal
 void kbClothComponent::update_internal(const float dt) {
 	Super::update_internal(dt);
 
-	float DeltaTime = dt;
-	if (DeltaTime == 0.0f) {
-		DeltaTime = 0.016f;
-	}
 	// Dont start sim for a few frames in case the entity is teleported
 	m_CurrentTickFrame++;
 	if (m_CurrentTickFrame < 5) {
@@ -82,46 +128,236 @@ void kbClothComponent::update_internal(const float dt) {
 		}
 	}
 
+	m_pSkelComponent = pSkelRenderComponent;
 	if (pSkelRenderComponent == nullptr || m_pSkeletalModel == nullptr) {
 		return;
 	}
 
-	RunSimulation(DeltaTime);
+	// The renderer isn't thread safe, so last frame's results are drawn here rather than after the simulation
+	DrawDebug();
 
-	Mat4 WorldMat;
-	GetOwner()->CalculateWorldMatrix(WorldMat);
+	UpdateWind();
 
-	// todo: Need my own inverse matrix function
-	Mat4 invParentMatrix;
-	XMMATRIX inverseMat = XMMatrixInverse(nullptr, XMMATRIXFromMat4(WorldMat));
-	invParentMatrix = Mat4FromXMMATRIX(inverseMat);
+	m_PendingDeltaTime += dt;
+	RequestSimulation();
+}
 
-	std::vector<kbBoneMatrix_t>& FinalBoneMatrices = pSkelRenderComponent->GetFinalBoneMatrices();
-	if (FinalBoneMatrices.size() == 0) {
+/// kbClothComponent::RequestSimulation
+void kbClothComponent::RequestSimulation() {
+	if (g_ParallelCloth.GetBool() == false) {
+		Simulate();
 		return;
 	}
 
-	static int clothDebug = 0;
+	if (m_bSimulationPending == false) {
+		m_bSimulationPending = true;
+		g_PendingClothComponents.push_back(this);
+	}
+}
 
-	/*if ( GetAsyncKeyState( 'I') ) {
-		clothDebug = 0;
-	} else if ( GetAsyncKeyState( 'O') ) {
-		clothDebug = 1;
-	} else if ( GetAsyncKeyState( 'P') ) {
-		clothDebug = 2;
-	}*/
+/// kbClothComponent::Simulate
+///
+/// Only touches this component, its skeletal model component, and read-only owner data so that cloth can be
+/// simulated on any thread once poses have been evaluated
+void kbClothComponent::Simulate() {
+	m_bSimulationPending = false;
+
+	if (m_pSkelComponent == nullptr || m_pSkeletalModel == nullptr) {
+		return;
+	}
+
+	RunSimulation(m_PendingDeltaTime);
+	m_PendingDeltaTime = 0.0f;
+
+	ApplyToSkeleton();
+}
+
+/// kbClothComponent::UpdateWind
+void kbClothComponent::UpdateWind() {
+	if (m_bAddFakeOscillation == false) {
+		return;
+	}
+
+	if (g_GlobalTimer.TimeElapsedSeconds() >= m_NextWindChangeTime) {
+		m_NextWindChangeTime = g_GlobalTimer.TimeElapsedSeconds() + (kbfrand() * (m_MaxWindGustDuration - m_MinWindGustDuration)) + m_MinWindGustDuration;
+		m_NextWindVelocity = Vec3Rand(m_MinWindVelocity, m_MaxWindVelocity);
+	}
+
+	m_CurWindVelocity = kbLerp(m_CurWindVelocity, m_NextWindVelocity, 0.0075f);
+}
+
+/// kbClothComponent::GatherColliders
+void kbClothComponent::GatherColliders() {
+
+	// Collision spheres and capsules follow their bones
+	m_WorldCollisionSpheres.clear();
+	for (int iCollision = 0; iCollision < m_CollisionSpheres.size(); iCollision++) {
+		kbBoneMatrix_t boneWorldMatrix;
+		if (m_pSkelComponent->GetBoneWorldMatrix(m_CollisionSpheres[iCollision].m_BoneName, boneWorldMatrix)) {
+			boneWorldMatrix.m_Axis[0].normalize_self();
+			boneWorldMatrix.m_Axis[1].normalize_self();
+			boneWorldMatrix.m_Axis[2].normalize_self();
+
+			const Vec3 spherePos = m_CollisionSpheres[iCollision].m_Sphere.ToVec3() * boneWorldMatrix;
+			m_WorldCollisionSpheres.push_back(Vec4(spherePos, m_CollisionSpheres[iCollision].m_Sphere.w));
+		}
+	}
+	m_Solver.SetCollisionSpheres(m_WorldCollisionSpheres.data(), (u32)m_WorldCollisionSpheres.size());
+
+	m_WorldCollisionCapsules.clear();
+	for (int iCollision = 0; iCollision < m_CollisionCapsules.size(); iCollision++) {
+		kbBoneMatrix_t boneWorldMatrix;
+		if (m_pSkelComponent->GetBoneWorldMatrix(m_CollisionCapsules[iCollision].m_BoneName, boneWorldMatrix)) {
+			boneWorldMatrix.m_Axis[0].normalize_self();
+			boneWorldMatrix.m_Axis[1].normalize_self();
+			boneWorldMatrix.m_Axis[2].normalize_self();
+
+			kbClothCapsule_t capsule;
+			capsule.m_Start = m_CollisionCapsules[iCollision].m_Start * boneWorldMatrix;
+			capsule.m_End = m_CollisionCapsules[iCollision].m_End * boneWorldMatrix;
+			capsule.m_Radius = m_CollisionCapsules[iCollision].m_Radius;
+			m_WorldCollisionCapsules.push_back(capsule);
+		}
+	}
+	m_Solver.SetCollisionCapsules(m_WorldCollisionCapsules.data(), (u32)m_WorldCollisionCapsules.size());
+
+	// Only world meshes near last frame's cloth are handed to the solver.  The margin covers the cloth moving this frame
+	m_WorldMeshColliders.clear();
+	if (m_bCollideWithWorld && m_Masses.size() > 0) {
+		kbBounds clothBounds(true);
+		for (int i = 0; i < m_Masses.size(); i++) {
+			clothBounds.AddPoint(m_Masses[i].GetPosition());
+		}
+		const Vec3 margin = (clothBounds.Max() - clothBounds.Min()) + Vec3(m_CollisionThickness, m_CollisionThickness, m_CollisionThickness);
+		clothBounds.SetMaxMin(clothBounds.Max() + margin, clothBounds.Min() - margin);
+
+		for (size_t iCollider = 0; iCollider < g_ClothWorldColliders.size(); iCollider++) {
+			const kbClothWorldCollider_t& worldCollider = g_ClothWorldColliders[iCollider];
+			if (worldCollider.m_pCollider->IsValid() == false) {
+				continue;
+			}
+
+			const kbGameEntity* const pOwner = worldCollider.m_pComponent->GetOwner();
+			const Vec3 scale = pOwner->GetScale() * kbLevelComponent::GetGlobalModelScale();
+
+			kbClothMeshInstance_t instance;
+			instance.m_pCollider = worldCollider.m_pCollider;
+			instance.m_LocalToWorld.make_scale(scale);
+			instance.m_LocalToWorld = instance.m_LocalToWorld * pOwner->GetOrientation().to_mat4();
+			instance.m_LocalToWorld[3] = pOwner->GetPosition();
+
+			const kbBounds& localBounds = worldCollider.m_pCollider->GetBounds();
+			instance.m_WorldBounds.Reset();
+			for (int iCorner = 0; iCorner < 8; iCorner++) {
+				const Vec3 corner((iCorner & 1) ? (localBounds.Max().x) : (localBounds.Min().x), (iCorner & 2) ? (localBounds.Max().y) : (localBounds.Min().y), (iCorner & 4) ? (localBounds.Max().z) : (localBounds.Min().z));
+				instance.m_WorldBounds.AddPoint(instance.m_LocalToWorld.transform_point(corner));
+			}
+
+			if (clothBounds.IntersectsBounds(instance.m_WorldBounds) == false) {
+				continue;
+			}
+
+			const XMMATRIX inverseMat = XMMatrixInverse(nullptr, XMMATRIXFromMat4(instance.m_LocalToWorld));
+			instance.m_WorldToLocal = Mat4FromXMMATRIX(inverseMat);
+			instance.m_WorldToLocalScale = 1.0f / max(min(fabsf(scale.x), min(fabsf(scale.y), fabsf(scale.z))), 0.0001f);
+			m_WorldMeshColliders.push_back(instance);
+		}
+	}
+	m_Solver.SetMeshColliders(m_WorldMeshColliders.data(), (u32)m_WorldMeshColliders.size());
+}
+
+/// kbClothComponent::RunSimulation
+void kbClothComponent::RunSimulation(const float DeltaTime) {
+	GatherColliders();
+
+	// Anchored masses follow the animated pose.  They're snapped to it here as well as handed to the solver, so they
+	// don't lag on frames too short for a step
+	const std::vector<kbBoneMatrix_t>& FinalBoneMatrices = m_pSkelComponent->GetFinalBoneMatrices();
+	if (FinalBoneMatrices.size() == 0) {
+		return;
+	}
+
+	Mat4 WorldMat;
+	GetOwner()->CalculateWorldMatrix(WorldMat);
 
 	for (int i = 0; i < m_Masses.size(); i++) {
+		if (m_Masses[i].m_bAnchored == false) {
+			continue;
+		}
 
 		const int BoneIndex = m_BoneIndices[i];
+		const Vec3 localBonePos = m_pSkelComponent->GetBoneRefMatrix(BoneIndex).GetAxis(3);
+		const Vec3 finalPosition = WorldMat.transform_point(localBonePos * FinalBoneMatrices[BoneIndex]);
+		m_Masses[i].SetPosition(finalPosition);
+		m_Solver.SetAnchorTarget(i, finalPosition);
+	}
+
+	kbClothSolverParams_t params;
+	params.m_Gravity = m_gravity + Vec3(0.0f, g_ClothGrav.GetFloat(), 0.0f);
+	params.m_Wind = (m_bAddFakeOscillation) ? (m_CurWindVelocity) : (Vec3::zero);
+	params.m_FixedTimeStep = max(g_ClothTimeStep.GetFloat(), 0.001f);
+	params.m_Damping = g_ClothFriction.GetFloat();
+	params.m_Stiffness = g_ClothSpring.GetFloat();
+	params.m_Thickness = m_CollisionThickness;
+	params.m_SelfCollisionDistance = m_SelfCollisionDistance;
+	params.m_NumIterations = (u32)max(m_NumConstrainIterations, 0);
+
+	if (m_Solver.Advance(DeltaTime, params) == 0) {
+		return;
+	}
+
+	for (int i = 0; i < m_Masses.size(); i++) {
+		if (m_Masses[i].m_bAnchored == false) {
+			m_Masses[i].SetPosition(m_Solver.GetPosition(i));
+		}
+	}
+
+	// Update orientation
+	for (size_t massIdx = 0; massIdx < m_BoneInfo.size(); massIdx++) {
+		const size_t curX = massIdx % (size_t)m_Width;
+		const size_t curY = massIdx / (size_t)m_Width;
+		Vec3 xAxis;
+		Vec3 yAxis;
+		Vec3 zAxis;
+
+		if (curX < (size_t)m_Width - 1) {
+			xAxis = (m_Masses[massIdx + 1].GetPosition() - m_Masses[massIdx].GetPosition()).normalize_safe();
+		} else {
+			xAxis = (m_Masses[massIdx].GetPosition() - m_Masses[massIdx - 1].GetPosition()).normalize_safe();
+		}
 
-		if (m_Masses[i].m_bAnchored) {
-			const kbBoneMatrix_t refBoneMatrix = pSkelRenderComponent->GetBoneRefMatrix(BoneIndex);
-			const Vec3 localBonePos = refBoneMatrix.GetAxis(3);
-			Vec3 finalPosition = WorldMat.transform_point(localBonePos * FinalBoneMatrices[BoneIndex]);
-			m_Masses[i].SetPosition(finalPosition);
+		if (curY > 0) {
+			yAxis = (m_Masses[massIdx - m_Width].GetPosition() - m_Masses[massIdx].GetPosition()).normalize_safe();
+		} else {
+			yAxis = (m_Masses[massIdx].GetPosition() - m_Masses[massIdx + m_Width].GetPosition()).normalize_safe();
 		}
 
+		zAxis = xAxis.cross(yAxis).normalize_safe();
+		yAxis = zAxis.cross(xAxis).normalize_safe();
+
+		m_Masses[massIdx].SetAxis(0, xAxis);
+		m_Masses[massIdx].SetAxis(1, yAxis);
+		m_Masses[massIdx].SetAxis(2, zAxis);
+	}
+}
+
+/// kbClothComponent::ApplyToSkeleton
+void kbClothComponent::ApplyToSkeleton() {
+	std::vector<kbBoneMatrix_t>& FinalBoneMatrices = m_pSkelComponent->GetFinalBoneMatrices();
+	if (FinalBoneMatrices.size() == 0) {
+		return;
+	}
+
+	Mat4 WorldMat;
+	GetOwner()->CalculateWorldMatrix(WorldMat);
+
+	// todo: Need my own inverse matrix function
+	Mat4 invParentMatrix;
+	XMMATRIX inverseMat = XMMatrixInverse(nullptr, XMMATRIXFromMat4(WorldMat));
+	invParentMatrix = Mat4FromXMMATRIX(inverseMat);
+
+	for (int i = 0; i < m_Masses.size(); i++) {
+		const int BoneIndex = m_BoneIndices[i];
 
 		const Vec3 worldPos = m_Masses[i].GetPosition();
 		kbBoneMatrix_t WorldToLocalSpace;
@@ -131,11 +367,28 @@ void kbClothComponent::update_internal(const float dt) {
 		WorldToLocalSpace.SetAxis(3, worldPos);
 		WorldToLocalSpace *= invParentMatrix;
 
-		kbBoneMatrix_t LocalToRef = pSkelRenderComponent->GetBoneRefMatrix(BoneIndex);
+		kbBoneMatrix_t LocalToRef = m_pSkelComponent->GetBoneRefMatrix(BoneIndex);
 		LocalToRef.Invert();
 		FinalBoneMatrices[BoneIndex] = LocalToRef * WorldToLocalSpace;
+	}
+}
+
+/// kbClothComponent::DrawDebug
+void kbClothComponent::DrawDebug() {
+	static int clothDebug = 0;
+
+	/*if ( GetAsyncKeyState( 'I') ) {
+		clothDebug = 0;
+	} else if ( GetAsyncKeyState( 'O') ) {
+		clothDebug = 1;
+	} else if ( GetAsyncKeyState( 'P') ) {
+		clothDebug = 2;
+	}*/
+
+	if (clothDebug == 1 || g_DebugCloth.GetInt() == 1) {
+		for (int i = 0; i < m_Masses.size(); i++) {
+			const Vec3 worldPos = m_Masses[i].GetPosition();
 
-		if (clothDebug == 1 || g_DebugCloth.GetInt() == 1) {
 			kbBounds bounds(true);
 			bounds.AddPoint(worldPos);
 			bounds.AddPoint(worldPos + Vec3(0.1f, 0.1f, 0.1f));
@@ -154,7 +407,6 @@ void kbClothComponent::update_internal(const float dt) {
 		}
 	}
 
-
 	if (clothDebug == 2 || g_DebugCloth.GetInt() == 2) {
 		for (int i = 0; i < m_Springs.size(); i++) {
 			const kbClothSpring_t& curSpring = m_Springs[i];
@@ -198,9 +450,7 @@ void kbClothComponent::update_internal(const float dt) {
 				blk::log("%f %f %f", m_CollisionSpheres[iCollision].m_Sphere.x, m_CollisionSpheres[iCollision].m_Sphere.y, m_CollisionSpheres[iCollision].m_Sphere.z);
 			}
 
-			//		blk::log( "%s looking for %s", pSkelRenderComponent->model()->GetFullFileName().c_str(), m_CollisionSpheres[iCollision].m_BoneName.c_str() );
-
-			if (pSkelRenderComponent->GetBoneWorldMatrix(m_CollisionSpheres[iCollision].m_BoneName, boneWorldMatrix)) {
+			if (m_pSkelComponent->GetBoneWorldMatrix(m_CollisionSpheres[iCollision].m_BoneName, boneWorldMatrix)) {
 				boneWorldMatrix.m_Axis[0].normalize_self();
 				boneWorldMatrix.m_Axis[1].normalize_self();
 				boneWorldMatrix.m_Axis[2].normalize_self();
@@ -209,223 +459,18 @@ void kbClothComponent::update_internal(const float dt) {
 				g_pRenderer->DrawSphere(spherePos, m_CollisionSpheres[iCollision].m_Sphere.w, 12, kbColor(1.0f, 0.0f, 1.0f, 1.0f));
 			}
 		}
-	}
-}
-
-/// kbClothComponent::RunSimulation
-void kbClothComponent::RunSimulation(const float inDeltaTime) {
-
-	const float DeltaTime = kbClamp(inDeltaTime, 0.0f, 0.016f);
-
-	if (m_bAddFakeOscillation) {
-
-		if (g_GlobalTimer.TimeElapsedSeconds() >= m_NextWindChangeTime) {
-			m_NextWindChangeTime = g_GlobalTimer.TimeElapsedSeconds() + (kbfrand() * (m_MaxWindGustDuration - m_MinWindGustDuration)) + m_MinWindGustDuration;
-			m_NextWindVelocity = Vec3Rand(m_MinWindVelocity, m_MaxWindVelocity);
-		}
-
-		m_CurWindVelocity = kbLerp(m_CurWindVelocity, m_NextWindVelocity, 0.0075f);
-	}
-
-
-	// Wind Sim
-
-	Vec3 wind = m_CurWindVelocity;
-
 
-	static Vec3 BallPos(0.0f, -35.0f, 0.0f);
-	static Vec3 BallDir(0.0f, 0.0f, 1.0f);
-	static float BallRad = 65;
-
-	// Ball Sim
-	/*BallPos = BallPos + BallDir * DeltaTime * 124.0f;
-	if ( BallDir.z > 0 && BallPos.z > 200.0f )
-		BallDir.z = -1.0f;
-	else if ( BallDir.z < 0 && BallPos.z < -200.0f )
-		BallDir.z = 1.0f;
-
-	kbBounds bounds( true );
-	bounds.AddPoint( BallPos ),
-	bounds.AddPoint( BallPos + Vec3( 1.0f, 1.0f, 1.0f ).normalize_safe() * BallRad );
-	bounds.AddPoint( BallPos - ( Vec3( 1.0f, 1.0f, 1.0f ).normalize_safe() * BallRad ) );
-
-	std::vector<Vec4> CollisionSpheres;
-	Vec4 newSphere( BallPos.x, BallPos.y, BallPos.z, 1.0f );
-	newSphere.w = BallRad;
-	CollisionSpheres.push_back( newSphere );
-
-	g_pRenderer->DrawSphere( BallPos, BallRad, 16, kbColor::yellow);*/
-	// Ball Sim - end
-
-	SkeletalModelComponent* pSkelRenderComponent = NULL;
-	for (int i = 0; i < GetOwner()->NumComponents(); i++) {
-		if (GetOwner()->GetComponent(i)->IsA(SkeletalModelComponent::GetType())) {
-			pSkelRenderComponent = static_cast<SkeletalModelComponent*>(GetOwner()->GetComponent(i));
-			if (pSkelRenderComponent->model() != m_pSkeletalModel) {
-				break;
-			}
+		for (int iCollision = 0; iCollision < m_WorldCollisionCapsules.size(); iCollision++) {
+			const kbClothCapsule_t& capsule = m_WorldCollisionCapsules[iCollision];
+			g_pRenderer->DrawSphere(capsule.m_Start, capsule.m_Radius, 12, kbColor(1.0f, 0.0f, 1.0f, 1.0f));
+			g_pRenderer->DrawSphere(capsule.m_End, capsule.m_Radius, 12, kbColor(1.0f, 0.0f, 1.0f, 1.0f));
+			g_pRenderer->DrawLine(capsule.m_Start, capsule.m_End, kbColor(1.0f, 0.0f, 1.0f, 1.0f));
 		}
-	}
-
-	std::vector<Vec4> CollisionSpheres;
-	for (int iCollision = 0; iCollision < m_CollisionSpheres.size(); iCollision++) {
-		kbBoneMatrix_t boneWorldMatrix;
-		if (pSkelRenderComponent->GetBoneWorldMatrix(m_CollisionSpheres[iCollision].m_BoneName, boneWorldMatrix)) {
-			boneWorldMatrix.m_Axis[0].normalize_self();
-			boneWorldMatrix.m_Axis[1].normalize_self();
-			boneWorldMatrix.m_Axis[2].normalize_self();
-
-			const Vec3 spherePos = m_CollisionSpheres[iCollision].m_Sphere.ToVec3() * boneWorldMatrix;
-			CollisionSpheres.push_back(Vec4(spherePos, m_CollisionSpheres[iCollision].m_Sphere.w));
-		}
-	}
-
-	// Apply forces and update positions
-	std::vector<float> a;
-	for (int i = 0; i < m_Width; i++) {
-		float theRand = kbfrand();
-
-		a.push_back(theRand);
-		a.push_back(theRand);
-		a.push_back(theRand);
-
-	}
-
-	float theRand = 0.0f;
-	for (int massIdx = 0; massIdx < m_Masses.size(); massIdx++) {
-		if (m_Masses[massIdx].m_bAnchored) {
-			m_Masses[massIdx].m_FrameForces = Vec3::zero;
-			continue;
-		}
-
-		Vec3 totalForce = m_gravity + Vec3(0.0f, g_ClothGrav.GetFloat(), 0.0f);
-		if (m_bAddFakeOscillation) {
-
-			Vec3 windAmt = ((wind - (wind * 0.5f) * kbfrand() + (wind * 0.5f)));
-			int level = massIdx / m_Height;
-
-			if (massIdx % 1 == 0) {
-				theRand = kbfrand();
-			}
-			if (a[massIdx / m_Width] < 0.45f) {
-				windAmt *= 1.3f + kbfrand() * 1.35f;
-			}
-			totalForce += windAmt;
-		}
-		totalForce += m_Masses[massIdx].m_FrameForces;
-		Vec3 newLocation = m_Masses[massIdx].GetPosition();// + ( totalForce * DeltaTime );
-
-		// ...
-		/*for ( int sphereIdx = 0; sphereIdx < CollisionSpheres.size(); sphereIdx++ ) {
-			const Vec3 sphereToVert = newLocation - CollisionSpheres[sphereIdx].ToVec3();
-			if ( sphereToVert.length_sqr() < ( CollisionSpheres[sphereIdx].w * CollisionSpheres[sphereIdx].w) ) {
-				newLocation = CollisionSpheres[sphereIdx].ToVec3() + sphereToVert.normalize_safe() * CollisionSpheres[sphereIdx].w;
-			}
-		}*/
-		// ...
-
-		Vec3 velocity = m_Masses[massIdx].GetPosition() - m_Masses[massIdx].m_LastPosition;
-		m_Masses[massIdx].m_LastPosition = m_Masses[massIdx].GetPosition();
-
-		newLocation += velocity * (1.0f - g_ClothFriction.GetFloat()) + totalForce * (DeltaTime * DeltaTime);
-		m_Masses[massIdx].SetPosition(newLocation);
-		m_Masses[massIdx].m_FrameForces = Vec3::zero;
-	}
-
-	for (int iIteration = 0; iIteration < m_NumConstrainIterations; iIteration++) {
-
-		// Apply constraints
-		for (int iSpring = 0; iSpring < m_Springs.size(); iSpring++) {
-			const int mass1Idx = m_Springs[iSpring].m_MassIndices[0];
-			const int mass2Idx = m_Springs[iSpring].m_MassIndices[1];
-
-			const Vec3 mass1Pos = m_Masses[mass1Idx].GetPosition();
-			const Vec3 mass2Pos = m_Masses[mass2Idx].GetPosition();
-
-			const Vec3 mass1ToMass2 = mass2Pos - mass1Pos;
-			const float distanceBetween = mass1ToMass2.length();
-			const float invDist = (distanceBetween > 0.001f) ? (1.0f / distanceBetween) : (0.0f);
-			Vec3 finalOffset = ((mass1ToMass2 * invDist) * (distanceBetween - m_Springs[iSpring].m_Length)) * g_ClothSpring.GetFloat();
-
-			if (m_Masses[mass1Idx].m_bAnchored || m_Masses[mass2Idx].m_bAnchored) {
-				finalOffset *= 2.0f;
-			}
-
-			if (m_Masses[mass1Idx].m_bAnchored == false) {
-				m_Masses[mass1Idx].SetPosition(mass1Pos + (finalOffset * 0.5f));
-			}
-
-			if (m_Masses[mass2Idx].m_bAnchored == false) {
-				m_Masses[mass2Idx].SetPosition(mass2Pos - (finalOffset * 0.5f));
-			}
-		}
-
-		// Apply collisions
-		for (int massIdx = 0; massIdx < m_Masses.size(); massIdx++) {
-			if (m_Masses[massIdx].m_bAnchored)
-				continue;
-
-			Vec3 newLocation = m_Masses[massIdx].GetPosition();
-
-			for (int sphereIdx = 0; sphereIdx < CollisionSpheres.size(); sphereIdx++) {
-				const Vec3 sphereToVert = newLocation - CollisionSpheres[sphereIdx].ToVec3();
-				const float	 lenSqr = sphereToVert.length_sqr();
-				const float W = CollisionSpheres[sphereIdx].w;
-				if (lenSqr < W * W) {
-					newLocation = CollisionSpheres[sphereIdx].ToVec3() + sphereToVert.normalize_safe() * (CollisionSpheres[sphereIdx].w);
-				}
-			}
 
-			m_Masses[massIdx].SetPosition(newLocation);
+		for (int iMesh = 0; iMesh < m_WorldMeshColliders.size(); iMesh++) {
+			g_pRenderer->DrawBox(m_WorldMeshColliders[iMesh].m_WorldBounds, kbColor(1.0f, 0.0f, 1.0f, 1.0f));
 		}
 	}
-
-	// Apply collisions
-	for (int massIdx = 0; massIdx < m_Masses.size(); massIdx++) {
-		if (m_Masses[massIdx].m_bAnchored)
-			continue;
-
-		Vec3 newLocation = m_Masses[massIdx].GetPosition();
-
-		for (int sphereIdx = 0; sphereIdx < CollisionSpheres.size(); sphereIdx++) {
-			const Vec3 sphereToVert = newLocation - CollisionSpheres[sphereIdx].ToVec3();
-			const float	 lenSqr = sphereToVert.length_sqr();
-			const float W = CollisionSpheres[sphereIdx].w;
-			if (lenSqr < W * W) {
-				newLocation = CollisionSpheres[sphereIdx].ToVec3() + sphereToVert.normalize_safe() * (CollisionSpheres[sphereIdx].w);
-			}
-		}
-
-		m_Masses[massIdx].SetPosition(newLocation);
-	}
-
-	// Update orientation
-	for (size_t massIdx = 0; massIdx < m_BoneInfo.size(); massIdx++) {
-		const size_t curX = massIdx % (size_t)m_Width;
-		const size_t curY = massIdx / (size_t)m_Width;
-		Vec3 xAxis;
-		Vec3 yAxis;
-		Vec3 zAxis;
-
-		if (curX < (size_t)m_Width - 1) {
-			xAxis = (m_Masses[massIdx + 1].GetPosition() - m_Masses[massIdx].GetPosition()).normalize_safe();
-		} else {
-			xAxis = (m_Masses[massIdx].GetPosition() - m_Masses[massIdx - 1].GetPosition()).normalize_safe();
-		}
-
-		if (curY > 0) {
-			yAxis = (m_Masses[massIdx - m_Width].GetPosition() - m_Masses[massIdx].GetPosition()).normalize_safe();
-		} else {
-			yAxis = (m_Masses[massIdx].GetPosition() - m_Masses[massIdx + m_Width].GetPosition()).normalize_safe();
-		}
-
-		zAxis = xAxis.cross(yAxis).normalize_safe();
-		yAxis = zAxis.cross(xAxis).normalize_safe();
-
-		m_Masses[massIdx].SetAxis(0, xAxis);
-		m_Masses[massIdx].SetAxis(1, yAxis);
-		m_Masses[massIdx].SetAxis(2, zAxis);
-	}
 }
 
 /// kbClothComponent::SetupCloth
@@ -475,7 +520,6 @@ void kbClothComponent::SetupCloth() {
 		m_Masses[i].m_Matrix.SetAxis(0, Vec3(1.0f, 0.0f, 0.0f));
 		m_Masses[i].m_Matrix.SetAxis(1, Vec3(0.0f, 1.0f, 0.0f));
 		m_Masses[i].m_Matrix.SetAxis(2, Vec3(0.0f, 0.0f, 1.0f));
-		m_Masses[i].m_LastPosition = m_Masses[i].GetPosition();
 
 		if (i < m_Width) {
 			m_Masses[i].m_bAnchored = true;
@@ -492,7 +536,6 @@ void kbClothComponent::SetupCloth() {
 		m_Masses[curIdx].m_Matrix.SetAxis(0, Vec3(1.0f, 0.0f, 0.0f));
 		m_Masses[curIdx].m_Matrix.SetAxis(1, Vec3(0.0f, 1.0f, 0.0f));
 		m_Masses[curIdx].m_Matrix.SetAxis(2, Vec3(0.0f, 0.0f, 1.0f));
-		m_Masses[i].m_LastPosition = m_Masses[i].GetPosition();
 
 		m_Masses[curIdx].m_bAnchored = m_AdditionalBoneInfo[i].m_bIsAnchored;
 	}
@@ -572,6 +615,17 @@ void kbClothComponent::SetupCloth() {
 			newSpring.m_Length = (m_Masses[curBoneIdx].m_Matrix.GetOrigin() - m_Masses[newSpring.m_MassIndices[1]].m_Matrix.GetOrigin()).length();
 		}
 	}
+
+	// Hand the masses and springs to the solver.  Masses in the same row share wind gusts
+	m_Solver.Reset();
+	for (int i = 0; i < m_Masses.size(); i++) {
+		m_Solver.AddMass(m_Masses[i].GetPosition(), m_Masses[i].m_bAnchored, (m_Width > 0) ? (i / m_Width) : (0));
+	}
+
+	for (int i = 0; i < m_Springs.size(); i++) {
+		m_Solver.AddSpring(m_Springs[i].m_MassIndices[0], m_Springs[i].m_MassIndices[1], m_Springs[i].m_Length);
+	}
+	m_Solver.Finalize();
 }
 
 /// kbClothComponent::SetClothCollisionSphere
@@ -583,3 +637,90 @@ void kbClothComponent::SetClothCollisionSphere(const int idx, const Vec4& sphere
 
 	m_CollisionSpheres[idx].m_Sphere = sphere;
 }
+
+/// kbClothComponent::SimulatePendingCloth
+void kbClothComponent::SimulatePendingCloth() {
+	START_SCOPED_TIMER(CLOTH_SIMULATION);
+
+	const size_t numPending = g_PendingClothComponents.size();
+	if (numPending == 0) {
+		return;
+	}
+
+	// Cloth on the same skeleton reads and writes the same bone matrices, so each skeleton's cloth is simulated in
+	// request order by a single job.  Otherwise a component only writes to its own solver
+	std::stable_sort(g_PendingClothComponents.begin(), g_PendingClothComponents.end(),
+		[](const kbClothComponent* const pA, const kbClothComponent* const pB) { return pA->m_pSkelComponent < pB->m_pSkelComponent; });
+
+	g_PendingClothSkeletons.clear();
+	for (size_t i = 0; i < numPending; i++) {
+		if (g_PendingClothSkeletons.empty() || g_PendingClothSkeletons.back().m_pComponents[0]->m_pSkelComponent != g_PendingClothComponents[i]->m_pSkelComponent) {
+			g_PendingClothSkeletons.push_back({ &g_PendingClothComponents[i], 0 });
+		}
+		g_PendingClothSkeletons.back().m_NumComponents++;
+	}
+
+	// One batch per job thread plus one for this thread
+	static const size_t MinSkeletonsPerJob = 2;
+	static kbJobBatches<kbPendingClothSkeleton_t> clothJobs;
+
+	clothJobs.Kick(g_PendingClothSkeletons.data(), g_PendingClothSkeletons.size(), MinSkeletonsPerJob, [](kbPendingClothSkeleton_t& skeleton) {
+		for (size_t i = 0; i < skeleton.m_NumComponents; i++) {
+			skeleton.m_pComponents[i]->FinishSimulation();
+		}
+	}, true);
+	clothJobs.Wait();
+
+	g_PendingClothComponents.clear();
+	g_PendingClothSkeletons.clear();
+}
+
+/// kbClothComponent::AddWorldCollider
+void kbClothComponent::AddWorldCollider(const kbStaticModelComponent* const pComponent) {
+	const kbModel* const pModel = pComponent->model();
+	if (pModel == nullptr) {
+		return;
+	}
+
+	kbClothMeshCacheEntry_t& cacheEntry = g_ClothMeshCache[pModel];
+	if (cacheEntry.m_NumRefs == 0) {
+		std::vector<Vec3> vertices;
+		for (size_t iMesh = 0; iMesh < pModel->NumMeshes(); iMesh++) {
+			const std::vector<Vec3>& meshVertices = pModel->GetMeshes()[iMesh].m_Vertices;
+			vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+		}
+		cacheEntry.m_Collider.Build(vertices.data(), (u32)vertices.size());
+
+		if (cacheEntry.m_Collider.IsValid() == false) {
+			blk::warn("kbClothComponent::AddWorldCollider() - %s has no CPU side triangles to collide with", pModel->GetFullFileName().c_str());
+		}
+	}
+	cacheEntry.m_NumRefs++;
+
+	kbClothWorldCollider_t worldCollider;
+	worldCollider.m_pComponent = pComponent;
+	worldCollider.m_pModel = pModel;
+	worldCollider.m_pCollider = &cacheEntry.m_Collider;
+	g_ClothWorldColliders.push_back(worldCollider);
+}
+
+/// kbClothComponent::RemoveWorldCollider
+void kbClothComponent::RemoveWorldCollider(const kbStaticModelComponent* const pComponent) {
+	for (size_t i = 0; i < g_ClothWorldColliders.size(); i++) {
+		if (g_ClothWorldColliders[i].m_pComponent != pComponent) {
+			continue;
+		}
+
+		auto cacheIt = g_ClothMeshCache.find(g_ClothWorldColliders[i].m_pModel);
+		if (cacheIt != g_ClothMeshCache.end()) {
+			cacheIt->second.m_NumRefs--;
+			if (cacheIt->second.m_NumRefs == 0) {
+				g_ClothMeshCache.erase(cacheIt);
+			}
+		}
+
+		g_ClothWorldColliders[i] = g_ClothWorldColliders.back();
+		g_ClothWorldColliders.pop_back();
+		return;
+	}
+}
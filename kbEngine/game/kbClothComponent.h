@@ -6,6 +6,10 @@
 
 #include "kbComponent.h"
 #include "kbRenderer_defs.h"
+#include "kbClothSolver.h"
+
+class SkeletalModelComponent;
+class kbStaticModelComponent;
 
 /// EClothType
 enum EClothType {
@@ -21,7 +25,7 @@ struct kbClothSpring_t {
 
 /// kbClothMass_t
 struct kbClothMass_t {
-	kbClothMass_t() : m_LastPosition(Vec3::zero), m_FrameForces(Vec3::zero), m_bAnchored(false) { }
+	kbClothMass_t() : m_bAnchored(false) { }
 
 	const Vec3& GetPosition() const { return m_Matrix.GetOrigin(); }
 	const Vec3& GetAxis(const int index) const { return m_Matrix.GetAxis(index); }
@@ -30,8 +34,6 @@ struct kbClothMass_t {
 	void SetAxis(const int index, const Vec3& axis) { m_Matrix.SetAxis(index, axis); }
 
 	kbBoneMatrix_t m_Matrix;
-	Vec3 m_LastPosition;
-	Vec3 m_FrameForces;
 	bool m_bAnchored;
 };
 
@@ -60,19 +62,34 @@ public:
 	const std::vector<kbClothMass_t>& GetMasses() const { return m_Masses; }
 	const std::vector<kbClothSpring_t>& GetSprings() const { return m_Springs; }
 
-	void										AddForceToMass(const int massIdx, const Vec3& force) { m_Masses[massIdx].m_FrameForces += force; }
+	void										AddForceToMass(const int massIdx, const Vec3& force) { if (massIdx >= 0 && massIdx < (int)m_Solver.NumMasses()) { m_Solver.AddForce(massIdx, force); } }
 
 	void										SetClothCollisionSphere(const int idx, const Vec4& sphere);
 
+	/// Simulations requested during update are run here, spread across the job threads.  Call once all entities have
+	/// updated and skeletal poses have been evaluated
+	static void									SimulatePendingCloth();
+
+	/// Static models flagged as cloth colliders register here.  Their triangles are shared by every component using the same model
+	static void									AddWorldCollider(const kbStaticModelComponent* const pComponent);
+	static void									RemoveWorldCollider(const kbStaticModelComponent* const pComponent);
+
 protected:
 
 	virtual void								RunSimulation(const float DeltaTime);
 
 private:
-
 	virtual void								update_internal(const float DeltaTime) override;
 
 	void										SetupCloth();
+	void										GatherColliders();
+	void										UpdateWind();
+	void										DrawDebug();
+
+	void										RequestSimulation();
+	void										FinishSimulation() { if (m_bSimulationPending) { Simulate(); } }
+	void										Simulate();
+	void										ApplyToSkeleton();
 
 	int											m_Width;
 	int											m_Height;
@@ -81,6 +98,10 @@ private:
 	std::vector<class kbClothBone>				m_BoneInfo;
 	std::vector<class kbClothBone>				m_AdditionalBoneInfo;
 	std::vector<class kbBoneCollisionSphere>	m_CollisionSpheres;
+	std::vector<class kbBoneCollisionCapsule>	m_CollisionCapsules;
+	float										m_CollisionThickness;
+	float										m_SelfCollisionDistance;		// Keep below the spacing between bones.  0 turns self collision off
+	bool										m_bCollideWithWorld;
 	int											m_NumConstrainIterations;
 
 	Vec3										m_gravity;
@@ -98,6 +119,14 @@ private:
 	float										m_NextWindChangeTime;
 
 	const kbModel* m_pSkeletalModel;
+	SkeletalModelComponent*						m_pSkelComponent;
+
+	kbClothSolver								m_Solver;
+	std::vector<Vec4>							m_WorldCollisionSpheres;
+	std::vector<kbClothCapsule_t>				m_WorldCollisionCapsules;
+	std::vector<kbClothMeshInstance_t>			m_WorldMeshColliders;
+	float										m_PendingDeltaTime;
+	bool										m_bSimulationPending;
 
 	std::vector<int>							m_BoneIndices;
 	std::vector<kbClothMass_t>					m_Masses;
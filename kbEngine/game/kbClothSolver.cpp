@@ -0,0 +1,704 @@
+/// kbClothSolver.cpp
+///
+/// 2025 blk 1.0
+
+#include <xmmintrin.h>
+#include "blk_core.h"
+#include "kbClothSolver.h"
+
+/// HashNoise - [0, 1) from two integers.  Deterministic and thread safe, unlike kbfrand()
+static f32 HashNoise(const u32 a, const u32 b) {
+	u32 h = (a * 0x9E3779B1u) ^ ((b + 0x7F4A7C15u) * 0x85EBCA77u);
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+	return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+/// kbClothSolver::Reset
+void kbClothSolver::Reset() {
+	for (u32 i = 0; i < CS_NumStreams; i++) {
+		m_Streams[i].clear();
+	}
+	m_WindGroups.clear();
+	m_SpringA.clear();
+	m_SpringB.clear();
+	m_RestLength.clear();
+	m_WeightA.clear();
+	m_WeightB.clear();
+	m_BatchStarts.clear();
+
+	m_NumMasses = 0;
+	m_NumStreamMasses = 0;
+	m_NumSprings = 0;
+	m_TimeAccumulator = 0.0f;
+	m_StepCount = 0;
+}
+
+/// kbClothSolver::AddMass
+u32 kbClothSolver::AddMass(const Vec3& position, const bool bAnchored, const u32 windGroup) {
+	blk::error_check(m_BatchStarts.size() == 0, "kbClothSolver::AddMass() - Solver is already finalized");
+
+	const f32 values[CS_NumStreams] = {
+		position.x, position.y, position.z,
+		position.x, position.y, position.z,
+		position.x, position.y, position.z,
+		0.0f, 0.0f, 0.0f,
+		bAnchored ? 0.0f : 1.0f
+	};
+	for (u32 i = 0; i < CS_NumStreams; i++) {
+		m_Streams[i].push_back(values[i]);
+	}
+	m_WindGroups.push_back(windGroup);
+
+	return m_NumMasses++;
+}
+
+/// kbClothSolver::AddSpring
+void kbClothSolver::AddSpring(const u32 massA, const u32 massB, const f32 restLength) {
+	blk::error_check(m_BatchStarts.size() == 0, "kbClothSolver::AddSpring() - Solver is already finalized");
+	blk::error_check(massA < m_NumMasses && massB < m_NumMasses && massA != massB, "kbClothSolver::AddSpring() - Invalid masses %u and %u", massA, massB);
+
+	m_SpringA.push_back(massA);
+	m_SpringB.push_back(massB);
+	m_RestLength.push_back(restLength);
+	m_NumSprings++;
+}
+
+/// kbClothSolver::Finalize
+void kbClothSolver::Finalize() {
+
+	// One dummy mass for the padding springs, then pad to a multiple of four.  Padding has an inverse mass of 0 so
+	// that the SIMD loops leave it alone
+	const u32 dummyMass = m_NumMasses;
+	m_NumStreamMasses = (m_NumMasses + 1 + 3) & ~3u;
+	for (u32 i = 0; i < CS_NumStreams; i++) {
+		m_Streams[i].resize(m_NumStreamMasses, 0.0f);
+	}
+	m_WindGroups.resize(m_NumStreamMasses, 0);
+
+	// Greedy colouring.  Each spring takes the lowest colour neither of its masses has used yet
+	std::vector<u64> usedColours(m_NumMasses, 0);
+	std::vector<u32> springColours(m_NumSprings);
+	u32 numColours = 0;
+	for (u32 i = 0; i < m_NumSprings; i++) {
+		const u64 used = usedColours[m_SpringA[i]] | usedColours[m_SpringB[i]];
+		u32 colour = 0;
+		while (colour < 64 && (used & (1ull << colour)) != 0) {
+			colour++;
+		}
+		blk::error_check(colour < 64, "kbClothSolver::Finalize() - Mass %u or %u has too many springs", m_SpringA[i], m_SpringB[i]);
+
+		usedColours[m_SpringA[i]] |= 1ull << colour;
+		usedColours[m_SpringB[i]] |= 1ull << colour;
+		springColours[i] = colour;
+		numColours = max(numColours, colour + 1);
+	}
+
+	// Springs' masses are excluded from self collision, and their average length sizes the collision hash's cells
+	m_NeighborStarts.assign(m_NumMasses + 1, 0);
+	f32 totalRestLength = 0.0f;
+	for (u32 i = 0; i < m_NumSprings; i++) {
+		m_NeighborStarts[m_SpringA[i]]++;
+		m_NeighborStarts[m_SpringB[i]]++;
+		totalRestLength += m_RestLength[i];
+	}
+	for (u32 i = 1; i <= m_NumMasses; i++) {
+		m_NeighborStarts[i] += m_NeighborStarts[i - 1];
+	}
+	m_Neighbors.resize(m_NumSprings * 2);
+	for (u32 i = 0; i < m_NumSprings; i++) {
+		m_Neighbors[--m_NeighborStarts[m_SpringA[i]]] = m_SpringB[i];
+		m_Neighbors[--m_NeighborStarts[m_SpringB[i]]] = m_SpringA[i];
+	}
+	m_RestCellSize = (m_NumSprings > 0) ? (max(totalRestLength / m_NumSprings, 0.001f)) : (1.0f);
+
+	m_HashSize = 16;
+	while (m_HashSize < m_NumMasses * 2) {
+		m_HashSize *= 2;
+	}
+	m_HashStarts.assign(m_HashSize + 1, 0);
+	m_HashMasses.resize(m_NumMasses);
+	m_MassBuckets.resize(m_NumMasses);
+	m_BucketStamps.assign(m_HashSize, 0);
+	m_Stamp = 0;
+
+	// Sort into batches
+	const std::vector<u32> springA = m_SpringA;
+	const std::vector<u32> springB = m_SpringB;
+	const std::vector<f32> restLength = m_RestLength;
+	m_SpringA.clear();
+	m_SpringB.clear();
+	m_RestLength.clear();
+	m_WeightA.clear();
+	m_WeightB.clear();
+	m_BatchStarts.clear();
+
+	const f32* const pInvMass = m_Streams[CS_InvMass].data();
+	for (u32 colour = 0; colour < numColours; colour++) {
+		m_BatchStarts.push_back((u32)m_SpringA.size());
+
+		for (u32 i = 0; i < m_NumSprings; i++) {
+			if (springColours[i] != colour) {
+				continue;
+			}
+
+			// A spring with one anchored end moves only the other one.  Springs between two anchors do nothing
+			const f32 invMassSum = pInvMass[springA[i]] + pInvMass[springB[i]];
+			m_SpringA.push_back(springA[i]);
+			m_SpringB.push_back(springB[i]);
+			m_RestLength.push_back(restLength[i]);
+			m_WeightA.push_back((invMassSum > 0.0f) ? (pInvMass[springA[i]] / invMassSum) : (0.0f));
+			m_WeightB.push_back((invMassSum > 0.0f) ? (pInvMass[springB[i]] / invMassSum) : (0.0f));
+		}
+
+		while ((m_SpringA.size() & 3) != 0) {
+			m_SpringA.push_back(dummyMass);
+			m_SpringB.push_back(dummyMass);
+			m_RestLength.push_back(0.0f);
+			m_WeightA.push_back(0.0f);
+			m_WeightB.push_back(0.0f);
+		}
+	}
+	m_BatchStarts.push_back((u32)m_SpringA.size());
+}
+
+/// kbClothSolver::SetAnchorTarget
+void kbClothSolver::SetAnchorTarget(const u32 idx, const Vec3& position) {
+	m_Streams[CS_AnchorTargetX][idx] = position.x;
+	m_Streams[CS_AnchorTargetY][idx] = position.y;
+	m_Streams[CS_AnchorTargetZ][idx] = position.z;
+}
+
+/// kbClothSolver::AddForce
+void kbClothSolver::AddForce(const u32 idx, const Vec3& force) {
+	m_Streams[CS_ForceX][idx] += force.x;
+	m_Streams[CS_ForceY][idx] += force.y;
+	m_Streams[CS_ForceZ][idx] += force.z;
+}
+
+/// kbClothSolver::SetCollisionSpheres
+void kbClothSolver::SetCollisionSpheres(const Vec4* const pSpheres, const u32 numSpheres) {
+	if (m_Spheres.size() < numSpheres) {
+		m_Spheres.resize(numSpheres);
+	}
+
+	for (u32 i = 0; i < numSpheres; i++) {
+		m_Spheres[i] = pSpheres[i];
+	}
+	m_NumSpheres = numSpheres;
+}
+
+/// kbClothSolver::SetCollisionCapsules
+void kbClothSolver::SetCollisionCapsules(const kbClothCapsule_t* const pCapsules, const u32 numCapsules) {
+	if (m_Capsules.size() < numCapsules) {
+		m_Capsules.resize(numCapsules);
+	}
+
+	for (u32 i = 0; i < numCapsules; i++) {
+		m_Capsules[i] = pCapsules[i];
+	}
+	m_NumCapsules = numCapsules;
+}
+
+/// kbClothSolver::SetMeshColliders
+void kbClothSolver::SetMeshColliders(const kbClothMeshInstance_t* const pMeshes, const u32 numMeshes) {
+	if (m_Meshes.size() < numMeshes) {
+		m_Meshes.resize(numMeshes);
+	}
+
+	for (u32 i = 0; i < numMeshes; i++) {
+		m_Meshes[i] = pMeshes[i];
+	}
+	m_NumMeshes = numMeshes;
+}
+
+/// kbClothSolver::Advance
+u32 kbClothSolver::Advance(const f32 deltaTime, const kbClothSolverParams_t& params) {
+	if (m_NumMasses == 0 || m_BatchStarts.size() == 0 || params.m_FixedTimeStep <= 0.0f) {
+		return 0;
+	}
+
+	m_NumCollisionTests = 0;
+	m_TimeAccumulator += max(deltaTime, 0.0f);
+	u32 numSteps = (u32)(m_TimeAccumulator / params.m_FixedTimeStep);
+	if (numSteps > MaxSubsteps) {
+		numSteps = MaxSubsteps;
+		m_TimeAccumulator = 0.0f;
+	} else {
+		m_TimeAccumulator -= numSteps * params.m_FixedTimeStep;
+	}
+
+	f32* const pPosX = m_Streams[CS_PositionX].data();
+	f32* const pPosY = m_Streams[CS_PositionY].data();
+	f32* const pPosZ = m_Streams[CS_PositionZ].data();
+	f32* const pPrevX = m_Streams[CS_PrevPositionX].data();
+	f32* const pPrevY = m_Streams[CS_PrevPositionY].data();
+	f32* const pPrevZ = m_Streams[CS_PrevPositionZ].data();
+	const f32* const pInvMass = m_Streams[CS_InvMass].data();
+
+	if (numSteps > 0) {
+		// Anchors lerp from where they are now to their targets across the steps
+		for (u32 i = 0; i < m_NumMasses; i++) {
+			if (pInvMass[i] == 0.0f) {
+				pPrevX[i] = pPosX[i];
+				pPrevY[i] = pPosY[i];
+				pPrevZ[i] = pPosZ[i];
+			}
+		}
+
+		for (u32 iStep = 0; iStep < numSteps; iStep++) {
+			Step(params, (f32)(iStep + 1) / numSteps);
+		}
+	}
+
+	m_Streams[CS_ForceX].assign(m_NumStreamMasses, 0.0f);
+	m_Streams[CS_ForceY].assign(m_NumStreamMasses, 0.0f);
+	m_Streams[CS_ForceZ].assign(m_NumStreamMasses, 0.0f);
+	return numSteps;
+}
+
+/// kbClothSolver::Step
+void kbClothSolver::Step(const kbClothSolverParams_t& params, const f32 anchorT) {
+	f32* const pPosX = m_Streams[CS_PositionX].data();
+	f32* const pPosY = m_Streams[CS_PositionY].data();
+	f32* const pPosZ = m_Streams[CS_PositionZ].data();
+	f32* const pPrevX = m_Streams[CS_PrevPositionX].data();
+	f32* const pPrevY = m_Streams[CS_PrevPositionY].data();
+	f32* const pPrevZ = m_Streams[CS_PrevPositionZ].data();
+	const f32* const pTargetX = m_Streams[CS_AnchorTargetX].data();
+	const f32* const pTargetY = m_Streams[CS_AnchorTargetY].data();
+	const f32* const pTargetZ = m_Streams[CS_AnchorTargetZ].data();
+	const f32* const pForceX = m_Streams[CS_ForceX].data();
+	const f32* const pForceY = m_Streams[CS_ForceY].data();
+	const f32* const pForceZ = m_Streams[CS_ForceZ].data();
+	const f32* const pInvMass = m_Streams[CS_InvMass].data();
+
+	const f32 dtSqr = params.m_FixedTimeStep * params.m_FixedTimeStep;
+	const __m128 dtSqr4 = _mm_set1_ps(dtSqr);
+	const __m128 keep = _mm_set1_ps(1.0f - params.m_Damping);
+	const __m128 gravityX = _mm_set1_ps(params.m_Gravity.x);
+	const __m128 gravityY = _mm_set1_ps(params.m_Gravity.y);
+	const __m128 gravityZ = _mm_set1_ps(params.m_Gravity.z);
+
+	// Integrate.  Anchors and padding have an inverse mass of 0, which zeroes their move and keeps their previous position
+	for (u32 i = 0; i < m_NumStreamMasses; i += 4) {
+		const __m128 invMass = _mm_loadu_ps(pInvMass + i);
+		const __m128 posX = _mm_loadu_ps(pPosX + i);
+		const __m128 posY = _mm_loadu_ps(pPosY + i);
+		const __m128 posZ = _mm_loadu_ps(pPosZ + i);
+		const __m128 prevX = _mm_loadu_ps(pPrevX + i);
+		const __m128 prevY = _mm_loadu_ps(pPrevY + i);
+		const __m128 prevZ = _mm_loadu_ps(pPrevZ + i);
+
+		const __m128 moveX = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(posX, prevX), keep), _mm_mul_ps(_mm_add_ps(gravityX, _mm_loadu_ps(pForceX + i)), dtSqr4));
+		const __m128 moveY = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(posY, prevY), keep), _mm_mul_ps(_mm_add_ps(gravityY, _mm_loadu_ps(pForceY + i)), dtSqr4));
+		const __m128 moveZ = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(posZ, prevZ), keep), _mm_mul_ps(_mm_add_ps(gravityZ, _mm_loadu_ps(pForceZ + i)), dtSqr4));
+
+		_mm_storeu_ps(pPrevX + i, _mm_add_ps(prevX, _mm_mul_ps(_mm_sub_ps(posX, prevX), invMass)));
+		_mm_storeu_ps(pPrevY + i, _mm_add_ps(prevY, _mm_mul_ps(_mm_sub_ps(posY, prevY), invMass)));
+		_mm_storeu_ps(pPrevZ + i, _mm_add_ps(prevZ, _mm_mul_ps(_mm_sub_ps(posZ, prevZ), invMass)));
+		_mm_storeu_ps(pPosX + i, _mm_add_ps(posX, _mm_mul_ps(moveX, invMass)));
+		_mm_storeu_ps(pPosY + i, _mm_add_ps(posY, _mm_mul_ps(moveY, invMass)));
+		_mm_storeu_ps(pPosZ + i, _mm_add_ps(posZ, _mm_mul_ps(moveZ, invMass)));
+	}
+
+	// Wind.  Each mass gets 1x to 1.5x of it, and the masses in 45% of the wind groups get a gust on top
+	if (params.m_Wind.length_sqr() > 0.0f) {
+		for (u32 i = 0; i < m_NumMasses; i++) {
+			if (pInvMass[i] == 0.0f) {
+				continue;
+			}
+
+			f32 windScale = 1.5f - 0.5f * HashNoise(i, m_StepCount);
+			const u32 gustSeed = m_WindGroups[i] + 0x10000;
+			if (HashNoise(gustSeed, m_StepCount) < 0.45f) {
+				windScale *= 1.3f + HashNoise(i + 0x20000, m_StepCount) * 1.35f;
+			}
+
+			const f32 windMove = windScale * dtSqr;
+			pPosX[i] += params.m_Wind.x * windMove;
+			pPosY[i] += params.m_Wind.y * windMove;
+			pPosZ[i] += params.m_Wind.z * windMove;
+		}
+	}
+
+	for (u32 i = 0; i < m_NumMasses; i++) {
+		if (pInvMass[i] == 0.0f) {
+			pPosX[i] = kbLerp(pPrevX[i], pTargetX[i], anchorT);
+			pPosY[i] = kbLerp(pPrevY[i], pTargetY[i], anchorT);
+			pPosZ[i] = kbLerp(pPrevZ[i], pTargetZ[i], anchorT);
+		}
+	}
+
+	for (u32 iIteration = 0; iIteration < params.m_NumIterations; iIteration++) {
+		SolveSprings(params.m_Stiffness);
+		SolveCollisions(params);
+	}
+
+	m_StepCount++;
+}
+
+/// kbClothSolver::SolveSprings
+void kbClothSolver::SolveSprings(const f32 stiffness) {
+	f32* const pPosX = m_Streams[CS_PositionX].data();
+	f32* const pPosY = m_Streams[CS_PositionY].data();
+	f32* const pPosZ = m_Streams[CS_PositionZ].data();
+	const u32* const pSpringA = m_SpringA.data();
+	const u32* const pSpringB = m_SpringB.data();
+
+	const __m128 stiffness4 = _mm_set1_ps(stiffness);
+	const __m128 minLength = _mm_set1_ps(0.001f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	alignas(16) f32 outAX[4], outAY[4], outAZ[4], outBX[4], outBY[4], outBZ[4];
+
+	// Springs in a batch share no masses, so the four lanes never write to the same mass.  Batches are solved in
+	// order because they do
+	for (size_t iBatch = 0; iBatch + 1 < m_BatchStarts.size(); iBatch++) {
+		for (u32 i = m_BatchStarts[iBatch]; i < m_BatchStarts[iBatch + 1]; i += 4) {
+			const u32* const a = pSpringA + i;
+			const u32* const b = pSpringB + i;
+
+			const __m128 aX = _mm_set_ps(pPosX[a[3]], pPosX[a[2]], pPosX[a[1]], pPosX[a[0]]);
+			const __m128 aY = _mm_set_ps(pPosY[a[3]], pPosY[a[2]], pPosY[a[1]], pPosY[a[0]]);
+			const __m128 aZ = _mm_set_ps(pPosZ[a[3]], pPosZ[a[2]], pPosZ[a[1]], pPosZ[a[0]]);
+			const __m128 bX = _mm_set_ps(pPosX[b[3]], pPosX[b[2]], pPosX[b[1]], pPosX[b[0]]);
+			const __m128 bY = _mm_set_ps(pPosY[b[3]], pPosY[b[2]], pPosY[b[1]], pPosY[b[0]]);
+			const __m128 bZ = _mm_set_ps(pPosZ[b[3]], pPosZ[b[2]], pPosZ[b[1]], pPosZ[b[0]]);
+
+			const __m128 deltaX = _mm_sub_ps(bX, aX);
+			const __m128 deltaY = _mm_sub_ps(bY, aY);
+			const __m128 deltaZ = _mm_sub_ps(bZ, aZ);
+			const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY)), _mm_mul_ps(deltaZ, deltaZ)));
+
+			// Nearly coincident masses have no direction to push along, so they're left alone
+			const __m128 invLength = _mm_and_ps(_mm_cmpgt_ps(length, minLength), _mm_div_ps(one, _mm_max_ps(length, minLength)));
+			const __m128 correction = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(length, _mm_loadu_ps(&m_RestLength[i])), invLength), stiffness4);
+			const __m128 offsetX = _mm_mul_ps(deltaX, correction);
+			const __m128 offsetY = _mm_mul_ps(deltaY, correction);
+			const __m128 offsetZ = _mm_mul_ps(deltaZ, correction);
+
+			const __m128 weightA = _mm_loadu_ps(&m_WeightA[i]);
+			const __m128 weightB = _mm_loadu_ps(&m_WeightB[i]);
+			_mm_store_ps(outAX, _mm_add_ps(aX, _mm_mul_ps(offsetX, weightA)));
+			_mm_store_ps(outAY, _mm_add_ps(aY, _mm_mul_ps(offsetY, weightA)));
+			_mm_store_ps(outAZ, _mm_add_ps(aZ, _mm_mul_ps(offsetZ, weightA)));
+			_mm_store_ps(outBX, _mm_sub_ps(bX, _mm_mul_ps(offsetX, weightB)));
+			_mm_store_ps(outBY, _mm_sub_ps(bY, _mm_mul_ps(offsetY, weightB)));
+			_mm_store_ps(outBZ, _mm_sub_ps(bZ, _mm_mul_ps(offsetZ, weightB)));
+
+			for (u32 lane = 0; lane < 4; lane++) {
+				pPosX[a[lane]] = outAX[lane];
+				pPosY[a[lane]] = outAY[lane];
+				pPosZ[a[lane]] = outAZ[lane];
+				pPosX[b[lane]] = outBX[lane];
+				pPosY[b[lane]] = outBY[lane];
+				pPosZ[b[lane]] = outBZ[lane];
+			}
+		}
+	}
+}
+
+/// kbClothSolver::BuildMassHash
+void kbClothSolver::BuildMassHash(const f32 cellSize) {
+	const f32* const pPosX = m_Streams[CS_PositionX].data();
+	const f32* const pPosY = m_Streams[CS_PositionY].data();
+	const f32* const pPosZ = m_Streams[CS_PositionZ].data();
+
+	m_InvHashCellSize = 1.0f / cellSize;
+	m_ClothBounds.Reset();
+
+	// Counting sort.  Each bucket's count is summed into its end, then masses are placed walking the ends back to the starts
+	m_HashStarts.assign(m_HashSize + 1, 0);
+	for (u32 i = 0; i < m_NumMasses; i++) {
+		m_ClothBounds.AddPoint(Vec3(pPosX[i], pPosY[i], pPosZ[i]));
+		m_MassBuckets[i] = HashCell(CellCoord(pPosX[i]), CellCoord(pPosY[i]), CellCoord(pPosZ[i]));
+		m_HashStarts[m_MassBuckets[i]]++;
+	}
+
+	for (u32 i = 1; i < m_HashSize; i++) {
+		m_HashStarts[i] += m_HashStarts[i - 1];
+	}
+
+	for (u32 i = 0; i < m_NumMasses; i++) {
+		m_HashMasses[--m_HashStarts[m_MassBuckets[i]]] = i;
+	}
+	m_HashStarts[m_HashSize] = m_NumMasses;
+}
+
+/// kbClothSolver::ForEachMassInBox
+template<typename Func>
+void kbClothSolver::ForEachMassInBox(const Vec3& boxMin, const Vec3& boxMax, Func&& func) {
+	if (m_ClothBounds.IntersectsBounds(kbBounds(boxMin, boxMax)) == false) {
+		return;
+	}
+
+	// Clip to the cloth so that large colliders don't walk empty cells
+	const Vec3& clothMin = m_ClothBounds.Min();
+	const Vec3& clothMax = m_ClothBounds.Max();
+	const i32 minX = CellCoord(max(boxMin.x, clothMin.x)), maxX = CellCoord(min(boxMax.x, clothMax.x));
+	const i32 minY = CellCoord(max(boxMin.y, clothMin.y)), maxY = CellCoord(min(boxMax.y, clothMax.y));
+	const i32 minZ = CellCoord(max(boxMin.z, clothMin.z)), maxZ = CellCoord(min(boxMax.z, clothMax.z));
+	const u64 numCells = (u64)(maxX - minX + 1) * (u64)(maxY - minY + 1) * (u64)(maxZ - minZ + 1);
+
+	if (numCells >= m_HashSize) {
+		for (u32 i = 0; i < m_NumMasses; i++) {
+			func(i);
+		}
+		return;
+	}
+
+	m_Stamp++;
+	if (m_Stamp == 0) {
+		m_BucketStamps.assign(m_HashSize, 0);
+		m_Stamp = 1;
+	}
+
+	for (i32 z = minZ; z <= maxZ; z++) {
+		for (i32 y = minY; y <= maxY; y++) {
+			for (i32 x = minX; x <= maxX; x++) {
+				const u32 bucket = HashCell(x, y, z);
+				if (m_BucketStamps[bucket] == m_Stamp) {
+					continue;
+				}
+				m_BucketStamps[bucket] = m_Stamp;
+
+				for (u32 i = m_HashStarts[bucket]; i < m_HashStarts[bucket + 1]; i++) {
+					func(m_HashMasses[i]);
+				}
+			}
+		}
+	}
+}
+
+/// kbClothSolver::AreNeighbors
+bool kbClothSolver::AreNeighbors(const u32 massA, const u32 massB) const {
+	for (u32 i = m_NeighborStarts[massA]; i < m_NeighborStarts[massA + 1]; i++) {
+		if (m_Neighbors[i] == massB) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// kbClothSolver::PushOutOfSphere
+void kbClothSolver::PushOutOfSphere(const u32 idx, const Vec3& center, const f32 radius) {
+	if (m_Streams[CS_InvMass][idx] == 0.0f) {
+		return;
+	}
+	m_NumCollisionTests++;
+
+	const Vec3 toMass = GetPosition(idx) - center;
+	const f32 lengthSqr = toMass.length_sqr();
+	if (lengthSqr >= radius * radius || lengthSqr < 0.000001f) {
+		return;
+	}
+
+	const Vec3 newPos = center + toMass * (radius / sqrtf(lengthSqr));
+	m_Streams[CS_PositionX][idx] = newPos.x;
+	m_Streams[CS_PositionY][idx] = newPos.y;
+	m_Streams[CS_PositionZ][idx] = newPos.z;
+}
+
+/// kbClothSolver::SolveCollisions
+void kbClothSolver::SolveCollisions(const kbClothSolverParams_t& params) {
+	const bool bSelfCollision = params.m_SelfCollisionDistance > 0.0f;
+	if (m_NumSpheres == 0 && m_NumCapsules == 0 && m_NumMeshes == 0 && bSelfCollision == false) {
+		return;
+	}
+
+	BuildMassHash(max(m_RestCellSize, params.m_SelfCollisionDistance));
+
+	f32* const pPosX = m_Streams[CS_PositionX].data();
+	f32* const pPosY = m_Streams[CS_PositionY].data();
+	f32* const pPosZ = m_Streams[CS_PositionZ].data();
+	const f32* const pPrevX = m_Streams[CS_PrevPositionX].data();
+	const f32* const pPrevY = m_Streams[CS_PrevPositionY].data();
+	const f32* const pPrevZ = m_Streams[CS_PrevPositionZ].data();
+	const f32* const pInvMass = m_Streams[CS_InvMass].data();
+	const f32 thickness = params.m_Thickness;
+
+	for (u32 iSphere = 0; iSphere < m_NumSpheres; iSphere++) {
+		const Vec3 center = m_Spheres[iSphere].ToVec3();
+		const f32 radius = m_Spheres[iSphere].w + thickness;
+		const Vec3 extent(radius, radius, radius);
+
+		ForEachMassInBox(center - extent, center + extent, [&](const u32 idx) {
+			PushOutOfSphere(idx, center, radius);
+		});
+	}
+
+	for (u32 iCapsule = 0; iCapsule < m_NumCapsules; iCapsule++) {
+		const kbClothCapsule_t& capsule = m_Capsules[iCapsule];
+		const f32 radius = capsule.m_Radius + thickness;
+		const Vec3 extent(radius, radius, radius);
+		const Vec3 boxMin(min(capsule.m_Start.x, capsule.m_End.x), min(capsule.m_Start.y, capsule.m_End.y), min(capsule.m_Start.z, capsule.m_End.z));
+		const Vec3 boxMax(max(capsule.m_Start.x, capsule.m_End.x), max(capsule.m_Start.y, capsule.m_End.y), max(capsule.m_Start.z, capsule.m_End.z));
+		const Vec3 axis = capsule.m_End - capsule.m_Start;
+		const f32 axisLengthSqr = axis.length_sqr();
+
+		ForEachMassInBox(boxMin - extent, boxMax + extent, [&](const u32 idx) {
+			const f32 t = (axisLengthSqr > 0.0f) ? (kbSaturate((GetPosition(idx) - capsule.m_Start).dot(axis) / axisLengthSqr)) : (0.0f);
+			PushOutOfSphere(idx, capsule.m_Start + axis * t, radius);
+		});
+	}
+
+	// Masses are kept on the side of each triangle they started the step on.  Only faces are tested, since
+	// neighbouring triangles cover each other's edges for anything the size of a cloth mass.  A little thickness is
+	// always kept so that a mass resting on a face still knows which side it's on next step
+	const f32 meshThickness = max(thickness, 0.01f);
+	for (u32 iMesh = 0; iMesh < m_NumMeshes; iMesh++) {
+		const kbClothMeshInstance_t& mesh = m_Meshes[iMesh];
+		const Vec3 extent(meshThickness, meshThickness, meshThickness);
+
+		ForEachMassInBox(mesh.m_WorldBounds.Min() - extent, mesh.m_WorldBounds.Max() + extent, [&](const u32 idx) {
+			if (pInvMass[idx] == 0.0f) {
+				return;
+			}
+
+			Vec3 pos(pPosX[idx], pPosY[idx], pPosZ[idx]);
+			const Vec3 prev(pPrevX[idx], pPrevY[idx], pPrevZ[idx]);
+			const f32 travel = (pos - prev).length();
+
+			const Vec3 localPos = mesh.m_WorldToLocal.transform_point(pos);
+			const Vec3 localPrev = mesh.m_WorldToLocal.transform_point(prev);
+			const f32 localPad = meshThickness * mesh.m_WorldToLocalScale;
+			const Vec3 localMin(min(localPos.x, localPrev.x) - localPad, min(localPos.y, localPrev.y) - localPad, min(localPos.z, localPrev.z) - localPad);
+			const Vec3 localMax(max(localPos.x, localPrev.x) + localPad, max(localPos.y, localPrev.y) + localPad, max(localPos.z, localPrev.z) + localPad);
+
+			mesh.m_pCollider->ForEachTriangle(localMin, localMax, [&](const u32 triIdx) {
+				m_NumCollisionTests++;
+
+				const Vec3* const pTri = mesh.m_pCollider->GetTriangle(triIdx);
+				const Vec3 v0 = mesh.m_LocalToWorld.transform_point(pTri[0]);
+				const Vec3 v1 = mesh.m_LocalToWorld.transform_point(pTri[1]);
+				const Vec3 v2 = mesh.m_LocalToWorld.transform_point(pTri[2]);
+
+				Vec3 normal = (v1 - v0).cross(v2 - v0);
+				const f32 normalLengthSqr = normal.length_sqr();
+				if (normalLengthSqr < 0.0000001f) {
+					return;
+				}
+				normal *= 1.0f / sqrtf(normalLengthSqr);
+
+				const f32 side = (normal.dot(prev - v0) >= 0.0f) ? (1.0f) : (-1.0f);
+				const f32 dist = normal.dot(pos - v0);
+				if (side * dist >= meshThickness || side * dist < -(travel + meshThickness)) {
+					return;
+				}
+
+				const Vec3 onPlane = pos - normal * dist;
+				if ((v1 - v0).cross(onPlane - v0).dot(normal) < 0.0f || (v2 - v1).cross(onPlane - v1).dot(normal) < 0.0f || (v0 - v2).cross(onPlane - v2).dot(normal) < 0.0f) {
+					return;
+				}
+
+				pos += normal * (side * meshThickness - dist);
+			});
+
+			pPosX[idx] = pos.x;
+			pPosY[idx] = pos.y;
+			pPosZ[idx] = pos.z;
+		});
+	}
+
+	if (bSelfCollision) {
+		const f32 minDist = params.m_SelfCollisionDistance;
+		const Vec3 extent(minDist, minDist, minDist);
+
+		for (u32 i = 0; i < m_NumMasses; i++) {
+			const Vec3 massPos = GetPosition(i);
+
+			ForEachMassInBox(massPos - extent, massPos + extent, [&](const u32 j) {
+				const f32 invMassSum = pInvMass[i] + pInvMass[j];
+				if (j <= i || invMassSum == 0.0f) {
+					return;
+				}
+				m_NumCollisionTests++;
+
+				const Vec3 delta(pPosX[j] - pPosX[i], pPosY[j] - pPosY[i], pPosZ[j] - pPosZ[i]);
+				const f32 lengthSqr = delta.length_sqr();
+				if (lengthSqr >= minDist * minDist || lengthSqr < 0.000001f || AreNeighbors(i, j)) {
+					return;
+				}
+
+				const f32 length = sqrtf(lengthSqr);
+				const Vec3 offset = delta * ((minDist - length) / (length * invMassSum));
+				pPosX[i] -= offset.x * pInvMass[i];
+				pPosY[i] -= offset.y * pInvMass[i];
+				pPosZ[i] -= offset.z * pInvMass[i];
+				pPosX[j] += offset.x * pInvMass[j];
+				pPosY[j] += offset.y * pInvMass[j];
+				pPosZ[j] += offset.z * pInvMass[j];
+			});
+		}
+	}
+}
+
+/// kbClothMeshCollider::Reset
+void kbClothMeshCollider::Reset() {
+	m_Vertices.clear();
+	m_CellStarts.clear();
+	m_CellTriangles.clear();
+	m_Bounds.Reset();
+	m_CellSize = 0.0f;
+	m_InvCellSize = 0.0f;
+	m_DimX = m_DimY = m_DimZ = 0;
+	m_NumTriangles = 0;
+}
+
+/// kbClothMeshCollider::Build
+void kbClothMeshCollider::Build(const Vec3* const pVertices, const u32 numVertices) {
+	Reset();
+
+	m_NumTriangles = numVertices / 3;
+	if (m_NumTriangles == 0) {
+		return;
+	}
+
+	m_Vertices.assign(pVertices, pVertices + m_NumTriangles * 3);
+	for (size_t i = 0; i < m_Vertices.size(); i++) {
+		m_Bounds.AddPoint(m_Vertices[i]);
+	}
+
+	const Vec3 extent = m_Bounds.Max() - m_Bounds.Min();
+	m_CellSize = max(max(extent.x, max(extent.y, extent.z)) / MaxCellsPerAxis, 0.001f);
+	m_InvCellSize = 1.0f / m_CellSize;
+	m_DimX = kbClamp((u32)(extent.x * m_InvCellSize) + 1, 1u, (u32)MaxCellsPerAxis);
+	m_DimY = kbClamp((u32)(extent.y * m_InvCellSize) + 1, 1u, (u32)MaxCellsPerAxis);
+	m_DimZ = kbClamp((u32)(extent.z * m_InvCellSize) + 1, 1u, (u32)MaxCellsPerAxis);
+	const u32 numCells = m_DimX * m_DimY * m_DimZ;
+
+	// Counting sort of each triangle into every cell its bounds touch, same as kbClothSolver::BuildMassHash()
+	const Vec3& origin = m_Bounds.Min();
+	auto forEachCell = [&](const u32 triIdx, auto&& func) {
+		const Vec3* const pTri = &m_Vertices[triIdx * 3];
+		kbBounds triBounds(true);
+		triBounds.AddPoint(pTri[0]);
+		triBounds.AddPoint(pTri[1]);
+		triBounds.AddPoint(pTri[2]);
+
+		for (u32 z = GetCell(triBounds.Min().z, origin.z, m_DimZ); z <= GetCell(triBounds.Max().z, origin.z, m_DimZ); z++) {
+			for (u32 y = GetCell(triBounds.Min().y, origin.y, m_DimY); y <= GetCell(triBounds.Max().y, origin.y, m_DimY); y++) {
+				for (u32 x = GetCell(triBounds.Min().x, origin.x, m_DimX); x <= GetCell(triBounds.Max().x, origin.x, m_DimX); x++) {
+					func((z * m_DimY + y) * m_DimX + x);
+				}
+			}
+		}
+	};
+
+	m_CellStarts.assign(numCells + 1, 0);
+	for (u32 i = 0; i < m_NumTriangles; i++) {
+		forEachCell(i, [&](const u32 cell) { m_CellStarts[cell]++; });
+	}
+
+	for (u32 i = 1; i < numCells; i++) {
+		m_CellStarts[i] += m_CellStarts[i - 1];
+	}
+
+	m_CellTriangles.resize(m_CellStarts[numCells - 1]);
+	for (u32 i = 0; i < m_NumTriangles; i++) {
+		forEachCell(i, [&](const u32 cell) { m_CellTriangles[--m_CellStarts[cell]] = i; });
+	}
+	m_CellStarts[numCells] = (u32)m_CellTriangles.size();
+}
@@ -0,0 +1,224 @@
+/// kbClothSolver.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+#include "kbBounds.h"
+
+/// EClothStream
+enum EClothStream {
+	CS_PositionX,
+	CS_PositionY,
+	CS_PositionZ,
+	CS_PrevPositionX,		// Last step's position.  Anchored masses keep their position from the start of Advance() here
+	CS_PrevPositionY,
+	CS_PrevPositionZ,
+	CS_AnchorTargetX,
+	CS_AnchorTargetY,
+	CS_AnchorTargetZ,
+	CS_ForceX,				// Cleared after every Advance()
+	CS_ForceY,
+	CS_ForceZ,
+	CS_InvMass,				// 0 for anchored masses and padding, 1 otherwise
+	CS_NumStreams
+};
+
+/// kbClothSolverParams_t
+struct kbClothSolverParams_t {
+	kbClothSolverParams_t() : m_Gravity(Vec3::zero), m_Wind(Vec3::zero), m_FixedTimeStep(1.0f / 60.0f), m_Damping(0.02f), m_Stiffness(0.5f), m_Thickness(0.0f),
+							  m_SelfCollisionDistance(0.0f), m_NumIterations(1) { }
+
+	Vec3 m_Gravity;
+	Vec3 m_Wind;				// Scaled per mass and per step by hashed noise so that cloth flutters
+	f32 m_FixedTimeStep;
+	f32 m_Damping;				// Fraction of the velocity lost each step
+	f32 m_Stiffness;			// Fraction of a spring's stretch corrected each iteration
+	f32 m_Thickness;			// How far masses are kept from capsules and meshes.  Spheres use it too
+	f32 m_SelfCollisionDistance;	// Closest that two masses without a spring between them may get.  0 turns self collision off
+	u32 m_NumIterations;
+};
+
+/// kbClothCapsule_t
+struct kbClothCapsule_t {
+	Vec3 m_Start;
+	Vec3 m_End;
+	f32 m_Radius;
+};
+
+/// kbClothMeshCollider - Model space triangles bucketed into a uniform grid.  Built once per model and shared by
+/// every cloth that collides with it
+class kbClothMeshCollider {
+public:
+	kbClothMeshCollider() : m_CellSize(0.0f), m_InvCellSize(0.0f), m_DimX(0), m_DimY(0), m_DimZ(0), m_NumTriangles(0) { m_Bounds.Reset(); }
+
+	/// pVertices is a triangle list, three vertices per triangle
+	void Build(const Vec3* const pVertices, const u32 numVertices);
+	void Reset();
+
+	bool IsValid() const { return m_NumTriangles > 0; }
+	const kbBounds& GetBounds() const { return m_Bounds; }
+	u32 NumTriangles() const { return m_NumTriangles; }
+	const Vec3* GetTriangle(const u32 idx) const { return &m_Vertices[idx * 3]; }
+
+	/// Calls func(triangleIdx) for every triangle in the cells the box touches.  A triangle that spans several of
+	/// those cells is visited once per cell
+	template<typename Func>
+	void ForEachTriangle(const Vec3& boxMin, const Vec3& boxMax, Func&& func) const;
+
+private:
+	static const u32 MaxCellsPerAxis = 32;
+
+	u32 GetCell(const f32 value, const f32 origin, const u32 dim) const { return (u32)kbClamp((i32)((value - origin) * m_InvCellSize), 0, (i32)dim - 1); }
+
+	std::vector<Vec3> m_Vertices;
+	std::vector<u32> m_CellStarts;			// One more entry than there are cells
+	std::vector<u32> m_CellTriangles;
+	kbBounds m_Bounds;
+	f32 m_CellSize;
+	f32 m_InvCellSize;
+	u32 m_DimX;
+	u32 m_DimY;
+	u32 m_DimZ;
+	u32 m_NumTriangles;
+};
+
+/// kbClothMeshCollider::ForEachTriangle
+template<typename Func>
+void kbClothMeshCollider::ForEachTriangle(const Vec3& boxMin, const Vec3& boxMax, Func&& func) const {
+	if (m_NumTriangles == 0 || m_Bounds.IntersectsBounds(kbBounds(boxMin, boxMax)) == false) {
+		return;
+	}
+
+	const Vec3& origin = m_Bounds.Min();
+	const u32 minX = GetCell(boxMin.x, origin.x, m_DimX), maxX = GetCell(boxMax.x, origin.x, m_DimX);
+	const u32 minY = GetCell(boxMin.y, origin.y, m_DimY), maxY = GetCell(boxMax.y, origin.y, m_DimY);
+	const u32 minZ = GetCell(boxMin.z, origin.z, m_DimZ), maxZ = GetCell(boxMax.z, origin.z, m_DimZ);
+	for (u32 z = minZ; z <= maxZ; z++) {
+		for (u32 y = minY; y <= maxY; y++) {
+			for (u32 x = minX; x <= maxX; x++) {
+				const u32 cell = (z * m_DimY + y) * m_DimX + x;
+				for (u32 i = m_CellStarts[cell]; i < m_CellStarts[cell + 1]; i++) {
+					func(m_CellTriangles[i]);
+				}
+			}
+		}
+	}
+}
+
+/// kbClothMeshInstance_t - A mesh collider placed in the world
+struct kbClothMeshInstance_t {
+	const kbClothMeshCollider* m_pCollider;
+	Mat4 m_LocalToWorld;
+	Mat4 m_WorldToLocal;
+	f32 m_WorldToLocalScale;	// Largest scale of m_WorldToLocal, for converting distances
+	kbBounds m_WorldBounds;
+};
+
+/// kbClothSolver
+///
+/// Verlet cloth over one float stream per attribute.  Advance() runs whole fixed-size steps out of an accumulator, so
+/// cloth moves at the same speed at any frame rate.  Time past MaxSubsteps steps is dropped rather than carried over.
+///
+/// Finalize() graph colours the springs into batches where no two springs share a mass, and pads each batch to a
+/// multiple of four with springs on a dummy mass.  A batch is then solved four springs at a time with SSE, and could be
+/// split across threads, without any two writes landing on the same mass.
+///
+/// Collision hashes the masses into a grid each iteration.  Colliders that overlap the cloth only test the masses in
+/// the cells they cover, and self collision only tests the cells around each mass, so the cost follows the number of
+/// nearby pairs rather than masses times colliders.  All storage is sized in Finalize() and the collider setters, so
+/// stepping never allocates
+class kbClothSolver {
+public:
+	static const u32 MaxSubsteps = 4;
+
+	kbClothSolver() : m_RestCellSize(1.0f), m_InvHashCellSize(1.0f), m_HashSize(0), m_Stamp(0), m_NumCapsules(0), m_NumMeshes(0), m_NumCollisionTests(0),
+					  m_NumMasses(0), m_NumStreamMasses(0), m_NumSprings(0), m_NumSpheres(0), m_TimeAccumulator(0.0f), m_StepCount(0) { }
+
+	/// Setup.  Masses and springs can only be added before Finalize()
+	void Reset();
+	u32 AddMass(const Vec3& position, const bool bAnchored, const u32 windGroup);
+	void AddSpring(const u32 massA, const u32 massB, const f32 restLength);
+	void Finalize();
+
+	u32 NumMasses() const { return m_NumMasses; }
+	u32 NumSprings() const { return m_NumSprings; }
+	u32 NumSpringBatches() const { return m_BatchStarts.size() > 0 ? (u32)m_BatchStarts.size() - 1 : 0; }
+
+	Vec3 GetPosition(const u32 idx) const { return Vec3(m_Streams[CS_PositionX][idx], m_Streams[CS_PositionY][idx], m_Streams[CS_PositionZ][idx]); }
+	bool IsAnchored(const u32 idx) const { return m_Streams[CS_InvMass][idx] == 0.0f; }
+
+	/// Anchored masses move to their target over the steps of the next Advance()
+	void SetAnchorTarget(const u32 idx, const Vec3& position);
+	void AddForce(const u32 idx, const Vec3& force);
+
+	/// Colliders are in world space.  For spheres xyz is the center and w the radius
+	void SetCollisionSpheres(const Vec4* const pSpheres, const u32 numSpheres);
+	void SetCollisionCapsules(const kbClothCapsule_t* const pCapsules, const u32 numCapsules);
+	void SetMeshColliders(const kbClothMeshInstance_t* const pMeshes, const u32 numMeshes);
+
+	/// Narrow phase collision tests run during the last Advance()
+	u32 NumCollisionTests() const { return m_NumCollisionTests; }
+
+	/// Returns the number of fixed steps that were run
+	u32 Advance(const f32 deltaTime, const kbClothSolverParams_t& params);
+
+private:
+	void Step(const kbClothSolverParams_t& params, const f32 anchorT);
+	void SolveSprings(const f32 stiffness);
+	void SolveCollisions(const kbClothSolverParams_t& params);
+
+	void BuildMassHash(const f32 cellSize);
+	u32 HashCell(const i32 x, const i32 y, const i32 z) const { return (((u32)x * 73856093u) ^ ((u32)y * 19349663u) ^ ((u32)z * 83492791u)) & (m_HashSize - 1); }
+	i32 CellCoord(const f32 value) const { return (i32)floorf(value * m_InvHashCellSize); }
+
+	/// Calls func(massIdx) for the masses hashed into the cells the box touches.  Each bucket is visited once, but
+	/// buckets can hold masses from other cells
+	template<typename Func>
+	void ForEachMassInBox(const Vec3& boxMin, const Vec3& boxMax, Func&& func);
+
+	bool AreNeighbors(const u32 massA, const u32 massB) const;
+	void PushOutOfSphere(const u32 idx, const Vec3& center, const f32 radius);
+
+	std::vector<f32> m_Streams[CS_NumStreams];
+	std::vector<u32> m_WindGroups;
+
+	// Springs sorted by batch.  m_BatchStarts has one more entry than there are batches
+	std::vector<u32> m_SpringA;
+	std::vector<u32> m_SpringB;
+	std::vector<f32> m_RestLength;
+	std::vector<f32> m_WeightA;
+	std::vector<f32> m_WeightB;
+	std::vector<u32> m_BatchStarts;
+
+	// Masses each mass shares a spring with, which self collision skips.  m_NeighborStarts has one more entry than there are masses
+	std::vector<u32> m_NeighborStarts;
+	std::vector<u32> m_Neighbors;
+
+	// Spatial hash of the masses.  m_HashStarts has one more entry than there are buckets
+	std::vector<u32> m_HashStarts;
+	std::vector<u32> m_HashMasses;
+	std::vector<u32> m_MassBuckets;
+	std::vector<u32> m_BucketStamps;
+	kbBounds m_ClothBounds;
+	f32 m_RestCellSize;
+	f32 m_InvHashCellSize;
+	u32 m_HashSize;
+	u32 m_Stamp;
+
+	std::vector<Vec4> m_Spheres;
+	std::vector<kbClothCapsule_t> m_Capsules;
+	std::vector<kbClothMeshInstance_t> m_Meshes;
+	u32 m_NumCapsules;
+	u32 m_NumMeshes;
+	u32 m_NumCollisionTests;
+
+	u32 m_NumMasses;
+	u32 m_NumStreamMasses;			// Masses plus the dummy mass and padding to a multiple of four
+	u32 m_NumSprings;
+	u32 m_NumSpheres;
+	f32 m_TimeAccumulator;
+	u32 m_StepCount;
+};
@@ -11,12 +11,14 @@
 #include "kbIntersectionTests.h"
 #include "blk_console.h"
 #include "kbRenderer.h"
+#include "kbOctree.h"
 
 KB_DEFINE_COMPONENT(kbCollisionComponent)
 
 kbCollisionManager g_CollisionManager;
 
 kbConsoleVariable g_ShowCollision("showcollision", false, kbConsoleVariable::Console_Bool, "Show collision", "");
+kbConsoleVariable g_OctreeBenchmark("octreebenchmark", false, kbConsoleVariable::Console_Bool, "Check kbOctree against brute force with 20k moving elements on the next line check, and time both.", "");
 
 /// kbCollisionComponent::Constructor
 void kbCollisionComponent::Constructor() {
@@ -92,6 +94,11 @@ kbCollisionManager::~kbCollisionManager() {
 
 /// kbCollisionManager::PerformLineCheck
 kbCollisionInfo_t kbCollisionManager::PerformLineCheck(const Vec3& start, const Vec3& end) {
+	if (g_OctreeBenchmark.GetBool()) {
+		BenchmarkOctree(20000, 60);
+		g_OctreeBenchmark.SetBool(false);
+	}
+
 	kbCollisionInfo_t collisionInfo;
 
 	float LineLength = 0.0f;
@@ -136,11 +143,19 @@ kbCollisionInfo_t kbCollisionManager::PerformLineCheck(const Vec3& start, const
 		} else if (pCollision->m_CollisionType == CollisionType_StaticMesh) {
 			kbGameEntity* const pOwner = pCollision->GetOwner();
 			kbStaticModelComponent* const pStaticModel = (kbStaticModelComponent*)pOwner->GetComponentByType(kbStaticModelComponent::GetType());
-			if (pStaticModel == nullptr) {
+			SkeletalModelComponent* const pSkelModel = (pStaticModel == nullptr) ? ((SkeletalModelComponent*)pOwner->GetComponentByType(SkeletalModelComponent::GetType())) : (nullptr);
+			if (pStaticModel == nullptr && (pSkelModel == nullptr || pSkelModel->model() == nullptr)) {
 				blk::warn("kbCollisionManager::PerformLineCheck() - Entity %s is missing a RenderComponent", pOwner->GetName().c_str());
 				continue;
 			}
-			kbModelIntersection_t intersection = pStaticModel->model()->RayIntersection(start, rayDir, pOwner->GetPosition(), pOwner->GetOrientation(), Vec3::one);
+
+			// Skinned models are tested against their current pose
+			kbModelIntersection_t intersection;
+			if (pStaticModel != nullptr) {
+				intersection = pStaticModel->model()->RayIntersection(start, rayDir, pOwner->GetPosition(), pOwner->GetOrientation(), Vec3::one);
+			} else {
+				intersection = pSkelModel->model()->RayIntersection(start, rayDir, pOwner->GetPosition(), pOwner->GetOrientation(), Vec3::one, &pSkelModel->GetFinalBoneMatrices());
+			}
 			if (intersection.hasIntersection && intersection.t < LineLength && intersection.t < collisionInfo.m_T) {
 				collisionInfo.m_bHit = true;
 				collisionInfo.m_HitLocation = start + rayDir * intersection.t;
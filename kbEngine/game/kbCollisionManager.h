@@ -30,6 +30,23 @@ private:
 	Vec4										m_Sphere;
 };
 
+/// kbBoneCollisionCapsule
+class kbBoneCollisionCapsule : public kbGameComponent {
+
+	KB_DECLARE_COMPONENT( kbBoneCollisionCapsule, kbGameComponent );
+	friend class kbClothComponent;
+
+//---------------------------------------------------------------------------------------------------
+public:
+	const kbString &							GetBoneName() const { return m_BoneName; }
+
+private:
+	kbString									m_BoneName;
+	Vec3										m_Start;
+	Vec3										m_End;
+	float										m_Radius;
+};
+
 
  /// kbCollisionComponent
 class kbCollisionComponent : public kbGameComponent {
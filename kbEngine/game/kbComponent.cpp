@@ -3,6 +3,7 @@
 /// 2016-2025 blk 1.0
 
 #include "blk_core.h"
+#include "blk_containers.h"
 #include "Matrix.h"
 #include "Quaternion.h"
 #include "kbGameEntityHeader.h"
@@ -335,48 +336,59 @@ void kbVectorAnimEvent::Constructor() {
 	m_EventValue = Vec3::zero;
 }
 
+/// GetEventTime
+static const auto GetEventTime = [](const auto& animEvent) { return animEvent.GetEventTime(); };
+
 /// kbAnimEvent::Evaluate
 float kbAnimEvent::Evaluate(const std::vector<kbAnimEvent>& eventList, const float t) {
+	u32 noCursor = UINT_MAX;
+	return Evaluate(eventList, t, noCursor);
+}
+
+/// kbAnimEvent::Evaluate
+float kbAnimEvent::Evaluate(const std::vector<kbAnimEvent>& eventList, const float t, u32& keyCursor) {
 	if (eventList.size() == 0) {
 		blk::warn("kbAnimEvent::Evaluate() - Empty event list");
 		return 0;
 	}
 
-	for (size_t i = 0; i < eventList.size(); i++) {
-		if (t < eventList[i].GetEventTime()) {
-			if (i == 0) {
-				return eventList[0].GetEventValue();
-			}
+	const int i = blk::find_key_index(eventList, t, keyCursor, GetEventTime);
+	if (i < 0) {
+		return eventList[0].GetEventValue();
+	}
 
-			const float lerp = (t - eventList[i - 1].GetEventTime()) / (eventList[i].GetEventTime() - eventList[i - 1].GetEventTime());
-			return kbLerp(eventList[i - 1].GetEventValue(), eventList[i].GetEventValue(), lerp);
-		}
+	if (i >= (int)eventList.size() - 1) {
+		return eventList.back().GetEventValue();
 	}
 
-	return eventList.back().GetEventValue();
+	const float lerp = (t - eventList[i].GetEventTime()) / (eventList[i + 1].GetEventTime() - eventList[i].GetEventTime());
+	return kbLerp(eventList[i].GetEventValue(), eventList[i + 1].GetEventValue(), lerp);
 }
 
 /// kbVectorAnimEvent::Evaluate
 Vec4 kbVectorAnimEvent::Evaluate(const std::vector<kbVectorAnimEvent>& eventList, const float t) {
+	u32 noCursor = UINT_MAX;
+	return Evaluate(eventList, t, noCursor);
+}
+
+/// kbVectorAnimEvent::Evaluate
+Vec4 kbVectorAnimEvent::Evaluate(const std::vector<kbVectorAnimEvent>& eventList, const float t, u32& keyCursor) {
 	if (eventList.size() == 0) {
 		blk::warn("kbVectorAnimEvent::Evaluate() - Empty event list");
 		return Vec3::zero;
 	}
 
-	for (int i = 0; i < eventList.size(); i++) {
-		if (t < eventList[i].GetEventTime()) {
-			if (i == 0) {
-				return eventList[0].GetEventValue();
-			}
+	const int i = blk::find_key_index(eventList, t, keyCursor, GetEventTime);
+	if (i < 0) {
+		return eventList[0].GetEventValue();
+	}
 
-			const float lerp = (t - eventList[i - 1].GetEventTime()) / (eventList[i].GetEventTime() - eventList[i - 1].GetEventTime());
-			//	blk::log( "i = %d, lerp = %f.  time1 = %f, time2 = %f", i, lerp, eventList[i-1].GetEventTime(), t - eventList[i-1].GetEventTime() );
-			return kbLerp(eventList[i - 1].GetEventValue(), eventList[i].GetEventValue(), lerp);
-		}
+	if (i >= (int)eventList.size() - 1) {
+		return eventList.back().GetEventValue();
 	}
 
-	//	blk::log( "Gah!");
-	return eventList.back().GetEventValue();
+	const float lerp = (t - eventList[i].GetEventTime()) / (eventList[i + 1].GetEventTime() - eventList[i].GetEventTime());
+	return kbLerp(eventList[i].GetEventValue(), eventList[i + 1].GetEventValue(), lerp);
 }
 
 /// kbEditorGlobalSettingsComponent::Constructor
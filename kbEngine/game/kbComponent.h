@@ -207,6 +207,7 @@ public:
 	float GetEventValue() const { return m_EventValue; }
 
 	static float Evaluate(const std::vector<kbAnimEvent>& eventList, const float t);
+	static float Evaluate(const std::vector<kbAnimEvent>& eventList, const float t, u32& keyCursor);
 
 private:
 	kbString m_EventName;
@@ -240,6 +241,7 @@ public:
 	Vec4 GetEventValue() const { return m_EventValue; }
 
 	static Vec4	Evaluate(const std::vector<kbVectorAnimEvent>& eventList, const float t);
+	static Vec4	Evaluate(const std::vector<kbVectorAnimEvent>& eventList, const float t, u32& keyCursor);
 
 private:
 	kbString m_EventName;
@@ -0,0 +1,110 @@
+/// kbCurveTable.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "kbComponent.h"
+#include "kbCurveTable.h"
+
+/// kbCurveTable::Reset
+void kbCurveTable::Reset() {
+	m_Values.clear();
+	m_NumSamples = 0;
+	m_NumChannels = 0;
+	m_MaxError = 0.0f;
+}
+
+/// kbCurveTable::BakeSamples
+template<typename SampleFunc>
+void kbCurveTable::BakeSamples(const std::vector<f32>& keyTimes, const u32 numChannels, const f32 maxError, SampleFunc&& sampleCurve) {
+	m_NumChannels = numChannels;
+
+	f32 curveValue[4];
+	for (u32 numSamples = MinSamples; ; numSamples *= 2) {
+		m_NumSamples = numSamples;
+		m_Values.resize((numSamples + 1) * numChannels);
+		for (u32 i = 0; i <= numSamples; i++) {
+			sampleCurve((f32)i / numSamples, &m_Values[i * numChannels]);
+		}
+
+		// Keys outside of [0, 1] can't be reached since t is clamped
+		m_MaxError = 0.0f;
+		for (size_t iKey = 0; iKey < keyTimes.size(); iKey++) {
+			const f32 keyTime = keyTimes[iKey];
+			if (keyTime < 0.0f || keyTime > 1.0f) {
+				continue;
+			}
+
+			sampleCurve(keyTime, curveValue);
+
+			u32 idx;
+			const f32 frac = GetSample(keyTime, idx);
+			for (u32 c = 0; c < numChannels; c++) {
+				const f32 tableValue = kbLerp(m_Values[idx * numChannels + c], m_Values[(idx + 1) * numChannels + c], frac);
+				m_MaxError = max(m_MaxError, (f32)fabs(tableValue - curveValue[c]));
+			}
+		}
+
+		if (m_MaxError <= maxError || numSamples >= MaxSamples) {
+			break;
+		}
+	}
+}
+
+/// kbCurveTable::Bake
+void kbCurveTable::Bake(const std::vector<kbAnimEvent>& curve, const f32 maxError) {
+	Reset();
+	if (curve.size() == 0) {
+		return;
+	}
+
+	std::vector<f32> keyTimes(curve.size());
+	for (size_t i = 0; i < curve.size(); i++) {
+		keyTimes[i] = curve[i].GetEventTime();
+	}
+
+	BakeSamples(keyTimes, 1, maxError, [&curve](const f32 t, f32* const pOut) {
+		pOut[0] = kbAnimEvent::Evaluate(curve, t);
+	});
+}
+
+/// kbCurveTable::Bake
+void kbCurveTable::Bake(const std::vector<kbVectorAnimEvent>& curve, const f32 maxError) {
+	Reset();
+	if (curve.size() == 0) {
+		return;
+	}
+
+	std::vector<f32> keyTimes(curve.size());
+	for (size_t i = 0; i < curve.size(); i++) {
+		keyTimes[i] = curve[i].GetEventTime();
+	}
+
+	BakeSamples(keyTimes, 4, maxError, [&curve](const f32 t, f32* const pOut) {
+		const Vec4 value = kbVectorAnimEvent::Evaluate(curve, t);
+		pOut[0] = value.x;
+		pOut[1] = value.y;
+		pOut[2] = value.z;
+		pOut[3] = value.w;
+	});
+}
+
+/// kbCurveTable::EvaluateBatch
+void kbCurveTable::EvaluateBatch(const f32* const pTimes, const u32 count, f32* const pOut) const {
+	for (u32 i = 0; i < count; i++) {
+		pOut[i] = Evaluate(pTimes[i]);
+	}
+}
+
+/// kbCurveTable::EvaluateBatch
+void kbCurveTable::EvaluateBatch(const f32* const pTimes, const u32 count, f32* const pOutX, f32* const pOutY, f32* const pOutZ, f32* const pOutW) const {
+	blk::error_check(m_NumChannels == 4, "kbCurveTable::EvaluateBatch() - Table has %u channels, expected 4", m_NumChannels);
+
+	for (u32 i = 0; i < count; i++) {
+		const Vec4 value = EvaluateVector(pTimes[i]);
+		pOutX[i] = value.x;
+		pOutY[i] = value.y;
+		pOutZ[i] = value.z;
+		pOutW[i] = value.w;
+	}
+}
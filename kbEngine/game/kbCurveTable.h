@@ -0,0 +1,72 @@
+/// kbCurveTable.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+
+class kbAnimEvent;
+class kbVectorAnimEvent;
+
+/// kbCurveTable
+///
+/// An anim event curve over normalized time baked into evenly spaced samples, so that evaluating it is a clamp, an
+/// indexed fetch and a lerp instead of a key search.  Bake() starts with MinSamples and doubles the resolution until
+/// the table is within maxError of the curve or MaxSamples is reached.  Both the curve and the table are piecewise
+/// linear and the table is exact at its samples, so the largest error is always at one of the curve's keys.
+/// GetMaxError() is that measured error
+class kbCurveTable {
+public:
+	static const u32 MinSamples = 16;
+	static const u32 MaxSamples = 1024;
+
+	kbCurveTable() : m_NumSamples(0), m_NumChannels(0), m_MaxError(0.0f) { }
+
+	void Bake(const std::vector<kbAnimEvent>& curve, const f32 maxError = 1.0f / 1024.0f);
+	void Bake(const std::vector<kbVectorAnimEvent>& curve, const f32 maxError = 1.0f / 1024.0f);
+	void Reset();
+
+	bool IsValid() const { return m_NumSamples > 0; }
+	u32 NumSamples() const { return m_NumSamples; }
+	u32 NumChannels() const { return m_NumChannels; }
+	f32 GetMaxError() const { return m_MaxError; }
+
+	/// t is clamped to [0, 1].  Evaluate() returns the first channel
+	f32 Evaluate(const f32 t) const {
+		u32 idx;
+		const f32 frac = GetSample(t, idx);
+		const f32* const pSample = &m_Values[idx * m_NumChannels];
+		return pSample[0] + (pSample[m_NumChannels] - pSample[0]) * frac;
+	}
+
+	Vec4 EvaluateVector(const f32 t) const {
+		u32 idx;
+		const f32 frac = GetSample(t, idx);
+		const f32* const pSample = &m_Values[idx * 4];
+		return Vec4(pSample[0] + (pSample[4] - pSample[0]) * frac, pSample[1] + (pSample[5] - pSample[1]) * frac,
+					pSample[2] + (pSample[6] - pSample[2]) * frac, pSample[3] + (pSample[7] - pSample[3]) * frac);
+	}
+
+	/// Batched versions for a stream of normalized times.  The vector version requires a four channel table
+	void EvaluateBatch(const f32* const pTimes, const u32 count, f32* const pOut) const;
+	void EvaluateBatch(const f32* const pTimes, const u32 count, f32* const pOutX, f32* const pOutY, f32* const pOutZ, f32* const pOutW) const;
+
+private:
+	template<typename SampleFunc>
+	void BakeSamples(const std::vector<f32>& keyTimes, const u32 numChannels, const f32 maxError, SampleFunc&& sampleCurve);
+
+	f32 GetSample(const f32 t, u32& outIdx) const {
+		// Written so that a NaN t clamps to 0
+		const f32 clampedT = (t > 0.0f) ? ((t < 1.0f) ? (t) : (1.0f)) : (0.0f);
+		const f32 x = clampedT * m_NumSamples;
+		outIdx = min((u32)x, m_NumSamples - 1);
+		return x - outIdx;
+	}
+
+	std::vector<f32> m_Values;		// m_NumSamples + 1 samples of m_NumChannels values
+	u32 m_NumSamples;
+	u32 m_NumChannels;
+	f32 m_MaxError;
+};
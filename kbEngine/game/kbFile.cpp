@@ -12,8 +12,6 @@
 /// kbFile::kbFile
 kbFile::kbFile() :
 	m_FileType(FT_None),
-	m_CurrentReadPos(0),
-	m_NextReadPos(0),
 	m_bIsPackageFile(false),
 	m_bLoadAssetsImmediately(true) {
 }
@@ -43,26 +41,11 @@ bool kbFile::Open(const std::string& fileName, const kbFileType_t fileType) {
 
 		m_File.open(tempFileName.c_str(), std::fstream::out);
 	} else {
-		m_File.open(m_FileName.c_str(), std::fstream::in);
-
-		if (m_File.fail()) {
+		// Tokens point straight into the file's data, which stays valid until Close()
+		if (g_FileSystem.ReadFile(m_FileName, m_FileData) == false) {
 			return false;
 		}
-		m_File.seekg(0, m_File.end);
-		size_t length = m_File.tellg();
-		m_File.seekg(0, m_File.beg);
-
-		char* readBuffer = new char[length + 1];
-		m_File.read(readBuffer, length);
-		std::streamsize charsRead = m_File.gcount();
-
-		readBuffer[charsRead] = '\0';
-		m_Buffer = readBuffer;
-
-		delete[] readBuffer;
-
-		m_File.close();
-
+		m_Tokenizer.Reset((const char*)m_FileData.GetData(), m_FileData.GetSize(), m_FileName);
 	}
 
 	if (GetFileExtension(fileName) == "kbPkg") {
@@ -78,13 +61,16 @@ void kbFile::Close() {
 		return;
 	}
 
-	if (m_FileType == FT_Write) {		// note: read files are already closed
+	if (m_FileType == FT_Write) {
 		m_File.close();
 
 		std::string tempFileName = m_FileName.c_str();
 		tempFileName += "_tmp";
 		CopyFile(tempFileName.c_str(), m_FileName.c_str(), false);
 		DeleteFile(tempFileName.c_str());
+	} else {
+		m_Tokenizer.Reset(nullptr, 0, m_FileName);
+		m_FileData.Release();
 	}
 
 	m_FileType = FT_None;
@@ -101,62 +87,44 @@ kbGameEntity* kbFile::ReadGameEntity() {
 
 /// kbFile::ReadGameEntity_Internal
 kbGameEntity* kbFile::ReadGameEntity_Internal() {
-	size_t nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-	if (nextStringPos == std::string::npos) {
+	kbTextToken_t token;
+	if (m_Tokenizer.NextSkippingBraces(token) == false) {
 		return nullptr;
 	}
 
-	// Read GUID
-	m_CurrentReadPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-	if (m_CurrentReadPos == std::string::npos) {
+	if (token.m_Text != "kbGameEntity") {
+		m_Tokenizer.Error(token, "Expected kbGameEntity but found '%.*s'", (int)token.m_Text.size(), token.m_Text.data());
 		return nullptr;
 	}
-	m_CurrentReadPos += 1;
-
-	nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-	const std::string guid1 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-	m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-	nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-	const std::string guid2 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-	m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-	nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-	const std::string guid3 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-	m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-	nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-	const std::string guid4 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-	m_CurrentReadPos = m_Buffer.find_first_of("{", m_CurrentReadPos) + 1;
-	int bracketCount = 1;
-	nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
 
+	// Read GUID
 	kbGUID entityGUID;
-	entityGUID.m_iGuid[0] = strtoul(&guid1[0], nullptr, 0);
-	entityGUID.m_iGuid[1] = strtoul(&guid2[0], nullptr, 0);
-	entityGUID.m_iGuid[2] = strtoul(&guid3[0], nullptr, 0);
-	entityGUID.m_iGuid[3] = strtoul(&guid4[0], nullptr, 0);
+	for (int i = 0; i < 4; i++) {
+		if (m_Tokenizer.ReadUInt(entityGUID.m_iGuid[i]) == false) {
+			return nullptr;
+		}
+	}
 
-	kbGameEntity* const pGameEntity = new kbGameEntity(&entityGUID, m_bIsPackageFile);
+	if (m_Tokenizer.Expect(kbTextToken_t::TT_OpenBrace, token) == false) {
+		return nullptr;
+	}
 
-	do {
-		std::string nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-		char nextChar = m_Buffer[m_CurrentReadPos];
-		m_CurrentReadPos = nextStringPos + 1;
+	kbGameEntity* const pGameEntity = new kbGameEntity(&entityGUID, m_bIsPackageFile);
 
-		if (nextChar == '}') {
-			bracketCount--;
-		} else if (nextChar == '{') {
+	int bracketCount = 1;
+	while (bracketCount > 0 && m_Tokenizer.Next(token)) {
+		if (token.m_Type == kbTextToken_t::TT_OpenBrace) {
 			bracketCount++;
-		} else if (nextChar == ' ' || nextChar == '{' || nextChar == '\n' || nextChar == '\r' || nextChar == '\t' || nextChar == '=') {
-
-		} else if (nextToken.find("Component", 0) != std::string::npos) {
-			ReadComponent(pGameEntity, nextToken, NULL);
+		} else if (token.m_Type == kbTextToken_t::TT_CloseBrace) {
+			bracketCount--;
+		} else if (token.m_Type == kbTextToken_t::TT_Word && token.m_Text.find("Component") != std::string_view::npos) {
+			ReadComponent(pGameEntity, token, nullptr);
 		}
+	}
 
-		nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-	} while (bracketCount != 0 && nextStringPos != std::string::npos);
+	if (bracketCount > 0) {
+		m_Tokenizer.Error(token, "Unexpected end of file inside kbGameEntity %u %u %u %u", entityGUID.m_iGuid[0], entityGUID.m_iGuid[1], entityGUID.m_iGuid[2], entityGUID.m_iGuid[3]);
+	}
 
 	pGameEntity->post_load();
 
@@ -171,263 +139,181 @@ kbGameEntity* kbFile::ReadGameEntity_Internal() {
 }
 
 /// kbFile::ReadComponent
-kbComponent* kbFile::ReadComponent(kbGameEntity* const pGameEntity, const std::string& componentType, kbComponent* ComponentToFill) {
+kbComponent* kbFile::ReadComponent(kbGameEntity* const pGameEntity, const kbTextToken_t& componentType, kbComponent* ComponentToFill) {
 	kbComponent* pComponent = nullptr;
 	if (ComponentToFill != nullptr) {
 		pComponent = ComponentToFill;
-	} else if (componentType == "kbTransformComponent") {
+	} else if (componentType.m_Text == "kbTransformComponent") {
 		pComponent = (kbComponent*)(pGameEntity->GetComponent(0));
 	} else {
-		pComponent = ConstructClassFromName(componentType);
-		pGameEntity->AddComponent(pComponent);
+		pComponent = ConstructClassFromName(std::string(componentType.m_Text));
+		if (pComponent != nullptr) {
+			pGameEntity->AddComponent(pComponent);
+		}
 	}
 
-	size_t nextStringPos = m_CurrentReadPos + 1;
-	int bracketState = 0;
-
-	do {
-		std::string nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-		char nextChar = m_Buffer[m_CurrentReadPos];
-		m_CurrentReadPos = nextStringPos + 1;
-
-		if (nextChar == '{') {
-			bracketState++;
-		} else if (nextChar == ' ' || nextChar == '\n' || nextChar == '\r' || nextChar == '\t' || nextChar == '=') {
-
-		} else if (nextChar == '}') {
-			bracketState--;
-			if (bracketState == 0) {
-				break;
-			}
-		} else {
-			const std::vector< class kbTypeInfoClass* >& typeInfo = pComponent->GetTypeInfo();
-			const kbTypeInfoVar* currentVar = nullptr;
-
-			for (int i = 0; i < typeInfo.size(); i++) {
-				const kbTypeInfoVar* typeInfoVar = typeInfo[i]->GetField(nextToken);
-				if (typeInfoVar != nullptr) {
-					currentVar = typeInfoVar;
-					break;
-				}
-			}
-
-			// Unrecognized var.  Go to the next line
-			if (currentVar == nullptr) {
-				while (m_Buffer[m_CurrentReadPos] != '\n') {
-					m_CurrentReadPos++;
-				}
-				while (m_Buffer[m_CurrentReadPos] == ' ' || m_Buffer[m_CurrentReadPos] == '{' || m_Buffer[m_CurrentReadPos] == '\n' || m_Buffer[m_CurrentReadPos] == '\r' || m_Buffer[m_CurrentReadPos] == '\t') {
-					m_CurrentReadPos++;
-				}
-				nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-				continue;
-			}
-
-			m_CurrentReadPos++;
-			while (m_Buffer[m_CurrentReadPos] == ' ') m_CurrentReadPos++;
+	kbTextToken_t token;
+	if (m_Tokenizer.Expect(kbTextToken_t::TT_OpenBrace, token) == false) {
+		return pComponent;
+	}
 
-			if (m_Buffer[m_CurrentReadPos] == '"') {
-				// Reading a name in quuotes, get the whole thing
-				nextStringPos = m_Buffer.find_first_of("\"", m_CurrentReadPos + 1);
-			} else {
-				nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			}
+	if (pComponent == nullptr) {
+		m_Tokenizer.Error(componentType, "Unknown class %.*s.  Skipping it", (int)componentType.m_Text.size(), componentType.m_Text.data());
+		m_Tokenizer.SkipBlock();
+		return nullptr;
+	}
 
-			byte* pCurrentComponentAsBytePtr = ((byte*)pComponent);
+	const std::vector<class kbTypeInfoClass*>& typeInfo = pComponent->GetTypeInfo();
+	while (m_Tokenizer.Next(token)) {
+		if (token.m_Type == kbTextToken_t::TT_CloseBrace) {
+			return pComponent;
+		}
 
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			if (currentVar->IsArray()) {
-				switch (currentVar->Type()) {
-					case KBTYPEINFO_SHADER:
-					{
-						std::vector< class kbShader* >& shaderList = *(std::vector< class kbShader* > *)(&pCurrentComponentAsBytePtr[currentVar->Offset()]);
+		if (token.m_Type != kbTextToken_t::TT_Word) {
+			m_Tokenizer.Error(token, "Expected a field of %s but found '%.*s'", pComponent->GetComponentClassName(), (int)token.m_Text.size(), token.m_Text.data());
+			continue;
+		}
 
-						shaderList.resize(atoi(nextToken.c_str()));
-						int size = (int)shaderList.size();
-						while (size > 0) {
-							m_CurrentReadPos++;
-							size /= 10;
-						}
+		// A block that doesn't belong to a field, such as an element of an array that was removed
+		kbTextToken_t nextToken;
+		m_Tokenizer.Peek(nextToken);
+		if (nextToken.m_Type == kbTextToken_t::TT_OpenBrace) {
+			m_Tokenizer.Next(nextToken);
+			m_Tokenizer.SkipBlock();
+			continue;
+		}
 
-						for (int i = 0; i < shaderList.size(); i++) {
-							while (m_Buffer[m_CurrentReadPos] == ' ' || m_Buffer[m_CurrentReadPos] == '\n' || m_Buffer[m_CurrentReadPos] == '\r' || m_Buffer[m_CurrentReadPos] == '\t') {
-								m_CurrentReadPos++;
-							}
-							nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-							nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
+		const u64 fieldNameHash = kbHashName(token.m_Text);
+		const kbTypeInfoVar* currentVar = nullptr;
+		for (int i = 0; i < typeInfo.size() && currentVar == nullptr; i++) {
+			currentVar = typeInfo[i]->GetField(fieldNameHash);
+		}
 
-							const kbTypeInfoVar* pVar = currentVar;
-							shaderList[i] = (kbShader*)g_ResourceManager.GetResource(nextToken, m_bLoadAssetsImmediately, true);
-							m_CurrentReadPos = nextStringPos;
-						}
+		// Unrecognized var.  Go to the next line
+		if (currentVar == nullptr) {
+			m_Tokenizer.SkipLine();
+			continue;
+		}
 
-						currentVar = nullptr;
-						break;
-					}
+		if (m_Tokenizer.Expect(kbTextToken_t::TT_Equals, nextToken) == false) {
+			m_Tokenizer.SkipLine();
+			continue;
+		}
 
-					case KBTYPEINFO_TEXTURE:
-					{
-						std::vector<class kbTexture*>& textureList = *(std::vector< kbTexture*> *)(&pCurrentComponentAsBytePtr[currentVar->Offset()]);
+		ReadField(pGameEntity, pComponent, *currentVar);
+	}
 
-						textureList.resize(atoi(nextToken.c_str()));
-						int size = (int)textureList.size();
-						while (size > 0) {
-							m_CurrentReadPos++;
-							size /= 10;
-						}
+	m_Tokenizer.Error(token, "Unexpected end of file inside %s", pComponent->GetComponentClassName());
+	return pComponent;
+}
 
-						for (int i = 0; i < textureList.size(); i++) {
-							while (m_Buffer[m_CurrentReadPos] == ' ' || m_Buffer[m_CurrentReadPos] == '\n' || m_Buffer[m_CurrentReadPos] == '\r' || m_Buffer[m_CurrentReadPos] == '\t') {
-								m_CurrentReadPos++;
-							}
-							nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-							nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
+/// kbFile::ReadField
+void kbFile::ReadField(kbGameEntity* const pGameEntity, kbComponent* const pComponent, const kbTypeInfoVar& currentVar) {
+	byte* const pValue = ((byte*)pComponent) + currentVar.Offset();
+	if (currentVar.IsArray() == false) {
+		ReadProperty(&currentVar, pValue);
+		return;
+	}
 
-							const kbTypeInfoVar* pVar = currentVar;
-							textureList[i] = (kbTexture*)g_ResourceManager.GetResource(nextToken, m_bLoadAssetsImmediately, true);
-							m_CurrentReadPos = nextStringPos;
-						}
+	u32 arraySize = 0;
+	if (m_Tokenizer.ReadUInt(arraySize) == false) {
+		return;
+	}
 
-						currentVar = nullptr;
-						break;
-					}
-					default:
-					{
-						byte* const arrayBytePtr = &pCurrentComponentAsBytePtr[currentVar->Offset()];
-
-						const size_t arraySize = atoi(nextToken.c_str());
-						g_NameToTypeInfoMap->ResizeVector(arrayBytePtr, currentVar->GetStructName(), arraySize);
-						for (int i = 0; i < arraySize; i++) {
-
-							byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(arrayBytePtr, currentVar->GetStructName(), i);
-
-							if (currentVar->Type() == KBTYPEINFO_STRUCT) {
-								while (m_Buffer[m_CurrentReadPos] != '{') {
-									m_CurrentReadPos++;
-								}
-								kbComponent* const pNewComponent = ReadComponent(pGameEntity, currentVar->GetStructName(), (kbComponent*)arrayElem);
-								pNewComponent->SetOwningComponent(pComponent);
-							} else {
-								// hack
-								if (currentVar->Type() == KBTYPEINFO_FLOAT) {
-									m_CurrentReadPos = nextStringPos + 2;
-								} else {
-									m_CurrentReadPos = nextStringPos + 1;
-								}
-								nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-								nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-								ReadProperty(currentVar, arrayElem, nextToken, nextStringPos);
-								nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-							}
-							nextStringPos = m_Buffer.find_first_of(" }{\n\r\t", m_CurrentReadPos);
-						}
-						break;
-					}
-				}
-			} else {
-				ReadProperty(currentVar, &pCurrentComponentAsBytePtr[currentVar->Offset()], nextToken, nextStringPos);
+	switch (currentVar.Type()) {
+		case KBTYPEINFO_SHADER:
+		case KBTYPEINFO_TEXTURE:
+		{
+			std::vector<class kbResource*>& resourceList = *(std::vector<kbResource*>*)pValue;
+			resourceList.resize(arraySize);
+			for (u32 i = 0; i < arraySize; i++) {
+				resourceList[i] = nullptr;
+				ReadProperty(&currentVar, (byte*)&resourceList[i]);
 			}
+			break;
+		}
 
-			if (m_Buffer[m_CurrentReadPos] == '}') {
-				bracketState--;
-				if (bracketState == 0) {
-					m_CurrentReadPos++;
-					break;
+		default:
+		{
+			g_NameToTypeInfoMap->ResizeVector(pValue, currentVar.GetStructNameHash(), arraySize);
+			for (u32 i = 0; i < arraySize; i++) {
+				byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(pValue, currentVar.GetStructNameHash(), i);
+
+				if (currentVar.Type() == KBTYPEINFO_STRUCT) {
+					kbTextToken_t className;
+					if (m_Tokenizer.Expect(kbTextToken_t::TT_Word, className) == false) {
+						return;
+					}
+					kbComponent* const pNewComponent = ReadComponent(pGameEntity, className, (kbComponent*)arrayElem);
+					pNewComponent->SetOwningComponent(pComponent);
+				} else if (ReadProperty(&currentVar, arrayElem) == false) {
+					return;
 				}
 			}
-			m_CurrentReadPos = nextStringPos + 1;
-		}
-
-		while (m_Buffer[m_CurrentReadPos] == ' ' || m_Buffer[m_CurrentReadPos] == '{' || m_Buffer[m_CurrentReadPos] == '\n' || m_Buffer[m_CurrentReadPos] == '\r' || m_Buffer[m_CurrentReadPos] == '\t') {
-			m_CurrentReadPos++;
+			break;
 		}
-		nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-	} while (bracketState != 0);
-
-	return pComponent;
+	}
 }
 
 /// kbFile::ReadProperty
-void kbFile::ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const byteOffset, std::string& nextToken, size_t& nextStringPos) {
+bool kbFile::ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const byteOffset) {
 	switch (pTypeInfoVar->Type()) {
 		case KBTYPEINFO_BOOL:
 		{
+			std::string_view value;
+			if (m_Tokenizer.ReadWord(value) == false) {
+				return false;
+			}
+
 			bool& pComponentBool = *(bool*)byteOffset;
-			pComponentBool = (nextToken[0] - '0') == 1;
-			break;
+			pComponentBool = value.size() > 0 && value[0] == '1';
+			return true;
 		}
 
 		case KBTYPEINFO_FLOAT:
 		{
-			float& pComponentFloat = *(float*)byteOffset;
-			pComponentFloat = (float)atof(nextToken.c_str());
-			break;
+			return m_Tokenizer.ReadFloat(*(float*)byteOffset);
 		}
 
 		case KBTYPEINFO_INT:
 		{
-			int& pComponentInt = *(int*)byteOffset;
-			pComponentInt = atoi(nextToken.c_str());
-			break;
+			return m_Tokenizer.ReadInt(*(int*)byteOffset);
 		}
 
 		case KBTYPEINFO_KBSTRING:
 		{
+			std::string_view value;
+			if (m_Tokenizer.ReadWord(value) == false) {
+				return false;
+			}
+
 			kbString& string = *(kbString*)byteOffset;
-			std::string strippedString = nextToken;
-			strippedString.erase(std::remove(strippedString.begin(), strippedString.end(), '"'), strippedString.end());
-			string = strippedString;
-			break;
+			string = std::string(value);
+			return true;
 		}
 
 		case KBTYPEINFO_STRING:
 		{
+			std::string_view value;
+			if (m_Tokenizer.ReadWord(value) == false) {
+				return false;
+			}
+
 			std::string& theString = *(std::string*)byteOffset;
-			break;
+			theString = value;
+			return true;
 		}
 
 		case KBTYPEINFO_VECTOR4:
 		{
 			Vec4& theVec = *(Vec4*)byteOffset;
-
-			theVec[0] = (float)atof(nextToken.c_str());
-
-			m_CurrentReadPos = nextStringPos + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			theVec[1] = (float)atof(nextToken.c_str());
-
-			m_CurrentReadPos = nextStringPos + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			theVec[2] = (float)atof(nextToken.c_str());
-
-			m_CurrentReadPos = nextStringPos + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			theVec[3] = (float)atof(nextToken.c_str());
-
-			break;
+			return m_Tokenizer.ReadFloat(theVec.x) && m_Tokenizer.ReadFloat(theVec.y) && m_Tokenizer.ReadFloat(theVec.z) && m_Tokenizer.ReadFloat(theVec.w);
 		}
 
 		case KBTYPEINFO_VECTOR:
 		{
 			Vec3& theVec = *(Vec3*)byteOffset;
-
-			theVec[0] = (float)atof(nextToken.c_str());
-
-			m_CurrentReadPos = nextStringPos + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			theVec[1] = (float)atof(nextToken.c_str());
-
-			m_CurrentReadPos = nextStringPos + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			nextToken = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-			theVec[2] = (float)atof(nextToken.c_str());
-
-
-			break;
+			return m_Tokenizer.ReadFloat(theVec.x) && m_Tokenizer.ReadFloat(theVec.y) && m_Tokenizer.ReadFloat(theVec.z);
 		}
 
 		case KBTYPEINFO_GAMEENTITY:
@@ -435,27 +321,14 @@ void kbFile::ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const b
 			kbGameEntityPtr& entityPtr = *(kbGameEntityPtr*)byteOffset;
 
 			// Read GUID
-			const std::string guid1 = nextToken;
-
-			m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-			nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-			const std::string guid2 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-			m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-			nextStringPos = m_Buffer.find_first_of(" ", m_CurrentReadPos);
-			const std::string guid3 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
-			m_CurrentReadPos = m_Buffer.find_first_of(" ", nextStringPos) + 1;
-			nextStringPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-			const std::string guid4 = m_Buffer.substr(m_CurrentReadPos, nextStringPos - m_CurrentReadPos);
-
 			kbGUID entityGUID;
-			entityGUID.m_iGuid[0] = strtoul(&guid1[0], nullptr, 0);
-			entityGUID.m_iGuid[1] = strtoul(&guid2[0], nullptr, 0);
-			entityGUID.m_iGuid[2] = strtoul(&guid3[0], nullptr, 0);
-			entityGUID.m_iGuid[3] = strtoul(&guid4[0], nullptr, 0);
+			for (int i = 0; i < 4; i++) {
+				if (m_Tokenizer.ReadUInt(entityGUID.m_iGuid[i]) == false) {
+					return false;
+				}
+			}
 			entityPtr.SetEntity(entityGUID);
-			break;
+			return true;
 		}
 
 		case KBTYPEINFO_SOUNDWAVE:
@@ -465,34 +338,43 @@ void kbFile::ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const b
 		case KBTYPEINFO_STATICMODEL:
 		case KBTYPEINFO_SHADER:
 		{
+			std::string_view value;
+			if (m_Tokenizer.ReadWord(value) == false) {
+				return false;
+			}
+
 			INT_PTR* intPtr = (INT_PTR*)byteOffset;
 			INT_PTR& intRef = *intPtr;
-			if (nextToken != "NULL") {
-				intRef = (INT_PTR)(g_ResourceManager.GetResource(nextToken, m_bLoadAssetsImmediately, true));
+			if (value != "NULL") {
+				intRef = (INT_PTR)(g_ResourceManager.GetResource(std::string(value), m_bLoadAssetsImmediately, true));
 			}
-			break;
+			return true;
 		}
 
 		case KBTYPEINFO_ENUM:
 		{
+			kbTextToken_t token;
+			if (m_Tokenizer.Expect(kbTextToken_t::TT_Word, token) == false) {
+				return false;
+			}
+
 			int& pComponentInt = *(int*)byteOffset;
 
-			const std::vector< std::string >* enumList = g_NameToTypeInfoMap->GetEnum(pTypeInfoVar->GetStructName());
+			const std::vector< std::string >* enumList = g_NameToTypeInfoMap->GetEnum(pTypeInfoVar->GetStructNameHash());
 
 			pComponentInt = 0;
-			int i = 0;
-			for (i = 0; i < enumList->size(); i++) {
-				if ((*enumList)[i] == nextToken) {
+			for (int i = 0; i < enumList->size(); i++) {
+				if ((*enumList)[i] == token.m_Text) {
 					pComponentInt = i;
-					break;
+					return true;
 				}
 			}
 
-			if (i == enumList->size()) {
-				blk::warn("Enum value out of range");
-			}
+			m_Tokenizer.Error(token, "%.*s is not a value of %s", (int)token.m_Text.size(), token.m_Text.data(), pTypeInfoVar->GetStructName().c_str());
+			return true;
 		}
 	}
+	return true;
 }
 
 /// kbFile::WriteGameEntity
@@ -554,14 +436,14 @@ void kbFile::WriteComponent(const kbComponent* const pCurComponent, std::string&
 	// Write out variables
 	for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField())
 	{
-		byte* byteOffsetToVar = componentBytePtr + pNextField->second.Offset();
+		byte* byteOffsetToVar = componentBytePtr + pNextField->Offset();
 
-		m_Buffer += curTab + pNextField->first.c_str();		// Write out var name
+		m_Buffer += curTab + pNextField->GetName().c_str();		// Write out var name
 		m_Buffer += " = ";
 
 		// Write out arrays
-		if (pNextField->second.IsArray()) {
-			switch (pNextField->second.Type()) {
+		if (pNextField->IsArray()) {
+			switch (pNextField->Type()) {
 
 				case KBTYPEINFO_SHADER:
 				{
@@ -569,7 +451,7 @@ void kbFile::WriteComponent(const kbComponent* const pCurComponent, std::string&
 					m_Buffer += std::to_string(shaderList->size()) + "\n\t" + curTab;
 
 					for (int i = 0; i < shaderList->size(); i++) {
-						WriteProperty(pNextField->second.Type(), pNextField->second.GetStructName(), (byte*)&(*shaderList)[i], m_Buffer);
+						WriteProperty(pNextField->Type(), pNextField->GetStructName(), (byte*)&(*shaderList)[i], m_Buffer);
 						m_Buffer += "\n";
 					}
 					break;
@@ -581,31 +463,31 @@ void kbFile::WriteComponent(const kbComponent* const pCurComponent, std::string&
 					m_Buffer += std::to_string(textureList->size()) + "\n\t" + curTab;
 
 					for (int i = 0; i < textureList->size(); i++) {
-						WriteProperty(pNextField->second.Type(), pNextField->second.GetStructName(), (byte*)&(*textureList)[i], m_Buffer);
+						WriteProperty(pNextField->Type(), pNextField->GetStructName(), (byte*)&(*textureList)[i], m_Buffer);
 						m_Buffer += "\n";
 					}
 					break;
 				}
 				default:
 				{
-					const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(byteOffsetToVar, pNextField->second.GetStructName());
+					const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(byteOffsetToVar, pNextField->GetStructNameHash());
 					m_Buffer += std::to_string(vectorSize);
 					for (int i = 0; i < vectorSize; i++) {
 						m_Buffer += "\n";
-						byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(byteOffsetToVar, pNextField->second.GetStructName(), i);
-						if (pNextField->second.Type() == KBTYPEINFO_STRUCT) {
+						byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(byteOffsetToVar, pNextField->GetStructNameHash(), i);
+						if (pNextField->Type() == KBTYPEINFO_STRUCT) {
 							curTab += "\t";
 							WriteComponent((kbComponent*)arrayElem, curTab);
 							curTab.resize(curTab.size() - 1);
 						} else {
-							WriteProperty(pNextField->second.Type(), pNextField->second.GetStructName(), arrayElem, m_Buffer);
+							WriteProperty(pNextField->Type(), pNextField->GetStructName(), arrayElem, m_Buffer);
 						}
 					}
 					break;
 				}
 			}
 		} else {
-			WriteProperty(pNextField->second.Type(), pNextField->second.GetStructName(), byteOffsetToVar, m_Buffer);
+			WriteProperty(pNextField->Type(), pNextField->GetStructName(), byteOffsetToVar, m_Buffer);
 		}
 
 		m_Buffer += "\n";
@@ -765,21 +647,6 @@ bool kbFile::WritePackage(const kbPackage& package) {
 	return true;
 }
 
-/// kbFile::ReadToken
-void kbFile::ReadToken(std::string& token) {
-	// Find Start of next token
-	m_NextReadPos = m_Buffer.find_first_not_of(" \t{\n\r}", m_CurrentReadPos);
-	if (m_NextReadPos == std::string::npos) {
-		return;
-	}
-	m_CurrentReadPos = m_NextReadPos;
-
-	// Get next token
-	m_NextReadPos = m_Buffer.find_first_of(" {\n\r\t", m_CurrentReadPos);
-	token = m_Buffer.substr(m_CurrentReadPos, m_NextReadPos - m_CurrentReadPos);
-	m_CurrentReadPos = m_NextReadPos + 1;
-}
-
 /// kbFile::ReadPackage
 kbPackage* kbFile::ReadPackage(const bool bLoadAssetsImmediately) {
 	m_bLoadAssetsImmediately = bLoadAssetsImmediately;
@@ -789,52 +656,63 @@ kbPackage* kbFile::ReadPackage(const bool bLoadAssetsImmediately) {
 		return nullptr;
 	}
 
-	std::string nextToken;
-	ReadToken(nextToken);
-
 	kbPackage* newPackage = new kbPackage();
 	const size_t packageNamePos = m_FileName.find_last_of("/");
 	newPackage->m_PackageName = m_FileName.substr(packageNamePos + 1);
-	int folderIdx = -1;
 
-	while (m_NextReadPos != std::string::npos) {
+	// Braces are skipped between prefabs.  The writer puts an extra one after the first entity in a package
+	kbTextToken_t token;
+	while (m_Tokenizer.NextSkippingBraces(token)) {
 		kbPackage::kbFolder newFolder;
-		newFolder.m_FolderName = nextToken;
-
-		ReadToken(nextToken);
+		newFolder.m_FolderName = token.m_Text;
 
-		const unsigned int NumPrefabsInFolder = std::stoi(nextToken);
+		u32 NumPrefabsInFolder = 0;
+		if (m_Tokenizer.ReadUInt(NumPrefabsInFolder) == false) {
+			break;
+		}
 
 		if (NumPrefabsInFolder > 256) {
 			blk::error("Too many prefabs in folder");
 		}
 
-		for (unsigned int prefabIdx = 0; prefabIdx < NumPrefabsInFolder; prefabIdx++) {
-			ReadToken(nextToken);
-			if (nextToken != "kbPrefab") {
-				blk::error("Expected 'kbPrefab' while reading file");
+		bool bFolderIsValid = true;
+		for (u32 prefabIdx = 0; prefabIdx < NumPrefabsInFolder && bFolderIsValid; prefabIdx++) {
+			if (m_Tokenizer.NextSkippingBraces(token) == false || token.m_Text != "kbPrefab") {
+				m_Tokenizer.Error(token, "Expected 'kbPrefab' but found '%.*s'", (int)token.m_Text.size(), token.m_Text.data());
+				bFolderIsValid = false;
+				break;
+			}
+
+			u32 NumEntitiesInPrefab = 0;
+			if (m_Tokenizer.ReadUInt(NumEntitiesInPrefab) == false || m_Tokenizer.NextSkippingBraces(token) == false) {
+				bFolderIsValid = false;
+				break;
 			}
 
-			ReadToken(nextToken);
-			const unsigned int NumEntitiesInPrefab = std::stoi(nextToken);
 			if (NumEntitiesInPrefab > 16) {
 				blk::error("Too many entities in prefab");
 			}
 
 			kbPrefab* pPrefab = new kbPrefab();
-			ReadToken(pPrefab->m_PrefabName);
+			pPrefab->m_PrefabName = token.m_Text;
 			newFolder.m_pPrefabs.push_back(pPrefab);
 
-			for (unsigned entityIdx = 0; entityIdx < NumEntitiesInPrefab; entityIdx++) {
-				kbGameEntity* pEntity = ReadGameEntity();
+			for (u32 entityIdx = 0; entityIdx < NumEntitiesInPrefab; entityIdx++) {
+				kbGameEntity* const pEntity = ReadGameEntity();
+				if (pEntity == nullptr) {
+					bFolderIsValid = false;
+					break;
+				}
 				pPrefab->m_GameEntities.push_back(pEntity);
 			}
 		}
 
 		newPackage->m_Folders.push_back(newFolder);
-		folderIdx++;
 
-		ReadToken(nextToken);
+		if (bFolderIsValid == false) {
+			blk::warn("kbFile::ReadPackage() - Stopped reading %s at a malformed prefab", m_FileName.c_str());
+			break;
+		}
 	}
 
 	return newPackage;
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <fstream>
+#include "blk_tokenizer.h"
+#include "blk_file_system.h"
 
 class kbPackage;
 class kbGameEntity;
@@ -40,18 +42,19 @@ private:
 	void WriteProperty(const kbTypeInfoType_t propertyType, const std::string& structName, byte* byteOffsetToVar, std::string& writeBuffer);
 
 	kbGameEntity* ReadGameEntity_Internal();
-	kbComponent* ReadComponent(kbGameEntity* const pEntity, const std::string& className, kbComponent* ComponentToFill);
-	void ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const byteOffset, std::string& nextToken, size_t& nextStringPos);
-	void ReadToken(std::string& token);
+	kbComponent* ReadComponent(kbGameEntity* const pEntity, const kbTextToken_t& className, kbComponent* ComponentToFill);
+	void ReadField(kbGameEntity* const pEntity, kbComponent* const pComponent, const kbTypeInfoVar& typeInfoVar);
+	bool ReadProperty(const kbTypeInfoVar* const pTypeInfoVar, byte* const byteOffset);
 
 	std::fstream m_File;
 
 	kbFileType_t m_FileType;
 	std::string	m_FileName;
 
-	std::string	m_Buffer;
-	size_t m_CurrentReadPos;
-	size_t m_NextReadPos;
+	std::string	m_Buffer;			// Write buffer
+
+	kbFileData m_FileData;
+	kbTextTokenizer m_Tokenizer;
 
 	bool m_bIsPackageFile;
 	bool m_bLoadAssetsImmediately;
@@ -48,6 +48,9 @@ void kbGame::InitGame(HWND hwnd, const int backBufferWidth, const int backBuffer
 	m_InputManager.Init(m_Hwnd);
 	kbConsoleVarManager::GetConsoleVarManager()->Initialize();
 
+	// Loose files under ./assets/ still override anything packed
+	g_FileSystem.MountArchives("./paks/");
+
 	init_internal();
 }
 
@@ -86,6 +89,7 @@ void kbGame::LoadMap(const std::string& mapName) {
 
 				StopGame();
 				g_pRenderer->WaitForRenderingToComplete();
+				m_ParticleManager.WaitForParticleJobs();
 
 				for (int i = 0; i < m_GameEntityList.size(); i++) {
 					m_GameEntityList[i]->RenderSync();
@@ -194,8 +198,14 @@ void kbGame::Update() {
 		m_GameEntityList[i]->Update(m_CurFrameDeltaTime);
 	}
 
+	SkeletalModelComponent::EvaluatePendingPoses();
+	kbClothComponent::SimulatePendingCloth();
+
 	postupdate_internal();
 
+	// Particles simulate on the job threads while this thread waits for the renderer
+	m_ParticleManager.KickParticleJobs();
+
 	if (g_pRenderer != nullptr) {
 
 		const float fontHeight = (16.0f) / g_pRenderer->GetBackBufferHeight();
@@ -222,6 +232,8 @@ void kbGame::Update() {
 		{
 			START_SCOPED_TIMER(RENDER_SYNC);
 
+			m_ParticleManager.WaitForParticleJobs();
+
 			for (int i = 0; i < m_GameEntityList.size(); i++) {
 				m_GameEntityList[i]->RenderSync();
 			}
@@ -447,6 +459,14 @@ bool kbGame::ProcessCommand(const std::string& InCommand) {
 			}
 		} else if (finalCommand == "exit") {
 			RequestQuitGame();
+		} else if (finalCommand == "buildarchive") {
+			// A mapped archive can't be replaced
+			g_FileSystem.Unmount("./paks/assets.kbArc");
+			CreateDirectory("./paks/", nullptr);
+			kbArchive::Build("./paks/assets.kbArc", "./assets/", "assets/", true);
+			g_FileSystem.MountArchive("./paks/assets.kbArc");
+		} else if (finalCommand == "mounts") {
+			g_FileSystem.DumpMounts();
 		}
 		return true;
 	}
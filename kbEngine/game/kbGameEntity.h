@@ -142,6 +142,8 @@ class kbPrefab {
 	friend class kbEditor;
 	friend class kbResourceManager;
 	friend class kbFile;
+	friend class kbBinaryPackage;
+	friend class kbBinaryPackageReader;
 
 public:
 	~kbPrefab() { }
@@ -48,4 +48,72 @@ private:
 
 extern kbJobManager* g_pJobManager;
 
+/// kbJobBatches
+///
+/// Splits an array into contiguous batches and calls pRunItem() on each item from the job threads.  Batches run in any
+/// order, so items in different batches must not touch the same data.  The array has to stay put until Wait() returns
+template<typename T>
+class kbJobBatches {
+public:
+	typedef void (*RunItemFunc_t)(T& item);
+
+	kbJobBatches() : m_NumJobs(0) { }
+
+	/// Batches hold at least minItemsPerJob items.  With bRunFirstBatch, the calling thread runs the first batch before
+	/// returning.  Everything runs on the calling thread if there are no job threads
+	void Kick(T* const pItems, const size_t numItems, const size_t minItemsPerJob, const RunItemFunc_t pRunItem, const bool bRunFirstBatch) {
+		if (numItems == 0) {
+			return;
+		}
+
+		const size_t maxBatches = (bRunFirstBatch) ? (MAX_NUM_THREADS + 1) : (MAX_NUM_THREADS);
+		size_t numBatches = (numItems + minItemsPerJob - 1) / minItemsPerJob;
+		numBatches = (numBatches < maxBatches) ? (numBatches) : (maxBatches);
+		const size_t batchSize = (numItems + numBatches - 1) / numBatches;
+
+		size_t numLocal = numItems;
+		if (g_pJobManager != nullptr) {
+			numLocal = (bRunFirstBatch) ? ((batchSize < numItems) ? (batchSize) : (numItems)) : (0);
+			for (size_t start = numLocal; start < numItems; start += batchSize, m_NumJobs++) {
+				kbBatchJob& job = m_Jobs[m_NumJobs];
+				job.m_pItems = &pItems[start];
+				job.m_NumItems = (numItems - start < batchSize) ? (numItems - start) : (batchSize);
+				job.m_pRunItem = pRunItem;
+				g_pJobManager->RegisterJob(&job);
+			}
+		}
+
+		for (size_t i = 0; i < numLocal; i++) {
+			pRunItem(pItems[i]);
+		}
+	}
+
+	void Wait() {
+		for (size_t i = 0; i < m_NumJobs; i++) {
+			m_Jobs[i].WaitForJob();
+		}
+		m_NumJobs = 0;
+	}
+
+	bool IsRunning() const { return m_NumJobs > 0; }
+
+private:
+	/// kbBatchJob
+	class kbBatchJob : public kbJob {
+	public:
+		virtual void Run() override {
+			for (size_t i = 0; i < m_NumItems; i++) {
+				m_pRunItem(m_pItems[i]);
+			}
+		}
+
+		T* m_pItems = nullptr;
+		size_t m_NumItems = 0;
+		RunItemFunc_t m_pRunItem = nullptr;
+	};
+
+	kbBatchJob m_Jobs[MAX_NUM_THREADS];
+	size_t m_NumJobs;
+};
+
 void SetThreadName(const char threadName[]);
\ No newline at end of file
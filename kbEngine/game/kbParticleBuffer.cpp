@@ -0,0 +1,295 @@
+/// kbParticleBuffer.cpp
+///
+/// 2025 blk 1.0
+
+#include <xmmintrin.h>
+#include "blk_core.h"
+#include "kbCurveTable.h"
+#include "kbParticleBuffer.h"
+
+/// kbParticleBuffer::Reserve
+void kbParticleBuffer::Reserve(const u32 numParticles) {
+	const u32 newCapacity = (numParticles + 3) & ~3u;
+	if (newCapacity <= m_Capacity) {
+		return;
+	}
+
+	for (u32 i = 0; i < PS_NumStreams; i++) {
+		m_Streams[i].resize(newCapacity, 0.0f);
+	}
+	m_Capacity = newCapacity;
+}
+
+/// kbParticleBuffer::Add
+u32 kbParticleBuffer::Add(const kbParticleSpawn_t& spawn) {
+	if (m_NumParticles >= m_Capacity) {
+		Reserve(max(m_Capacity * 2, 64u));
+	}
+
+	const u32 idx = m_NumParticles++;
+	m_Streams[PS_PositionX][idx] = spawn.m_Position.x;
+	m_Streams[PS_PositionY][idx] = spawn.m_Position.y;
+	m_Streams[PS_PositionZ][idx] = spawn.m_Position.z;
+	m_Streams[PS_VelocityX][idx] = spawn.m_StartVelocity.x;
+	m_Streams[PS_VelocityY][idx] = spawn.m_StartVelocity.y;
+	m_Streams[PS_VelocityZ][idx] = spawn.m_StartVelocity.z;
+	m_Streams[PS_LifeLeft][idx] = spawn.m_Life;
+	m_Streams[PS_NormalizedTime][idx] = 0.0f;
+	m_Streams[PS_Rotation][idx] = spawn.m_Rotation;
+	m_Streams[PS_SizeX][idx] = spawn.m_StartSize.x;
+	m_Streams[PS_SizeY][idx] = spawn.m_StartSize.y;
+	m_Streams[PS_SizeZ][idx] = spawn.m_StartSize.z;
+	m_Streams[PS_ColorR][idx] = 0.0f;
+	m_Streams[PS_ColorG][idx] = 0.0f;
+	m_Streams[PS_ColorB][idx] = 0.0f;
+	m_Streams[PS_ColorA][idx] = 0.0f;
+
+	m_Streams[PS_TotalLife][idx] = spawn.m_Life;
+	m_Streams[PS_InvTotalLife][idx] = (spawn.m_Life > 0.0f) ? (1.0f / spawn.m_Life) : (0.0f);
+	m_Streams[PS_StartVelocityX][idx] = spawn.m_StartVelocity.x;
+	m_Streams[PS_StartVelocityY][idx] = spawn.m_StartVelocity.y;
+	m_Streams[PS_StartVelocityZ][idx] = spawn.m_StartVelocity.z;
+	m_Streams[PS_EndVelocityX][idx] = spawn.m_EndVelocity.x;
+	m_Streams[PS_EndVelocityY][idx] = spawn.m_EndVelocity.y;
+	m_Streams[PS_EndVelocityZ][idx] = spawn.m_EndVelocity.z;
+	m_Streams[PS_StartRotationRate][idx] = spawn.m_StartRotationRate;
+	m_Streams[PS_EndRotationRate][idx] = spawn.m_EndRotationRate;
+	m_Streams[PS_StartSizeX][idx] = spawn.m_StartSize.x;
+	m_Streams[PS_StartSizeY][idx] = spawn.m_StartSize.y;
+	m_Streams[PS_StartSizeZ][idx] = spawn.m_StartSize.z;
+	m_Streams[PS_EndSizeX][idx] = spawn.m_EndSize.x;
+	m_Streams[PS_EndSizeY][idx] = spawn.m_EndSize.y;
+	m_Streams[PS_EndSizeZ][idx] = spawn.m_EndSize.z;
+	m_Streams[PS_Random0][idx] = spawn.m_Randoms[0];
+	m_Streams[PS_Random1][idx] = spawn.m_Randoms[1];
+	m_Streams[PS_Random2][idx] = spawn.m_Randoms[2];
+	m_Streams[PS_RotationAxisX][idx] = spawn.m_RotationAxis.x;
+	m_Streams[PS_RotationAxisY][idx] = spawn.m_RotationAxis.y;
+	m_Streams[PS_RotationAxisZ][idx] = spawn.m_RotationAxis.z;
+	m_Streams[PS_Stuck][idx] = 0.0f;
+	m_Streams[PS_VelocityCurve][idx] = 1.0f;
+
+	return idx;
+}
+
+/// kbParticleBuffer::RemoveSwap
+void kbParticleBuffer::RemoveSwap(const u32 idx) {
+	const u32 lastIdx = m_NumParticles - 1;
+	if (idx != lastIdx) {
+		for (u32 i = 0; i < PS_NumStreams; i++) {
+			m_Streams[i][idx] = m_Streams[i][lastIdx];
+		}
+	}
+	m_NumParticles--;
+}
+
+/// kbParticleBuffer::Simulate
+void kbParticleBuffer::Simulate(const kbParticleSimParams_t& params) {
+	if (m_NumParticles == 0) {
+		return;
+	}
+
+	const u32 numParticles = m_NumParticles;
+	const u32 numSimdParticles = NumSimdParticles();
+	const bool bVelocityCurve = params.m_pVelocityCurve != nullptr && params.m_pVelocityCurve->IsValid();
+	const bool bSizeCurve = params.m_pSizeCurve != nullptr && params.m_pSizeCurve->IsValid();
+	const bool bColorCurve = params.m_pColorCurve != nullptr && params.m_pColorCurve->IsValid();
+	const bool bAlphaCurve = params.m_pAlphaCurve != nullptr && params.m_pAlphaCurve->IsValid();
+
+	f32* const pPosX = GetStream(PS_PositionX);
+	f32* const pPosY = GetStream(PS_PositionY);
+	f32* const pPosZ = GetStream(PS_PositionZ);
+	f32* const pVelX = GetStream(PS_VelocityX);
+	f32* const pVelY = GetStream(PS_VelocityY);
+	f32* const pVelZ = GetStream(PS_VelocityZ);
+	f32* const pTime = GetStream(PS_NormalizedTime);
+	f32* const pRotation = GetStream(PS_Rotation);
+	f32* const pSizeX = GetStream(PS_SizeX);
+	f32* const pSizeY = GetStream(PS_SizeY);
+	f32* const pSizeZ = GetStream(PS_SizeZ);
+	f32* const pColorR = GetStream(PS_ColorR);
+	f32* const pColorG = GetStream(PS_ColorG);
+	f32* const pColorB = GetStream(PS_ColorB);
+	f32* const pColorA = GetStream(PS_ColorA);
+	f32* const pVelCurve = GetStream(PS_VelocityCurve);
+	f32* const pCurveScratch = GetStream(PS_CurveScratch);
+	const f32* const pLifeLeft = GetStream(PS_LifeLeft);
+	const f32* const pTotalLife = GetStream(PS_TotalLife);
+	const f32* const pInvTotalLife = GetStream(PS_InvTotalLife);
+	const f32* const pStartVelX = GetStream(PS_StartVelocityX);
+	const f32* const pStartVelY = GetStream(PS_StartVelocityY);
+	const f32* const pStartVelZ = GetStream(PS_StartVelocityZ);
+	const f32* const pEndVelX = GetStream(PS_EndVelocityX);
+	const f32* const pEndVelY = GetStream(PS_EndVelocityY);
+	const f32* const pEndVelZ = GetStream(PS_EndVelocityZ);
+	const f32* const pStartRotRate = GetStream(PS_StartRotationRate);
+	const f32* const pEndRotRate = GetStream(PS_EndRotationRate);
+	const f32* const pStartSizeX = GetStream(PS_StartSizeX);
+	const f32* const pStartSizeY = GetStream(PS_StartSizeY);
+	const f32* const pStartSizeZ = GetStream(PS_StartSizeZ);
+	const f32* const pEndSizeX = GetStream(PS_EndSizeX);
+	const f32* const pEndSizeY = GetStream(PS_EndSizeY);
+	const f32* const pEndSizeZ = GetStream(PS_EndSizeZ);
+	const f32* const pStuck = GetStream(PS_Stuck);
+
+	// Normalized age
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (u32 i = 0; i < numSimdParticles; i += 4) {
+		const __m128 t = _mm_sub_ps(one, _mm_mul_ps(_mm_loadu_ps(pLifeLeft + i), _mm_loadu_ps(pInvTotalLife + i)));
+		_mm_storeu_ps(pTime + i, t);
+	}
+
+	// Curves are fetched from their tables up front into the streams the SIMD pass reads or skips.  The color curve's
+	// alpha is always replaced by the alpha curve or the start and end alpha
+	if (bVelocityCurve) {
+		params.m_pVelocityCurve->EvaluateBatch(pTime, numParticles, pVelCurve);
+	}
+
+	if (bSizeCurve) {
+		params.m_pSizeCurve->EvaluateBatch(pTime, numParticles, pSizeX, pSizeY, pSizeZ, pCurveScratch);
+	}
+
+	if (bColorCurve) {
+		params.m_pColorCurve->EvaluateBatch(pTime, numParticles, pColorR, pColorG, pColorB, pColorA);
+	}
+
+	if (bAlphaCurve) {
+		params.m_pAlphaCurve->EvaluateBatch(pTime, numParticles, pColorA);
+	}
+
+	const __m128 deltaTime = _mm_set1_ps(params.m_DeltaTime);
+	const __m128 gravityX = _mm_set1_ps(params.m_Gravity.x);
+	const __m128 gravityY = _mm_set1_ps(params.m_Gravity.y);
+	const __m128 gravityZ = _mm_set1_ps(params.m_Gravity.z);
+	const __m128 scaleX = _mm_set1_ps(params.m_Scale.x);
+	const __m128 scaleY = _mm_set1_ps(params.m_Scale.y);
+	const __m128 scaleZ = _mm_set1_ps(params.m_Scale.z);
+	const __m128 startR = _mm_set1_ps(params.m_StartColor.x);
+	const __m128 startG = _mm_set1_ps(params.m_StartColor.y);
+	const __m128 startB = _mm_set1_ps(params.m_StartColor.z);
+	const __m128 startA = _mm_set1_ps(params.m_StartColor.w);
+	const __m128 deltaR = _mm_set1_ps(params.m_EndColor.x - params.m_StartColor.x);
+	const __m128 deltaG = _mm_set1_ps(params.m_EndColor.y - params.m_StartColor.y);
+	const __m128 deltaB = _mm_set1_ps(params.m_EndColor.z - params.m_StartColor.z);
+	const __m128 deltaA = _mm_set1_ps(params.m_EndColor.w - params.m_StartColor.w);
+
+	for (u32 i = 0; i < numSimdParticles; i += 4) {
+		const __m128 t = _mm_loadu_ps(pTime + i);
+		const __m128 age = _mm_sub_ps(_mm_loadu_ps(pTotalLife + i), _mm_loadu_ps(pLifeLeft + i));
+
+		// Velocity and position
+		__m128 velX, velY, velZ;
+		const __m128 startVelX = _mm_loadu_ps(pStartVelX + i);
+		const __m128 startVelY = _mm_loadu_ps(pStartVelY + i);
+		const __m128 startVelZ = _mm_loadu_ps(pStartVelZ + i);
+		if (bVelocityCurve) {
+			const __m128 velScale = _mm_loadu_ps(pVelCurve + i);
+			velX = _mm_mul_ps(startVelX, velScale);
+			velY = _mm_mul_ps(startVelY, velScale);
+			velZ = _mm_mul_ps(startVelZ, velScale);
+		} else {
+			velX = _mm_add_ps(startVelX, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pEndVelX + i), startVelX), t));
+			velY = _mm_add_ps(startVelY, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pEndVelY + i), startVelY), t));
+			velZ = _mm_add_ps(startVelZ, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pEndVelZ + i), startVelZ), t));
+		}
+
+		velX = _mm_add_ps(velX, _mm_mul_ps(gravityX, age));
+		velY = _mm_add_ps(velY, _mm_mul_ps(gravityY, age));
+		velZ = _mm_add_ps(velZ, _mm_mul_ps(gravityZ, age));
+
+		const __m128 moveScale = _mm_sub_ps(one, _mm_loadu_ps(pStuck + i));
+		velX = _mm_mul_ps(velX, moveScale);
+		velY = _mm_mul_ps(velY, moveScale);
+		velZ = _mm_mul_ps(velZ, moveScale);
+		_mm_storeu_ps(pVelX + i, velX);
+		_mm_storeu_ps(pVelY + i, velY);
+		_mm_storeu_ps(pVelZ + i, velZ);
+
+		_mm_storeu_ps(pPosX + i, _mm_add_ps(_mm_loadu_ps(pPosX + i), _mm_mul_ps(velX, deltaTime)));
+		_mm_storeu_ps(pPosY + i, _mm_add_ps(_mm_loadu_ps(pPosY + i), _mm_mul_ps(velY, deltaTime)));
+		_mm_storeu_ps(pPosZ + i, _mm_add_ps(_mm_loadu_ps(pPosZ + i), _mm_mul_ps(velZ, deltaTime)));
+
+		// Rotation
+		const __m128 startRotRate = _mm_loadu_ps(pStartRotRate + i);
+		const __m128 rotRate = _mm_add_ps(startRotRate, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pEndRotRate + i), startRotRate), t));
+		_mm_storeu_ps(pRotation + i, _mm_add_ps(_mm_loadu_ps(pRotation + i), _mm_mul_ps(rotRate, deltaTime)));
+
+		// Size.  Curves scale the start size by the emitter's scale.  Otherwise start size is scaled by the emitter's x
+		// scale and end size by its y
+		if (bSizeCurve) {
+			_mm_storeu_ps(pSizeX + i, _mm_mul_ps(_mm_loadu_ps(pSizeX + i), _mm_mul_ps(_mm_loadu_ps(pStartSizeX + i), scaleX)));
+			_mm_storeu_ps(pSizeY + i, _mm_mul_ps(_mm_loadu_ps(pSizeY + i), _mm_mul_ps(_mm_loadu_ps(pStartSizeY + i), scaleY)));
+			_mm_storeu_ps(pSizeZ + i, _mm_mul_ps(_mm_loadu_ps(pSizeZ + i), _mm_mul_ps(_mm_loadu_ps(pStartSizeZ + i), scaleZ)));
+		} else {
+			const __m128 startSizeX = _mm_mul_ps(_mm_loadu_ps(pStartSizeX + i), scaleX);
+			const __m128 startSizeY = _mm_mul_ps(_mm_loadu_ps(pStartSizeY + i), scaleX);
+			const __m128 startSizeZ = _mm_mul_ps(_mm_loadu_ps(pStartSizeZ + i), scaleX);
+			const __m128 endSizeX = _mm_mul_ps(_mm_loadu_ps(pEndSizeX + i), scaleY);
+			const __m128 endSizeY = _mm_mul_ps(_mm_loadu_ps(pEndSizeY + i), scaleY);
+			const __m128 endSizeZ = _mm_mul_ps(_mm_loadu_ps(pEndSizeZ + i), scaleY);
+			_mm_storeu_ps(pSizeX + i, _mm_add_ps(startSizeX, _mm_mul_ps(_mm_sub_ps(endSizeX, startSizeX), t)));
+			_mm_storeu_ps(pSizeY + i, _mm_add_ps(startSizeY, _mm_mul_ps(_mm_sub_ps(endSizeY, startSizeY), t)));
+			_mm_storeu_ps(pSizeZ + i, _mm_add_ps(startSizeZ, _mm_mul_ps(_mm_sub_ps(endSizeZ, startSizeZ), t)));
+		}
+
+		// Color
+		if (bColorCurve == false) {
+			_mm_storeu_ps(pColorR + i, _mm_add_ps(startR, _mm_mul_ps(deltaR, t)));
+			_mm_storeu_ps(pColorG + i, _mm_add_ps(startG, _mm_mul_ps(deltaG, t)));
+			_mm_storeu_ps(pColorB + i, _mm_add_ps(startB, _mm_mul_ps(deltaB, t)));
+		}
+
+		if (bAlphaCurve == false) {
+			_mm_storeu_ps(pColorA + i, _mm_add_ps(startA, _mm_mul_ps(deltaA, t)));
+		}
+	}
+}
+
+/// kbParticleBuffer::Benchmark
+void kbParticleBuffer::Benchmark(const u32 numParticles, const u32 numFrames) {
+	if (numParticles == 0 || numFrames == 0) {
+		return;
+	}
+
+	const f32 frameTime = 1.0f / 60.0f;
+	const f32 simLength = numFrames * frameTime;
+
+	kbParticleBuffer particles;
+
+	// Lifetimes are spread so that around half of the particles expire over the run
+	kbTimer spawnTimer;
+	particles.Reserve(numParticles);
+	for (u32 i = 0; i < numParticles; i++) {
+		kbParticleSpawn_t spawn;
+		spawn.m_Position = Vec3Rand(Vec3(-10.0f, -10.0f, -10.0f), Vec3(10.0f, 10.0f, 10.0f));
+		spawn.m_StartVelocity = Vec3Rand(Vec3(-2.0f, 5.0f, -2.0f), Vec3(2.0f, 5.0f, 2.0f));
+		spawn.m_StartSize.set(3.0f, 3.0f, 3.0f);
+		spawn.m_EndSize.set(1.0f, 1.0f, 1.0f);
+		spawn.m_Life = kbfrand(simLength * 0.5f, simLength * 1.5f);
+		spawn.m_StartRotationRate = kbfrand(-1.0f, 1.0f);
+		particles.Add(spawn);
+	}
+	const f32 spawnMS = spawnTimer.TimeElapsedMS();
+
+	kbParticleSimParams_t params;
+	params.m_DeltaTime = frameTime;
+	params.m_Gravity.set(0.0f, -9.8f, 0.0f);
+	params.m_StartColor.set(1.0f, 1.0f, 1.0f, 1.0f);
+	params.m_EndColor.set(1.0f, 0.5f, 0.0f, 0.0f);
+
+	u32 numRemoved = 0;
+	f32 expireMS = 0.0f, simulateMS = 0.0f;
+	for (u32 iFrame = 0; iFrame < numFrames; iFrame++) {
+		kbTimer expireTimer;
+		particles.RemoveExpired(frameTime, [&numRemoved](const u32, const u32) { numRemoved++; });
+		expireMS += expireTimer.TimeElapsedMS();
+
+		kbTimer simulateTimer;
+		particles.Simulate(params);
+		simulateMS += simulateTimer.TimeElapsedMS();
+	}
+
+	const f32 frameMS = (expireMS + simulateMS) / numFrames;
+	blk::log("Particle benchmark - %u particles, %u frames at 60hz.  %u expired", numParticles, numFrames, numRemoved);
+	blk::log("	Spawn: %.3f ms.  Per frame - age and compact: %.3f ms.  simulate: %.3f ms.  %.1f million particles a second", spawnMS, expireMS / numFrames, simulateMS / numFrames, (frameMS > 0.0f) ? (numParticles / (frameMS * 1000.0f)) : (0.0f));
+}
@@ -0,0 +1,166 @@
+/// kbParticleBuffer.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+
+class kbCurveTable;
+
+/// EParticleStream
+enum EParticleStream {
+	// Updated every frame
+	PS_PositionX,
+	PS_PositionY,
+	PS_PositionZ,
+	PS_VelocityX,
+	PS_VelocityY,
+	PS_VelocityZ,
+	PS_LifeLeft,
+	PS_NormalizedTime,
+	PS_Rotation,
+	PS_SizeX,
+	PS_SizeY,
+	PS_SizeZ,
+	PS_ColorR,
+	PS_ColorG,
+	PS_ColorB,
+	PS_ColorA,
+
+	// Set on spawn
+	PS_TotalLife,
+	PS_InvTotalLife,
+	PS_StartVelocityX,
+	PS_StartVelocityY,
+	PS_StartVelocityZ,
+	PS_EndVelocityX,
+	PS_EndVelocityY,
+	PS_EndVelocityZ,
+	PS_StartRotationRate,
+	PS_EndRotationRate,
+	PS_StartSizeX,
+	PS_StartSizeY,
+	PS_StartSizeZ,
+	PS_EndSizeX,
+	PS_EndSizeY,
+	PS_EndSizeZ,
+	PS_Random0,
+	PS_Random1,
+	PS_Random2,
+	PS_RotationAxisX,
+	PS_RotationAxisY,
+	PS_RotationAxisZ,
+
+	// Set by collision.  1 for particles that stuck to what they hit, which stops them moving
+	PS_Stuck,
+
+	// Per-frame curve results
+	PS_VelocityCurve,
+	PS_CurveScratch,
+
+	PS_NumStreams
+};
+
+/// kbParticleSpawn_t
+struct kbParticleSpawn_t {
+	kbParticleSpawn_t() : m_Position(Vec3::zero), m_StartVelocity(Vec3::zero), m_EndVelocity(Vec3::zero), m_StartSize(Vec3::zero), m_EndSize(Vec3::zero),
+						  m_RotationAxis(Vec3::zero), m_Life(0.0f), m_Rotation(0.0f), m_StartRotationRate(0.0f), m_EndRotationRate(0.0f) {
+		m_Randoms[0] = m_Randoms[1] = m_Randoms[2] = 0.0f;
+	}
+
+	Vec3 m_Position;
+	Vec3 m_StartVelocity;
+	Vec3 m_EndVelocity;
+	Vec3 m_StartSize;
+	Vec3 m_EndSize;
+	Vec3 m_RotationAxis;
+	f32 m_Life;
+	f32 m_Rotation;
+	f32 m_StartRotationRate;
+	f32 m_EndRotationRate;
+	f32 m_Randoms[3];
+};
+
+/// kbParticleSimParams_t - Emitter wide inputs to kbParticleBuffer::Simulate().  Curve tables are optional
+struct kbParticleSimParams_t {
+	kbParticleSimParams_t() : m_DeltaTime(0.0f), m_Gravity(Vec3::zero), m_Scale(Vec3::one), m_StartColor(Vec4::zero), m_EndColor(Vec4::zero),
+							  m_pVelocityCurve(nullptr), m_pSizeCurve(nullptr), m_pColorCurve(nullptr), m_pAlphaCurve(nullptr) { }
+
+	f32 m_DeltaTime;
+	Vec3 m_Gravity;
+	Vec3 m_Scale;
+	Vec4 m_StartColor;
+	Vec4 m_EndColor;
+
+	const kbCurveTable* m_pVelocityCurve;
+	const kbCurveTable* m_pSizeCurve;
+	const kbCurveTable* m_pColorCurve;
+	const kbCurveTable* m_pAlphaCurve;
+};
+
+/// kbParticleBuffer
+///
+/// Particle storage as one float stream per attribute so that the update touches only the streams it needs and can
+/// run four particles at a time with SSE.  Streams are padded to a multiple of four, and lanes past the live count
+/// hold stale but finite values, so the SIMD loops never need a scalar tail.
+///
+/// Expired particles are removed in the same pass that ages them by swapping the last live particle into their slot.
+/// That reorders particles, so anything kept alongside the buffer must be moved by the RemoveExpired() callback
+class kbParticleBuffer {
+public:
+	kbParticleBuffer() : m_NumParticles(0), m_Capacity(0) { }
+
+	void Reserve(const u32 numParticles);
+	void Clear() { m_NumParticles = 0; }
+
+	u32 NumParticles() const { return m_NumParticles; }
+	u32 Capacity() const { return m_Capacity; }
+
+	/// Returns the new particle's index
+	u32 Add(const kbParticleSpawn_t& spawn);
+
+	/// Ages particles by deltaTime and swap removes the ones that expired.  onRemove(removedIdx, lastIdx) is called
+	/// before particle lastIdx is moved into removedIdx.  The two are equal when the last particle is the one removed
+	template<typename RemoveFunc>
+	void RemoveExpired(const f32 deltaTime, RemoveFunc&& onRemove);
+
+	/// Updates velocity, position, rotation, size and color from each particle's normalized age
+	void Simulate(const kbParticleSimParams_t& params);
+
+	const f32* GetStream(const EParticleStream stream) const { return m_Streams[stream].data(); }
+	f32* GetStream(const EParticleStream stream) { return m_Streams[stream].data(); }
+
+	Vec3 GetPosition(const u32 idx) const { return Vec3(m_Streams[PS_PositionX][idx], m_Streams[PS_PositionY][idx], m_Streams[PS_PositionZ][idx]); }
+	Vec3 GetVelocity(const u32 idx) const { return Vec3(m_Streams[PS_VelocityX][idx], m_Streams[PS_VelocityY][idx], m_Streams[PS_VelocityZ][idx]); }
+	Vec3 GetSize(const u32 idx) const { return Vec3(m_Streams[PS_SizeX][idx], m_Streams[PS_SizeY][idx], m_Streams[PS_SizeZ][idx]); }
+	Vec4 GetColor(const u32 idx) const { return Vec4(m_Streams[PS_ColorR][idx], m_Streams[PS_ColorG][idx], m_Streams[PS_ColorB][idx], m_Streams[PS_ColorA][idx]); }
+	Vec3 GetRotationAxis(const u32 idx) const { return Vec3(m_Streams[PS_RotationAxisX][idx], m_Streams[PS_RotationAxisY][idx], m_Streams[PS_RotationAxisZ][idx]); }
+
+	/// Logs the cost of spawning, simulating, and expiring numParticles over numFrames
+	static void Benchmark(const u32 numParticles, const u32 numFrames);
+
+private:
+	u32 NumSimdParticles() const { return (m_NumParticles + 3) & ~3u; }
+	void RemoveSwap(const u32 idx);
+
+	std::vector<f32> m_Streams[PS_NumStreams];
+	u32 m_NumParticles;
+	u32 m_Capacity;
+};
+
+/// kbParticleBuffer::RemoveExpired
+template<typename RemoveFunc>
+void kbParticleBuffer::RemoveExpired(const f32 deltaTime, RemoveFunc&& onRemove) {
+	f32* const pLifeLeft = m_Streams[PS_LifeLeft].data();
+
+	// Walking backwards means the particle swapped into a removed slot has already been aged
+	for (i32 i = (i32)m_NumParticles - 1; i >= 0; i--) {
+		pLifeLeft[i] -= deltaTime;
+		if (pLifeLeft[i] <= 0.0f) {
+			onRemove((u32)i, m_NumParticles - 1);
+			RemoveSwap((u32)i);
+		}
+	}
+}
@@ -0,0 +1,375 @@
+/// kbParticleCollision.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "blk_containers.h"
+#include "blk_console.h"
+#include "kbParticleCollision.h"
+#include "kbParticleBuffer.h"
+#include "kbCurveTable.h"
+
+kbConsoleVariable g_ParticleCollisionBudget("particlecollisionbudget", 1.0f, kbConsoleVariable::Console_Float, "Milliseconds of CPU time particle collision may use each frame.  0 is unlimited.", "");
+
+/// kbParticleHeightField::Build
+void kbParticleHeightField::Build(const f32 originX, const f32 originZ, const f32 cellSize, const u32 dimX, const u32 dimZ, const f32* const pHeights) {
+	Reset();
+	if (dimX < 2 || dimZ < 2 || cellSize <= 0.0f) {
+		blk::warn("kbParticleHeightField::Build() - Invalid dimensions %u x %u with cell size %f", dimX, dimZ, cellSize);
+		return;
+	}
+
+	m_Heights.assign(pHeights, pHeights + dimX * dimZ);
+	m_OriginX = originX;
+	m_OriginZ = originZ;
+	m_CellSize = cellSize;
+	m_InvCellSize = 1.0f / cellSize;
+	m_DimX = dimX;
+	m_DimZ = dimZ;
+}
+
+/// kbParticleHeightField::Reset
+void kbParticleHeightField::Reset() {
+	m_Heights.clear();
+	m_CellSize = 0.0f;
+	m_InvCellSize = 0.0f;
+	m_DimX = 0;
+	m_DimZ = 0;
+}
+
+/// kbParticleHeightField::GetHeight
+bool kbParticleHeightField::GetHeight(const f32 x, const f32 z, f32& outHeight) const {
+	const f32 fx = (x - m_OriginX) * m_InvCellSize;
+	const f32 fz = (z - m_OriginZ) * m_InvCellSize;
+	if ((fx >= 0.0f && fz >= 0.0f && fx <= (f32)(m_DimX - 1) && fz <= (f32)(m_DimZ - 1)) == false) {
+		return false;
+	}
+
+	const u32 ix = min((u32)fx, m_DimX - 2);
+	const u32 iz = min((u32)fz, m_DimZ - 2);
+	const f32 fracX = fx - ix;
+	const f32 fracZ = fz - iz;
+	const f32* const pRow0 = &m_Heights[iz * m_DimX + ix];
+	const f32* const pRow1 = pRow0 + m_DimX;
+	outHeight = kbLerp(kbLerp(pRow0[0], pRow0[1], fracX), kbLerp(pRow1[0], pRow1[1], fracX), fracZ);
+	return true;
+}
+
+/// kbParticleHeightField::GetNormal
+Vec3 kbParticleHeightField::GetNormal(const f32 x, const f32 z) const {
+	const i32 ix = (i32)((x - m_OriginX) * m_InvCellSize + 0.5f);
+	const i32 iz = (i32)((z - m_OriginZ) * m_InvCellSize + 0.5f);
+	Vec3 normal(GetSample(ix - 1, iz) - GetSample(ix + 1, iz), 2.0f * m_CellSize, GetSample(ix, iz - 1) - GetSample(ix, iz + 1));
+	normal.normalize_self();
+	return normal;
+}
+
+/// kbParticleVoxelGrid::Init
+void kbParticleVoxelGrid::Init(const kbBounds& worldBounds, const f32 voxelSize) {
+	Reset();
+	if (voxelSize <= 0.0f) {
+		blk::warn("kbParticleVoxelGrid::Init() - Invalid voxel size %f", voxelSize);
+		return;
+	}
+
+	const Vec3 extent = worldBounds.Max() - worldBounds.Min();
+	m_Origin = worldBounds.Min();
+	m_VoxelSize = voxelSize;
+	m_InvVoxelSize = 1.0f / voxelSize;
+	m_DimX = max((u32)ceil(extent.x * m_InvVoxelSize), 1u);
+	m_DimY = max((u32)ceil(extent.y * m_InvVoxelSize), 1u);
+	m_DimZ = max((u32)ceil(extent.z * m_InvVoxelSize), 1u);
+	m_Voxels.resize(m_DimX * m_DimY * m_DimZ, 0);
+}
+
+/// kbParticleVoxelGrid::Reset
+void kbParticleVoxelGrid::Reset() {
+	m_Voxels.clear();
+	m_VoxelSize = 0.0f;
+	m_InvVoxelSize = 0.0f;
+	m_DimX = m_DimY = m_DimZ = 0;
+	m_NumSolid = 0;
+}
+
+/// kbParticleVoxelGrid::AddBox
+void kbParticleVoxelGrid::AddBox(const kbBounds& box) {
+	if (m_Voxels.size() == 0) {
+		return;
+	}
+
+	const Vec3 minVoxel = (box.Min() - m_Origin) * m_InvVoxelSize;
+	const Vec3 maxVoxel = (box.Max() - m_Origin) * m_InvVoxelSize;
+	const i32 minX = max((i32)floor(minVoxel.x), 0);
+	const i32 minY = max((i32)floor(minVoxel.y), 0);
+	const i32 minZ = max((i32)floor(minVoxel.z), 0);
+	const i32 maxX = min((i32)floor(maxVoxel.x), (i32)m_DimX - 1);
+	const i32 maxY = min((i32)floor(maxVoxel.y), (i32)m_DimY - 1);
+	const i32 maxZ = min((i32)floor(maxVoxel.z), (i32)m_DimZ - 1);
+
+	for (i32 z = minZ; z <= maxZ; z++) {
+		for (i32 y = minY; y <= maxY; y++) {
+			for (i32 x = minX; x <= maxX; x++) {
+				u8& voxel = m_Voxels[(z * m_DimY + y) * m_DimX + x];
+				if (voxel == 0) {
+					voxel = 1;
+					m_NumSolid++;
+				}
+			}
+		}
+	}
+}
+
+/// kbParticleVoxelGrid::IsSolid
+bool kbParticleVoxelGrid::IsSolid(const Vec3& position) const {
+	const f32 fx = (position.x - m_Origin.x) * m_InvVoxelSize;
+	const f32 fy = (position.y - m_Origin.y) * m_InvVoxelSize;
+	const f32 fz = (position.z - m_Origin.z) * m_InvVoxelSize;
+	if ((fx >= 0.0f && fy >= 0.0f && fz >= 0.0f && fx < (f32)m_DimX && fy < (f32)m_DimY && fz < (f32)m_DimZ) == false) {
+		return false;
+	}
+
+	return m_Voxels[((u32)fz * m_DimY + (u32)fy) * m_DimX + (u32)fx] != 0;
+}
+
+/// kbParticleCollisionWorld::kbParticleCollisionWorld
+kbParticleCollisionWorld::kbParticleCollisionWorld() :
+	m_MSPerTest(0.0f),
+	m_NumTestsThisFrame(0),
+	m_DemandThisFrame(0),
+	m_DemandLastFrame(0),
+	m_NumReportedTests(0),
+	m_ReportedMS(0.0f),
+	m_NumTestsLastFrame(0),
+	m_NumDeferredLastFrame(0) {
+}
+
+/// kbParticleCollisionWorld::AddHeightField
+void kbParticleCollisionWorld::AddHeightField(const kbParticleHeightField* const pHeightField) {
+	if (pHeightField == nullptr || std::find(m_HeightFields.begin(), m_HeightFields.end(), pHeightField) != m_HeightFields.end()) {
+		return;
+	}
+
+	m_HeightFields.push_back(pHeightField);
+}
+
+/// kbParticleCollisionWorld::RemoveHeightField
+void kbParticleCollisionWorld::RemoveHeightField(const kbParticleHeightField* const pHeightField) {
+	blk::std_remove_swap(m_HeightFields, pHeightField);
+}
+
+/// kbParticleCollisionWorld::AddPlane
+void kbParticleCollisionWorld::AddPlane(const Vec4& plane) {
+	m_Planes.push_back(plane);
+}
+
+/// kbParticleCollisionWorld::RemovePlane
+void kbParticleCollisionWorld::RemovePlane(const Vec4& plane) {
+	for (size_t i = 0; i < m_Planes.size(); i++) {
+		const Vec4& curPlane = m_Planes[i];
+		if (curPlane.x == plane.x && curPlane.y == plane.y && curPlane.z == plane.z && curPlane.w == plane.w) {
+			m_Planes[i] = m_Planes.back();
+			m_Planes.pop_back();
+			return;
+		}
+	}
+}
+
+/// kbParticleCollisionWorld::RequestTests
+u32 kbParticleCollisionWorld::RequestTests(const u32 numWanted) {
+	m_DemandThisFrame += numWanted;
+
+	const f32 budgetMS = g_ParticleCollisionBudget.GetFloat();
+	if (budgetMS <= 0.0f || m_MSPerTest <= 0.0f) {
+		m_NumTestsThisFrame += numWanted;
+		return numWanted;
+	}
+
+	// Split the budget by last frame's demand so that the emitters updated first don't starve the rest
+	const u32 budgetTests = (u32)(budgetMS / m_MSPerTest);
+	u32 numGranted = numWanted;
+	if (m_DemandLastFrame > budgetTests) {
+		numGranted = (u32)(((u64)numWanted * budgetTests) / m_DemandLastFrame);
+	}
+
+	const u32 numLeft = (m_NumTestsThisFrame < budgetTests) ? (budgetTests - m_NumTestsThisFrame) : (0);
+	numGranted = min(numGranted, numLeft);
+	m_NumTestsThisFrame += numGranted;
+	return numGranted;
+}
+
+/// kbParticleCollisionWorld::ReportCost
+void kbParticleCollisionWorld::ReportCost(const u32 numTested, const f32 milliseconds) {
+	m_NumReportedTests += numTested;
+	m_ReportedMS += milliseconds;
+}
+
+/// kbParticleCollisionWorld::EndFrame
+void kbParticleCollisionWorld::EndFrame() {
+	// Smooth the measured cost so one slow frame doesn't halve the next frame's budget
+	if (m_NumReportedTests > 0) {
+		const f32 msPerTest = m_ReportedMS / m_NumReportedTests;
+		m_MSPerTest = (m_MSPerTest > 0.0f) ? (kbLerp(m_MSPerTest, msPerTest, 0.1f)) : (msPerTest);
+	}
+
+	m_NumTestsLastFrame = m_NumTestsThisFrame;
+	m_NumDeferredLastFrame = m_DemandThisFrame - m_NumTestsThisFrame;
+	m_DemandLastFrame = m_DemandThisFrame;
+
+	m_NumTestsThisFrame = 0;
+	m_DemandThisFrame = 0;
+	m_NumReportedTests = 0;
+	m_ReportedMS = 0.0f;
+}
+
+/// kbParticleCollisionWorld::Collide
+void kbParticleCollisionWorld::Collide(kbParticleBuffer& particles, const kbParticleSimParams_t& simParams, const kbParticleCollisionParams_t& params, const u32 first, const u32 count) const {
+	if (params.m_Response == PCR_None || HasColliders() == false) {
+		return;
+	}
+
+	const u32 end = min(first + count, particles.NumParticles());
+	for (u32 batchStart = first; batchStart < end; batchStart += BatchSize) {
+		CollideBatch(particles, simParams, params, batchStart, min(BatchSize, end - batchStart));
+	}
+}
+
+/// kbParticleCollisionWorld::CollideBatch
+void kbParticleCollisionWorld::CollideBatch(kbParticleBuffer& particles, const kbParticleSimParams_t& simParams, const kbParticleCollisionParams_t& params, const u32 first, const u32 count) const {
+	f32* const pPosX = particles.GetStream(PS_PositionX) + first;
+	f32* const pPosY = particles.GetStream(PS_PositionY) + first;
+	f32* const pPosZ = particles.GetStream(PS_PositionZ) + first;
+	f32* const pVelX = particles.GetStream(PS_VelocityX) + first;
+	f32* const pVelY = particles.GetStream(PS_VelocityY) + first;
+	f32* const pVelZ = particles.GetStream(PS_VelocityZ) + first;
+	f32* const pStuck = particles.GetStream(PS_Stuck) + first;
+
+	// Deepest penetration and its normal per particle.  Each collider type is tested over the whole batch so that
+	// its loop stays tight
+	f32 depth[BatchSize];
+	f32 normalX[BatchSize];
+	f32 normalY[BatchSize];
+	f32 normalZ[BatchSize];
+	for (u32 i = 0; i < count; i++) {
+		depth[i] = 0.0f;
+	}
+
+	const f32 radius = params.m_Radius;
+	for (size_t iPlane = 0; iPlane < m_Planes.size(); iPlane++) {
+		const Vec4& plane = m_Planes[iPlane];
+		for (u32 i = 0; i < count; i++) {
+			const f32 penetration = radius - (pPosX[i] * plane.x + pPosY[i] * plane.y + pPosZ[i] * plane.z + plane.w);
+			if (penetration > depth[i]) {
+				depth[i] = penetration;
+				normalX[i] = plane.x;
+				normalY[i] = plane.y;
+				normalZ[i] = plane.z;
+			}
+		}
+	}
+
+	for (size_t iField = 0; iField < m_HeightFields.size(); iField++) {
+		const kbParticleHeightField& heightField = *m_HeightFields[iField];
+		for (u32 i = 0; i < count; i++) {
+			f32 height;
+			if (heightField.GetHeight(pPosX[i], pPosZ[i], height) == false) {
+				continue;
+			}
+
+			const f32 penetration = height + radius - pPosY[i];
+			if (penetration > depth[i]) {
+				const Vec3 normal = heightField.GetNormal(pPosX[i], pPosZ[i]);
+				depth[i] = penetration;
+				normalX[i] = normal.x;
+				normalY[i] = normal.y;
+				normalZ[i] = normal.z;
+			}
+		}
+	}
+
+	// Voxels have no surface to measure against, so particles inside one are backed out along the path they came in on
+	const f32 deltaTime = simParams.m_DeltaTime;
+	if (m_VoxelGrid.IsValid()) {
+		for (u32 i = 0; i < count; i++) {
+			if (depth[i] > 0.0f || m_VoxelGrid.IsSolid(Vec3(pPosX[i], pPosY[i], pPosZ[i])) == false) {
+				continue;
+			}
+
+			const f32 speed = sqrt(pVelX[i] * pVelX[i] + pVelY[i] * pVelY[i] + pVelZ[i] * pVelZ[i]);
+			if (speed <= 0.0f) {
+				continue;
+			}
+
+			depth[i] = speed * deltaTime;
+			normalX[i] = -pVelX[i] / speed;
+			normalY[i] = -pVelY[i] / speed;
+			normalZ[i] = -pVelZ[i] / speed;
+		}
+	}
+
+	// Respond
+	f32* const pStartVelX = particles.GetStream(PS_StartVelocityX) + first;
+	f32* const pStartVelY = particles.GetStream(PS_StartVelocityY) + first;
+	f32* const pStartVelZ = particles.GetStream(PS_StartVelocityZ) + first;
+	f32* const pEndVelX = particles.GetStream(PS_EndVelocityX) + first;
+	f32* const pEndVelY = particles.GetStream(PS_EndVelocityY) + first;
+	f32* const pEndVelZ = particles.GetStream(PS_EndVelocityZ) + first;
+	f32* const pLifeLeft = particles.GetStream(PS_LifeLeft) + first;
+	f32* const pColorA = particles.GetStream(PS_ColorA) + first;
+	const f32* const pVelCurve = particles.GetStream(PS_VelocityCurve) + first;
+	const bool bVelocityCurve = simParams.m_pVelocityCurve != nullptr && simParams.m_pVelocityCurve->IsValid();
+
+	for (u32 i = 0; i < count; i++) {
+		if (depth[i] <= 0.0f || pStuck[i] > 0.0f) {
+			continue;
+		}
+
+		pPosX[i] += normalX[i] * depth[i];
+		pPosY[i] += normalY[i] * depth[i];
+		pPosZ[i] += normalZ[i] * depth[i];
+
+		if (params.m_Response == PCR_Die) {
+			pLifeLeft[i] = 0.0f;
+			pColorA[i] = 0.0f;
+			continue;
+		}
+
+		Vec3 newVelocity = Vec3::zero;
+		if (params.m_Response == PCR_Stick) {
+			pStuck[i] = 1.0f;
+		} else {
+			const Vec3 velocity(pVelX[i], pVelY[i], pVelZ[i]);
+			const Vec3 normal(normalX[i], normalY[i], normalZ[i]);
+			const f32 intoSurface = velocity.dot(normal);
+			if (intoSurface >= 0.0f) {
+				// Already moving away
+				continue;
+			}
+
+			const Vec3 normalVelocity = normal * intoSurface;
+			newVelocity = (velocity - normalVelocity) * (1.0f - params.m_Friction) - normalVelocity * params.m_Restitution;
+		}
+
+		// Simulate() rebuilds velocity from the start and end velocities each frame, so the change goes into those.
+		// Velocity curves only scale the start velocity
+		const Vec3 deltaVelocity(newVelocity.x - pVelX[i], newVelocity.y - pVelY[i], newVelocity.z - pVelZ[i]);
+		if (bVelocityCurve) {
+			if (pVelCurve[i] > 0.001f) {
+				const f32 invCurve = 1.0f / pVelCurve[i];
+				pStartVelX[i] += deltaVelocity.x * invCurve;
+				pStartVelY[i] += deltaVelocity.y * invCurve;
+				pStartVelZ[i] += deltaVelocity.z * invCurve;
+			}
+		} else {
+			pStartVelX[i] += deltaVelocity.x;
+			pStartVelY[i] += deltaVelocity.y;
+			pStartVelZ[i] += deltaVelocity.z;
+			pEndVelX[i] += deltaVelocity.x;
+			pEndVelY[i] += deltaVelocity.y;
+			pEndVelZ[i] += deltaVelocity.z;
+		}
+
+		pVelX[i] = newVelocity.x;
+		pVelY[i] = newVelocity.y;
+		pVelZ[i] = newVelocity.z;
+	}
+}
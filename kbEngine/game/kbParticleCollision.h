@@ -0,0 +1,136 @@
+/// kbParticleCollision.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+#include "kbBounds.h"
+
+class kbParticleBuffer;
+struct kbParticleSimParams_t;
+
+/// EParticleCollisionResponse
+enum EParticleCollisionResponse {
+	PCR_None,
+	PCR_Bounce,
+	PCR_Stick,
+	PCR_Die
+};
+
+/// kbParticleCollisionParams_t - Per emitter collision settings
+struct kbParticleCollisionParams_t {
+	kbParticleCollisionParams_t() : m_Response(PCR_None), m_Restitution(0.5f), m_Friction(0.2f), m_Radius(0.0f) { }
+
+	EParticleCollisionResponse m_Response;
+	f32 m_Restitution;		// Fraction of the velocity into the surface that's kept on a bounce
+	f32 m_Friction;			// Fraction of the velocity along the surface that's lost on a bounce
+	f32 m_Radius;
+};
+
+/// kbParticleHeightField - Evenly spaced world space heights over the xz plane
+class kbParticleHeightField {
+public:
+	kbParticleHeightField() : m_OriginX(0.0f), m_OriginZ(0.0f), m_CellSize(0.0f), m_InvCellSize(0.0f), m_DimX(0), m_DimZ(0) { }
+
+	/// heights are row major with dimX samples per row.  Sample (0, 0) is at originX, originZ
+	void Build(const f32 originX, const f32 originZ, const f32 cellSize, const u32 dimX, const u32 dimZ, const f32* const pHeights);
+	void Reset();
+
+	bool IsValid() const { return m_DimX > 1 && m_DimZ > 1; }
+
+	/// Returns false if x, z is outside of the field
+	bool GetHeight(const f32 x, const f32 z, f32& outHeight) const;
+	Vec3 GetNormal(const f32 x, const f32 z) const;
+
+private:
+	f32 GetSample(const i32 x, const i32 z) const { return m_Heights[kbClamp(z, 0, (i32)m_DimZ - 1) * m_DimX + kbClamp(x, 0, (i32)m_DimX - 1)]; }
+
+	std::vector<f32> m_Heights;
+	f32 m_OriginX;
+	f32 m_OriginZ;
+	f32 m_CellSize;
+	f32 m_InvCellSize;
+	u32 m_DimX;
+	u32 m_DimZ;
+};
+
+/// kbParticleVoxelGrid - Coarse occupancy of solid world geometry, one byte per voxel
+class kbParticleVoxelGrid {
+public:
+	kbParticleVoxelGrid() : m_VoxelSize(0.0f), m_InvVoxelSize(0.0f), m_DimX(0), m_DimY(0), m_DimZ(0), m_NumSolid(0) { }
+
+	void Init(const kbBounds& worldBounds, const f32 voxelSize);
+	void Reset();
+
+	/// Marks every voxel the box touches as solid
+	void AddBox(const kbBounds& box);
+
+	bool IsValid() const { return m_NumSolid > 0; }
+	bool IsSolid(const Vec3& position) const;
+
+	f32 GetVoxelSize() const { return m_VoxelSize; }
+
+private:
+	std::vector<u8> m_Voxels;
+	Vec3 m_Origin;
+	f32 m_VoxelSize;
+	f32 m_InvVoxelSize;
+	u32 m_DimX;
+	u32 m_DimY;
+	u32 m_DimZ;
+	u32 m_NumSolid;
+};
+
+/// kbParticleCollisionWorld
+///
+/// The height fields, planes and voxels that particles collide with, and the per-frame budget for testing against them.
+/// Colliders are only added and removed on the game thread outside of the particle jobs, so Collide() can run on any
+/// thread.  The budget is CPU time across all threads.  Emitters claim a share of it when they update, and the
+/// particles left over are tested on later frames
+class kbParticleCollisionWorld {
+public:
+	kbParticleCollisionWorld();
+
+	void AddHeightField(const kbParticleHeightField* const pHeightField);
+	void RemoveHeightField(const kbParticleHeightField* const pHeightField);
+
+	/// xyz is the normal and w is the distance along it to the origin
+	void AddPlane(const Vec4& plane);
+	void RemovePlane(const Vec4& plane);
+
+	kbParticleVoxelGrid& GetVoxelGrid() { return m_VoxelGrid; }
+
+	bool HasColliders() const { return m_HeightFields.size() > 0 || m_Planes.size() > 0 || m_VoxelGrid.IsValid(); }
+
+	/// Budget.  Returns how many of numWanted particles an emitter may test this frame
+	u32 RequestTests(const u32 numWanted);
+	void ReportCost(const u32 numTested, const f32 milliseconds);
+	void EndFrame();
+
+	u32 NumTestsLastFrame() const { return m_NumTestsLastFrame; }
+	u32 NumDeferredLastFrame() const { return m_NumDeferredLastFrame; }
+
+	/// Tests count particles starting at first and applies params.m_Response to the ones that hit
+	void Collide(kbParticleBuffer& particles, const kbParticleSimParams_t& simParams, const kbParticleCollisionParams_t& params, const u32 first, const u32 count) const;
+
+private:
+	static const u32 BatchSize = 64;
+
+	void CollideBatch(kbParticleBuffer& particles, const kbParticleSimParams_t& simParams, const kbParticleCollisionParams_t& params, const u32 first, const u32 count) const;
+
+	std::vector<const kbParticleHeightField*> m_HeightFields;
+	std::vector<Vec4> m_Planes;
+	kbParticleVoxelGrid m_VoxelGrid;
+
+	f32 m_MSPerTest;
+	u32 m_NumTestsThisFrame;
+	u32 m_DemandThisFrame;
+	u32 m_DemandLastFrame;
+	u32 m_NumReportedTests;
+	f32 m_ReportedMS;
+
+	u32 m_NumTestsLastFrame;
+	u32 m_NumDeferredLastFrame;
+};
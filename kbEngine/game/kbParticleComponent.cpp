@@ -10,25 +10,20 @@
 #include "kbGame.h"
 #include "kbRenderer.h"
 #include "renderer.h"
+#include "blk_console.h"
 
 
 KB_DEFINE_COMPONENT(kbParticleComponent)
 
-static const uint NumParticleBufferVerts = 10000;
+kbConsoleVariable g_ParallelParticles("parallelparticles", true, kbConsoleVariable::Console_Bool, "Simulate sprite emitters and write their instances on the job threads.", "");
+kbConsoleVariable g_ParticleBenchmark("particlebenchmark", false, kbConsoleVariable::Console_Bool, "Benchmark the particle simulation with 100k particles on the next particle component to update.", "");
+
+static const uint MaxParticleInstances = 10000;
 static const uint NumMeshVerts = 10000;
 // #define DX11_PARTICLES
 
-/// kbParticle_t::kbParticle_t
-kbParticle_t::kbParticle_t() {
-	m_pSrcModelEmitter = nullptr;
-}
-
-/// kbParticle_t::~kbParticle_t
-kbParticle_t::~kbParticle_t() {
-}
-
-/// kbParticle_t::Shutdown
-void kbParticle_t::Shutdown() {
+/// kbModelParticle_t::Shutdown
+void kbModelParticle_t::Shutdown() {
 #ifdef DX11_PARTICLES
 	if (m_render_object.m_pComponent != nullptr) {
 		g_pRenderer->RemoveRenderObject(m_render_object);
@@ -80,15 +75,30 @@ void kbParticleComponent::Constructor() {
 	m_gravity.set(0.0f, 0.0f, 0.0f);
 	m_render_order_bias = 0.0f;
 	m_DebugPlayEntity = false;
+	m_CollisionResponse = PCR_None;
+	m_CollisionBounce = 0.5f;
+	m_CollisionFriction = 0.2f;
+	m_CollisionRadius = 0.0f;
+	m_MaxLiveParticles = 0;
+	m_SpawnScale = 1.0f;
+	m_SpawnAccumulator = 0.0f;
+	m_NumCollisionTests = 0;
+	m_CollisionCursor = 0;
+	m_NumCollisionTested = 0;
+	m_CollisionMS = 0.0f;
 
 	m_LeftOverTime = 0.0f;
 	m_vertex_buffer = nullptr;
-	m_index_buffer = nullptr;
+	for (int i = 0; i < NumParticleBuffers; i++) {
+		m_num_instances[i] = 0;
+	}
 
 	m_buffer_to_fill = -1;
 	m_buffer_to_render = -1;
 
 	m_bIsSpawning = true;
+	m_bUpdatePending = false;
+	m_bQueuedForUpdate = false;
 
 	m_bIsPooled = false;
 	m_ParticleTemplate = nullptr;
@@ -109,6 +119,11 @@ void kbParticleComponent::StopParticleSystem() {
 
 	blk::error_check(g_pRenderer->IsRenderingSynced() == true, "kbParticleComponent::StopParticleSystem() - Shutting down particle component even though rendering is not synced");
 
+	if (m_bQueuedForUpdate) {
+		g_pGame->GetParticleManager().CancelParticleUpdate(this);
+	}
+	m_bUpdatePending = false;
+
 	if (IsModelEmitter()) {
 		return;
 	}
@@ -131,10 +146,18 @@ void kbParticleComponent::StopParticleSystem() {
 			m_models[i].UnmapIndexBuffer();		// todo : don't need to map/remap index buffer
 		}
 	}
+	m_vertex_buffer = nullptr;
 	m_buffer_to_fill = -1;
 	m_buffer_to_render = -1;
-	m_Particles.clear();
+	for (u32 i = 0; i < NumParticleBuffers; i++) {
+		m_num_instances[i] = 0;
+	}
+	m_Particles.Clear();
+	m_ModelParticles.clear();
+	m_PendingSpawns.clear();
 	m_LeftOverTime = 0.0f;
+	m_SpawnAccumulator = 0.0f;
+	m_CollisionCursor = 0;
 
 	//m_ParticleBillboardType = BT_FaceCamera;
 }
@@ -143,6 +166,14 @@ void kbParticleComponent::StopParticleSystem() {
 void kbParticleComponent::update_internal(const float DeltaTime) {
 	Super::update_internal(DeltaTime);
 
+	// An update from earlier this frame that the job threads haven't picked up yet
+	FinishParticleUpdate();
+
+	if (g_ParticleBenchmark.GetBool()) {
+		kbParticleBuffer::Benchmark(100000, 300);
+		g_ParticleBenchmark.SetBool(false);
+	}
+
 	if (m_StartDelay > 0) {
 		m_StartDelay -= DeltaTime;
 		if (m_StartDelay < 0) {
@@ -167,158 +198,228 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 		return;
 	}
 
-	Vec3 currentCameraPosition;
-	Quat4 currentCameraRotation;
-	g_pRenderer->GetRenderViewTransform(nullptr, currentCameraPosition, currentCameraRotation);
+	m_SimParams.m_DeltaTime = DeltaTime;
+	m_SimParams.m_Gravity = m_gravity;
+	m_SimParams.m_Scale = GetScale();
+	m_SimParams.m_StartColor = m_ParticleStartColor;
+	m_SimParams.m_EndColor = m_ParticleEndColor;
+	m_SimParams.m_pVelocityCurve = &m_VelocityCurveTable;
+	m_SimParams.m_pSizeCurve = &m_SizeCurveTable;
+	m_SimParams.m_pColorCurve = &m_ColorCurveTable;
+	m_SimParams.m_pAlphaCurve = &m_AlphaCurveTable;
+
+	m_NumCollisionTests = 0;
+	if (g_pGame != nullptr) {
+		kbParticleCollisionWorld& collisionWorld = g_pGame->GetParticleManager().GetCollisionWorld();
+		if (m_NumCollisionTested > 0) {
+			collisionWorld.ReportCost(m_NumCollisionTested, m_CollisionMS);
+			m_NumCollisionTested = 0;
+			m_CollisionMS = 0.0f;
+		}
 
-	int iVertex = 0;
-	int curVBPosition = 0;
-	const Vec3 scale = GetScale();
-	const Vec3 direction = GetOrientation().to_mat4()[2].ToVec3();
-	byte iBillboardType = 0;
-	switch (m_ParticleBillboardType) {
-		case EBillboardType::BT_FaceCamera: iBillboardType = 0; break;
-		case EBillboardType::BT_AxialBillboard: iBillboardType = 1; break;
-		case EBillboardType::BT_AlignAlongVelocity: iBillboardType = 1; break;
-		default: blk::warn("kbParticleComponent::update_internal() - Invalid billboard type specified"); break;
+		m_CollisionParams.m_Response = m_CollisionResponse;
+		m_CollisionParams.m_Restitution = m_CollisionBounce;
+		m_CollisionParams.m_Friction = m_CollisionFriction;
+		m_CollisionParams.m_Radius = m_CollisionRadius;
+		if (m_CollisionResponse != PCR_None && collisionWorld.HasColliders()) {
+			m_NumCollisionTests = collisionWorld.RequestTests(m_Particles.NumParticles());
+		}
 	}
 
-	kbParticleVertex* pDstVerts = nullptr;
-
-	for (int i = (int)m_Particles.size() - 1; i >= 0; i--) {
-		kbParticle_t& particle = m_Particles[i];
-
-		if (particle.m_LifeLeft >= 0.0f) {
-			particle.m_LifeLeft -= DeltaTime;
+	m_SpawnScale = 1.0f;
+	if (g_pGame != nullptr) {
+		m_SpawnScale = g_pGame->GetParticleManager().GetEmitterSpawnScale(this, GetPosition(), GetEffectRadius(), m_Particles.NumParticles());
+	}
 
-			if (particle.m_LifeLeft <= 0.0f || (IsModelEmitter() && particle.m_render_object.m_pComponent == nullptr)) {
-				particle.Shutdown();
-				blk::std_remove_idx_swap(m_Particles, i);
-				continue;
-			}
-		}
+	if (IsModelEmitter()) {
+		// Model particles add and move render objects, so they stay on the game thread
+		UpdateModelParticles();
+		SpawnParticles(DeltaTime);
+		return;
 	}
 
-	m_render_object.m_VertBufferIndexCount = (uint)m_Particles.size() * 6;
+	// Spawning uses rand() and the owner's transform, so it's decided here.  The new particles are added by the
+	// deferred update after the existing ones are simulated
+	SpawnParticles(DeltaTime);
+	RequestParticleUpdate();
+}
 
-#ifdef DX11_PARTICLES
-	if (IsModelEmitter() == false && m_Particles.size() > 0) {
-		kbParticleManager& particleMgr = g_pGame->GetParticleManager();
-		particleMgr.ReserveScratchBufferSpace(pDstVerts, m_render_object, (int)m_Particles.size() * 4);
-		blk::error_check(pDstVerts != nullptr, "kbParticleComponent::update_internal() - pDstVerts is null");
+/// kbParticleComponent::UpdateModelParticles
+void kbParticleComponent::UpdateModelParticles() {
 
-		for (int i = 0; i < m_Particles.size() * 4; i++) {
-			pDstVerts[i].position = Vec3::zero;
+	// Model emitters keep a render object per particle that has to follow it when the buffer swap removes
+	m_Particles.RemoveExpired(m_SimParams.m_DeltaTime, [this](const u32 removedIdx, const u32 lastIdx) {
+		if (m_ModelParticles.size() == 0) {
+			return;
 		}
-	}
-#endif
 
-	for (int i = (int)m_Particles.size() - 1; i >= 0; i--) {
-		kbParticle_t& particle = m_Particles[i];
-		const float normalizedTime = (particle.m_TotalLife - particle.m_LifeLeft) / particle.m_TotalLife;
-		Vec3 curVelocity = Vec3::zero;
+		m_ModelParticles[removedIdx].Shutdown();
+		if (removedIdx != lastIdx) {
+			m_ModelParticles[removedIdx] = m_ModelParticles[lastIdx];
+		}
+		m_ModelParticles.pop_back();
+	});
+
+	m_Particles.Simulate(m_SimParams);
+	CollideParticles();
+
+	const u32 numParticles = m_Particles.NumParticles();
+	m_render_object.m_VertBufferIndexCount = numParticles * 6;
+
+	const f32* const pNormalizedTime = m_Particles.GetStream(PS_NormalizedTime);
+	for (u32 i = 0; i < numParticles; i++) {
+		kbRenderObject& renderObj = m_ModelParticles[i].m_render_object;
+
+		renderObj.m_position = m_Particles.GetPosition(i);
+		//renderObj.m_Orientation = Quat4( 0.0f, 0.0f, 0.0f, 1.0f );	TODO
+		renderObj.m_Scale = m_Particles.GetSize(i);
+		renderObj.m_Scale *= kbLevelComponent::GetGlobalModelScale();
+
+		if (m_RotationCurveTable.IsValid()) {
+			const Vec4 rotationFactor = m_RotationCurveTable.EvaluateVector(pNormalizedTime[i]);
+			const Vec3 rotationAxis = m_Particles.GetRotationAxis(i);
+			Quat4 xAxis, yAxis, zAxis;
+			xAxis.from_axis_angle(Vec3(1.0f, 0.0f, 0.0f), kbToRadians(rotationAxis.x * rotationFactor.x));
+			yAxis.from_axis_angle(Vec3(0.0f, 1.0f, 0.0f), kbToRadians(rotationAxis.y * rotationFactor.y));
+			zAxis.from_axis_angle(Vec3(0.0f, 0.0f, 1.0f), kbToRadians(rotationAxis.z * rotationFactor.z));
+			renderObj.m_Orientation = xAxis * yAxis * zAxis;
+		}
 
-		if (m_velocityOverLifeTimeCurve.size() == 0) {
-			curVelocity = kbLerp(particle.m_StartVelocity, particle.m_EndVelocity, normalizedTime);
-		} else {
-			const float velCurve = kbAnimEvent::Evaluate(m_velocityOverLifeTimeCurve, normalizedTime);
-			curVelocity = particle.m_StartVelocity * velCurve;
+		const Vec4 curColor = m_Particles.GetColor(i);
+		for (int iMat = 0; iMat < renderObj.m_Materials.size(); iMat++) {
+			renderObj.m_Materials[iMat].SetVec4("particleColor", curColor);
 		}
 
-		curVelocity += m_gravity * (particle.m_TotalLife - particle.m_LifeLeft);
+#ifdef DX11_PARTICLES
+		g_pRenderer->UpdateRenderObject(renderObj);
+#endif
+	}
+}
 
-		particle.m_position = particle.m_position + curVelocity * DeltaTime;
+/// kbParticleComponent::RequestParticleUpdate
+void kbParticleComponent::RequestParticleUpdate() {
+#ifdef DX11_PARTICLES
+	// The DX11 scratch buffers are shared between emitters
+	UpdateParticles();
+	return;
+#endif
 
-		const float curRotationRate = kbLerp(particle.m_StartRotation, particle.m_EndRotation, normalizedTime);
-		particle.m_Rotation += curRotationRate * DeltaTime;
+	if (g_ParallelParticles.GetBool() == false || g_pGame == nullptr) {
+		UpdateParticles();
+		return;
+	}
 
-		Vec3 curSize = Vec3::zero;
-		if (m_SizeOverLifeTimeCurve.size() == 0) {
-			curSize = kbLerp(particle.m_StartSize * scale.x, particle.m_EndSize * scale.y, normalizedTime);
-		} else {
-			Vec3 eval = kbVectorAnimEvent::Evaluate(m_SizeOverLifeTimeCurve, normalizedTime).ToVec3();
-			curSize.x = eval.x * particle.m_StartSize.x * scale.x;
-			curSize.y = eval.y * particle.m_StartSize.y * scale.y;
-			curSize.z = eval.z * particle.m_StartSize.z * scale.z;
-		}
+	// An update finished early on the game thread leaves this component in the pending list, so it's only queued once
+	m_bUpdatePending = true;
+	if (m_bQueuedForUpdate == false) {
+		g_pGame->GetParticleManager().QueueParticleUpdate(this);
+	}
+}
 
-		Vec4 curColor = Vec4::zero;
-		if (m_ColorOverLifeTimeCurve.size() == 0) {
-			curColor = kbLerp(m_ParticleStartColor, m_ParticleEndColor, normalizedTime);
-		} else {
-			curColor = kbVectorAnimEvent::Evaluate(m_ColorOverLifeTimeCurve, normalizedTime);
-		}
+/// kbParticleComponent::UpdateParticles
+void kbParticleComponent::UpdateParticles() {
+	m_bUpdatePending = false;
 
-		if (m_AlphaOverLifeTimeCurve.size() == 0) {
-			curColor.w = kbLerp(m_ParticleStartColor.w, m_ParticleEndColor.w, normalizedTime);
-		} else {
-			curColor.w = kbAnimEvent::Evaluate(m_AlphaOverLifeTimeCurve, normalizedTime);
-		}
+	m_Particles.RemoveExpired(m_SimParams.m_DeltaTime, [](const u32 removedIdx, const u32 lastIdx) { });
+	m_Particles.Simulate(m_SimParams);
+	CollideParticles();
+	WriteParticleInstances();
 
-		byte byteColor[4] = { (byte)kbClamp(curColor.x * 255.0f, 0.0f, 255.0f), (byte)kbClamp(curColor.y * 255.0f, 0.0f, 255.0f), (byte)kbClamp(curColor.z * 255.0f, 0.0f, 255.0f), (byte)kbClamp(curColor.w * 255.0f, 0.0f, 255.0f) };
+	for (size_t i = 0; i < m_PendingSpawns.size(); i++) {
+		m_Particles.Add(m_PendingSpawns[i]);
+	}
+	m_PendingSpawns.clear();
+}
 
-		if (IsModelEmitter()) {
+/// kbParticleComponent::CollideParticles
+void kbParticleComponent::CollideParticles() {
+	const u32 numParticles = m_Particles.NumParticles();
+	const u32 numTests = min(m_NumCollisionTests, numParticles);
+	if (numTests == 0 || g_pGame == nullptr) {
+		return;
+	}
 
-			kbRenderObject& renderObj = particle.m_render_object;
+	kbTimer collisionTimer;
+	const kbParticleCollisionWorld& collisionWorld = g_pGame->GetParticleManager().GetCollisionWorld();
 
-			renderObj.m_position = particle.m_position;
-			//renderObj.m_Orientation = Quat4( 0.0f, 0.0f, 0.0f, 1.0f );	TODO
-			renderObj.m_Scale.set(curSize.x, curSize.y, curSize.z);
-			renderObj.m_Scale *= kbLevelComponent::GetGlobalModelScale();
+	// Swap removal reorders particles, so the round robin is only approximate.  Every particle still gets tested
+	// eventually when the budget is short
+	if (m_CollisionCursor >= numParticles) {
+		m_CollisionCursor = 0;
+	}
 
-			if (m_RotationOverLifeTimeCurve.size() > 0) {
-				const Vec4 rotationFactor = kbVectorAnimEvent::Evaluate(m_RotationOverLifeTimeCurve, normalizedTime);
-				Quat4 xAxis, yAxis, zAxis;
-				xAxis.from_axis_angle(Vec3(1.0f, 0.0f, 0.0f), kbToRadians(particle.m_rotation_axis.x * rotationFactor.x));
-				yAxis.from_axis_angle(Vec3(0.0f, 1.0f, 0.0f), kbToRadians(particle.m_rotation_axis.y * rotationFactor.y));
-				zAxis.from_axis_angle(Vec3(0.0f, 0.0f, 1.0f), kbToRadians(particle.m_rotation_axis.z * rotationFactor.z));
-				renderObj.m_Orientation = xAxis * yAxis * zAxis;
-			}
+	const u32 numBeforeWrap = min(numTests, numParticles - m_CollisionCursor);
+	collisionWorld.Collide(m_Particles, m_SimParams, m_CollisionParams, m_CollisionCursor, numBeforeWrap);
+	if (numTests > numBeforeWrap) {
+		collisionWorld.Collide(m_Particles, m_SimParams, m_CollisionParams, 0, numTests - numBeforeWrap);
+	}
+	m_CollisionCursor = (m_CollisionCursor + numTests) % numParticles;
 
-			for (int iMat = 0; iMat < renderObj.m_Materials.size(); iMat++) {
-				renderObj.m_Materials[iMat].SetVec4("particleColor", curColor);
-			}
+	m_NumCollisionTests = 0;
+	m_NumCollisionTested += numTests;
+	m_CollisionMS += collisionTimer.TimeElapsedMS();
+}
+
+/// kbParticleComponent::WriteParticleInstances
+void kbParticleComponent::WriteParticleInstances() {
+	const u32 numParticles = m_Particles.NumParticles();
+	m_render_object.m_VertBufferIndexCount = numParticles * 6;
+
+	const f32* const pRotation = m_Particles.GetStream(PS_Rotation);
+	const f32* const pSizeX = m_Particles.GetStream(PS_SizeX);
+	const f32* const pSizeY = m_Particles.GetStream(PS_SizeY);
+	const f32* const pColorR = m_Particles.GetStream(PS_ColorR);
+	const f32* const pColorG = m_Particles.GetStream(PS_ColorG);
+	const f32* const pColorB = m_Particles.GetStream(PS_ColorB);
+	const f32* const pColorA = m_Particles.GetStream(PS_ColorA);
+	const f32* const pRandom = m_Particles.GetStream(PS_Random0);
+
+	if (g_renderer != nullptr && m_vertex_buffer != nullptr && m_buffer_to_fill < (u32)NumParticleBuffers) {
+		// The vertex buffers only have room for this many instances
+		const u32 numInstances = min(numParticles, MaxParticleInstances);
+
+		for (u32 i = 0; i < numInstances; i++) {
+			ParticleVertex& instance = m_vertex_buffer[i];
+			instance.position = m_Particles.GetPosition(i);
+			instance.size.set(abs(pSizeX[i]), abs(pSizeY[i]));
+			instance.color[0] = (byte)kbClamp(pColorR[i] * 255.0f, 0.0f, 255.0f);
+			instance.color[1] = (byte)kbClamp(pColorG[i] * 255.0f, 0.0f, 255.0f);
+			instance.color[2] = (byte)kbClamp(pColorB[i] * 255.0f, 0.0f, 255.0f);
+			instance.color[3] = (byte)kbClamp(pColorA[i] * 255.0f, 0.0f, 255.0f);
+			instance.rotation = pRotation[i];
+			instance.random = pRandom[i];
+		}
+		m_num_instances[m_buffer_to_fill] = numInstances;
+	}
 
 #ifdef DX11_PARTICLES
-			g_pRenderer->UpdateRenderObject(renderObj);
-#endif
+	if (numParticles == 0) {
+		return;
+	}
 
-			continue;
-		}
+	const Vec3 direction = GetOrientation().to_mat4()[2].ToVec3();
+	byte iBillboardType = 0;
+	switch (m_ParticleBillboardType) {
+		case EBillboardType::BT_FaceCamera: iBillboardType = 0; break;
+		case EBillboardType::BT_AxialBillboard: iBillboardType = 1; break;
+		case EBillboardType::BT_AlignAlongVelocity: iBillboardType = 1; break;
+		default: blk::warn("kbParticleComponent::WriteParticleInstances() - Invalid billboard type specified"); break;
+	}
 
-		if (g_renderer != nullptr) {
-			const u32 idx = iVertex;
-			m_vertex_buffer[idx + 0].position = particle.m_position;
-			m_vertex_buffer[idx + 1].position = particle.m_position;
-			m_vertex_buffer[idx + 2].position = particle.m_position;
-			m_vertex_buffer[idx + 3].position = particle.m_position;
-
-			m_vertex_buffer[idx + 0].uv.set(0.0f, 0.0f);
-			m_vertex_buffer[idx + 1].uv.set(1.0f, 0.0f);
-			m_vertex_buffer[idx + 2].uv.set(1.0f, 1.0f);
-			m_vertex_buffer[idx + 3].uv.set(0.0f, 1.0f);
-
-			memcpy(&m_vertex_buffer[idx + 0].color, byteColor, sizeof(byteColor));
-			memcpy(&m_vertex_buffer[idx + 1].color, byteColor, sizeof(byteColor));
-			memcpy(&m_vertex_buffer[idx + 2].color, byteColor, sizeof(byteColor));
-			memcpy(&m_vertex_buffer[idx + 3].color, byteColor, sizeof(byteColor));
-
-			m_vertex_buffer[idx + 0].rotation = particle.m_Rotation;
-			m_vertex_buffer[idx + 1].rotation = particle.m_Rotation;
-			m_vertex_buffer[idx + 2].rotation = particle.m_Rotation;
-			m_vertex_buffer[idx + 3].rotation = particle.m_Rotation;
-
-			m_vertex_buffer[idx + 0].scale = abs(curSize.x);
-			m_vertex_buffer[idx + 1].scale = abs(curSize.x);
-			m_vertex_buffer[idx + 2].scale = abs(curSize.x);
-			m_vertex_buffer[idx + 3].scale = abs(curSize.x);
-		}
+	kbParticleVertex* pDstVerts = nullptr;
+	kbParticleManager& particleMgr = g_pGame->GetParticleManager();
+	particleMgr.ReserveScratchBufferSpace(pDstVerts, m_render_object, (int)numParticles * 4);
+	blk::error_check(pDstVerts != nullptr, "kbParticleComponent::WriteParticleInstances() - pDstVerts is null");
 
-#ifdef DX11_PARTICLES
-		pDstVerts[iVertex + 0].position = particle.m_position;
-		pDstVerts[iVertex + 1].position = particle.m_position;
-		pDstVerts[iVertex + 2].position = particle.m_position;
-		pDstVerts[iVertex + 3].position = particle.m_position;
+	for (u32 i = 0, iVertex = 0; i < numParticles; i++, iVertex += 4) {
+		const Vec3 position = m_Particles.GetPosition(i);
+		const Vec2 quadSize(pSizeX[i], pSizeY[i]);
+		byte byteColor[4] = { (byte)kbClamp(pColorR[i] * 255.0f, 0.0f, 255.0f), (byte)kbClamp(pColorG[i] * 255.0f, 0.0f, 255.0f), (byte)kbClamp(pColorB[i] * 255.0f, 0.0f, 255.0f), (byte)kbClamp(pColorA[i] * 255.0f, 0.0f, 255.0f) };
+
+		pDstVerts[iVertex + 0].position = position;
+		pDstVerts[iVertex + 1].position = position;
+		pDstVerts[iVertex + 2].position = position;
+		pDstVerts[iVertex + 3].position = position;
 
 		pDstVerts[iVertex + 0].uv.set(0.0f, 0.0f);
 		pDstVerts[iVertex + 1].uv.set(1.0f, 0.0f);
@@ -326,10 +427,10 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 		pDstVerts[iVertex + 3].uv.set(0.0f, 1.0f);
 
 
-		pDstVerts[iVertex + 0].size = Vec2(-curSize.x, curSize.y);
-		pDstVerts[iVertex + 1].size = Vec2(curSize.x, curSize.y);
-		pDstVerts[iVertex + 2].size = Vec2(curSize.x, -curSize.y);
-		pDstVerts[iVertex + 3].size = Vec2(-curSize.x, -curSize.y);
+		pDstVerts[iVertex + 0].size = Vec2(-quadSize.x, quadSize.y);
+		pDstVerts[iVertex + 1].size = Vec2(quadSize.x, quadSize.y);
+		pDstVerts[iVertex + 2].size = Vec2(quadSize.x, -quadSize.y);
+		pDstVerts[iVertex + 3].size = Vec2(-quadSize.x, -quadSize.y);
 
 		memcpy(&pDstVerts[iVertex + 0].color, byteColor, sizeof(byteColor));
 		memcpy(&pDstVerts[iVertex + 1].color, byteColor, sizeof(byteColor));
@@ -337,6 +438,7 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 		memcpy(&pDstVerts[iVertex + 3].color, byteColor, sizeof(byteColor));
 
 		if (m_ParticleBillboardType == EBillboardType::BT_AlignAlongVelocity) {
+			const Vec3 curVelocity = m_Particles.GetVelocity(i);
 			Vec3 alignVec = Vec3::up;
 			if (curVelocity.length_sqr() > 0.01f) {
 				alignVec = curVelocity.normalize_safe();
@@ -352,36 +454,36 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 			pDstVerts[iVertex + 3].direction = direction;
 		}
 
-		pDstVerts[iVertex + 0].rotation = particle.m_Rotation;
-		pDstVerts[iVertex + 1].rotation = particle.m_Rotation;
-		pDstVerts[iVertex + 2].rotation = particle.m_Rotation;
-		pDstVerts[iVertex + 3].rotation = particle.m_Rotation;
+		pDstVerts[iVertex + 0].rotation = pRotation[i];
+		pDstVerts[iVertex + 1].rotation = pRotation[i];
+		pDstVerts[iVertex + 2].rotation = pRotation[i];
+		pDstVerts[iVertex + 3].rotation = pRotation[i];
 
 		pDstVerts[iVertex + 0].billboardType[0] = iBillboardType;
 		pDstVerts[iVertex + 1].billboardType[0] = iBillboardType;
 		pDstVerts[iVertex + 2].billboardType[0] = iBillboardType;
 		pDstVerts[iVertex + 3].billboardType[0] = iBillboardType;
 
-		pDstVerts[iVertex + 0].billboardType[1] = (byte)kbClamp(particle.m_Randoms[0] * 255.0f, 0.0f, 255.0f);
+		pDstVerts[iVertex + 0].billboardType[1] = (byte)kbClamp(m_Particles.GetStream(PS_Random0)[i] * 255.0f, 0.0f, 255.0f);
 		pDstVerts[iVertex + 1].billboardType[1] = pDstVerts[iVertex + 0].billboardType[1];
 		pDstVerts[iVertex + 2].billboardType[1] = pDstVerts[iVertex + 0].billboardType[1];
 		pDstVerts[iVertex + 3].billboardType[1] = pDstVerts[iVertex + 0].billboardType[1];
 
-		pDstVerts[iVertex + 0].billboardType[2] = (byte)kbClamp(particle.m_Randoms[1] * 255.0f, 0.0f, 255.0f);
+		pDstVerts[iVertex + 0].billboardType[2] = (byte)kbClamp(m_Particles.GetStream(PS_Random1)[i] * 255.0f, 0.0f, 255.0f);
 		pDstVerts[iVertex + 1].billboardType[2] = pDstVerts[iVertex + 0].billboardType[2];
 		pDstVerts[iVertex + 2].billboardType[2] = pDstVerts[iVertex + 0].billboardType[2];
 		pDstVerts[iVertex + 3].billboardType[2] = pDstVerts[iVertex + 0].billboardType[2];
 
-		pDstVerts[iVertex + 0].billboardType[3] = (byte)kbClamp(particle.m_Randoms[2] * 255.0f, 0.0f, 255.0f);
+		pDstVerts[iVertex + 0].billboardType[3] = (byte)kbClamp(m_Particles.GetStream(PS_Random2)[i] * 255.0f, 0.0f, 255.0f);
 		pDstVerts[iVertex + 1].billboardType[3] = pDstVerts[iVertex + 0].billboardType[3];
 		pDstVerts[iVertex + 2].billboardType[3] = pDstVerts[iVertex + 0].billboardType[3];
 		pDstVerts[iVertex + 3].billboardType[3] = pDstVerts[iVertex + 0].billboardType[3];
-#endif
-
-		iVertex += 4;
-		curVBPosition++;
 	}
+#endif
+}
 
+/// kbParticleComponent::SpawnParticles
+void kbParticleComponent::SpawnParticles(const f32 DeltaTime) {
 	m_TimeAlive += DeltaTime;
 	if (m_TotalDuration > 0.0f && m_TimeAlive > m_TotalDuration && m_BurstCount <= 0) {
 		return;
@@ -390,26 +492,56 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 	const float invMinSpawnRate = (m_MinParticleSpawnRate > 0.0f) ? (1.0f / m_MinParticleSpawnRate) : (0.0f);
 	const float invMaxSpawnRate = (m_MaxParticleSpawnRate > 0.0f) ? (1.0f / m_MaxParticleSpawnRate) : (0.0f);
 	float TimeLeft = DeltaTime - m_LeftOverTime;
-	int currentListEnd = (int)m_Particles.size();
 	float NextSpawn = 0.0f;
 
 	Mat4 ownerMatrix = GetOwner()->GetOrientation().to_mat4();
 
+	auto advanceSpawnTime = [&]() {
+		if (m_BurstCount > 0) {
+			m_BurstCount--;
+		} else {
+			TimeLeft -= NextSpawn;
+			NextSpawn = invMaxSpawnRate + (kbfrand() * (invMinSpawnRate - invMaxSpawnRate));
+		}
+		m_NumEmittedParticles++;
+	};
+
+	kbParticleManager* const pParticleManager = (g_pGame != nullptr) ? (&g_pGame->GetParticleManager()) : (nullptr);
+	u32 numLiveParticles = m_Particles.NumParticles() + (u32)m_PendingSpawns.size();
+	u32 numCulledByLOD = 0;
+	u32 numCulledByCap = 0;
+
 	// Spawn particles
 	Vec3 MyPosition = GetPosition();
 	while (m_bIsSpawning && ((m_MaxParticleSpawnRate > 0 && TimeLeft >= NextSpawn) || m_BurstCount > 0) && (m_MaxParticlesToEmit <= 0 || m_NumEmittedParticles < m_MaxParticlesToEmit)) {
+
+		// LOD and the caps thin out spawns without touching the emitter's timing, so bursts and durations play out the same
+		m_SpawnAccumulator += m_SpawnScale;
+		if (m_SpawnAccumulator < 1.0f) {
+			numCulledByLOD++;
+			advanceSpawnTime();
+			continue;
+		}
+		m_SpawnAccumulator -= 1.0f;
+
+		if ((m_MaxLiveParticles > 0 && numLiveParticles >= (u32)m_MaxLiveParticles) || (pParticleManager != nullptr && pParticleManager->TrySpawnParticle() == false)) {
+			numCulledByCap++;
+			advanceSpawnTime();
+			continue;
+		}
+
 		if (m_MinStart3DOffset.compare(Vec3::zero) == false || m_MaxStart3DOffset.compare(Vec3::zero) == false) {
 			const Vec3 startingOffset = Vec3Rand(m_MinStart3DOffset, m_MaxStart3DOffset);
 			MyPosition += startingOffset;
 		}
 
-		kbParticle_t newParticle;
+		kbParticleSpawn_t newParticle;
+		kbModelParticle_t newModelParticle;
 		newParticle.m_StartVelocity = Vec3Rand(m_MinParticleStartVelocity, m_MaxParticleStartVelocity) * ownerMatrix;
 		newParticle.m_EndVelocity = Vec3Rand(m_MinParticleEndVelocity, m_MaxParticleEndVelocity) * ownerMatrix;
 
-		newParticle.m_position = MyPosition + newParticle.m_StartVelocity * TimeLeft;
-		newParticle.m_LifeLeft = m_ParticleMinDuration + (kbfrand() * (m_ParticleMaxDuration - m_ParticleMinDuration));
-		newParticle.m_TotalLife = newParticle.m_LifeLeft;
+		newParticle.m_Position = MyPosition + newParticle.m_StartVelocity * TimeLeft;
+		newParticle.m_Life = m_ParticleMinDuration + (kbfrand() * (m_ParticleMaxDuration - m_ParticleMinDuration));
 
 		const float startSizeRand = kbfrand();
 		newParticle.m_StartSize.x = m_MinParticleStartSize.x + (startSizeRand * (m_MaxParticleStartSize.x - m_MinParticleStartSize.x));
@@ -430,24 +562,24 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 		newParticle.m_Randoms[1] = kbfrand();
 		newParticle.m_Randoms[2] = kbfrand();
 
-		newParticle.m_StartRotation = kbfrand(m_MinStartRotationRate, m_MaxStartRotationRate);
-		newParticle.m_EndRotation = kbfrand(m_MinEndRotationRate, m_MaxEndRotationRate);
+		newParticle.m_StartRotationRate = kbfrand(m_MinStartRotationRate, m_MaxStartRotationRate);
+		newParticle.m_EndRotationRate = kbfrand(m_MinEndRotationRate, m_MaxEndRotationRate);
 
 		if (IsModelEmitter() && m_ModelEmitter.size()) {
 			const kbGameComponent* const pComponent = g_pGame->GetParticleManager().GetComponentFromPool();
 			if (pComponent != nullptr) {
 				const int randIdx = rand() % m_ModelEmitter.size();
 				kbModelEmitter* const pModelEmitter = &m_ModelEmitter[randIdx];
-				newParticle.m_pSrcModelEmitter = &m_ModelEmitter[randIdx];
+				newModelParticle.m_pSrcModelEmitter = &m_ModelEmitter[randIdx];
 
-				kbRenderObject& renderObj = newParticle.m_render_object;
+				kbRenderObject& renderObj = newModelParticle.m_render_object;
 				renderObj.m_pComponent = pComponent;
 
 				renderObj.m_model = pModelEmitter->model();
 				renderObj.m_Materials = pModelEmitter->GetShaderParamOverrides();
 				renderObj.m_render_pass = RP_Translucent;
 				renderObj.m_render_order_bias = 0;
-				renderObj.m_position = newParticle.m_position;
+				renderObj.m_position = newParticle.m_Position;
 
 				renderObj.m_Scale = Vec3::one;
 				renderObj.m_EntityId = 0;
@@ -459,11 +591,11 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 
 				renderObj.m_Orientation = Quat4(0.0f, 0.0f, 0.0f, 1.0f);
 				if (m_MinStart3DRotation.compare(Vec3::zero) == false || m_MaxStart3DRotation.compare(Vec3::zero) == false) {
-					newParticle.m_rotation_axis = Vec3Rand(m_MinStart3DRotation, m_MaxStart3DRotation);
+					newParticle.m_RotationAxis = Vec3Rand(m_MinStart3DRotation, m_MaxStart3DRotation);
 					Quat4 xAxis, yAxis, zAxis;
-					xAxis.from_axis_angle(Vec3(1.0f, 0.0f, 0.0f), kbToRadians(newParticle.m_rotation_axis.x));
-					yAxis.from_axis_angle(Vec3(0.0f, 1.0f, 0.0f), kbToRadians(newParticle.m_rotation_axis.y));
-					zAxis.from_axis_angle(Vec3(0.0f, 0.0f, 1.0f), kbToRadians(newParticle.m_rotation_axis.z));
+					xAxis.from_axis_angle(Vec3(1.0f, 0.0f, 0.0f), kbToRadians(newParticle.m_RotationAxis.x));
+					yAxis.from_axis_angle(Vec3(0.0f, 1.0f, 0.0f), kbToRadians(newParticle.m_RotationAxis.y));
+					zAxis.from_axis_angle(Vec3(0.0f, 0.0f, 1.0f), kbToRadians(newParticle.m_RotationAxis.z));
 
 					renderObj.m_Orientation = xAxis * yAxis * zAxis;
 				}
@@ -480,28 +612,42 @@ void kbParticleComponent::update_internal(const float DeltaTime) {
 			}
 		}
 
-		if (newParticle.m_StartRotation != 0 || newParticle.m_EndRotation != 0) {
+		if (newParticle.m_StartRotationRate != 0 || newParticle.m_EndRotationRate != 0) {
 			newParticle.m_Rotation = kbfrand() * kbPI;
 		} else {
 			newParticle.m_Rotation = 0;
 		}
 
-		if (m_BurstCount > 0) {
-			m_BurstCount--;
+		advanceSpawnTime();
+		numLiveParticles++;
+		if (IsModelEmitter()) {
+			m_Particles.Add(newParticle);
+			m_ModelParticles.push_back(newModelParticle);
 		} else {
-			TimeLeft -= NextSpawn;
-			NextSpawn = invMaxSpawnRate + (kbfrand() * (invMinSpawnRate - invMaxSpawnRate));
+			m_PendingSpawns.push_back(newParticle);
 		}
-
-		m_NumEmittedParticles++;
-		m_Particles.push_back(newParticle);
 	}
 
 
+	if (pParticleManager != nullptr && (numCulledByLOD > 0 || numCulledByCap > 0)) {
+		pParticleManager->ReportCulledParticles(numCulledByLOD, numCulledByCap);
+	}
+
 	//blk::log( "Num Indices = %d", m_NumIndicesInCurrentBuffer );
 	m_LeftOverTime = NextSpawn - TimeLeft;
 }
 
+/// kbParticleComponent::GetEffectRadius
+f32 kbParticleComponent::GetEffectRadius() const {
+	const Vec3 scale = GetScale();
+	const f32 maxScale = max(max(scale.x, scale.y), scale.z);
+	const f32 maxSize = max(max(m_MaxParticleStartSize.x, m_MaxParticleStartSize.y), max(m_MaxParticleEndSize.x, m_MaxParticleEndSize.y));
+	const f32 maxSpeed = max(max(m_MinParticleStartVelocity.length(), m_MaxParticleStartVelocity.length()), max(m_MinParticleEndVelocity.length(), m_MaxParticleEndVelocity.length()));
+
+	// Particles rarely travel their full speed for their full life, so half of it is used
+	return (maxSize * 0.5f + maxSpeed * m_ParticleMaxDuration * 0.5f) * maxScale;
+}
+
 /// kbParticleComponent::EditorChange
 void kbParticleComponent::editor_change(const std::string& propertyName) {
 	Super::editor_change(propertyName);
@@ -511,6 +657,8 @@ void kbParticleComponent::editor_change(const std::string& propertyName) {
 		for (int i = 0; i < this->m_materials.size(); i++) {
 			m_materials[i].SetOwningComponent(this);
 		}
+	} else if (propertyName == "VelocityCurve" || propertyName == "SizeOverLife" || propertyName == "RotationOverLife" || propertyName == "ColorOverLife" || propertyName == "AlphaOverLife") {
+		BakeCurves();
 	} else if (propertyName == "DebugPlayEntity") {
 		kbGameEntity* const pEnt = GetOwner();
 		const int numComp = (int)pEnt->NumComponents();
@@ -552,25 +700,9 @@ void kbParticleComponent::RenderSync() {
 	if (g_renderer != nullptr) {
 		if (m_models[0].NumVertices() == 0) {
 			for (u32 i = 0; i < NumParticleBuffers; i++) {
-				m_models[i].create_dynamic(NumParticleBufferVerts, NumParticleBufferVerts);
-				m_vertex_buffer = (ParticleVertex*)m_models[i].map_vertex_buffer();
-				for (u32 idx = 0; idx < NumParticleBufferVerts; idx++) {
-					m_vertex_buffer[idx].position.set(0.0f, 0.0f, 0.0f);
-					m_vertex_buffer[idx].uv.set(0.f, 0.f);
-				}
-				m_models[i].unmap_vertex_buffer();
-
-				m_index_buffer = (u16*)m_models[i].map_index_buffer();
-				for (u32 index_buf = 0, vertex_buf = 0; index_buf < NumParticleBufferVerts; index_buf += 6, vertex_buf += 4) {
-					m_index_buffer[index_buf + 0] = vertex_buf + 2;
-					m_index_buffer[index_buf + 1] = vertex_buf + 1;
-					m_index_buffer[index_buf + 2] = vertex_buf + 0;
-					m_index_buffer[index_buf + 3] = vertex_buf + 3;
-					m_index_buffer[index_buf + 4] = vertex_buf + 2;
-					m_index_buffer[index_buf + 5] = vertex_buf + 0;
-				}
-
-				m_models[i].unmap_index_buffer();
+				// One ParticleVertex per particle.  The quads are expanded by the vertex shader, so there's no index buffer to fill
+				m_models[i].create_dynamic(MaxParticleInstances, 0);
+				m_num_instances[i] = 0;
 			}
 		}
 	}
@@ -630,9 +762,9 @@ void kbParticleComponent::RenderSync() {
 	}
 
 	if (g_renderer != nullptr) {
+		// Only the instances written this frame are drawn, so stale ones don't need clearing
 		m_vertex_buffer = (ParticleVertex*)m_models[m_buffer_to_fill].map_vertex_buffer();
-		memset(m_vertex_buffer, 0, sizeof(vertexLayout)* m_models[m_buffer_to_fill].NumVertices());
-		//m_index_buffer = (u16*)m_models[m_buffer_to_fill].map_index_buffer();
+		m_num_instances[m_buffer_to_fill] = 0;
 	}
 
 	if (g_renderer != nullptr) {
@@ -645,6 +777,8 @@ void kbParticleComponent::enable_internal(const bool isEnabled) {
 	Super::enable_internal(isEnabled);
 
 	if (isEnabled) {
+		BakeCurves();
+
 		m_bIsSpawning = true;
 		m_NumEmittedParticles = 0;
 
@@ -673,11 +807,27 @@ void kbParticleComponent::enable_internal(const bool isEnabled) {
 			g_renderer->remove_render_component(this);
 		}
 
-		m_Particles.clear();
+		if (m_bQueuedForUpdate) {
+			g_pGame->GetParticleManager().CancelParticleUpdate(this);
+		}
+		m_bUpdatePending = false;
+
+		m_Particles.Clear();
+	m_ModelParticles.clear();
+		m_PendingSpawns.clear();
 		m_LeftOverTime = 0.0f;
 	}
 		}
 
+/// kbParticleComponent::BakeCurves
+void kbParticleComponent::BakeCurves() {
+	m_VelocityCurveTable.Bake(m_velocityOverLifeTimeCurve);
+	m_SizeCurveTable.Bake(m_SizeOverLifeTimeCurve);
+	m_RotationCurveTable.Bake(m_RotationOverLifeTimeCurve);
+	m_ColorCurveTable.Bake(m_ColorOverLifeTimeCurve);
+	m_AlphaCurveTable.Bake(m_AlphaOverLifeTimeCurve);
+}
+
 /// kbParticleComponent::EnableNewSpawns
 void kbParticleComponent::EnableNewSpawns(const bool bEnable) {
 	if (m_bIsSpawning == bEnable) {
@@ -3,6 +3,9 @@
 /// 2016-2025 blk 1.0
 #pragma once
 #include "kbModel.h"
+#include "kbParticleBuffer.h"
+#include "kbCurveTable.h"
+#include "kbParticleCollision.h"
 
 enum EBillboardType {
 	BT_FaceCamera,
@@ -10,32 +13,14 @@ enum EBillboardType {
 	BT_AlignAlongVelocity
 };
 
-struct kbParticle_t {
-	kbParticle_t();
-	kbParticle_t(const kbParticle_t&) = default;
-	~kbParticle_t();
-
-	kbParticle_t& operator=(const kbParticle_t&) = default;
+/// kbModelParticle_t - Per-particle data that only model emitters need.  Kept in step with the particle buffer
+struct kbModelParticle_t {
+	kbModelParticle_t() : m_pSrcModelEmitter(nullptr) { }
 
 	void Shutdown();
 
-	Vec3 m_position;
-	float m_Rotation;
-	Vec3 m_StartSize;
-	Vec3 m_EndSize;
-	float m_LifeLeft;
-	float m_TotalLife;
-	Vec3 m_StartVelocity;
-	Vec3 m_EndVelocity;
-	float m_StartRotation;
-	float m_EndRotation;
-	float m_Randoms[3];
-	Vec3 m_rotation_axis;
-
 	class kbModelEmitter* m_pSrcModelEmitter;
-
-	int m_CurrentModelIndex;
-	kbRenderObject m_render_object;		// For model emitters
+	kbRenderObject m_render_object;
 };
 
 /// kbModelEmitter
@@ -87,11 +72,38 @@ public:
 		}
 	}
 
+	/// Number of ParticleVertex instance records in get_model()'s vertex buffer.  Each one is drawn as a six vertex quad
+	u32 get_num_instances() const {
+		if (m_buffer_to_render != -1) {
+			return m_num_instances[m_buffer_to_render];
+		} else {
+			return 0;
+		}
+	}
+
 protected:
 	virtual void enable_internal(const bool isEnabled) override;
 	virtual void update_internal(const float DeltaTime) override;
 
 private:
+	void BakeCurves();
+
+	void SpawnParticles(const f32 DeltaTime);
+
+	/// Rough extent of the effect from its authored sizes, speeds and lifetimes.  Used for LOD
+	f32 GetEffectRadius() const;
+	void UpdateModelParticles();
+
+	/// Sprite emitters simulate and write their instances on the job threads once all entities have updated.  Only
+	/// touches this component's particle buffer and mapped vertex buffer
+	void RequestParticleUpdate();
+	void FinishParticleUpdate() { if (m_bUpdatePending) { UpdateParticles(); } }
+	void UpdateParticles();
+	void WriteParticleInstances();
+
+	/// Tests the particles granted by the collision budget, continuing from where last frame's tests stopped
+	void CollideParticles();
+
 	// Editable
 	std::vector<kbMaterialComponent> m_materials;
 	f32 m_TotalDuration;
@@ -131,6 +143,11 @@ private:
 	std::vector<kbModelEmitter>	m_ModelEmitter;
 	f32	m_render_order_bias;
 	bool m_DebugPlayEntity;
+	EParticleCollisionResponse m_CollisionResponse;
+	f32 m_CollisionBounce;
+	f32 m_CollisionFriction;
+	f32 m_CollisionRadius;
+	int m_MaxLiveParticles;
 
 	// Non-editable
 	f32 m_LeftOverTime;
@@ -138,15 +155,36 @@ private:
 	int	m_BurstCount;
 	f32	m_StartDelayRemaining;
 	int	m_NumEmittedParticles;
+	f32 m_SpawnScale;
+	f32 m_SpawnAccumulator;
 
 	kbRenderObject m_render_object;
-	std::vector<kbParticle_t> m_Particles;
+	kbParticleBuffer m_Particles;
+	std::vector<kbModelParticle_t> m_ModelParticles;
+
+	// Inputs to the deferred update
+	kbParticleSimParams_t m_SimParams;
+	std::vector<kbParticleSpawn_t> m_PendingSpawns;
+	kbParticleCollisionParams_t m_CollisionParams;
+	u32 m_NumCollisionTests;
+
+	// Written by the deferred update and reported to the collision budget on the next update
+	u32 m_CollisionCursor;
+	u32 m_NumCollisionTested;
+	f32 m_CollisionMS;
+
+	// Over life curves baked on enable and when edited
+	kbCurveTable m_VelocityCurveTable;
+	kbCurveTable m_SizeCurveTable;
+	kbCurveTable m_RotationCurveTable;
+	kbCurveTable m_ColorCurveTable;
+	kbCurveTable m_AlphaCurveTable;
 
 	// Dx12
 	static const int NumParticleBuffers = 3;
 	kbModel m_models[NumParticleBuffers];
+	u32 m_num_instances[NumParticleBuffers];
 	ParticleVertex* m_vertex_buffer;
-	u16* m_index_buffer;
 	//
 
 	u32 m_buffer_to_fill;
@@ -156,4 +194,6 @@ private:
 	const kbParticleComponent* m_ParticleTemplate;
 	bool m_bIsPooled;
 	bool m_bIsSpawning;
+	bool m_bUpdatePending;
+	bool m_bQueuedForUpdate;		// In the particle manager's pending list.  Can outlive m_bUpdatePending if the update finished early
 };
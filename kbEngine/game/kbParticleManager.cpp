@@ -2,10 +2,15 @@
 ///
 /// 2016-2025 blk 1.0
 
+#include <sstream>
+#include <iomanip>
 #include "blk_core.h"
+#include "blk_console.h"
 #include "kbParticleManager.h"
 #include "kbRenderer.h"
 #include "renderer.h"
+#include "blk_containers.h"
+#include "kbJobManager.h"
 
 static const uint NumParticleBufferVerts = 10000;
 static const uint NumCustomAtlases = 16;
@@ -13,8 +18,20 @@ static const uint ComponentPoolSize = 1000;
 static const uint NumScratchBuffers = 4;
 static const uint NumScratchBufferVerts = 50000;
 
+kbConsoleVariable g_ParticleLOD("particlelod", true, kbConsoleVariable::Console_Bool, "Scale emitter spawn rates by distance, screen coverage and the particle budget.", "");
+kbConsoleVariable g_ParticleLODNear("particlelodnear", 50.0f, kbConsoleVariable::Console_Float, "Distance inside of which emitters spawn at their authored rate.", "");
+kbConsoleVariable g_ParticleLODFar("particlelodfar", 500.0f, kbConsoleVariable::Console_Float, "Distance past which emitters stop spawning.", "");
+kbConsoleVariable g_ParticleLODMinCoverage("particlelodmincoverage", 0.005f, kbConsoleVariable::Console_Float, "Fraction of the screen's height an emitter must cover to spawn.", "");
+kbConsoleVariable g_ParticleMergeCellSize("particlemergecellsize", 20.0f, kbConsoleVariable::Console_Float, "Emitters of the same effect past particlelodnear that share a cell this size are merged into one.  0 disables merging.", "");
+kbConsoleVariable g_MaxParticles("maxparticles", 50000, kbConsoleVariable::Console_Int, "Most live particles across all emitters.  0 is unlimited.", "");
+kbConsoleVariable g_ShowParticleStats("showparticlestats", false, kbConsoleVariable::Console_Bool, "Display particle budget, LOD and collision stats.", "");
+
 /// kbParticleManager::kbParticleManager
 kbParticleManager::kbParticleManager() {
+	m_ViewerPosition = Vec3::zero;
+	m_ViewerProjScale = 1.0f;
+	m_bHasViewer = false;
+
 	m_ComponentPool.resize(ComponentPoolSize);
 	for (int i = 0; i < ComponentPoolSize; i++) {
 		m_ComponentPool[i] = new kbGameComponent();
@@ -53,6 +70,8 @@ kbParticleManager::kbParticleManager() {
 
 /// kbParticleManager::~kbParticleManager
 kbParticleManager::~kbParticleManager() {
+	WaitForParticleJobs();
+
 	for (int i = 0; i < m_CustomAtlases.size(); i++) {
 		CustomAtlasParticle_t& curAtlas = m_CustomAtlases[i];
 		for (int iBuffer = 0; iBuffer < NumCustomParticleBuffers; iBuffer++) {
@@ -222,8 +241,169 @@ void kbParticleManager::UpdateAtlas(CustomAtlasParticle_t& atlasInfo) {
 	atlasInfo.m_iCurParticleModel = -1;
 }
 
+static kbJobBatches<kbParticleComponent*> g_ParticleJobs;
+
+/// kbParticleManager::QueueParticleUpdate
+void kbParticleManager::QueueParticleUpdate(kbParticleComponent* const pParticle) {
+	blk::error_check(g_ParticleJobs.IsRunning() == false, "kbParticleManager::QueueParticleUpdate() - Particle jobs are already running");
+	if (pParticle->m_bQueuedForUpdate) {
+		return;
+	}
+
+	pParticle->m_bQueuedForUpdate = true;
+	m_PendingParticleUpdates.push_back(pParticle);
+}
+
+/// kbParticleManager::CancelParticleUpdate
+void kbParticleManager::CancelParticleUpdate(kbParticleComponent* const pParticle) {
+	WaitForParticleJobs();
+	blk::std_remove_swap(m_PendingParticleUpdates, pParticle);
+	pParticle->m_bQueuedForUpdate = false;
+}
+
+/// kbParticleManager::KickParticleJobs
+void kbParticleManager::KickParticleJobs() {
+	const size_t numPending = m_PendingParticleUpdates.size();
+	if (numPending == 0 || g_ParticleJobs.IsRunning()) {
+		return;
+	}
+
+	if (g_pJobManager == nullptr) {
+		for (size_t i = 0; i < numPending; i++) {
+			m_PendingParticleUpdates[i]->FinishParticleUpdate();
+			m_PendingParticleUpdates[i]->m_bQueuedForUpdate = false;
+		}
+		m_PendingParticleUpdates.clear();
+		return;
+	}
+
+	// Each emitter only writes its own particles and mapped vertex buffer, so batches can run in any order.  The game
+	// thread is free until render sync, so every batch goes to the job threads
+	static const size_t MinComponentsPerJob = 4;
+	g_ParticleJobs.Kick(m_PendingParticleUpdates.data(), numPending, MinComponentsPerJob, [](kbParticleComponent*& pParticle) { pParticle->FinishParticleUpdate(); }, false);
+}
+
+/// kbParticleManager::WaitForParticleJobs
+void kbParticleManager::WaitForParticleJobs() {
+	if (g_ParticleJobs.IsRunning() == false) {
+		return;
+	}
+
+	START_SCOPED_TIMER(RENDER_SYNC_PARTICLES);
+	g_ParticleJobs.Wait();
+
+	for (size_t i = 0; i < m_PendingParticleUpdates.size(); i++) {
+		m_PendingParticleUpdates[i]->m_bQueuedForUpdate = false;
+	}
+	m_PendingParticleUpdates.clear();
+}
+
+/// kbParticleManager::GetEmitterSpawnScale
+f32 kbParticleManager::GetEmitterSpawnScale(const kbParticleComponent* const pEmitter, const Vec3& position, const f32 radius, const u32 numLiveParticles) {
+	m_BudgetStats.m_NumEmitters++;
+	m_BudgetStats.m_NumLiveParticles += numLiveParticles;
+
+	if (g_ParticleLOD.GetBool() == false) {
+		return 1.0f;
+	}
+
+	f32 spawnScale = 1.0f;
+	if (m_bHasViewer) {
+		const f32 lodNear = g_ParticleLODNear.GetFloat();
+		const f32 lodFar = max(g_ParticleLODFar.GetFloat(), lodNear + 0.001f);
+		const f32 distance = (position - m_ViewerPosition).length();
+		spawnScale = 1.0f - kbSaturate((distance - lodNear) / (lodFar - lodNear));
+
+		// Fades out over the 4x coverage above the minimum
+		const f32 minCoverage = g_ParticleLODMinCoverage.GetFloat();
+		if (minCoverage > 0.0f && distance > radius) {
+			const f32 coverage = radius * m_ViewerProjScale / distance;
+			spawnScale = min(spawnScale, kbSaturate((coverage - minCoverage) / (3.0f * minCoverage)));
+		}
+	}
+
+	// Ease off as the global cap gets close so that TrySpawnParticle() rarely has to refuse
+	const i32 maxParticles = g_MaxParticles.GetInt();
+	if (maxParticles > 0) {
+		const f32 fullness = (f32)m_BudgetStatsLastFrame.m_NumLiveParticles / maxParticles;
+		spawnScale *= kbSaturate((1.0f - fullness) * 4.0f);
+	}
+
+	if (spawnScale <= 0.0f) {
+		m_BudgetStats.m_NumDroppedEmitters++;
+		return 0.0f;
+	}
+
+	// The first emitter of an effect to update in a cell spawns for all of them
+	const f32 mergeCellSize = g_ParticleMergeCellSize.GetFloat();
+	if (spawnScale < 1.0f && mergeCellSize > 0.0f && pEmitter->m_ParticleTemplate != nullptr) {
+		const f32 invCellSize = 1.0f / mergeCellSize;
+		const auto mergeCell = std::make_tuple(pEmitter->m_ParticleTemplate, (i32)floor(position.x * invCellSize), (i32)floor(position.y * invCellSize), (i32)floor(position.z * invCellSize));
+		if (m_MergeCells.insert(mergeCell).second == false) {
+			m_BudgetStats.m_NumMergedEmitters++;
+			return 0.0f;
+		}
+	}
+
+	return spawnScale;
+}
+
+/// kbParticleManager::TrySpawnParticle
+bool kbParticleManager::TrySpawnParticle() {
+	const i32 maxParticles = g_MaxParticles.GetInt();
+	if (maxParticles > 0 && m_BudgetStatsLastFrame.m_NumLiveParticles + m_BudgetStats.m_NumSpawned >= (u32)maxParticles) {
+		return false;
+	}
+
+	m_BudgetStats.m_NumSpawned++;
+	return true;
+}
+
+/// kbParticleManager::ReportCulledParticles
+void kbParticleManager::ReportCulledParticles(const u32 numCulledByLOD, const u32 numCulledByCap) {
+	m_BudgetStats.m_NumCulledByLOD += numCulledByLOD;
+	m_BudgetStats.m_NumCulledByCap += numCulledByCap;
+}
+
+/// kbParticleManager::EndBudgetFrame
+void kbParticleManager::EndBudgetFrame() {
+	m_BudgetStatsLastFrame = m_BudgetStats;
+	m_BudgetStats = kbParticleBudgetStats_t();
+	m_MergeCells.clear();
+	m_CollisionWorld.EndFrame();
+
+	// The game sets the camera after its entities update, so next frame's LOD uses this frame's view
+	if (g_pRenderer != nullptr) {
+		m_ViewerPosition = g_pRenderer->GetCameraPosition();
+		const f32 projScale = g_pRenderer->GetProjectionMatrix()[1][1];
+		m_ViewerProjScale = (projScale > 0.0f) ? (projScale) : (1.0f);
+		m_bHasViewer = true;
+	}
+
+	if (g_ShowParticleStats.GetBool() && g_pRenderer != nullptr) {
+		const kbParticleBudgetStats_t& stats = m_BudgetStatsLastFrame;
+		float curY = 0.1f;
+
+		std::stringstream stream;
+		stream << "Particles: " << stats.m_NumLiveParticles << " live, " << stats.m_NumSpawned << " spawned, " << stats.m_NumCulledByLOD << " culled by LOD, " << stats.m_NumCulledByCap << " culled by cap";
+		g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+		curY += g_DebugLineSpacing;
+
+		stream.str("");
+		stream << "Emitters: " << stats.m_NumEmitters << ", " << stats.m_NumDroppedEmitters << " dropped, " << stats.m_NumMergedEmitters << " merged";
+		g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+		curY += g_DebugLineSpacing;
+
+		stream.str("");
+		stream << "Collision tests: " << m_CollisionWorld.NumTestsLastFrame() << ", " << m_CollisionWorld.NumDeferredLastFrame() << " deferred";
+		g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+	}
+}
+
 /// kbParticleManager::RenderSync
 void kbParticleManager::RenderSync() {
+	EndBudgetFrame();
+
 	if (g_renderer != nullptr) {
 		return;
 	}
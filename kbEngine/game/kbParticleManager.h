@@ -5,12 +5,34 @@
 #pragma once
 
 #include <vector>
+#include <set>
+#include <tuple>
 #include "matrix.h"
 #include "kbGameEntityHeader.h"
 #include "kbParticleComponent.h"
 
 class kbParticleComponent;
 
+/// kbParticleBudgetStats_t - One frame of emitter updates
+struct kbParticleBudgetStats_t {
+	kbParticleBudgetStats_t() :
+		m_NumEmitters(0),
+		m_NumDroppedEmitters(0),
+		m_NumMergedEmitters(0),
+		m_NumLiveParticles(0),
+		m_NumSpawned(0),
+		m_NumCulledByLOD(0),
+		m_NumCulledByCap(0) { }
+
+	u32 m_NumEmitters;
+	u32 m_NumDroppedEmitters;		// Too far away or too small on screen to spawn
+	u32 m_NumMergedEmitters;		// Not spawning because a nearby emitter of the same effect is
+	u32 m_NumLiveParticles;
+	u32 m_NumSpawned;
+	u32 m_NumCulledByLOD;
+	u32 m_NumCulledByCap;
+};
+
 /// kbParticleManager
 class kbParticleManager {
 public:
@@ -27,6 +49,27 @@ public:
 
 	void RenderSync();
 
+	/// Sprite emitter updates queued during the entity update are simulated and written on the job threads between
+	/// KickParticleJobs() and WaitForParticleJobs().  Nothing may touch a queued component in between, so kick once all
+	/// entities have updated and wait before render sync
+	void QueueParticleUpdate(kbParticleComponent* const pParticle);
+	void CancelParticleUpdate(kbParticleComponent* const pParticle);
+	void KickParticleJobs();
+	void WaitForParticleJobs();
+
+	/// Colliders are added and removed on the game thread outside of KickParticleJobs() and WaitForParticleJobs()
+	kbParticleCollisionWorld& GetCollisionWorld() { return m_CollisionWorld; }
+
+	/// LOD and budget.  Emitters call these on the game thread as they update.  GetEmitterSpawnScale() returns the
+	/// fraction of the authored spawn rate the emitter gets this frame, or 0 if it's dropped or merged
+	f32 GetEmitterSpawnScale(const kbParticleComponent* const pEmitter, const Vec3& position, const f32 radius, const u32 numLiveParticles);
+
+	/// Returns false once the global particle cap is reached
+	bool TrySpawnParticle();
+	void ReportCulledParticles(const u32 numCulledByLOD, const u32 numCulledByCap);
+
+	const kbParticleBudgetStats_t& GetBudgetStats() const { return m_BudgetStatsLastFrame; }
+
 	struct CustomParticleAtlasInfo_t {
 		EBillboardType m_Type;
 		Vec3 m_position;
@@ -93,6 +136,20 @@ private:
 
 	std::vector<const kbGameComponent*>	m_ComponentPool;
 
+	std::vector<kbParticleComponent*> m_PendingParticleUpdates;
+	size_t m_NumParticleJobs;
+
+	kbParticleCollisionWorld m_CollisionWorld;
+
+	// Budget
+	kbParticleBudgetStats_t m_BudgetStats;
+	kbParticleBudgetStats_t m_BudgetStatsLastFrame;
+	std::set<std::tuple<const kbParticleComponent*, i32, i32, i32>> m_MergeCells;
+	Vec3 m_ViewerPosition;
+	f32 m_ViewerProjScale;
+	bool m_bHasViewer;
+
 private:
 	void UpdateAtlas(CustomAtlasParticle_t& atlasInfo);
+	void EndBudgetFrame();
 };
@@ -5,28 +5,26 @@
 #include <filesystem>
 #include "blk_core.h"
 #include "blk_containers.h"
+#include "blk_console.h"
+#include "blk_file_system.h"
 #include "kbFile.h"
+#include "kbBinaryPackage.h"
 #include "kbMaterial.h"
 #include "kbModel.h"
 #include "kbSoundManager.h"
 #include "kbGameEntityHeader.h"
+#include "kbTypeInfoSerializer.h"
+#include "kbResourceStreamer.h"
+#include "blk_file_watcher.h"
 
 kbResourceManager g_ResourceManager;
 
-namespace fs = std::filesystem;
-
-/// kbLoadResourceJob
-class kbLoadResourceJob : public kbJob {
-public:
-	kbLoadResourceJob() :
-		m_Resource(nullptr) { }
-
-	virtual void Run() {
-		m_Resource->Load();
-	}
+kbConsoleVariable g_BinaryPackages("binarypackages", false, kbConsoleVariable::Console_Bool, "Save packages in the binary format.  Text and binary packages both load either way.", "");
+kbConsoleVariable g_PackageBenchmark("packagebenchmark", false, kbConsoleVariable::Console_Bool, "Benchmark text against binary loading on the next text package to load.", "");
+kbConsoleVariable g_TypeInfoBenchmark("typeinfobenchmark", false, kbConsoleVariable::Console_Bool, "Benchmark reflection lookups, walks and copies over the components of the next package to load.", "");
+kbConsoleVariable g_HotReloadDebounceMS("hotreloaddebouncems", 150.0f, kbConsoleVariable::Console_Float, "Milliseconds a changed asset has to go without being written before it's hot reloaded.", "");
 
-	kbResource* m_Resource;
-};
+namespace fs = std::filesystem;
 
 /// kbResource::Reload
 void kbResource::Load() {
@@ -34,7 +32,7 @@ void kbResource::Load() {
 	const float loadStartTime = g_GlobalTimer.TimeElapsedSeconds();
 
 	if (m_bIsLoaded == false) {
-		if (Load_Internal()) {
+		if (Load_Internal() && Upload_Internal()) {
 			m_bIsLoaded = true;
 		}
 	}
@@ -46,6 +44,14 @@ void kbResource::Load() {
 	// blk::log( "It took %f seconds to load %s.  Total resource load time = %f", curLoadTime, GetFullFileName().c_str(), totalLoadTime );
 }
 
+/// kbResource::GetStreamedData
+const kbFileData* kbResource::GetStreamedData(const std::string& fileName) const {
+	if (m_pStreamedFile == nullptr || m_pStreamedFile->m_FileName != fileName) {
+		return nullptr;
+	}
+	return &m_pStreamedFile->m_Data;
+}
+
 /// kbResource::Release
 void kbResource::Release() {
 	Release_Internal();
@@ -54,133 +60,82 @@ void kbResource::Release() {
 }
 
 /// kbResourceManager::kbResourceManager
-kbResourceManager::kbResourceManager() {
-	m_hGameAssetDirectory = CreateFile("./assets/",
-									GENERIC_READ | FILE_LIST_DIRECTORY,
-									FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-									nullptr,
-									OPEN_EXISTING,
-									FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
-									nullptr);
-
-	m_hEngineAssetDirectory = CreateFile("../../kbEngine/assets/",
-		GENERIC_READ | FILE_LIST_DIRECTORY,
-		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-		nullptr,
-		OPEN_EXISTING,
-		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
-		nullptr);
-
-	ZeroMemory(&m_Ovl, sizeof(m_Ovl));
-	//	m_Ovl.hEvent = ::CreateEvent( nullptr, FALSE, FALSE, nullptr );
+kbResourceManager::kbResourceManager() :
+	m_pFileWatcher(nullptr) {
+	m_pStreamer = new kbResourceStreamer();
 }
 
 /// kbResourceManager::~kbResourceManager
 kbResourceManager::~kbResourceManager() {
 	Shutdown();
+
+	delete m_pStreamer;
+	m_pStreamer = nullptr;
 }
 
 /// kbResourceManager::RenderSync
 void kbResourceManager::RenderSync() {
-	for (int i = 0; i < m_ResourcesToLoad.size(); i++) {
-		m_ResourcesToLoad[i]->Load();
-	}
-	m_ResourcesToLoad.clear();
+	m_pStreamer->Update();
 
 	UpdateHotReloads();
 }
 
 /// kbResourceManager::UpdateHotReloads
 void kbResourceManager::UpdateHotReloads() {
-
-	static std::vector<std::wstring> queuedFiles;
-
-	static float lastUpdateTimeSecs = 0;
-	const float totalSeconds = g_GlobalTimer.TimeElapsedSeconds();
-	if (totalSeconds < lastUpdateTimeSecs + 0.05f) {
-		return;
-	}
-	lastUpdateTimeSecs = totalSeconds;
-
-	// Handle queued up modified files
-	if (queuedFiles.size() > 0) {
-
-		for (int i = 0; i < queuedFiles.size(); i++) {
-			const std::wstring& fileName = queuedFiles[i];
-			FileModifiedCB(fileName);
-		}
-
-		for (int i = 0; i < m_FunctionCallbacks.size(); i++) {
-			m_FunctionCallbacks[i].m_pFunc(CBR_FileModified);
+	static fs::file_time_type lastRescanTime;
+	if (m_pFileWatcher == nullptr) {
+		m_pFileWatcher = new kbFileWatcher();
+		m_pFileWatcher->Watch("./assets/");
+		m_pFileWatcher->Watch("../../kbEngine/assets/");
+		lastRescanTime = fs::file_time_type::clock::now();
+	}
+
+	std::vector<std::string> changedFiles;
+	std::vector<std::string> overflowedDirectories;
+	m_pFileWatcher->GetChanges(changedFiles, overflowedDirectories, g_HotReloadDebounceMS.GetFloat());
+
+	// Events were dropped, so pick up anything written since the last time this happened
+	if (overflowedDirectories.empty() == false) {
+		const fs::file_time_type rescanTime = fs::file_time_type::clock::now();
+		for (size_t i = 0; i < overflowedDirectories.size(); i++) {
+			blk::warn("kbResourceManager::UpdateHotReloads() - Missed changes in %s.  Rescanning it", overflowedDirectories[i].c_str());
+
+			std::error_code error;
+			for (fs::recursive_directory_iterator it(overflowedDirectories[i], error), end; it != end; it.increment(error)) {
+				if (it->is_regular_file(error) && it->last_write_time(error) >= lastRescanTime) {
+					const std::string fileName = it->path().string();
+					if (blk::std_contains(changedFiles, fileName) == false) {
+						changedFiles.push_back(fileName);
+					}
+				}
+			}
 		}
+		lastRescanTime = rescanTime;
 	}
-	queuedFiles.clear();
-
-	static int states[] = { 0,0 };
-	HANDLE handles[] = { m_hGameAssetDirectory, m_hEngineAssetDirectory };
-	static byte* buffers[2] = { new byte[2048], new byte[2048] };
-	DWORD numBytes = 0;
-
-	for (int i = 0; i < 2; i++) {
-		if (states[i] == 0) {
-			BOOL result = ReadDirectoryChangesW(handles[i],
-												 buffers[i],
-												 2048,
-												 TRUE,
-												 FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
-												 &numBytes,
-												 &m_Ovl[i],
-												 nullptr);
-
-			if (result == false) {
-				continue;
-			}
 
-			states[i] = 1;
+	std::vector<kbResource*> reloads;
+	bool bFileModified = false;
+	for (size_t i = 0; i < changedFiles.size(); i++) {
+		const std::string& fileName = changedFiles[i];
+		if (fileName.find('~') != std::string::npos || GetFileExtension(fileName).empty()) {
+			continue;
 		}
 
-		FILE_NOTIFY_INFORMATION* pCurInfo = (FILE_NOTIFY_INFORMATION*)buffers[i];
-		byte* pByteCurInfo = buffers[i];
-
-		if (GetOverlappedResult(handles[i], &m_Ovl[i], &numBytes, FALSE)) {
-			while (pCurInfo->Action != 0) {
-				states[i] = 0;
-
-				const DWORD FileNameLength = (pCurInfo->FileNameLength) / 2;
-				std::wstring fileName;
-
-				fileName.resize(FileNameLength);
-				bool bHasTilda = false;
-				for (DWORD i = 0; i < FileNameLength; i++) {
-
-					fileName[i] = pCurInfo->FileName[i];
-					if (fileName[i] == '~') {
-						bHasTilda = true;
-						break;
-					}
-				}
+		bFileModified = true;
+		FileModifiedCB(fileName, reloads);
+	}
 
-				if (bHasTilda == false && GetFileExtension(fileName).empty() == false) {
-					std::replace(fileName.begin(), fileName.end(), '/', '\\');
-					std::wstring fullFileName;
-					if (i == 0) {
-						fullFileName = L".\\assets\\" + fileName;
-					} else {
-						fullFileName = L"..\\..\\kbEngine\\assets\\" + fileName;
-					}
+	for (size_t i = 0; i < reloads.size(); i++) {
+		kbResource* const pResource = reloads[i];
+		blk::log("Hot reloading %s", pResource->GetFullFileName().c_str());
 
-					if (blk::std_contains(queuedFiles, fullFileName) == false) {
-						queuedFiles.push_back(fullFileName);
-					} else {
-						static int breakhere = 0;
-						breakhere++;
-					}
-				}
+		ClearDependencies(pResource);
+		m_pStreamer->Reload(pResource);
+	}
 
-				pCurInfo->Action = 0;
-				pByteCurInfo += pCurInfo->NextEntryOffset;
-				pCurInfo = (FILE_NOTIFY_INFORMATION*)pByteCurInfo;
-			}
+	if (bFileModified) {
+		for (int i = 0; i < m_FunctionCallbacks.size(); i++) {
+			m_FunctionCallbacks[i].m_pFunc(CBR_FileModified);
 		}
 	}
 }
@@ -206,7 +161,14 @@ kbResource* kbResourceManager::GetResource(const kbString& fullFileName, const b
 
 		kbResource* const pResource = mapEntry->second;
 		if (bLoadImmediately && pResource->m_bIsLoaded == false) {
-			pResource->Load();
+			if (m_pStreamer->IsStreamerThread()) {
+				// Finish with any streaming job first so it doesn't load alongside this one
+				m_pStreamer->Cancel(pResource, true);
+				pResource->Load();
+			} else {
+				// Job threads, like a shader decode resolving its default textures, can't wait on the streamer
+				m_pStreamer->Request(pResource, StreamPriority_Critical);
+			}
 		}
 
 		return pResource;
@@ -263,32 +225,65 @@ kbResource* kbResourceManager::GetResource(const kbString& fullFileName, const b
 }
 
 /// kbResourceManager::AsyncLoadResource
-kbResource* kbResourceManager::AsyncLoadResource(const kbString& stringName) {
+kbResource* kbResourceManager::AsyncLoadResource(const kbString& stringName, const kbStreamPriority_t priority) {
+	kbResource* const pResource = GetResource(stringName, false, true);
+	if (pResource == nullptr) {
+		blk::warn("kbResourceManager::AsyncLoadResource() - Failed to kick off a job for %s", stringName.c_str());
+		return nullptr;
+	}
+
+	m_pStreamer->Request(pResource, priority);
+	return (pResource->m_bIsLoaded) ? (pResource) : (nullptr);
+}
+
+/// kbResourceManager::CancelAsyncLoad
+void kbResourceManager::CancelAsyncLoad(const kbString& stringName) {
 	auto mapEntry = m_ResourcesMap.find(stringName);
 	if (mapEntry != m_ResourcesMap.end()) {
-		kbResource* const pResource = mapEntry->second;
-		if (pResource->m_bIsLoaded) {
-			return pResource;
-		}
+		m_pStreamer->Cancel(mapEntry->second);
+	}
+}
 
-		// Check if resource is currently being loaded
-		for (int j = 0; j < m_LoadResourceJobs.size(); j++) {
-			if (m_LoadResourceJobs[j]->m_Resource == mapEntry->second) {
-				return nullptr;
-			}
-		}
+/// kbResourceManager::IsStreaming
+bool kbResourceManager::IsStreaming(const kbString& stringName) const {
+	auto mapEntry = m_ResourcesMap.find(stringName);
+	return mapEntry != m_ResourcesMap.end() && m_pStreamer->IsStreaming(mapEntry->second);
+}
 
-		// Create a new loading job for this resources
-		kbLoadResourceJob* const pLoadJob = new kbLoadResourceJob();
-		pLoadJob->m_Resource = pResource;
-		m_LoadResourceJobs.push_back(pLoadJob);
-		g_pJobManager->RegisterJob(pLoadJob);
+/// kbResourceManager::DumpStreamingStats
+void kbResourceManager::DumpStreamingStats() const {
+	m_pStreamer->DumpStats();
+}
 
-		return nullptr;
+/// kbResourceManager::GetDependencyName
+std::string kbResourceManager::GetDependencyName(const std::string& fileName) {
+	return kbFileSystem::NormalizePath(fs::path(fileName).lexically_normal().generic_string());
+}
+
+/// kbResourceManager::AddDependency
+void kbResourceManager::AddDependency(kbResource* const pResource, const std::string& fileName) {
+	std::lock_guard<std::mutex> lock(m_DependencyLock);
+
+	// Staging copies are loading on behalf of the live resource
+	kbResource* const pDependent = (pResource->m_pReloadTarget != nullptr) ? (pResource->m_pReloadTarget) : (pResource);
+	std::vector<kbResource*>& dependents = m_Dependents[GetDependencyName(fileName)];
+	if (blk::std_contains(dependents, pDependent) == false) {
+		dependents.push_back(pDependent);
 	}
+}
 
-	blk::warn("kbResourceManager::AsyncLoadResource() - Failed to kick off a job for %s", stringName.c_str());
-	return nullptr;
+/// kbResourceManager::ClearDependencies
+void kbResourceManager::ClearDependencies(const kbResource* const pResource) {
+	std::lock_guard<std::mutex> lock(m_DependencyLock);
+
+	for (auto it = m_Dependents.begin(); it != m_Dependents.end();) {
+		blk::std_remove_swap(it->second, pResource);
+		if (it->second.empty()) {
+			it = m_Dependents.erase(it);
+		} else {
+			++it;
+		}
+	}
 }
 
 /// kbResourceManager::AddPrefab
@@ -361,26 +356,60 @@ void kbResourceManager::UpdatePrefab(const kbPrefab* const pPrefab, std::vector<
 		return;
 	}
 
-	const kbGUID guid = pPrefab->GetGameEntity(0)->GetGUID();
-
 	kbPrefab* const updatedPrefab = const_cast<kbPrefab*>(pPrefab);
-	for (int i = 0; i < updatedPrefab->m_GameEntities.size(); i++) {
-		delete updatedPrefab->m_GameEntities[i];
+
+	// Patch the prefab's entities in place when the layout matches so they keep their GUIDs
+	bool bSameLayout = updatedPrefab->m_GameEntities.size() == pEntityList.size();
+	for (int i = 0; i < pEntityList.size() && bSameLayout; i++) {
+		bSameLayout = kbTypeInfoSerializer::HasSameLayout(updatedPrefab->m_GameEntities[i], pEntityList[i]);
 	}
-	updatedPrefab->m_GameEntities.clear();
 
-	for (int i = 0; i < pEntityList.size(); i++) {
-		kbGameEntity* const pNewEntity = new kbGameEntity(pEntityList[i], true, &guid);
-		updatedPrefab->m_GameEntities.push_back(pNewEntity);
-		blk::log("Update prefab %d.  GUID is %d %d %d %d", (INT_PTR)pNewEntity, guid.m_iGuid[0], guid.m_iGuid[1], guid.m_iGuid[2], guid.m_iGuid[3]);
+	bool bChanged = false;
+	if (bSameLayout) {
+		std::vector<byte> delta;
+		for (int i = 0; i < pEntityList.size(); i++) {
+			delta.clear();
+			if (kbTypeInfoSerializer::DiffEntity(updatedPrefab->m_GameEntities[i], pEntityList[i], delta) == false) {
+				continue;
+			}
+
+			if (kbTypeInfoSerializer::ApplyEntity(delta, updatedPrefab->m_GameEntities[i]) == false) {
+				blk::warn("kbResourceManager::UpdatePrefab() - Failed to apply delta to %s", pPrefab->GetPrefabName().c_str());
+			}
+			bChanged = true;
+		}
+	} else {
+		const kbGUID guid = pPrefab->GetGameEntity(0)->GetGUID();
+		for (int i = 0; i < updatedPrefab->m_GameEntities.size(); i++) {
+			delete updatedPrefab->m_GameEntities[i];
+		}
+		updatedPrefab->m_GameEntities.clear();
+
+		for (int i = 0; i < pEntityList.size(); i++) {
+			kbGameEntity* const pNewEntity = new kbGameEntity(pEntityList[i], true, &guid);
+			updatedPrefab->m_GameEntities.push_back(pNewEntity);
+			blk::log("Update prefab %d.  GUID is %d %d %d %d", (INT_PTR)pNewEntity, guid.m_iGuid[0], guid.m_iGuid[1], guid.m_iGuid[2], guid.m_iGuid[3]);
+		}
+		bChanged = true;
+	}
+
+	if (bChanged == false) {
+		return;
 	}
 
-	// Hack
+	// Only the package that owns the prefab needs to be saved
 	for (int i = 0; i < m_pPackages.size(); i++) {
 		if (m_pPackages[i] == nullptr) {
 			continue;
 		}
-		SavePackage(m_pPackages[i]->GetPackageName());
+
+		for (int iFolder = 0; iFolder < m_pPackages[i]->m_Folders.size(); iFolder++) {
+			const std::vector<kbPrefab*>& prefabList = m_pPackages[i]->m_Folders[iFolder].m_pPrefabs;
+			if (std::find(prefabList.begin(), prefabList.end(), pPrefab) != prefabList.end()) {
+				SavePackage(m_pPackages[i]->GetPackageName());
+				return;
+			}
+		}
 	}
 }
 
@@ -394,10 +423,25 @@ kbPackage* kbResourceManager::GetPackage(const std::string& FullPackageName, con
 		}
 	}
 
-	kbFile newFile;
-	newFile.Open(FullPackageName, kbFile::kbFileType_t::FT_Read);
-	kbPackage* const pPackage = newFile.ReadPackage(bLoadImmediately);
-	newFile.Close();
+	kbPackage* pPackage = nullptr;
+	if (kbBinaryPackage::IsBinaryPackage(FullPackageName)) {
+		pPackage = kbBinaryPackage::Read(FullPackageName, bLoadImmediately);
+	} else {
+		if (g_PackageBenchmark.GetBool()) {
+			kbBinaryPackage::Benchmark(FullPackageName, 10);
+			g_PackageBenchmark.SetBool(false);
+		}
+
+		kbFile newFile;
+		newFile.Open(FullPackageName, kbFile::kbFileType_t::FT_Read);
+		pPackage = newFile.ReadPackage(bLoadImmediately);
+		newFile.Close();
+	}
+
+	if (pPackage == nullptr) {
+		blk::warn("kbResourceManager::GetPackage() - Failed to load %s", FullPackageName.c_str());
+		return nullptr;
+	}
 
 	for (int iFolder = 0; iFolder < pPackage->m_Folders.size(); iFolder++) {
 
@@ -407,6 +451,23 @@ kbPackage* kbResourceManager::GetPackage(const std::string& FullPackageName, con
 		}
 	}
 
+	if (g_TypeInfoBenchmark.GetBool()) {
+		std::vector<const kbComponent*> components;
+		for (int iFolder = 0; iFolder < pPackage->m_Folders.size(); iFolder++) {
+			const std::vector< class kbPrefab* >& PrefabList = pPackage->m_Folders[iFolder].m_pPrefabs;
+			for (int iPrefab = 0; iPrefab < PrefabList.size(); iPrefab++) {
+				for (int iEntity = 0; iEntity < PrefabList[iPrefab]->NumGameEntities(); iEntity++) {
+					const kbGameEntity* const pEntity = PrefabList[iPrefab]->GetGameEntity(iEntity);
+					for (size_t iComponent = 0; iComponent < pEntity->NumComponents(); iComponent++) {
+						components.push_back(pEntity->GetComponent(iComponent));
+					}
+				}
+			}
+		}
+		BenchmarkTypeInfo(components, 100);
+		g_TypeInfoBenchmark.SetBool(false);
+	}
+
 	m_pPackages.push_back(pPackage);
 
 	return pPackage;
@@ -431,6 +492,12 @@ void kbResourceManager::SavePackage(const std::string& PackageName) {
 			if (GetFileExtension(PackageName) != "kbPkg") {
 				PackageName += ".kbPkg";
 			}
+
+			if (g_BinaryPackages.GetBool()) {
+				kbBinaryPackage::Write(PackageName, *m_pPackages[i]);
+				break;
+			}
+
 			newFile.Open(PackageName, kbFile::kbFileType_t::FT_Write);
 			newFile.WritePackage(*m_pPackages[i]);
 			newFile.Close();
@@ -454,6 +521,16 @@ void kbResourceManager::DumpPackageInfo() {
 
 /// kbResourceManager::Shutdown
 void kbResourceManager::Shutdown() {
+	if (m_pFileWatcher != nullptr) {
+		m_pFileWatcher->Stop();
+		delete m_pFileWatcher;
+		m_pFileWatcher = nullptr;
+	}
+
+	if (m_pStreamer != nullptr) {
+		m_pStreamer->Shutdown();
+	}
+
 	for (auto it = m_ResourcesMap.begin(); it != m_ResourcesMap.end(); ++it) {
 		kbResource* const pResource = it->second;
 		pResource->Release();
@@ -466,35 +543,56 @@ void kbResourceManager::Shutdown() {
 	}
 	m_pPackages.clear();
 
-	CloseHandle(m_hGameAssetDirectory);
-	m_hGameAssetDirectory = nullptr;
-
-	CloseHandle(m_hEngineAssetDirectory);
-	m_hEngineAssetDirectory = nullptr;
+	std::lock_guard<std::mutex> lock(m_DependencyLock);
+	m_Dependents.clear();
 }
 
 /// kbResourceManager::FileModifiedCB
-void kbResourceManager::FileModifiedCB(const std::wstring& fileName) {
-
-	std::wstring convertedFileName = fileName;
-	std::transform(convertedFileName.begin(), convertedFileName.end(), convertedFileName.begin(), ::tolower);
-	fs::path p = fs::canonical(convertedFileName.c_str());
+void kbResourceManager::FileModifiedCB(const std::string& fileName, std::vector<kbResource*>& outReloads) {
+	bool bIsDependency = false;
+	{
+		std::lock_guard<std::mutex> lock(m_DependencyLock);
+		auto dependents = m_Dependents.find(GetDependencyName(fileName));
+		if (dependents != m_Dependents.end()) {
+			bIsDependency = true;
+			for (size_t i = 0; i < dependents->second.size(); i++) {
+				if (blk::std_contains(outReloads, dependents->second[i]) == false) {
+					outReloads.push_back(dependents->second[i]);
+				}
+			}
+		}
+	}
 
-	// TODO HOT RELOADING
-	for (auto it = m_ResourcesMap.begin(); it != m_ResourcesMap.end(); ++it) {
+	kbResource* pResource = GetResource(fileName, false, false);
+	if (pResource == nullptr && bIsDependency == false) {
+		// The resource may have been loaded through a different relative path
+		std::error_code error;
+		const fs::path p = fs::canonical(fileName, error);
+		for (auto it = m_ResourcesMap.begin(); it != m_ResourcesMap.end() && error.value() == 0; ++it) {
+			std::error_code resourceError;
+			if (fs::canonical(it->second->GetFullFileName(), resourceError) == p && resourceError.value() == 0) {
+				pResource = it->second;
+				break;
+			}
+		}
+	}
 
-		kbResource* const pCurResource = it->second;
-		fs::path resourcePath = fs::canonical(pCurResource->GetFullFileName());
-		if (resourcePath.string() == p.string()) {
-			blk::log("Hot reloading %s", p.string().c_str());
-			pCurResource->Release();
-			pCurResource->Load();
-			return;
+	if (pResource != nullptr) {
+		if (blk::std_contains(outReloads, pResource) == false) {
+			outReloads.push_back(pResource);
 		}
+		return;
 	}
 
-	blk::log("Loading %s", p.string().c_str());
-	GetResource(p.string(), true, true);
+	if (bIsDependency) {
+		return;
+	}
+
+	pResource = GetResource(fileName, false, true);
+	if (pResource != nullptr) {
+		blk::log("Loading %s", pResource->GetFullFileName().c_str());
+		m_pStreamer->Request(pResource, StreamPriority_High);
+	}
 }
 
 /// kbResourceManager::RegisterCB
@@ -4,12 +4,24 @@
 
 #pragma once
 
+#include <mutex>
+
+/// kbStreamPriority_t - Higher priorities are read first and uploaded first
+enum kbStreamPriority_t {
+	StreamPriority_Low = 0,
+	StreamPriority_Normal,
+	StreamPriority_High,
+	StreamPriority_Critical,
+	StreamPriority_Num
+};
+
 /// kbResource
 class kbResource {
 	friend class kbResourceManager;
+	friend class kbResourceStreamer;
 
 public:
-	kbResource() { m_LastLoadTime = -1.0f, m_bIsLoaded = false; }
+	kbResource() { m_LastLoadTime = -1.0f, m_bIsLoaded = false, m_pStreamedFile = nullptr, m_pReloadTarget = nullptr; }
 	virtual	~kbResource() = 0 { }
 
 	virtual kbTypeInfoType_t GetType() const = 0;
@@ -28,6 +40,21 @@ protected:
 	virtual bool Load_Internal() { blk::warn("Make pure virtual"); return false; }
 	virtual void Release_Internal() {}
 
+	/// Device work that has to happen on the render thread.  Streamed resources run Load_Internal() on a job thread
+	virtual bool Upload_Internal() { return true; }
+
+	/// The file the streamer reads ahead of Load_Internal()
+	virtual std::string GetStreamFileName() const { return m_FullFileName; }
+
+	/// Returns the bytes the streamer read for fileName, or nullptr if the resource isn't streaming or read a different file
+	const class kbFileData* GetStreamedData(const std::string& fileName) const;
+
+	/// Hot reloads decode into an unloaded copy of the resource on a job thread, so the live one keeps its data if the
+	/// new file fails to load.  Once the copy uploads, SwapStagedData() trades everything it loaded with the live
+	/// resource on the render thread.  Types that return nullptr are released and loaded again in place
+	virtual kbResource* CreateStagingCopy() const { return nullptr; }
+	virtual void SwapStagedData(kbResource* const pStaged) { }
+
 	// todo: make pure virtual
 	virtual bool load_internal() { blk::warn("Make pure virtual"); return false; }
 	virtual void release_internal() { blk::warn("Make pure virtual"); }
@@ -36,6 +63,9 @@ protected:
 	std::string	m_FullFileName;
 	kbString m_FullName;
 
+	const struct kbStreamedFile_t* m_pStreamedFile;
+	kbResource* m_pReloadTarget;			// The live resource when this is a staging copy
+
 	float m_LastLoadTime;
 
 	bool m_bIsLoaded;
@@ -45,6 +75,8 @@ protected:
 class kbPackage {
 	friend class kbResourceManager;
 	friend class kbFile;
+	friend class kbBinaryPackage;
+	friend class kbBinaryPackageReader;
 
 public:
 	const size_t NumFolders() const { return m_Folders.size(); }
@@ -74,10 +106,20 @@ public:
 
 	void RenderSync();
 
+	/// Off the streaming thread, bLoadImmediately only requests the resource at StreamPriority_Critical, since the
+	/// streamer may already be loading it
 	kbResource* GetResource(const std::string& fullFileName, const bool bLoadImmediately, const bool bLoadIfNotFound);
 	kbResource* GetResource(const kbString& fullFileName, const bool bLoadImmediately, const bool bLoadIfNotFound);
 
-	kbResource* AsyncLoadResource(const kbString& stringName);
+	/// Streams the resource in.  Returns it if it's already loaded, otherwise nullptr until it's been uploaded
+	kbResource* AsyncLoadResource(const kbString& stringName, const kbStreamPriority_t priority = StreamPriority_Normal);
+	void CancelAsyncLoad(const kbString& stringName);
+	bool IsStreaming(const kbString& stringName) const;
+	void DumpStreamingStats() const;
+
+	/// Hot reloads pResource whenever fileName changes, along with its own file.  Resources add these while loading, so
+	/// they're cleared each time a resource reloads.  Safe to call from job threads
+	void AddDependency(kbResource* const pResource, const std::string& fileName);
 
 	bool AddPrefab(class kbGameEntity* pEntity, const std::string& package, const std::string& folder, const std::string& file, const bool bOverwrite, kbPrefab** prefab = NULL);
 	void UpdatePrefab(const kbPrefab* const pPrefab, std::vector<kbGameEntity*>& pEntityList);
@@ -104,20 +146,25 @@ public:
 private:
 	void UpdateHotReloads();
 
-	void FileModifiedCB(const std::wstring& fileName);
+	/// Adds the resources that need reloading because fileName changed
+	void FileModifiedCB(const std::string& fileName, std::vector<kbResource*>& outReloads);
+
+	void ClearDependencies(const kbResource* const pResource);
+
+	/// Dependencies are matched on the file's normalized path, with any ".." collapsed
+	static std::string GetDependencyName(const std::string& fileName);
 
 	std::unordered_map<kbString, kbResource*, kbStringHash>	m_ResourcesMap;
-	std::vector<kbResource*> m_ResourcesToLoad;		// Loaded during render sync
 
 	std::vector<kbPackage*>	m_pPackages;
 	std::map<kbGUID, const kbGameEntity*> m_GuidToEntityMap;
 
-	std::vector<class kbLoadResourceJob*> m_LoadResourceJobs;
+	class kbResourceStreamer* m_pStreamer;
 
 	// Hot reloading
-	HANDLE m_hGameAssetDirectory;
-	HANDLE m_hEngineAssetDirectory;
-	OVERLAPPED m_Ovl[2];
+	class kbFileWatcher* m_pFileWatcher;
+	std::unordered_map<std::string, std::vector<kbResource*>> m_Dependents;
+	std::mutex m_DependencyLock;
 
 	struct CallbackInfo {
 		CallbackInfo(ResourceManagerCB inFunc, const CallbackReason reason) : m_pFunc(inFunc), m_CBReason(reason) { }
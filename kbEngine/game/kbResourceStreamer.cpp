@@ -0,0 +1,418 @@
+/// kbResourceStreamer.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "blk_containers.h"
+#include "blk_console.h"
+#include "kbResourceManager.h"
+#include "kbResourceStreamer.h"
+
+kbConsoleVariable g_StreamMaxReads("streammaxreads", 4, kbConsoleVariable::Console_Int, "Max number of resource files being read at once.", "");
+kbConsoleVariable g_StreamUploadBudget("streamuploadbudget", 2.0f, kbConsoleVariable::Console_Float, "Milliseconds per frame the render thread spends uploading streamed resources.", "");
+kbConsoleVariable g_StreamHitchMS("streamhitchms", 4.0f, kbConsoleVariable::Console_Float, "Frames that spend longer than this uploading streamed resources are logged as hitches.", "");
+kbConsoleVariable g_StreamStats("streamstats", false, kbConsoleVariable::Console_Bool, "Log resource streaming latencies and hitches.", "");
+
+static const size_t g_MaxStreamHitches = 32;
+
+/// kbResourceStreamer::RunJob
+void kbResourceStreamer::RunJob(kbStreamRequest_t* const pRequest) {
+	if (pRequest->m_State == StreamState_Reading) {
+		pRequest->m_ReadStartMS = pRequest->m_Timer.TimeElapsedMS();
+
+		if (g_FileSystem.ReadFile(pRequest->m_File.m_FileName, pRequest->m_File.m_Data)) {
+			pRequest->m_File.m_Data.Prefetch();
+		} else {
+			// Decode falls back to reading the file itself
+			pRequest->m_File.m_FileName.clear();
+		}
+
+		pRequest->m_ReadEndMS = pRequest->m_Timer.TimeElapsedMS();
+		return;
+	}
+
+	pRequest->m_DecodeStartMS = pRequest->m_Timer.TimeElapsedMS();
+
+	kbResource* const pResource = (pRequest->m_pStaging != nullptr) ? (pRequest->m_pStaging) : (pRequest->m_pResource);
+	pResource->m_pStreamedFile = &pRequest->m_File;
+	pRequest->m_bSucceeded = pResource->Load_Internal();
+	pResource->m_pStreamedFile = nullptr;
+
+	pRequest->m_File.m_Data.Release();
+
+	pRequest->m_DecodeEndMS = pRequest->m_Timer.TimeElapsedMS();
+}
+
+/// kbResourceStreamer::kbResourceStreamer
+kbResourceStreamer::kbResourceStreamer() :
+	m_StreamerThread(std::this_thread::get_id()),
+	m_NumReading(0),
+	m_Frame(0) {
+}
+
+/// kbResourceStreamer::~kbResourceStreamer
+kbResourceStreamer::~kbResourceStreamer() {
+	Shutdown();
+}
+
+/// kbResourceStreamer::Request
+void kbResourceStreamer::Request(kbResource* const pResource, const kbStreamPriority_t priority) {
+	if (pResource == nullptr || pResource->m_bIsLoaded) {
+		return;
+	}
+
+	std::unique_lock<std::recursive_mutex> lock(m_Lock);
+	std::unordered_map<const kbResource*, kbStreamRequest_t*>::iterator it = m_Requests.find(pResource);
+	if (it != m_Requests.end()) {
+		kbStreamRequest_t* const pRequest = it->second;
+		pRequest->m_bCancelled = false;
+
+		if (priority > pRequest->m_Priority) {
+			pRequest->m_Priority = priority;
+			if (pRequest->m_State == StreamState_Queued) {
+				m_Queues[priority].push_back(pResource);
+			}
+		}
+		return;
+	}
+
+	// Tools run without job threads
+	if (g_pJobManager == nullptr) {
+		lock.unlock();
+		pResource->Load();
+		return;
+	}
+
+	kbStreamRequest_t* const pRequest = new kbStreamRequest_t();
+	pRequest->m_pResource = pResource;
+	pRequest->m_Priority = priority;
+	pRequest->m_Job.m_pRequest = pRequest;
+	m_Requests[pResource] = pRequest;
+	m_Queues[priority].push_back(pResource);
+}
+
+/// kbResourceStreamer::Cancel
+void kbResourceStreamer::Cancel(kbResource* const pResource, const bool bWaitForJobs) {
+	blk::error_check(IsStreamerThread(), "kbResourceStreamer::Cancel() - Called off the streamer thread for %s", pResource->GetFullFileName().c_str());
+
+	std::unique_lock<std::recursive_mutex> lock(m_Lock);
+	std::unordered_map<const kbResource*, kbStreamRequest_t*>::iterator it = m_Requests.find(pResource);
+	if (it == m_Requests.end()) {
+		return;
+	}
+
+	kbStreamRequest_t* const pRequest = it->second;
+	pRequest->m_bCancelled = true;
+
+	if (pRequest->m_State == StreamState_Queued) {
+		// Its queue entry is skipped once the request is gone
+		Retire(pRequest);
+		return;
+	}
+
+	if (pRequest->m_State == StreamState_Uploading) {
+		blk::std_remove_swap(m_ReadyToUpload, pRequest);
+		if (pRequest->m_bSucceeded && pRequest->m_pStaging == nullptr) {
+			pResource->Release_Internal();
+		}
+		Retire(pRequest);
+		return;
+	}
+
+	if (bWaitForJobs) {
+		// The job may be decoding a resource that requests others
+		lock.unlock();
+		pRequest->m_Job.WaitForJob();
+		RetireJobs();
+	}
+}
+
+/// kbResourceStreamer::IsStreaming
+bool kbResourceStreamer::IsStreaming(const kbResource* const pResource) const {
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	return m_Requests.find(pResource) != m_Requests.end();
+}
+
+/// kbResourceStreamer::NumRequests
+size_t kbResourceStreamer::NumRequests() const {
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	return m_Requests.size();
+}
+
+/// kbResourceStreamer::Reload
+void kbResourceStreamer::Reload(kbResource* const pResource) {
+	if (pResource == nullptr) {
+		return;
+	}
+
+	// Anything already in flight read the old file
+	Cancel(pResource, true);
+
+	kbResource* const pStaging = CreateStaging(pResource);
+	if (pStaging == nullptr) {
+		pResource->Release();
+		pResource->Load();
+		return;
+	}
+
+	if (g_pJobManager == nullptr) {
+		if (pStaging->Load_Internal() && pStaging->Upload_Internal()) {
+			pResource->SwapStagedData(pStaging);
+			pResource->m_bIsLoaded = true;
+			pResource->m_LastLoadTime = g_GlobalTimer.TimeElapsedSeconds();
+		} else {
+			blk::warn("kbResourceStreamer::Reload() - Failed to reload %s.  Keeping the old data", pResource->GetFullFileName().c_str());
+		}
+		DestroyStaging(pStaging);
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	kbStreamRequest_t* const pRequest = new kbStreamRequest_t();
+	pRequest->m_pResource = pResource;
+	pRequest->m_Priority = StreamPriority_Critical;
+	pRequest->m_pStaging = pStaging;
+	pRequest->m_Job.m_pRequest = pRequest;
+	m_Requests[pResource] = pRequest;
+	m_Queues[StreamPriority_Critical].push_back(pResource);
+}
+
+/// kbResourceStreamer::Update
+void kbResourceStreamer::Update() {
+	m_StreamerThread = std::this_thread::get_id();
+	m_Frame++;
+
+	RetireJobs();
+	StartReads();
+	Upload();
+
+	if (g_StreamStats.GetBool()) {
+		DumpStats();
+		g_StreamStats.SetBool(false);
+	}
+}
+
+/// kbResourceStreamer::RetireJobs
+void kbResourceStreamer::RetireJobs() {
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	for (int i = 0; i < m_Running.size(); i++) {
+		kbStreamRequest_t* const pRequest = m_Running[i];
+		if (pRequest->m_Job.IsJobFinished() == false) {
+			continue;
+		}
+
+		blk::std_remove_idx_swap(m_Running, i);
+		i--;
+
+		if (pRequest->m_State == StreamState_Reading) {
+			m_NumReading--;
+			m_StageStats[StreamStage_QueueWait].Add(pRequest->m_ReadStartMS);
+			m_StageStats[StreamStage_Read].Add(pRequest->m_ReadEndMS - pRequest->m_ReadStartMS);
+
+			if (pRequest->m_bCancelled) {
+				Retire(pRequest);
+				continue;
+			}
+
+			pRequest->m_State = StreamState_Decoding;
+			m_Running.push_back(pRequest);
+			g_pJobManager->RegisterJob(&pRequest->m_Job);
+			continue;
+		}
+
+		m_StageStats[StreamStage_DecodeWait].Add(pRequest->m_DecodeStartMS - pRequest->m_ReadEndMS);
+		m_StageStats[StreamStage_Decode].Add(pRequest->m_DecodeEndMS - pRequest->m_DecodeStartMS);
+
+		if (pRequest->m_bCancelled) {
+			if (pRequest->m_bSucceeded && pRequest->m_pStaging == nullptr) {
+				pRequest->m_pResource->Release_Internal();
+			}
+			Retire(pRequest);
+			continue;
+		}
+
+		if (pRequest->m_bSucceeded == false) {
+			if (pRequest->m_pStaging != nullptr) {
+				blk::warn("kbResourceStreamer::RetireJobs() - Failed to reload %s.  Keeping the old data", pRequest->m_pResource->GetFullFileName().c_str());
+			} else {
+				blk::warn("kbResourceStreamer::RetireJobs() - Failed to load %s", pRequest->m_pResource->GetFullFileName().c_str());
+			}
+			Retire(pRequest);
+			continue;
+		}
+
+		pRequest->m_State = StreamState_Uploading;
+		m_ReadyToUpload.push_back(pRequest);
+	}
+}
+
+/// kbResourceStreamer::StartReads
+void kbResourceStreamer::StartReads() {
+	const u32 maxReads = (u32)std::max(g_StreamMaxReads.GetInt(), 1);
+
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	for (int priority = StreamPriority_Num - 1; priority >= 0 && m_NumReading < maxReads; priority--) {
+		std::deque<kbResource*>& queue = m_Queues[priority];
+
+		while (queue.empty() == false && m_NumReading < maxReads) {
+			kbResource* const pResource = queue.front();
+			queue.pop_front();
+
+			std::unordered_map<const kbResource*, kbStreamRequest_t*>::iterator it = m_Requests.find(pResource);
+			if (it == m_Requests.end() || it->second->m_State != StreamState_Queued || it->second->m_Priority != priority) {
+				continue;
+			}
+
+			kbStreamRequest_t* const pRequest = it->second;
+			pRequest->m_State = StreamState_Reading;
+			pRequest->m_File.m_FileName = pResource->GetStreamFileName();
+			m_Running.push_back(pRequest);
+			m_NumReading++;
+
+			g_pJobManager->RegisterJob(&pRequest->m_Job);
+		}
+	}
+}
+
+/// kbResourceStreamer::Upload
+void kbResourceStreamer::Upload() {
+	if (m_ReadyToUpload.empty()) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_Lock);
+		std::stable_sort(m_ReadyToUpload.begin(), m_ReadyToUpload.end(),
+			[](const kbStreamRequest_t* const pA, const kbStreamRequest_t* const pB) { return pA->m_Priority > pB->m_Priority; });
+	}
+
+	const float budgetMS = g_StreamUploadBudget.GetFloat();
+	kbTimer frameTimer;
+
+	std::string worstResource;
+	float worstUploadMS = 0.0f;
+	size_t numUploads = 0;
+	while (numUploads < m_ReadyToUpload.size() && (numUploads == 0 || frameTimer.TimeElapsedMS() < budgetMS)) {
+		kbStreamRequest_t* const pRequest = m_ReadyToUpload[numUploads];
+		numUploads++;
+
+		kbResource* const pResource = pRequest->m_pResource;
+		m_StageStats[StreamStage_UploadWait].Add(pRequest->m_Timer.TimeElapsedMS() - pRequest->m_DecodeEndMS);
+
+		kbTimer uploadTimer;
+		kbResource* const pStaging = pRequest->m_pStaging;
+		if (pStaging != nullptr) {
+			// The staging copy is left holding the old data, which Retire() releases
+			if (pStaging->Upload_Internal()) {
+				pResource->SwapStagedData(pStaging);
+				pResource->m_bIsLoaded = true;
+				pResource->m_LastLoadTime = g_GlobalTimer.TimeElapsedSeconds();
+			} else {
+				blk::warn("kbResourceStreamer::Upload() - Failed to upload %s.  Keeping the old data", pResource->GetFullFileName().c_str());
+			}
+		} else if (pResource->Upload_Internal()) {
+			pResource->m_bIsLoaded = true;
+			pResource->m_LastLoadTime = g_GlobalTimer.TimeElapsedSeconds();
+		} else {
+			blk::warn("kbResourceStreamer::Upload() - Failed to upload %s", pResource->GetFullFileName().c_str());
+			pResource->Release_Internal();
+		}
+
+		const float uploadMS = uploadTimer.TimeElapsedMS();
+		m_StageStats[StreamStage_Upload].Add(uploadMS);
+		if (uploadMS > worstUploadMS) {
+			worstUploadMS = uploadMS;
+			worstResource = pResource->GetFullFileName();
+		}
+
+		Retire(pRequest);
+	}
+	m_ReadyToUpload.erase(m_ReadyToUpload.begin(), m_ReadyToUpload.begin() + numUploads);
+
+	const float totalUploadMS = frameTimer.TimeElapsedMS();
+	if (totalUploadMS > g_StreamHitchMS.GetFloat()) {
+		blk::warn("kbResourceStreamer::Upload() - Frame %u spent %.2f ms uploading %u resources.  %s took %.2f ms", m_Frame, totalUploadMS, (u32)numUploads, worstResource.c_str(), worstUploadMS);
+
+		if (m_Hitches.size() >= g_MaxStreamHitches) {
+			m_Hitches.erase(m_Hitches.begin());
+		}
+
+		kbStreamHitch_t hitch;
+		hitch.m_Frame = m_Frame;
+		hitch.m_UploadMS = totalUploadMS;
+		hitch.m_NumUploads = (u32)numUploads;
+		hitch.m_WorstResource = worstResource;
+		hitch.m_WorstUploadMS = worstUploadMS;
+		m_Hitches.push_back(hitch);
+	}
+}
+
+/// kbResourceStreamer::Retire
+void kbResourceStreamer::Retire(kbStreamRequest_t* const pRequest) {
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	m_Requests.erase(pRequest->m_pResource);
+	DestroyStaging(pRequest->m_pStaging);
+	delete pRequest;
+}
+
+/// kbResourceStreamer::CreateStaging
+kbResource* kbResourceStreamer::CreateStaging(kbResource* const pResource) {
+	kbResource* const pStaging = pResource->CreateStagingCopy();
+	if (pStaging == nullptr) {
+		return nullptr;
+	}
+
+	pStaging->m_Name = pResource->m_Name;
+	pStaging->m_FullFileName = pResource->m_FullFileName;
+	pStaging->m_FullName = pResource->m_FullName;
+	pStaging->m_pReloadTarget = pResource;
+	return pStaging;
+}
+
+/// kbResourceStreamer::DestroyStaging
+void kbResourceStreamer::DestroyStaging(kbResource* const pStaging) {
+	if (pStaging == nullptr) {
+		return;
+	}
+
+	pStaging->Release();
+	delete pStaging;
+}
+
+/// kbResourceStreamer::Shutdown
+void kbResourceStreamer::Shutdown() {
+	for (int i = 0; i < m_Running.size(); i++) {
+		m_Running[i]->m_Job.WaitForJob();
+	}
+	m_Running.clear();
+	m_ReadyToUpload.clear();
+	m_NumReading = 0;
+
+	std::lock_guard<std::recursive_mutex> lock(m_Lock);
+	for (int i = 0; i < StreamPriority_Num; i++) {
+		m_Queues[i].clear();
+	}
+
+	for (std::unordered_map<const kbResource*, kbStreamRequest_t*>::iterator it = m_Requests.begin(); it != m_Requests.end(); ++it) {
+		DestroyStaging(it->second->m_pStaging);
+		delete it->second;
+	}
+	m_Requests.clear();
+}
+
+/// kbResourceStreamer::DumpStats
+void kbResourceStreamer::DumpStats() const {
+	static const char* const stageNames[StreamStage_Num] = { "Queued", "Read", "Waiting to decode", "Decode", "Waiting to upload", "Upload" };
+
+	blk::log("Resource streaming - %u requests, %u reading, %u waiting to upload", (u32)NumRequests(), m_NumReading, (u32)m_ReadyToUpload.size());
+	for (int i = 0; i < StreamStage_Num; i++) {
+		const kbStageStats_t& stats = m_StageStats[i];
+		blk::log("	%s: %.2f ms average, %.2f ms worst over %u resources", stageNames[i], stats.Average(), stats.m_MaxMS, stats.m_Count);
+	}
+
+	blk::log("	%u upload hitches over %.2f ms", (u32)m_Hitches.size(), g_StreamHitchMS.GetFloat());
+	for (size_t i = 0; i < m_Hitches.size(); i++) {
+		const kbStreamHitch_t& hitch = m_Hitches[i];
+		blk::log("		Frame %u - %.2f ms for %u uploads.  Worst was %s at %.2f ms", hitch.m_Frame, hitch.m_UploadMS, hitch.m_NumUploads, hitch.m_WorstResource.c_str(), hitch.m_WorstUploadMS);
+	}
+}
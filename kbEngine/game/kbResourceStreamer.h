@@ -0,0 +1,165 @@
+/// kbResourceStreamer.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "kbJobManager.h"
+#include "blk_file_system.h"
+
+class kbResource;
+
+/// kbStreamedFile_t - What the read stage pulled off disk for a resource.  See kbResource::GetStreamedData()
+struct kbStreamedFile_t {
+	std::string m_FileName;
+	kbFileData m_Data;
+};
+
+/// kbResourceStreamer
+///
+/// Loads resources in three stages:
+///
+///	- Read: A job opens the resource's file through g_FileSystem and pages it in.  At most "streammaxreads" reads are in
+///	  flight, and queued requests start in priority order
+///	- Decode: A job runs the resource's Load_Internal() over the bytes that were read
+///	- Upload: Update() runs Upload_Internal() on the render thread in priority order until "streamuploadbudget" ms
+///	  have been spent in a frame.  At least one upload runs each frame so the queue always drains
+///
+/// Requests are deduplicated by resource, so asking for a resource that's already streaming only raises its priority.
+/// Cancelling a request that hasn't started decoding drops it.  Later stages can't be interrupted, so the resource is
+/// released once they finish instead of being uploaded.
+///
+/// Reloads go through the same stages, but decode into a staging copy of the resource (kbResource::CreateStagingCopy()).
+/// The copy's data is only swapped into the live resource after it uploads, so the renderer never sees a half loaded
+/// resource and a file that fails to load leaves the old data in place
+///
+/// Request(), IsStreaming() and NumRequests() can be called from any thread, since resources decoding on job threads
+/// request the resources they depend on.  Everything else belongs to the thread that runs Update()
+class kbResourceStreamer {
+public:
+	kbResourceStreamer();
+	~kbResourceStreamer();
+
+	/// Does nothing if the resource is already loaded.  Loads it right away if there are no job threads
+	void Request(kbResource* const pResource, const kbStreamPriority_t priority);
+
+	/// bWaitForJobs blocks until the resource's read or decode job finishes, so it can be released or loaded right after
+	void Cancel(kbResource* const pResource, const bool bWaitForJobs = false);
+
+	/// Re-reads a resource whether or not it's loaded.  It keeps its current data until the new data is uploaded
+	void Reload(kbResource* const pResource);
+
+	bool IsStreaming(const kbResource* const pResource) const;
+	size_t NumRequests() const;
+
+	bool IsStreamerThread() const { return std::this_thread::get_id() == m_StreamerThread; }
+
+	/// Called once a frame from the render thread
+	void Update();
+
+	/// Cancels everything and waits for running jobs
+	void Shutdown();
+
+	/// Logs the average and worst latency of each stage, and the frames where uploads ran over "streamhitchms"
+	void DumpStats() const;
+
+private:
+	enum kbStreamState_t {
+		StreamState_Queued,
+		StreamState_Reading,
+		StreamState_Decoding,
+		StreamState_Uploading,
+	};
+
+	struct kbStreamRequest_t;
+
+	/// kbStreamJob
+	class kbStreamJob : public kbJob {
+	public:
+		virtual void Run() override { RunJob(m_pRequest); }
+
+		kbStreamRequest_t* m_pRequest = nullptr;
+	};
+
+	struct kbStreamRequest_t {
+		kbResource* m_pResource = nullptr;
+		kbStreamPriority_t m_Priority = StreamPriority_Normal;
+		kbStreamState_t m_State = StreamState_Queued;
+		bool m_bCancelled = false;
+		bool m_bSucceeded = false;
+
+		kbResource* m_pStaging = nullptr;		// Decoded and uploaded in place of m_pResource when reloading
+
+		kbStreamJob m_Job;
+		kbStreamedFile_t m_File;
+
+		// Milliseconds since the request was made
+		kbTimer m_Timer;
+		float m_ReadStartMS = 0.0f;
+		float m_ReadEndMS = 0.0f;
+		float m_DecodeStartMS = 0.0f;
+		float m_DecodeEndMS = 0.0f;
+	};
+
+	/// kbStageStats_t
+	struct kbStageStats_t {
+		void Add(const float ms) { m_TotalMS += ms; m_MaxMS = (ms > m_MaxMS) ? (ms) : (m_MaxMS); m_Count++; }
+		float Average() const { return (m_Count > 0) ? (float)(m_TotalMS / m_Count) : (0.0f); }
+
+		f64 m_TotalMS = 0.0;
+		float m_MaxMS = 0.0f;
+		u32 m_Count = 0;
+	};
+
+	enum kbStreamStage_t {
+		StreamStage_QueueWait,
+		StreamStage_Read,
+		StreamStage_DecodeWait,
+		StreamStage_Decode,
+		StreamStage_UploadWait,
+		StreamStage_Upload,
+		StreamStage_Num
+	};
+
+	/// kbStreamHitch_t
+	struct kbStreamHitch_t {
+		u32 m_Frame;
+		float m_UploadMS;
+		u32 m_NumUploads;
+		std::string m_WorstResource;
+		float m_WorstUploadMS;
+	};
+
+	/// Runs on a job thread.  Reads or decodes depending on the request's state
+	static void RunJob(kbStreamRequest_t* const pRequest);
+
+	void StartReads();
+	void RetireJobs();
+	void Upload();
+	void Retire(kbStreamRequest_t* const pRequest);
+
+	/// Returns nullptr if pResource's type doesn't support staging copies
+	static kbResource* CreateStaging(kbResource* const pResource);
+	static void DestroyStaging(kbResource* const pStaging);
+
+	// Guards m_Requests, m_Queues and the requests' priority, state and cancelled flag.  Only the streamer thread
+	// retires requests, so it can drop the lock to wait on a job.  Not held while resources decode or upload
+	mutable std::recursive_mutex m_Lock;
+	std::thread::id m_StreamerThread;
+
+	std::unordered_map<const kbResource*, kbStreamRequest_t*> m_Requests;
+	std::deque<kbResource*> m_Queues[StreamPriority_Num];		// Can hold stale entries.  A resource is only started from the queue matching its request's priority
+	std::vector<kbStreamRequest_t*> m_Running;
+	std::vector<kbStreamRequest_t*> m_ReadyToUpload;
+	u32 m_NumReading;
+
+	kbStageStats_t m_StageStats[StreamStage_Num];
+	std::vector<kbStreamHitch_t> m_Hitches;
+	u32 m_Frame;
+};
@@ -403,6 +403,10 @@ kbTerrainComponent::~kbTerrainComponent() {
 		m_pHeightMap = nullptr;
 	}
 
+	if (g_pGame != nullptr) {
+		g_pGame->GetParticleManager().GetCollisionWorld().RemoveHeightField(&m_ParticleHeightField);
+	}
+
 	m_TerrainModel.Release();
 }
 
@@ -520,6 +524,17 @@ void kbTerrainComponent::GenerateTerrain() {
 	}
 	m_TerrainModel.UnmapVertexBuffer();
 
+	// Particles collide with the same heights
+	std::vector<f32> particleHeights(cpuVerts.size());
+	for (size_t i = 0; i < cpuVerts.size(); i++) {
+		particleHeights[i] = cpuVerts[i].y;
+	}
+	const Vec3 ownerPos = GetOwner()->GetPosition();
+	m_ParticleHeightField.Build(ownerPos.x - HalfTerrainWidth + cellWidth, ownerPos.z - HalfTerrainWidth + cellWidth, cellWidth, m_TerrainDimensions, m_TerrainDimensions, particleHeights.data());
+	if (g_pGame != nullptr && IsEnabled()) {
+		g_pGame->GetParticleManager().GetCollisionWorld().AddHeightField(&m_ParticleHeightField);
+	}
+
 	ushort* pIndices = (ushort*)m_TerrainModel.MapIndexBuffer();
 	int currentIndexToWrite = 0;
 
@@ -650,12 +665,20 @@ void kbTerrainComponent::enable_internal(const bool isEnabled) {
 			m_Grass[i].Enable(true);
 		}
 
+		if (g_pGame != nullptr && m_ParticleHeightField.IsValid()) {
+			g_pGame->GetParticleManager().GetCollisionWorld().AddHeightField(&m_ParticleHeightField);
+		}
+
 	} else {
 		g_pRenderer->RemoveRenderObject(m_render_object);
 
 		for (int i = 0; i < m_Grass.size(); i++) {
 			m_Grass[i].Enable(false);
 		}
+
+		if (g_pGame != nullptr) {
+			g_pGame->GetParticleManager().GetCollisionWorld().RemoveHeightField(&m_ParticleHeightField);
+		}
 	}
 }
 
@@ -6,6 +6,7 @@
 
 #include "kbRenderBuffer.h"
 #include "kbModel.h"
+#include "kbParticleCollision.h"
 
 ///
 ///	kbGrass
@@ -142,6 +143,7 @@ protected:
 
 	// Non-editor
 	kbModel	m_TerrainModel;
+	kbParticleHeightField m_ParticleHeightField;
 	float m_LastHeightMapLoadTime;
 
 	bool m_bRegenerateTerrain;
@@ -30,11 +30,73 @@ kbNameToTypeInfoMap::~kbNameToTypeInfoMap() {
 /// kbNameToTypeInfoMap::AddTypeInfo()
 void kbNameToTypeInfoMap::AddTypeInfo(const kbTypeInfoClass* const classToAdd) {
 	m_Map[classToAdd->GetClassName()] = classToAdd;
+	m_ClassMap[kbHashName(classToAdd->GetClassName())] = classToAdd;
 }
 
 /// kbNameToTypeInfoMap::AddEnum()
 void kbNameToTypeInfoMap::AddEnum(const std::string& enumName, const std::vector< std::string >& enumFields) {
-	m_EnumMap[enumName] = enumFields;
+	m_EnumMap[kbHashName(enumName)] = enumFields;
+}
+
+/// kbNameToTypeInfoMap::GetTypeInfoFromClassName()
+const kbTypeInfoClass* kbNameToTypeInfoMap::GetTypeInfoFromClassName(const std::string_view name) const {
+	std::unordered_map<u64, const kbTypeInfoClass*>::const_iterator it = m_ClassMap.find(kbHashName(name));
+	if (it == m_ClassMap.end()) {
+		return nullptr;
+	}
+	return it->second;
+}
+
+/// kbNameToTypeInfoMap::GetEnum()
+const std::vector<std::string>* kbNameToTypeInfoMap::GetEnum(const u64 nameHash) const {
+	static const std::vector<std::string> emptyEnum;
+
+	std::unordered_map<u64, std::vector<std::string>>::const_iterator it = m_EnumMap.find(nameHash);
+	if (it == m_EnumMap.end()) {
+		return &emptyEnum;
+	}
+	return &it->second;
+}
+
+/// kbTypeInfoClass::AddMember
+void kbTypeInfoClass::AddMember(const kbTypeInfoVar& fieldInfo) {
+	std::vector<kbFieldIndex_t>::iterator it = std::lower_bound(m_FieldIndex.begin(), m_FieldIndex.end(), fieldInfo.GetNameHash(),
+		[](const kbFieldIndex_t& entry, const u64 hash) { return entry.m_NameHash < hash; });
+
+	if (it != m_FieldIndex.end() && it->m_NameHash == fieldInfo.GetNameHash()) {
+		kbTypeInfoVar& existingField = m_Fields[it->m_FieldIdx];
+		if (existingField.GetName() != fieldInfo.GetName()) {
+			blk::error("kbTypeInfoClass::AddMember() - %s and %s have the same hash", existingField.GetName().c_str(), fieldInfo.GetName().c_str());
+		}
+		existingField = fieldInfo;
+		return;
+	}
+
+	kbFieldIndex_t newEntry;
+	newEntry.m_NameHash = fieldInfo.GetNameHash();
+	newEntry.m_FieldIdx = (u32)m_Fields.size();
+	m_FieldIndex.insert(it, newEntry);
+	m_Fields.push_back(fieldInfo);
+}
+
+/// kbTypeInfoClass::GetField
+const kbTypeInfoVar* kbTypeInfoClass::GetField(const u64 nameHash) const {
+	std::vector<kbFieldIndex_t>::const_iterator it = std::lower_bound(m_FieldIndex.begin(), m_FieldIndex.end(), nameHash,
+		[](const kbFieldIndex_t& entry, const u64 hash) { return entry.m_NameHash < hash; });
+
+	if (it == m_FieldIndex.end() || it->m_NameHash != nameHash) {
+		return nullptr;
+	}
+	return &m_Fields[it->m_FieldIdx];
+}
+
+/// kbTypeInfoClass::GetField
+const kbTypeInfoVar* kbTypeInfoClass::GetField(const std::string_view memberName) const {
+	const kbTypeInfoVar* const pField = GetField(kbHashName(memberName));
+	if (pField == nullptr || pField->GetName() != memberName) {
+		return nullptr;
+	}
+	return pField;
 }
 
 kbComponent* ConstructClassFromName(const std::string& className) {
@@ -47,6 +109,62 @@ kbComponent* ConstructClassFromName(const std::string& className) {
 	return typeInfo->ConstructInstance();
 }
 
+/// BenchmarkTypeInfo
+void BenchmarkTypeInfo(const std::vector<const kbComponent*>& components, const u32 numIterations) {
+	if (components.empty() || numIterations == 0) {
+		return;
+	}
+
+	// Load - Find every field by name the way kbFile::ReadComponent() does
+	size_t numFound = 0;
+	kbTimer loadTimer;
+	for (u32 iteration = 0; iteration < numIterations; iteration++) {
+		for (size_t i = 0; i < components.size(); i++) {
+			const std::vector<kbTypeInfoClass*>& typeInfo = components[i]->GetTypeInfo();
+			kbTypeInfoHierarchyIterator iterator(components[i]);
+			for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField()) {
+				const u64 nameHash = kbHashName(pNextField->GetName());
+				for (size_t j = 0; j < typeInfo.size(); j++) {
+					if (typeInfo[j]->GetField(nameHash) != nullptr) {
+						numFound++;
+						break;
+					}
+				}
+			}
+		}
+	}
+	const f32 loadMS = loadTimer.TimeElapsedMS();
+
+	// Save - Walk every field and size every array the way kbFile::WriteComponent() does
+	size_t numElements = 0;
+	kbTimer saveTimer;
+	for (u32 iteration = 0; iteration < numIterations; iteration++) {
+		for (size_t i = 0; i < components.size(); i++) {
+			const byte* const componentBytePtr = (const byte*)components[i];
+			kbTypeInfoHierarchyIterator iterator(components[i]);
+			for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField()) {
+				if (pNextField->IsArray() && pNextField->Type() != KBTYPEINFO_SHADER && pNextField->Type() != KBTYPEINFO_TEXTURE) {
+					numElements += g_NameToTypeInfoMap->GetVectorSize(componentBytePtr + pNextField->Offset(), pNextField->GetStructNameHash());
+				}
+			}
+		}
+	}
+	const f32 saveMS = saveTimer.TimeElapsedMS();
+
+	// Clone - Copy every component the way kbGameEntity's copy constructor does
+	kbTimer cloneTimer;
+	for (u32 iteration = 0; iteration < numIterations; iteration++) {
+		for (size_t i = 0; i < components.size(); i++) {
+			const kbTypeInfoClass* const pTypeInfoClass = g_NameToTypeInfoMap->GetTypeInfoFromClassName(components[i]->GetComponentClassName());
+			delete pTypeInfoClass->ConstructInstance(components[i]);
+		}
+	}
+	const f32 cloneMS = cloneTimer.TimeElapsedMS();
+
+	blk::log("BenchmarkTypeInfo() - %u components x %u iterations (%u fields found, %u array elements)", (u32)components.size(), numIterations, (u32)numFound, (u32)numElements);
+	blk::log("	Load: %.3f ms  Save: %.3f ms  Clone: %.3f ms", loadMS, saveMS, cloneMS);
+}
+
 
 // Should be a macro with each member specified
 
@@ -58,6 +176,8 @@ EClothType_Enum EClothType_EnumClass;
 
 ECollisionType_Enum ECollisionType_EnumClass;
 
+EAnimPoseNodeType_Enum EAnimPoseNodeType_EnumClass;
+
 EBillboardType_Enum EBillboardType_EnumClass;
 
 eWidgetAnchor_Enum EWidgetAnchor_EnumClass;
@@ -88,6 +208,12 @@ DEFINE_KBCLASS(kbStaticModelComponent)
 
 DEFINE_KBCLASS(kbAnimComponent)
 
+DEFINE_KBCLASS(kbAnimPoseNodeInput)
+
+DEFINE_KBCLASS(kbAnimBoneMask)
+
+DEFINE_KBCLASS(kbAnimPoseNode)
+
 DEFINE_KBCLASS(SkeletalModelComponent)
 
 DEFINE_KBCLASS(kbFlingPhysicsComponent)
@@ -116,6 +242,8 @@ DEFINE_KBCLASS(kbClothBone)
 
 DEFINE_KBCLASS(kbBoneCollisionSphere)
 
+DEFINE_KBCLASS(kbBoneCollisionCapsule)
+
 DEFINE_KBCLASS(kbClothComponent)
 
 DEFINE_KBCLASS(kbGameLogicComponent)
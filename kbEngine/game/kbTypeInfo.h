@@ -12,45 +12,51 @@ public:
 	kbTypeInfoVar() :
 		m_Type(KBTYPEINFO_NONE),
 		m_Offset(0),
+		m_NameHash(0),
+		m_StructNameHash(0),
 		m_bIsArray(false) {
 	}
 
-	kbTypeInfoVar(const kbTypeInfoType_t fieldType, const size_t fieldOffset, const bool bIsArray, const std::string& structName) :
+	kbTypeInfoVar(const std::string& name, const kbTypeInfoType_t fieldType, const size_t fieldOffset, const bool bIsArray, const std::string& structName) :
+		m_Name(name),
+		m_StructName(structName),
 		m_Type(fieldType),
 		m_Offset(fieldOffset),
-		m_bIsArray(bIsArray),
-		m_StructName(structName) {
+		m_NameHash(kbHashName(name)),
+		m_StructNameHash(kbHashName(structName)),
+		m_bIsArray(bIsArray) {
 	}
 
+	const std::string& GetName() const { return m_Name; }
+	const u64 GetNameHash() const { return m_NameHash; }
 	const kbTypeInfoType_t Type() const { return m_Type; }
 	const size_t Offset() const { return m_Offset; }
 	const bool IsArray() const { return m_bIsArray; }
 	const std::string& GetStructName() const { return m_StructName; }
+	const u64 GetStructNameHash() const { return m_StructNameHash; }
 
 private:
+	std::string m_Name;
+	std::string	m_StructName;
 	kbTypeInfoType_t m_Type;
 	size_t m_Offset;
-	std::string	m_StructName;
+	u64 m_NameHash;
+	u64 m_StructNameHash;
 	bool m_bIsArray;
 };
 
-/// kbTypeInfoClass - Maps a class' member's names to its kbTypeInfoField
+/// kbTypeInfoClass - A class' fields in the order they were added, plus an index of them sorted by name hash.
+/// Walking the fields touches one contiguous array and finding one by name is a binary search over u64s
 class kbTypeInfoClass {
 public:
 
-	void AddMember(const std::string& memberName, const kbTypeInfoVar& fieldInfo) {
-		memberFieldsMap[memberName] = fieldInfo;
-	}
+	void AddMember(const kbTypeInfoVar& fieldInfo);
 
-	const kbTypeInfoVar* GetField(const std::string& memberName) const {
-		std::map< std::string, kbTypeInfoVar >::const_iterator it = memberFieldsMap.find(memberName);
-		if (it == memberFieldsMap.end()) {
-			return nullptr;
-		}
-		return &it->second;
-	}
+	/// nameHash is kbHashName() of the field's name
+	const kbTypeInfoVar* GetField(const u64 nameHash) const;
+	const kbTypeInfoVar* GetField(const std::string_view memberName) const;
 
-	const std::map< std::string, kbTypeInfoVar >& GetMemberFieldsMap() const { return memberFieldsMap; }
+	const std::vector<kbTypeInfoVar>& GetFields() const { return m_Fields; }
 
 	const std::string& GetClassName() const { return m_ClassName; }
 
@@ -61,10 +67,18 @@ protected:
 	std::string m_ClassName;
 
 private:
-	std::map<std::string, kbTypeInfoVar> memberFieldsMap;
+	struct kbFieldIndex_t {
+		u64 m_NameHash;
+		u32 m_FieldIdx;
+	};
+
+	std::vector<kbTypeInfoVar> m_Fields;
+	std::vector<kbFieldIndex_t> m_FieldIndex;
 };
 
-/// kbNameToTypeInfoMap - This class maps all type info class' to string names.  Code can create an instance of a kbComponent with it's name
+/// kbNameToTypeInfoMap - This class maps all type info class' to string names.  Code can create an instance of a kbComponent with it's name.
+/// Classes, enums and vector operations are looked up by kbHashName() of their name.  The string overloads hash on each
+/// call, so code that does the same lookup repeatedly should use the kbTypeInfoVar's precomputed hash
 class kbNameToTypeInfoMap {
 public:
 	kbNameToTypeInfoMap();
@@ -73,79 +87,92 @@ public:
 	void AddTypeInfo(const kbTypeInfoClass* const classToAdd);
 	void AddEnum(const std::string& enumName, const std::vector<std::string>& enumFields);
 
-	const kbTypeInfoClass* GetTypeInfoFromClassName(const std::string& name) { return m_Map[name]; }
+	const kbTypeInfoClass* GetTypeInfoFromClassName(const std::string_view name) const;
 
+	/// Sorted by name for the editor
 	const std::map<std::string, const kbTypeInfoClass*>& GetClassMap() const { return m_Map; }
 
-	const std::vector<std::string>* GetEnum(const std::string& name) { return &m_EnumMap[name]; }
+	/// Never null.  Unknown enums are empty
+	const std::vector<std::string>* GetEnum(const u64 nameHash) const;
+	const std::vector<std::string>* GetEnum(const std::string_view name) const { return GetEnum(kbHashName(name)); }
 
 	template<typename t>
-	void RegisterVectorOperations(const std::string& vectorTypeString) {
-		std::map<std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t)>::const_iterator it = m_ResizeVectorPtr.find(vectorTypeString);
-		if (it == m_ResizeVectorPtr.end()) {
-			m_ResizeVectorPtr[vectorTypeString] = &kbNameToTypeInfoMap::ResizeVector_Internal<t>;
-			m_GetVectorElementPtr[vectorTypeString] = &kbNameToTypeInfoMap::GetVectorElement_Internal<t>;
-			m_GetVectorSizePtr[vectorTypeString] = &kbNameToTypeInfoMap::GetVectorSize_Internal<t>;
-			m_InsertVectorElementPtr[vectorTypeString] = &kbNameToTypeInfoMap::InsertVectorElement_Internal<t>;
-			m_RemoveVectorElementPtr[vectorTypeString] = &kbNameToTypeInfoMap::RemoveVectorElement_Internal<t>;
+	void RegisterVectorOperations(const std::string_view vectorTypeString) {
+		const u64 vectorTypeHash = kbHashName(vectorTypeString);
+		if (m_VectorOperations.find(vectorTypeHash) == m_VectorOperations.end()) {
+			kbVectorOperations_t& newOperations = m_VectorOperations[vectorTypeHash];
+			newOperations.m_pResize = &kbNameToTypeInfoMap::ResizeVector_Internal<t>;
+			newOperations.m_pGetElement = &kbNameToTypeInfoMap::GetVectorElement_Internal<t>;
+			newOperations.m_pGetSize = &kbNameToTypeInfoMap::GetVectorSize_Internal<t>;
+			newOperations.m_pInsertElement = &kbNameToTypeInfoMap::InsertVectorElement_Internal<t>;
+			newOperations.m_pRemoveElement = &kbNameToTypeInfoMap::RemoveVectorElement_Internal<t>;
 		}
 	}
 
-	void ResizeVector(const void* const vectorPtr, const std::string& vectorStringType, const size_t newVectorSize) {
-		void (kbNameToTypeInfoMap:: * pFunc)(const void*, const size_t) = nullptr;
-
-		std::map< std::string, void (kbNameToTypeInfoMap::*)(const void* const, const size_t) >::const_iterator it = m_ResizeVectorPtr.find(vectorStringType);
-		if (it != m_ResizeVectorPtr.end()) {
-			pFunc = it->second;
-			(this->*pFunc)(vectorPtr, newVectorSize);
+	void ResizeVector(const void* const vectorPtr, const u64 vectorTypeHash, const size_t newVectorSize) {
+		const kbVectorOperations_t* const pOperations = GetVectorOperations(vectorTypeHash);
+		if (pOperations != nullptr) {
+			(this->*pOperations->m_pResize)(vectorPtr, newVectorSize);
 		}
 	}
 
-	void* GetVectorElement(const void* const vectorPtr, const std::string& vectorStringType, const size_t index) {
-		void* (kbNameToTypeInfoMap:: * pFunc)(const void*, const size_t) = nullptr;
-
-		std::map< std::string, void* (kbNameToTypeInfoMap::*)(const void*, const size_t) >::const_iterator it = m_GetVectorElementPtr.find(vectorStringType);
-		if (it != m_GetVectorElementPtr.end()) {
-			pFunc = it->second;
-			return (this->*pFunc)(vectorPtr, index);
+	void* GetVectorElement(const void* const vectorPtr, const u64 vectorTypeHash, const size_t index) {
+		const kbVectorOperations_t* const pOperations = GetVectorOperations(vectorTypeHash);
+		if (pOperations != nullptr) {
+			return (this->*pOperations->m_pGetElement)(vectorPtr, index);
 		}
 		return nullptr;
 	}
 
-	size_t GetVectorSize(const void* const vectorPtr, const std::string& vectorStringType) {
-		size_t(kbNameToTypeInfoMap:: * pFunc)(const void*) = nullptr;
-
-		std::map< std::string, size_t(kbNameToTypeInfoMap::*)(const void*) >::const_iterator it = m_GetVectorSizePtr.find(vectorStringType);
-		if (it != m_GetVectorSizePtr.end()) {
-			pFunc = it->second;
-			return (this->*pFunc)(vectorPtr);
+	size_t GetVectorSize(const void* const vectorPtr, const u64 vectorTypeHash) {
+		const kbVectorOperations_t* const pOperations = GetVectorOperations(vectorTypeHash);
+		if (pOperations != nullptr) {
+			return (this->*pOperations->m_pGetSize)(vectorPtr);
 		}
 		return 0;
 	}
 
-	void InsertVectorElement(const void* const vectorPtr, const std::string& vectorStringType, const size_t index) {
-		void (kbNameToTypeInfoMap:: * pFunc)(const void*, const size_t) = nullptr;
+	void InsertVectorElement(const void* const vectorPtr, const u64 vectorTypeHash, const size_t index) {
+		const kbVectorOperations_t* const pOperations = GetVectorOperations(vectorTypeHash);
+		if (pOperations != nullptr) {
+			(this->*pOperations->m_pInsertElement)(vectorPtr, index);
+		}
+	}
 
-		std::map< std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t) >::const_iterator it = m_InsertVectorElementPtr.find(vectorStringType);
-		if (it != m_InsertVectorElementPtr.end()) {
-			pFunc = it->second;
-			(this->*pFunc)(vectorPtr, index);
+	void RemoveVectorElement(const void* const vectorPtr, const u64 vectorTypeHash, const size_t index) {
+		const kbVectorOperations_t* const pOperations = GetVectorOperations(vectorTypeHash);
+		if (pOperations != nullptr) {
+			(this->*pOperations->m_pRemoveElement)(vectorPtr, index);
 		}
 	}
 
-	void RemoveVectorElement(const void* const vectorPtr, const std::string& vectorStringType, const size_t index) {
-		void (kbNameToTypeInfoMap:: * pFunc)(const void*, const size_t) = nullptr;
+	void ResizeVector(const void* const vectorPtr, const std::string_view vectorStringType, const size_t newVectorSize) { ResizeVector(vectorPtr, kbHashName(vectorStringType), newVectorSize); }
+	void* GetVectorElement(const void* const vectorPtr, const std::string_view vectorStringType, const size_t index) { return GetVectorElement(vectorPtr, kbHashName(vectorStringType), index); }
+	size_t GetVectorSize(const void* const vectorPtr, const std::string_view vectorStringType) { return GetVectorSize(vectorPtr, kbHashName(vectorStringType)); }
+	void InsertVectorElement(const void* const vectorPtr, const std::string_view vectorStringType, const size_t index) { InsertVectorElement(vectorPtr, kbHashName(vectorStringType), index); }
+	void RemoveVectorElement(const void* const vectorPtr, const std::string_view vectorStringType, const size_t index) { RemoveVectorElement(vectorPtr, kbHashName(vectorStringType), index); }
+
+private:
+	struct kbVectorOperations_t {
+		void (kbNameToTypeInfoMap::* m_pResize)(const void*, const size_t);
+		void* (kbNameToTypeInfoMap::* m_pGetElement)(const void*, const size_t);
+		size_t (kbNameToTypeInfoMap::* m_pGetSize)(const void*);
+		void (kbNameToTypeInfoMap::* m_pInsertElement)(const void*, const size_t);
+		void (kbNameToTypeInfoMap::* m_pRemoveElement)(const void*, const size_t);
+	};
 
-		std::map< std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t) >::const_iterator it = m_RemoveVectorElementPtr.find(vectorStringType);
-		if (it != m_RemoveVectorElementPtr.end()) {
-			pFunc = it->second;
-			(this->*pFunc)(vectorPtr, index);
+	const kbVectorOperations_t* GetVectorOperations(const u64 vectorTypeHash) const {
+		std::unordered_map<u64, kbVectorOperations_t>::const_iterator it = m_VectorOperations.find(vectorTypeHash);
+		if (it == m_VectorOperations.end()) {
+			return nullptr;
 		}
+		return &it->second;
 	}
 
-private:
 	std::map<std::string, const kbTypeInfoClass*> m_Map;
-	std::map<std::string, std::vector< std::string>> m_EnumMap;
+	std::unordered_map<u64, const kbTypeInfoClass*> m_ClassMap;
+	std::unordered_map<u64, std::vector<std::string>> m_EnumMap;
+	std::unordered_map<u64, kbVectorOperations_t> m_VectorOperations;
 
 	template<typename t>
 	void ResizeVector_Internal(const void* const vectorPtr, const size_t vectorSize = 0) {
@@ -202,23 +229,21 @@ private:
 		vec.erase(vec.begin() + index);
 	}
 
-	std::map<std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t)> m_ResizeVectorPtr;
-	std::map<std::string, void* (kbNameToTypeInfoMap::*)(const void*, const size_t)> m_GetVectorElementPtr;
-	std::map<std::string, size_t(kbNameToTypeInfoMap::*)(const void*)> m_GetVectorSizePtr;
-	std::map<std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t)> m_InsertVectorElementPtr;
-	std::map<std::string, void (kbNameToTypeInfoMap::*)(const void*, const size_t)> m_RemoveVectorElementPtr;
 };
 extern kbNameToTypeInfoMap* g_NameToTypeInfoMap;
 
 kbComponent* ConstructClassFromName(const std::string& className);
 
+/// Logs the cost of the field lookups, field walks and copies that loading, saving and cloning components do
+void BenchmarkTypeInfo(const std::vector<const kbComponent*>& components, const u32 numIterations);
+
 #define AddEnumField( ENUM_FIELD_NAME, ENUM_STRING_NAME ) \
 	enumFields.push_back( ENUM_STRING_NAME );
 
 #define AddField( FIELD_NAME, FIELD_TYPE, CLASS_TYPE, MEMBER_NAME, IS_ARRAY, STRUCT_NAME ) \
 { \
-	kbTypeInfoVar newField( FIELD_TYPE, (size_t)&((CLASS_TYPE*)(0))->MEMBER_NAME, IS_ARRAY, STRUCT_NAME ); \
-	AddMember( FIELD_NAME, newField ); \
+	kbTypeInfoVar newField( FIELD_NAME, FIELD_TYPE, (size_t)&((CLASS_TYPE*)(0))->MEMBER_NAME, IS_ARRAY, STRUCT_NAME ); \
+	AddMember( newField ); \
 	if ( g_NameToTypeInfoMap == nullptr ) { g_NameToTypeInfoMap = new kbNameToTypeInfoMap(); } \
 	g_NameToTypeInfoMap->RegisterVectorOperations<CLASS_TYPE>(#CLASS_TYPE); \
 }
@@ -253,22 +278,21 @@ public:\
 	virtual kbComponent * ConstructInstance( const kbComponent *const pComponentToCopy ) const { return new CLASS_TYPE( *static_cast<const CLASS_TYPE*>( pComponentToCopy )); } \
 };
 
-/// Helper for iterating over a class and its ancestor's type info
+/// Helper for iterating over a class and its ancestor's type info.  Ancestors' fields come first
 class kbTypeInfoHierarchyIterator {
 public:
-	typedef std::map< std::string, kbTypeInfoVar >::const_iterator iteratorType;
+	typedef std::vector<kbTypeInfoVar>::const_iterator iteratorType;
 
 	kbTypeInfoHierarchyIterator(const kbComponent* pComponent) :
 		m_pComponent(pComponent),
 		m_CurrentIndex(0) {
-		const std::vector< class kbTypeInfoClass* >& pClass = m_pComponent->GetTypeInfo();
-		m_Iterator = pClass[0]->GetMemberFieldsMap().begin();
+		Begin();
 	}
 
-
 	iteratorType Begin() {
 		m_CurrentIndex = 0;
-		m_Iterator = m_pComponent->GetTypeInfo()[0]->GetMemberFieldsMap().begin();
+		m_Iterator = m_pComponent->GetTypeInfo()[0]->GetFields().begin();
+		SkipFinishedClasses();
 
 		return m_Iterator;
 	}
@@ -279,23 +303,26 @@ public:
 
 	const iteratorType GetNextTypeInfoField() {
 		m_Iterator++;
+		SkipFinishedClasses();
 
-		if (m_Iterator == m_pComponent->GetTypeInfo()[m_CurrentIndex]->GetMemberFieldsMap().end()) {
+		return m_Iterator;
+	}
+
+private:
+	void SkipFinishedClasses() {
+		const std::vector<class kbTypeInfoClass*>& typeInfo = m_pComponent->GetTypeInfo();
+		while (m_CurrentIndex < typeInfo.size() && m_Iterator == typeInfo[m_CurrentIndex]->GetFields().end()) {
 			m_CurrentIndex++;
 
-			if (m_CurrentIndex < m_pComponent->GetTypeInfo().size()) {
-				m_Iterator = m_pComponent->GetTypeInfo()[m_CurrentIndex]->GetMemberFieldsMap().begin();
+			if (m_CurrentIndex < typeInfo.size()) {
+				m_Iterator = typeInfo[m_CurrentIndex]->GetFields().begin();
 			}
-
 		}
-
-		return m_Iterator;
 	}
 
-private:
 	const kbComponent* m_pComponent;
 	iteratorType				m_Iterator;
-	int							m_CurrentIndex;
+	size_t						m_CurrentIndex;
 };
 
 #include "kbTypeInfoGeneratedClasses.h"
@@ -28,6 +28,17 @@ GenerateEnum(
 	AddEnumField(CT_Square, "Square")
 )
 
+GenerateEnum(
+	EAnimPoseNodeType, "EAnimPoseNodeType",
+	AddEnumField(PoseNode_Clip, "Clip")
+	AddEnumField(PoseNode_Blend, "Blend")
+	AddEnumField(PoseNode_Additive, "Additive")
+	AddEnumField(PoseNode_Layer, "Layer")
+	AddEnumField(PoseNode_BlendSpace1D, "BlendSpace1D")
+	AddEnumField(PoseNode_BlendSpace2D, "BlendSpace2D")
+	AddEnumField(PoseNode_External, "External")
+)
+
 GenerateEnum(
 	ECollisionType, "ECollisionType",
 	AddEnumField(CollisionType_Sphere, "Sphere")
@@ -105,6 +116,14 @@ GenerateClass(
 	AddField("Sphere", KBTYPEINFO_VECTOR4, kbBoneCollisionSphere, m_Sphere, false, "")
 )
 
+GenerateClass(
+	kbBoneCollisionCapsule,
+	AddField("BoneName", KBTYPEINFO_KBSTRING, kbBoneCollisionCapsule, m_BoneName, false, "")
+	AddField("Start", KBTYPEINFO_VECTOR, kbBoneCollisionCapsule, m_Start, false, "")
+	AddField("End", KBTYPEINFO_VECTOR, kbBoneCollisionCapsule, m_End, false, "")
+	AddField("Radius", KBTYPEINFO_FLOAT, kbBoneCollisionCapsule, m_Radius, false, "")
+)
+
 GenerateClass(
 	kbClothComponent,
 	AddField("BoneInfo", KBTYPEINFO_STRUCT, kbClothComponent, m_BoneInfo, true, "kbClothBone")
@@ -114,6 +133,10 @@ GenerateClass(
 	AddField("Height", KBTYPEINFO_INT, kbClothComponent, m_Height, false, "")
 	AddField("AdditionalBoneInfo", KBTYPEINFO_STRUCT, kbClothComponent, m_AdditionalBoneInfo, true, "kbClothBone")
 	AddField("Collision", KBTYPEINFO_STRUCT, kbClothComponent, m_CollisionSpheres, true, "kbBoneCollisionSphere")
+	AddField("CapsuleCollision", KBTYPEINFO_STRUCT, kbClothComponent, m_CollisionCapsules, true, "kbBoneCollisionCapsule")
+	AddField("CollisionThickness", KBTYPEINFO_FLOAT, kbClothComponent, m_CollisionThickness, false, "")
+	AddField("SelfCollisionDistance", KBTYPEINFO_FLOAT, kbClothComponent, m_SelfCollisionDistance, false, "")
+	AddField("CollideWithWorld", KBTYPEINFO_BOOL, kbClothComponent, m_bCollideWithWorld, false, "")
 	AddField("Gravity", KBTYPEINFO_VECTOR, kbClothComponent, m_gravity, false, "")
 	AddField("MinWindVelocity", KBTYPEINFO_VECTOR, kbClothComponent, m_MinWindVelocity, false, "")
 	AddField("MaxWindVelocity", KBTYPEINFO_VECTOR, kbClothComponent, m_MaxWindVelocity, false, "")
@@ -135,12 +158,14 @@ GenerateClass(
 	AddField("RenderPass", KBTYPEINFO_ENUM, RenderComponent, m_render_pass, false, "ERenderPass")
 	AddField("RenderOrderBias", KBTYPEINFO_FLOAT, RenderComponent, m_render_order_bias, false, "")
 	AddField("CastsShadow", KBTYPEINFO_BOOL, RenderComponent, m_casts_shadow, false, "")
+	AddField("IsOccluder", KBTYPEINFO_BOOL, RenderComponent, m_is_occluder, false, "")
 	AddField("Materials", KBTYPEINFO_STRUCT, RenderComponent, m_materials, true, "kbMaterialComponent")
 )
 
 GenerateClass(
 	kbStaticModelComponent,
 	AddField("Model", KBTYPEINFO_STATICMODEL, kbStaticModelComponent, m_model, false, "")
+	AddField("ClothCollider", KBTYPEINFO_BOOL, kbStaticModelComponent, m_bClothCollider, false, "")
 )
 
 GenerateClass(
@@ -152,10 +177,35 @@ GenerateClass(
 	AddField("AnimationEvent", KBTYPEINFO_STRUCT, kbAnimComponent, m_anim_events, true, "kbAnimEvent")
 )
 
+GenerateClass(
+	kbAnimPoseNodeInput,
+	AddField("NodeName", KBTYPEINFO_KBSTRING, kbAnimPoseNodeInput, m_node_name, false, "")
+	AddField("BlendPosition", KBTYPEINFO_VECTOR, kbAnimPoseNodeInput, m_blend_position, false, "")
+)
+
+GenerateClass(
+	kbAnimBoneMask,
+	AddField("BoneName", KBTYPEINFO_KBSTRING, kbAnimBoneMask, m_bone_name, false, "")
+	AddField("Weight", KBTYPEINFO_FLOAT, kbAnimBoneMask, m_weight, false, "")
+)
+
+GenerateClass(
+	kbAnimPoseNode,
+	AddField("NodeName", KBTYPEINFO_KBSTRING, kbAnimPoseNode, m_node_name, false, "")
+	AddField("NodeType", KBTYPEINFO_ENUM, kbAnimPoseNode, m_node_type, false, "EAnimPoseNodeType")
+	AddField("AnimationName", KBTYPEINFO_KBSTRING, kbAnimPoseNode, m_animation_name, false, "")
+	AddField("Inputs", KBTYPEINFO_STRUCT, kbAnimPoseNode, m_inputs, true, "kbAnimPoseNodeInput")
+	AddField("Parameter", KBTYPEINFO_KBSTRING, kbAnimPoseNode, m_parameter, false, "")
+	AddField("ParameterY", KBTYPEINFO_KBSTRING, kbAnimPoseNode, m_parameter_y, false, "")
+	AddField("Weight", KBTYPEINFO_FLOAT, kbAnimPoseNode, m_weight, false, "")
+	AddField("BoneMask", KBTYPEINFO_STRUCT, kbAnimPoseNode, m_bone_mask, true, "kbAnimBoneMask")
+)
+
 GenerateClass(
 	SkeletalModelComponent,
 	AddField("Model", KBTYPEINFO_STATICMODEL, SkeletalModelComponent, m_model, false, "")
 	AddField("Animations", KBTYPEINFO_STRUCT, SkeletalModelComponent, m_Animations, true, "kbAnimComponent")
+	AddField("PoseGraph", KBTYPEINFO_STRUCT, SkeletalModelComponent, m_PoseGraphNodes, true, "kbAnimPoseNode")
 	AddField("DebugAnimIndex", KBTYPEINFO_INT, SkeletalModelComponent, m_DebugAnimIdx, false, "")
 )
 
@@ -254,6 +304,14 @@ GenerateEnum(
 	AddEnumField(BT_AlignAlongVelocity, "AlignAlongVelocity")
 )
 
+GenerateEnum(
+	EParticleCollisionResponse, "EParticleCollisionResponse",
+	AddEnumField(PCR_None, "None")
+	AddEnumField(PCR_Bounce, "Bounce")
+	AddEnumField(PCR_Stick, "Stick")
+	AddEnumField(PCR_Die, "Die")
+)
+
 GenerateClass(
 	kbParticleComponent,
 	AddField("DebugPlayEntity", KBTYPEINFO_BOOL, kbParticleComponent, m_DebugPlayEntity, false, "")
@@ -310,6 +368,13 @@ GenerateClass(
 
 	AddField("ParticleBillboardType", KBTYPEINFO_ENUM, kbParticleComponent, m_ParticleBillboardType, false, "EBillboardType")
 
+	AddField("CollisionResponse", KBTYPEINFO_ENUM, kbParticleComponent, m_CollisionResponse, false, "EParticleCollisionResponse")
+	AddField("CollisionBounce", KBTYPEINFO_FLOAT, kbParticleComponent, m_CollisionBounce, false, "")
+	AddField("CollisionFriction", KBTYPEINFO_FLOAT, kbParticleComponent, m_CollisionFriction, false, "")
+	AddField("CollisionRadius", KBTYPEINFO_FLOAT, kbParticleComponent, m_CollisionRadius, false, "")
+
+	AddField("MaxLiveParticles", KBTYPEINFO_INT, kbParticleComponent, m_MaxLiveParticles, false, "")
+
 )
 
 GenerateClass(
@@ -0,0 +1,511 @@
+/// kbTypeInfoSerializer.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "Matrix.h"
+#include "kbGameEntityHeader.h"
+#include "kbTypeInfoSerializer.h"
+
+static const size_t MaxVarintSize = 10;
+
+/// EncodeVarint - Seven bits per byte, low bits first.  Returns the number of bytes written
+static size_t EncodeVarint(u64 value, byte* const pOut) {
+	size_t numBytes = 0;
+	while (value >= 0x80) {
+		pOut[numBytes++] = (byte)(value | 0x80);
+		value >>= 7;
+	}
+	pOut[numBytes++] = (byte)value;
+	return numBytes;
+}
+
+/// WriteVarint
+static void WriteVarint(std::vector<byte>& outBlob, const u64 value) {
+	byte encoded[MaxVarintSize];
+	const size_t numBytes = EncodeVarint(value, encoded);
+	outBlob.insert(outBlob.end(), encoded, encoded + numBytes);
+}
+
+/// InsertSize - Puts a varint byte count of everything written since start in front of it
+static void InsertSize(std::vector<byte>& outBlob, const size_t start) {
+	byte encoded[MaxVarintSize];
+	const size_t numBytes = EncodeVarint(outBlob.size() - start, encoded);
+	outBlob.insert(outBlob.begin() + start, encoded, encoded + numBytes);
+}
+
+/// WriteBytes
+static void WriteBytes(std::vector<byte>& outBlob, const void* const pSrc, const size_t numBytes) {
+	const byte* const pBytes = (const byte*)pSrc;
+	outBlob.insert(outBlob.end(), pBytes, pBytes + numBytes);
+}
+
+/// kbBlobReader - Bounds checked reads.  An overrun marks the reader as failed, after which reads return nothing
+class kbBlobReader {
+public:
+	kbBlobReader(const byte* const pData, const size_t size) : m_pCursor(pData), m_pEnd(pData + size), m_bFailed(false) { }
+
+	bool IsDone() const { return m_pCursor >= m_pEnd || m_bFailed; }
+	bool Failed() const { return m_bFailed; }
+	size_t BytesLeft() const { return (size_t)(m_pEnd - m_pCursor); }
+
+	u64 ReadVarint() {
+		u64 value = 0;
+		for (u32 shift = 0; shift < 64; shift += 7) {
+			if (m_pCursor >= m_pEnd) {
+				break;
+			}
+
+			const byte nextByte = *m_pCursor++;
+			value |= (u64)(nextByte & 0x7f) << shift;
+			if ((nextByte & 0x80) == 0) {
+				return value;
+			}
+		}
+
+		m_bFailed = true;
+		return 0;
+	}
+
+	const byte* ReadBytes(const size_t numBytes) {
+		if (m_bFailed || numBytes > BytesLeft()) {
+			m_bFailed = true;
+			return nullptr;
+		}
+
+		const byte* const pBytes = m_pCursor;
+		m_pCursor += numBytes;
+		return pBytes;
+	}
+
+	void ReadBytes(void* const pDst, const size_t numBytes) {
+		const byte* const pSrc = ReadBytes(numBytes);
+		if (pSrc != nullptr) {
+			memcpy(pDst, pSrc, numBytes);
+		}
+	}
+
+private:
+	const byte* m_pCursor;
+	const byte* m_pEnd;
+	bool m_bFailed;
+};
+
+/// kbFieldRecord_t
+struct kbFieldRecord_t {
+	u64 m_FieldIdx;
+	const byte* m_pValue;
+	size_t m_Size;
+};
+
+/// ReadRecords
+static bool ReadRecords(const std::vector<byte>& blob, std::vector<kbFieldRecord_t>& outRecords) {
+	kbBlobReader reader(blob.data(), blob.size());
+	while (reader.IsDone() == false) {
+		kbFieldRecord_t record;
+		record.m_FieldIdx = reader.ReadVarint();
+		record.m_Size = (size_t)reader.ReadVarint();
+		record.m_pValue = reader.ReadBytes(record.m_Size);
+		if (reader.Failed()) {
+			return false;
+		}
+		outRecords.push_back(record);
+	}
+	return true;
+}
+
+/// WriteRecord
+static void WriteRecord(std::vector<byte>& outBlob, const kbFieldRecord_t& record) {
+	WriteVarint(outBlob, record.m_FieldIdx);
+	WriteVarint(outBlob, record.m_Size);
+	WriteBytes(outBlob, record.m_pValue, record.m_Size);
+}
+
+/// GetFieldAt - Fields are numbered in kbTypeInfoHierarchyIterator order
+static const kbTypeInfoVar* GetFieldAt(const kbComponent* const pComponent, u64 fieldIdx) {
+	const std::vector<kbTypeInfoClass*>& typeInfo = pComponent->GetTypeInfo();
+	for (size_t i = 0; i < typeInfo.size(); i++) {
+		const std::vector<kbTypeInfoVar>& fields = typeInfo[i]->GetFields();
+		if (fieldIdx < fields.size()) {
+			return &fields[(size_t)fieldIdx];
+		}
+		fieldIdx -= fields.size();
+	}
+	return nullptr;
+}
+
+/// WriteValue - kbStrings, kbGameEntityPtrs and resources are plain indices and pointers, so they're copied as bytes
+static void WriteValue(const kbTypeInfoType_t type, const byte* const pValue, std::vector<byte>& outBlob) {
+	switch (type) {
+		case KBTYPEINFO_BOOL: {
+			outBlob.push_back(*(const bool*)pValue ? 1 : 0);
+			break;
+		}
+
+		case KBTYPEINFO_INT:
+		case KBTYPEINFO_ENUM:
+		case KBTYPEINFO_FLOAT: {
+			WriteBytes(outBlob, pValue, sizeof(u32));
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR: {
+			WriteBytes(outBlob, pValue, sizeof(Vec3));
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR4: {
+			WriteBytes(outBlob, pValue, sizeof(Vec4));
+			break;
+		}
+
+		case KBTYPEINFO_STRING: {
+			const std::string& string = *(const std::string*)pValue;
+			WriteVarint(outBlob, string.size());
+			WriteBytes(outBlob, string.data(), string.size());
+			break;
+		}
+
+		case KBTYPEINFO_KBSTRING: {
+			WriteBytes(outBlob, pValue, sizeof(kbString));
+			break;
+		}
+
+		case KBTYPEINFO_SOUNDWAVE:
+		case KBTYPEINFO_ANIMATION:
+		case KBTYPEINFO_PTR:
+		case KBTYPEINFO_TEXTURE:
+		case KBTYPEINFO_STATICMODEL:
+		case KBTYPEINFO_SHADER: {
+			WriteBytes(outBlob, pValue, sizeof(kbResource*));
+			break;
+		}
+
+		case KBTYPEINFO_GAMEENTITY: {
+			WriteBytes(outBlob, pValue, sizeof(kbGameEntityPtr));
+			break;
+		}
+	}
+}
+
+/// ReadValue
+static void ReadValue(const kbTypeInfoType_t type, byte* const pValue, kbBlobReader& reader) {
+	switch (type) {
+		case KBTYPEINFO_BOOL: {
+			const byte* const pByte = reader.ReadBytes(1);
+			if (pByte != nullptr) {
+				*(bool*)pValue = *pByte != 0;
+			}
+			break;
+		}
+
+		case KBTYPEINFO_INT:
+		case KBTYPEINFO_ENUM:
+		case KBTYPEINFO_FLOAT: {
+			reader.ReadBytes(pValue, sizeof(u32));
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR: {
+			reader.ReadBytes(pValue, sizeof(Vec3));
+			break;
+		}
+
+		case KBTYPEINFO_VECTOR4: {
+			reader.ReadBytes(pValue, sizeof(Vec4));
+			break;
+		}
+
+		case KBTYPEINFO_STRING: {
+			const size_t length = (size_t)reader.ReadVarint();
+			const byte* const pChars = reader.ReadBytes(length);
+			if (pChars != nullptr) {
+				((std::string*)pValue)->assign((const char*)pChars, length);
+			}
+			break;
+		}
+
+		case KBTYPEINFO_KBSTRING: {
+			reader.ReadBytes(pValue, sizeof(kbString));
+			break;
+		}
+
+		case KBTYPEINFO_SOUNDWAVE:
+		case KBTYPEINFO_ANIMATION:
+		case KBTYPEINFO_PTR:
+		case KBTYPEINFO_TEXTURE:
+		case KBTYPEINFO_STATICMODEL:
+		case KBTYPEINFO_SHADER: {
+			reader.ReadBytes(pValue, sizeof(kbResource*));
+			break;
+		}
+
+		case KBTYPEINFO_GAMEENTITY: {
+			reader.ReadBytes(pValue, sizeof(kbGameEntityPtr));
+			break;
+		}
+	}
+}
+
+/// WriteField - Returns false for fields that have no value, which are structs outside of arrays
+static bool WriteField(const kbTypeInfoVar& var, const byte* const pValue, std::vector<byte>& outBlob) {
+	if (var.IsArray() == false) {
+		if (var.Type() == KBTYPEINFO_STRUCT) {
+			return false;
+		}
+
+		WriteValue(var.Type(), pValue, outBlob);
+		return true;
+	}
+
+	switch (var.Type()) {
+		case KBTYPEINFO_SHADER:
+		case KBTYPEINFO_TEXTURE: {
+			const std::vector<kbResource*>& resourceList = *(const std::vector<kbResource*>*)pValue;
+			WriteVarint(outBlob, resourceList.size());
+			WriteBytes(outBlob, resourceList.data(), resourceList.size() * sizeof(kbResource*));
+			break;
+		}
+
+		default: {
+			const size_t vectorSize = g_NameToTypeInfoMap->GetVectorSize(pValue, var.GetStructNameHash());
+			WriteVarint(outBlob, vectorSize);
+			for (size_t i = 0; i < vectorSize; i++) {
+				const byte* const arrayElem = (const byte*)g_NameToTypeInfoMap->GetVectorElement(pValue, var.GetStructNameHash(), i);
+				if (var.Type() != KBTYPEINFO_STRUCT) {
+					WriteValue(var.Type(), arrayElem, outBlob);
+					continue;
+				}
+
+				const size_t elementStart = outBlob.size();
+				kbTypeInfoSerializer::Serialize((const kbComponent*)arrayElem, outBlob);
+				InsertSize(outBlob, elementStart);
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+/// ReadField
+static bool ReadField(const kbTypeInfoVar& var, byte* const pValue, kbBlobReader& reader, kbComponent* const pComponent) {
+	if (var.IsArray() == false) {
+		ReadValue(var.Type(), pValue, reader);
+		return reader.Failed() == false;
+	}
+
+	// Every element takes at least a byte
+	const size_t arraySize = (size_t)reader.ReadVarint();
+	if (reader.Failed() || arraySize > reader.BytesLeft()) {
+		return false;
+	}
+
+	switch (var.Type()) {
+		case KBTYPEINFO_SHADER:
+		case KBTYPEINFO_TEXTURE: {
+			std::vector<kbResource*>& resourceList = *(std::vector<kbResource*>*)pValue;
+			const byte* const pPointers = reader.ReadBytes(arraySize * sizeof(kbResource*));
+			if (pPointers == nullptr) {
+				return false;
+			}
+			resourceList.resize(arraySize);
+			memcpy(resourceList.data(), pPointers, arraySize * sizeof(kbResource*));
+			break;
+		}
+
+		default: {
+			g_NameToTypeInfoMap->ResizeVector(pValue, var.GetStructNameHash(), arraySize);
+			for (size_t i = 0; i < arraySize && reader.Failed() == false; i++) {
+				byte* const arrayElem = (byte*)g_NameToTypeInfoMap->GetVectorElement(pValue, var.GetStructNameHash(), i);
+				if (var.Type() != KBTYPEINFO_STRUCT) {
+					ReadValue(var.Type(), arrayElem, reader);
+					continue;
+				}
+
+				const size_t elementSize = (size_t)reader.ReadVarint();
+				const byte* const pElementData = reader.ReadBytes(elementSize);
+				kbComponent* const pElement = (kbComponent*)arrayElem;
+				if (pElementData == nullptr || kbTypeInfoSerializer::Apply(pElementData, elementSize, pElement) == false) {
+					return false;
+				}
+				pElement->SetOwningComponent(pComponent);
+			}
+			break;
+		}
+	}
+	return reader.Failed() == false;
+}
+
+/// kbTypeInfoSerializer::Serialize
+void kbTypeInfoSerializer::Serialize(const kbComponent* const pComponent, std::vector<byte>& outBlob) {
+	const byte* const componentBytePtr = (const byte*)pComponent;
+
+	u64 fieldIdx = 0;
+	kbTypeInfoHierarchyIterator iterator(pComponent);
+	for (kbTypeInfoHierarchyIterator::iteratorType pNextField = iterator.Begin(); iterator.IsDone() == false; pNextField = iterator.GetNextTypeInfoField(), fieldIdx++) {
+
+		const size_t recordStart = outBlob.size();
+		WriteVarint(outBlob, fieldIdx);
+
+		// The byte count goes in front of the value once the value's size is known
+		const size_t valueStart = outBlob.size();
+		if (WriteField(*pNextField, componentBytePtr + pNextField->Offset(), outBlob) == false) {
+			outBlob.resize(recordStart);
+			continue;
+		}
+		InsertSize(outBlob, valueStart);
+	}
+}
+
+/// kbTypeInfoSerializer::Apply
+bool kbTypeInfoSerializer::Apply(const byte* const pData, const size_t size, kbComponent* const pComponent) {
+	byte* const componentBytePtr = (byte*)pComponent;
+
+	kbBlobReader reader(pData, size);
+	while (reader.IsDone() == false) {
+		const u64 fieldIdx = reader.ReadVarint();
+		const size_t valueSize = (size_t)reader.ReadVarint();
+		const byte* const pValueData = reader.ReadBytes(valueSize);
+		if (pValueData == nullptr) {
+			return false;
+		}
+
+		const kbTypeInfoVar* const pVar = GetFieldAt(pComponent, fieldIdx);
+		if (pVar == nullptr) {
+			blk::warn("kbTypeInfoSerializer::Apply() - %s has no field %u", pComponent->GetComponentClassName(), (u32)fieldIdx);
+			return false;
+		}
+
+		kbBlobReader valueReader(pValueData, valueSize);
+		if (ReadField(*pVar, componentBytePtr + pVar->Offset(), valueReader, pComponent) == false || valueReader.BytesLeft() != 0) {
+			blk::warn("kbTypeInfoSerializer::Apply() - Malformed value for %s::%s", pComponent->GetComponentClassName(), pVar->GetName().c_str());
+			return false;
+		}
+	}
+
+	return reader.Failed() == false;
+}
+
+/// kbTypeInfoSerializer::Diff
+bool kbTypeInfoSerializer::Diff(const kbComponent* const pBase, const kbComponent* const pChanged, std::vector<byte>& outDelta) {
+	if (&pBase->GetTypeInfo() != &pChanged->GetTypeInfo()) {
+		blk::warn("kbTypeInfoSerializer::Diff() - Can't diff a %s against a %s", pBase->GetComponentClassName(), pChanged->GetComponentClassName());
+		return false;
+	}
+
+	std::vector<byte> baseBlob, changedBlob;
+	Serialize(pBase, baseBlob);
+	Serialize(pChanged, changedBlob);
+	return Diff(baseBlob, changedBlob, outDelta, nullptr);
+}
+
+/// kbTypeInfoSerializer::Diff
+bool kbTypeInfoSerializer::Diff(const std::vector<byte>& baseBlob, const std::vector<byte>& changedBlob, std::vector<byte>& outForward, std::vector<byte>* const pOutBackward) {
+	std::vector<kbFieldRecord_t> baseRecords, changedRecords;
+	if (ReadRecords(baseBlob, baseRecords) == false || ReadRecords(changedBlob, changedRecords) == false) {
+		blk::warn("kbTypeInfoSerializer::Diff() - Malformed blob");
+		return false;
+	}
+
+	// Records are in field order, so the two lists are merged
+	bool bDiffers = false;
+	size_t baseIdx = 0, changedIdx = 0;
+	while (baseIdx < baseRecords.size() || changedIdx < changedRecords.size()) {
+		const kbFieldRecord_t* const pBase = (baseIdx < baseRecords.size()) ? &baseRecords[baseIdx] : nullptr;
+		const kbFieldRecord_t* const pChanged = (changedIdx < changedRecords.size()) ? &changedRecords[changedIdx] : nullptr;
+
+		if (pBase != nullptr && pChanged != nullptr && pBase->m_FieldIdx == pChanged->m_FieldIdx) {
+			baseIdx++;
+			changedIdx++;
+			if (pBase->m_Size == pChanged->m_Size && memcmp(pBase->m_pValue, pChanged->m_pValue, pBase->m_Size) == 0) {
+				continue;
+			}
+
+			WriteRecord(outForward, *pChanged);
+			if (pOutBackward != nullptr) {
+				WriteRecord(*pOutBackward, *pBase);
+			}
+		} else if (pChanged != nullptr && (pBase == nullptr || pChanged->m_FieldIdx < pBase->m_FieldIdx)) {
+			changedIdx++;
+			WriteRecord(outForward, *pChanged);
+		} else {
+			baseIdx++;
+			if (pOutBackward != nullptr) {
+				WriteRecord(*pOutBackward, *pBase);
+			}
+		}
+		bDiffers = true;
+	}
+
+	return bDiffers;
+}
+
+/// kbTypeInfoSerializer::Clone
+void kbTypeInfoSerializer::Clone(const kbComponent* const pSrc, kbComponent* const pDst) {
+	if (&pSrc->GetTypeInfo() != &pDst->GetTypeInfo()) {
+		blk::warn("kbTypeInfoSerializer::Clone() - Can't copy a %s onto a %s", pSrc->GetComponentClassName(), pDst->GetComponentClassName());
+		return;
+	}
+
+	std::vector<byte> blob;
+	Serialize(pSrc, blob);
+	Apply(blob, pDst);
+}
+
+/// kbTypeInfoSerializer::HasSameLayout
+bool kbTypeInfoSerializer::HasSameLayout(const kbGameEntity* const pA, const kbGameEntity* const pB) {
+	if (pA->NumComponents() != pB->NumComponents()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < pA->NumComponents(); i++) {
+		if (&pA->GetComponent(i)->GetTypeInfo() != &pB->GetComponent(i)->GetTypeInfo()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// kbTypeInfoSerializer::DiffEntity
+bool kbTypeInfoSerializer::DiffEntity(const kbGameEntity* const pBase, const kbGameEntity* const pChanged, std::vector<byte>& outDelta) {
+	if (HasSameLayout(pBase, pChanged) == false) {
+		blk::warn("kbTypeInfoSerializer::DiffEntity() - %s and %s have different components", pBase->GetName().c_str(), pChanged->GetName().c_str());
+		return false;
+	}
+
+	bool bDiffers = false;
+	std::vector<byte> componentDelta;
+	for (size_t i = 0; i < pBase->NumComponents(); i++) {
+		componentDelta.clear();
+		if (Diff(pBase->GetComponent(i), pChanged->GetComponent(i), componentDelta) == false) {
+			continue;
+		}
+
+		WriteVarint(outDelta, i);
+		WriteVarint(outDelta, componentDelta.size());
+		WriteBytes(outDelta, componentDelta.data(), componentDelta.size());
+		bDiffers = true;
+	}
+
+	return bDiffers;
+}
+
+/// kbTypeInfoSerializer::ApplyEntity
+bool kbTypeInfoSerializer::ApplyEntity(const byte* const pData, const size_t size, kbGameEntity* const pEntity) {
+	kbBlobReader reader(pData, size);
+	while (reader.IsDone() == false) {
+		const u64 componentIdx = reader.ReadVarint();
+		const size_t deltaSize = (size_t)reader.ReadVarint();
+		const byte* const pDelta = reader.ReadBytes(deltaSize);
+		if (pDelta == nullptr || componentIdx >= pEntity->NumComponents()) {
+			blk::warn("kbTypeInfoSerializer::ApplyEntity() - Malformed delta for %s", pEntity->GetName().c_str());
+			return false;
+		}
+
+		if (Apply(pDelta, deltaSize, pEntity->GetComponent((size_t)componentIdx)) == false) {
+			return false;
+		}
+	}
+
+	return reader.Failed() == false;
+}
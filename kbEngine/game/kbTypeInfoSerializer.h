@@ -0,0 +1,49 @@
+/// kbTypeInfoSerializer.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+
+class kbComponent;
+class kbGameEntity;
+
+/// kbTypeInfoSerializer
+///
+/// Serializes, diffs, applies and clones components and entities by walking their kbTypeInfo.  A component is a list of
+/// field records, each holding a varint field index, a varint byte count and the field's value.  A snapshot has a record
+/// for every field and a delta only has records for the fields that changed, so Apply() reads both.  Arrays of structs
+/// nest a record list per element.
+///
+/// kbStrings, resources and entity pointers are written as their in-memory values, so a blob is only valid in the process
+/// that wrote it.  Blobs are meant for undo, prefab updates and other in-editor copies.  Packages remain the on-disk format
+class kbTypeInfoSerializer {
+public:
+	/// Appends a record for every field of pComponent
+	static void Serialize(const kbComponent* const pComponent, std::vector<byte>& outBlob);
+
+	/// Applies a snapshot or delta to a component of the class it was written from.  Returns false if the data is
+	/// malformed, which can leave some fields applied
+	static bool Apply(const byte* const pData, const size_t size, kbComponent* const pComponent);
+	static bool Apply(const std::vector<byte>& data, kbComponent* const pComponent) { return Apply(data.data(), data.size(), pComponent); }
+
+	/// Writes pChanged's value of each field that differs from pBase.  Both must be the same class.  Returns false
+	/// if nothing differs
+	static bool Diff(const kbComponent* const pBase, const kbComponent* const pChanged, std::vector<byte>& outDelta);
+
+	/// Diffs two snapshots of the same class.  outForward takes changedBlob's values and pOutBackward, if given, takes
+	/// baseBlob's values, so the two deltas redo and undo the change
+	static bool Diff(const std::vector<byte>& baseBlob, const std::vector<byte>& changedBlob, std::vector<byte>& outForward, std::vector<byte>* const pOutBackward);
+
+	/// Copies every reflected field of pSrc onto pDst, which must be the same class
+	static void Clone(const kbComponent* const pSrc, kbComponent* const pDst);
+
+	/// True if both entities have the same component classes in the same order
+	static bool HasSameLayout(const kbGameEntity* const pA, const kbGameEntity* const pB);
+
+	/// Entity deltas are a varint component index and byte count followed by that component's delta
+	static bool DiffEntity(const kbGameEntity* const pBase, const kbGameEntity* const pChanged, std::vector<byte>& outDelta);
+	static bool ApplyEntity(const byte* const pData, const size_t size, kbGameEntity* const pEntity);
+	static bool ApplyEntity(const std::vector<byte>& data, kbGameEntity* const pEntity) { return ApplyEntity(data.data(), data.size(), pEntity); }
+};
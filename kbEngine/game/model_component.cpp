@@ -8,24 +8,33 @@
 #include "kbGameEntityHeader.h"
 #include "kbRenderer.h"
 #include "renderer.h"
+#include "blk_console.h"
+#include "kbJobManager.h"
 #include "dx11/kbRenderer_DX11.h"
 
+kbConsoleVariable g_ParallelAnimation("parallelanimation", true, kbConsoleVariable::Console_Bool, "Evaluate skeletal poses on the job threads after all entities have updated.", "");
+kbConsoleVariable g_AnimSampleBenchmark("animsamplebenchmark", false, kbConsoleVariable::Console_Bool, "Benchmark key searches on the longest animation of the next skeletal model to update.", "");
+
+static std::vector<SkeletalModelComponent*> g_PendingPoseComponents;
+
 KB_DEFINE_COMPONENT(kbStaticModelComponent)
 
 /// RenderComponent
 void kbStaticModelComponent::Constructor() {
 	m_model = nullptr;
+	m_bClothCollider = false;
 }
 
 /// ~kbStaticModelComponent
 kbStaticModelComponent::~kbStaticModelComponent() {
+	kbClothComponent::RemoveWorldCollider(this);
 }
 
 /// kbStaticModelComponent::EditorChange
 void kbStaticModelComponent::editor_change(const std::string& propertyName) {
 	Super::editor_change(propertyName);
 
-	if (IsEnabled() && (propertyName == "Model" || propertyName == "ShaderOverride")) {
+	if (IsEnabled() && (propertyName == "Model" || propertyName == "ShaderOverride" || propertyName == "ClothCollider")) {
 		enable_internal(false);
 		enable_internal(true);
 	}
@@ -36,6 +45,12 @@ void kbStaticModelComponent::enable_internal(const bool isEnabled) {
 
 	Super::enable_internal(isEnabled);
 
+	// Removing first covers the model having changed since this was added
+	kbClothComponent::RemoveWorldCollider(this);
+	if (isEnabled && m_bClothCollider && m_model != nullptr) {
+		kbClothComponent::AddWorldCollider(this);
+	}
+
 	if (m_model == nullptr) {
 		return;
 	}
@@ -45,6 +60,7 @@ void kbStaticModelComponent::enable_internal(const bool isEnabled) {
 	if (isEnabled) {
 
 		m_render_object.m_casts_shadow = this->GetCastsShadow();
+		m_render_object.m_is_occluder = this->is_occluder();
 		m_render_object.m_bIsSkinnedModel = false;
 		m_render_object.m_EntityId = GetOwner()->GetEntityId();
 		m_render_object.m_Orientation = GetOwner()->GetOrientation();
@@ -98,6 +114,22 @@ void kbAnimComponent::Constructor() {
 	m_current_animation_time = -1.0f;
 }
 
+/// kbAnimPoseNodeInput::Constructor
+void kbAnimPoseNodeInput::Constructor() {
+	m_blend_position = Vec3::zero;
+}
+
+/// kbAnimBoneMask::Constructor
+void kbAnimBoneMask::Constructor() {
+	m_weight = 1.0f;
+}
+
+/// kbAnimPoseNode::Constructor
+void kbAnimPoseNode::Constructor() {
+	m_node_type = PoseNode_Clip;
+	m_weight = 1.0f;
+}
+
 /// SkeletalModelComponent::Constructor
 void SkeletalModelComponent::Constructor() {
 	m_model = nullptr;
@@ -113,10 +145,16 @@ void SkeletalModelComponent::Constructor() {
 
 	m_DebugAnimIdx = -1;
 	m_DebugAnimTime = 0.0f;
+
+	m_bPosePending = false;
 }
 
 /// SkeletalModelComponent::~SkeletalModelComponent
-SkeletalModelComponent::~SkeletalModelComponent() {}
+SkeletalModelComponent::~SkeletalModelComponent() {
+	if (m_bPosePending) {
+		blk::std_remove_swap(g_PendingPoseComponents, this);
+	}
+}
 
 /// SkeletalModelComponent::EditorChange
 void SkeletalModelComponent::editor_change(const std::string& propertyName) {
@@ -125,6 +163,10 @@ void SkeletalModelComponent::editor_change(const std::string& propertyName) {
 	if (propertyName == "Model" || propertyName == "ShaderOverride") {
 		refresh_materials(true);
 	}
+
+	if (propertyName == "Model" || propertyName == "Animations" || propertyName == "PoseGraph") {
+		BuildPoseGraph();
+	}
 }
 
 /// SkeletalModelComponent::enable_internal
@@ -160,6 +202,8 @@ void SkeletalModelComponent::enable_internal(const bool isEnabled) {
 		for (int i = 0; i < m_AnimationTimeScaleMultipliers.size(); i++) {
 			m_AnimationTimeScaleMultipliers[i] = 1.0f;
 		}
+
+		BuildPoseGraph();
 	} else {
 		g_pRenderer->RemoveRenderObject(m_render_object);
 
@@ -174,10 +218,28 @@ void SkeletalModelComponent::update_internal(const float DeltaTime) {
 	Super::update_internal(DeltaTime);
 
 	if (m_model != nullptr && m_pSyncParent == nullptr) {
+		FinishPose();
+		m_PoseRequest = poseRequest_t();
+		m_PoseRequest.m_DeltaTime = DeltaTime;
+
 		if (m_BindToLocalSpaceMatrices.size() != m_model->NumBones()) {
 			m_BindToLocalSpaceMatrices.resize(m_model->NumBones());
 		}
 
+		if (g_AnimSampleBenchmark.GetBool()) {
+			const kbAnimComponent* pLongestAnim = nullptr;
+			for (int i = 0; i < m_Animations.size(); i++) {
+				if (m_Animations[i].m_animation != nullptr && (pLongestAnim == nullptr || m_Animations[i].m_animation->GetLengthInSeconds() > pLongestAnim->m_animation->GetLengthInSeconds())) {
+					pLongestAnim = &m_Animations[i];
+				}
+			}
+
+			if (pLongestAnim != nullptr) {
+				m_model->BenchmarkAnimationSampling(pLongestAnim->m_animation, pLongestAnim->m_is_looping, 10000);
+				g_AnimSampleBenchmark.SetBool(false);
+			}
+		}
+
 		// Debug Animation
 		if (m_DebugAnimIdx >= 0 && m_DebugAnimIdx < m_Animations.size() && m_Animations[m_DebugAnimIdx].m_animation != nullptr) {
 			if (m_model != nullptr) {
@@ -192,37 +254,8 @@ void SkeletalModelComponent::update_internal(const float DeltaTime) {
 					}
 				}
 
-				if (m_BindToLocalSpaceMatrices.size() == 0) {
-					m_BindToLocalSpaceMatrices.resize(m_model->NumBones());
-				}
-				m_model->Animate(m_BindToLocalSpaceMatrices, m_DebugAnimTime, m_Animations[m_DebugAnimIdx].m_animation, m_Animations[m_DebugAnimIdx].m_is_looping);
-			}
-		} else {
-			for (int i = 0; i < m_model->NumBones(); i++) {
-				m_BindToLocalSpaceMatrices[i].SetIdentity();
-			}
-		}
-
-		BreakableComponent* const pDestructible = (BreakableComponent*)GetOwner()->GetComponentByType(BreakableComponent::GetType());
-		if (pDestructible != nullptr && pDestructible->is_simulating()) {
-			const std::vector<BreakableComponent::DestructibleBone_t>& brokenBones = pDestructible->get_bones();
-			const kbModel* const pModel = this->model();
-			for (int i = 0; i < brokenBones.size(); i++) {
-				const BreakableComponent::DestructibleBone_t& destructibleBone = brokenBones[i];
-
-				Quat4 rot;
-				rot.from_axis_angle(destructibleBone.m_rotation_axis, destructibleBone.m_cur_rotation_angle);
-				Mat4 matRot = rot.to_mat4();
-				m_BindToLocalSpaceMatrices[i].SetAxis(0, matRot[0].ToVec3());
-				m_BindToLocalSpaceMatrices[i].SetAxis(1, matRot[1].ToVec3());
-				m_BindToLocalSpaceMatrices[i].SetAxis(2, matRot[2].ToVec3());
-
-				m_BindToLocalSpaceMatrices[i].SetAxis(3, destructibleBone.m_position);
-
-				m_BindToLocalSpaceMatrices[i] = pModel->GetInvRefBoneMatrix(i) * m_BindToLocalSpaceMatrices[i];
-
-				//kbVec3 worldPos = destructibleBone.m_position * GetOwner()->GetOrientation().ToMat4() + GetOwner()->GetPosition();
-				//g_pRenderer->DrawBox( kbBounds( worldPos - kbVec3::one * 0.1f, worldPos + kbVec3::one * 0.1f ), kbColor::red );
+				m_PoseRequest.m_DebugAnimIdx = m_DebugAnimIdx;
+				m_PoseRequest.m_DebugAnimTime = m_DebugAnimTime;
 			}
 		}
 
@@ -308,7 +341,8 @@ void SkeletalModelComponent::update_internal(const float DeltaTime) {
 				if (bOutput) blk::log("	Not blending anim %s. anim time = %f", CurAnim.m_animation_name.c_str(), CurAnim.m_current_animation_time);
 #endif
 
-				m_model->Animate(m_BindToLocalSpaceMatrices, CurAnim.m_current_animation_time, CurAnim.m_animation, CurAnim.m_is_looping);
+				m_PoseRequest.m_AnimIdx = m_CurrentAnimation;
+				m_PoseRequest.m_AnimTime = CurAnim.m_current_animation_time;
 
 				if (bAnimIsFinished && CurAnim.m_desired_next_animation.IsEmptyString() == false) {
 
@@ -380,13 +414,23 @@ void SkeletalModelComponent::update_internal(const float DeltaTime) {
 				}
 
 				const float blendTime = kbClamp((g_GlobalTimer.TimeElapsedSeconds() - m_BlendStartTime) / m_BlendLength, 0.0f, 1.0f);
-				m_model->BlendAnimations(m_BindToLocalSpaceMatrices, CurAnim.m_animation, CurAnim.m_current_animation_time, CurAnim.m_is_looping, NextAnim.m_animation, NextAnim.m_current_animation_time, NextAnim.m_is_looping, blendTime);
+				m_PoseRequest.m_AnimIdx = m_CurrentAnimation;
+				m_PoseRequest.m_AnimTime = CurAnim.m_current_animation_time;
+				m_PoseRequest.m_BlendAnimIdx = m_NextAnimation;
+				m_PoseRequest.m_BlendAnimTime = NextAnim.m_current_animation_time;
+				m_PoseRequest.m_BlendTime = blendTime;
 
 #if DEBUG_ANIMS
 				if (bOutput) blk::log("	Blending anims %f.  %s cur time = %f. %s cur time is %f", blendTime, CurAnim.animation_name().c_str(), CurAnim.m_current_animation_time, NextAnim.animation_name().c_str(), NextAnim.m_current_animation_time);
 #endif
 			}
 		}
+
+		RequestPose();
+	} else {
+		for (int i = 0; i < m_SyncedSkelModels.size(); i++) {
+			m_SyncedSkelModels[i]->m_BindToLocalSpaceMatrices = m_BindToLocalSpaceMatrices;
+		}
 	}
 
 	m_render_object.m_pComponent = this;
@@ -396,12 +440,231 @@ void SkeletalModelComponent::update_internal(const float DeltaTime) {
 	m_render_object.m_model = m_model;
 	m_render_object.m_render_pass = m_render_pass;
 	g_pRenderer->UpdateRenderObject(m_render_object);
+}
+
+/// SkeletalModelComponent::RequestPose
+void SkeletalModelComponent::RequestPose() {
+	if (g_ParallelAnimation.GetBool() == false) {
+		EvaluatePose();
+		return;
+	}
+
+	if (m_bPosePending == false) {
+		m_bPosePending = true;
+		g_PendingPoseComponents.push_back(this);
+	}
+}
+
+/// SkeletalModelComponent::EvaluatePose
+///
+/// Only touches this component, its synced models, and read-only model and animation data so that poses can be
+/// evaluated on any thread
+void SkeletalModelComponent::EvaluatePose() {
+	m_bPosePending = false;
+
+	if (m_model == nullptr) {
+		return;
+	}
+
+	// The model can be swapped between the request and the evaluation
+	if (m_BindToLocalSpaceMatrices.size() != m_model->NumBones()) {
+		m_BindToLocalSpaceMatrices.resize(m_model->NumBones());
+	}
+
+	if (m_PoseRequest.m_DebugAnimIdx >= 0) {
+		kbAnimComponent& debugAnim = m_Animations[m_PoseRequest.m_DebugAnimIdx];
+		m_model->Animate(m_BindToLocalSpaceMatrices, m_PoseRequest.m_DebugAnimTime, debugAnim.m_animation, debugAnim.m_is_looping, &debugAnim.m_key_cursor, &m_PoseBuffer);
+	} else {
+		for (int i = 0; i < m_BindToLocalSpaceMatrices.size(); i++) {
+			m_BindToLocalSpaceMatrices[i].SetIdentity();
+		}
+	}
+
+	BreakableComponent* const pDestructible = (BreakableComponent*)GetOwner()->GetComponentByType(BreakableComponent::GetType());
+	if (pDestructible != nullptr && pDestructible->is_simulating()) {
+		const std::vector<BreakableComponent::DestructibleBone_t>& brokenBones = pDestructible->get_bones();
+		const kbModel* const pModel = this->model();
+		for (int i = 0; i < brokenBones.size(); i++) {
+			const BreakableComponent::DestructibleBone_t& destructibleBone = brokenBones[i];
+
+			Quat4 rot;
+			rot.from_axis_angle(destructibleBone.m_rotation_axis, destructibleBone.m_cur_rotation_angle);
+			Mat4 matRot = rot.to_mat4();
+			m_BindToLocalSpaceMatrices[i].SetAxis(0, matRot[0].ToVec3());
+			m_BindToLocalSpaceMatrices[i].SetAxis(1, matRot[1].ToVec3());
+			m_BindToLocalSpaceMatrices[i].SetAxis(2, matRot[2].ToVec3());
+
+			m_BindToLocalSpaceMatrices[i].SetAxis(3, destructibleBone.m_position);
+
+			m_BindToLocalSpaceMatrices[i] = pModel->GetInvRefBoneMatrix(i) * m_BindToLocalSpaceMatrices[i];
+
+			//kbVec3 worldPos = destructibleBone.m_position * GetOwner()->GetOrientation().ToMat4() + GetOwner()->GetPosition();
+			//g_pRenderer->DrawBox( kbBounds( worldPos - kbVec3::one * 0.1f, worldPos + kbVec3::one * 0.1f ), kbColor::red );
+		}
+	}
+
+	if (m_PoseGraph.IsFinalized()) {
+
+		// External nodes read the PlayAnimation() pose, so only sample it if something reads it
+		std::vector<AnimatedBone_t>* pExternalPose = nullptr;
+		if (m_PoseGraph.UsesExternalPose() && m_PoseRequest.m_AnimIdx >= 0) {
+			kbAnimComponent& curAnim = m_Animations[m_PoseRequest.m_AnimIdx];
+			m_model->SetBoneMatrices(m_PoseBuffer.m_FromPose, m_PoseRequest.m_AnimTime, curAnim.m_animation, curAnim.m_is_looping, &curAnim.m_key_cursor);
+
+			if (m_PoseRequest.m_BlendAnimIdx >= 0) {
+				kbAnimComponent& nextAnim = m_Animations[m_PoseRequest.m_BlendAnimIdx];
+				m_model->SetBoneMatrices(m_PoseBuffer.m_ToPose, m_PoseRequest.m_BlendAnimTime, nextAnim.m_animation, nextAnim.m_is_looping, &nextAnim.m_key_cursor);
+				kbAnimPoseGraph::BlendPoses(m_PoseBuffer.m_FromPose, m_PoseBuffer.m_FromPose, m_PoseBuffer.m_ToPose, m_PoseRequest.m_BlendTime);
+			}
+			pExternalPose = &m_PoseBuffer.m_FromPose;
+		}
+
+		std::vector<AnimatedBone_t>* const pPose = m_PoseGraph.Evaluate(*m_model, m_PoseRequest.m_DeltaTime, pExternalPose);
+		if (pPose != nullptr) {
+			m_model->BuildBoneMatrices(m_BindToLocalSpaceMatrices, *pPose);
+		}
+	} else if (m_PoseRequest.m_AnimIdx >= 0) {
+		kbAnimComponent& curAnim = m_Animations[m_PoseRequest.m_AnimIdx];
+		if (m_PoseRequest.m_BlendAnimIdx >= 0) {
+			kbAnimComponent& nextAnim = m_Animations[m_PoseRequest.m_BlendAnimIdx];
+			m_model->BlendAnimations(m_BindToLocalSpaceMatrices, curAnim.m_animation, m_PoseRequest.m_AnimTime, curAnim.m_is_looping, nextAnim.m_animation, m_PoseRequest.m_BlendAnimTime, nextAnim.m_is_looping, m_PoseRequest.m_BlendTime, &curAnim.m_key_cursor, &nextAnim.m_key_cursor, &m_PoseBuffer);
+		} else {
+			m_model->Animate(m_BindToLocalSpaceMatrices, m_PoseRequest.m_AnimTime, curAnim.m_animation, curAnim.m_is_looping, &curAnim.m_key_cursor, &m_PoseBuffer);
+		}
+	}
 
 	for (int i = 0; i < m_SyncedSkelModels.size(); i++) {
 		m_SyncedSkelModels[i]->m_BindToLocalSpaceMatrices = m_BindToLocalSpaceMatrices;
 	}
 }
 
+/// SkeletalModelComponent::BuildPoseGraph
+void SkeletalModelComponent::BuildPoseGraph() {
+	FinishPose();
+	m_PoseGraph.Reset();
+
+	if (m_model == nullptr || m_PoseGraphNodes.size() == 0) {
+		return;
+	}
+
+	std::vector<i32> graphNodeIndices(m_PoseGraphNodes.size(), -1);
+	for (size_t iNode = 0; iNode < m_PoseGraphNodes.size(); iNode++) {
+		const kbAnimPoseNode& nodeDesc = m_PoseGraphNodes[iNode];
+
+		// Inputs can only reference nodes listed before this one
+		std::vector<i32> inputNodes;
+		std::vector<Vec2> samplePositions;
+		for (size_t iInput = 0; iInput < nodeDesc.m_inputs.size(); iInput++) {
+			i32 inputIdx = -1;
+			for (size_t iPrev = 0; iPrev < iNode; iPrev++) {
+				if (m_PoseGraphNodes[iPrev].m_node_name == nodeDesc.m_inputs[iInput].m_node_name) {
+					inputIdx = graphNodeIndices[iPrev];
+				}
+			}
+			inputNodes.push_back(inputIdx);
+
+			const Vec3& blendPos = nodeDesc.m_inputs[iInput].m_blend_position;
+			samplePositions.push_back(Vec2(blendPos.x, blendPos.y));
+		}
+
+		const i32 param = (nodeDesc.m_parameter.IsEmptyString()) ? (-1) : (m_PoseGraph.AddParameter(nodeDesc.m_parameter));
+		const i32 input0 = (inputNodes.size() > 0) ? (inputNodes[0]) : (-1);
+		const i32 input1 = (inputNodes.size() > 1) ? (inputNodes[1]) : (-1);
+		const i32 input2 = (inputNodes.size() > 2) ? (inputNodes[2]) : (-1);
+
+		i32 graphNodeIdx = -1;
+		switch (nodeDesc.m_node_type) {
+			case PoseNode_Clip: {
+				for (int i = 0; i < m_Animations.size(); i++) {
+					if (m_Animations[i].m_animation_name == nodeDesc.m_animation_name) {
+						graphNodeIdx = m_PoseGraph.AddClipNode(m_Animations[i].m_animation, m_Animations[i].m_is_looping, m_Animations[i].m_time_scale);
+						break;
+					}
+				}
+				break;
+			}
+
+			case PoseNode_Blend: {
+				graphNodeIdx = m_PoseGraph.AddBlendNode(input0, input1, param, nodeDesc.m_weight);
+				break;
+			}
+
+			case PoseNode_Additive: {
+				graphNodeIdx = m_PoseGraph.AddAdditiveNode(input0, input1, input2, param, nodeDesc.m_weight);
+				break;
+			}
+
+			case PoseNode_Layer: {
+				std::vector<kbString> maskBones;
+				std::vector<f32> maskWeights;
+				for (size_t i = 0; i < nodeDesc.m_bone_mask.size(); i++) {
+					maskBones.push_back(nodeDesc.m_bone_mask[i].m_bone_name);
+					maskWeights.push_back(nodeDesc.m_bone_mask[i].m_weight);
+				}
+
+				std::vector<f32> boneWeights;
+				kbAnimPoseGraph::BuildBoneMask(*m_model, maskBones, maskWeights, boneWeights);
+				graphNodeIdx = m_PoseGraph.AddLayerNode(input0, input1, boneWeights, param, nodeDesc.m_weight);
+				break;
+			}
+
+			case PoseNode_BlendSpace1D:
+			case PoseNode_BlendSpace2D: {
+				const bool bIs2D = nodeDesc.m_node_type == PoseNode_BlendSpace2D;
+				const i32 yParam = (bIs2D && nodeDesc.m_parameter_y.IsEmptyString() == false) ? (m_PoseGraph.AddParameter(nodeDesc.m_parameter_y)) : (-1);
+				if (bIs2D && yParam == -1) {
+					break;
+				}
+				graphNodeIdx = m_PoseGraph.AddBlendSpaceNode(inputNodes, samplePositions, param, yParam);
+				break;
+			}
+
+			case PoseNode_External: {
+				graphNodeIdx = m_PoseGraph.AddExternalNode();
+				break;
+			}
+		}
+
+		if (graphNodeIdx == -1) {
+			blk::warn("SkeletalModelComponent::BuildPoseGraph() - %s has an invalid pose node %s.  Falling back to PlayAnimation()", GetOwner()->GetName().c_str(), nodeDesc.m_node_name.c_str());
+			m_PoseGraph.Reset();
+			return;
+		}
+		graphNodeIndices[iNode] = graphNodeIdx;
+	}
+
+	m_PoseGraph.Finalize(*m_model);
+}
+
+/// SkeletalModelComponent::SetPoseGraphParameter
+void SkeletalModelComponent::SetPoseGraphParameter(const kbString& paramName, const f32 value) {
+	const i32 paramIdx = m_PoseGraph.FindParameter(paramName);
+	if (paramIdx == -1) {
+		return;
+	}
+
+	m_PoseGraph.SetParameter(paramIdx, value);
+}
+
+/// SkeletalModelComponent::EvaluatePendingPoses
+void SkeletalModelComponent::EvaluatePendingPoses() {
+	START_SCOPED_TIMER(SKELETAL_ANIMATION);
+
+	const size_t numPending = g_PendingPoseComponents.size();
+	if (numPending == 0) {
+		return;
+	}
+
+	// One batch per job thread plus one for this thread.  Small lists aren't worth the hand off
+	static const size_t MinComponentsPerJob = 4;
+	static kbJobBatches<SkeletalModelComponent*> poseJobs;
+
+	poseJobs.Kick(g_PendingPoseComponents.data(), numPending, MinComponentsPerJob, [](SkeletalModelComponent*& pComponent) { pComponent->FinishPose(); }, true);
+	poseJobs.Wait();
+
+	g_PendingPoseComponents.clear();
+}
+
 /// SkeletalModelComponent::GetBoneIndex
 int SkeletalModelComponent::GetBoneIndex(const kbString& boneName) {
 	if (m_model == nullptr) {
@@ -417,6 +680,8 @@ kbBoneMatrix_t SkeletalModelComponent::GetBoneRefMatrix(int index) {
 
 /// SkeletalModelComponent::GetBoneWorldPosition
 bool SkeletalModelComponent::GetBoneWorldPosition(const kbString& boneName, Vec3& outWorldPosition) {
+	FinishPose();
+
 	const int boneIdx = GetBoneIndex(boneName);
 	if (boneIdx == -1 || boneIdx >= m_BindToLocalSpaceMatrices.size()) {
 		return false;
@@ -432,6 +697,8 @@ bool SkeletalModelComponent::GetBoneWorldPosition(const kbString& boneName, Vec3
 
 /// SkeletalModelComponent::GetBoneWorldMatrix
 bool SkeletalModelComponent::GetBoneWorldMatrix(const kbString& boneName, kbBoneMatrix_t& boneMatrix) {
+	FinishPose();
+
 	const int boneIdx = GetBoneIndex(boneName);
 	if (boneIdx == -1 || boneIdx >= m_BindToLocalSpaceMatrices.size()) {
 		return false;
@@ -445,6 +712,36 @@ bool SkeletalModelComponent::GetBoneWorldMatrix(const kbString& boneName, kbBone
 	return true;
 }
 
+/// SkeletalModelComponent::GetPoseBounds
+bool SkeletalModelComponent::GetPoseBounds(kbBounds& outBounds, const bool bExact) {
+	outBounds.Reset();
+	if (m_model == nullptr || m_model->GetSkinnedMesh().IsValid() == false) {
+		return false;
+	}
+
+	FinishPose();
+	if (bExact) {
+		m_model->GetSkinnedMesh().Skin(m_BindToLocalSpaceMatrices, nullptr, outBounds);
+		return true;
+	}
+
+	return m_model->GetSkinnedMesh().ComputeBounds(m_BindToLocalSpaceMatrices, outBounds);
+}
+
+/// SkeletalModelComponent::SkinVertices
+bool SkeletalModelComponent::SkinVertices(std::vector<Vec3>& outPositions, kbBounds& outBounds) {
+	outBounds.Reset();
+	if (m_model == nullptr || m_model->GetSkinnedMesh().IsValid() == false) {
+		outPositions.clear();
+		return false;
+	}
+
+	FinishPose();
+	outPositions.resize(m_model->GetSkinnedMesh().NumVertices());
+	m_model->GetSkinnedMesh().Skin(m_BindToLocalSpaceMatrices, outPositions.data(), outBounds);
+	return true;
+}
+
 /// SkeletalModelComponent::SetAnimationTimeScaleMultiplier
 void SkeletalModelComponent::SetAnimationTimeScaleMultiplier(const kbString& animName, const float factor) {
 	for (int i = 0; i < m_Animations.size(); i++) {
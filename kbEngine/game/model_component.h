@@ -6,6 +6,7 @@
 
 #include "render_component.h"
 #include "kbModel.h"
+#include "kbAnimPoseGraph.h"
 
 class kbAnimation;
 
@@ -27,6 +28,7 @@ protected:
 
 private:
 	class kbModel* m_model;
+	bool m_bClothCollider;		// Cloth with CollideWithWorld set collides with this model's triangles
 };
 
 /// kbAnimComponent
@@ -48,8 +50,53 @@ private:
 	float m_current_animation_time;
 	kbString m_desired_next_animation;
 	float m_desired_next_anim_blend_length;
+
+	kbAnimationCursor_t m_key_cursor;
+};
+
+/// kbAnimPoseNodeInput
+class kbAnimPoseNodeInput : public kbGameComponent {
+	friend class SkeletalModelComponent;
+
+	KB_DECLARE_COMPONENT(kbAnimPoseNodeInput, kbGameComponent);
+
+private:
+	kbString m_node_name;
+	Vec3 m_blend_position;		// Blend spaces only.  x for 1D, x and y for 2D
+};
+
+/// kbAnimBoneMask
+class kbAnimBoneMask : public kbGameComponent {
+	friend class SkeletalModelComponent;
+
+	KB_DECLARE_COMPONENT(kbAnimBoneMask, kbGameComponent);
+
+private:
+	kbString m_bone_name;
+	float m_weight;
 };
 
+/// kbAnimPoseNode
+///
+/// Editor description of a kbAnimPoseGraph node.  Inputs are names of nodes listed earlier in the graph and the last
+/// node is the output.  Clips name one of the component's Animations.  Blends take [from, to], additives take
+/// [base, additive, optional reference], and layers take [base, layer] masked by BoneMask.  External is the pose
+/// from PlayAnimation()
+class kbAnimPoseNode : public kbGameComponent {
+	friend class SkeletalModelComponent;
+
+	KB_DECLARE_COMPONENT(kbAnimPoseNode, kbGameComponent);
+
+private:
+	kbString m_node_name;
+	EAnimPoseNodeType m_node_type;
+	kbString m_animation_name;
+	std::vector<kbAnimPoseNodeInput> m_inputs;
+	kbString m_parameter;			// Weight, or x for blend spaces
+	kbString m_parameter_y;
+	float m_weight;					// Used when there's no weight parameter
+	std::vector<kbAnimBoneMask> m_bone_mask;
+};
 
 /// SkeletalModelComponent
 class SkeletalModelComponent : public RenderComponent {
@@ -68,9 +115,15 @@ public:
 
 	bool GetBoneWorldPosition(const kbString& boneName, Vec3& outWorldPosition);
 	bool GetBoneWorldMatrix(const kbString& boneName, kbBoneMatrix_t& boneMatrix);
-	std::vector<kbBoneMatrix_t>& GetFinalBoneMatrices() { return m_BindToLocalSpaceMatrices; }
+	std::vector<kbBoneMatrix_t>& GetFinalBoneMatrices() { FinishPose(); return m_BindToLocalSpaceMatrices; }
 	const std::vector<kbBoneMatrix_t>& GetFinalBoneMatrices() const { return m_BindToLocalSpaceMatrices; }
 
+	/// Model space bounds of the current pose.  bExact skins every vertex on the CPU, otherwise they're built from per-bone bounds
+	bool GetPoseBounds(kbBounds& outBounds, const bool bExact = false);
+
+	/// CPU skinned model space positions of the current pose, for when there's no GPU to skin with
+	bool SkinVertices(std::vector<Vec3>& outPositions, kbBounds& outBounds);
+
 	void SetAnimationTimeScaleMultiplier(const kbString& animationName, const f32 factor);
 
 	// Animation
@@ -97,19 +150,52 @@ public:
 	void RegisterSyncSkelModel(SkeletalModelComponent* const pSkelModel);
 	void UnregisterSyncSkelModel(SkeletalModelComponent* const pSkelModel);
 
+	// Pose graph
+	bool HasPoseGraph() const { return m_PoseGraph.IsFinalized(); }
+	const kbAnimPoseGraph& GetPoseGraph() const { return m_PoseGraph; }
+	void SetPoseGraphParameter(const kbString& paramName, const f32 value);
+	f32 GetPoseGraphParameter(const kbString& paramName) const { return m_PoseGraph.GetParameter(m_PoseGraph.FindParameter(paramName)); }
+
+	/// Poses requested during update are evaluated here, spread across the job threads.  Call once all entities have
+	/// updated.  Reading the bone matrices before then evaluates that component's pose on the calling thread
+	static void EvaluatePendingPoses();
+
 protected:
 	virtual void enable_internal(const bool isEnabled) override;
 	virtual void update_internal(const float DeltaTime) override;
 
+	void RequestPose();
+	void FinishPose() { if (m_bPosePending) { EvaluatePose(); } }
+	void EvaluatePose();
+	void BuildPoseGraph();
+
 	std::vector<IAnimEventListener*> m_AnimEventListeners;
 
 	// Editor
 	class kbModel* m_model;
 	std::vector<kbAnimComponent> m_Animations;
+	std::vector<kbAnimPoseNode> m_PoseGraphNodes;
 
 	// Game
 	std::vector<kbBoneMatrix_t>	m_BindToLocalSpaceMatrices;
 
+	struct poseRequest_t {
+		poseRequest_t() : m_DebugAnimIdx(-1), m_DebugAnimTime(0.0f), m_AnimIdx(-1), m_AnimTime(0.0f), m_BlendAnimIdx(-1), m_BlendAnimTime(0.0f), m_BlendTime(0.0f), m_DeltaTime(0.0f) { }
+
+		i32 m_DebugAnimIdx;
+		f32 m_DebugAnimTime;
+		i32 m_AnimIdx;
+		f32 m_AnimTime;
+		i32 m_BlendAnimIdx;
+		f32 m_BlendAnimTime;
+		f32 m_BlendTime;
+		f32 m_DeltaTime;
+	};
+	poseRequest_t m_PoseRequest;
+	kbAnimPoseBuffer_t m_PoseBuffer;
+	kbAnimPoseGraph m_PoseGraph;
+	bool m_bPosePending;
+
 	i32	m_CurrentAnimation;
 	i32	m_NextAnimation;
 	f32 m_BlendStartTime;
@@ -19,6 +19,7 @@ void RenderComponent::Constructor() {
 	m_render_pass = RP_Lighting;
 	m_render_order_bias = 0.0f;
 	m_casts_shadow = false;
+	m_is_occluder = false;
 }
 
 /// RenderComponent::~RenderComponent
@@ -30,6 +31,7 @@ void RenderComponent::editor_change(const std::string& propertyName) {
 	Super::editor_change(propertyName);
 
 	m_render_object.m_casts_shadow = this->GetCastsShadow();
+	m_render_object.m_is_occluder = this->is_occluder();
 	m_render_object.m_bIsSkinnedModel = false;
 	m_render_object.m_EntityId = GetOwner()->GetEntityId();
 	m_render_object.m_Orientation = GetOwner()->GetOrientation();
@@ -258,6 +260,7 @@ void kbShaderModifierComponent::Constructor() {
 	m_pRenderComponent = nullptr;
 	m_start_time = -1.0f;
 	m_anim_length_sec = -1.0f;
+	m_event_cursor = 0;
 }
 
 /// kbShaderModifierComponent::enable_internal
@@ -280,6 +283,7 @@ void kbShaderModifierComponent::enable_internal(const bool bEnable) {
 		}
 		m_anim_length_sec = m_ShaderVectorEvents[m_ShaderVectorEvents.size() - 1].GetEventTime();
 		m_start_time = g_GlobalTimer.TimeElapsedSeconds();
+		m_event_cursor = 0;
 	}
 }
 
@@ -296,6 +300,6 @@ void kbShaderModifierComponent::update_internal(const float dt) {
 	}
 
 	const float elapsedTime = g_GlobalTimer.TimeElapsedSeconds() - m_start_time;
-	const Vec4 shaderParam = kbVectorAnimEvent::Evaluate(m_ShaderVectorEvents, elapsedTime);
+	const Vec4 shaderParam = kbVectorAnimEvent::Evaluate(m_ShaderVectorEvents, elapsedTime, m_event_cursor);
 	m_pRenderComponent->set_material_param_vec4(0, m_ShaderVectorEvents[0].GetEventName().stl_str(), shaderParam);
 }
\ No newline at end of file
@@ -50,6 +50,7 @@ protected:
 	class RenderComponent* m_pRenderComponent;
 	float m_start_time;
 	float m_anim_length_sec;
+	u32 m_event_cursor;
 };
 
 /// kbMaterialComponent
@@ -85,6 +86,7 @@ public:
 	virtual void post_load() override;
 
 	bool GetCastsShadow() const { return m_casts_shadow; }
+	bool is_occluder() const { return m_is_occluder; }
 
 	void set_material_param_vec4(const int idx, const std::string& paramName, const Vec4& paramValue);
 	void set_material_param_texture(const int idx, const std::string& paramName, kbTexture* const pTexture);
@@ -113,4 +115,5 @@ protected:
 	kbRenderObject m_render_object;
 
 	bool m_casts_shadow;
+	bool m_is_occluder;
 };
\ No newline at end of file
@@ -424,6 +424,7 @@ void Renderer_Dx12::render() {
 		RenderBuffer_Dx12* vertex_buffer = nullptr;
 		RenderBuffer_Dx12* index_buffer = nullptr;
 		const kbModel* model = nullptr;
+		u32 num_particle_instances = 0;
 
 		if (render_comp->IsA(kbStaticModelComponent::GetType())) {
 			const kbStaticModelComponent* const skel = static_cast<const kbStaticModelComponent*>(render_comp);
@@ -478,16 +479,15 @@ void Renderer_Dx12::render() {
 			RenderPipeline_Dx12* const pipe = (RenderPipeline_Dx12*)get_pipeline("test_particle_shader");
 			m_command_list->SetPipelineState(pipe->m_pipeline_state.Get());
 
-			if (model == nullptr) {
+			num_particle_instances = particle->get_num_instances();
+			if (model == nullptr || num_particle_instances == 0) {
 				// Particle buffering might not be ready yet
 				continue;
 			}
 
+			// One instance per particle.  The vertex shader builds the quad from SV_VertexID
 			const auto vertex_buf_view = ((RenderBuffer_Dx12*)model->vertex_buffer())->vertex_buffer_view();
 			m_command_list->IASetVertexBuffers(0, 1, &vertex_buf_view);
-			index_buffer = (RenderBuffer_Dx12*)(model->m_index_buffer);
-			const auto index_buf_view = index_buffer->index_buffer_view();
-			m_command_list->IASetIndexBuffer(&index_buf_view);
 		} else {
 			blk::warn("Renderer_Dx12::render() - invalid component");
 			continue;
@@ -543,7 +543,11 @@ void Renderer_Dx12::render() {
 		}
 
 		m_command_list->SetGraphicsRootDescriptorTable(2, gpu_handle);
-		m_command_list->DrawIndexedInstanced(index_buffer->num_elements(), 1, 0, 0, 0);
+		if (num_particle_instances > 0) {
+			m_command_list->DrawInstanced(6, num_particle_instances, 0, 0);
+		} else {
+			m_command_list->DrawIndexedInstanced(index_buffer->num_elements(), 1, 0, 0, 0);
+		}
 		draw_idx++;
 	}
 
@@ -618,11 +622,12 @@ RenderPipeline* Renderer_Dx12::create_pipeline(const string& friendly_name, cons
 		input_element_desc.push_back({"TANGENT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
 
 	} else {
-		input_element_desc.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
-		input_element_desc.push_back({"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
-		input_element_desc.push_back({"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
-		input_element_desc.push_back({"NORMAL", 0, DXGI_FORMAT_R32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
-		input_element_desc.push_back({"TANGENT", 0, DXGI_FORMAT_R32_FLOAT, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0});
+		// ParticleVertex is read once per instance
+		input_element_desc.push_back({"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1});
+		input_element_desc.push_back({"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1});
+		input_element_desc.push_back({"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1});
+		input_element_desc.push_back({"NORMAL", 0, DXGI_FORMAT_R32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1});
+		input_element_desc.push_back({"TANGENT", 0, DXGI_FORMAT_R32_FLOAT, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1});
 	}
 
 	auto raster = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
@@ -365,11 +365,14 @@ void kbRenderer_DX11::RenderShadow( const kbRenderLight *const pLight, Mat4 spli
 		m_pCurrentRenderWindow->HackSetProjectionMatrix( lightProjMatrix );
 		m_pCurrentRenderWindow->HackSetViewProjectionMatrix( lightViewProjMatrix * offset );
 		
-		std::vector<kbRenderSubmesh> & LightingPassVisibleList = m_pCurrentRenderWindow->GetVisibleSubMeshes( RP_Lighting );
-		for ( int i = 0; i < LightingPassVisibleList.size(); i++ ) {
-			if ( LightingPassVisibleList[i].GetRenderObject()->m_casts_shadow ) {
-				RenderMesh( &LightingPassVisibleList[i], true );
-			}
+		m_VisibleIndices.clear();
+		const kbCullStats_t cascadeStats = CullView( m_ShadowCasterCuller, lightViewProjMatrix * offset, m_VisibleIndices );
+		m_CullStats[1 + i].m_NumTested += cascadeStats.m_NumTested;
+		m_CullStats[1 + i].m_NumVisible += cascadeStats.m_NumVisible;
+		m_CullStats[1 + i].m_CullTimeMS += cascadeStats.m_CullTimeMS;
+
+		for ( int iCaster = 0; iCaster < m_VisibleIndices.size(); iCaster++ ) {
+			RenderMesh( &m_ShadowCasterSubmeshes[m_VisibleIndices[iCaster]], true );
 		}
 	}
 
@@ -19,6 +19,12 @@
 #include "blk_console.h"
 #include "kbFile.h"
 
+kbConsoleVariable g_FrustumCull("frustumcull", true, kbConsoleVariable::Console_Bool, "Toggle CPU frustum culling of render objects.", "");
+kbConsoleVariable g_ShowCullStats("showcullstats", false, kbConsoleVariable::Console_Bool, "Display per-view frustum and occlusion culling stats.", "");
+kbConsoleVariable g_OcclusionCull("occlusioncull", true, kbConsoleVariable::Console_Bool, "Toggle CPU occlusion culling against render objects flagged as occluders.", "");
+kbConsoleVariable g_MaxOccluders("maxoccluders", 16, kbConsoleVariable::Console_Int, "Max number of occluders rasterized per frame.  The nearest ones are used.", "");
+kbConsoleVariable g_SkinnedCullBounds("skinnedcullbounds", true, kbConsoleVariable::Console_Bool, "Cull skinned models with bounds built from their current bone palette instead of a padded sphere.", "");
+
 kbColorWriteEnable operator |(const kbColorWriteEnable lhs, const kbColorWriteEnable rhs) { return (kbColorWriteEnable)((int)lhs | (int)rhs); }
 D3D11_COLOR_WRITE_ENABLE& operator |= (D3D11_COLOR_WRITE_ENABLE& lhs, const D3D11_COLOR_WRITE_ENABLE rhs) { return lhs = (D3D11_COLOR_WRITE_ENABLE)(lhs | rhs); }
 
@@ -955,6 +961,9 @@ void kbRenderer_DX11::SetRenderWindow(HWND hwnd) {
 void kbRenderer_DX11::RenderScene() {
 	START_SCOPED_TIMER(RENDER_THREAD);
 
+	// Begin the frame first so culling uses this frame's camera matrices
+	m_pCurrentRenderWindow->BeginFrame();
+
 	PreRenderCullAndSort();
 
 	kbGPUTimeStamp::BeginFrame(m_pDeviceContext);
@@ -965,8 +974,6 @@ void kbRenderer_DX11::RenderScene() {
 
 	const int numRenderPasses = 1;
 
-	m_pCurrentRenderWindow->BeginFrame();
-
 	for (int i = 0; i < numRenderPasses; i++) {
 
 		{
@@ -1216,62 +1223,121 @@ void kbRenderer_DX11::RenderScene() {
 	kbGPUTimeStamp::EndFrame(m_pDeviceContext);
 }
 
+/// IsFrustumCullablePass - Screen space and editor passes are never frustum culled
+static bool IsFrustumCullablePass(const ERenderPass renderPass) {
+	return renderPass == RP_Lighting || renderPass == RP_Translucent || renderPass == RP_TranslucentWithDepth ||
+		   renderPass == RP_PostLighting || renderPass == RP_InWorldUI || renderPass == RP_Distortion;
+}
+
+/// GetRenderObjectCullBounds - Returns false if the object's model has no bounds to cull with
+static bool GetRenderObjectCullBounds(const kbRenderObject& renderObj, Vec3& outCenter, Vec3& outExtents, float& outRadius) {
+	const kbBounds& modelBounds = renderObj.m_model->GetBounds();
+	if (modelBounds.Min().x > modelBounds.Max().x) {
+		return false;
+	}
+
+	// Skinned models are bounded by their current pose when the palette is available
+	kbBounds skinnedBounds;
+	const bool bUseSkinnedBounds = renderObj.m_bIsSkinnedModel && g_SkinnedCullBounds.GetBool() && renderObj.m_model->GetSkinnedMesh().ComputeBounds(renderObj.m_MatrixList, skinnedBounds);
+	const kbBounds& localBounds = (bUseSkinnedBounds) ? (skinnedBounds) : (modelBounds);
+
+	const Vec3 localCenter = localBounds.Center();
+	const Vec3 localExtents = (localBounds.Max() - localBounds.Min()) * 0.5f;
+	const Vec3 scaledCenter(localCenter.x * renderObj.m_Scale.x, localCenter.y * renderObj.m_Scale.y, localCenter.z * renderObj.m_Scale.z);
+	const Vec3 scaledExtents(fabs(localExtents.x * renderObj.m_Scale.x), fabs(localExtents.y * renderObj.m_Scale.y), fabs(localExtents.z * renderObj.m_Scale.z));
+
+	if (renderObj.m_bIsSkinnedModel && bUseSkinnedBounds == false) {
+		// Bind pose bounds don't account for animation, so skinned meshes get a padded sphere around their origin
+		const float skinnedBoundsScale = 1.5f;
+		outRadius = (scaledCenter.length() + scaledExtents.length()) * skinnedBoundsScale;
+		outCenter = renderObj.m_position;
+		outExtents.set(outRadius, outRadius, outRadius);
+		return true;
+	}
+
+	const Mat4 rotation = renderObj.m_Orientation.to_mat4();
+	outCenter = renderObj.m_position + scaledCenter * rotation;
+	outExtents.x = fabs(rotation[0].x) * scaledExtents.x + fabs(rotation[1].x) * scaledExtents.y + fabs(rotation[2].x) * scaledExtents.z;
+	outExtents.y = fabs(rotation[0].y) * scaledExtents.x + fabs(rotation[1].y) * scaledExtents.y + fabs(rotation[2].y) * scaledExtents.z;
+	outExtents.z = fabs(rotation[0].z) * scaledExtents.x + fabs(rotation[1].z) * scaledExtents.y + fabs(rotation[2].z) * scaledExtents.z;
+	outRadius = scaledExtents.length();
+	return true;
+}
+
 /// kbRenderer_DX11::PreRenderCullAndSort
 void kbRenderer_DX11::PreRenderCullAndSort() {
+	START_SCOPED_RENDER_TIMER(RENDER_CULL);
 
 	for (int i = 0; i < NUM_RENDER_PASSES; i++) {
 		m_pCurrentRenderWindow->GetVisibleSubMeshes(i).clear();
 	}
 
-	for (auto iter = m_pCurrentRenderWindow->GetRenderObjectMap().begin(); iter != m_pCurrentRenderWindow->GetRenderObjectMap().end(); iter++) {
+	for (int i = 0; i < NUM_CULL_VIEWS; i++) {
+		m_CullStats[i] = kbCullStats_t();
+	}
 
-		bool bIsVisible = true;
+	m_MainViewCuller.Reset();
+	m_MainViewCullObjects.clear();
+	m_ShadowCasterCuller.Reset();
+	m_ShadowCasterSubmeshes.clear();
 
-		kbRenderObject& renderObj = *iter->second;
+	const Vec3 cameraPosition = m_pCurrentRenderWindow->GetCameraPosition();
+	for (auto iter = m_pCurrentRenderWindow->GetRenderObjectMap().begin(); iter != m_pCurrentRenderWindow->GetRenderObjectMap().end(); iter++) {
+
+		const kbRenderObject& renderObj = *iter->second;
 
-		const float distToCamSqr = (renderObj.m_position - m_pCurrentRenderWindow->GetCameraPosition()).length_sqr();
+		const float distToCamSqr = (renderObj.m_position - cameraPosition).length_sqr();
 		if (renderObj.m_CullDistance > 0) {
 			const float cullDistSqr = renderObj.m_CullDistance * renderObj.m_CullDistance;
 
 			if (distToCamSqr >= cullDistSqr) {
-				bIsVisible = false;
 				continue;
 			}
-
 		}
 
-		if (bIsVisible) {
+		Vec3 boundsCenter, boundsExtents;
+		float boundsRadius;
+		if (GetRenderObjectCullBounds(renderObj, boundsCenter, boundsExtents, boundsRadius) == false) {
+			boundsCenter = renderObj.m_position;
+			boundsExtents.set(FLT_MAX, FLT_MAX, FLT_MAX);
+			boundsRadius = FLT_MAX;
+		}
 
-			// Add submeshes to their proper render passes
+		// Shadow casters are gathered independently of the main view since they can be off screen and still cast into it
+		if (renderObj.m_casts_shadow && renderObj.m_render_pass == RP_Lighting) {
 			const kbModel* const pModel = renderObj.m_model;
 			for (int i = 0; i < pModel->GetMeshes().size(); i++) {
-				const kbModel::mesh_t& mesh = pModel->GetMeshes()[i];
-				const kbShader* pShader = nullptr;
-				if (renderObj.m_Materials.size() > i) {
-					pShader = renderObj.m_Materials[i].m_shader;
-				}
-
-				if (pShader == nullptr || pShader->IsBlendEnabled() == false || renderObj.m_render_pass == RP_UI) {
-					m_pCurrentRenderWindow->GetVisibleSubMeshes(renderObj.m_render_pass).push_back(kbRenderSubmesh(&renderObj, i, renderObj.m_render_pass, sqrt(distToCamSqr)));
-				} else {
-					ERenderPass rp = RP_Translucent;
-					if (pShader->IsDistortionEnabled()) {
-						rp = RP_Distortion;
-					} else if (renderObj.m_render_pass == RP_TranslucentWithDepth) {
-						rp = RP_TranslucentWithDepth;
-					}
-
-					m_pCurrentRenderWindow->GetVisibleSubMeshes(rp).push_back(kbRenderSubmesh(&renderObj, i, RP_TranslucentWithDepth, sqrt(distToCamSqr)));
+				const kbShader* const pShader = (renderObj.m_Materials.size() > i) ? (renderObj.m_Materials[i].m_shader) : (nullptr);
+				if (pShader == nullptr || pShader->IsBlendEnabled() == false) {
+					m_ShadowCasterSubmeshes.push_back(kbRenderSubmesh(&renderObj, i, RP_Lighting, 0.0f));
+					m_ShadowCasterCuller.AddBounds(boundsCenter, boundsExtents, boundsRadius);
 				}
 			}
 		}
+
+		if (IsFrustumCullablePass(renderObj.m_render_pass)) {
+			m_MainViewCuller.AddBounds(boundsCenter, boundsExtents, boundsRadius);
+			m_MainViewCullObjects.push_back(&renderObj);
+			continue;
+		}
+
+		AddVisibleSubmeshes(renderObj, sqrt(distToCamSqr));
+	}
+
+	m_VisibleIndices.clear();
+	m_CullStats[0] = CullView(m_MainViewCuller, m_pCurrentRenderWindow->GetViewProjectionMatrix(), m_VisibleIndices);
+	OcclusionCull(m_VisibleIndices);
+
+	for (int i = 0; i < m_VisibleIndices.size(); i++) {
+		const kbRenderObject& renderObj = *m_MainViewCullObjects[m_VisibleIndices[i]];
+		AddVisibleSubmeshes(renderObj, (renderObj.m_position - cameraPosition).length());
 	}
 
 	const std::map<const void*, kbRenderObject*>& curMap = m_pCurrentRenderWindow->GetRenderParticleMap();
 	for (auto iter = curMap.begin(); iter != curMap.end(); iter++) {
 
 		kbRenderObject& renderObj = *iter->second;
-		const float distToCamSqr = (renderObj.m_position - m_pCurrentRenderWindow->GetCameraPosition()).length_sqr();
+		const float distToCamSqr = (renderObj.m_position - cameraPosition).length_sqr();
 		if (renderObj.m_CullDistance > 0) {
 			const float cullDistSqr = renderObj.m_CullDistance * renderObj.m_CullDistance;
 
@@ -1305,6 +1371,106 @@ void kbRenderer_DX11::PreRenderCullAndSort() {
 	});
 }
 
+/// kbRenderer_DX11::AddVisibleSubmeshes - Adds the object's submeshes to their proper render passes
+void kbRenderer_DX11::AddVisibleSubmeshes(const kbRenderObject& renderObj, const float distToCam) {
+	const kbModel* const pModel = renderObj.m_model;
+	for (int i = 0; i < pModel->GetMeshes().size(); i++) {
+		const kbShader* pShader = nullptr;
+		if (renderObj.m_Materials.size() > i) {
+			pShader = renderObj.m_Materials[i].m_shader;
+		}
+
+		if (pShader == nullptr || pShader->IsBlendEnabled() == false || renderObj.m_render_pass == RP_UI) {
+			m_pCurrentRenderWindow->GetVisibleSubMeshes(renderObj.m_render_pass).push_back(kbRenderSubmesh(&renderObj, i, renderObj.m_render_pass, distToCam));
+		} else {
+			ERenderPass rp = RP_Translucent;
+			if (pShader->IsDistortionEnabled()) {
+				rp = RP_Distortion;
+			} else if (renderObj.m_render_pass == RP_TranslucentWithDepth) {
+				rp = RP_TranslucentWithDepth;
+			}
+
+			m_pCurrentRenderWindow->GetVisibleSubMeshes(rp).push_back(kbRenderSubmesh(&renderObj, i, RP_TranslucentWithDepth, distToCam));
+		}
+	}
+}
+
+/// kbRenderer_DX11::CullView
+kbCullStats_t kbRenderer_DX11::CullView(const kbFrustumCuller& culler, const Mat4& viewProjMatrix, std::vector<u32>& outVisibleIndices) const {
+	if (g_FrustumCull.GetBool()) {
+		return culler.Cull(viewProjMatrix, outVisibleIndices);
+	}
+
+	kbCullStats_t stats;
+	stats.m_NumTested = culler.NumBounds();
+	stats.m_NumVisible = culler.NumBounds();
+	for (u32 i = 0; i < culler.NumBounds(); i++) {
+		outVisibleIndices.push_back(i);
+	}
+	return stats;
+}
+
+/// kbRenderer_DX11::OcclusionCull - Removes main view objects hidden behind the nearest designated occluders
+void kbRenderer_DX11::OcclusionCull(std::vector<u32>& visibleIndices) {
+	m_OcclusionCuller.BeginFrame(m_pCurrentRenderWindow->GetViewProjectionMatrix());
+	if (g_OcclusionCull.GetBool() == false) {
+		return;
+	}
+
+	const Vec3 cameraPosition = m_pCurrentRenderWindow->GetCameraPosition();
+	m_OccluderCandidates.clear();
+	for (int i = 0; i < visibleIndices.size(); i++) {
+		const kbRenderObject& renderObj = *m_MainViewCullObjects[visibleIndices[i]];
+		if (renderObj.m_is_occluder && renderObj.m_bIsSkinnedModel == false) {
+			m_OccluderCandidates.push_back(std::make_pair((renderObj.m_position - cameraPosition).length_sqr(), visibleIndices[i]));
+		}
+	}
+
+	if (m_OccluderCandidates.empty()) {
+		return;
+	}
+
+	std::sort(m_OccluderCandidates.begin(), m_OccluderCandidates.end());
+	const size_t numOccluders = min(m_OccluderCandidates.size(), (size_t)max(g_MaxOccluders.GetInt(), 0));
+	for (size_t i = 0; i < numOccluders; i++) {
+		const kbRenderObject& occluder = *m_MainViewCullObjects[m_OccluderCandidates[i].second];
+
+		Mat4 worldMatrix;
+		worldMatrix.make_scale(occluder.m_Scale);
+		worldMatrix *= occluder.m_Orientation.to_mat4();
+		worldMatrix[3] = occluder.m_position;
+
+		const std::vector<kbModel::mesh_t>& meshes = occluder.m_model->GetMeshes();
+		for (int iMesh = 0; iMesh < meshes.size(); iMesh++) {
+			if (meshes[iMesh].m_Vertices.empty() == false) {
+				m_OcclusionCuller.RasterizeOccluder(&meshes[iMesh].m_Vertices[0], meshes[iMesh].m_Vertices.size(), worldMatrix);
+			}
+		}
+	}
+	m_OcclusionCuller.BuildDepthPyramid();
+
+	// Occluders that were rasterized are kept as is.  Everything else is tested against the depth pyramid
+	size_t numVisible = 0;
+	for (int i = 0; i < visibleIndices.size(); i++) {
+		const u32 cullIdx = visibleIndices[i];
+
+		bool bIsRasterizedOccluder = false;
+		for (size_t iOccluder = 0; iOccluder < numOccluders; iOccluder++) {
+			if (m_OccluderCandidates[iOccluder].second == cullIdx) {
+				bIsRasterizedOccluder = true;
+				break;
+			}
+		}
+
+		Vec3 center, extents;
+		m_MainViewCuller.GetBounds(cullIdx, center, extents);
+		if (bIsRasterizedOccluder || m_OcclusionCuller.IsVisible(center, extents)) {
+			visibleIndices[numVisible++] = cullIdx;
+		}
+	}
+	visibleIndices.resize(numVisible);
+}
+
 /// kbRenderer_DX11::RenderTranslucency
 void kbRenderer_DX11::RenderTranslucency() {
 	START_SCOPED_RENDER_TIMER(RENDER_TRANSLUCENCY);
@@ -2252,6 +2418,32 @@ void kbRenderer_DX11::RenderSync_Internal() {
 		}
 	}
 
+	// Stats are from the last rendered frame.  The render thread is idle during sync so they're safe to read
+	if (g_ShowCullStats.GetBool()) {
+		static const char* const cullViewNames[NUM_CULL_VIEWS] = { "Main", "Cascade 0", "Cascade 1", "Cascade 2", "Cascade 3" };
+
+		float curY = 0.1f;
+		g_pRenderer->DrawDebugText("Visible / Tested (ms)", 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+		curY += g_DebugLineSpacing;
+
+		for (int i = 0; i < NUM_CULL_VIEWS; i++, curY += g_DebugLineSpacing) {
+			const kbCullStats_t& stats = m_CullStats[i];
+			std::stringstream stream;
+			stream << cullViewNames[i] << ": " << stats.m_NumVisible << " / " << stats.m_NumTested << " (" << std::fixed << std::setprecision(3) << stats.m_CullTimeMS << ")";
+			g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+		}
+
+		const kbOcclusionStats_t& occlusionStats = m_OcclusionCuller.GetStats();
+		std::stringstream stream;
+		stream << "Occlusion: " << occlusionStats.m_NumRejected << " rejected / " << occlusionStats.m_NumTested << ", " << occlusionStats.m_NumOccluders << " occluders, " << occlusionStats.m_NumOccluderTriangles << " tris";
+		g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+		curY += g_DebugLineSpacing;
+
+		stream.str("");
+		stream << std::fixed << std::setprecision(3) << "Occlusion ms: raster " << occlusionStats.m_RasterTimeMS << ", test " << occlusionStats.m_TestTimeMS;
+		g_pRenderer->DrawDebugText(stream.str(), 0.05f, curY, g_DebugTextSize, g_DebugTextSize, kbColor::green);
+	}
+
 	// Global shader params
 	for (int iGameData = 0; iGameData < m_GlobalShaderParams_GameThread.size(); iGameData++) {
 		kbShaderParamOverrides_t::kbShaderParam_t& gameData = m_GlobalShaderParams_GameThread[iGameData];
@@ -2299,6 +2491,9 @@ kbString g_BuiltInShaderParams[] = {
 	kbString("time"),
 };
 
+static const UINT g_ShaderCompileFlags = D3DCOMPILE_PACK_MATRIX_ROW_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ALL_RESOURCES_BOUND | D3DCOMPILE_WARNINGS_ARE_ERRORS;
+
+/// kbRenderer_DX11::ReadShaderFile
 void kbRenderer_DX11::ReadShaderFile(std::string& shaderText, kbShaderVarBindings_t* const pShaderBindings) {
 
 	std::string::size_type n = shaderText.find("cbuffer");
@@ -2348,12 +2543,6 @@ void kbRenderer_DX11::ReadShaderFile(std::string& shaderText, kbShaderVarBinding
 	const int sizeofSTDString = sizeof(kbString);
 	const int numBuiltInParams = sizeofBuiltInParams / sizeofSTDString;
 
-	// Param defaults
-	kbTexture* const pWhiteTex = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/white.bmp", true, true);
-	kbTexture* const pBlackTex = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/black_alpha.tif", true, true);
-	kbTexture* const pDefaultNormal = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/defaultNormal.bmp", true, true);
-	kbTexture* const pNoiseTex = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/noise.jpg", true, true);
-
 	size_t currOffset = 0;
 	for (size_t i = 0; i < constantBufferStrings.size(); i += 2) {
 		currOffset = (currOffset + 15) & 0xfffffff0;
@@ -2429,8 +2618,6 @@ void kbRenderer_DX11::ReadShaderFile(std::string& shaderText, kbShaderVarBinding
 		}
 
 		kbShaderVarBindings_t::textureBinding_t textureBinding;
-		textureBinding.m_pDefaultTexture = nullptr;
-		textureBinding.m_pDefaultRenderTexture = nullptr;
 		textureBinding.m_TextureName = shaderText.substr(startPos, endPos - startPos);
 
 		// Check for default values
@@ -2449,43 +2636,7 @@ void kbRenderer_DX11::ReadShaderFile(std::string& shaderText, kbShaderVarBinding
 				shaderText[defaultValStart++] = ' ';
 			}
 
-			textureBinding.m_bIsUserDefinedVar = true;
-
-			if (defaultTexture == "white") {
-				textureBinding.m_pDefaultTexture = pWhiteTex;
-			} else if (defaultTexture == "black") {
-				textureBinding.m_pDefaultTexture = pBlackTex;
-			} else if (defaultTexture == "defaultnormal") {
-				textureBinding.m_pDefaultTexture = pDefaultNormal;
-			} else if (defaultTexture == "colorbuffer") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[COLOR_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "normalbuffer") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[NORMAL_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "depthbuffer") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[DEPTH_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "specularbuffer") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[SPECULAR_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "shadowbuffer") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[SHADOW_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "maxhalf") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[MAX_HALF_BUFFER];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "noise") {
-				textureBinding.m_pDefaultTexture = pNoiseTex;
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else if (defaultTexture == "scenecolor") {
-				textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[ACCUMULATION_BUFFER_1];
-				textureBinding.m_bIsUserDefinedVar = false;
-			} else {
-				blk::warn("Default texture %s not found", defaultTexture.c_str());
-			}
-		} else {
-			textureBinding.m_bIsUserDefinedVar = true;
+			textureBinding.m_DefaultTextureName = defaultTexture;
 		}
 
 		pShaderBindings->m_Textures.push_back(textureBinding);
@@ -2494,6 +2645,56 @@ void kbRenderer_DX11::ReadShaderFile(std::string& shaderText, kbShaderVarBinding
 	}
 }
 
+/// kbRenderer_DX11::ResolveDefaultTextures - Default textures are stored by name so bindings read from the shader cache
+/// can be pointed at this run's resources
+void kbRenderer_DX11::ResolveDefaultTextures(kbShaderVarBindings_t* const pShaderBindings) {
+	for (size_t i = 0; i < pShaderBindings->m_Textures.size(); i++) {
+		kbShaderVarBindings_t::textureBinding_t& textureBinding = pShaderBindings->m_Textures[i];
+		textureBinding.m_pDefaultTexture = nullptr;
+		textureBinding.m_pDefaultRenderTexture = nullptr;
+		textureBinding.m_bIsUserDefinedVar = true;
+
+		const std::string& defaultTexture = textureBinding.m_DefaultTextureName;
+		if (defaultTexture.empty()) {
+			continue;
+		}
+
+		if (defaultTexture == "white") {
+			textureBinding.m_pDefaultTexture = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/white.bmp", true, true);
+		} else if (defaultTexture == "black") {
+			textureBinding.m_pDefaultTexture = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/black_alpha.tif", true, true);
+		} else if (defaultTexture == "defaultnormal") {
+			textureBinding.m_pDefaultTexture = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/defaultNormal.bmp", true, true);
+		} else if (defaultTexture == "colorbuffer") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[COLOR_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "normalbuffer") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[NORMAL_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "depthbuffer") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[DEPTH_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "specularbuffer") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[SPECULAR_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "shadowbuffer") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[SHADOW_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "maxhalf") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[MAX_HALF_BUFFER];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "noise") {
+			textureBinding.m_pDefaultTexture = (kbTexture*)g_ResourceManager.GetResource("../../kbEngine/assets/Textures/noise.jpg", true, true);
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else if (defaultTexture == "scenecolor") {
+			textureBinding.m_pDefaultRenderTexture = m_pRenderTargets[ACCUMULATION_BUFFER_1];
+			textureBinding.m_bIsUserDefinedVar = false;
+		} else {
+			blk::warn("Default texture %s not found", defaultTexture.c_str());
+		}
+	}
+}
+
 /// kbRenderer_DX11::LoadShader
 void kbRenderer_DX11::LoadShader(const std::string& fileName, ID3D11VertexShader*& vertexShader, ID3D11GeometryShader*& geometryShader, ID3D11PixelShader*& pixelShader,
 								  ID3D11InputLayout*& vertexLayout, const std::string& vertexShaderFunc, const std::string& pixelShaderFunc,
@@ -2510,31 +2711,67 @@ void kbRenderer_DX11::LoadShader(const std::string& fileName, ID3D11VertexShader
 	CreateShaderFromText(fileName, shaderText, vertexShader, geometryShader, pixelShader, vertexLayout, vertexShaderFunc, pixelShaderFunc, pShaderBindings);
 }
 /// kbRenderer_DX11::CreateShaderFromText
-
-void kbRenderer_DX11::CreateShaderFromText(const std::string& fileName, const std::string& inShaderText, ID3D11VertexShader*& vertexShader, ID3D11GeometryShader*& geometryShader,
+void kbRenderer_DX11::CreateShaderFromText(const std::string& fileName, const std::string& shaderText, ID3D11VertexShader*& vertexShader, ID3D11GeometryShader*& geometryShader,
 											ID3D11PixelShader*& pixelShader, ID3D11InputLayout*& vertexLayout, const std::string& vertexShaderFunc,
 											const std::string& pixelShaderFunc, struct kbShaderVarBindings_t* pShaderBindings) {
 
-	std::string shaderText = inShaderText;
+	kbShaderBlobs_t shaderBlobs;
+	if (CompileShader(fileName, shaderText, vertexShaderFunc, pixelShaderFunc, pShaderBindings, shaderBlobs)) {
+		CreateShaderFromBlobs(fileName, shaderBlobs, vertexShader, geometryShader, pixelShader, vertexLayout, vertexShaderFunc, pShaderBindings);
+	}
+}
 
-	HRESULT hr;
-	struct shaderBlobs_t {
-		~shaderBlobs_t() {
-			SAFE_RELEASE(errorMessage)
-				SAFE_RELEASE(vertexShaderBuffer)
-				SAFE_RELEASE(pixelShaderBuffer)
-				SAFE_RELEASE(geometryShaderBuffer)
-		}
+/// CompileShaderStage
+static bool CompileShaderStage(const std::string& fileName, const std::string& shaderText, const std::string& entryPoint, const char* const pTarget, std::vector<byte>& outBlob) {
+	ID3D10Blob* pShaderBlob = nullptr;
+	ID3D10Blob* pErrorMessage = nullptr;
+
+	const HRESULT hr = D3DCompile(shaderText.c_str(), shaderText.length(), nullptr, nullptr, nullptr, entryPoint.c_str(), pTarget, g_ShaderCompileFlags, 0, &pShaderBlob, &pErrorMessage);
+	if (SUCCEEDED(hr)) {
+		const byte* const pBytes = (const byte*)pShaderBlob->GetBufferPointer();
+		outBlob.assign(pBytes, pBytes + pShaderBlob->GetBufferSize());
+	} else {
+		blk::warn("kbRenderer_DX11::CompileShader() - Failed to compile %s %s : %s\n%s", pTarget, entryPoint.c_str(), fileName.c_str(), (pErrorMessage != nullptr) ? ((const char*)pErrorMessage->GetBufferPointer()) : ("No error message given"));
+	}
 
-		ID3D10Blob* errorMessage = nullptr;
-		ID3D10Blob* vertexShaderBuffer = nullptr;
-		ID3D10Blob* pixelShaderBuffer = nullptr;
-		ID3D10Blob* geometryShaderBuffer = nullptr;
-	} localBlobs;
+	SAFE_RELEASE(pShaderBlob);
+	SAFE_RELEASE(pErrorMessage);
+	return SUCCEEDED(hr);
+}
 
+/// kbRenderer_DX11::CompileShader
+bool kbRenderer_DX11::CompileShader(const std::string& fileName, const std::string& inShaderText, const std::string& vertexShaderFunc, const std::string& pixelShaderFunc,
+									 kbShaderVarBindings_t* const pShaderBindings, kbShaderBlobs_t& outBlobs) {
 
+	std::string shaderText = inShaderText;
 	ReadShaderFile(shaderText, pShaderBindings);
 
+	// The text is already in memory, so a failed compile is an error in the shader and retrying it won't help
+	if (CompileShaderStage(fileName, shaderText, vertexShaderFunc, "vs_5_0", outBlobs.m_VertexShader) == false) {
+		return false;
+	}
+
+	if (shaderText.find("void geometryShader") != std::string::npos) {
+		CompileShaderStage(fileName, shaderText, "geometryShader", "gs_5_0", outBlobs.m_GeometryShader);
+	}
+
+	return CompileShaderStage(fileName, shaderText, pixelShaderFunc, "ps_5_0", outBlobs.m_PixelShader);
+}
+
+/// kbRenderer_DX11::GetShaderCompileOptions
+std::string kbRenderer_DX11::GetShaderCompileOptions() const {
+	char options[128];
+	sprintf_s(options, "vs_5_0 gs_5_0 ps_5_0 flags %08x compiler %d", g_ShaderCompileFlags, D3D_COMPILER_VERSION);
+	return options;
+}
+
+/// kbRenderer_DX11::CreateShaderFromBlobs
+void kbRenderer_DX11::CreateShaderFromBlobs(const std::string& fileName, const kbShaderBlobs_t& shaderBlobs, ID3D11VertexShader*& vertexShader, ID3D11GeometryShader*& geometryShader,
+											 ID3D11PixelShader*& pixelShader, ID3D11InputLayout*& vertexLayout, const std::string& vertexShaderFunc, kbShaderVarBindings_t* const pShaderBindings) {
+
+	ResolveDefaultTextures(pShaderBindings);
+
+	HRESULT hr;
 	if (pShaderBindings->m_ConstantBufferSizeBytes > 0) {
 		const UINT desiredByteWidth = (pShaderBindings->m_ConstantBufferSizeBytes + 15) & 0xfffffff0;
 		if (m_ConstantBuffers.find(desiredByteWidth) == m_ConstantBuffers.end()) {
@@ -2554,88 +2791,32 @@ void kbRenderer_DX11::CreateShaderFromText(const std::string& fileName, const st
 			m_ConstantBuffers.insert(std::pair<size_t, ID3D11Buffer*>(desiredByteWidth, pConstantBuffer));
 		}
 	}
-	//	}
-
-		// Compile vertex shader
-	const UINT shaderFlags = D3DCOMPILE_PACK_MATRIX_ROW_MAJOR | D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_ALL_RESOURCES_BOUND | D3DCOMPILE_WARNINGS_ARE_ERRORS;
-
-	int numTries = 0;
-	do {
-		numTries++;
-
-		SAFE_RELEASE(localBlobs.errorMessage);
-		hr = D3DCompile(shaderText.c_str(), shaderText.length(), nullptr, nullptr, nullptr, vertexShaderFunc.c_str(), "vs_5_0", shaderFlags, 0, &localBlobs.vertexShaderBuffer, &localBlobs.errorMessage);
-		if (FAILED(hr)) {
-			Sleep(250);
-			SAFE_RELEASE(localBlobs.vertexShaderBuffer);
 
-		}
-	} while (FAILED(hr) && numTries < 4);
-
-	if (FAILED(hr)) {
-		blk::warn("kbRenderer_DX11::LoadShader() - Failed to load vertex shader : %s\n%s", fileName.c_str(), (localBlobs.errorMessage != nullptr) ? (localBlobs.errorMessage->GetBufferPointer()) : ("No error message given"));
+	if (shaderBlobs.m_VertexShader.empty() || shaderBlobs.m_PixelShader.empty()) {
+		blk::warn("kbRenderer_DX11::CreateShaderFromBlobs() - %s is missing its vertex or pixel shader", fileName.c_str());
 		return;
 	}
-	SAFE_RELEASE(localBlobs.errorMessage);
-
-	// Geometry Shader
-	if (shaderText.find("void geometryShader") != std::string::npos) {
-		numTries = 0;
-		do {
-			numTries++;
-
-			SAFE_RELEASE(localBlobs.errorMessage);
-			hr = D3DCompile(shaderText.c_str(), shaderText.length(), nullptr, nullptr, nullptr, "geometryShader", "gs_5_0", shaderFlags, 0, &localBlobs.geometryShaderBuffer, &localBlobs.errorMessage);
-			if (FAILED(hr)) {
-				Sleep(250);
-				SAFE_RELEASE(localBlobs.geometryShaderBuffer);
-
-			}
-		} while (FAILED(hr) && numTries < 4);
-
-		if (SUCCEEDED(hr)) {
-			hr = m_pD3DDevice->CreateGeometryShader(localBlobs.geometryShaderBuffer->GetBufferPointer(), localBlobs.geometryShaderBuffer->GetBufferSize(), nullptr, &geometryShader);
-			if (FAILED(hr)) {
-				blk::warn("kbRenderer_DX11::LoadShader() - Failed to create geometry shader %s", fileName.c_str());
-				SAFE_RELEASE(vertexShader);
-				return;
-			}
-		} else {
-			blk::warn("kbRenderer_DX11::LoadShader() - Failed to load geometry shader : %s\n%s", fileName.c_str(), (localBlobs.errorMessage != nullptr) ? (localBlobs.errorMessage->GetBufferPointer()) : ("No error message given"));
-		}
-	}
-	SAFE_RELEASE(localBlobs.errorMessage);
 
-	// Compile pixel shader
-	numTries = 0;
-	do {
-		numTries++;
-
-		SAFE_RELEASE(localBlobs.errorMessage)
-			hr = D3DCompile(shaderText.c_str(), shaderText.length(), nullptr, nullptr, nullptr, pixelShaderFunc.c_str(), "ps_5_0", shaderFlags, 0, &localBlobs.pixelShaderBuffer, &localBlobs.errorMessage);
+	if (shaderBlobs.m_GeometryShader.empty() == false) {
+		hr = m_pD3DDevice->CreateGeometryShader(shaderBlobs.m_GeometryShader.data(), shaderBlobs.m_GeometryShader.size(), nullptr, &geometryShader);
 		if (FAILED(hr)) {
-			Sleep(250);
-			SAFE_RELEASE(localBlobs.pixelShaderBuffer);
+			blk::warn("kbRenderer_DX11::LoadShader() - Failed to create geometry shader %s", fileName.c_str());
+			return;
 		}
-	} while (FAILED(hr) && numTries < 4);
-
-	if (FAILED(hr)) {
-		blk::warn("kbRenderer_DX11::LoadShader() - Failed to load pixel shader : %s\n%s", fileName.c_str(), (localBlobs.errorMessage != nullptr) ? localBlobs.errorMessage->GetBufferPointer() : ("No error message given "));
-		return;
 	}
 
-	SAFE_RELEASE(localBlobs.errorMessage);
-
-	hr = m_pD3DDevice->CreateVertexShader(localBlobs.vertexShaderBuffer->GetBufferPointer(), localBlobs.vertexShaderBuffer->GetBufferSize(), nullptr, &vertexShader);
+	hr = m_pD3DDevice->CreateVertexShader(shaderBlobs.m_VertexShader.data(), shaderBlobs.m_VertexShader.size(), nullptr, &vertexShader);
 	if (FAILED(hr)) {
 		blk::warn("kbRenderer_DX11::LoadShader() - Failed to create vertex shader %s", fileName.c_str());
+		SAFE_RELEASE(geometryShader);
 		return;
 	}
 
-	hr = m_pD3DDevice->CreatePixelShader(localBlobs.pixelShaderBuffer->GetBufferPointer(), localBlobs.pixelShaderBuffer->GetBufferSize(), nullptr, &pixelShader);
+	hr = m_pD3DDevice->CreatePixelShader(shaderBlobs.m_PixelShader.data(), shaderBlobs.m_PixelShader.size(), nullptr, &pixelShader);
 	if (FAILED(hr)) {
 		blk::warn("kbRenderer_DX11::LoadShader() - Failed to create pixel shader %s", fileName.c_str());
 		SAFE_RELEASE(vertexShader);
+		SAFE_RELEASE(geometryShader);
 		return;
 	}
 
@@ -2804,7 +2985,7 @@ void kbRenderer_DX11::CreateShaderFromText(const std::string& fileName, const st
 		polygonLayout[4].InstanceDataStepRate = 0;
 	}
 
-	hr = m_pD3DDevice->CreateInputLayout(&polygonLayout[0], (UINT)polygonLayout.size(), localBlobs.vertexShaderBuffer->GetBufferPointer(), localBlobs.vertexShaderBuffer->GetBufferSize(), &vertexLayout);
+	hr = m_pD3DDevice->CreateInputLayout(&polygonLayout[0], (UINT)polygonLayout.size(), shaderBlobs.m_VertexShader.data(), shaderBlobs.m_VertexShader.size(), &vertexLayout);
 	if (FAILED(hr)) {
 		blk::warn("kbRenderer_DX11::LoadShader() - Failed to create input layout for %s", fileName.c_str());
 
@@ -17,6 +17,8 @@
 #include "kbRenderer_defs.h"
 #include "kbMaterial.h"
 #include "kbJobManager.h"
+#include "kbFrustumCuller.h"
+#include "kbOcclusionCuller.h"
 
 using namespace DirectX;
 
@@ -368,6 +370,16 @@ public:
 															ID3D11PixelShader *& pixelShader, ID3D11InputLayout *& vertexLayout, const std::string & vertexShaderFunc, 
 															const std::string & pixelShaderFunc, struct kbShaderVarBindings_t * pShaderBindings = nullptr );
 
+	// Compiling and creating are split so kbShader can cache the compiled blobs
+	bool										CompileShader( const std::string & fileName, const std::string & shaderText, const std::string & vertexShaderFunc, const std::string & pixelShaderFunc,
+															   kbShaderVarBindings_t *const pShaderBindings, kbShaderBlobs_t & outBlobs );
+	void										CreateShaderFromBlobs( const std::string & fileName, const kbShaderBlobs_t & shaderBlobs, ID3D11VertexShader *& vertexShader, ID3D11GeometryShader *& geometryShader,
+																	   ID3D11PixelShader *& pixelShader, ID3D11InputLayout *& vertexLayout, const std::string & vertexShaderFunc,
+																	   kbShaderVarBindings_t *const pShaderBindings );
+
+	/// Everything besides the shader text that changes the compiled blobs
+	std::string									GetShaderCompileOptions() const;
+
 	virtual Vec2i								GetEntityIdAtScreenPosition( const uint x, const uint y ) override;
 
 	virtual void								SetGlobalShaderParam( const kbShaderParamOverrides_t::kbShaderParam_t & shaderParam ) override;
@@ -396,12 +408,16 @@ private:
 	virtual void								Shutdown_Internal() override;
 
 	void										ReadShaderFile( std::string & shaderText, kbShaderVarBindings_t *const pShaderBindings );
+	void										ResolveDefaultTextures( kbShaderVarBindings_t *const pShaderBindings );
 
 	void										SetRenderTarget( eReservedRenderTargets type );
 
 	virtual void								RenderScene() override;
 
 	void										PreRenderCullAndSort();
+	void										AddVisibleSubmeshes( const kbRenderObject & renderObj, const float distToCam );
+	kbCullStats_t								CullView( const kbFrustumCuller & culler, const Mat4 & viewProjMatrix, std::vector<u32> & outVisibleIndices ) const;
+	void										OcclusionCull( std::vector<u32> & visibleIndices );
 
 	void										RenderMesh( const kbRenderSubmesh *const pRenderMesh, const bool bShadowPass = false, const bool bSkipMeshBlendSettings = false );
 
@@ -503,6 +519,17 @@ private:
 	ID3D11Buffer *								m_DebugVertexBuffer;
 	ID3D11Buffer *								m_DebugPreTransformedVertexBuffer;
 
+	// Visibility.  Cull view 0 is the main camera and views 1-4 are the shadow cascades
+	const static int NUM_CULL_VIEWS = 5;
+	kbFrustumCuller								m_MainViewCuller;
+	std::vector<const kbRenderObject *>			m_MainViewCullObjects;
+	kbFrustumCuller								m_ShadowCasterCuller;
+	std::vector<kbRenderSubmesh>				m_ShadowCasterSubmeshes;
+	std::vector<u32>							m_VisibleIndices;
+	kbCullStats_t								m_CullStats[NUM_CULL_VIEWS];
+	kbOcclusionCuller							m_OcclusionCuller;
+	std::vector<std::pair<float, u32>>			m_OccluderCandidates;
+
 	kbModel	*									m_DebugText;
 	int											m_FrameNum;
 };
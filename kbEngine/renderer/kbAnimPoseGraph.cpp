@@ -0,0 +1,502 @@
+/// kbAnimPoseGraph.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "kbAnimPoseGraph.h"
+
+/// SetBindPose
+static void SetBindPose(std::vector<AnimatedBone_t>& pose, const u32 numBones) {
+	pose.resize(numBones);
+	for (u32 i = 0; i < numBones; i++) {
+		pose[i].m_bone_space_rotation = Quat4::identity;
+		pose[i].m_bone_space_position = Vec3::zero;
+	}
+}
+
+/// kbAnimPoseGraph::Reset
+void kbAnimPoseGraph::Reset() {
+	m_Nodes.clear();
+	m_Parameters.clear();
+	m_PoseSlots.clear();
+	m_Stats = kbAnimPoseGraphStats_t();
+	m_NumBones = 0;
+	m_EvalStamp = 0;
+	m_bIsFinalized = false;
+	m_bUsesExternalPose = false;
+}
+
+/// kbAnimPoseGraph::AddParameter
+i32 kbAnimPoseGraph::AddParameter(const kbString& name, const f32 defaultValue) {
+	const i32 existingIdx = FindParameter(name);
+	if (existingIdx >= 0) {
+		return existingIdx;
+	}
+
+	parameter_t newParam;
+	newParam.m_Name = name;
+	newParam.m_Value = defaultValue;
+	m_Parameters.push_back(newParam);
+	return (i32)m_Parameters.size() - 1;
+}
+
+/// kbAnimPoseGraph::FindParameter
+i32 kbAnimPoseGraph::FindParameter(const kbString& name) const {
+	for (i32 i = 0; i < (i32)m_Parameters.size(); i++) {
+		if (m_Parameters[i].m_Name == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/// kbAnimPoseGraph::AddNode
+i32 kbAnimPoseGraph::AddNode(const node_t& node) {
+	m_bIsFinalized = false;
+	m_Nodes.push_back(node);
+	return (i32)m_Nodes.size() - 1;
+}
+
+/// kbAnimPoseGraph::AddClipNode
+i32 kbAnimPoseGraph::AddClipNode(const kbAnimation* const pAnimation, const bool bLoop, const f32 timeScale) {
+	if (pAnimation == nullptr) {
+		blk::warn("kbAnimPoseGraph::AddClipNode() - Null animation");
+		return -1;
+	}
+
+	node_t newNode;
+	newNode.m_Type = PoseNode_Clip;
+	newNode.m_pAnimation = pAnimation;
+	newNode.m_bLoop = bLoop;
+	newNode.m_TimeScale = timeScale;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::AddBlendNode
+i32 kbAnimPoseGraph::AddBlendNode(const i32 fromNode, const i32 toNode, const i32 weightParam, const f32 weight) {
+	if (IsValidInput(fromNode) == false || IsValidInput(toNode) == false) {
+		blk::warn("kbAnimPoseGraph::AddBlendNode() - Invalid input");
+		return -1;
+	}
+
+	node_t newNode;
+	newNode.m_Type = PoseNode_Blend;
+	newNode.m_Inputs.push_back(fromNode);
+	newNode.m_Inputs.push_back(toNode);
+	newNode.m_WeightParam = (weightParam < (i32)m_Parameters.size()) ? (weightParam) : (-1);
+	newNode.m_Weight = weight;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::AddAdditiveNode
+i32 kbAnimPoseGraph::AddAdditiveNode(const i32 baseNode, const i32 additiveNode, const i32 referenceNode, const i32 weightParam, const f32 weight) {
+	if (IsValidInput(baseNode) == false || IsValidInput(additiveNode) == false || (referenceNode != -1 && IsValidInput(referenceNode) == false)) {
+		blk::warn("kbAnimPoseGraph::AddAdditiveNode() - Invalid input");
+		return -1;
+	}
+
+	node_t newNode;
+	newNode.m_Type = PoseNode_Additive;
+	newNode.m_Inputs.push_back(baseNode);
+	newNode.m_Inputs.push_back(additiveNode);
+	newNode.m_Inputs.push_back(referenceNode);
+	newNode.m_WeightParam = (weightParam < (i32)m_Parameters.size()) ? (weightParam) : (-1);
+	newNode.m_Weight = weight;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::AddLayerNode
+i32 kbAnimPoseGraph::AddLayerNode(const i32 baseNode, const i32 layerNode, const std::vector<f32>& boneWeights, const i32 weightParam, const f32 weight) {
+	if (IsValidInput(baseNode) == false || IsValidInput(layerNode) == false) {
+		blk::warn("kbAnimPoseGraph::AddLayerNode() - Invalid input");
+		return -1;
+	}
+
+	node_t newNode;
+	newNode.m_Type = PoseNode_Layer;
+	newNode.m_Inputs.push_back(baseNode);
+	newNode.m_Inputs.push_back(layerNode);
+	newNode.m_BoneWeights = boneWeights;
+	newNode.m_WeightParam = (weightParam < (i32)m_Parameters.size()) ? (weightParam) : (-1);
+	newNode.m_Weight = weight;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::AddBlendSpaceNode
+i32 kbAnimPoseGraph::AddBlendSpaceNode(const std::vector<i32>& inputNodes, const std::vector<Vec2>& samplePositions, const i32 xParam, const i32 yParam) {
+	if (inputNodes.size() == 0 || inputNodes.size() != samplePositions.size()) {
+		blk::warn("kbAnimPoseGraph::AddBlendSpaceNode() - Need one sample position per input");
+		return -1;
+	}
+
+	if (xParam < 0 || xParam >= (i32)m_Parameters.size() || yParam >= (i32)m_Parameters.size()) {
+		blk::warn("kbAnimPoseGraph::AddBlendSpaceNode() - Invalid parameter");
+		return -1;
+	}
+
+	for (size_t i = 0; i < inputNodes.size(); i++) {
+		if (IsValidInput(inputNodes[i]) == false) {
+			blk::warn("kbAnimPoseGraph::AddBlendSpaceNode() - Invalid input");
+			return -1;
+		}
+	}
+
+	const i32 newNodeIdx = (i32)m_Nodes.size();
+	for (size_t i = 0; i < inputNodes.size(); i++) {
+		node_t& inputNode = m_Nodes[inputNodes[i]];
+		if (inputNode.m_Type == PoseNode_Clip && inputNode.m_SyncNode == -1) {
+			inputNode.m_SyncNode = newNodeIdx;
+		}
+	}
+
+	node_t newNode;
+	newNode.m_Type = (yParam >= 0) ? (PoseNode_BlendSpace2D) : (PoseNode_BlendSpace1D);
+	newNode.m_Inputs = inputNodes;
+	newNode.m_SamplePositions = samplePositions;
+	newNode.m_InputWeights.resize(inputNodes.size(), 0.0f);
+	newNode.m_WeightParam = xParam;
+	newNode.m_YParam = yParam;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::AddExternalNode
+i32 kbAnimPoseGraph::AddExternalNode() {
+	node_t newNode;
+	newNode.m_Type = PoseNode_External;
+	m_bUsesExternalPose = true;
+	return AddNode(newNode);
+}
+
+/// kbAnimPoseGraph::Finalize
+bool kbAnimPoseGraph::Finalize(const kbModel& model) {
+	m_bIsFinalized = false;
+	m_NumBones = (u32)model.NumBones();
+	if (m_NumBones == 0 || m_Nodes.size() == 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < m_Nodes.size(); i++) {
+		const node_t& node = m_Nodes[i];
+		if (node.m_BoneWeights.size() > 0 && node.m_BoneWeights.size() != m_NumBones) {
+			blk::warn("kbAnimPoseGraph::Finalize() - Node %d has a bone mask for %d bones but the model has %d", (int)i, (int)node.m_BoneWeights.size(), m_NumBones);
+			return false;
+		}
+	}
+
+	m_PoseSlots.resize(m_Nodes.size());
+	for (size_t i = 0; i < m_PoseSlots.size(); i++) {
+		SetBindPose(m_PoseSlots[i], m_NumBones);
+	}
+
+	m_bIsFinalized = true;
+	return true;
+}
+
+/// kbAnimPoseGraph::ComputeBlendSpaceWeights
+void kbAnimPoseGraph::ComputeBlendSpaceWeights(node_t& node) const {
+	const size_t numInputs = node.m_Inputs.size();
+	const Vec2 samplePos(m_Parameters[node.m_WeightParam].m_Value, (node.m_YParam >= 0) ? (m_Parameters[node.m_YParam].m_Value) : (0.0f));
+	std::fill(node.m_InputWeights.begin(), node.m_InputWeights.end(), 0.0f);
+
+	if (node.m_Type == PoseNode_BlendSpace1D) {
+
+		// Blend between the closest samples on either side, clamping past the ends
+		i32 lowIdx = -1, highIdx = -1;
+		for (size_t i = 0; i < numInputs; i++) {
+			const f32 x = node.m_SamplePositions[i].x;
+			if (x <= samplePos.x && (lowIdx == -1 || x > node.m_SamplePositions[lowIdx].x)) {
+				lowIdx = (i32)i;
+			}
+			if (x >= samplePos.x && (highIdx == -1 || x < node.m_SamplePositions[highIdx].x)) {
+				highIdx = (i32)i;
+			}
+		}
+
+		if (lowIdx == -1 || highIdx == -1 || lowIdx == highIdx) {
+			node.m_InputWeights[(lowIdx != -1) ? (lowIdx) : ((highIdx != -1) ? (highIdx) : (0))] = 1.0f;
+			return;
+		}
+
+		const f32 lowX = node.m_SamplePositions[lowIdx].x;
+		const f32 highX = node.m_SamplePositions[highIdx].x;
+		const f32 t = (highX - lowX > kbEpsilon) ? ((samplePos.x - lowX) / (highX - lowX)) : (0.0f);
+		node.m_InputWeights[lowIdx] = 1.0f - t;
+		node.m_InputWeights[highIdx] += t;
+		return;
+	}
+
+	// Gradient band interpolation.  Each sample's weight falls off linearly toward every other sample, which handles
+	// arbitrary layouts without building a triangulation
+	f32 totalWeight = 0.0f;
+	i32 closestIdx = 0;
+	f32 closestDistSqr = FLT_MAX;
+	for (size_t i = 0; i < numInputs; i++) {
+		const Vec2& samplePos_i = node.m_SamplePositions[i];
+		const Vec2 toPos = samplePos - samplePos_i;
+		const f32 distSqr = toPos.x * toPos.x + toPos.y * toPos.y;
+		if (distSqr < closestDistSqr) {
+			closestDistSqr = distSqr;
+			closestIdx = (i32)i;
+		}
+
+		f32 weight = 1.0f;
+		for (size_t j = 0; j < numInputs && weight > 0.0f; j++) {
+			if (i == j) {
+				continue;
+			}
+
+			const Vec2 toSample = node.m_SamplePositions[j] - samplePos_i;
+			const f32 sampleDistSqr = toSample.x * toSample.x + toSample.y * toSample.y;
+			if (sampleDistSqr < kbEpsilon) {
+				continue;
+			}
+
+			weight = min(weight, 1.0f - (toPos.x * toSample.x + toPos.y * toSample.y) / sampleDistSqr);
+		}
+
+		node.m_InputWeights[i] = max(weight, 0.0f);
+		totalWeight += node.m_InputWeights[i];
+	}
+
+	if (totalWeight < kbEpsilon) {
+		std::fill(node.m_InputWeights.begin(), node.m_InputWeights.end(), 0.0f);
+		node.m_InputWeights[closestIdx] = 1.0f;
+		return;
+	}
+
+	for (size_t i = 0; i < numInputs; i++) {
+		node.m_InputWeights[i] /= totalWeight;
+	}
+}
+
+/// kbAnimPoseGraph::AdvanceTime
+void kbAnimPoseGraph::AdvanceTime(const f32 deltaTime) {
+	for (i32 nodeIdx = 0; nodeIdx < (i32)m_Nodes.size(); nodeIdx++) {
+		node_t& node = m_Nodes[nodeIdx];
+
+		if (node.m_Type == PoseNode_Clip && node.m_SyncNode == -1) {
+			const f32 animLength = node.m_pAnimation->GetLengthInSeconds();
+			node.m_Time += deltaTime * node.m_TimeScale;
+			if (node.m_bLoop && animLength > 0.0f) {
+				node.m_Time = fmod(node.m_Time, animLength);
+			} else {
+				node.m_Time = min(node.m_Time, animLength);
+			}
+		} else if (node.m_Type == PoseNode_BlendSpace1D || node.m_Type == PoseNode_BlendSpace2D) {
+			ComputeBlendSpaceWeights(node);
+
+			// The phase moves at the weighted average rate of the clips it drives
+			f32 cycleLength = 0.0f;
+			for (size_t i = 0; i < node.m_Inputs.size(); i++) {
+				const node_t& inputNode = m_Nodes[node.m_Inputs[i]];
+				if (inputNode.m_SyncNode == nodeIdx && inputNode.m_TimeScale > kbEpsilon) {
+					cycleLength += node.m_InputWeights[i] * inputNode.m_pAnimation->GetLengthInSeconds() / inputNode.m_TimeScale;
+				}
+			}
+
+			if (cycleLength > kbEpsilon) {
+				node.m_Time = fmod(node.m_Time + deltaTime / cycleLength, 1.0f);
+			}
+		}
+	}
+}
+
+/// kbAnimPoseGraph::Evaluate
+std::vector<AnimatedBone_t>* kbAnimPoseGraph::Evaluate(const kbModel& model, const f32 deltaTime, std::vector<AnimatedBone_t>* const pExternalPose) {
+	if (m_bIsFinalized == false || model.NumBones() != m_NumBones) {
+		return nullptr;
+	}
+
+	m_Stats = kbAnimPoseGraphStats_t();
+
+	// Stamps start at 0 on new nodes, so skip it when wrapping
+	m_EvalStamp++;
+	if (m_EvalStamp == 0) {
+		m_EvalStamp = 1;
+	}
+
+	AdvanceTime(deltaTime);
+	return EvaluateNode(model, (i32)m_Nodes.size() - 1, pExternalPose);
+}
+
+/// kbAnimPoseGraph::EvaluateNode
+std::vector<AnimatedBone_t>* kbAnimPoseGraph::EvaluateNode(const kbModel& model, const i32 nodeIdx, std::vector<AnimatedBone_t>* const pExternalPose) {
+	node_t& node = m_Nodes[nodeIdx];
+	if (node.m_EvalStamp == m_EvalStamp) {
+		return GetSlotPose(node.m_OutputSlot, pExternalPose);
+	}
+
+	m_Stats.m_NumNodesEvaluated++;
+
+	std::vector<AnimatedBone_t>& poseSlot = m_PoseSlots[nodeIdx];
+	std::vector<AnimatedBone_t>* pOutput = &poseSlot;
+
+	switch (node.m_Type) {
+		case PoseNode_Clip: {
+			node.m_SampleTime = (node.m_SyncNode >= 0) ? (m_Nodes[node.m_SyncNode].m_Time * node.m_pAnimation->GetLengthInSeconds()) : (node.m_Time);
+
+			// Reuse the sample if another clip node already sampled this animation at the same time this frame
+			bool bIsShared = false;
+			for (i32 i = 0; i < nodeIdx; i++) {
+				const node_t& otherNode = m_Nodes[i];
+				if (otherNode.m_Type == PoseNode_Clip && otherNode.m_EvalStamp == m_EvalStamp && otherNode.m_pAnimation == node.m_pAnimation &&
+					otherNode.m_bLoop == node.m_bLoop && otherNode.m_SampleTime == node.m_SampleTime) {
+					pOutput = GetSlotPose(otherNode.m_OutputSlot, pExternalPose);
+					bIsShared = true;
+					m_Stats.m_NumClipsShared++;
+					break;
+				}
+			}
+
+			if (bIsShared == false) {
+				model.SetBoneMatrices(poseSlot, node.m_SampleTime, node.m_pAnimation, node.m_bLoop, &node.m_Cursor);
+				if (poseSlot.size() != m_NumBones) {
+					SetBindPose(poseSlot, m_NumBones);
+				}
+				m_Stats.m_NumClipsSampled++;
+			}
+			break;
+		}
+
+		case PoseNode_Blend: {
+			const f32 weight = GetNodeWeight(node);
+			if (weight <= 0.0f) {
+				pOutput = EvaluateNode(model, node.m_Inputs[0], pExternalPose);
+			} else if (weight >= 1.0f) {
+				pOutput = EvaluateNode(model, node.m_Inputs[1], pExternalPose);
+			} else {
+				const std::vector<AnimatedBone_t>* const pFromPose = EvaluateNode(model, node.m_Inputs[0], pExternalPose);
+				const std::vector<AnimatedBone_t>* const pToPose = EvaluateNode(model, node.m_Inputs[1], pExternalPose);
+				BlendPoses(poseSlot, *pFromPose, *pToPose, weight);
+				m_Stats.m_NumPosesBlended++;
+			}
+			break;
+		}
+
+		case PoseNode_Additive: {
+			const f32 weight = GetNodeWeight(node);
+			std::vector<AnimatedBone_t>* const pBasePose = EvaluateNode(model, node.m_Inputs[0], pExternalPose);
+			if (weight <= 0.0f) {
+				pOutput = pBasePose;
+				break;
+			}
+
+			// The additive pose is applied as its difference from the reference pose, or from the bind pose if there isn't one
+			const std::vector<AnimatedBone_t>& additivePose = *EvaluateNode(model, node.m_Inputs[1], pExternalPose);
+			const std::vector<AnimatedBone_t>* const pRefPose = (node.m_Inputs[2] >= 0) ? (EvaluateNode(model, node.m_Inputs[2], pExternalPose)) : (nullptr);
+
+			for (u32 i = 0; i < m_NumBones; i++) {
+				const Quat4 refRotation = (pRefPose != nullptr) ? ((*pRefPose)[i].m_bone_space_rotation) : (Quat4::identity);
+				const Vec3 refPosition = (pRefPose != nullptr) ? ((*pRefPose)[i].m_bone_space_position) : (Vec3::zero);
+				const Quat4 invRefRotation(-refRotation.x, -refRotation.y, -refRotation.z, refRotation.w);
+
+				const Quat4 deltaRotation = Quat4::slerp(Quat4::identity, invRefRotation * additivePose[i].m_bone_space_rotation, weight);
+				poseSlot[i].m_bone_space_rotation = ((*pBasePose)[i].m_bone_space_rotation * deltaRotation).normalize_self();
+				poseSlot[i].m_bone_space_position = (*pBasePose)[i].m_bone_space_position + (additivePose[i].m_bone_space_position - refPosition) * weight;
+			}
+			m_Stats.m_NumPosesBlended++;
+			break;
+		}
+
+		case PoseNode_Layer: {
+			const f32 weight = GetNodeWeight(node);
+			std::vector<AnimatedBone_t>* const pBasePose = EvaluateNode(model, node.m_Inputs[0], pExternalPose);
+			if (weight <= 0.0f) {
+				pOutput = pBasePose;
+				break;
+			}
+
+			const std::vector<AnimatedBone_t>& layerPose = *EvaluateNode(model, node.m_Inputs[1], pExternalPose);
+			const bool bHasMask = node.m_BoneWeights.size() > 0;
+			for (u32 i = 0; i < m_NumBones; i++) {
+				const f32 boneWeight = (bHasMask) ? (node.m_BoneWeights[i] * weight) : (weight);
+				poseSlot[i].m_bone_space_rotation = Quat4::slerp((*pBasePose)[i].m_bone_space_rotation, layerPose[i].m_bone_space_rotation, boneWeight);
+				poseSlot[i].m_bone_space_position = kbLerp((*pBasePose)[i].m_bone_space_position, layerPose[i].m_bone_space_position, boneWeight);
+			}
+			m_Stats.m_NumPosesBlended++;
+			break;
+		}
+
+		case PoseNode_BlendSpace1D:
+		case PoseNode_BlendSpace2D: {
+
+			// Fold each weighted input into the running result.  A single contributing input is passed through untouched
+			std::vector<AnimatedBone_t>* pBlendedPose = nullptr;
+			f32 accumulatedWeight = 0.0f;
+			for (size_t i = 0; i < node.m_Inputs.size(); i++) {
+				const f32 inputWeight = node.m_InputWeights[i];
+				if (inputWeight <= kbEpsilon) {
+					continue;
+				}
+
+				std::vector<AnimatedBone_t>* const pInputPose = EvaluateNode(model, node.m_Inputs[i], pExternalPose);
+				accumulatedWeight += inputWeight;
+				if (pBlendedPose == nullptr) {
+					pBlendedPose = pInputPose;
+					continue;
+				}
+
+				BlendPoses(poseSlot, *pBlendedPose, *pInputPose, inputWeight / accumulatedWeight);
+				pBlendedPose = &poseSlot;
+				m_Stats.m_NumPosesBlended++;
+			}
+
+			pOutput = (pBlendedPose != nullptr) ? (pBlendedPose) : (EvaluateNode(model, node.m_Inputs[0], pExternalPose));
+			break;
+		}
+
+		case PoseNode_External: {
+			if (pExternalPose != nullptr && pExternalPose->size() == m_NumBones) {
+				pOutput = pExternalPose;
+			} else {
+				SetBindPose(poseSlot, m_NumBones);
+			}
+			break;
+		}
+	}
+
+	node.m_EvalStamp = m_EvalStamp;
+	node.m_OutputSlot = (pOutput == pExternalPose) ? (-1) : ((i32)(pOutput - &m_PoseSlots[0]));
+	return pOutput;
+}
+
+/// kbAnimPoseGraph::BuildBoneMask
+void kbAnimPoseGraph::BuildBoneMask(const kbModel& model, const std::vector<kbString>& boneNames, const std::vector<f32>& weights, std::vector<f32>& outBoneWeights) {
+	outBoneWeights.clear();
+	if (boneNames.size() == 0) {
+		return;
+	}
+
+	// Parents always come before their children, so one pass pushes each listed weight down its subtree
+	std::vector<f32> listedWeights(model.NumBones(), -1.0f);
+	for (size_t i = 0; i < boneNames.size(); i++) {
+		const int boneIdx = model.GetBoneIndex(boneNames[i]);
+		if (boneIdx == -1) {
+			blk::warn("kbAnimPoseGraph::BuildBoneMask() - Bone %s not found in %s", boneNames[i].c_str(), model.GetName().c_str());
+			continue;
+		}
+		listedWeights[boneIdx] = kbClamp((i < weights.size()) ? (weights[i]) : (1.0f), 0.0f, 1.0f);
+	}
+
+	outBoneWeights.resize(model.NumBones(), 0.0f);
+	for (int i = 0; i < model.NumBones(); i++) {
+		const int parentIdx = model.GetParentBoneIndex(i);
+		if (listedWeights[i] >= 0.0f) {
+			outBoneWeights[i] = listedWeights[i];
+		} else if (parentIdx >= 0) {
+			outBoneWeights[i] = outBoneWeights[parentIdx];
+		}
+	}
+}
+
+/// kbAnimPoseGraph::BlendPoses
+void kbAnimPoseGraph::BlendPoses(std::vector<AnimatedBone_t>& outPose, const std::vector<AnimatedBone_t>& fromPose, const std::vector<AnimatedBone_t>& toPose, const f32 t) {
+	const size_t numBones = min(fromPose.size(), toPose.size());
+	outPose.resize(numBones);
+
+	// outPose may be fromPose or toPose.  Each bone only reads its own entries, so that's safe
+	for (size_t i = 0; i < numBones; i++) {
+		outPose[i].m_bone_space_rotation = Quat4::slerp(fromPose[i].m_bone_space_rotation, toPose[i].m_bone_space_rotation, t);
+		outPose[i].m_bone_space_position = kbLerp(fromPose[i].m_bone_space_position, toPose[i].m_bone_space_position, t);
+	}
+}
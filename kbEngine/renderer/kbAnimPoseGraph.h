@@ -0,0 +1,130 @@
+/// kbAnimPoseGraph.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "kbModel.h"
+
+/// EAnimPoseNodeType
+enum EAnimPoseNodeType {
+	PoseNode_Clip,
+	PoseNode_Blend,
+	PoseNode_Additive,
+	PoseNode_Layer,
+	PoseNode_BlendSpace1D,
+	PoseNode_BlendSpace2D,
+	PoseNode_External,
+};
+
+/// kbAnimPoseGraphStats_t
+struct kbAnimPoseGraphStats_t {
+	kbAnimPoseGraphStats_t() : m_NumNodesEvaluated(0), m_NumClipsSampled(0), m_NumClipsShared(0), m_NumPosesBlended(0) { }
+
+	u32 m_NumNodesEvaluated;
+	u32 m_NumClipsSampled;
+	u32 m_NumClipsShared;		// Clip nodes that reused another node's sample of the same animation and time
+	u32 m_NumPosesBlended;
+};
+
+/// kbAnimPoseGraph
+///
+/// Per-instance graph of pose nodes that produces one local space pose a frame.  Nodes can only take inputs that were
+/// added before them, so the last node added is the root and the node list is already in dependency order.
+///
+/// Every node owns one pose slot that is allocated by Finalize(), so evaluating never allocates.  Each node is
+/// evaluated at most once per frame no matter how many nodes read it, inputs with no weight are skipped, and nodes
+/// that would only copy an input hand back the input's slot instead
+class kbAnimPoseGraph {
+public:
+	kbAnimPoseGraph() : m_NumBones(0), m_EvalStamp(0), m_bIsFinalized(false), m_bUsesExternalPose(false) { }
+
+	void Reset();
+
+	/// Parameters drive node weights and blend space positions.  Adding an existing name returns its index
+	i32 AddParameter(const kbString& name, const f32 defaultValue = 0.0f);
+	i32 FindParameter(const kbString& name) const;
+	void SetParameter(const i32 paramIdx, const f32 value) { if (paramIdx >= 0 && paramIdx < m_Parameters.size()) { m_Parameters[paramIdx].m_Value = value; } }
+	f32 GetParameter(const i32 paramIdx) const { return (paramIdx >= 0 && paramIdx < m_Parameters.size()) ? (m_Parameters[paramIdx].m_Value) : (0.0f); }
+
+	/// Each returns the new node's index, or -1 if an input is invalid.  weightParam of -1 uses the constant weight
+	i32 AddClipNode(const kbAnimation* const pAnimation, const bool bLoop, const f32 timeScale);
+	i32 AddBlendNode(const i32 fromNode, const i32 toNode, const i32 weightParam, const f32 weight);
+	i32 AddAdditiveNode(const i32 baseNode, const i32 additiveNode, const i32 referenceNode, const i32 weightParam, const f32 weight);
+	i32 AddLayerNode(const i32 baseNode, const i32 layerNode, const std::vector<f32>& boneWeights, const i32 weightParam, const f32 weight);
+	i32 AddBlendSpaceNode(const std::vector<i32>& inputNodes, const std::vector<Vec2>& samplePositions, const i32 xParam, const i32 yParam);
+	i32 AddExternalNode();
+
+	/// Sizes the pose slots for model's skeleton.  Must be called before Evaluate() and again if the model changes
+	bool Finalize(const kbModel& model);
+	bool IsFinalized() const { return m_bIsFinalized; }
+	bool UsesExternalPose() const { return m_bUsesExternalPose; }
+	u32 NumNodes() const { return (u32)m_Nodes.size(); }
+
+	/// Advances clip times by deltaTime then evaluates the root node.  pExternalPose feeds PoseNode_External nodes.
+	/// The returned pose belongs to the graph (or is pExternalPose) and stays valid until the next call
+	std::vector<AnimatedBone_t>* Evaluate(const kbModel& model, const f32 deltaTime, std::vector<AnimatedBone_t>* const pExternalPose);
+
+	const kbAnimPoseGraphStats_t& GetStats() const { return m_Stats; }
+
+	/// Per-bone weights for a layer.  Each listed bone's weight applies to its descendants until another listed bone overrides it
+	static void BuildBoneMask(const kbModel& model, const std::vector<kbString>& boneNames, const std::vector<f32>& weights, std::vector<f32>& outBoneWeights);
+
+	static void BlendPoses(std::vector<AnimatedBone_t>& outPose, const std::vector<AnimatedBone_t>& fromPose, const std::vector<AnimatedBone_t>& toPose, const f32 t);
+
+private:
+	struct parameter_t {
+		kbString m_Name;
+		f32 m_Value;
+	};
+
+	struct node_t {
+		node_t() : m_Type(PoseNode_Clip), m_pAnimation(nullptr), m_bLoop(false), m_TimeScale(1.0f), m_Time(0.0f), m_SyncNode(-1),
+				   m_SampleTime(0.0f), m_WeightParam(-1), m_YParam(-1), m_Weight(1.0f), m_EvalStamp(0), m_OutputSlot(-1) { }
+
+		EAnimPoseNodeType m_Type;
+		std::vector<i32> m_Inputs;
+
+		// Clips.  Clips feeding a blend space take their time from its phase so that the inputs stay in step
+		const kbAnimation* m_pAnimation;
+		bool m_bLoop;
+		f32 m_TimeScale;
+		f32 m_Time;
+		i32 m_SyncNode;
+		f32 m_SampleTime;
+		kbAnimationCursor_t m_Cursor;
+
+		// Blends.  Blend spaces use m_WeightParam and m_YParam as their x and y, and m_Time as their phase
+		i32 m_WeightParam;
+		i32 m_YParam;
+		f32 m_Weight;
+		std::vector<Vec2> m_SamplePositions;
+		std::vector<f32> m_InputWeights;
+		std::vector<f32> m_BoneWeights;
+
+		// Output for the frame matching m_EvalStamp.  The pose slot of this node or of an input it passed through, or -1
+		// for the external pose.  Kept as an index so that copies of the graph don't point into each other's slots
+		u32 m_EvalStamp;
+		i32 m_OutputSlot;
+	};
+
+	i32 AddNode(const node_t& node);
+	bool IsValidInput(const i32 nodeIdx) const { return nodeIdx >= 0 && nodeIdx < (i32)m_Nodes.size(); }
+	f32 GetNodeWeight(const node_t& node) const { return kbClamp((node.m_WeightParam >= 0) ? (m_Parameters[node.m_WeightParam].m_Value) : (node.m_Weight), 0.0f, 1.0f); }
+
+	void AdvanceTime(const f32 deltaTime);
+	void ComputeBlendSpaceWeights(node_t& node) const;
+	std::vector<AnimatedBone_t>* GetSlotPose(const i32 slot, std::vector<AnimatedBone_t>* const pExternalPose) { return (slot >= 0) ? (&m_PoseSlots[slot]) : (pExternalPose); }
+	std::vector<AnimatedBone_t>* EvaluateNode(const kbModel& model, const i32 nodeIdx, std::vector<AnimatedBone_t>* const pExternalPose);
+
+	std::vector<node_t> m_Nodes;
+	std::vector<parameter_t> m_Parameters;
+	std::vector<std::vector<AnimatedBone_t>> m_PoseSlots;
+
+	kbAnimPoseGraphStats_t m_Stats;
+	u32 m_NumBones;
+	u32 m_EvalStamp;
+	bool m_bIsFinalized;
+	bool m_bUsesExternalPose;
+};
@@ -0,0 +1,344 @@
+/// kbCompressedAnimation.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "blk_containers.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "kbModel.h"
+#include "kbCompressedAnimation.h"
+
+static const float g_SqrtHalf = 0.70710678f;
+static const float g_RotationQuantizeScale = 32767.0f;
+static const float g_TranslationQuantizeScale = 65535.0f;
+
+// Worst case angle lost packing a rotation.  Each component is off by at most half a step
+static const float g_RotationQuantizeError = 2.0f * 1.7320508f * (g_SqrtHalf / g_RotationQuantizeScale);
+
+/// RotationError
+///
+/// Angle between two rotations.  Uses the chord length instead of acos(a|b), which has no precision left near 0
+static float RotationError(const Quat4& a, const Quat4& b) {
+	const float sign = ((a | b) < 0.0f) ? (-1.0f) : (1.0f);
+	const float dx = a.x - b.x * sign, dy = a.y - b.y * sign, dz = a.z - b.z * sign, dw = a.w - b.w * sign;
+	const float halfChord = 0.5f * sqrtf(dx * dx + dy * dy + dz * dz + dw * dw);
+	return 4.0f * asinf(min(halfChord, 1.0f));
+}
+
+/// ReduceKeys
+///
+/// Greedily drops keys that can be rebuilt by interpolating the last kept key and a later one.  The first and last
+/// keys are always kept.  A track whose keys all fall within maxError of the first key is reduced to that one key
+template<typename T, typename Interpolate, typename Error>
+static void ReduceKeys(const std::vector<T>& keys, const float maxError, Interpolate interpolate, Error error, std::vector<u32>& outKeptKeys) {
+	outKeptKeys.clear();
+	if (keys.size() == 0) {
+		return;
+	}
+
+	outKeptKeys.push_back(0);
+
+	bool bIsConstant = true;
+	for (size_t i = 1; i < keys.size() && bIsConstant; i++) {
+		bIsConstant = error(keys[0], keys[i]) <= maxError;
+	}
+
+	if (bIsConstant) {
+		return;
+	}
+
+	u32 anchor = 0;
+	for (u32 end = anchor + 2; end < keys.size(); end++) {
+		bool bFits = true;
+		for (u32 i = anchor + 1; i < end && bFits; i++) {
+			const float timeSpan = keys[end].m_Time - keys[anchor].m_Time;
+			const float t = (timeSpan > 0.0f) ? ((keys[i].m_Time - keys[anchor].m_Time) / timeSpan) : (0.0f);
+			bFits = error(interpolate(keys[anchor], keys[end], t), keys[i]) <= maxError;
+		}
+
+		if (bFits == false) {
+			anchor = end - 1;
+			outKeptKeys.push_back(anchor);
+		}
+	}
+	outKeptKeys.push_back((u32)keys.size() - 1);
+}
+
+/// kbCompressedAnimation::PackRotation
+void kbCompressedAnimation::PackRotation(const Quat4& rotation, u16 outPacked[3]) {
+	const Quat4 normalizedRot = rotation.normalize_safe();
+	float components[4] = { normalizedRot.x, normalizedRot.y, normalizedRot.z, normalizedRot.w };
+
+	// Drop the largest component.  q and -q are the same rotation, so flip it positive and rebuild it from the other three
+	u32 largestIdx = 0;
+	for (u32 i = 1; i < 4; i++) {
+		if (fabsf(components[i]) > fabsf(components[largestIdx])) {
+			largestIdx = i;
+		}
+	}
+	const float sign = (components[largestIdx] < 0.0f) ? (-1.0f) : (1.0f);
+
+	u32 outIdx = 0;
+	for (u32 i = 0; i < 4; i++) {
+		if (i == largestIdx) {
+			continue;
+		}
+		const float normalized = kbClamp((components[i] * sign / g_SqrtHalf) * 0.5f + 0.5f, 0.0f, 1.0f);
+		outPacked[outIdx++] = (u16)(normalized * g_RotationQuantizeScale + 0.5f);
+	}
+
+	// The dropped component's index goes in the top bits of the first two values
+	outPacked[0] |= (u16)((largestIdx & 1) << 15);
+	outPacked[1] |= (u16)((largestIdx >> 1) << 15);
+}
+
+/// kbCompressedAnimation::UnpackRotation
+Quat4 kbCompressedAnimation::UnpackRotation(const u16 packed[3]) {
+	const u32 largestIdx = (packed[0] >> 15) | ((packed[1] >> 15) << 1);
+
+	float components[4];
+	float sumSqr = 0.0f;
+	u32 packedIdx = 0;
+	for (u32 i = 0; i < 4; i++) {
+		if (i == largestIdx) {
+			continue;
+		}
+		const float normalized = (packed[packedIdx++] & 0x7fff) / g_RotationQuantizeScale;
+		components[i] = (normalized * 2.0f - 1.0f) * g_SqrtHalf;
+		sumSqr += components[i] * components[i];
+	}
+	components[largestIdx] = sqrtf(max(1.0f - sumSqr, 0.0f));
+
+	return Quat4(components[0], components[1], components[2], components[3]);
+}
+
+/// kbCompressedAnimation::Reset
+void kbCompressedAnimation::Reset() {
+	m_RotationTracks.clear();
+	m_TranslationTracks.clear();
+	m_TranslationRanges.clear();
+	m_RotationTimes.clear();
+	m_RotationData.clear();
+	m_TranslationTimes.clear();
+	m_TranslationData.clear();
+	m_LengthInSeconds = 0.0f;
+	m_TimeScale = 0.0f;
+	m_Stats = kbAnimationCompressionStats_t();
+}
+
+/// kbCompressedAnimation::Compress
+void kbCompressedAnimation::Compress(const kbAnimation& animation, const kbAnimationCompressionSettings_t& settings) {
+	Reset();
+
+	m_LengthInSeconds = animation.m_LengthInSeconds;
+	m_TimeScale = m_LengthInSeconds / 65535.0f;
+	const float invLength = (m_LengthInSeconds > 0.0f) ? (1.0f / m_LengthInSeconds) : (0.0f);
+
+	const size_t numBones = animation.m_JointKeyFrameData.size();
+	m_RotationTracks.resize(numBones);
+	m_TranslationTracks.resize(numBones);
+	m_TranslationRanges.resize(numBones);
+
+	const auto interpolateRotation = [](const kbAnimation::kbRotationKeyFrame_t& from, const kbAnimation::kbRotationKeyFrame_t& to, const float t) {
+		kbAnimation::kbRotationKeyFrame_t key;
+		key.m_Time = from.m_Time + (to.m_Time - from.m_Time) * t;
+		key.m_Rotation = Quat4::slerp(from.m_Rotation, to.m_Rotation, t);
+		return key;
+	};
+	const auto rotationError = [](const kbAnimation::kbRotationKeyFrame_t& a, const kbAnimation::kbRotationKeyFrame_t& b) {
+		return RotationError(a.m_Rotation, b.m_Rotation);
+	};
+
+	const auto interpolateTranslation = [](const kbAnimation::kbTranslationKeyFrame_t& from, const kbAnimation::kbTranslationKeyFrame_t& to, const float t) {
+		kbAnimation::kbTranslationKeyFrame_t key;
+		key.m_Time = from.m_Time + (to.m_Time - from.m_Time) * t;
+		key.m_position = from.m_position + (to.m_position - from.m_position) * t;
+		return key;
+	};
+	const auto translationError = [](const kbAnimation::kbTranslationKeyFrame_t& a, const kbAnimation::kbTranslationKeyFrame_t& b) {
+		return (a.m_position - b.m_position).length();
+	};
+
+	std::vector<u32> keptKeys;
+	for (size_t iBone = 0; iBone < numBones; iBone++) {
+		const kbAnimation::kbBoneKeyFrames_t& joint = animation.m_JointKeyFrameData[iBone];
+
+		// Rotations.  Part of the error budget is saved for quantization
+		const std::vector<kbAnimation::kbRotationKeyFrame_t>& rotationKeys = joint.m_RotationKeyFrames;
+		m_Stats.m_NumRawKeys += (u32)rotationKeys.size();
+		m_Stats.m_RawSizeBytes += (u32)(rotationKeys.size() * sizeof(kbAnimation::kbRotationKeyFrame_t));
+
+		// Tracks that stay at the default pose are stripped
+		bool bIsDefaultPose = true;
+		for (size_t i = 0; i < rotationKeys.size() && bIsDefaultPose; i++) {
+			bIsDefaultPose = RotationError(rotationKeys[i].m_Rotation, Quat4::identity) <= settings.m_MaxRotationError;
+		}
+
+		keptKeys.clear();
+		if (bIsDefaultPose == false) {
+			ReduceKeys(rotationKeys, max(settings.m_MaxRotationError - g_RotationQuantizeError, 0.0f), interpolateRotation, rotationError, keptKeys);
+		}
+
+		track_t& rotationTrack = m_RotationTracks[iBone];
+		rotationTrack.m_FirstKey = (u32)m_RotationTimes.size();
+		rotationTrack.m_NumKeys = (u32)keptKeys.size();
+		for (size_t i = 0; i < keptKeys.size(); i++) {
+			const kbAnimation::kbRotationKeyFrame_t& key = rotationKeys[keptKeys[i]];
+			m_RotationTimes.push_back((u16)(kbClamp(key.m_Time * invLength, 0.0f, 1.0f) * 65535.0f + 0.5f));
+
+			u16 packed[3];
+			PackRotation(key.m_Rotation, packed);
+			m_RotationData.insert(m_RotationData.end(), packed, packed + 3);
+		}
+
+		if (rotationKeys.size() > 0) {
+			m_Stats.m_NumConstantTracks += (keptKeys.size() == 1) ? (1) : (0);
+			m_Stats.m_NumStrippedTracks += (keptKeys.size() == 0) ? (1) : (0);
+		}
+
+		// Translations
+		const std::vector<kbAnimation::kbTranslationKeyFrame_t>& translationKeys = joint.m_TranslationKeyFrames;
+		m_Stats.m_NumRawKeys += (u32)translationKeys.size();
+		m_Stats.m_RawSizeBytes += (u32)(translationKeys.size() * sizeof(kbAnimation::kbTranslationKeyFrame_t));
+
+		translationRange_t& range = m_TranslationRanges[iBone];
+		range.m_Min = Vec3::zero;
+		range.m_Extent = Vec3::zero;
+		if (translationKeys.size() > 0) {
+			Vec3 rangeMax = translationKeys[0].m_position;
+			range.m_Min = translationKeys[0].m_position;
+			for (size_t i = 1; i < translationKeys.size(); i++) {
+				const Vec3& pos = translationKeys[i].m_position;
+				range.m_Min.set(min(range.m_Min.x, pos.x), min(range.m_Min.y, pos.y), min(range.m_Min.z, pos.z));
+				rangeMax.set(max(rangeMax.x, pos.x), max(rangeMax.y, pos.y), max(rangeMax.z, pos.z));
+			}
+			range.m_Extent = rangeMax - range.m_Min;
+		}
+
+		bIsDefaultPose = true;
+		for (size_t i = 0; i < translationKeys.size() && bIsDefaultPose; i++) {
+			bIsDefaultPose = translationKeys[i].m_position.length() <= settings.m_MaxTranslationError;
+		}
+
+		keptKeys.clear();
+		if (bIsDefaultPose == false) {
+			const float translationQuantizeError = 0.5f * range.m_Extent.length() / g_TranslationQuantizeScale;
+			ReduceKeys(translationKeys, max(settings.m_MaxTranslationError - translationQuantizeError, 0.0f), interpolateTranslation, translationError, keptKeys);
+		}
+
+		track_t& translationTrack = m_TranslationTracks[iBone];
+		translationTrack.m_FirstKey = (u32)m_TranslationTimes.size();
+		translationTrack.m_NumKeys = (u32)keptKeys.size();
+		for (size_t i = 0; i < keptKeys.size(); i++) {
+			const kbAnimation::kbTranslationKeyFrame_t& key = translationKeys[keptKeys[i]];
+			m_TranslationTimes.push_back((u16)(kbClamp(key.m_Time * invLength, 0.0f, 1.0f) * 65535.0f + 0.5f));
+
+			for (int axis = 0; axis < 3; axis++) {
+				const float normalized = (range.m_Extent[axis] > 0.0f) ? ((key.m_position[axis] - range.m_Min[axis]) / range.m_Extent[axis]) : (0.0f);
+				m_TranslationData.push_back((u16)(kbClamp(normalized, 0.0f, 1.0f) * g_TranslationQuantizeScale + 0.5f));
+			}
+		}
+
+		if (translationKeys.size() > 0) {
+			m_Stats.m_NumConstantTracks += (keptKeys.size() == 1) ? (1) : (0);
+			m_Stats.m_NumStrippedTracks += (keptKeys.size() == 0) ? (1) : (0);
+		}
+	}
+
+	m_Stats.m_NumCompressedKeys = (u32)(m_RotationTimes.size() + m_TranslationTimes.size());
+	m_Stats.m_CompressedSizeBytes = (u32)(sizeof(track_t) * (m_RotationTracks.size() + m_TranslationTracks.size()) +
+										  sizeof(translationRange_t) * m_TranslationRanges.size() +
+										  sizeof(u16) * (m_RotationTimes.size() + m_RotationData.size() + m_TranslationTimes.size() + m_TranslationData.size()));
+
+	// Measure the real error by comparing decoded samples against the source keys and the midpoints between them
+	for (size_t iBone = 0; iBone < numBones; iBone++) {
+		const kbAnimation::kbBoneKeyFrames_t& joint = animation.m_JointKeyFrameData[iBone];
+
+		u32 rotationCursor = 0, translationCursor = 0;
+		for (size_t i = 0; i < joint.m_RotationKeyFrames.size() * 2 - min(joint.m_RotationKeyFrames.size(), (size_t)1); i++) {
+			const kbAnimation::kbRotationKeyFrame_t& prevKey = joint.m_RotationKeyFrames[i / 2];
+			const kbAnimation::kbRotationKeyFrame_t& nextKey = joint.m_RotationKeyFrames[min(i / 2 + 1, joint.m_RotationKeyFrames.size() - 1)];
+			const kbAnimation::kbRotationKeyFrame_t rawKey = ((i & 1) != 0) ? (interpolateRotation(prevKey, nextKey, 0.5f)) : (prevKey);
+
+			Quat4 decoded = Quat4::identity;
+			SampleRotation((u32)iBone, rawKey.m_Time, rotationCursor, decoded);
+			m_Stats.m_MaxRotationError = max(m_Stats.m_MaxRotationError, RotationError(rawKey.m_Rotation, decoded));
+		}
+
+		for (size_t i = 0; i < joint.m_TranslationKeyFrames.size() * 2 - min(joint.m_TranslationKeyFrames.size(), (size_t)1); i++) {
+			const kbAnimation::kbTranslationKeyFrame_t& prevKey = joint.m_TranslationKeyFrames[i / 2];
+			const kbAnimation::kbTranslationKeyFrame_t& nextKey = joint.m_TranslationKeyFrames[min(i / 2 + 1, joint.m_TranslationKeyFrames.size() - 1)];
+			const kbAnimation::kbTranslationKeyFrame_t rawKey = ((i & 1) != 0) ? (interpolateTranslation(prevKey, nextKey, 0.5f)) : (prevKey);
+
+			Vec3 decoded = Vec3::zero;
+			SampleTranslation((u32)iBone, rawKey.m_Time, translationCursor, decoded);
+			m_Stats.m_MaxTranslationError = max(m_Stats.m_MaxTranslationError, (rawKey.m_position - decoded).length());
+		}
+	}
+}
+
+/// kbCompressedAnimation::UnpackTranslation
+Vec3 kbCompressedAnimation::UnpackTranslation(const u32 boneIdx, const u32 keyIdx) const {
+	const translationRange_t& range = m_TranslationRanges[boneIdx];
+	const u16* const packed = &m_TranslationData[keyIdx * 3];
+	return Vec3(range.m_Min.x + range.m_Extent.x * (packed[0] / g_TranslationQuantizeScale),
+				range.m_Min.y + range.m_Extent.y * (packed[1] / g_TranslationQuantizeScale),
+				range.m_Min.z + range.m_Extent.z * (packed[2] / g_TranslationQuantizeScale));
+}
+
+/// kbCompressedAnimation::FindRotationKey
+i32 kbCompressedAnimation::FindRotationKey(const u32 boneIdx, const float time, u32& cursor) const {
+	const track_t& track = m_RotationTracks[boneIdx];
+	if (track.m_NumKeys == 0) {
+		return -1;
+	}
+	return blk::find_key_index(&m_RotationTimes[track.m_FirstKey], (int)track.m_NumKeys, time, cursor, [this](const u16 keyTime) { return KeyTime(keyTime); });
+}
+
+/// kbCompressedAnimation::SampleRotation
+void kbCompressedAnimation::SampleRotation(const u32 boneIdx, const float time, u32& cursor, Quat4& outRotation) const {
+	const track_t& track = m_RotationTracks[boneIdx];
+	if (track.m_NumKeys == 0) {
+		return;
+	}
+
+	const u16* const keyTimes = &m_RotationTimes[track.m_FirstKey];
+	const i32 keyIdx = blk::find_key_index(keyTimes, (int)track.m_NumKeys, time, cursor, [this](const u16 keyTime) { return KeyTime(keyTime); });
+	if (keyIdx < 0 || keyIdx >= (i32)track.m_NumKeys - 1) {
+		const u32 heldKey = track.m_FirstKey + ((keyIdx < 0) ? (0) : (track.m_NumKeys - 1));
+		outRotation = UnpackRotation(&m_RotationData[heldKey * 3]);
+		return;
+	}
+
+	const float prevTime = KeyTime(keyTimes[keyIdx]);
+	const float timeBetweenKeys = KeyTime(keyTimes[keyIdx + 1]) - prevTime;
+	const float t = (timeBetweenKeys > 0.0f) ? ((time - prevTime) / timeBetweenKeys) : (0.0f);
+
+	const u32 prevKey = track.m_FirstKey + keyIdx;
+	outRotation = Quat4::slerp(UnpackRotation(&m_RotationData[prevKey * 3]), UnpackRotation(&m_RotationData[(prevKey + 1) * 3]), t);
+}
+
+/// kbCompressedAnimation::SampleTranslation
+void kbCompressedAnimation::SampleTranslation(const u32 boneIdx, const float time, u32& cursor, Vec3& outTranslation) const {
+	const track_t& track = m_TranslationTracks[boneIdx];
+	if (track.m_NumKeys == 0) {
+		return;
+	}
+
+	const u16* const keyTimes = &m_TranslationTimes[track.m_FirstKey];
+	const i32 keyIdx = blk::find_key_index(keyTimes, (int)track.m_NumKeys, time, cursor, [this](const u16 keyTime) { return KeyTime(keyTime); });
+	if (keyIdx < 0 || keyIdx >= (i32)track.m_NumKeys - 1) {
+		const u32 heldKey = track.m_FirstKey + ((keyIdx < 0) ? (0) : (track.m_NumKeys - 1));
+		outTranslation = UnpackTranslation(boneIdx, heldKey);
+		return;
+	}
+
+	const float prevTime = KeyTime(keyTimes[keyIdx]);
+	const float timeBetweenKeys = KeyTime(keyTimes[keyIdx + 1]) - prevTime;
+	const float t = (timeBetweenKeys > 0.0f) ? ((time - prevTime) / timeBetweenKeys) : (0.0f);
+
+	const u32 prevKey = track.m_FirstKey + keyIdx;
+	const Vec3 prevPos = UnpackTranslation(boneIdx, prevKey);
+	outTranslation = prevPos + (UnpackTranslation(boneIdx, prevKey + 1) - prevPos) * t;
+}
@@ -0,0 +1,91 @@
+/// kbCompressedAnimation.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+#include "Quaternion.h"
+
+/// kbAnimationCompressionSettings_t
+struct kbAnimationCompressionSettings_t {
+	kbAnimationCompressionSettings_t() : m_MaxRotationError(0.0005f), m_MaxTranslationError(0.001f) { }
+
+	float m_MaxRotationError;			// Radians
+	float m_MaxTranslationError;		// Model units
+};
+
+/// kbAnimationCompressionStats_t
+struct kbAnimationCompressionStats_t {
+	kbAnimationCompressionStats_t() : m_RawSizeBytes(0), m_CompressedSizeBytes(0), m_NumRawKeys(0), m_NumCompressedKeys(0), m_NumConstantTracks(0), m_NumStrippedTracks(0), m_MaxRotationError(0.0f), m_MaxTranslationError(0.0f) { }
+
+	float CompressionRatio() const { return (m_CompressedSizeBytes > 0) ? ((float)m_RawSizeBytes / m_CompressedSizeBytes) : (0.0f); }
+
+	u32 m_RawSizeBytes;
+	u32 m_CompressedSizeBytes;
+	u32 m_NumRawKeys;
+	u32 m_NumCompressedKeys;
+	u32 m_NumConstantTracks;
+	u32 m_NumStrippedTracks;
+	float m_MaxRotationError;
+	float m_MaxTranslationError;
+};
+
+/// kbCompressedAnimation
+///
+/// Compact, read-only copy of a kbAnimation's key frames.  Keys that can be rebuilt by interpolating their neighbors
+/// within the error bounds are dropped, tracks that never change are stored as a single key (or not at all if they
+/// match the default pose), rotations are packed to 48 bits using smallest-three, and translations are packed to 48 bits
+/// relative to their track's range.  Samples are decoded straight from the packed keys.
+class kbCompressedAnimation {
+public:
+	kbCompressedAnimation() : m_LengthInSeconds(0.0f), m_TimeScale(0.0f) { }
+
+	void Compress(const class kbAnimation& animation, const kbAnimationCompressionSettings_t& settings);
+	void Reset();
+
+	u32 NumTracks() const { return (u32)m_RotationTracks.size(); }
+	const kbAnimationCompressionStats_t& GetStats() const { return m_Stats; }
+
+	/// Bones without keys are left untouched.  Cursors work the same as blk::find_key_index()'s
+	void SampleRotation(const u32 boneIdx, const float time, u32& cursor, Quat4& outRotation) const;
+	void SampleTranslation(const u32 boneIdx, const float time, u32& cursor, Vec3& outTranslation) const;
+
+	/// Key searches over a bone's packed rotation times, so the sampling benchmark can run once the raw keys are freed
+	u32 NumRotationKeys(const u32 boneIdx) const { return m_RotationTracks[boneIdx].m_NumKeys; }
+	float RotationKeyTime(const u32 boneIdx, const u32 keyIdx) const { return KeyTime(m_RotationTimes[m_RotationTracks[boneIdx].m_FirstKey + keyIdx]); }
+	i32 FindRotationKey(const u32 boneIdx, const float time, u32& cursor) const;
+
+	static void PackRotation(const Quat4& rotation, u16 outPacked[3]);
+	static Quat4 UnpackRotation(const u16 packed[3]);
+
+private:
+	struct track_t {
+		u32 m_FirstKey;
+		u32 m_NumKeys;
+	};
+
+	struct translationRange_t {
+		Vec3 m_Min;
+		Vec3 m_Extent;
+	};
+
+	float KeyTime(const u16 quantizedTime) const { return quantizedTime * m_TimeScale; }
+	Vec3 UnpackTranslation(const u32 boneIdx, const u32 keyIdx) const;
+
+	std::vector<track_t> m_RotationTracks;
+	std::vector<track_t> m_TranslationTracks;
+	std::vector<translationRange_t> m_TranslationRanges;
+
+	// Times are normalized to the clip length and stored as 16 bits.  Key data is 3 u16s per key
+	std::vector<u16> m_RotationTimes;
+	std::vector<u16> m_RotationData;
+	std::vector<u16> m_TranslationTimes;
+	std::vector<u16> m_TranslationData;
+
+	float m_LengthInSeconds;
+	float m_TimeScale;
+
+	kbAnimationCompressionStats_t m_Stats;
+};
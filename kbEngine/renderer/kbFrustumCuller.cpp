@@ -0,0 +1,125 @@
+/// kbFrustumCuller.cpp
+///
+/// 2025 blk 1.0
+
+#include <xmmintrin.h>
+#include "blk_core.h"
+#include "kbFrustumCuller.h"
+
+/// kbFrustumCuller::Reset
+void kbFrustumCuller::Reset() {
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_ExtentX.clear();
+	m_ExtentY.clear();
+	m_ExtentZ.clear();
+	m_Radius.clear();
+	m_NumBounds = 0;
+}
+
+/// kbFrustumCuller::AddBounds
+u32 kbFrustumCuller::AddBounds(const Vec3& center, const Vec3& extents, const float radius) {
+
+	// Arrays are kept padded to a multiple of 4 so Cull() can always load full batches
+	if ((m_NumBounds % 4) == 0) {
+		const size_t paddedSize = m_NumBounds + 4;
+		m_CenterX.resize(paddedSize, 0.0f);
+		m_CenterY.resize(paddedSize, 0.0f);
+		m_CenterZ.resize(paddedSize, 0.0f);
+		m_ExtentX.resize(paddedSize, 0.0f);
+		m_ExtentY.resize(paddedSize, 0.0f);
+		m_ExtentZ.resize(paddedSize, 0.0f);
+		m_Radius.resize(paddedSize, 0.0f);
+	}
+
+	const u32 idx = m_NumBounds++;
+	m_CenterX[idx] = center.x;
+	m_CenterY[idx] = center.y;
+	m_CenterZ[idx] = center.z;
+	m_ExtentX[idx] = extents.x;
+	m_ExtentY[idx] = extents.y;
+	m_ExtentZ[idx] = extents.z;
+	m_Radius[idx] = radius;
+
+	return idx;
+}
+
+/// kbFrustumCuller::ExtractFrustumPlanes
+void kbFrustumCuller::ExtractFrustumPlanes(const Mat4& viewProjMatrix, Plane3d outPlanes[6]) {
+	Mat4 matrix = viewProjMatrix;
+	matrix.left_clip_plane(outPlanes[0]);
+	matrix.right_clip_plane(outPlanes[1]);
+	matrix.top_clip_plane(outPlanes[2]);
+	matrix.bottom_clip_plane(outPlanes[3]);
+	matrix.near_clip_plane(outPlanes[4]);
+	matrix.far_clip_plane(outPlanes[5]);
+}
+
+/// kbFrustumCuller::Cull
+kbCullStats_t kbFrustumCuller::Cull(const Mat4& viewProjMatrix, std::vector<u32>& outVisibleIndices) const {
+	Plane3d frustumPlanes[6];
+	ExtractFrustumPlanes(viewProjMatrix, frustumPlanes);
+	return Cull(frustumPlanes, outVisibleIndices);
+}
+
+/// kbFrustumCuller::Cull
+kbCullStats_t kbFrustumCuller::Cull(const Plane3d frustumPlanes[6], std::vector<u32>& outVisibleIndices) const {
+	kbTimer cullTimer;
+
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	for (int i = 0; i < 6; i++) {
+		planeX[i] = _mm_set1_ps(frustumPlanes[i].x);
+		planeY[i] = _mm_set1_ps(frustumPlanes[i].y);
+		planeZ[i] = _mm_set1_ps(frustumPlanes[i].z);
+		planeW[i] = _mm_set1_ps(frustumPlanes[i].w);
+		absPlaneX[i] = _mm_andnot_ps(signMask, planeX[i]);
+		absPlaneY[i] = _mm_andnot_ps(signMask, planeY[i]);
+		absPlaneZ[i] = _mm_andnot_ps(signMask, planeZ[i]);
+	}
+
+	const size_t numVisibleBefore = outVisibleIndices.size();
+	for (u32 batchStart = 0; batchStart < m_NumBounds; batchStart += 4) {
+		const __m128 centerX = _mm_loadu_ps(&m_CenterX[batchStart]);
+		const __m128 centerY = _mm_loadu_ps(&m_CenterY[batchStart]);
+		const __m128 centerZ = _mm_loadu_ps(&m_CenterZ[batchStart]);
+		const __m128 extentX = _mm_loadu_ps(&m_ExtentX[batchStart]);
+		const __m128 extentY = _mm_loadu_ps(&m_ExtentY[batchStart]);
+		const __m128 extentZ = _mm_loadu_ps(&m_ExtentZ[batchStart]);
+		const __m128 radius = _mm_loadu_ps(&m_Radius[batchStart]);
+
+		__m128 outside = _mm_setzero_ps();
+		for (int i = 0; i < 6; i++) {
+
+			// Signed distance from the plane.  Positive is outside
+			__m128 dist = _mm_mul_ps(planeX[i], centerX);
+			dist = _mm_add_ps(dist, _mm_mul_ps(planeY[i], centerY));
+			dist = _mm_add_ps(dist, _mm_mul_ps(planeZ[i], centerZ));
+			dist = _mm_sub_ps(dist, planeW[i]);
+
+			// Projected radius of the box onto the plane normal
+			__m128 boxRadius = _mm_mul_ps(absPlaneX[i], extentX);
+			boxRadius = _mm_add_ps(boxRadius, _mm_mul_ps(absPlaneY[i], extentY));
+			boxRadius = _mm_add_ps(boxRadius, _mm_mul_ps(absPlaneZ[i], extentZ));
+
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, boxRadius));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dist, radius));
+		}
+
+		const int outsideMask = _mm_movemask_ps(outside);
+		const u32 batchEnd = min(batchStart + 4, m_NumBounds);
+		for (u32 idx = batchStart; idx < batchEnd; idx++) {
+			if ((outsideMask & (1 << (idx - batchStart))) == 0) {
+				outVisibleIndices.push_back(idx);
+			}
+		}
+	}
+
+	kbCullStats_t stats;
+	stats.m_NumTested = m_NumBounds;
+	stats.m_NumVisible = (u32)(outVisibleIndices.size() - numVisibleBefore);
+	stats.m_CullTimeMS = cullTimer.TimeElapsedMS();
+	return stats;
+}
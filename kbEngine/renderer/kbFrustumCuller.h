@@ -0,0 +1,56 @@
+/// kbFrustumCuller.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+#include "Plane3d.h"
+
+/// kbCullStats_t
+struct kbCullStats_t {
+	kbCullStats_t() : m_NumTested(0), m_NumVisible(0), m_CullTimeMS(0.0f) { }
+
+	u32 NumCulled() const { return m_NumTested - m_NumVisible; }
+
+	u32 m_NumTested;
+	u32 m_NumVisible;
+	float m_CullTimeMS;
+};
+
+/// kbFrustumCuller
+///
+/// Holds world space bounds in SoA form and tests them four at a time against a view's frustum planes.  Each entry
+/// is bounded by both an AABB and a sphere and is culled if either one is fully outside a plane, so callers can pass
+/// a tight box for rigid objects and a rotation-invariant sphere for things like skinned meshes.
+class kbFrustumCuller {
+public:
+	kbFrustumCuller() : m_NumBounds(0) { }
+
+	void Reset();
+
+	u32 AddBounds(const Vec3& center, const Vec3& extents, const float radius);
+	u32 NumBounds() const { return m_NumBounds; }
+	void GetBounds(const u32 idx, Vec3& outCenter, Vec3& outExtents) const {
+		outCenter.set(m_CenterX[idx], m_CenterY[idx], m_CenterZ[idx]);
+		outExtents.set(m_ExtentX[idx], m_ExtentY[idx], m_ExtentZ[idx]);
+	}
+
+	/// Appends the indices of entries that intersect the frustum to outVisibleIndices
+	kbCullStats_t Cull(const Mat4& viewProjMatrix, std::vector<u32>& outVisibleIndices) const;
+	kbCullStats_t Cull(const Plane3d frustumPlanes[6], std::vector<u32>& outVisibleIndices) const;
+
+	/// Planes face outward, matching Mat4::*_clip_plane()
+	static void ExtractFrustumPlanes(const Mat4& viewProjMatrix, Plane3d outPlanes[6]);
+
+private:
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+	std::vector<float> m_Radius;
+	u32 m_NumBounds;
+};
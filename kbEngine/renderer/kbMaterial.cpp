@@ -2,9 +2,15 @@
 ///
 /// 2016-2025 blk 1.0
 
+#include <algorithm>
 #include <fstream>
+#include <filesystem>
+#include <sstream>
 #include <Wincodec.h>
 #include "blk_core.h"
+#include "blk_console.h"
+#include "blk_file_system.h"
+#include "blk_cache.h"
 #include "kbRenderer_defs.h"
 #include "kbRenderer.h"
 #include "DX11/kbRenderer_DX11.h"	//	TODO HACK
@@ -38,133 +44,6 @@ private:
 	T* _pointer;
 };
 
-struct WICTranslate {
-	GUID wic;
-	DXGI_FORMAT format;
-};
-
-static WICTranslate g_WICFormats[] = {
-	{ GUID_WICPixelFormat128bppRGBAFloat,       DXGI_FORMAT_R32G32B32A32_FLOAT },
-
-	{ GUID_WICPixelFormat64bppRGBAHalf,         DXGI_FORMAT_R16G16B16A16_FLOAT },
-	{ GUID_WICPixelFormat64bppRGBA,             DXGI_FORMAT_R16G16B16A16_UNORM },
-
-	{ GUID_WICPixelFormat32bppRGBA,             DXGI_FORMAT_R8G8B8A8_UNORM },
-	{ GUID_WICPixelFormat32bppBGRA,             DXGI_FORMAT_B8G8R8A8_UNORM }, // DXGI 1.1
-	{ GUID_WICPixelFormat32bppBGR,              DXGI_FORMAT_B8G8R8X8_UNORM }, // DXGI 1.1
-
-	{ GUID_WICPixelFormat32bppRGBA1010102XR,    DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM }, // DXGI 1.1
-	{ GUID_WICPixelFormat32bppRGBA1010102,      DXGI_FORMAT_R10G10B10A2_UNORM },
-	{ GUID_WICPixelFormat32bppRGBE,             DXGI_FORMAT_R9G9B9E5_SHAREDEXP },
-
-#ifdef DXGI_1_2_FORMATS
-
-	{ GUID_WICPixelFormat16bppBGRA5551,         DXGI_FORMAT_B5G5R5A1_UNORM },
-	{ GUID_WICPixelFormat16bppBGR565,           DXGI_FORMAT_B5G6R5_UNORM },
-
-#endif // DXGI_1_2_FORMATS
-
-	{ GUID_WICPixelFormat32bppGrayFloat,        DXGI_FORMAT_R32_FLOAT },
-	{ GUID_WICPixelFormat16bppGrayHalf,         DXGI_FORMAT_R16_FLOAT },
-	{ GUID_WICPixelFormat16bppGray,             DXGI_FORMAT_R16_UNORM },
-	{ GUID_WICPixelFormat8bppGray,              DXGI_FORMAT_R8_UNORM },
-
-	{ GUID_WICPixelFormat8bppAlpha,             DXGI_FORMAT_A8_UNORM },
-
-#if (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)
-	{ GUID_WICPixelFormat96bppRGBFloat,         DXGI_FORMAT_R32G32B32_FLOAT },
-#endif
-};
-
-//-------------------------------------------------------------------------------------
-// WIC Pixel Format nearest conversion table
-//-------------------------------------------------------------------------------------
-struct WICConvert {
-	GUID source;
-	GUID target;
-};
-
-static WICConvert g_WICConvert[] = {
-	// Note target GUID in this conversion table must be one of those directly supported formats (above).
-
-	{ GUID_WICPixelFormatBlackWhite,            GUID_WICPixelFormat8bppGray }, // DXGI_FORMAT_R8_UNORM
-
-	{ GUID_WICPixelFormat1bppIndexed,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat2bppIndexed,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat4bppIndexed,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat8bppIndexed,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-
-	{ GUID_WICPixelFormat2bppGray,              GUID_WICPixelFormat8bppGray }, // DXGI_FORMAT_R8_UNORM 
-	{ GUID_WICPixelFormat4bppGray,              GUID_WICPixelFormat8bppGray }, // DXGI_FORMAT_R8_UNORM 
-
-	{ GUID_WICPixelFormat16bppGrayFixedPoint,   GUID_WICPixelFormat16bppGrayHalf }, // DXGI_FORMAT_R16_FLOAT 
-	{ GUID_WICPixelFormat32bppGrayFixedPoint,   GUID_WICPixelFormat32bppGrayFloat }, // DXGI_FORMAT_R32_FLOAT 
-
-#ifdef DXGI_1_2_FORMATS
-
-	{ GUID_WICPixelFormat16bppBGR555,           GUID_WICPixelFormat16bppBGRA5551 }, // DXGI_FORMAT_B5G5R5A1_UNORM
-
-#else
-
-	{ GUID_WICPixelFormat16bppBGR555,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM
-	{ GUID_WICPixelFormat16bppBGRA5551,         GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM
-	{ GUID_WICPixelFormat16bppBGR565,           GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM
-
-#endif // DXGI_1_2_FORMATS
-
-	{ GUID_WICPixelFormat32bppBGR101010,        GUID_WICPixelFormat32bppRGBA1010102 }, // DXGI_FORMAT_R10G10B10A2_UNORM
-
-	{ GUID_WICPixelFormat24bppBGR,              GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat24bppRGB,              GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat32bppPBGRA,            GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat32bppPRGBA,            GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-
-	{ GUID_WICPixelFormat48bppRGB,              GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat48bppBGR,              GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat64bppBGRA,             GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat64bppPRGBA,            GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat64bppPBGRA,            GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-
-	{ GUID_WICPixelFormat48bppRGBFixedPoint,    GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat48bppBGRFixedPoint,    GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat64bppRGBAFixedPoint,   GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat64bppBGRAFixedPoint,   GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat64bppRGBFixedPoint,    GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat64bppRGBHalf,          GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-	{ GUID_WICPixelFormat48bppRGBHalf,          GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-
-	{ GUID_WICPixelFormat96bppRGBFixedPoint,    GUID_WICPixelFormat128bppRGBAFloat }, // DXGI_FORMAT_R32G32B32A32_FLOAT 
-	{ GUID_WICPixelFormat128bppPRGBAFloat,      GUID_WICPixelFormat128bppRGBAFloat }, // DXGI_FORMAT_R32G32B32A32_FLOAT 
-	{ GUID_WICPixelFormat128bppRGBFloat,        GUID_WICPixelFormat128bppRGBAFloat }, // DXGI_FORMAT_R32G32B32A32_FLOAT 
-	{ GUID_WICPixelFormat128bppRGBAFixedPoint,  GUID_WICPixelFormat128bppRGBAFloat }, // DXGI_FORMAT_R32G32B32A32_FLOAT 
-	{ GUID_WICPixelFormat128bppRGBFixedPoint,   GUID_WICPixelFormat128bppRGBAFloat }, // DXGI_FORMAT_R32G32B32A32_FLOAT 
-
-	{ GUID_WICPixelFormat32bppCMYK,             GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM 
-	{ GUID_WICPixelFormat64bppCMYK,             GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat40bppCMYKAlpha,        GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat80bppCMYKAlpha,        GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-
-#if (_WIN32_WINNT >= 0x0602 /*_WIN32_WINNT_WIN8*/)
-	{ GUID_WICPixelFormat32bppRGB,              GUID_WICPixelFormat32bppRGBA }, // DXGI_FORMAT_R8G8B8A8_UNORM
-	{ GUID_WICPixelFormat64bppRGB,              GUID_WICPixelFormat64bppRGBA }, // DXGI_FORMAT_R16G16B16A16_UNORM
-	{ GUID_WICPixelFormat64bppPRGBAHalf,        GUID_WICPixelFormat64bppRGBAHalf }, // DXGI_FORMAT_R16G16B16A16_FLOAT 
-#endif
-
-	// We don't support n-channel formats
-};
-
-//---------------------------------------------------------------------------------
-static DXGI_FORMAT _WICToDXGI(const GUID& guid) {
-
-	for (size_t i = 0; i < _countof(g_WICFormats); ++i) {
-		if (memcmp(&g_WICFormats[i].wic, &guid, sizeof(GUID)) == 0) {
-			return g_WICFormats[i].format;
-		}
-	}
-
-	return DXGI_FORMAT_UNKNOWN;
-}
-
 static IWICImagingFactory* _GetWIC() {
 	static IWICImagingFactory* s_Factory = nullptr;
 
@@ -188,275 +67,122 @@ static IWICImagingFactory* _GetWIC() {
 	return s_Factory;
 }
 
-//---------------------------------------------------------------------------------
-static size_t _WICBitsPerPixel(REFGUID targetGuid) {
-	IWICImagingFactory* const pWIC = _GetWIC();
-	if (pWIC == nullptr) {
-		return 0;
-	}
-
-	ScopedObject<IWICComponentInfo> cinfo;
-	if (FAILED(pWIC->CreateComponentInfo(targetGuid, &cinfo))) {
-		return 0;
-	}
-
-	WICComponentType type;
-	if (FAILED(cinfo->GetComponentType(&type))) {
-		return 0;
-	}
-
-	if (type != WICPixelFormat) {
-		return 0;
-	}
-
-	ScopedObject<IWICPixelFormatInfo> pfinfo;
-	if (FAILED(cinfo->QueryInterface(__uuidof(IWICPixelFormatInfo), reinterpret_cast<void**>(&pfinfo)))) {
-		return 0;
-	}
-
-	UINT bpp;
-	if (FAILED(pfinfo->GetBitsPerPixel(&bpp))) {
-		return 0;
-	}
-
-	return bpp;
-}
-
-
-static HRESULT CreateTextureFromWIC(IWICBitmapFrameDecode* const frame,
-									 ID3D11Resource** texture,
-									 ID3D11ShaderResourceView** textureView,
-									 size_t maxsize,
-									 const kbString& fileName,
-									 std::unique_ptr<uint8_t[]>& temp,
-									 UINT& twidth,
-									 UINT& theight) {
-
-	twidth = 0;
-	theight = 0;
-
-	UINT width, height;
-	HRESULT hr = frame->GetSize(&width, &height);
-	if (FAILED(hr)) {
-		return hr;
-	}
+kbConsoleVariable g_TextureCache("texturecache", true, kbConsoleVariable::Console_Bool, "Load textures from their cooked copies in ./cache/, cooking them again when the source changes.", "");
+kbConsoleVariable g_TextureCookFormat("texturecookformat", 0, kbConsoleVariable::Console_Int, "Format textures are cooked to.  0 picks one per texture, 1 is BC1, 2 BC3, 3 BC5, 4 BC7 and 5 uncompressed.  A texture's .kbtex file overrides it.", "");
+kbConsoleVariable g_TextureCookHQ("texturecookhq", false, kbConsoleVariable::Console_Bool, "Cook textures with the slower, higher quality encoders.  Picks BC7 unless texturecookformat says otherwise.", "");
+
+/// kbTextureCacheHeader_t - Followed by the kbCookedTexture
+struct kbTextureCacheHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u64 m_SourceSize;
+	u64 m_SourceTime;
+	u32 m_CookFormat;			// kbTexture::GetCookFormat() and "texturecookhq" when it was cooked
+	u32 m_bHighQuality;
+};
 
-	blk::error_check(width > 0 && height > 0, "CreateTextureFromWIC() - Invalid width and/or height %d x %d", width, height);
+static const u32 g_TextureCacheMagic = 0x58544b42;		// "BKTX"
+static const u32 g_TextureCacheVersion = 2;
 
-	if (maxsize == 0) {
-		maxsize = 16384;
-	}
+/// kbWICSourceFormat_t - Sources with more than 8 bits a channel are decoded to m_Target and cooked uncompressed as m_Format
+struct kbWICSourceFormat_t {
+	const GUID& m_Source;
+	const GUID& m_Target;
+	kbTextureFormat_t m_Format;
+};
 
-	if (width > maxsize || height > maxsize) {
-		const float aspectRatio = static_cast<float>(height) / static_cast<float>(width);
-		if (width > height) {
-			twidth = static_cast<UINT>(maxsize);
-			theight = static_cast<UINT>(static_cast<float>(maxsize) * aspectRatio);
-		} else {
-			theight = static_cast<UINT>(maxsize);
-			twidth = static_cast<UINT>(static_cast<float>(maxsize) / aspectRatio);
-		}
-		blk::error_check(twidth <= maxsize && theight <= maxsize, "CreateTextureFromWIC() - Invalid width and/or height %d x %d", width, height);
-	} else {
-		twidth = width;
-		theight = height;
-	}
+static const kbWICSourceFormat_t g_WICWideFormats[] = {
+	{ GUID_WICPixelFormat128bppRGBAFloat, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat128bppPRGBAFloat, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat128bppRGBFloat, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat128bppRGBAFixedPoint, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat128bppRGBFixedPoint, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat96bppRGBFloat, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat96bppRGBFixedPoint, GUID_WICPixelFormat128bppRGBAFloat, TextureFormat_RGBA32F },
+	{ GUID_WICPixelFormat64bppRGBAHalf, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat64bppRGBHalf, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat48bppRGBHalf, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat64bppRGBAFixedPoint, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat64bppRGBFixedPoint, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat48bppRGBFixedPoint, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat32bppRGBE, GUID_WICPixelFormat64bppRGBAHalf, TextureFormat_RGBA16F },
+	{ GUID_WICPixelFormat64bppRGBA, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat64bppBGRA, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat64bppPRGBA, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat64bppPBGRA, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat64bppRGB, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat48bppRGB, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat48bppBGR, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat32bppRGBA1010102, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat64bppCMYK, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat80bppCMYKAlpha, GUID_WICPixelFormat64bppRGBA, TextureFormat_RGBA16 },
+	{ GUID_WICPixelFormat16bppGray, GUID_WICPixelFormat16bppGray, TextureFormat_R16 },
+	{ GUID_WICPixelFormat16bppGrayHalf, GUID_WICPixelFormat16bppGrayHalf, TextureFormat_R16F },
+	{ GUID_WICPixelFormat16bppGrayFixedPoint, GUID_WICPixelFormat16bppGrayHalf, TextureFormat_R16F },
+	{ GUID_WICPixelFormat32bppGrayFloat, GUID_WICPixelFormat32bppGrayFloat, TextureFormat_R32F },
+	{ GUID_WICPixelFormat32bppGrayFixedPoint, GUID_WICPixelFormat32bppGrayFloat, TextureFormat_R32F },
+};
 
-	// Determine format
-	WICPixelFormatGUID pixelFormat;
-	hr = frame->GetPixelFormat(&pixelFormat);
-	if (FAILED(hr)) {
-		return hr;
+/// kbTexture::GetCookFormat - TextureFormat_Num lets the cooker pick.  A "format <name>" line in <texture>.kbtex overrides "texturecookformat"
+kbTextureFormat_t kbTexture::GetCookFormat() const {
+	// cpu_texture() and the software renderer read RGBA8, and the GPU copy has to match it
+	if (m_is_cpu_texture) {
+		return TextureFormat_RGBA8;
 	}
 
-	WICPixelFormatGUID convertGUID;
-	memcpy(&convertGUID, &pixelFormat, sizeof(WICPixelFormatGUID));
-
-	size_t bpp = 0;
-
-	DXGI_FORMAT format = _WICToDXGI(pixelFormat);
-	if (format == DXGI_FORMAT_UNKNOWN) {
-		for (size_t i = 0; i < _countof(g_WICConvert); ++i) {
-			if (memcmp(&g_WICConvert[i].source, &pixelFormat, sizeof(WICPixelFormatGUID)) == 0) {
-				memcpy(&convertGUID, &g_WICConvert[i].target, sizeof(WICPixelFormatGUID));
-
-				format = _WICToDXGI(g_WICConvert[i].target);
-				blk::error_check(format != DXGI_FORMAT_UNKNOWN, "CreateTextureFromWIC() - Unkown format");
-				bpp = _WICBitsPerPixel(convertGUID);
-				break;
+	kbFileData settingsFile;
+	if (g_FileSystem.ReadFile(GetFullFileName() + ".kbtex", settingsFile)) {
+		static const struct {
+			const char* m_pName;
+			kbTextureFormat_t m_Format;
+		} formatNames[] = { { "auto", TextureFormat_Num }, { "bc1", TextureFormat_BC1 }, { "bc3", TextureFormat_BC3 }, { "bc5", TextureFormat_BC5 },
+							{ "bc7", TextureFormat_BC7 }, { "uncompressed", TextureFormat_RGBA8 }, { "rgba8", TextureFormat_RGBA8 } };
+
+		std::istringstream settings(std::string((const char*)settingsFile.GetData(), settingsFile.GetSize()));
+		std::string key, value;
+		while (settings >> key >> value) {
+			if (key != "format") {
+				continue;
 			}
-		}
 
-		if (format == DXGI_FORMAT_UNKNOWN) {
-			return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-		}
-	} else {
-		bpp = _WICBitsPerPixel(pixelFormat);
-	}
-
-	if (bpp == 0) {
-		return E_FAIL;
-	}
-
-	// Verify our target format is supported by the current device
-	// (handles WDDM 1.0 or WDDM 1.1 device driver cases as well as DirectX 11.0 Runtime without 16bpp format support)
-	UINT support = 0;
-	hr = g_pD3DDevice->CheckFormatSupport(format, &support);
-	if (FAILED(hr) || !(support & D3D11_FORMAT_SUPPORT_TEXTURE2D)) {
-		// Fallback to RGBA 32-bit format which is supported by all devices
-		memcpy(&convertGUID, &GUID_WICPixelFormat32bppRGBA, sizeof(WICPixelFormatGUID));
-		format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		bpp = 32;
-	}
-
-	// Allocate temporary memory for image
-	size_t rowPitch = (twidth * bpp + 7) / 8;
-	size_t imageSize = rowPitch * theight;
-
-	temp = std::unique_ptr<uint8_t[]>(new uint8_t[imageSize]);
-
-	// Load image data
-	if (memcmp(&convertGUID, &pixelFormat, sizeof(GUID)) == 0 && twidth == width && theight == height) {
-		// No format conversion or resize needed
-		hr = frame->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
-		if (FAILED(hr)) {
-			return hr;
-		}
-	} else if (twidth != width || theight != height) {
-		// Resize
-		IWICImagingFactory* const pWIC = _GetWIC();
-		if (pWIC == nullptr) {
-			return E_NOINTERFACE;
-		}
-
-		ScopedObject<IWICBitmapScaler> scaler;
-		hr = pWIC->CreateBitmapScaler(&scaler);
-		if (FAILED(hr)) {
-			return hr;
-		}
-
-		hr = scaler->Initialize(frame, twidth, theight, WICBitmapInterpolationModeFant);
-		if (FAILED(hr)) {
-			return hr;
-		}
-
-		WICPixelFormatGUID pfScaler;
-		hr = scaler->GetPixelFormat(&pfScaler);
-		if (FAILED(hr)) {
-			return hr;
-		}
-
-		if (memcmp(&convertGUID, &pfScaler, sizeof(GUID)) == 0) {
-			// No format conversion needed
-			hr = scaler->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
-			if (FAILED(hr)) {
-				return hr;
-			}
-		} else {
-			ScopedObject<IWICFormatConverter> FC;
-			hr = pWIC->CreateFormatConverter(&FC);
-			if (FAILED(hr)) {
-				return hr;
-			}
-
-			hr = FC->Initialize(scaler.Get(), convertGUID, WICBitmapDitherTypeErrorDiffusion, 0, 0, WICBitmapPaletteTypeCustom);
-			if (FAILED(hr)) {
-				return hr;
-			}
-
-			hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
-			if (FAILED(hr)) {
-				return hr;
+			std::transform(value.begin(), value.end(), value.begin(), [](const unsigned char c) { return (char)tolower(c); });
+			for (u32 i = 0; i < _countof(formatNames); i++) {
+				if (value == formatNames[i].m_pName) {
+					return formatNames[i].m_Format;
+				}
 			}
-		}
-	} else {
-		// Format conversion but no resize
-		IWICImagingFactory* const pWIC = _GetWIC();
-		if (pWIC == nullptr) {
-			return E_NOINTERFACE;
-		}
-
-		ScopedObject<IWICFormatConverter> FC;
-		hr = pWIC->CreateFormatConverter(&FC);
-		if (FAILED(hr)) {
-			return hr;
-		}
-
-		hr = FC->Initialize(frame, convertGUID, WICBitmapDitherTypeErrorDiffusion, 0, 0, WICBitmapPaletteTypeCustom);
-		if (FAILED(hr)) {
-			return hr;
-		}
-
-		hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
-		if (FAILED(hr)) {
-			return hr;
+			blk::warn("kbTexture::GetCookFormat() - Unknown format \"%s\" in %s.kbtex", value.c_str(), GetFullFileName().c_str());
 		}
 	}
 
-	// See if format is supported for auto-gen mipmaps (varies by feature level)
-	bool autogen = false;
-	if (textureView != nullptr) {
-		UINT fmtSupport = 0;
-		hr = g_pD3DDevice->CheckFormatSupport(format, &fmtSupport);
-		if (SUCCEEDED(hr) && (fmtSupport & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN)) {
-			autogen = true;
-		}
-	}
+	static const kbTextureFormat_t formats[] = { TextureFormat_Num, TextureFormat_BC1, TextureFormat_BC3, TextureFormat_BC5, TextureFormat_BC7, TextureFormat_RGBA8 };
 
-	// Create texture
-	D3D11_TEXTURE2D_DESC desc = {};
-	desc.Width = twidth;
-	desc.Height = theight;
-	desc.MipLevels = (autogen) ? 0 : 1;
-	desc.ArraySize = 1;
-	desc.Format = format;
-	desc.SampleDesc.Count = 1;
-	desc.SampleDesc.Quality = 0;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = (autogen) ? (D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET) : (D3D11_BIND_SHADER_RESOURCE);
-	desc.CPUAccessFlags = 0;
-	desc.MiscFlags = (autogen) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
-
-	D3D11_SUBRESOURCE_DATA initData = {};
-	initData.pSysMem = temp.get();
-	initData.SysMemPitch = static_cast<UINT>(rowPitch);
-	initData.SysMemSlicePitch = static_cast<UINT>(imageSize);
-
-	ID3D11Texture2D* tex = nullptr;
-	hr = g_pD3DDevice->CreateTexture2D(&desc, (autogen) ? nullptr : &initData, &tex);
-	if (SUCCEEDED(hr) && tex != nullptr) {
-		if (textureView != nullptr) {
-			D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc;
-			memset(&SRVDesc, 0, sizeof(SRVDesc));
-			SRVDesc.Format = format;
-			SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-			SRVDesc.Texture2D.MipLevels = (autogen) ? -1 : 1;
-
-			hr = g_pD3DDevice->CreateShaderResourceView(tex, &SRVDesc, textureView);
-			if (FAILED(hr)) {
-				tex->Release();
-				return hr;
-			}
-
-			if (autogen == true) {
-				g_pImmediateContext->UpdateSubresource(tex, 0, nullptr, temp.get(), static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize));
-				g_pImmediateContext->GenerateMips(*textureView);
-			}
-		}
+	const int formatIdx = g_TextureCookFormat.GetInt();
+	return (formatIdx >= 0 && formatIdx < (int)_countof(formats)) ? (formats[formatIdx]) : (TextureFormat_Num);
+}
 
-		if (texture != nullptr) {
-			*texture = tex;
-		} else {
-#if defined(_DEBUG) || defined(PROFILE)
-			tex->SetPrivateData(WKPDID_D3DDebugObjectName,
-								 static_cast<UINT>(fileName.stl_str().length()),
-								 fileName.c_str());
-#endif
-			tex->Release();
-		}
+/// GetDXGIFormat
+static DXGI_FORMAT GetDXGIFormat(const kbTextureFormat_t format) {
+	switch (format) {
+		case TextureFormat_BC1: return DXGI_FORMAT_BC1_UNORM;
+		case TextureFormat_BC3: return DXGI_FORMAT_BC3_UNORM;
+		case TextureFormat_BC5: return DXGI_FORMAT_BC5_UNORM;
+		case TextureFormat_BC7: return DXGI_FORMAT_BC7_UNORM;
+		case TextureFormat_RGBA16: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case TextureFormat_RGBA16F: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+		case TextureFormat_RGBA32F: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case TextureFormat_R16: return DXGI_FORMAT_R16_UNORM;
+		case TextureFormat_R16F: return DXGI_FORMAT_R16_FLOAT;
+		case TextureFormat_R32F: return DXGI_FORMAT_R32_FLOAT;
+		default: return DXGI_FORMAT_R8G8B8A8_UNORM;
 	}
+}
 
-	return hr;
+/// IsFormatSupported - BC7 needs feature level 11
+static bool IsFormatSupported(const kbTextureFormat_t format) {
+	UINT support = 0;
+	const HRESULT hr = g_pD3DDevice->CheckFormatSupport(GetDXGIFormat(format), &support);
+	return SUCCEEDED(hr) && (support & D3D11_FORMAT_SUPPORT_TEXTURE2D) != 0;
 }
 
 /// kbTexture::kbTexture
@@ -486,7 +212,7 @@ kbTexture::kbTexture(const kbString& fileName) :
 	m_FullFileName = fileName.stl_str();
 	m_FullName = kbString(m_FullFileName);
 
-	Load_Internal();
+	Load();
 }
 
 /// kbTexture::load_internal
@@ -501,16 +227,113 @@ bool kbTexture::load_internal() {
 		return false;
 	}
 
+	// Cook again when the per texture settings change
+	g_ResourceManager.AddDependency(this, GetFullFileName() + ".kbtex");
+
+	const bool bLoaded = (g_TextureCache.GetBool() && ReadCache()) || CookSource();
+	if (bLoaded == false) {
+		return false;
+	}
+
+	m_width = m_CookedTexture.GetWidth();
+	m_height = m_CookedTexture.GetHeight();
+
+	const std::vector<byte>& cpuCopy = m_CookedTexture.GetCPUCopy();
+	if (m_is_cpu_texture && cpuCopy.empty() == false) {
+		m_pCPUTexture.reset(new uint8_t[cpuCopy.size()]);
+		memcpy(m_pCPUTexture.get(), cpuCopy.data(), cpuCopy.size());
+	} else {
+		m_pCPUTexture.reset();
+	}
+	return true;
+}
+
+/// kbTexture::Upload_Internal
+bool kbTexture::Upload_Internal() {
+	if (m_CookedTexture.IsValid() == false) {
+		return false;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = m_CookedTexture.GetWidth();
+	desc.Height = m_CookedTexture.GetHeight();
+	desc.MipLevels = (UINT)m_CookedTexture.NumMips();
+	desc.ArraySize = 1;
+	desc.Format = GetDXGIFormat(m_CookedTexture.GetFormat());
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(m_CookedTexture.NumMips());
+	for (size_t i = 0; i < initData.size(); i++) {
+		const kbCookedTexture::mip_t& mip = m_CookedTexture.GetMip(i);
+		initData[i].pSysMem = m_CookedTexture.GetMipData(i);
+		initData[i].SysMemPitch = mip.m_RowPitch;
+		initData[i].SysMemSlicePitch = mip.m_Size;
+	}
+
+	ID3D11Texture2D* pTexture = nullptr;
+	HRESULT hr = g_pD3DDevice->CreateTexture2D(&desc, initData.data(), &pTexture);
+	if (SUCCEEDED(hr)) {
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+		hr = g_pD3DDevice->CreateShaderResourceView(pTexture, &srvDesc, &m_pGPUTexture);
+
+#if defined(_DEBUG) || defined(PROFILE)
+		pTexture->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)GetFullFileName().length(), GetFullFileName().c_str());
+#endif
+		pTexture->Release();
+	}
+
+	m_CookedTexture.Reset();
+
+	if (FAILED(hr)) {
+		blk::warn("kbTexture::Upload_Internal() - Failed to create %s", GetFullFileName().c_str());
+		return false;
+	}
+	return true;
+}
+
+/// kbTexture::GetStreamFileName
+std::string kbTexture::GetStreamFileName() const {
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+
+	return (g_TextureCache.GetBool() && g_FileSystem.FileExists(cacheFileName)) ? (cacheFileName) : (GetFullFileName());
+}
+
+/// kbTexture::CookSource
+bool kbTexture::CookSource() {
 	IWICImagingFactory* const pWIC = _GetWIC();
 	if (pWIC == nullptr) {
 		return false;
 	}
 
-	// Initialize WIC
-	const std::wstring wideName = std::wstring(GetFullFileName().begin(), GetFullFileName().end());
+	// Initialize WIC.  The file data has to outlive the decoder, so it's declared first
+	kbFileData textureFile;
+	const kbFileData* pTextureData = GetStreamedData(GetFullFileName());
+	if (pTextureData == nullptr) {
+		if (g_FileSystem.ReadFile(GetFullFileName(), textureFile) == false) {
+			return false;
+		}
+		pTextureData = &textureFile;
+	}
+
+	ScopedObject<IWICStream> stream;
+	HRESULT hr = pWIC->CreateStream(&stream);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	hr = stream->InitializeFromMemory((BYTE*)pTextureData->GetData(), (DWORD)pTextureData->GetSize());
+	if (FAILED(hr)) {
+		return false;
+	}
 
 	ScopedObject<IWICBitmapDecoder> decoder;
-	HRESULT hr = pWIC->CreateDecoderFromFilename(wideName.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+	hr = pWIC->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
 	if (FAILED(hr)) {
 		return false;
 	}
@@ -521,25 +344,162 @@ bool kbTexture::load_internal() {
 		return false;
 	}
 
-	hr = CreateTextureFromWIC(frame.Get(), nullptr, &m_pGPUTexture, 0, GetFullName(), m_pCPUTexture, m_width, m_height);
+	UINT width = 0;
+	UINT height = 0;
+	hr = frame->GetSize(&width, &height);
+	if (FAILED(hr) || width == 0 || height == 0) {
+		return false;
+	}
+
+	// Scale down anything the device can't hold
+	IWICBitmapSource* pSource = frame.Get();
+	ScopedObject<IWICBitmapScaler> scaler;
+	const UINT maxSize = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+	if (width > maxSize || height > maxSize) {
+		const float scale = (float)maxSize / std::max(width, height);
+		width = std::max((UINT)(width * scale), 1u);
+		height = std::max((UINT)(height * scale), 1u);
+
+		hr = pWIC->CreateBitmapScaler(&scaler);
+		if (FAILED(hr) || FAILED(scaler->Initialize(frame.Get(), width, height, WICBitmapInterpolationModeFant))) {
+			return false;
+		}
+		pSource = scaler.Get();
+	}
+
+	ScopedObject<IWICFormatConverter> converter;
+	hr = pWIC->CreateFormatConverter(&converter);
 	if (FAILED(hr)) {
 		return false;
 	}
 
-	if (m_is_cpu_texture == false) {
-		m_pCPUTexture.reset();
+	// Sources with more than 8 bits a channel keep their precision.  Everything else, and anything read on the CPU, is RGBA8
+	WICPixelFormatGUID sourceFormat;
+	hr = frame->GetPixelFormat(&sourceFormat);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	const GUID* pTargetFormat = &GUID_WICPixelFormat32bppRGBA;
+	kbTextureFormat_t pixelFormat = TextureFormat_RGBA8;
+	for (u32 i = 0; i < _countof(g_WICWideFormats) && m_is_cpu_texture == false; i++) {
+		if (IsEqualGUID(sourceFormat, g_WICWideFormats[i].m_Source) == false) {
+			continue;
+		}
+
+		BOOL bCanConvert = FALSE;
+		if (IsFormatSupported(g_WICWideFormats[i].m_Format) && SUCCEEDED(converter->CanConvert(sourceFormat, g_WICWideFormats[i].m_Target, &bCanConvert)) && bCanConvert) {
+			pTargetFormat = &g_WICWideFormats[i].m_Target;
+			pixelFormat = g_WICWideFormats[i].m_Format;
+		}
+		break;
+	}
+
+	hr = converter->Initialize(pSource, *pTargetFormat, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	const u32 pixelSize = kbCookedTexture::GetPixelSize(pixelFormat);
+	std::vector<byte> pixels((size_t)width * height * pixelSize);
+	hr = converter->CopyPixels(nullptr, width * pixelSize, (UINT)pixels.size(), pixels.data());
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	kbTextureCookSettings_t settings;
+	settings.m_bHighQuality = g_TextureCookHQ.GetBool();
+	settings.m_bKeepCPUCopy = m_is_cpu_texture;
+	settings.m_Format = GetCookFormat();
+	if (settings.m_Format == TextureFormat_Num) {
+		settings.m_Format = kbCookedTexture::ChooseFormat(pixels.data(), width, height, pixelFormat, settings.m_bHighQuality);
+	}
+
+	if (IsFormatSupported(settings.m_Format) == false) {
+		settings.m_Format = pixelFormat;
+	}
+
+	kbTimer cookTimer;
+	if (m_CookedTexture.Cook(pixels.data(), width, height, pixelFormat, settings) == false) {
+		return false;
+	}
+	blk::log("Cooked %s to %s with %u mips in %.2f ms", GetFullFileName().c_str(), kbCookedTexture::GetFormatName(m_CookedTexture.GetFormat()), (u32)m_CookedTexture.NumMips(), cookTimer.TimeElapsedMS());
+
+	if (g_TextureCache.GetBool()) {
+		WriteCache();
 	}
-	// 
 	return true;
 }
 
+/// kbTexture::ReadCache
+bool kbTexture::ReadCache() {
+	u64 sourceSize = 0;
+	u64 sourceTime = 0;
+	if (GetSourceStamp(GetFullFileName(), sourceSize, sourceTime) == false) {
+		return false;
+	}
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	kbFileData cacheFile;
+	const kbFileData* pCacheData = GetStreamedData(cacheFileName);
+	if (pCacheData == nullptr) {
+		if (g_FileSystem.ReadFile(cacheFileName, cacheFile) == false) {
+			return false;
+		}
+		pCacheData = &cacheFile;
+	}
+
+	kbCacheReader reader(pCacheData->GetData(), pCacheData->GetSize());
+	kbTextureCacheHeader_t header;
+	if (reader.Read(header) == false || header.m_Magic != g_TextureCacheMagic || header.m_Version != g_TextureCacheVersion ||
+		header.m_SourceSize != sourceSize || header.m_SourceTime != sourceTime ||
+		header.m_CookFormat != (u32)GetCookFormat() || header.m_bHighQuality != (u32)g_TextureCookHQ.GetBool()) {
+		return false;
+	}
+
+	if (m_CookedTexture.Read(reader) == false) {
+		blk::warn("kbTexture::ReadCache() - %s is corrupt.  Cooking %s again", cacheFileName.c_str(), GetFullFileName().c_str());
+		return false;
+	}
+
+	// Cooked without the CPU copy this texture now needs, or in a format this device can't sample
+	if ((m_is_cpu_texture && m_CookedTexture.GetCPUCopy().empty()) || IsFormatSupported(m_CookedTexture.GetFormat()) == false) {
+		m_CookedTexture.Reset();
+		return false;
+	}
+	return true;
+}
+
+/// kbTexture::WriteCache
+void kbTexture::WriteCache() const {
+	kbTextureCacheHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if (GetSourceStamp(GetFullFileName(), header.m_SourceSize, header.m_SourceTime) == false) {
+		return;
+	}
+
+	header.m_Magic = g_TextureCacheMagic;
+	header.m_Version = g_TextureCacheVersion;
+	header.m_CookFormat = (u32)GetCookFormat();
+	header.m_bHighQuality = g_TextureCookHQ.GetBool();
+
+	kbCacheWriter writer;
+	writer.Write(header);
+	m_CookedTexture.Write(writer);
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	if (writer.Save(cacheFileName) == false) {
+		blk::warn("kbTexture::WriteCache() - Failed to write %s", cacheFileName.c_str());
+	}
+}
+
 /// kbShader::cpu_texture
 const uint8_t* kbTexture::cpu_texture(unsigned int& width, unsigned int& height) {
 	if (m_is_cpu_texture == false) {
 
 		m_is_cpu_texture = true;
 		Release();
-		Load_Internal();
+		Load();
 	}
 
 	width = m_width;
@@ -548,11 +508,34 @@ const uint8_t* kbTexture::cpu_texture(unsigned int& width, unsigned int& height)
 	return m_pCPUTexture.get();
 }
 
+/// kbTexture::Release_Internal
+void kbTexture::Release_Internal() {
+	m_CookedTexture.Reset();
+}
+
 /// kbTexture::release_internal
 void kbTexture::release_internal() {
 	SAFE_RELEASE(m_pGPUTexture);
 }
 
+/// kbTexture::CreateStagingCopy
+kbResource* kbTexture::CreateStagingCopy() const {
+	kbTexture* const pStaging = new kbTexture();
+	pStaging->m_is_cpu_texture = m_is_cpu_texture;
+	return pStaging;
+}
+
+/// kbTexture::SwapStagedData
+void kbTexture::SwapStagedData(kbResource* const pStaged) {
+	kbTexture* const pTexture = (kbTexture*)pStaged;
+	std::swap(m_pGPUTexture, pTexture->m_pGPUTexture);
+	m_pCPUTexture.swap(pTexture->m_pCPUTexture);
+	std::swap(m_CookedTexture, pTexture->m_CookedTexture);
+	std::swap(m_width, pTexture->m_width);
+	std::swap(m_height, pTexture->m_height);
+	std::swap(m_texture_id, pTexture->m_texture_id);
+}
+
 /// kbShader::kbShader
 kbShader::kbShader() :
 	m_pVertexShader(nullptr),
@@ -595,157 +578,428 @@ kbShader::kbShader(const std::string& fileName) :
 	m_FullFileName = fileName;
 }
 
-std::unordered_map<std::string, kbColorWriteEnable> g_ColorWriteMap;
+/// GetColorWriteEnableFromName
 kbColorWriteEnable GetColorWriteEnableFromName(const std::string& name) {
-
-	if (g_ColorWriteMap.empty()) {
-		typedef std::pair<std::string, kbColorWriteEnable> colorWriteMapPair;
-
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_r", ColorWriteEnable_Red));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_rg", ColorWriteEnable_Red | ColorWriteEnable_Green));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_rgb", ColorWriteEnable_Red | ColorWriteEnable_Green | ColorWriteEnable_Blue));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_rgba", ColorWriteEnable_All));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_rb", ColorWriteEnable_Red | ColorWriteEnable_Blue));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_rba", ColorWriteEnable_Red | ColorWriteEnable_Blue | ColorWriteEnable_Alpha));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_ra", ColorWriteEnable_Red | ColorWriteEnable_Alpha));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_g", ColorWriteEnable_Green));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_gb", ColorWriteEnable_Green | ColorWriteEnable_Blue));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_gba", ColorWriteEnable_Green | ColorWriteEnable_Blue | ColorWriteEnable_Alpha));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_ga", ColorWriteEnable_Green | ColorWriteEnable_Alpha));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_b", ColorWriteEnable_Blue));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_ba", ColorWriteEnable_Blue | ColorWriteEnable_Alpha));
-		g_ColorWriteMap.insert(colorWriteMapPair("colorwriteenable_a", ColorWriteEnable_Alpha));
-	}
-
-	auto colorMapIt = g_ColorWriteMap.find(name);
-	if (colorMapIt != g_ColorWriteMap.end()) {
-		return colorMapIt->second;
+	// Shaders load on job threads, so these are built once by the first caller instead of into a shared map
+	static const std::pair<const char*, kbColorWriteEnable> colorWriteNames[] = {
+		{ "colorwriteenable_r", ColorWriteEnable_Red },
+		{ "colorwriteenable_rg", ColorWriteEnable_Red | ColorWriteEnable_Green },
+		{ "colorwriteenable_rgb", ColorWriteEnable_Red | ColorWriteEnable_Green | ColorWriteEnable_Blue },
+		{ "colorwriteenable_rgba", ColorWriteEnable_All },
+		{ "colorwriteenable_rb", ColorWriteEnable_Red | ColorWriteEnable_Blue },
+		{ "colorwriteenable_rba", ColorWriteEnable_Red | ColorWriteEnable_Blue | ColorWriteEnable_Alpha },
+		{ "colorwriteenable_ra", ColorWriteEnable_Red | ColorWriteEnable_Alpha },
+		{ "colorwriteenable_g", ColorWriteEnable_Green },
+		{ "colorwriteenable_gb", ColorWriteEnable_Green | ColorWriteEnable_Blue },
+		{ "colorwriteenable_gba", ColorWriteEnable_Green | ColorWriteEnable_Blue | ColorWriteEnable_Alpha },
+		{ "colorwriteenable_ga", ColorWriteEnable_Green | ColorWriteEnable_Alpha },
+		{ "colorwriteenable_b", ColorWriteEnable_Blue },
+		{ "colorwriteenable_ba", ColorWriteEnable_Blue | ColorWriteEnable_Alpha },
+		{ "colorwriteenable_a", ColorWriteEnable_Alpha },
+	};
+
+	for (size_t i = 0; i < _countof(colorWriteNames); i++) {
+		if (name == colorWriteNames[i].first) {
+			return colorWriteNames[i].second;
+		}
 	}
 
 	blk::warn("GetColorWriteEnableFromName() - Invalid value %s", name.c_str());
 	return ColorWriteEnable_All;
 }
 
-std::unordered_map<std::string, kbBlend> g_BlendMap;
+/// GetBlendFromName
 kbBlend GetBlendFromName(const std::string& name) {
-	if (g_BlendMap.empty()) {
-		typedef std::pair<std::string, kbBlend> blendMapPair;
-		g_BlendMap.insert(blendMapPair("blend_zero", Blend_Zero));
-		g_BlendMap.insert(blendMapPair("blend_one", Blend_One));
-		g_BlendMap.insert(blendMapPair("blend_srccolor", Blend_SrcColor));
-		g_BlendMap.insert(blendMapPair("blend_invsrccolor", Blend_InvSrcColor));
-		g_BlendMap.insert(blendMapPair("blend_srcalpha", Blend_SrcAlpha));
-		g_BlendMap.insert(blendMapPair("blend_invsrcalpha", Blend_InvSrcAlpha));
-		g_BlendMap.insert(blendMapPair("blend_dstalpha", Blend_DstAlpha));
-		g_BlendMap.insert(blendMapPair("blend_invdstalpha", Blend_InvDstAlpha));
-		g_BlendMap.insert(blendMapPair("blend_dstcolor", Blend_DstColor));
-		g_BlendMap.insert(blendMapPair("blend_invdstcolor", Blend_InvDstColor));
-	}
-
-	auto blendMapIt = g_BlendMap.find(name);
-	if (blendMapIt != g_BlendMap.end()) {
-		return blendMapIt->second;
+	static const std::pair<const char*, kbBlend> blendNames[] = {
+		{ "blend_zero", Blend_Zero },
+		{ "blend_one", Blend_One },
+		{ "blend_srccolor", Blend_SrcColor },
+		{ "blend_invsrccolor", Blend_InvSrcColor },
+		{ "blend_srcalpha", Blend_SrcAlpha },
+		{ "blend_invsrcalpha", Blend_InvSrcAlpha },
+		{ "blend_dstalpha", Blend_DstAlpha },
+		{ "blend_invdstalpha", Blend_InvDstAlpha },
+		{ "blend_dstcolor", Blend_DstColor },
+		{ "blend_invdstcolor", Blend_InvDstColor },
+	};
+
+	for (size_t i = 0; i < _countof(blendNames); i++) {
+		if (name == blendNames[i].first) {
+			return blendNames[i].second;
+		}
 	}
 
 	blk::warn("GetBlendFromName() - Invalid value %s", name.c_str());
 	return Blend_One;
 }
 
-std::unordered_map<std::string, kbBlendOp> g_BlendOpMap;
+/// GetBlendOpFromName
 kbBlendOp GetBlendOpFromName(std::string& name) {
-	if (g_BlendOpMap.empty()) {
-		typedef std::pair<std::string, kbBlendOp> blendOpMapPair;
-		g_BlendOpMap.insert(blendOpMapPair("blendop_add", BlendOp_Add));
-		g_BlendOpMap.insert(blendOpMapPair("blendop_subtract", BlendOp_Subtract));
-		g_BlendOpMap.insert(blendOpMapPair("blendop_max", BlendOp_Max));
-		g_BlendOpMap.insert(blendOpMapPair("blendop_min", BlendOp_Min));
-	}
-
-	auto blendOpMapIt = g_BlendOpMap.find(name);
-	if (blendOpMapIt != g_BlendOpMap.end()) {
-		return blendOpMapIt->second;
+	static const std::pair<const char*, kbBlendOp> blendOpNames[] = {
+		{ "blendop_add", BlendOp_Add },
+		{ "blendop_subtract", BlendOp_Subtract },
+		{ "blendop_max", BlendOp_Max },
+		{ "blendop_min", BlendOp_Min },
+	};
+
+	for (size_t i = 0; i < _countof(blendOpNames); i++) {
+		if (name == blendOpNames[i].first) {
+			return blendOpNames[i].second;
+		}
 	}
 
 	blk::warn("GetBlendOpFromName() - Invalid value %s", name.c_str());
 	return BlendOp_Add;
 }
 
-/// kbShader::Load_Internal
-bool kbShader::Load_Internal() {
-	if (g_pD3D11Renderer != nullptr) {		// HACK TODO
-		// Load File
-		std::ifstream shaderFile;
-		shaderFile.open(GetFullFileName().c_str(), std::fstream::in);
-		if (shaderFile.fail()) {
+/// ExpandShaderIncludes
+///
+/// Shaders are compiled from text without an include handler, so #include "file" lines are pasted in here.  Paths are
+/// relative to the including file, and each included file is added as a dependency so editing it reloads the shader
+static bool ExpandShaderIncludes(kbShader* const pShader, const std::string& fileName, std::string& shaderText, const int depth) {
+	static const int maxIncludeDepth = 16;
+	if (depth > maxIncludeDepth) {
+		blk::warn("ExpandShaderIncludes() - Includes in %s are nested more than %d deep", pShader->GetFullFileName().c_str(), maxIncludeDepth);
+		return false;
+	}
+
+	const size_t lastSlash = fileName.find_last_of("/\\");
+	const std::string directory = (lastSlash != std::string::npos) ? (fileName.substr(0, lastSlash + 1)) : ("");
+
+	// #line takes a string literal, so keep backslashes out of it
+	std::string lineFileName = fileName;
+	std::replace(lineFileName.begin(), lineFileName.end(), '\\', '/');
+
+	std::string expandedText;
+	size_t lineStart = 0;
+	int lineNum = 1;
+	while (lineStart < shaderText.size()) {
+		size_t lineEnd = shaderText.find('\n', lineStart);
+		lineEnd = (lineEnd != std::string::npos) ? (lineEnd + 1) : (shaderText.size());
+
+		const std::string_view line(&shaderText[lineStart], lineEnd - lineStart);
+		const size_t directiveStart = line.find_first_not_of(" \t");
+		if (directiveStart == std::string::npos || line.compare(directiveStart, 8, "#include") != 0) {
+			expandedText.append(line);
+			lineStart = lineEnd;
+			lineNum++;
+			continue;
+		}
+
+		const size_t nameStart = line.find('"', directiveStart);
+		const size_t nameEnd = (nameStart != std::string::npos) ? (line.find('"', nameStart + 1)) : (std::string::npos);
+		if (nameEnd == std::string::npos) {
+			blk::warn("ExpandShaderIncludes() - Malformed include in %s: %s", fileName.c_str(), std::string(line).c_str());
+			return false;
+		}
+
+		const std::string includeFileName = directory + std::string(line.substr(nameStart + 1, nameEnd - nameStart - 1));
+		g_ResourceManager.AddDependency(pShader, includeFileName);
+
+		kbFileData includeFile;
+		if (g_FileSystem.ReadFile(includeFileName, includeFile) == false) {
+			blk::warn("ExpandShaderIncludes() - %s includes %s, which couldn't be read", fileName.c_str(), includeFileName.c_str());
 			return false;
 		}
 
-		std::string shaderText((std::istreambuf_iterator<char>(shaderFile)), std::istreambuf_iterator<char>());
-		shaderFile.close();
+		std::string includeText((const char*)includeFile.GetData(), includeFile.GetSize());
+		includeText.erase(std::remove(includeText.begin(), includeText.end(), '\r'), includeText.end());
+		if (ExpandShaderIncludes(pShader, includeFileName, includeText, depth + 1) == false) {
+			return false;
+		}
 
-		kbTextParser shaderParser(shaderText);
-		shaderParser.RemoveComments();
+		// Keeps compile errors pointing at the right file and line
+		std::string includeLineFileName = includeFileName;
+		std::replace(includeLineFileName.begin(), includeLineFileName.end(), '\\', '/');
+		expandedText += "#line 1 \"" + includeLineFileName + "\"\n";
+		expandedText += includeText;
+		if (includeText.empty() == false && includeText.back() != '\n') {
+			expandedText += '\n';
+		}
+		lineStart = lineEnd;
+		lineNum++;
+		expandedText += "#line " + std::to_string(lineNum) + " \"" + lineFileName + "\"\n";
+	}
 
-		if (shaderParser.SetBlock("kbShaderState")) {
-			shaderParser.MakeLowerCase();
+	shaderText.swap(expandedText);
+	return true;
+}
 
-			std::string value;
+/// kbShaderCacheHeader_t - Followed by kbShaderCacheState_t, the shader var bindings and the compiled blobs
+struct kbShaderCacheHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u64 m_KeyHash;
+	u64 m_KeySize;			// Checked along with the hash so a collision also needs a key of the same length
+};
 
-			if (shaderParser.ContainsKey("distortion")) {
-				m_bDistortionEnabled = true;
-			}
+/// kbShaderCacheState_t - The parsed kbShaderState block
+struct kbShaderCacheState_t {
+	u32 m_bBlendEnabled;
+	u32 m_bDistortionEnabled;
+	u32 m_SrcBlend;
+	u32 m_DstBlend;
+	u32 m_BlendOp;
+	u32 m_SrcBlendAlpha;
+	u32 m_DstBlendAlpha;
+	u32 m_BlendOpAlpha;
+	u32 m_ColorWriteEnable;
+	u32 m_CullMode;
+};
 
-			if (shaderParser.GetValueForKey(value, "srcblend")) {
-				m_SrcBlend = GetBlendFromName(value);
-				m_bBlendEnabled = true;
-			}
+static const u32 g_ShaderCacheMagic = 0x48534b42;		// "BKSH"
+static const u32 g_ShaderCacheVersion = 1;
 
-			if (shaderParser.GetValueForKey(value, "dstblend")) {
-				m_DstBlend = GetBlendFromName(value);
-				m_bBlendEnabled = true;
-			}
+kbConsoleVariable g_ShaderCache("shadercache", true, kbConsoleVariable::Console_Bool, "Load compiled shaders from the shader cache instead of compiling them.  The cache is ./cache/shaders/ unless BLK_SHADER_CACHE names another directory.", "");
 
-			if (shaderParser.GetValueForKey(value, "blendop")) {
-				m_BlendOp = GetBlendOpFromName(value);
-				m_bBlendEnabled = true;
-			}
+/// GetShaderCacheDirectory - Entries are named by the hash of everything that goes into the compile, so a directory can be
+/// shared between machines and never has to be cleaned out for correctness
+static const std::string& GetShaderCacheDirectory() {
+	static const std::string cacheDirectory = []() {
+		char envDirectory[MAX_PATH];
+		const DWORD length = GetEnvironmentVariableA("BLK_SHADER_CACHE", envDirectory, MAX_PATH);
+		if (length == 0 || length >= MAX_PATH) {
+			return std::string("./cache/shaders/");
+		}
 
-			if (shaderParser.GetValueForKey(value, "srcblendalpha")) {
-				m_SrcBlendAlpha = GetBlendFromName(value);
-				m_bBlendEnabled = true;
-			}
+		std::string directory(envDirectory, length);
+		if (directory.back() != '/' && directory.back() != '\\') {
+			directory += '/';
+		}
+		return directory;
+	}();
+	return cacheDirectory;
+}
 
-			if (shaderParser.GetValueForKey(value, "dstblendalpha")) {
-				m_DstBlendAlpha = GetBlendFromName(value);
-				m_bBlendEnabled = true;
-			}
+/// kbShader::ParseShaderState - Reads the kbShaderState block and blanks it out of shaderText
+void kbShader::ParseShaderState(std::string& shaderText) {
+	kbTextParser shaderParser(shaderText);
+	shaderParser.RemoveComments();
+
+	if (shaderParser.SetBlock("kbShaderState") == false) {
+		return;
+	}
 
-			if (shaderParser.GetValueForKey(value, "blendopalpha")) {
-				m_BlendOpAlpha = GetBlendOpFromName(value);
-				m_bBlendEnabled = true;
+	shaderParser.MakeLowerCase();
+
+	std::string value;
+
+	if (shaderParser.ContainsKey("distortion")) {
+		m_bDistortionEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "srcblend")) {
+		m_SrcBlend = GetBlendFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "dstblend")) {
+		m_DstBlend = GetBlendFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "blendop")) {
+		m_BlendOp = GetBlendOpFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "srcblendalpha")) {
+		m_SrcBlendAlpha = GetBlendFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "dstblendalpha")) {
+		m_DstBlendAlpha = GetBlendFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "blendopalpha")) {
+		m_BlendOpAlpha = GetBlendOpFromName(value);
+		m_bBlendEnabled = true;
+	}
+
+	if (shaderParser.GetValueForKey(value, "colorwriteenable")) {
+		m_ColorWriteEnable = GetColorWriteEnableFromName(value);
+	}
+
+	if (shaderParser.GetValueForKey(value, "cullmode")) {
+		if (value == "cullmode_none") {
+			m_CullMode = CullMode_None;
+		} else if (value == "cullmode_frontfaces") {
+			m_CullMode = CullMode_FrontFaces;
+		} else if (value == " cullmode_backfaces") {
+			m_CullMode = CullMode_BackFaces;
+		}
+	}
+	shaderParser.ReplaceBlockWithSpaces();
+}
+
+/// kbShader::Load_Internal
+bool kbShader::Load_Internal() {
+	if (g_pD3D11Renderer != nullptr) {		// HACK TODO
+		// Load File
+		kbFileData shaderFile;
+		const kbFileData* pShaderData = GetStreamedData(GetFullFileName());
+		if (pShaderData == nullptr) {
+			if (g_FileSystem.ReadFile(GetFullFileName(), shaderFile) == false) {
+				return false;
 			}
+			pShaderData = &shaderFile;
+		}
 
-			if (shaderParser.GetValueForKey(value, "colorwriteenable")) {
-				m_ColorWriteEnable = GetColorWriteEnableFromName(value);
+		// The parser splits values on new lines, so drop the carriage returns a text mode read would have
+		std::string shaderText((const char*)pShaderData->GetData(), pShaderData->GetSize());
+		shaderText.erase(std::remove(shaderText.begin(), shaderText.end(), '\r'), shaderText.end());
+
+		if (ExpandShaderIncludes(this, GetFullFileName(), shaderText, 0) == false) {
+			return false;
+		}
+
+		// Includes are pasted in by now, so the key changes exactly when the shader or one of its includes does
+		std::string cacheKey = g_pD3D11Renderer->GetShaderCompileOptions();
+		cacheKey += '\n' + m_VertexShaderFunctionName + '\n' + m_PixelShaderFunctionName + '\n';
+		cacheKey += shaderText;
+
+		kbShaderCacheHeader_t cacheHeader;
+		memset(&cacheHeader, 0, sizeof(cacheHeader));
+		cacheHeader.m_Magic = g_ShaderCacheMagic;
+		cacheHeader.m_Version = g_ShaderCacheVersion;
+		cacheHeader.m_KeyHash = kbHashName(cacheKey);
+		cacheHeader.m_KeySize = cacheKey.size();
+
+		const size_t namePos = GetFullFileName().find_last_of("/\\");
+		char hashStr[32];
+		sprintf_s(hashStr, "%016llx", cacheHeader.m_KeyHash);
+		const std::string cacheFileName = GetShaderCacheDirectory() + GetFullFileName().substr(namePos + 1) + "." + hashStr + ".kbShader";
+
+		kbShaderBlobs_t shaderBlobs;
+		if (g_ShaderCache.GetBool() == false || ReadCache(cacheFileName, cacheHeader, shaderBlobs) == false) {
+			ParseShaderState(shaderText);
+
+			kbTimer compileTimer;
+			if (g_pD3D11Renderer->CompileShader(GetFullFileName(), shaderText, m_VertexShaderFunctionName, m_PixelShaderFunctionName, &m_ShaderVarBindings, shaderBlobs) == false) {
+				return true;
 			}
+			blk::log("Compiled %s in %.2f ms", GetFullFileName().c_str(), compileTimer.TimeElapsedMS());
 
-			if (shaderParser.GetValueForKey(value, "cullmode")) {
-				if (value == "cullmode_none") {
-					m_CullMode = CullMode_None;
-				} else if (value == "cullmode_frontfaces") {
-					m_CullMode = CullMode_FrontFaces;
-				} else if (value == " cullmode_backfaces") {
-					m_CullMode = CullMode_BackFaces;
-				}
+			if (g_ShaderCache.GetBool()) {
+				WriteCache(cacheFileName, cacheHeader, shaderBlobs);
 			}
-			shaderParser.ReplaceBlockWithSpaces();
 		}
 
-		g_pD3D11Renderer->CreateShaderFromText(GetFullFileName(), shaderText, m_pVertexShader, m_pGeometryShader, m_pPixelShader, m_pVertexLayout, m_VertexShaderFunctionName.c_str(), m_PixelShaderFunctionName.c_str(), &m_ShaderVarBindings);
+		g_pD3D11Renderer->CreateShaderFromBlobs(GetFullFileName(), shaderBlobs, m_pVertexShader, m_pGeometryShader, m_pPixelShader, m_pVertexLayout, m_VertexShaderFunctionName, &m_ShaderVarBindings);
+	}
+	return true;
+}
+
+/// kbShader::ReadCache
+bool kbShader::ReadCache(const std::string& cacheFileName, const kbShaderCacheHeader_t& expectedHeader, kbShaderBlobs_t& outBlobs) {
+	kbFileData cacheFile;
+	if (g_FileSystem.ReadFile(cacheFileName, cacheFile) == false) {
+		return false;
+	}
+
+	kbCacheReader reader(cacheFile.GetData(), cacheFile.GetSize());
+	kbShaderCacheHeader_t header;
+	if (reader.Read(header) == false || memcmp(&header, &expectedHeader, sizeof(header)) != 0) {
+		return false;
+	}
+
+	kbShaderCacheState_t state;
+	kbShaderVarBindings_t bindings;
+	u64 constantBufferSize = 0;
+	u32 numVarBindings = 0;
+	bool bValid = reader.Read(state) && reader.Read(constantBufferSize) && reader.Read(numVarBindings);
+	for (u32 i = 0; bValid && i < numVarBindings; i++) {
+		std::string varName;
+		u32 byteOffset = 0;
+		Vec4 defaultValue;
+		u32 flags = 0;
+		bValid = reader.ReadString(varName) && reader.Read(byteOffset) && reader.Read(defaultValue) && reader.Read(flags);
+		bindings.m_VarBindings.push_back(kbShaderVarBindings_t::binding_t(varName, byteOffset, (flags & 1) != 0, defaultValue, (flags & 2) != 0));
 	}
+
+	u32 numTextures = 0;
+	bValid = bValid && reader.Read(numTextures);
+	for (u32 i = 0; bValid && i < numTextures; i++) {
+		kbShaderVarBindings_t::textureBinding_t textureBinding;
+		bValid = reader.ReadString(textureBinding.m_TextureName) && reader.ReadString(textureBinding.m_DefaultTextureName);
+		bindings.m_Textures.push_back(textureBinding);
+	}
+
+	std::vector<byte>* const blobs[] = { &outBlobs.m_VertexShader, &outBlobs.m_GeometryShader, &outBlobs.m_PixelShader };
+	for (size_t i = 0; bValid && i < _countof(blobs); i++) {
+		u32 blobSize = 0;
+		bValid = reader.Read(blobSize) && reader.ReadArray(*blobs[i], blobSize);
+	}
+
+	if (bValid == false) {
+		blk::warn("kbShader::ReadCache() - %s is corrupt.  Compiling %s again", cacheFileName.c_str(), GetFullFileName().c_str());
+		outBlobs = kbShaderBlobs_t();
+		return false;
+	}
+
+	m_bBlendEnabled = state.m_bBlendEnabled != 0;
+	m_bDistortionEnabled = state.m_bDistortionEnabled != 0;
+	m_SrcBlend = (kbBlend)state.m_SrcBlend;
+	m_DstBlend = (kbBlend)state.m_DstBlend;
+	m_BlendOp = (kbBlendOp)state.m_BlendOp;
+	m_SrcBlendAlpha = (kbBlend)state.m_SrcBlendAlpha;
+	m_DstBlendAlpha = (kbBlend)state.m_DstBlendAlpha;
+	m_BlendOpAlpha = (kbBlendOp)state.m_BlendOpAlpha;
+	m_ColorWriteEnable = (kbColorWriteEnable)state.m_ColorWriteEnable;
+	m_CullMode = (ECullMode)state.m_CullMode;
+
+	bindings.m_ConstantBufferSizeBytes = (size_t)constantBufferSize;
+	m_ShaderVarBindings = bindings;
 	return true;
 }
 
+/// kbShader::WriteCache
+void kbShader::WriteCache(const std::string& cacheFileName, const kbShaderCacheHeader_t& header, const kbShaderBlobs_t& shaderBlobs) const {
+	kbShaderCacheState_t state;
+	state.m_bBlendEnabled = m_bBlendEnabled;
+	state.m_bDistortionEnabled = m_bDistortionEnabled;
+	state.m_SrcBlend = m_SrcBlend;
+	state.m_DstBlend = m_DstBlend;
+	state.m_BlendOp = m_BlendOp;
+	state.m_SrcBlendAlpha = m_SrcBlendAlpha;
+	state.m_DstBlendAlpha = m_DstBlendAlpha;
+	state.m_BlendOpAlpha = m_BlendOpAlpha;
+	state.m_ColorWriteEnable = m_ColorWriteEnable;
+	state.m_CullMode = m_CullMode;
+
+	kbCacheWriter writer;
+	writer.Write(header);
+	writer.Write(state);
+	writer.Write((u64)m_ShaderVarBindings.m_ConstantBufferSizeBytes);
+
+	writer.Write((u32)m_ShaderVarBindings.m_VarBindings.size());
+	for (size_t i = 0; i < m_ShaderVarBindings.m_VarBindings.size(); i++) {
+		const kbShaderVarBindings_t::binding_t& binding = m_ShaderVarBindings.m_VarBindings[i];
+		writer.WriteString(binding.m_VarName);
+		writer.Write((u32)binding.m_VarByteOffset);
+		writer.Write(binding.m_DefaultValue);
+		writer.Write((u32)((binding.m_bHasDefaultValue ? 1 : 0) | (binding.m_bIsUserDefinedVar ? 2 : 0)));
+	}
+
+	writer.Write((u32)m_ShaderVarBindings.m_Textures.size());
+	for (size_t i = 0; i < m_ShaderVarBindings.m_Textures.size(); i++) {
+		writer.WriteString(m_ShaderVarBindings.m_Textures[i].m_TextureName);
+		writer.WriteString(m_ShaderVarBindings.m_Textures[i].m_DefaultTextureName);
+	}
+
+	const std::vector<byte>* const blobs[] = { &shaderBlobs.m_VertexShader, &shaderBlobs.m_GeometryShader, &shaderBlobs.m_PixelShader };
+	for (size_t i = 0; i < _countof(blobs); i++) {
+		writer.Write((u32)blobs[i]->size());
+		writer.WriteArray(*blobs[i]);
+	}
+
+	if (writer.Save(cacheFileName) == false) {
+		blk::warn("kbShader::WriteCache() - Failed to write %s", cacheFileName.c_str());
+	}
+}
+
 /// kbShader::Release_Internal
 void kbShader::Release_Internal() {
 	SAFE_RELEASE(m_pVertexShader);
@@ -767,6 +1021,36 @@ void kbShader::Release_Internal() {
 	m_CullMode = CullMode_BackFaces;
 }
 
+/// kbShader::CreateStagingCopy
+kbResource* kbShader::CreateStagingCopy() const {
+	kbShader* const pStaging = new kbShader();
+	pStaging->m_VertexShaderFunctionName = m_VertexShaderFunctionName;
+	pStaging->m_PixelShaderFunctionName = m_PixelShaderFunctionName;
+	return pStaging;
+}
+
+/// kbShader::SwapStagedData
+void kbShader::SwapStagedData(kbResource* const pStaged) {
+	kbShader* const pShader = (kbShader*)pStaged;
+	std::swap(m_pVertexShader, pShader->m_pVertexShader);
+	std::swap(m_pGeometryShader, pShader->m_pGeometryShader);
+	std::swap(m_pPixelShader, pShader->m_pPixelShader);
+	std::swap(m_pVertexLayout, pShader->m_pVertexLayout);
+	m_ShaderConstantsMap.swap(pShader->m_ShaderConstantsMap);
+	std::swap(m_ShaderVarBindings, pShader->m_ShaderVarBindings);
+
+	std::swap(m_bBlendEnabled, pShader->m_bBlendEnabled);
+	std::swap(m_bDistortionEnabled, pShader->m_bDistortionEnabled);
+	std::swap(m_SrcBlend, pShader->m_SrcBlend);
+	std::swap(m_DstBlend, pShader->m_DstBlend);
+	std::swap(m_BlendOp, pShader->m_BlendOp);
+	std::swap(m_SrcBlendAlpha, pShader->m_SrcBlendAlpha);
+	std::swap(m_DstBlendAlpha, pShader->m_DstBlendAlpha);
+	std::swap(m_BlendOpAlpha, pShader->m_BlendOpAlpha);
+	std::swap(m_ColorWriteEnable, pShader->m_ColorWriteEnable);
+	std::swap(m_CullMode, pShader->m_CullMode);
+}
+
 /// kbShader::CommitShaderParams
 void kbShader::CommitShaderParams() {
 	blk::error_check(g_pRenderer->IsRenderingSynced(), "kbShader::CommitShaderParams() - Can only be called when rendering is synced");
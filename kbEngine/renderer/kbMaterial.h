@@ -8,6 +8,7 @@
 #include "kbRenderBuffer.h"
 #include "kbResourceManager.h"
 #include "kbRenderer_Defs.h"
+#include "kbTextureCooker.h"
 
 /// kbTexture
 class kbTexture : public kbResource {
@@ -35,8 +36,24 @@ private:
 	virtual bool load_internal();
 	virtual void release_internal();
 
+	/// Creates the GPU texture from m_CookedTexture on the render thread
+	virtual bool Upload_Internal() override;
+	virtual void Release_Internal() override;
+
+	/// The cooked copy when there is one, so the streamer reads it instead of the source image
+	virtual std::string GetStreamFileName() const override;
+
+	virtual kbResource* CreateStagingCopy() const override;
+	virtual void SwapStagedData(kbResource* const pStaged) override;
+
+	kbTextureFormat_t GetCookFormat() const;
+	bool CookSource();
+	bool ReadCache();
+	void WriteCache() const;
+
 	kbHWTexture* m_pGPUTexture;
 	std::unique_ptr<uint8_t[]> m_pCPUTexture;
+	kbCookedTexture m_CookedTexture;		// Only held between load and upload
 
 	uint m_width;
 	uint m_height;
@@ -71,6 +88,7 @@ struct kbShaderVarBindings_t {
 		textureBinding_t() : m_pDefaultTexture(nullptr), m_pDefaultRenderTexture(nullptr), m_bIsUserDefinedVar(false) { }
 
 		std::string	m_TextureName;
+		std::string m_DefaultTextureName;		// "white", "depthbuffer" etc.  Resolved to the pointers below when the shader is created
 		kbTexture* m_pDefaultTexture;
 		kbRenderTexture* m_pDefaultRenderTexture;
 		bool m_bIsUserDefinedVar;
@@ -88,6 +106,13 @@ struct kbShaderVarBindings_t {
 
 };
 
+/// kbShaderBlobs_t - Compiled bytecode for each stage.  The geometry shader is optional
+struct kbShaderBlobs_t {
+	std::vector<byte> m_VertexShader;
+	std::vector<byte> m_GeometryShader;
+	std::vector<byte> m_PixelShader;
+};
+
 ///  kbShader
 class kbShader : public kbResource {
 	friend class kbShader_TypeInfo;
@@ -134,6 +159,16 @@ private:
 	virtual bool Load_Internal();
 	virtual void Release_Internal();
 
+	/// The game thread's shader params stay with the live shader
+	virtual kbResource* CreateStagingCopy() const override;
+	virtual void SwapStagedData(kbResource* const pStaged) override;
+
+	void ParseShaderState(std::string& shaderText);
+
+	/// Compiled blobs and parsed state are cached under a hash of the expanded source and compile options
+	bool ReadCache(const std::string& cacheFileName, const struct kbShaderCacheHeader_t& expectedHeader, kbShaderBlobs_t& outBlobs);
+	void WriteCache(const std::string& cacheFileName, const struct kbShaderCacheHeader_t& header, const kbShaderBlobs_t& shaderBlobs) const;
+
 	kbHWVertexShader* m_pVertexShader;
 	kbHWGeometryShader* m_pGeometryShader;
 	kbHWPixelShader* m_pPixelShader;
@@ -4,7 +4,12 @@
 
 #include <fbxsdk.h>
 #include <fstream>
+#include <filesystem>
 #include "blk_core.h"
+#include "blk_containers.h"
+#include "blk_console.h"
+#include "blk_file_system.h"
+#include "blk_cache.h"
 #include "Matrix.h"
 #include "kbIntersectionTests.h"
 #include "kbModel.h"
@@ -13,6 +18,9 @@
 #include "Renderer_Dx12.h"
 #include "render_defs.h"
 
+kbConsoleVariable g_AnimCompression("animcompression", true, kbConsoleVariable::Console_Bool, "Compress animations as they load and release their raw keys.", "");
+kbConsoleVariable g_ModelCache("modelcache", true, kbConsoleVariable::Console_Bool, "Load models and animations from their cooked copies in ./cache/, cooking them again when the source changes.", "");
+
 #pragma pack(push, packing)
 #pragma pack(1)
 
@@ -73,8 +81,59 @@ typedef struct {
 
 #pragma pack( pop, packing )
 
+/// kbModelCacheHeader_t - Followed by the vertices, indices, meshes, material colors, bones, ref pose, inverse ref pose and
+/// bone names in that order.  Every section starts on a four byte boundary
+struct kbModelCacheHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u64 m_SourceSize;
+	u64 m_SourceTime;
+	u32 m_bCPUAccessOnly;		// MS3D vertex colors come from the material instead of the bone indices
+	u32 m_NumVertices;
+	u32 m_NumIndices;
+	u32 m_NumMeshes;
+	u32 m_NumMaterials;
+	u32 m_NumBones;
+	Vec3 m_BoundsMin;
+	Vec3 m_BoundsMax;
+};
+
+/// kbModelCacheMesh_t
+struct kbModelCacheMesh_t {
+	Vec3 m_BoundsMin;
+	Vec3 m_BoundsMax;
+	u32 m_NumTriangles;
+	u32 m_IndexBufferIndex;
+	u32 m_MaterialIndex;
+};
+
+/// kbModelCacheBone_t - Names are stored after the inverse ref pose as a u32 length and the characters
+struct kbModelCacheBone_t {
+	Quat4 m_RelativeRotation;
+	Vec3 m_RelativePosition;
+	u32 m_ParentIndex;
+};
+
+/// kbAnimCacheHeader_t - Followed by a u32 rotation and translation key count per bone, then each bone's rotation keys and
+/// translation keys
+struct kbAnimCacheHeader_t {
+	u32 m_Magic;
+	u32 m_Version;
+	u64 m_SourceSize;
+	u64 m_SourceTime;
+	u32 m_NumBones;
+	f32 m_LengthInSeconds;
+};
+
+static const u32 g_ModelCacheMagic = 0x444d4b42;		// "BKMD"
+static const u32 g_ModelCacheVersion = 1;
+static const u32 g_AnimCacheMagic = 0x4e414b42;		// "BKAN"
+static const u32 g_AnimCacheVersion = 1;
+
 /// kbModel::kbModel
 kbModel::kbModel() :
+	m_vertex_buffer(nullptr),
+	m_index_buffer(nullptr),
 	m_NumVertices(0),
 	m_NumTriangles(0),
 	m_Stride(sizeof(vertexLayout)),
@@ -93,33 +152,273 @@ kbModel::~kbModel() {
 /// kbModel::Load_Internal
 bool kbModel::Load_Internal() {
 	const std::string fileExt = GetFileExtension(GetFullFileName());
-	if (fileExt == "ms3d") {
-		return LoadMS3D();
-	} else if (fileExt == "fbx") {
-		return LoadFBX();
-	} else if (fileExt == "diablo3") {
-		return LoadDiablo3();
+
+	bool bLoaded = g_ModelCache.GetBool() && ReadCache();
+	if (bLoaded == false) {
+		if (fileExt == "ms3d") {
+			bLoaded = LoadMS3D();
+		} else if (fileExt == "fbx") {
+			bLoaded = LoadFBX();
+		} else if (fileExt == "diablo3") {
+			bLoaded = LoadDiablo3();
+		}
+
+		if (bLoaded && g_ModelCache.GetBool()) {
+			WriteCache();
+		}
+	}
+
+	if (bLoaded == false) {
+		return false;
+	}
+
+	if (KeepsCPUCopy()) {
+		for (size_t iMesh = 0; iMesh < m_Meshes.size(); iMesh++) {
+			mesh_t& mesh = m_Meshes[iMesh];
+			mesh.m_Vertices.resize((size_t)mesh.m_NumTriangles * 3);
+
+			// Index buffer winding is the reverse of m_Vertices
+			for (size_t iVert = 0; iVert < mesh.m_Vertices.size(); iVert += 3) {
+				const size_t iIndex = mesh.m_IndexBufferIndex + iVert;
+				mesh.m_Vertices[iVert + 0] = m_CPUVertices[m_CPUIndices[iIndex + 2]].position;
+				mesh.m_Vertices[iVert + 1] = m_CPUVertices[m_CPUIndices[iIndex + 1]].position;
+				mesh.m_Vertices[iVert + 2] = m_CPUVertices[m_CPUIndices[iIndex + 0]].position;
+			}
+		}
+
+		if (NumBones() > 0 && m_CPUVertices.size() > 0) {
+			m_SkinnedMesh.Build(m_CPUVertices);
+		}
+	}
+
+	return true;
+}
+
+/// kbModel::Upload_Internal
+bool kbModel::Upload_Internal() {
+	if (m_bCPUAccessOnly == false) {
+		CreateRenderBuffers();
+	}
+
+	if (KeepsCPUCopy() == false) {
+		m_CPUVertices.clear();
+		m_CPUVertices.shrink_to_fit();
+		m_CPUIndices.clear();
+		m_CPUIndices.shrink_to_fit();
 	}
 
-	return false;
+	return true;
+}
+
+/// kbModel::KeepsCPUCopy
+bool kbModel::KeepsCPUCopy() const {
+	return m_bCPUAccessOnly || GetFileExtension(GetFullFileName()) == "ms3d";
 }
 
-/// kbModel::LoadMS3D
-bool kbModel::LoadMS3D() {
-	std::ifstream modelFile;
-	modelFile.open(m_FullFileName, std::ifstream::in | std::ifstream::binary);
-	blk::error_check(modelFile.good(), "kbModel::LoadMS3D() - Failed to load model %s", m_FullFileName.c_str());
+/// kbModel::GetStreamFileName
+std::string kbModel::GetStreamFileName() const {
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
 
-	// Find the file size
-	modelFile.seekg(0, std::ifstream::end);
-	const std::streamoff fileSize = modelFile.tellg();
-	modelFile.seekg(0, std::ifstream::beg);
+	return (g_ModelCache.GetBool() && g_FileSystem.FileExists(cacheFileName)) ? (cacheFileName) : (GetFullFileName());
+}
 
-	// Load file into memory
-	char* const pMemoryFileBuffer = new char[fileSize];
-	modelFile.read(pMemoryFileBuffer, fileSize);
-	modelFile.close();
+/// kbModel::CreateStagingCopy
+kbResource* kbModel::CreateStagingCopy() const {
+	kbModel* const pStaging = new kbModel();
+	pStaging->m_bCPUAccessOnly = m_bCPUAccessOnly;
+	return pStaging;
+}
 
+/// kbModel::SwapStagedData
+void kbModel::SwapStagedData(kbResource* const pStaged) {
+	kbModel* const pModel = (kbModel*)pStaged;
+	std::swap(m_vertex_buffer, pModel->m_vertex_buffer);
+	std::swap(m_index_buffer, pModel->m_index_buffer);
+	m_VertexBuffer.Swap(pModel->m_VertexBuffer);
+	m_IndexBuffer.Swap(pModel->m_IndexBuffer);
+	std::swap(m_Bounds, pModel->m_Bounds);
+	m_CPUIndices.swap(pModel->m_CPUIndices);
+	m_CPUVertices.swap(pModel->m_CPUVertices);
+	std::swap(m_NumTriangles, pModel->m_NumTriangles);
+	std::swap(m_NumVertices, pModel->m_NumVertices);
+	m_Meshes.swap(pModel->m_Meshes);
+	m_Materials.swap(pModel->m_Materials);
+	m_bones.swap(pModel->m_bones);
+	m_RefPose.swap(pModel->m_RefPose);
+	m_InvRefPose.swap(pModel->m_InvRefPose);
+	std::swap(m_SkinnedMesh, pModel->m_SkinnedMesh);
+	std::swap(m_Stride, pModel->m_Stride);
+}
+
+/// kbModel::CreateRenderBuffers
+void kbModel::CreateRenderBuffers() {
+	m_VertexBuffer.CreateVertexBuffer(m_CPUVertices);
+	m_IndexBuffer.CreateIndexBuffer(m_CPUIndices);
+
+	// D3D12
+	if (g_renderer != nullptr) {
+		m_vertex_buffer = g_renderer->create_render_buffer();
+		if (m_vertex_buffer != nullptr) {
+			m_vertex_buffer->write_vertex_buffer(m_CPUVertices);
+		}
+
+		m_index_buffer = g_renderer->create_render_buffer();
+		if (m_index_buffer != nullptr) {
+			m_index_buffer->write_index_buffer(m_CPUIndices);
+		}
+	}
+}
+
+/// kbModel::ReadCache
+bool kbModel::ReadCache() {
+	u64 sourceSize = 0;
+	u64 sourceTime = 0;
+	if (GetSourceStamp(GetFullFileName(), sourceSize, sourceTime) == false) {
+		return false;
+	}
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	kbFileData cacheFile;
+	const kbFileData* pCacheData = GetStreamedData(cacheFileName);
+	if (pCacheData == nullptr) {
+		if (g_FileSystem.ReadFile(cacheFileName, cacheFile) == false) {
+			return false;
+		}
+		pCacheData = &cacheFile;
+	}
+
+	kbCacheReader reader(pCacheData->GetData(), pCacheData->GetSize());
+	kbModelCacheHeader_t header;
+	if (reader.Read(header) == false || header.m_Magic != g_ModelCacheMagic || header.m_Version != g_ModelCacheVersion ||
+		header.m_SourceSize != sourceSize || header.m_SourceTime != sourceTime || header.m_bCPUAccessOnly != (u32)m_bCPUAccessOnly) {
+		return false;
+	}
+
+	std::vector<kbModelCacheMesh_t> meshes;
+	std::vector<kbColor> materialColors;
+	std::vector<kbModelCacheBone_t> bones;
+	bool bRead = reader.ReadArray(m_CPUVertices, header.m_NumVertices) && reader.ReadArray(m_CPUIndices, header.m_NumIndices) &&
+				 reader.ReadArray(meshes, header.m_NumMeshes) && reader.ReadArray(materialColors, header.m_NumMaterials) &&
+				 reader.ReadArray(bones, header.m_NumBones) && reader.ReadArray(m_RefPose, header.m_NumBones) && reader.ReadArray(m_InvRefPose, header.m_NumBones);
+
+	m_bones.resize(bones.size());
+	for (size_t i = 0; i < bones.size() && bRead; i++) {
+		std::string boneName;
+		bRead = reader.ReadString(boneName);
+
+		m_bones[i].m_Name = kbString(boneName);
+		m_bones[i].m_ParentIndex = (ushort)bones[i].m_ParentIndex;
+		m_bones[i].m_RelativeRotation = bones[i].m_RelativeRotation;
+		m_bones[i].m_RelativePosition = bones[i].m_RelativePosition;
+	}
+
+	for (size_t i = 0; i < meshes.size() && bRead; i++) {
+		bRead = (u64)meshes[i].m_IndexBufferIndex + (u64)meshes[i].m_NumTriangles * 3 <= m_CPUIndices.size() && meshes[i].m_MaterialIndex < materialColors.size();
+	}
+
+	for (size_t i = 0; i < m_CPUIndices.size() && bRead; i++) {
+		bRead = m_CPUIndices[i] < m_CPUVertices.size();
+	}
+
+	if (bRead == false) {
+		blk::warn("kbModel::ReadCache() - %s is corrupt.  Importing %s again", cacheFileName.c_str(), GetFullFileName().c_str());
+		m_CPUVertices.clear();
+		m_CPUIndices.clear();
+		m_RefPose.clear();
+		m_InvRefPose.clear();
+		m_bones.clear();
+		return false;
+	}
+
+	m_Bounds.SetMaxMin(header.m_BoundsMax, header.m_BoundsMin);
+
+	m_Meshes.resize(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++) {
+		m_Meshes[i].m_Bounds.SetMaxMin(meshes[i].m_BoundsMax, meshes[i].m_BoundsMin);
+		m_Meshes[i].m_NumTriangles = meshes[i].m_NumTriangles;
+		m_Meshes[i].m_IndexBufferIndex = meshes[i].m_IndexBufferIndex;
+		m_Meshes[i].m_MaterialIndex = (unsigned char)meshes[i].m_MaterialIndex;
+	}
+
+	m_Materials.resize(materialColors.size());
+	for (size_t i = 0; i < materialColors.size(); i++) {
+		m_Materials[i].m_DiffuseColor = materialColors[i];
+	}
+
+	return true;
+}
+
+/// kbModel::WriteCache
+void kbModel::WriteCache() const {
+	kbModelCacheHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if (GetSourceStamp(GetFullFileName(), header.m_SourceSize, header.m_SourceTime) == false) {
+		return;
+	}
+
+	header.m_Magic = g_ModelCacheMagic;
+	header.m_Version = g_ModelCacheVersion;
+	header.m_bCPUAccessOnly = m_bCPUAccessOnly;
+	header.m_NumVertices = (u32)m_CPUVertices.size();
+	header.m_NumIndices = (u32)m_CPUIndices.size();
+	header.m_NumMeshes = (u32)m_Meshes.size();
+	header.m_NumMaterials = (u32)m_Materials.size();
+	header.m_NumBones = (u32)m_bones.size();
+	header.m_BoundsMin = m_Bounds.Min();
+	header.m_BoundsMax = m_Bounds.Max();
+
+	kbCacheWriter writer;
+	writer.Write(header);
+	writer.WriteArray(m_CPUVertices);
+	writer.WriteArray(m_CPUIndices);
+
+	for (size_t i = 0; i < m_Meshes.size(); i++) {
+		kbModelCacheMesh_t mesh;
+		mesh.m_BoundsMin = m_Meshes[i].m_Bounds.Min();
+		mesh.m_BoundsMax = m_Meshes[i].m_Bounds.Max();
+		mesh.m_NumTriangles = m_Meshes[i].m_NumTriangles;
+		mesh.m_IndexBufferIndex = m_Meshes[i].m_IndexBufferIndex;
+		mesh.m_MaterialIndex = m_Meshes[i].m_MaterialIndex;
+		writer.Write(mesh);
+	}
+
+	for (size_t i = 0; i < m_Materials.size(); i++) {
+		writer.Write(m_Materials[i].m_DiffuseColor);
+	}
+
+	for (size_t i = 0; i < m_bones.size(); i++) {
+		kbModelCacheBone_t bone;
+		bone.m_RelativeRotation = m_bones[i].m_RelativeRotation;
+		bone.m_RelativePosition = m_bones[i].m_RelativePosition;
+		bone.m_ParentIndex = m_bones[i].m_ParentIndex;
+		writer.Write(bone);
+	}
+
+	writer.WriteArray(m_RefPose);
+	writer.WriteArray(m_InvRefPose);
+
+	for (size_t i = 0; i < m_bones.size(); i++) {
+		writer.WriteString(m_bones[i].m_Name.stl_str());
+	}
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	if (writer.Save(cacheFileName) == false) {
+		blk::warn("kbModel::WriteCache() - Failed to write %s", cacheFileName.c_str());
+	}
+}
+
+/// kbModel::LoadMS3D
+bool kbModel::LoadMS3D() {
+	// Streamed models were already read
+	kbFileData fileData;
+	const kbFileData* pFileData = GetStreamedData(m_FullFileName);
+	if (pFileData == nullptr) {
+		blk::error_check(g_FileSystem.ReadFile(m_FullFileName, fileData), "kbModel::LoadMS3D() - Failed to load model %s", m_FullFileName.c_str());
+		pFileData = &fileData;
+	}
+
+	const char* const pMemoryFileBuffer = (const char*)pFileData->GetData();
+	const std::streamoff fileSize = (std::streamoff)pFileData->GetSize();
 	const char* pPtr = pMemoryFileBuffer;
 
 	// Header
@@ -393,62 +692,14 @@ bool kbModel::LoadMS3D() {
 				}
 
 				m_CPUIndices[(size_t)(ibIndex + (2 - j))] = vertIndex;
-
-				// todo - Maybe should be editor only?
-				m_Meshes[i].m_Vertices.push_back(newVert.position);
 			}
 
 			ibIndex += 3;
 		}
 	}
 
-	if (m_bCPUAccessOnly == false) {
-		m_IndexBuffer.CreateIndexBuffer(m_CPUIndices);
-
-		std::vector<vertexLayout> verts(m_CPUVertices.size());
-
-		for (uint i = 0; i < m_CPUVertices.size(); i++) {
-			verts[i].position = m_CPUVertices[i].position;
-			verts[i].uv = m_CPUVertices[i].uv;
-
-			verts[i].normal[0] = m_CPUVertices[i].normal[0];
-			verts[i].normal[1] = m_CPUVertices[i].normal[1];
-			verts[i].normal[2] = m_CPUVertices[i].normal[2];
-			verts[i].normal[3] = m_CPUVertices[i].normal[3];
-
-			verts[i].tangent[0] = m_CPUVertices[i].tangent[0];
-			verts[i].tangent[1] = m_CPUVertices[i].tangent[1];
-			verts[i].tangent[2] = m_CPUVertices[i].tangent[2];
-			verts[i].tangent[3] = m_CPUVertices[i].tangent[3];
-
-
-			verts[i].color[0] = m_CPUVertices[i].color[0];
-			verts[i].color[1] = m_CPUVertices[i].color[1];
-			verts[i].color[2] = m_CPUVertices[i].color[2];
-			verts[i].color[3] = m_CPUVertices[i].color[3];
-
-			// color, normal, etc
-		}
-
-		// D3D12
-		if (g_renderer != nullptr) {
-			m_vertex_buffer = g_renderer->create_render_buffer();
-			if (m_vertex_buffer != nullptr) {
-				m_vertex_buffer->write_vertex_buffer(verts);
-			}
-
-			m_index_buffer = g_renderer->create_render_buffer();
-			if (m_index_buffer != nullptr) {
-				m_index_buffer->write_index_buffer(m_CPUIndices);
-			}
-		}
-
-		m_VertexBuffer.CreateVertexBuffer(verts);
-	}
-
 	delete[] tempVertices;
 	delete[] tempTriangles;
-	delete[] pMemoryFileBuffer;
 
 	return true;
 }
@@ -710,22 +961,8 @@ bool kbModel::LoadFBX() {
 			}
 		}*/
 
-	m_VertexBuffer.CreateVertexBuffer(vertexList);
-	m_IndexBuffer.CreateIndexBuffer(indexList);
-
-
-	// D3D12
-	if (g_renderer != nullptr) {
-		m_vertex_buffer = g_renderer->create_render_buffer();
-		if (m_vertex_buffer != nullptr) {
-			m_vertex_buffer->write_vertex_buffer(vertexList);
-		}
-
-		m_index_buffer = g_renderer->create_render_buffer();
-		if (m_index_buffer != nullptr) {
-			m_index_buffer->write_index_buffer(indexList);
-		}
-	}
+	m_CPUVertices.swap(vertexList);
+	m_CPUIndices.swap(indexList);
 
 	kbMaterial newMaterial;
 	newMaterial.m_shader = nullptr;//(kbShader *) g_ResourceManager.GetResource( "../../kbEngine/assets/Shaders/basicShader.kbShader", true );
@@ -734,6 +971,7 @@ bool kbModel::LoadFBX() {
 	m_bones.resize(boneToBounds.size());
 	for (int i = 0; i < boneToBounds.size(); i++) {
 		kbBounds& boneBounds = boneToBounds[i];
+		m_bones[i].m_ParentIndex = 65535;
 		m_bones[i].m_RelativePosition = boneBounds.Center();
 		m_bones[i].m_RelativeRotation = Quat4(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -856,23 +1094,15 @@ bool kbModel::LoadDiablo3() {
 		//blk::log( "%d, %d, (%f %f %f), (%f %f %f %f), (%f %f)", vertNum, vertIdx, vertPos.x, vertPos.y, vertPos.z, vertNormal.x, vertNormal.y, vertNormal.z, vertNormal.w, vertUV1.x, vertUV1.y );
 	}
 
-	m_VertexBuffer.CreateVertexBuffer(vertexList);
-	m_IndexBuffer.CreateIndexBuffer(indexList);
-
-	if (g_renderer) {
-		auto* vertex_buffer = g_renderer->create_render_buffer();
-		vertex_buffer->write_vertex_buffer(vertexList);
-
-		auto* index_buffer = g_renderer->create_render_buffer();
-		index_buffer->write_index_buffer(indexList);
-	}
-
 	m_Meshes.push_back(mesh_t());
 	mesh_t& newMesh = m_Meshes[m_Meshes.size() - 1];
 	newMesh.m_IndexBufferIndex = 0;
 	newMesh.m_MaterialIndex = 0;
 	newMesh.m_NumTriangles = (uint)indexList.size() / 3;
 
+	m_CPUVertices.swap(vertexList);
+	m_CPUIndices.swap(indexList);
+
 	kbMaterial newMaterial;
 	newMaterial.m_shader = nullptr;//(kbShader *) g_ResourceManager.GetResource( "../../kbEngine/assets/Shaders/basicShader.kbShader", true );
 	m_Materials.push_back(newMaterial);
@@ -1055,7 +1285,7 @@ void kbModel::SwapTexture(const UINT meshIdx, const kbTexture* pTexture, const i
 }
 
 /// kbModel::RayIntersection
-kbModelIntersection_t kbModel::RayIntersection(const Vec3& inRayOrigin, const Vec3& inRayDirection, const Vec3& modelTranslation, const Quat4& modelOrientation, const Vec3& scale) const {
+kbModelIntersection_t kbModel::RayIntersection(const Vec3& inRayOrigin, const Vec3& inRayDirection, const Vec3& modelTranslation, const Quat4& modelOrientation, const Vec3& scale, const std::vector<kbBoneMatrix_t>* const pBonePalette) const {
 	kbModelIntersection_t intersectionInfo;
 
 	Mat4 inverseModelRotation;
@@ -1068,17 +1298,41 @@ kbModelIntersection_t kbModel::RayIntersection(const Vec3& inRayOrigin, const Ve
 	const Vec3 rayDir = inRayDirection.normalize_safe() * inverseModelRotation;
 	float t = FLT_MAX;
 
-	for (int iMesh = 0; iMesh < m_Meshes.size(); iMesh++) {
-		for (size_t iVert = 0; iVert < m_Meshes[iMesh].m_Vertices.size(); iVert += 3) {
+	if (pBonePalette != nullptr && pBonePalette->size() > 0 && m_SkinnedMesh.IsValid() && m_CPUIndices.size() > 0) {
+		std::vector<Vec3> skinnedPositions(m_SkinnedMesh.NumVertices());
+		kbBounds skinnedBounds;
+		m_SkinnedMesh.Skin(*pBonePalette, skinnedPositions.data(), skinnedBounds);
+
+		// Index buffer winding is the reverse of m_Vertices
+		const bool bHitsBounds = kbRayAABBIntersection(rayStart, rayDir, skinnedBounds);
+		for (int iMesh = 0; iMesh < m_Meshes.size() && bHitsBounds; iMesh++) {
+			const mesh_t& mesh = m_Meshes[iMesh];
+			for (size_t iIndex = mesh.m_IndexBufferIndex; iIndex < mesh.m_IndexBufferIndex + mesh.m_NumTriangles * 3 && iIndex + 2 < m_CPUIndices.size(); iIndex += 3) {
+				const Vec3& v0 = skinnedPositions[m_CPUIndices[iIndex + 2]];
+				const Vec3& v1 = skinnedPositions[m_CPUIndices[iIndex + 1]];
+				const Vec3& v2 = skinnedPositions[m_CPUIndices[iIndex + 0]];
+
+				if (kbRayTriIntersection(t, rayStart, rayDir, v0, v1, v2)) {
+					if (t < intersectionInfo.t && t >= 0) {
+						intersectionInfo.t = t;
+						intersectionInfo.meshNum = iMesh;
+					}
+				}
+			}
+		}
+	} else {
+		for (int iMesh = 0; iMesh < m_Meshes.size(); iMesh++) {
+			for (size_t iVert = 0; iVert < m_Meshes[iMesh].m_Vertices.size(); iVert += 3) {
 
-			const Vec3& v0 = m_Meshes[iMesh].m_Vertices[iVert + 0];
-			const Vec3& v1 = m_Meshes[iMesh].m_Vertices[iVert + 1];
-			const Vec3& v2 = m_Meshes[iMesh].m_Vertices[iVert + 2];
+				const Vec3& v0 = m_Meshes[iMesh].m_Vertices[iVert + 0];
+				const Vec3& v1 = m_Meshes[iMesh].m_Vertices[iVert + 1];
+				const Vec3& v2 = m_Meshes[iMesh].m_Vertices[iVert + 2];
 
-			if (kbRayTriIntersection(t, rayStart, rayDir, v0, v1, v2)) {
-				if (t < intersectionInfo.t && t >= 0) {
-					intersectionInfo.t = t;
-					intersectionInfo.meshNum = iMesh;
+				if (kbRayTriIntersection(t, rayStart, rayDir, v0, v1, v2)) {
+					if (t < intersectionInfo.t && t >= 0) {
+						intersectionInfo.t = t;
+						intersectionInfo.meshNum = iMesh;
+					}
 				}
 			}
 		}
@@ -1106,6 +1360,7 @@ void kbModel::Release_Internal() {
 
 	m_CPUVertices.clear();
 	m_CPUIndices.clear();
+	m_SkinnedMesh.Reset();
 	m_Bounds.Reset();
 }
 
@@ -1120,127 +1375,258 @@ int	kbModel::GetBoneIndex(const kbString& BoneName) const {
 	return -1;
 }
 
+/// GetKeyTime
+static const auto GetKeyTime = [](const auto& key) { return key.m_Time; };
+
+/// GetKeyFrameBlend
+///
+/// Takes the result of blk::find_key_index() and returns the pair of keys to blend between along with the blend amount.
+/// Times before the first key or past the last one hold that key, which also covers the end of a looping anim
+template<typename T>
+static f32 GetKeyFrameBlend(const std::vector<T>& keys, const i32 key_idx, const f32 anim_time, u32& prev_key, u32& next_key) {
+	if (key_idx < 0) {
+		prev_key = next_key = 0;
+		return 0.0f;
+	}
+
+	if (key_idx >= (i32)keys.size() - 1) {
+		prev_key = next_key = (u32)keys.size() - 1;
+		return 0.0f;
+	}
+
+	prev_key = (u32)key_idx;
+	next_key = prev_key + 1;
+
+	const f32 time_between_keys = keys[next_key].m_Time - keys[prev_key].m_Time;
+	return (time_between_keys > 0) ? ((anim_time - keys[prev_key].m_Time) / time_between_keys) : (0.0f);
+}
+
 /// kbModel::SetBoneMatrices
 void kbModel::SetBoneMatrices(
 	std::vector<AnimatedBone_t>& bones,
 	const f32 time,
 	const kbAnimation* const animation,
-	const bool is_looping
-) {
+	const bool is_looping,
+	kbAnimationCursor_t* const cursor
+) const {
+
+	// bones may be a reused pose buffer, so leave it empty rather than holding a stale pose
 	if (m_bones.size() == 0 || animation == nullptr) {
+		bones.clear();
 		return;
 	}
 
 	const kbAnimation& anim_data = *animation;
-	if (anim_data.m_JointKeyFrameData.size() == 0) {
+	const bool is_compressed = anim_data.IsCompressed();
+	if (is_compressed == false && anim_data.m_JointKeyFrameData.size() == 0) {
+		bones.clear();
 		return;
 	}
 
 	const f32 anim_duration = anim_data.m_LengthInSeconds;
 	const f32 anim_time = (is_looping && time > anim_duration) ? (fmod(time, anim_duration)) : (time);
 
+	if (cursor != nullptr && (cursor->m_pAnimation != animation || cursor->m_RotationKeys.size() != m_bones.size())) {
+		cursor->m_pAnimation = animation;
+		cursor->m_RotationKeys.assign(m_bones.size(), 0);
+		cursor->m_TranslationKeys.assign(m_bones.size(), 0);
+	}
+
 	bones.resize(m_bones.size());
 	for (u32 i = 0; i < m_bones.size(); i++) {
 		bones[i].m_bone_space_position = Vec3::zero;
 		bones[i].m_bone_space_rotation = Quat4::identity;
 
-		const kbAnimation::kbBoneKeyFrames_t& joints = anim_data.m_JointKeyFrameData[i];
-		for (u32 next_key = 0; next_key < joints.m_RotationKeyFrames.size(); next_key++) {
-			// todo: fix linear search to find next key
-			f32 next_time = joints.m_RotationKeyFrames[next_key].m_Time;
-			if (anim_time >= next_time && next_key != joints.m_RotationKeyFrames.size() - 1) {
-				continue;
+		// Without a cursor, start from an out of range key so the search goes straight to a binary search
+		u32 rotation_cursor = (cursor != nullptr) ? (cursor->m_RotationKeys[i]) : (UINT_MAX);
+		u32 translation_cursor = (cursor != nullptr) ? (cursor->m_TranslationKeys[i]) : (UINT_MAX);
+
+		if (is_compressed) {
+			anim_data.m_CompressedData.SampleRotation(i, anim_time, rotation_cursor, bones[i].m_bone_space_rotation);
+			anim_data.m_CompressedData.SampleTranslation(i, anim_time, translation_cursor, bones[i].m_bone_space_position);
+		} else {
+			const kbAnimation::kbBoneKeyFrames_t& joints = anim_data.m_JointKeyFrameData[i];
+			if (joints.m_RotationKeyFrames.size() > 0) {
+				const i32 key_idx = blk::find_key_index(joints.m_RotationKeyFrames, anim_time, rotation_cursor, GetKeyTime);
+
+				u32 prev_key, next_key;
+				const f32 t = GetKeyFrameBlend(joints.m_RotationKeyFrames, key_idx, anim_time, prev_key, next_key);
+				bones[i].m_bone_space_rotation = Quat4::slerp(joints.m_RotationKeyFrames[prev_key].m_Rotation, joints.m_RotationKeyFrames[next_key].m_Rotation, t);
 			}
 
-			i32 prev_key = next_key;
-			if (anim_time >= next_time) {
-				if (is_looping) {
-					prev_key = (i32)joints.m_RotationKeyFrames.size() - 1;
+			// Translation keys don't necessarily line up with the rotation keys, so they get their own search
+			if (joints.m_TranslationKeyFrames.size() > 0) {
+				const i32 key_idx = blk::find_key_index(joints.m_TranslationKeyFrames, anim_time, translation_cursor, GetKeyTime);
 
-					// todo: determine proper wrapping behavior
-					if (joints.m_RotationKeyFrames.size() > 1) {
-						next_key = 1;
-					} else {
-						next_key = 0;
-					}
-				} else {
-					prev_key = next_key = (i32)joints.m_RotationKeyFrames.size() - 1;
-				}
-			} else {
-				prev_key = kbClamp(prev_key - 1, 0, (i32)joints.m_RotationKeyFrames.size());
+				u32 prev_key, next_key;
+				const f32 t = GetKeyFrameBlend(joints.m_TranslationKeyFrames, key_idx, anim_time, prev_key, next_key);
+				const Vec3 prev_position = joints.m_TranslationKeyFrames[prev_key].m_position;
+				const Vec3 next_position = joints.m_TranslationKeyFrames[next_key].m_position;
+				bones[i].m_bone_space_position = prev_position + (next_position - prev_position) * t;
 			}
+		}
+
+		if (cursor != nullptr) {
+			cursor->m_RotationKeys[i] = rotation_cursor;
+			cursor->m_TranslationKeys[i] = translation_cursor;
+		}
+	}
+}
+
+/// kbModel::BenchmarkAnimationSampling
+void kbModel::BenchmarkAnimationSampling(const kbAnimation* const pAnimation, const bool bLoopAnim, const u32 numSamples) {
+	if (pAnimation == nullptr || numSamples == 0) {
+		return;
+	}
+
+	// animcompression frees the raw keys on load, so compressed clips are searched through their packed key times
+	const u32 numBones = (u32)m_bones.size();
+	const bool bCompressed = pAnimation->IsCompressed();
+	if ((bCompressed) ? (pAnimation->m_CompressedData.NumTracks() < numBones) : (pAnimation->m_JointKeyFrameData.size() < numBones)) {
+		blk::warn("kbModel::BenchmarkAnimationSampling() - %s doesn't have keys for all %u bones", pAnimation->GetName().c_str(), numBones);
+		return;
+	}
 
-			const f32 prev_time = joints.m_RotationKeyFrames[prev_key].m_Time;
-			const f32 time_between_keys = next_time - prev_time;
-			const f32 time_since_prev_key = anim_time - prev_time;
-			const f32 t = (time_between_keys > 0) ? (time_since_prev_key / time_between_keys) : (0.0f);
+	const kbCompressedAnimation& packedKeys = pAnimation->m_CompressedData;
+	const std::vector<kbAnimation::kbBoneKeyFrames_t>& rawKeys = pAnimation->m_JointKeyFrameData;
+	auto NumKeys = [&](const u32 boneIdx) -> u32 {
+		return (bCompressed) ? (packedKeys.NumRotationKeys(boneIdx)) : ((u32)rawKeys[boneIdx].m_RotationKeyFrames.size());
+	};
+	auto KeyTime = [&](const u32 boneIdx, const u32 keyIdx) -> f32 {
+		return (bCompressed) ? (packedKeys.RotationKeyTime(boneIdx, keyIdx)) : (rawKeys[boneIdx].m_RotationKeyFrames[keyIdx].m_Time);
+	};
+	auto FindKey = [&](const u32 boneIdx, const f32 time, u32& cursor) -> i32 {
+		return (bCompressed) ? (packedKeys.FindRotationKey(boneIdx, time, cursor)) : (blk::find_key_index(rawKeys[boneIdx].m_RotationKeyFrames, time, cursor, GetKeyTime));
+	};
+
+	const f32 animLength = pAnimation->GetLengthInSeconds();
+	const f32 timeStep = 1.0f / 60.0f;
 
-			const Vec3 prev_position = joints.m_TranslationKeyFrames[prev_key].m_position;
-			const Vec3 next_position = joints.m_TranslationKeyFrames[next_key].m_position;
-			bones[i].m_bone_space_position = prev_position + (next_position - prev_position) * t;
+	u32 maxKeys = 0;
+	for (u32 i = 0; i < numBones; i++) {
+		maxKeys = max(maxKeys, NumKeys(i));
+	}
 
-			const Quat4 prev_rotation = joints.m_RotationKeyFrames[prev_key].m_Rotation;
-			const Quat4 next_rotation = joints.m_RotationKeyFrames[next_key].m_Rotation;
-			bones[i].m_bone_space_rotation = Quat4::slerp(prev_rotation, next_rotation, t);
+	// Linear search from the first key every sample, which is what sampling used to do
+	u32 numMismatches = 0;
+	std::vector<i32> linearKeys(numBones);
+	std::vector<u32> keyCursors(numBones, 0);
+	f32 linearMS = 0.0f, binaryMS = 0.0f, cursorMS = 0.0f;
+
+	for (u32 iSample = 0; iSample < numSamples; iSample++) {
+		const f32 sampleTime = fmod(iSample * timeStep, animLength);
+
+		kbTimer linearTimer;
+		for (u32 i = 0; i < numBones; i++) {
+			const i32 numKeys = (i32)NumKeys(i);
+			i32 keyIdx = -1;
+			while (keyIdx + 1 < numKeys && KeyTime(i, keyIdx + 1) <= sampleTime) {
+				keyIdx++;
+			}
+			linearKeys[i] = keyIdx;
+		}
+		linearMS += linearTimer.TimeElapsedMS();
 
-			break;
+		kbTimer binaryTimer;
+		for (u32 i = 0; i < numBones; i++) {
+			u32 noCursor = UINT_MAX;
+			numMismatches += (FindKey(i, sampleTime, noCursor) != linearKeys[i]) ? (1) : (0);
 		}
+		binaryMS += binaryTimer.TimeElapsedMS();
+
+		kbTimer cursorTimer;
+		for (u32 i = 0; i < numBones; i++) {
+			numMismatches += (FindKey(i, sampleTime, keyCursors[i]) != linearKeys[i]) ? (1) : (0);
+		}
+		cursorMS += cursorTimer.TimeElapsedMS();
 	}
-}
 
-/// kbModel::Animate
-void kbModel::Animate(std::vector<kbBoneMatrix_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim) {
+	// Full sample cost with and without a cursor
 	std::vector<AnimatedBone_t> tempBones;
-	SetBoneMatrices(tempBones, time, pAnimation, bLoopAnim);
+	kbAnimationCursor_t animCursor;
+
+	kbTimer noCursorTimer;
+	for (u32 iSample = 0; iSample < numSamples; iSample++) {
+		SetBoneMatrices(tempBones, iSample * timeStep, pAnimation, bLoopAnim);
+	}
+	const f32 noCursorSampleMS = noCursorTimer.TimeElapsedMS();
 
-	for (int i = 0; i < tempBones.size(); i++) {
+	kbTimer withCursorTimer;
+	for (u32 iSample = 0; iSample < numSamples; iSample++) {
+		SetBoneMatrices(tempBones, iSample * timeStep, pAnimation, bLoopAnim, &animCursor);
+	}
+	const f32 cursorSampleMS = withCursorTimer.TimeElapsedMS();
+
+	// Sampling without a cursor has to land on the same pose as sampling with one
+	std::vector<AnimatedBone_t> cursorBones;
+	kbAnimationCursor_t checkCursor;
+	u32 numPoseMismatches = 0;
+	for (u32 iSample = 0; iSample < numSamples; iSample++) {
+		SetBoneMatrices(tempBones, iSample * timeStep, pAnimation, bLoopAnim);
+		SetBoneMatrices(cursorBones, iSample * timeStep, pAnimation, bLoopAnim, &checkCursor);
+		for (u32 i = 0; i < numBones; i++) {
+			const bool bSamePose = memcmp(&tempBones[i].m_bone_space_rotation, &cursorBones[i].m_bone_space_rotation, sizeof(Quat4)) == 0 &&
+								   memcmp(&tempBones[i].m_bone_space_position, &cursorBones[i].m_bone_space_position, sizeof(Vec3)) == 0;
+			numPoseMismatches += (bSamePose) ? (0) : (1);
+		}
+	}
+
+	blk::log("Animation sampling benchmark - %s (%s keys).  %u bones, %.2f seconds, up to %u keys per bone, %u samples at 60hz", pAnimation->GetName().c_str(), (bCompressed) ? ("packed") : ("raw"), numBones, animLength, maxKeys, numSamples);
+	blk::log("	Key search - linear: %.3f ms.  binary: %.3f ms.  cursor: %.3f ms.  %u mismatches", linearMS, binaryMS, cursorMS, numMismatches);
+	blk::log("	Full sample - no cursor: %.3f ms.  cursor: %.3f ms.  %u pose mismatches", noCursorSampleMS, cursorSampleMS, numPoseMismatches);
+}
+
+/// kbModel::BuildBoneMatrices
+void kbModel::BuildBoneMatrices(std::vector<kbBoneMatrix_t>& outMatrices, std::vector<AnimatedBone_t>& pose) const {
+	const size_t numBones = min(min(pose.size(), outMatrices.size()), m_bones.size());
+	for (int i = 0; i < numBones; i++) {
 
 		const int parent = m_bones[i].m_ParentIndex;
 
 		kbBoneMatrix_t matLocalSkel(m_bones[i].m_RelativeRotation, m_bones[i].m_RelativePosition);
-		kbBoneMatrix_t matAnimate(tempBones[i].m_bone_space_rotation, tempBones[i].m_bone_space_position);
+		kbBoneMatrix_t matAnimate(pose[i].m_bone_space_rotation, pose[i].m_bone_space_position);
 
 		kbBoneMatrix_t matLocal = matAnimate * matLocalSkel;
 		if (parent != 65535) {
-			tempBones[i].m_local_space_matrix = matLocal * tempBones[parent].m_local_space_matrix;
+			pose[i].m_local_space_matrix = matLocal * pose[parent].m_local_space_matrix;
 		} else {
-			tempBones[i].m_local_space_matrix = matLocal;
+			pose[i].m_local_space_matrix = matLocal;
 		}
 
 		const kbBoneMatrix_t& invRef = GetInvRefBoneMatrix(i);
-		outMatrices[i] = invRef * tempBones[i].m_local_space_matrix;
+		outMatrices[i] = invRef * pose[i].m_local_space_matrix;
 	}
 }
 
+/// kbModel::Animate
+void kbModel::Animate(std::vector<kbBoneMatrix_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim, kbAnimationCursor_t* const pCursor, kbAnimPoseBuffer_t* const pPoseBuffer) const {
+	std::vector<AnimatedBone_t> localPose;
+	std::vector<AnimatedBone_t>& tempBones = (pPoseBuffer != nullptr) ? (pPoseBuffer->m_ToPose) : (localPose);
+	SetBoneMatrices(tempBones, time, pAnimation, bLoopAnim, pCursor);
+	BuildBoneMatrices(outMatrices, tempBones);
+}
+
 /// kbModel::BlendAnimations
-void kbModel::BlendAnimations(std::vector<kbBoneMatrix_t>& outMatrices, const kbAnimation* const pFromAnim, const float FromAnimTime, const bool bFromAnimLoops, const kbAnimation* const pToAnim, const float ToAnimTime, const bool bToAnimLoops, const float normalizedBlendTime) {
+void kbModel::BlendAnimations(std::vector<kbBoneMatrix_t>& outMatrices, const kbAnimation* const pFromAnim, const float FromAnimTime, const bool bFromAnimLoops, const kbAnimation* const pToAnim, const float ToAnimTime, const bool bToAnimLoops, const float normalizedBlendTime, kbAnimationCursor_t* const pFromCursor, kbAnimationCursor_t* const pToCursor, kbAnimPoseBuffer_t* const pPoseBuffer) const {
 
-	std::vector<AnimatedBone_t> fromTempBones;
-	SetBoneMatrices(fromTempBones, FromAnimTime, pFromAnim, bFromAnimLoops);
+	kbAnimPoseBuffer_t localPoses;
+	kbAnimPoseBuffer_t& poseBuffer = (pPoseBuffer != nullptr) ? (*pPoseBuffer) : (localPoses);
 
-	std::vector<AnimatedBone_t> toTempBones;
-	SetBoneMatrices(toTempBones, ToAnimTime, pToAnim, bToAnimLoops);
+	std::vector<AnimatedBone_t>& fromTempBones = poseBuffer.m_FromPose;
+	SetBoneMatrices(fromTempBones, FromAnimTime, pFromAnim, bFromAnimLoops, pFromCursor);
 
-	for (int i = 0; i < fromTempBones.size(); i++) {
+	std::vector<AnimatedBone_t>& toTempBones = poseBuffer.m_ToPose;
+	SetBoneMatrices(toTempBones, ToAnimTime, pToAnim, bToAnimLoops, pToCursor);
 
+	for (int i = 0; i < fromTempBones.size() && i < toTempBones.size(); i++) {
 		toTempBones[i].m_bone_space_position = kbLerp(fromTempBones[i].m_bone_space_position, toTempBones[i].m_bone_space_position, normalizedBlendTime);
 		toTempBones[i].m_bone_space_rotation = Quat4::slerp(fromTempBones[i].m_bone_space_rotation, toTempBones[i].m_bone_space_rotation, normalizedBlendTime);
+	}
 
-		const int parent = m_bones[i].m_ParentIndex;
-
-		kbBoneMatrix_t matLocalSkel(m_bones[i].m_RelativeRotation, m_bones[i].m_RelativePosition);
-		kbBoneMatrix_t matAnimate(toTempBones[i].m_bone_space_rotation, toTempBones[i].m_bone_space_position);
-
-		kbBoneMatrix_t matLocal = matAnimate * matLocalSkel;
-		if (parent != 65535) {
-			toTempBones[i].m_local_space_matrix = matLocal * toTempBones[parent].m_local_space_matrix;
-		} else {
-			toTempBones[i].m_local_space_matrix = matLocal;
-		}
-
-		const kbBoneMatrix_t& invRef = GetInvRefBoneMatrix(i);
-		outMatrices[i] = invRef * toTempBones[i].m_local_space_matrix;
+	if (fromTempBones.size() < toTempBones.size()) {
+		toTempBones.resize(fromTempBones.size());
 	}
+	BuildBoneMatrices(outMatrices, toTempBones);
 }
 
 /// kbAnimation::kbAnimation
@@ -1250,36 +1636,49 @@ kbAnimation::kbAnimation() :
 
 /// kbAnimation::Load_Internal
 bool kbAnimation::Load_Internal() {
-
-	std::ifstream modelFile;
-	modelFile.open(m_FullFileName, std::ifstream::in | std::ifstream::binary);
-
-	if (modelFile.fail()) {
-		int numTries = 5;
-		while (numTries < 2 && modelFile.fail()) {
-			modelFile.close();
-			Sleep(2);
-			modelFile.open(m_FullFileName, std::ifstream::in | std::ifstream::binary);
-			numTries++;
+	bool bLoaded = g_ModelCache.GetBool() && ReadCache();
+	if (bLoaded == false) {
+		bLoaded = LoadMS3D();
+		if (bLoaded && g_ModelCache.GetBool()) {
+			WriteCache();
 		}
+	}
+
+	if (bLoaded == false) {
+		return false;
+	}
 
-		if (modelFile.fail()) {
-			modelFile.close();
+	m_CompressedData.Reset();
+	if (g_AnimCompression.GetBool()) {
+		m_CompressedData.Compress(*this, kbAnimationCompressionSettings_t());
+		m_JointKeyFrameData.clear();
+		m_JointKeyFrameData.shrink_to_fit();
+
+		const kbAnimationCompressionStats_t& stats = m_CompressedData.GetStats();
+		blk::log("Anim %s - %f.  %u -> %u bytes (%.2fx), %u -> %u keys, %u constant and %u stripped tracks.  Max error %f radians, %f units", m_FullFileName.c_str(), m_LengthInSeconds,
+				 stats.m_RawSizeBytes, stats.m_CompressedSizeBytes, stats.CompressionRatio(), stats.m_NumRawKeys, stats.m_NumCompressedKeys, stats.m_NumConstantTracks, stats.m_NumStrippedTracks, stats.m_MaxRotationError, stats.m_MaxTranslationError);
+	} else {
+		blk::log("Anim %s - %f", m_FullFileName.c_str(), this->m_LengthInSeconds);
+	}
+
+	return true;
+}
+
+/// kbAnimation::LoadMS3D
+bool kbAnimation::LoadMS3D() {
+
+	// Streamed animations were already read
+	kbFileData fileData;
+	const kbFileData* pFileData = GetStreamedData(m_FullFileName);
+	if (pFileData == nullptr) {
+		if (g_FileSystem.ReadFile(m_FullFileName, fileData) == false) {
 			blk::warn("kbModel::LoadResource_Internal - Failed to load model %s", m_FullFileName.c_str());
 			return false;
 		}
+		pFileData = &fileData;
 	}
 
-	// Find the file size
-	modelFile.seekg(0, std::ifstream::end);
-	std::streamoff fileSize = modelFile.tellg();
-	modelFile.seekg(0, std::ifstream::beg);
-
-	// Load file into memory
-	char* const pMemoryFileBuffer = new char[fileSize];
-	modelFile.read(pMemoryFileBuffer, fileSize);
-	modelFile.close();
-
+	const char* const pMemoryFileBuffer = (const char*)pFileData->GetData();
 	const char* pPtr = pMemoryFileBuffer;
 
 	// Header
@@ -1379,15 +1778,109 @@ bool kbAnimation::Load_Internal() {
 		}
 	}
 
-	delete[] pMemoryFileBuffer;
 
-	blk::log("Anim %s - %f", m_FullFileName.c_str(), this->m_LengthInSeconds);
+	return true;
+}
+
+/// kbAnimation::ReadCache
+bool kbAnimation::ReadCache() {
+	u64 sourceSize = 0;
+	u64 sourceTime = 0;
+	if (GetSourceStamp(GetFullFileName(), sourceSize, sourceTime) == false) {
+		return false;
+	}
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	kbFileData cacheFile;
+	const kbFileData* pCacheData = GetStreamedData(cacheFileName);
+	if (pCacheData == nullptr) {
+		if (g_FileSystem.ReadFile(cacheFileName, cacheFile) == false) {
+			return false;
+		}
+		pCacheData = &cacheFile;
+	}
+
+	kbCacheReader reader(pCacheData->GetData(), pCacheData->GetSize());
+	kbAnimCacheHeader_t header;
+	if (reader.Read(header) == false || header.m_Magic != g_AnimCacheMagic || header.m_Version != g_AnimCacheVersion ||
+		header.m_SourceSize != sourceSize || header.m_SourceTime != sourceTime) {
+		return false;
+	}
+
+	std::vector<u32> keyCounts;
+	bool bRead = reader.ReadArray(keyCounts, (size_t)header.m_NumBones * 2);
+
+	m_JointKeyFrameData.resize(header.m_NumBones);
+	for (size_t i = 0; i < m_JointKeyFrameData.size() && bRead; i++) {
+		bRead = reader.ReadArray(m_JointKeyFrameData[i].m_RotationKeyFrames, keyCounts[i * 2]) &&
+				reader.ReadArray(m_JointKeyFrameData[i].m_TranslationKeyFrames, keyCounts[i * 2 + 1]);
+	}
+
+	if (bRead == false) {
+		blk::warn("kbAnimation::ReadCache() - %s is corrupt.  Importing %s again", cacheFileName.c_str(), GetFullFileName().c_str());
+		m_JointKeyFrameData.clear();
+		return false;
+	}
 
+	m_LengthInSeconds = header.m_LengthInSeconds;
 	return true;
 }
 
+/// kbAnimation::WriteCache
+void kbAnimation::WriteCache() const {
+	kbAnimCacheHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if (GetSourceStamp(GetFullFileName(), header.m_SourceSize, header.m_SourceTime) == false) {
+		return;
+	}
+
+	header.m_Magic = g_AnimCacheMagic;
+	header.m_Version = g_AnimCacheVersion;
+	header.m_NumBones = (u32)m_JointKeyFrameData.size();
+	header.m_LengthInSeconds = m_LengthInSeconds;
+
+	kbCacheWriter writer;
+	writer.Write(header);
+
+	for (size_t i = 0; i < m_JointKeyFrameData.size(); i++) {
+		writer.Write((u32)m_JointKeyFrameData[i].m_RotationKeyFrames.size());
+		writer.Write((u32)m_JointKeyFrameData[i].m_TranslationKeyFrames.size());
+	}
+
+	for (size_t i = 0; i < m_JointKeyFrameData.size(); i++) {
+		writer.WriteArray(m_JointKeyFrameData[i].m_RotationKeyFrames);
+		writer.WriteArray(m_JointKeyFrameData[i].m_TranslationKeyFrames);
+	}
+
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
+	if (writer.Save(cacheFileName) == false) {
+		blk::warn("kbAnimation::WriteCache() - Failed to write %s", cacheFileName.c_str());
+	}
+}
+
 void kbAnimation::Release_Internal() {
+	m_JointKeyFrameData.clear();
+	m_CompressedData.Reset();
+}
+
+/// kbAnimation::CreateStagingCopy
+kbResource* kbAnimation::CreateStagingCopy() const {
+	return new kbAnimation();
+}
+
+/// kbAnimation::SwapStagedData
+void kbAnimation::SwapStagedData(kbResource* const pStaged) {
+	kbAnimation* const pAnimation = (kbAnimation*)pStaged;
+	m_JointKeyFrameData.swap(pAnimation->m_JointKeyFrameData);
+	std::swap(m_LengthInSeconds, pAnimation->m_LengthInSeconds);
+	std::swap(m_CompressedData, pAnimation->m_CompressedData);
+}
+
+/// kbAnimation::GetStreamFileName
+std::string kbAnimation::GetStreamFileName() const {
+	const std::string cacheFileName = GetCacheFileName(GetFullFileName());
 
+	return (g_ModelCache.GetBool() && g_FileSystem.FileExists(cacheFileName)) ? (cacheFileName) : (GetFullFileName());
 }
 
 kbBoneMatrix_t operator *(const kbBoneMatrix_t& op1, const kbBoneMatrix_t& op2) {
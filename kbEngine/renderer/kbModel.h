@@ -10,6 +10,8 @@
 #include "Matrix.h"
 #include "kbRenderer_defs.h"
 #include "kbMaterial.h"
+#include "kbCompressedAnimation.h"
+#include "kbSkinnedMesh.h"
 
 #include "render_defs.h"
 
@@ -26,6 +28,7 @@ struct kbModelIntersection_t {
 /// kbAnimation
 class kbAnimation : public kbResource {
 	friend class kbModel;
+	friend class kbCompressedAnimation;
 
 public:
 	kbAnimation();
@@ -33,10 +36,24 @@ public:
 
 	float GetLengthInSeconds() const { return m_LengthInSeconds; }
 
+	bool IsCompressed() const { return m_CompressedData.NumTracks() > 0; }
+	const kbAnimationCompressionStats_t& GetCompressionStats() const { return m_CompressedData.GetStats(); }
+
 private:
 	virtual bool Load_Internal();
 	virtual void Release_Internal();
 
+	virtual std::string GetStreamFileName() const override;
+
+	virtual kbResource* CreateStagingCopy() const override;
+	virtual void SwapStagedData(kbResource* const pStaged) override;
+
+	bool LoadMS3D();
+
+	/// Cooked copies of the decoded key frames.  See kbModel::ReadCache()
+	bool ReadCache();
+	void WriteCache() const;
+
 private:
 	struct kbRotationKeyFrame_t {
 		float m_Time;
@@ -55,6 +72,21 @@ private:
 
 	std::vector<kbBoneKeyFrames_t> m_JointKeyFrameData;
 	float m_LengthInSeconds;
+
+	// Once compressed, m_JointKeyFrameData is released and sampling decodes from here
+	kbCompressedAnimation m_CompressedData;
+};
+
+/// kbAnimationCursor_t
+///
+/// Per-instance record of the keys each bone was last sampled between.  Passing one to kbModel::Animate() lets the
+/// next sample start its key search from there instead of from the first key
+struct kbAnimationCursor_t {
+	void Reset() { m_pAnimation = nullptr; m_RotationKeys.clear(); m_TranslationKeys.clear(); }
+
+	const kbAnimation* m_pAnimation = nullptr;
+	std::vector<u32> m_RotationKeys;
+	std::vector<u32> m_TranslationKeys;
 };
 
 Vec3 operator*(const Vec3& op1, const kbBoneMatrix_t& op2);
@@ -67,6 +99,15 @@ struct AnimatedBone_t {
 	kbBoneMatrix_t m_local_space_matrix;
 };
 
+/// kbAnimPoseBuffer_t
+///
+/// Per-instance scratch poses for kbModel::Animate() and kbModel::BlendAnimations().  They only allocate the first time
+/// a buffer is used with a given skeleton
+struct kbAnimPoseBuffer_t {
+	std::vector<AnimatedBone_t> m_FromPose;
+	std::vector<AnimatedBone_t> m_ToPose;
+};
+
 
 /// kbModel
 class kbModel : public kbResource {
@@ -142,14 +183,25 @@ public:
 	size_t NumVertices() const { return m_NumVertices; }
 	UINT VertexStride() const { return m_Stride; }
 
-	kbModelIntersection_t RayIntersection(const Vec3& rayOrigin, const Vec3& rayDirection, const Vec3& modelTranslation, const Quat4& modelOrientation, const Vec3& scale) const;
+	/// Passing a bone palette tests against the skinned triangles instead of the bind pose
+	kbModelIntersection_t RayIntersection(const Vec3& rayOrigin, const Vec3& rayDirection, const Vec3& modelTranslation, const Quat4& modelOrientation, const Vec3& scale, const std::vector<kbBoneMatrix_t>* const pBonePalette = nullptr) const;
+
+	/// Only valid for skinned models
+	const kbSkinnedMesh& GetSkinnedMesh() const { return m_SkinnedMesh; }
+
+	void Animate(std::vector<kbBoneMatrix_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim, kbAnimationCursor_t* const pCursor = nullptr, kbAnimPoseBuffer_t* const pPoseBuffer = nullptr) const;
+	void BlendAnimations(std::vector<kbBoneMatrix_t>& outMatrices, const kbAnimation* const pFromAnim, const float fromAnimTime, const bool bFromAnimLoops, const kbAnimation* const pToAnim, const float ToAnimTime, const bool bToAnimLoops, const float normalizedBlendTime, kbAnimationCursor_t* const pFromCursor = nullptr, kbAnimationCursor_t* const pToCursor = nullptr, kbAnimPoseBuffer_t* const pPoseBuffer = nullptr) const;
+	void SetBoneMatrices(std::vector<AnimatedBone_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim, kbAnimationCursor_t* const pCursor = nullptr) const;
+
+	/// Converts a bone space pose into skinning matrices.  Fills in each bone's m_local_space_matrix along the way
+	void BuildBoneMatrices(std::vector<kbBoneMatrix_t>& outMatrices, std::vector<AnimatedBone_t>& pose) const;
 
-	void Animate(std::vector<kbBoneMatrix_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim);
-	void BlendAnimations(std::vector<kbBoneMatrix_t>& outMatrices, const kbAnimation* const pFromAnim, const float fromAnimTime, const bool bFromAnimLoops, const kbAnimation* const pToAnim, const float ToAnimTime, const bool bToAnimLoops, const float normalizedBlendTime);
-	void SetBoneMatrices(std::vector<AnimatedBone_t>& outMatrices, const float time, const kbAnimation* const pAnimation, const bool bLoopAnim);
+	/// Logs the cost of linear, binary, and cursor key searches when sampling pAnimation
+	void BenchmarkAnimationSampling(const kbAnimation* const pAnimation, const bool bLoopAnim, const u32 numSamples);
 
 	int NumBones() const { return (int)m_bones.size(); }
 	int	GetBoneIndex(const kbString& BoneName) const;
+	int GetParentBoneIndex(const int index) const { return (m_bones[index].m_ParentIndex != 65535) ? (m_bones[index].m_ParentIndex) : (-1); }
 	const kbBoneMatrix_t& GetRefBoneMatrix(const int index) const { return m_RefPose[index]; }
 	const kbBoneMatrix_t& GetInvRefBoneMatrix(const int index) const { return m_InvRefPose[index]; }
 
@@ -158,10 +210,27 @@ public:
 
 protected:
 	virtual bool Load_Internal();
+	virtual bool Upload_Internal() override;
+	virtual std::string GetStreamFileName() const override;
+
+	virtual kbResource* CreateStagingCopy() const override;
+	virtual void SwapStagedData(kbResource* const pStaged) override;
+
 	bool LoadMS3D();
 	bool LoadFBX();
 	bool LoadDiablo3();
 
+	/// Imported models are cooked to ./cache/ in their final vertex layout along with their meshes, materials and
+	/// skeleton.  A cooked copy is only read if the source file's size and write time still match the ones it was cooked from
+	bool ReadCache();
+	void WriteCache() const;
+
+	/// Uploads m_CPUVertices and m_CPUIndices
+	void CreateRenderBuffers();
+
+	/// MS3Ds keep a CPU copy for ray tests, and of the skin for bounds and picking
+	bool KeepsCPUCopy() const;
+
 	virtual void Release_Internal();
 protected:
 	RenderBuffer* m_vertex_buffer;
@@ -184,6 +253,7 @@ protected:
 	std::vector<bone_t>	m_bones;
 	std::vector<kbBoneMatrix_t>	m_RefPose;
 	std::vector<kbBoneMatrix_t>	m_InvRefPose;
+	kbSkinnedMesh m_SkinnedMesh;
 
 	UINT m_Stride;
 
@@ -0,0 +1,219 @@
+/// kbOcclusionCuller.cpp
+///
+/// 2025 blk 1.0
+
+#include "blk_core.h"
+#include "kbOcclusionCuller.h"
+
+static const float g_MinClipW = 1e-4f;
+
+/// kbOcclusionCuller::kbOcclusionCuller
+kbOcclusionCuller::kbOcclusionCuller(const u32 width, const u32 height) :
+	m_Width(max(width, 1u)),
+	m_Height(max(height, 1u)) {
+
+	u32 levelWidth = m_Width;
+	u32 levelHeight = m_Height;
+	while (true) {
+		m_LevelWidth.push_back(levelWidth);
+		m_LevelHeight.push_back(levelHeight);
+		m_DepthPyramid.push_back(std::vector<float>((size_t)levelWidth * levelHeight, 1.0f));
+
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	m_ViewProjMatrix.make_identity();
+}
+
+/// kbOcclusionCuller::BeginFrame
+void kbOcclusionCuller::BeginFrame(const Mat4& viewProjMatrix) {
+	m_ViewProjMatrix = viewProjMatrix;
+	m_Stats = kbOcclusionStats_t();
+
+	std::fill(m_DepthPyramid[0].begin(), m_DepthPyramid[0].end(), 1.0f);
+}
+
+/// kbOcclusionCuller::RasterizeOccluder
+void kbOcclusionCuller::RasterizeOccluder(const Vec3* const triangleVerts, const size_t numVerts, const Mat4& worldMatrix) {
+	kbTimer rasterTimer;
+
+	const Mat4 worldViewProj = worldMatrix * m_ViewProjMatrix;
+	const float halfWidth = m_Width * 0.5f;
+	const float halfHeight = m_Height * 0.5f;
+	std::vector<float>& depthBuffer = m_DepthPyramid[0];
+
+	for (size_t iTri = 0; iTri + 2 < numVerts; iTri += 3) {
+
+		// Project to screen space.  Triangles that cross the near plane are dropped, which only makes the buffer less occluding
+		Vec3 screenPos[3];
+		bool bIsClipped = false;
+		for (int i = 0; i < 3; i++) {
+			const Vec4 clipPos = Vec4(triangleVerts[iTri + i].x, triangleVerts[iTri + i].y, triangleVerts[iTri + i].z, 1.0f).transform_point(worldViewProj);
+			if (clipPos.w < g_MinClipW || clipPos.z < 0.0f) {
+				bIsClipped = true;
+				break;
+			}
+
+			const float invW = 1.0f / clipPos.w;
+			screenPos[i].x = (clipPos.x * invW + 1.0f) * halfWidth;
+			screenPos[i].y = (1.0f - clipPos.y * invW) * halfHeight;
+			// Not clamped to the far plane here.  Clamping a vertex bends the depth plane toward the camera, so parts of
+			// the triangle in front of the far plane would occlude things in front of them
+			screenPos[i].z = clipPos.z * invW;
+		}
+
+		if (bIsClipped) {
+			continue;
+		}
+
+		float area = (screenPos[1].x - screenPos[0].x) * (screenPos[2].y - screenPos[0].y) - (screenPos[1].y - screenPos[0].y) * (screenPos[2].x - screenPos[0].x);
+		if (fabs(area) < kbEpsilon) {
+			continue;
+		}
+
+		// Occluders are two sided, so flip to a consistent winding
+		if (area < 0.0f) {
+			std::swap(screenPos[1], screenPos[2]);
+			area = -area;
+		}
+		m_Stats.m_NumOccluderTriangles++;
+
+		const int minX = max((int)floor(min(min(screenPos[0].x, screenPos[1].x), screenPos[2].x)), 0);
+		const int maxX = min((int)ceil(max(max(screenPos[0].x, screenPos[1].x), screenPos[2].x)), (int)m_Width - 1);
+		const int minY = max((int)floor(min(min(screenPos[0].y, screenPos[1].y), screenPos[2].y)), 0);
+		const int maxY = min((int)ceil(max(max(screenPos[0].y, screenPos[1].y), screenPos[2].y)), (int)m_Height - 1);
+		if (minX > maxX || minY > maxY) {
+			continue;
+		}
+
+		// Depth plane.  Each pixel writes the plane's farthest value over the pixel footprint to stay conservative
+		const float invArea = 1.0f / area;
+		const float dzdx = ((screenPos[1].z - screenPos[0].z) * (screenPos[2].y - screenPos[0].y) - (screenPos[2].z - screenPos[0].z) * (screenPos[1].y - screenPos[0].y)) * invArea;
+		const float dzdy = ((screenPos[2].z - screenPos[0].z) * (screenPos[1].x - screenPos[0].x) - (screenPos[1].z - screenPos[0].z) * (screenPos[2].x - screenPos[0].x)) * invArea;
+		const float depthSlop = 0.5f * (fabs(dzdx) + fabs(dzdy));
+
+		// Inner coverage.  Each edge function is tested at the pixel corner that's farthest inside of it, so pixels on the
+		// silhouette that are only partly covered aren't marked as occluded.  Pixels along edges shared by two triangles
+		// are dropped too, which leaves the buffer less occluding but never wrong
+		const float edgeSlop0 = 0.5f * (fabs(screenPos[2].x - screenPos[1].x) + fabs(screenPos[2].y - screenPos[1].y));
+		const float edgeSlop1 = 0.5f * (fabs(screenPos[0].x - screenPos[2].x) + fabs(screenPos[0].y - screenPos[2].y));
+		const float edgeSlop2 = 0.5f * (fabs(screenPos[1].x - screenPos[0].x) + fabs(screenPos[1].y - screenPos[0].y));
+
+		for (int y = minY; y <= maxY; y++) {
+			const float py = y + 0.5f;
+			for (int x = minX; x <= maxX; x++) {
+				const float px = x + 0.5f;
+
+				const float w0 = (screenPos[2].x - screenPos[1].x) * (py - screenPos[1].y) - (screenPos[2].y - screenPos[1].y) * (px - screenPos[1].x);
+				const float w1 = (screenPos[0].x - screenPos[2].x) * (py - screenPos[2].y) - (screenPos[0].y - screenPos[2].y) * (px - screenPos[2].x);
+				const float w2 = (screenPos[1].x - screenPos[0].x) * (py - screenPos[0].y) - (screenPos[1].y - screenPos[0].y) * (px - screenPos[0].x);
+				if (w0 < edgeSlop0 || w1 < edgeSlop1 || w2 < edgeSlop2) {
+					continue;
+				}
+
+				// Past the far plane, the depth never beats the cleared value of 1
+				const float depth = screenPos[0].z + dzdx * (px - screenPos[0].x) + dzdy * (py - screenPos[0].y) + depthSlop;
+				float& dest = depthBuffer[(size_t)y * m_Width + x];
+				if (depth < dest) {
+					dest = depth;
+				}
+			}
+		}
+	}
+
+	m_Stats.m_NumOccluders++;
+	m_Stats.m_RasterTimeMS += rasterTimer.TimeElapsedMS();
+}
+
+/// kbOcclusionCuller::BuildDepthPyramid
+void kbOcclusionCuller::BuildDepthPyramid() {
+	kbTimer rasterTimer;
+
+	for (size_t level = 1; level < m_DepthPyramid.size(); level++) {
+		const std::vector<float>& src = m_DepthPyramid[level - 1];
+		std::vector<float>& dest = m_DepthPyramid[level];
+		const u32 srcWidth = m_LevelWidth[level - 1];
+		const u32 srcHeight = m_LevelHeight[level - 1];
+
+		for (u32 y = 0; y < m_LevelHeight[level]; y++) {
+			const u32 y0 = y * 2;
+			const u32 y1 = min(y0 + 1, srcHeight - 1);
+			for (u32 x = 0; x < m_LevelWidth[level]; x++) {
+				const u32 x0 = x * 2;
+				const u32 x1 = min(x0 + 1, srcWidth - 1);
+				const float maxDepth = max(max(src[y0 * srcWidth + x0], src[y0 * srcWidth + x1]), max(src[y1 * srcWidth + x0], src[y1 * srcWidth + x1]));
+				dest[y * m_LevelWidth[level] + x] = maxDepth;
+			}
+		}
+	}
+
+	m_Stats.m_RasterTimeMS += rasterTimer.TimeElapsedMS();
+}
+
+/// kbOcclusionCuller::IsVisible
+bool kbOcclusionCuller::IsVisible(const Vec3& center, const Vec3& extents) {
+	kbTimer testTimer;
+	m_Stats.m_NumTested++;
+
+	// Project the box corners and find its screen rect and nearest depth
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for (int i = 0; i < 8; i++) {
+		const Vec4 corner(center.x + ((i & 1) ? extents.x : -extents.x),
+						  center.y + ((i & 2) ? extents.y : -extents.y),
+						  center.z + ((i & 4) ? extents.z : -extents.z), 1.0f);
+		const Vec4 clipPos = corner.transform_point(m_ViewProjMatrix);
+
+		// Boxes that cross the near plane or have no usable bounds are always visible
+		if ((clipPos.w >= g_MinClipW) == false) {
+			m_Stats.m_TestTimeMS += testTimer.TimeElapsedMS();
+			return true;
+		}
+
+		const float invW = 1.0f / clipPos.w;
+		const float screenX = (clipPos.x * invW + 1.0f) * 0.5f * m_Width;
+		const float screenY = (1.0f - clipPos.y * invW) * 0.5f * m_Height;
+		minX = min(minX, screenX);
+		maxX = max(maxX, screenX);
+		minY = min(minY, screenY);
+		maxY = max(maxY, screenY);
+		minZ = min(minZ, clipPos.z * invW);
+	}
+
+	if (minZ <= 0.0f || maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height) {
+		m_Stats.m_TestTimeMS += testTimer.TimeElapsedMS();
+		return true;
+	}
+
+	const u32 pixelMinX = (u32)max((int)floor(minX), 0);
+	const u32 pixelMinY = (u32)max((int)floor(minY), 0);
+	const u32 pixelMaxX = (u32)min((int)floor(maxX), (int)m_Width - 1);
+	const u32 pixelMaxY = (u32)min((int)floor(maxY), (int)m_Height - 1);
+
+	// Pick the level where the rect covers at most 2x2 texels
+	u32 level = 0;
+	while (level + 1 < m_DepthPyramid.size() && ((pixelMaxX >> level) - (pixelMinX >> level) > 1 || (pixelMaxY >> level) - (pixelMinY >> level) > 1)) {
+		level++;
+	}
+
+	bool bIsVisible = false;
+	const std::vector<float>& levelDepth = m_DepthPyramid[level];
+	for (u32 y = pixelMinY >> level; y <= (pixelMaxY >> level) && bIsVisible == false; y++) {
+		for (u32 x = pixelMinX >> level; x <= (pixelMaxX >> level); x++) {
+			if (minZ <= levelDepth[y * m_LevelWidth[level] + x]) {
+				bIsVisible = true;
+				break;
+			}
+		}
+	}
+
+	if (bIsVisible == false) {
+		m_Stats.m_NumRejected++;
+	}
+
+	m_Stats.m_TestTimeMS += testTimer.TimeElapsedMS();
+	return bIsVisible;
+}
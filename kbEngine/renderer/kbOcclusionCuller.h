@@ -0,0 +1,60 @@
+/// kbOcclusionCuller.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+
+/// kbOcclusionStats_t
+struct kbOcclusionStats_t {
+	kbOcclusionStats_t() : m_NumOccluders(0), m_NumOccluderTriangles(0), m_NumTested(0), m_NumRejected(0), m_RasterTimeMS(0.0f), m_TestTimeMS(0.0f) { }
+
+	u32 m_NumOccluders;
+	u32 m_NumOccluderTriangles;
+	u32 m_NumTested;
+	u32 m_NumRejected;
+	float m_RasterTimeMS;
+	float m_TestTimeMS;
+};
+
+/// kbOcclusionCuller
+///
+/// Low resolution CPU depth buffer.  A handful of occluder meshes are rasterized into it each frame, then a max-depth
+/// pyramid is built so an object's screen space AABB can be tested against a few texels.  Depth follows the D3D
+/// convention of 0 at the near plane and 1 at the far plane.  Doesn't depend on any graphics API.
+class kbOcclusionCuller {
+public:
+	kbOcclusionCuller(const u32 width = 256, const u32 height = 128);
+
+	void BeginFrame(const Mat4& viewProjMatrix);
+
+	/// triangleVerts is a non-indexed triangle list in model space.  Triangles crossing the near plane are skipped.  Coverage
+	/// is conservative, so only pixels a triangle covers completely are written
+	void RasterizeOccluder(const Vec3* const triangleVerts, const size_t numVerts, const Mat4& worldMatrix);
+
+	/// Must be called after the last occluder is rasterized and before any visibility tests
+	void BuildDepthPyramid();
+
+	/// Returns false only if the world space AABB is completely hidden behind rasterized occluders
+	bool IsVisible(const Vec3& center, const Vec3& extents);
+
+	const kbOcclusionStats_t& GetStats() const { return m_Stats; }
+
+	u32 GetWidth() const { return m_Width; }
+	u32 GetHeight() const { return m_Height; }
+	const std::vector<float>& GetDepthBuffer() const { return m_DepthPyramid[0]; }
+
+private:
+	u32 m_Width;
+	u32 m_Height;
+
+	// Level 0 is the rasterized depth buffer.  Each following level holds the max of its 2x2 children
+	std::vector<std::vector<float>> m_DepthPyramid;
+	std::vector<u32> m_LevelWidth;
+	std::vector<u32> m_LevelHeight;
+
+	Mat4 m_ViewProjMatrix;
+	kbOcclusionStats_t m_Stats;
+};
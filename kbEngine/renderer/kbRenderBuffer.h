@@ -26,6 +26,7 @@ public:
 	}
 
 	virtual void Release();
+	void Swap(kbRenderBuffer& other) { std::swap(m_pBuffer, other.m_pBuffer); }
 
 	virtual void CreateVertexBuffer(const int numVerts, const int vertexByteSize);
 	virtual void CreateIndexBuffer(const int numIndexes);
@@ -230,6 +230,7 @@ public:
 													m_VertBufferIndexCount( -1 ),
 													m_CullDistance( -1.0f ),
 													m_casts_shadow( false ),
+													m_is_occluder( false ),
 													m_bIsSkinnedModel( false ),
 													m_bIsFirstAdd( true ),
 													m_bIsRemove( false ) { }
@@ -253,6 +254,7 @@ public:
 	float										m_CullDistance;
 
 	bool										m_casts_shadow			: 1;
+	bool										m_is_occluder			: 1;
 	bool										m_bIsSkinnedModel		: 1;
 
 	// Updated by renderer
@@ -0,0 +1,160 @@
+/// kbSkinnedMesh.cpp
+///
+/// 2025 blk 1.0
+
+#include <xmmintrin.h>
+#include "blk_core.h"
+#include "kbModel.h"
+#include "kbSkinnedMesh.h"
+
+// Bone indices are stored in a byte
+static const u32 g_MaxSkinningBones = 256;
+
+/// kbSkinnedMesh::Reset
+void kbSkinnedMesh::Reset() {
+	m_Vertices.clear();
+	m_BoneBounds.clear();
+	m_MaxBoneIndex = 0;
+}
+
+/// kbSkinnedMesh::Build
+void kbSkinnedMesh::Build(const std::vector<vertexLayout>& vertices) {
+	Reset();
+
+	m_Vertices.resize(vertices.size());
+	for (size_t iVert = 0; iVert < vertices.size(); iVert++) {
+		const vertexLayout& srcVert = vertices[iVert];
+		skinnedVertex_t& destVert = m_Vertices[iVert];
+
+		destVert.m_Position[0] = srcVert.position.x;
+		destVert.m_Position[1] = srcVert.position.y;
+		destVert.m_Position[2] = srcVert.position.z;
+		destVert.m_Position[3] = 1.0f;
+
+		// Only keep influences that have weight, and normalize them.  Verts without any are fully bound to their first bone
+		u32 weightSum = 0;
+		for (int i = 0; i < 4; i++) {
+			weightSum += srcVert.tangent[i];
+		}
+
+		destVert.m_NumInfluences = 0;
+		for (int i = 0; i < 4; i++) {
+			if (weightSum > 0 && srcVert.tangent[i] == 0) {
+				continue;
+			}
+
+			const u32 influence = destVert.m_NumInfluences++;
+			destVert.m_BoneIndices[influence] = srcVert.color[i];
+			destVert.m_Weights[influence] = (weightSum > 0) ? ((f32)srcVert.tangent[i] / weightSum) : (1.0f);
+			if (weightSum == 0) {
+				break;
+			}
+		}
+
+		for (u32 i = destVert.m_NumInfluences; i < 4; i++) {
+			destVert.m_BoneIndices[i] = 0;
+			destVert.m_Weights[i] = 0.0f;
+		}
+
+		for (u32 i = 0; i < destVert.m_NumInfluences; i++) {
+			const u32 boneIdx = destVert.m_BoneIndices[i];
+			if (boneIdx >= m_BoneBounds.size()) {
+				m_BoneBounds.resize(boneIdx + 1, kbBounds(true));
+			}
+			m_BoneBounds[boneIdx].AddPoint(srcVert.position);
+			m_MaxBoneIndex = max(m_MaxBoneIndex, boneIdx);
+		}
+	}
+}
+
+/// kbSkinnedMesh::Skin
+void kbSkinnedMesh::Skin(const std::vector<kbBoneMatrix_t>& bonePalette, Vec3* const pOutPositions, kbBounds& outBounds) const {
+	outBounds.Reset();
+	if (IsValid() == false) {
+		return;
+	}
+
+	// Widen the palette to four rows of __m128 per bone.  Bones the palette doesn't cover are left at identity
+	__m128 palette[g_MaxSkinningBones * 4];
+	for (u32 i = 0; i <= m_MaxBoneIndex; i++) {
+		__m128* const pRows = &palette[i * 4];
+		if (i < bonePalette.size()) {
+			const kbBoneMatrix_t& boneMatrix = bonePalette[i];
+			for (int axis = 0; axis < 4; axis++) {
+				pRows[axis] = _mm_set_ps(0.0f, boneMatrix.m_Axis[axis].z, boneMatrix.m_Axis[axis].y, boneMatrix.m_Axis[axis].x);
+			}
+		} else {
+			pRows[0] = _mm_set_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			pRows[1] = _mm_set_ps(0.0f, 0.0f, 1.0f, 0.0f);
+			pRows[2] = _mm_set_ps(0.0f, 1.0f, 0.0f, 0.0f);
+			pRows[3] = _mm_setzero_ps();
+		}
+	}
+
+	__m128 boundsMin = _mm_set1_ps(FLT_MAX);
+	__m128 boundsMax = _mm_set1_ps(-FLT_MAX);
+	alignas(16) f32 skinnedPos[4];
+
+	for (size_t iVert = 0; iVert < m_Vertices.size(); iVert++) {
+		const skinnedVertex_t& vert = m_Vertices[iVert];
+		const __m128 posX = _mm_set1_ps(vert.m_Position[0]);
+		const __m128 posY = _mm_set1_ps(vert.m_Position[1]);
+		const __m128 posZ = _mm_set1_ps(vert.m_Position[2]);
+
+		__m128 result = _mm_setzero_ps();
+		for (u32 i = 0; i < vert.m_NumInfluences; i++) {
+			const __m128* const pRows = &palette[vert.m_BoneIndices[i] * 4];
+			__m128 transformed = _mm_mul_ps(posX, pRows[0]);
+			transformed = _mm_add_ps(transformed, _mm_mul_ps(posY, pRows[1]));
+			transformed = _mm_add_ps(transformed, _mm_mul_ps(posZ, pRows[2]));
+			transformed = _mm_add_ps(transformed, pRows[3]);
+			result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vert.m_Weights[i]), transformed));
+		}
+
+		boundsMin = _mm_min_ps(boundsMin, result);
+		boundsMax = _mm_max_ps(boundsMax, result);
+
+		if (pOutPositions != nullptr) {
+			_mm_store_ps(skinnedPos, result);
+			pOutPositions[iVert].set(skinnedPos[0], skinnedPos[1], skinnedPos[2]);
+		}
+	}
+
+	alignas(16) f32 minValues[4];
+	alignas(16) f32 maxValues[4];
+	_mm_store_ps(minValues, boundsMin);
+	_mm_store_ps(maxValues, boundsMax);
+	outBounds.Set(minValues[0], minValues[1], minValues[2], maxValues[0], maxValues[1], maxValues[2]);
+}
+
+/// kbSkinnedMesh::ComputeBounds
+bool kbSkinnedMesh::ComputeBounds(const std::vector<kbBoneMatrix_t>& bonePalette, kbBounds& outBounds) const {
+	outBounds.Reset();
+	if (IsValid() == false || bonePalette.size() == 0) {
+		return false;
+	}
+
+	kbBoneMatrix_t identity;
+	identity.SetIdentity();
+
+	for (u32 i = 0; i < m_BoneBounds.size(); i++) {
+		const kbBounds& boneBounds = m_BoneBounds[i];
+		if (boneBounds.Min().x > boneBounds.Max().x) {
+			continue;
+		}
+
+		const kbBoneMatrix_t& boneMatrix = (i < bonePalette.size()) ? (bonePalette[i]) : (identity);
+		const Vec3 center = boneBounds.Center() * boneMatrix;
+		const Vec3 extents = (boneBounds.Max() - boneBounds.Min()) * 0.5f;
+
+		Vec3 transformedExtents;
+		transformedExtents.x = fabs(boneMatrix.m_Axis[0].x) * extents.x + fabs(boneMatrix.m_Axis[1].x) * extents.y + fabs(boneMatrix.m_Axis[2].x) * extents.z;
+		transformedExtents.y = fabs(boneMatrix.m_Axis[0].y) * extents.x + fabs(boneMatrix.m_Axis[1].y) * extents.y + fabs(boneMatrix.m_Axis[2].y) * extents.z;
+		transformedExtents.z = fabs(boneMatrix.m_Axis[0].z) * extents.x + fabs(boneMatrix.m_Axis[1].z) * extents.y + fabs(boneMatrix.m_Axis[2].z) * extents.z;
+
+		outBounds.AddPoint(center - transformedExtents);
+		outBounds.AddPoint(center + transformedExtents);
+	}
+
+	return true;
+}
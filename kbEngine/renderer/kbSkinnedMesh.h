@@ -0,0 +1,48 @@
+/// kbSkinnedMesh.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+#include "Matrix.h"
+#include "kbBounds.h"
+#include "kbRenderer_defs.h"
+#include "render_defs.h"
+
+/// kbSkinnedMesh
+///
+/// CPU copy of a skinned model's bind pose positions and bone influences, laid out so that Skin() can deform them
+/// with SSE using the same bone palette the GPU gets (kbRenderObject::m_MatrixList).  Influence weights are
+/// normalized on build.
+///
+/// Skin() gives deformed positions and their exact AABB.  ComputeBounds() is much cheaper and returns a conservative
+/// AABB by transforming each bone's bind pose bounds.  It's conservative because a skinned vertex is a weighted
+/// average of its position transformed by each bone that influences it
+class kbSkinnedMesh {
+public:
+	kbSkinnedMesh() : m_MaxBoneIndex(0) { }
+
+	/// vertices use the skinned layout, with bone indices in color and weights in tangent
+	void Build(const std::vector<vertexLayout>& vertices);
+	void Reset();
+
+	bool IsValid() const { return m_Vertices.size() > 0; }
+	u32 NumVertices() const { return (u32)m_Vertices.size(); }
+
+	/// pOutPositions may be null to only get the bounds.  Otherwise it must hold NumVertices() entries
+	void Skin(const std::vector<kbBoneMatrix_t>& bonePalette, Vec3* const pOutPositions, kbBounds& outBounds) const;
+	bool ComputeBounds(const std::vector<kbBoneMatrix_t>& bonePalette, kbBounds& outBounds) const;
+
+private:
+	struct skinnedVertex_t {
+		f32 m_Position[4];
+		f32 m_Weights[4];
+		u8 m_BoneIndices[4];
+		u32 m_NumInfluences;
+	};
+
+	std::vector<skinnedVertex_t> m_Vertices;
+	std::vector<kbBounds> m_BoneBounds;		// Bind pose bounds of the vertices each bone influences
+	u32 m_MaxBoneIndex;
+};
@@ -0,0 +1,846 @@
+/// kbTextureCooker.cpp
+///
+/// 2025 blk 1.0
+
+#include <cfloat>
+#include <cmath>
+#include "blk_core.h"
+#include "blk_cache.h"
+#include "kbTextureCooker.h"
+
+static const u32 g_MaxTextureMips = 32;
+
+// BC7 interpolation weights for 4 bit indices, out of 64
+static const int g_BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/// kbBlockBitWriter_t - Packs fields into a block starting from its least significant bit
+struct kbBlockBitWriter_t {
+	kbBlockBitWriter_t(byte* const pData) : m_pData(pData), m_Pos(0) { }
+
+	void Write(const u32 value, const u32 numBits) {
+		for (u32 i = 0; i < numBits; i++, m_Pos++) {
+			if (((value >> i) & 1) != 0) {
+				m_pData[m_Pos >> 3] |= (byte)(1 << (m_Pos & 7));
+			}
+		}
+	}
+
+	byte* m_pData;
+	u32 m_Pos;
+};
+
+/// ComputePrincipalAxis - Mean and direction of greatest variance of the block's first numChannels channels
+static void ComputePrincipalAxis(const float pixels[16][4], const int numChannels, float outMean[4], float outAxis[4]) {
+	for (int c = 0; c < 4; c++) {
+		outMean[c] = 0.0f;
+		outAxis[c] = 0.0f;
+	}
+
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < numChannels; c++) {
+			outMean[c] += pixels[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int a = 0; a < numChannels; a++) {
+			for (int b = 0; b < numChannels; b++) {
+				covariance[a][b] += (pixels[i][a] - outMean[a]) * (pixels[i][b] - outMean[b]);
+			}
+		}
+	}
+
+	// Power iteration, starting from the channel that varies the most
+	int startChannel = 0;
+	for (int c = 1; c < numChannels; c++) {
+		if (covariance[c][c] > covariance[startChannel][startChannel]) {
+			startChannel = c;
+		}
+	}
+	outAxis[startChannel] = 1.0f;
+
+	for (int iter = 0; iter < 8; iter++) {
+		float nextAxis[4] = {};
+		float lengthSqr = 0.0f;
+		for (int a = 0; a < numChannels; a++) {
+			for (int b = 0; b < numChannels; b++) {
+				nextAxis[a] += covariance[a][b] * outAxis[b];
+			}
+			lengthSqr += nextAxis[a] * nextAxis[a];
+		}
+
+		if (lengthSqr < 1e-12f) {
+			break;
+		}
+
+		const float invLength = 1.0f / sqrtf(lengthSqr);
+		for (int c = 0; c < numChannels; c++) {
+			outAxis[c] = nextAxis[c] * invLength;
+		}
+	}
+}
+
+/// GetEndpoints - Projects the block onto its principal axis and returns the extremes
+static void GetEndpoints(const float pixels[16][4], const int numChannels, float outEndpoint0[4], float outEndpoint1[4]) {
+	float mean[4];
+	float axis[4];
+	ComputePrincipalAxis(pixels, numChannels, mean, axis);
+
+	float minT = FLT_MAX;
+	float maxT = -FLT_MAX;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < numChannels; c++) {
+			t += (pixels[i][c] - mean[c]) * axis[c];
+		}
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (int c = 0; c < 4; c++) {
+		outEndpoint0[c] = mean[c] + axis[c] * maxT;
+		outEndpoint1[c] = mean[c] + axis[c] * minT;
+	}
+}
+
+/// SolveEndpoints - Least squares endpoints for a block whose pixels sit at weights[i] of the way from endpoint 0 to
+/// endpoint 1.  Returns false if every pixel has the same weight
+static bool SolveEndpoints(const float pixels[16][4], const float weights[16], const int numChannels, float outEndpoint0[4], float outEndpoint1[4]) {
+	float a = 0.0f;
+	float b = 0.0f;
+	float c = 0.0f;
+	float x0[4] = {};
+	float x1[4] = {};
+	for (int i = 0; i < 16; i++) {
+		const float t = weights[i];
+		a += (1.0f - t) * (1.0f - t);
+		b += t * (1.0f - t);
+		c += t * t;
+		for (int ch = 0; ch < numChannels; ch++) {
+			x0[ch] += (1.0f - t) * pixels[i][ch];
+			x1[ch] += t * pixels[i][ch];
+		}
+	}
+
+	const float det = a * c - b * b;
+	if (fabsf(det) < 1e-6f) {
+		return false;
+	}
+
+	for (int ch = 0; ch < numChannels; ch++) {
+		outEndpoint0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / det, 0.0f, 255.0f);
+		outEndpoint1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+/// PackRGB565
+static u16 PackRGB565(const float color[4]) {
+	const int r = std::clamp((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	const int g = std::clamp((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	const int b = std::clamp((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (u16)((r << 11) | (g << 5) | b);
+}
+
+/// UnpackRGB565
+static void UnpackRGB565(const u16 packed, int outColor[3]) {
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+	outColor[0] = (r << 3) | (r >> 2);
+	outColor[1] = (g << 2) | (g >> 4);
+	outColor[2] = (b << 3) | (b >> 2);
+}
+
+/// FindColorIndices - Picks the closest of c0 and c1's four colors for each pixel and returns the squared error
+static float FindColorIndices(const float pixels[16][4], const u16 c0, const u16 c1, u32& outIndices) {
+	int palette[4][3];
+	UnpackRGB565(c0, palette[0]);
+	UnpackRGB565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+	}
+
+	outIndices = 0;
+	float totalError = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float bestError = FLT_MAX;
+		u32 bestIndex = 0;
+		for (u32 p = 0; p < 4; p++) {
+			float error = 0.0f;
+			for (int c = 0; c < 3; c++) {
+				const float diff = pixels[i][c] - palette[p][c];
+				error += diff * diff;
+			}
+
+			if (error < bestError) {
+				bestError = error;
+				bestIndex = p;
+			}
+		}
+		outIndices |= bestIndex << (i * 2);
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+/// EncodeColorBlock - BC1's block.  It's always written in four color mode, so it's also BC3's color block
+static void EncodeColorBlock(const float pixels[16][4], const bool bHighQuality, byte* const pOut) {
+	float endpoint0[4];
+	float endpoint1[4];
+	GetEndpoints(pixels, 3, endpoint0, endpoint1);
+
+	u16 c0 = PackRGB565(endpoint0);
+	u16 c1 = PackRGB565(endpoint1);
+	u32 indices = 0;
+	float error = FindColorIndices(pixels, c0, c1, indices);
+
+	if (bHighQuality) {
+		static const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		for (int iter = 0; iter < 4 && error > 0.0f; iter++) {
+			float weights[16];
+			for (int i = 0; i < 16; i++) {
+				weights[i] = indexWeights[(indices >> (i * 2)) & 3];
+			}
+
+			if (SolveEndpoints(pixels, weights, 3, endpoint0, endpoint1) == false) {
+				break;
+			}
+
+			const u16 newC0 = PackRGB565(endpoint0);
+			const u16 newC1 = PackRGB565(endpoint1);
+			u32 newIndices = 0;
+			const float newError = FindColorIndices(pixels, newC0, newC1, newIndices);
+			if (newError >= error) {
+				break;
+			}
+
+			c0 = newC0;
+			c1 = newC1;
+			indices = newIndices;
+			error = newError;
+		}
+	}
+
+	// c0 <= c1 selects three color mode, so swap the endpoints and flip each index between 0 and 1, or 2 and 3
+	if (c0 < c1) {
+		std::swap(c0, c1);
+		indices ^= 0x55555555;
+	} else if (c0 == c1) {
+		indices = 0;
+	}
+
+	pOut[0] = (byte)(c0 & 0xff);
+	pOut[1] = (byte)(c0 >> 8);
+	pOut[2] = (byte)(c1 & 0xff);
+	pOut[3] = (byte)(c1 >> 8);
+	for (int i = 0; i < 4; i++) {
+		pOut[4 + i] = (byte)((indices >> (i * 8)) & 0xff);
+	}
+}
+
+/// GetSingleChannelPalette - Eight interpolated values if a0 > a1, otherwise six plus 0 and 255
+static void GetSingleChannelPalette(const int a0, const int a1, int outPalette[8]) {
+	outPalette[0] = a0;
+	outPalette[1] = a1;
+	if (a0 > a1) {
+		for (int i = 2; i < 8; i++) {
+			outPalette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+		}
+	} else {
+		for (int i = 2; i < 6; i++) {
+			outPalette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+		}
+		outPalette[6] = 0;
+		outPalette[7] = 255;
+	}
+}
+
+/// FindSingleChannelIndices - Returns the squared error
+static int FindSingleChannelIndices(const int values[16], const int a0, const int a1, u64& outIndices) {
+	int palette[8];
+	GetSingleChannelPalette(a0, a1, palette);
+
+	outIndices = 0;
+	int totalError = 0;
+	for (int i = 0; i < 16; i++) {
+		int bestError = INT_MAX;
+		u64 bestIndex = 0;
+		for (u64 p = 0; p < 8; p++) {
+			const int error = (values[i] - palette[p]) * (values[i] - palette[p]);
+			if (error < bestError) {
+				bestError = error;
+				bestIndex = p;
+			}
+		}
+		outIndices |= bestIndex << (i * 3);
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+/// EncodeSingleChannelBlock - The BC4 block used for BC3's alpha and each of BC5's channels
+static void EncodeSingleChannelBlock(const int values[16], const bool bHighQuality, byte* const pOut) {
+	int minValue = 255;
+	int maxValue = 0;
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, values[i]);
+		maxValue = std::max(maxValue, values[i]);
+	}
+
+	int a0 = maxValue;
+	int a1 = minValue;
+	u64 indices = 0;
+	int error = FindSingleChannelIndices(values, a0, a1, indices);
+
+	if (bHighQuality && error > 0) {
+		// Pulling the endpoints in can line the interpolated values up with the block's values better
+		const int maxInset = std::min((maxValue - minValue) / 8, 8);
+		for (int inset0 = 0; inset0 <= maxInset; inset0++) {
+			for (int inset1 = 0; inset1 <= maxInset; inset1++) {
+				const int try0 = maxValue - inset0;
+				const int try1 = minValue + inset1;
+				if (try0 <= try1) {
+					continue;
+				}
+
+				u64 tryIndices = 0;
+				const int tryError = FindSingleChannelIndices(values, try0, try1, tryIndices);
+				if (tryError < error) {
+					a0 = try0;
+					a1 = try1;
+					indices = tryIndices;
+					error = tryError;
+				}
+			}
+		}
+
+		// Six value mode has an exact 0 and 255, which suits blocks that mix the extremes with values in between
+		int innerMin = 255;
+		int innerMax = 0;
+		for (int i = 0; i < 16; i++) {
+			if (values[i] != 0 && values[i] != 255) {
+				innerMin = std::min(innerMin, values[i]);
+				innerMax = std::max(innerMax, values[i]);
+			}
+		}
+
+		if (innerMin <= innerMax) {
+			u64 tryIndices = 0;
+			const int tryError = FindSingleChannelIndices(values, innerMin, innerMax, tryIndices);
+			if (tryError < error) {
+				a0 = innerMin;
+				a1 = innerMax;
+				indices = tryIndices;
+				error = tryError;
+			}
+		}
+	}
+
+	pOut[0] = (byte)a0;
+	pOut[1] = (byte)a1;
+	for (int i = 0; i < 6; i++) {
+		pOut[2 + i] = (byte)((indices >> (i * 8)) & 0xff);
+	}
+}
+
+/// EncodeSingleChannel
+static void EncodeSingleChannel(const float pixels[16][4], const int channel, const bool bHighQuality, byte* const pOut) {
+	int values[16];
+	for (int i = 0; i < 16; i++) {
+		values[i] = (int)pixels[i][channel];
+	}
+	EncodeSingleChannelBlock(values, bHighQuality, pOut);
+}
+
+/// kbBC7Endpoints_t - Mode 6 endpoints are 7 bits per channel plus a p-bit that's shared by the endpoint's channels
+struct kbBC7Endpoints_t {
+	int m_Quantized[2][4];
+	int m_PBits[2];
+	u8 m_Indices[16];
+	float m_Error;
+};
+
+/// QuantizeBC7Endpoint - Returns the squared quantization error
+static float QuantizeBC7Endpoint(const float endpoint[4], const int pBit, int outQuantized[4]) {
+	float error = 0.0f;
+	for (int c = 0; c < 4; c++) {
+		outQuantized[c] = std::clamp((int)((endpoint[c] - pBit) * 0.5f + 0.5f), 0, 127);
+		const float diff = (float)((outQuantized[c] << 1) | pBit) - endpoint[c];
+		error += diff * diff;
+	}
+	return error;
+}
+
+/// FindBC7Indices - Fills in the indices and error of endpoints' quantized values
+static void FindBC7Indices(const float pixels[16][4], kbBC7Endpoints_t& endpoints) {
+	int palette[16][4];
+	for (int c = 0; c < 4; c++) {
+		const int e0 = (endpoints.m_Quantized[0][c] << 1) | endpoints.m_PBits[0];
+		const int e1 = (endpoints.m_Quantized[1][c] << 1) | endpoints.m_PBits[1];
+		for (int w = 0; w < 16; w++) {
+			palette[w][c] = ((64 - g_BC7Weights[w]) * e0 + g_BC7Weights[w] * e1 + 32) >> 6;
+		}
+	}
+
+	endpoints.m_Error = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float bestError = FLT_MAX;
+		u8 bestIndex = 0;
+		for (u8 w = 0; w < 16; w++) {
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++) {
+				const float diff = pixels[i][c] - palette[w][c];
+				error += diff * diff;
+			}
+
+			if (error < bestError) {
+				bestError = error;
+				bestIndex = w;
+			}
+		}
+		endpoints.m_Indices[i] = bestIndex;
+		endpoints.m_Error += bestError;
+	}
+}
+
+/// FitBC7Endpoints - Fast mode picks each endpoint's p-bit by how well it quantizes.  High quality tries every combination
+static void FitBC7Endpoints(const float pixels[16][4], const float endpoint0[4], const float endpoint1[4], const bool bHighQuality, kbBC7Endpoints_t& inOutBest) {
+	const float* const floatEndpoints[2] = { endpoint0, endpoint1 };
+
+	if (bHighQuality == false) {
+		kbBC7Endpoints_t endpoints;
+		for (int e = 0; e < 2; e++) {
+			int quantized[2][4];
+			const float error0 = QuantizeBC7Endpoint(floatEndpoints[e], 0, quantized[0]);
+			const float error1 = QuantizeBC7Endpoint(floatEndpoints[e], 1, quantized[1]);
+			endpoints.m_PBits[e] = (error1 < error0) ? (1) : (0);
+			memcpy(endpoints.m_Quantized[e], quantized[endpoints.m_PBits[e]], sizeof(endpoints.m_Quantized[e]));
+		}
+
+		FindBC7Indices(pixels, endpoints);
+		if (endpoints.m_Error < inOutBest.m_Error) {
+			inOutBest = endpoints;
+		}
+		return;
+	}
+
+	for (int pBits = 0; pBits < 4; pBits++) {
+		kbBC7Endpoints_t endpoints;
+		for (int e = 0; e < 2; e++) {
+			endpoints.m_PBits[e] = (pBits >> e) & 1;
+			QuantizeBC7Endpoint(floatEndpoints[e], endpoints.m_PBits[e], endpoints.m_Quantized[e]);
+		}
+
+		FindBC7Indices(pixels, endpoints);
+		if (endpoints.m_Error < inOutBest.m_Error) {
+			inOutBest = endpoints;
+		}
+	}
+}
+
+/// EncodeBC7Block - Always mode 6, which is a single subset with RGBA endpoints and 4 bit indices
+static void EncodeBC7Block(const float pixels[16][4], const bool bHighQuality, byte* const pOut) {
+	float endpoint0[4];
+	float endpoint1[4];
+	GetEndpoints(pixels, 4, endpoint0, endpoint1);
+
+	kbBC7Endpoints_t best;
+	best.m_Error = FLT_MAX;
+	FitBC7Endpoints(pixels, endpoint0, endpoint1, bHighQuality, best);
+
+	if (bHighQuality) {
+		for (int iter = 0; iter < 3 && best.m_Error > 0.0f; iter++) {
+			float weights[16];
+			for (int i = 0; i < 16; i++) {
+				weights[i] = g_BC7Weights[best.m_Indices[i]] / 64.0f;
+			}
+
+			if (SolveEndpoints(pixels, weights, 4, endpoint0, endpoint1) == false) {
+				break;
+			}
+
+			const float prevError = best.m_Error;
+			FitBC7Endpoints(pixels, endpoint0, endpoint1, true, best);
+			if (best.m_Error >= prevError) {
+				break;
+			}
+		}
+	}
+
+	// The first pixel's index is stored with its top bit implied to be 0
+	if (best.m_Indices[0] >= 8) {
+		std::swap(best.m_Quantized[0], best.m_Quantized[1]);
+		std::swap(best.m_PBits[0], best.m_PBits[1]);
+		for (int i = 0; i < 16; i++) {
+			best.m_Indices[i] = 15 - best.m_Indices[i];
+		}
+	}
+
+	memset(pOut, 0, 16);
+	kbBlockBitWriter_t writer(pOut);
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		writer.Write(best.m_Quantized[0][c], 7);
+		writer.Write(best.m_Quantized[1][c], 7);
+	}
+	writer.Write(best.m_PBits[0], 1);
+	writer.Write(best.m_PBits[1], 1);
+
+	writer.Write(best.m_Indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		writer.Write(best.m_Indices[i], 4);
+	}
+}
+
+/// kbHalf_t - IEEE half float.  A separate type so BoxFilter() averages it as a float
+struct kbHalf_t {
+	u16 m_Bits;
+};
+
+/// HalfToFloat
+static float HalfToFloat(const kbHalf_t half) {
+	const u32 sign = (u32)(half.m_Bits & 0x8000) << 16;
+	u32 exponent = (half.m_Bits >> 10) & 0x1f;
+	u32 mantissa = half.m_Bits & 0x3ff;
+
+	u32 bits = sign;
+	if (exponent == 0x1f) {
+		bits |= 0x7f800000 | (mantissa << 13);
+	} else if (exponent != 0) {
+		bits |= ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	} else if (mantissa != 0) {
+		// Denormal.  Shift the mantissa up until it has the implicit 1
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400) == 0) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits |= (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/// FloatToHalf - Rounds to nearest even
+static kbHalf_t FloatToHalf(const float value) {
+	u32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const u16 sign = (u16)((bits >> 16) & 0x8000);
+	const u32 absBits = bits & 0x7fffffff;
+	if (absBits > 0x7f800000) {
+		return { (u16)(sign | 0x7e00) };
+	}
+
+	// 65520 and up round to infinity
+	if (absBits >= 0x477ff000) {
+		return { (u16)(sign | 0x7c00) };
+	}
+
+	// Below the smallest normal half, the mantissa is the value in units of 2^-24
+	if (absBits < 0x38800000) {
+		float absValue;
+		memcpy(&absValue, &absBits, sizeof(absValue));
+		return { (u16)(sign | (u16)nearbyintf(absValue * 16777216.0f)) };
+	}
+
+	u32 half = (absBits - 0x38000000) >> 13;
+	const u32 roundBits = absBits & 0x1fff;
+	if (roundBits > 0x1000 || (roundBits == 0x1000 && (half & 1) != 0)) {
+		half++;
+	}
+	return { (u16)(sign | half) };
+}
+
+/// Average4 - The value of a mip texel from the four it covers
+static byte Average4(const byte a, const byte b, const byte c, const byte d) { return (byte)(((u32)a + b + c + d + 2) / 4); }
+static u16 Average4(const u16 a, const u16 b, const u16 c, const u16 d) { return (u16)(((u32)a + b + c + d + 2) / 4); }
+static float Average4(const float a, const float b, const float c, const float d) { return (a + b + c + d) * 0.25f; }
+static kbHalf_t Average4(const kbHalf_t a, const kbHalf_t b, const kbHalf_t c, const kbHalf_t d) { return FloatToHalf(Average4(HalfToFloat(a), HalfToFloat(b), HalfToFloat(c), HalfToFloat(d))); }
+
+/// BoxFilter - Halves a mip.  Odd sizes repeat their last row or column
+template<typename T>
+static void BoxFilter(const T* const pSrc, const u32 srcWidth, const u32 srcHeight, const u32 numChannels, T* const pDst, const u32 dstWidth, const u32 dstHeight) {
+	for (u32 y = 0; y < dstHeight; y++) {
+		const size_t row0 = (size_t)std::min(y * 2, srcHeight - 1) * srcWidth;
+		const size_t row1 = (size_t)std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+		for (u32 x = 0; x < dstWidth; x++) {
+			const size_t col0 = std::min(x * 2, srcWidth - 1);
+			const size_t col1 = std::min(x * 2 + 1, srcWidth - 1);
+			for (u32 c = 0; c < numChannels; c++) {
+				pDst[((size_t)y * dstWidth + x) * numChannels + c] = Average4(pSrc[(row0 + col0) * numChannels + c], pSrc[(row0 + col1) * numChannels + c],
+																				pSrc[(row1 + col0) * numChannels + c], pSrc[(row1 + col1) * numChannels + c]);
+			}
+		}
+	}
+}
+
+/// kbCookedTexture::EncodeBlock
+void kbCookedTexture::EncodeBlock(const byte block[16][4], const kbTextureFormat_t format, const bool bHighQuality, byte* const pOutBlock) {
+	float pixels[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			pixels[i][c] = block[i][c];
+		}
+	}
+
+	switch (format) {
+		case TextureFormat_BC1:
+			EncodeColorBlock(pixels, bHighQuality, pOutBlock);
+			break;
+
+		case TextureFormat_BC3:
+			EncodeSingleChannel(pixels, 3, bHighQuality, pOutBlock);
+			EncodeColorBlock(pixels, bHighQuality, pOutBlock + 8);
+			break;
+
+		case TextureFormat_BC5:
+			EncodeSingleChannel(pixels, 0, bHighQuality, pOutBlock);
+			EncodeSingleChannel(pixels, 1, bHighQuality, pOutBlock + 8);
+			break;
+
+		case TextureFormat_BC7:
+			EncodeBC7Block(pixels, bHighQuality, pOutBlock);
+			break;
+
+		default:
+			blk::error("kbCookedTexture::EncodeBlock() - %s isn't block compressed", GetFormatName(format));
+			break;
+	}
+}
+
+/// kbCookedTexture::ChooseFormat
+kbTextureFormat_t kbCookedTexture::ChooseFormat(const byte* const pPixels, const u32 width, const u32 height, const kbTextureFormat_t pixelFormat, const bool bHighQuality) {
+	if (pixelFormat != TextureFormat_RGBA8) {
+		return pixelFormat;
+	}
+
+	if (bHighQuality) {
+		return TextureFormat_BC7;
+	}
+
+	const size_t numPixels = (size_t)width * height;
+	for (size_t i = 0; i < numPixels; i++) {
+		if (pPixels[i * 4 + 3] != 255) {
+			return TextureFormat_BC3;
+		}
+	}
+	return TextureFormat_BC1;
+}
+
+/// kbCookedTexture::GetBlockSize
+u32 kbCookedTexture::GetBlockSize(const kbTextureFormat_t format) {
+	switch (format) {
+		case TextureFormat_BC1: return 8;
+		case TextureFormat_BC3: return 16;
+		case TextureFormat_BC5: return 16;
+		case TextureFormat_BC7: return 16;
+		default: return 0;
+	}
+}
+
+/// kbCookedTexture::GetPixelSize
+u32 kbCookedTexture::GetPixelSize(const kbTextureFormat_t format) {
+	switch (format) {
+		case TextureFormat_RGBA8: return 4;
+		case TextureFormat_RGBA16: return 8;
+		case TextureFormat_RGBA16F: return 8;
+		case TextureFormat_RGBA32F: return 16;
+		case TextureFormat_R16: return 2;
+		case TextureFormat_R16F: return 2;
+		case TextureFormat_R32F: return 4;
+		default: return 0;
+	}
+}
+
+/// kbCookedTexture::GetUncompressedFormat
+kbTextureFormat_t kbCookedTexture::GetUncompressedFormat(const kbTextureFormat_t format) {
+	return (GetBlockSize(format) > 0) ? (TextureFormat_RGBA8) : (format);
+}
+
+/// kbCookedTexture::GetFormatName
+const char* kbCookedTexture::GetFormatName(const kbTextureFormat_t format) {
+	switch (format) {
+		case TextureFormat_RGBA8: return "RGBA8";
+		case TextureFormat_BC1: return "BC1";
+		case TextureFormat_BC3: return "BC3";
+		case TextureFormat_BC5: return "BC5";
+		case TextureFormat_BC7: return "BC7";
+		case TextureFormat_RGBA16: return "RGBA16";
+		case TextureFormat_RGBA16F: return "RGBA16F";
+		case TextureFormat_RGBA32F: return "RGBA32F";
+		case TextureFormat_R16: return "R16";
+		case TextureFormat_R16F: return "R16F";
+		case TextureFormat_R32F: return "R32F";
+		default: return "Unknown";
+	}
+}
+
+/// kbCookedTexture::GetMipLayout
+void kbCookedTexture::GetMipLayout(const u32 width, const u32 height, const kbTextureFormat_t format, mip_t& outMip) {
+	outMip.m_Width = width;
+	outMip.m_Height = height;
+	outMip.m_Offset = 0;
+
+	const u32 blockSize = GetBlockSize(format);
+	if (blockSize > 0) {
+		outMip.m_RowPitch = ((width + 3) / 4) * blockSize;
+		outMip.m_Size = outMip.m_RowPitch * ((height + 3) / 4);
+	} else {
+		outMip.m_RowPitch = width * GetPixelSize(format);
+		outMip.m_Size = outMip.m_RowPitch * height;
+	}
+}
+
+/// kbCookedTexture::Cook
+bool kbCookedTexture::Cook(const byte* const pPixels, const u32 width, const u32 height, const kbTextureFormat_t pixelFormat, const kbTextureCookSettings_t& settings) {
+	Reset();
+	const u32 pixelSize = GetPixelSize(pixelFormat);
+	if (pPixels == nullptr || width == 0 || height == 0 || pixelSize == 0) {
+		return false;
+	}
+
+	kbTextureFormat_t format = (settings.m_Format < TextureFormat_Num) ? (settings.m_Format) : (ChooseFormat(pPixels, width, height, pixelFormat, settings.m_bHighQuality));
+	if (GetUncompressedFormat(format) != pixelFormat || (GetBlockSize(format) > 0 && ((width % 4) != 0 || (height % 4) != 0))) {
+		format = pixelFormat;
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_Format = format;
+
+	const u32 blockSize = GetBlockSize(format);
+	std::vector<byte> level(pPixels, pPixels + (size_t)width * height * pixelSize);
+	std::vector<byte> nextLevel;
+	u32 mipWidth = width;
+	u32 mipHeight = height;
+	while (true) {
+		mip_t mip;
+		GetMipLayout(mipWidth, mipHeight, format, mip);
+		mip.m_Offset = (u32)m_Data.size();
+		m_Data.resize(m_Data.size() + mip.m_Size);
+		byte* const pMipData = &m_Data[mip.m_Offset];
+
+		if (blockSize == 0) {
+			memcpy(pMipData, level.data(), mip.m_Size);
+		} else {
+			byte block[16][4];
+			for (u32 blockY = 0; blockY < mipHeight; blockY += 4) {
+				for (u32 blockX = 0; blockX < mipWidth; blockX += 4) {
+					// Blocks that hang off the edge of the small mips repeat the edge pixels
+					for (u32 y = 0; y < 4; y++) {
+						for (u32 x = 0; x < 4; x++) {
+							const u32 srcX = std::min(blockX + x, mipWidth - 1);
+							const u32 srcY = std::min(blockY + y, mipHeight - 1);
+							memcpy(block[y * 4 + x], &level[((size_t)srcY * mipWidth + srcX) * 4], 4);
+						}
+					}
+					EncodeBlock(block, format, settings.m_bHighQuality, pMipData + (blockY / 4) * mip.m_RowPitch + (blockX / 4) * blockSize);
+				}
+			}
+		}
+		m_Mips.push_back(mip);
+
+		if (settings.m_bGenerateMips == false || (mipWidth == 1 && mipHeight == 1)) {
+			break;
+		}
+
+		const u32 nextWidth = std::max(mipWidth / 2, 1u);
+		const u32 nextHeight = std::max(mipHeight / 2, 1u);
+		nextLevel.resize((size_t)nextWidth * nextHeight * pixelSize);
+		switch (pixelFormat) {
+			case TextureFormat_RGBA8: BoxFilter(level.data(), mipWidth, mipHeight, 4, nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_RGBA16: BoxFilter((const u16*)level.data(), mipWidth, mipHeight, 4, (u16*)nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_RGBA16F: BoxFilter((const kbHalf_t*)level.data(), mipWidth, mipHeight, 4, (kbHalf_t*)nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_RGBA32F: BoxFilter((const float*)level.data(), mipWidth, mipHeight, 4, (float*)nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_R16: BoxFilter((const u16*)level.data(), mipWidth, mipHeight, 1, (u16*)nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_R16F: BoxFilter((const kbHalf_t*)level.data(), mipWidth, mipHeight, 1, (kbHalf_t*)nextLevel.data(), nextWidth, nextHeight); break;
+			case TextureFormat_R32F: BoxFilter((const float*)level.data(), mipWidth, mipHeight, 1, (float*)nextLevel.data(), nextWidth, nextHeight); break;
+			default: break;
+		}
+
+		level.swap(nextLevel);
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	if (settings.m_bKeepCPUCopy) {
+		m_CPUCopy.assign(pPixels, pPixels + (size_t)width * height * pixelSize);
+	}
+	return true;
+}
+
+/// kbCookedTexture::Reset
+void kbCookedTexture::Reset() {
+	m_Width = 0;
+	m_Height = 0;
+	m_Format = TextureFormat_RGBA8;
+	m_Mips.clear();
+	m_Data.clear();
+	m_Data.shrink_to_fit();
+	m_CPUCopy.clear();
+	m_CPUCopy.shrink_to_fit();
+}
+
+/// kbCookedTexture::Write
+void kbCookedTexture::Write(kbCacheWriter& writer) const {
+	writer.Write(m_Width);
+	writer.Write(m_Height);
+	writer.Write((u32)m_Format);
+	writer.Write((u32)m_Mips.size());
+	writer.Write((u32)m_Data.size());
+	writer.Write((u32)m_CPUCopy.size());
+	writer.WriteArray(m_Mips);
+	writer.WriteArray(m_Data);
+	writer.WriteArray(m_CPUCopy);
+}
+
+/// kbCookedTexture::Read
+bool kbCookedTexture::Read(kbCacheReader& reader) {
+	Reset();
+
+	u32 width = 0;
+	u32 height = 0;
+	u32 format = 0;
+	u32 numMips = 0;
+	u32 dataSize = 0;
+	u32 cpuCopySize = 0;
+	if (reader.Read(width) == false || reader.Read(height) == false || reader.Read(format) == false ||
+		reader.Read(numMips) == false || reader.Read(dataSize) == false || reader.Read(cpuCopySize) == false) {
+		return false;
+	}
+
+	if (format >= TextureFormat_Num || width == 0 || height == 0 || numMips == 0 || numMips > g_MaxTextureMips ||
+		(cpuCopySize != 0 && cpuCopySize != (u64)width * height * GetPixelSize(GetUncompressedFormat((kbTextureFormat_t)format)))) {
+		return false;
+	}
+
+	if (reader.ReadArray(m_Mips, numMips) == false || reader.ReadArray(m_Data, dataSize) == false || reader.ReadArray(m_CPUCopy, cpuCopySize) == false) {
+		Reset();
+		return false;
+	}
+
+	// Mips have to have the layout Cook() gives them, so uploads can trust their sizes
+	for (u32 i = 0; i < numMips; i++) {
+		mip_t expected;
+		GetMipLayout(std::max(width >> i, 1u), std::max(height >> i, 1u), (kbTextureFormat_t)format, expected);
+
+		const mip_t& mip = m_Mips[i];
+		if (mip.m_Width != expected.m_Width || mip.m_Height != expected.m_Height || mip.m_RowPitch != expected.m_RowPitch ||
+			mip.m_Size != expected.m_Size || (u64)mip.m_Offset + mip.m_Size > m_Data.size()) {
+			Reset();
+			return false;
+		}
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_Format = (kbTextureFormat_t)format;
+	return true;
+}
@@ -0,0 +1,100 @@
+/// kbTextureCooker.h
+///
+/// 2025 blk 1.0
+
+#pragma once
+
+#include <vector>
+
+class kbCacheWriter;
+class kbCacheReader;
+
+/// kbTextureFormat_t
+enum kbTextureFormat_t {
+	TextureFormat_RGBA8 = 0,
+	TextureFormat_BC1,			// RGB at 4 bits per pixel
+	TextureFormat_BC3,			// RGBA at 8 bits per pixel, with alpha stored separately from color
+	TextureFormat_BC5,			// RG at 8 bits per pixel.  For two channel data like normal maps whose z is rebuilt in the shader
+	TextureFormat_BC7,			// RGBA at 8 bits per pixel
+	TextureFormat_RGBA16,		// Sources with more than 8 bits a channel keep their precision and are never block compressed
+	TextureFormat_RGBA16F,
+	TextureFormat_RGBA32F,
+	TextureFormat_R16,
+	TextureFormat_R16F,
+	TextureFormat_R32F,
+	TextureFormat_Num
+};
+
+/// kbTextureCookSettings_t
+struct kbTextureCookSettings_t {
+	kbTextureCookSettings_t() : m_Format(TextureFormat_Num), m_bHighQuality(false), m_bGenerateMips(true), m_bKeepCPUCopy(false) { }
+
+	kbTextureFormat_t m_Format;		// TextureFormat_Num picks one.  See kbCookedTexture::ChooseFormat()
+	bool m_bHighQuality;			// Refines block endpoints with least squares and searches more of the encodings.  Several times slower
+	bool m_bGenerateMips;
+	bool m_bKeepCPUCopy;			// Keeps the top mip uncompressed, in the format the pixels were cooked from
+};
+
+/// kbCookedTexture
+///
+/// A texture in the layout the GPU consumes.  The full mip chain is built with a box filter and each level is block
+/// compressed, so loading one is a read and a copy instead of an image decode.  Only RGBA8 pixels are block compressed,
+/// and only when the top mip is a whole number of 4x4 blocks.  Anything else is stored in the format it was cooked from
+class kbCookedTexture {
+public:
+	struct mip_t {
+		u32 m_Width;
+		u32 m_Height;
+		u32 m_RowPitch;			// Bytes per row of pixels, or per row of blocks
+		u32 m_Offset;
+		u32 m_Size;
+	};
+
+	kbCookedTexture() : m_Width(0), m_Height(0), m_Format(TextureFormat_RGBA8) { }
+
+	/// pPixels is width * height pixels of pixelFormat, which can't be block compressed
+	bool Cook(const byte* const pPixels, const u32 width, const u32 height, const kbTextureFormat_t pixelFormat, const kbTextureCookSettings_t& settings);
+	void Reset();
+
+	void Write(kbCacheWriter& writer) const;
+	bool Read(kbCacheReader& reader);
+
+	bool IsValid() const { return m_Mips.empty() == false; }
+	u32 GetWidth() const { return m_Width; }
+	u32 GetHeight() const { return m_Height; }
+	kbTextureFormat_t GetFormat() const { return m_Format; }
+
+	size_t NumMips() const { return m_Mips.size(); }
+	const mip_t& GetMip(const size_t idx) const { return m_Mips[idx]; }
+	const byte* GetMipData(const size_t idx) const { return &m_Data[m_Mips[idx].m_Offset]; }
+	size_t GetDataSize() const { return m_Data.size(); }
+
+	/// Empty unless the texture was cooked with m_bKeepCPUCopy
+	const std::vector<byte>& GetCPUCopy() const { return m_CPUCopy; }
+
+	/// BC1 for opaque RGBA8 textures and BC3 for ones with alpha.  High quality uses BC7 for both.  Wider formats are kept
+	static kbTextureFormat_t ChooseFormat(const byte* const pPixels, const u32 width, const u32 height, const kbTextureFormat_t pixelFormat, const bool bHighQuality);
+
+	/// Bytes per 4x4 block, or 0 if the format isn't block compressed
+	static u32 GetBlockSize(const kbTextureFormat_t format);
+
+	/// Bytes per pixel, or 0 if the format is block compressed
+	static u32 GetPixelSize(const kbTextureFormat_t format);
+
+	/// The format pixels have to be in to be cooked to format.  RGBA8 for the block compressed formats
+	static kbTextureFormat_t GetUncompressedFormat(const kbTextureFormat_t format);
+	static const char* GetFormatName(const kbTextureFormat_t format);
+
+	/// Encodes a 4x4 block of RGBA8 pixels in row order
+	static void EncodeBlock(const byte block[16][4], const kbTextureFormat_t format, const bool bHighQuality, byte* const pOutBlock);
+
+private:
+	static void GetMipLayout(const u32 width, const u32 height, const kbTextureFormat_t format, mip_t& outMip);
+
+	u32 m_Width;
+	u32 m_Height;
+	kbTextureFormat_t m_Format;
+	std::vector<mip_t> m_Mips;
+	std::vector<byte> m_Data;
+	std::vector<byte> m_CPUCopy;
+};
@@ -84,14 +84,16 @@ struct vertexLayout {
 	}
 };
 
-/// ParticleVertex
+/// ParticleVertex - One per particle.  The vertex shader expands it into a camera facing quad, so the buffer is read
+/// per-instance and the corners come from the vertex id.  Buffers use vertexLayout's stride, so the sizes must match
 struct ParticleVertex {
 	Vec3 position;
-	Vec2 uv;
+	Vec2 size;
 	byte color[4];
 	f32 rotation;
-	f32 scale;
+	f32 random;
 };
+static_assert(sizeof(ParticleVertex) == sizeof(vertexLayout), "ParticleVertex must match vertexLayout's stride");
 
 
 /// RenderPipeline
@@ -20,10 +20,22 @@ static int orient2d(const Vec2i& a, const Vec2i& b, const Vec2i& c)
 }
 
 void TrianglePipeline::render(const set<const RenderComponent*>& comp, vector<u8>& color, vector<f32>& depth, const Vec2i& frame_dim) {
+	vector<Vec3> skinned_positions;
 	for (auto render_comp : comp) {
+		const kbModel* model = nullptr;
+		bool is_skinned = false;
 		if (render_comp->IsA(kbStaticModelComponent::GetType())) {
-			kbStaticModelComponent* const skel_comp = (kbStaticModelComponent*)render_comp;
-			const kbModel* const model = skel_comp->model();
+			kbStaticModelComponent* const static_comp = (kbStaticModelComponent*)render_comp;
+			model = static_comp->model();
+		} else if (render_comp->IsA(SkeletalModelComponent::GetType())) {
+			// There's no GPU to skin with, so deform the verts on the CPU
+			SkeletalModelComponent* const skel_comp = (SkeletalModelComponent*)render_comp;
+			kbBounds pose_bounds;
+			is_skinned = skel_comp->SkinVertices(skinned_positions, pose_bounds);
+			model = skel_comp->model();
+		}
+
+		if (model != nullptr) {
 
 			Mat4 world_mat;
 			world_mat.make_scale(render_comp->owner_scale());
@@ -63,7 +75,7 @@ void TrianglePipeline::render(const set<const RenderComponent*>& comp, vector<u8
 
 				for (size_t idx = 0; idx < 3; idx++) {
 					const auto& v1 = vertices[indices[i + idx]];
-					Vec4 vertex_pos = v1.position.extend(1.f);
+					Vec4 vertex_pos = (is_skinned) ? (skinned_positions[indices[i + idx]].extend(1.f)) : (v1.position.extend(1.f));
 					vertex_pos.x *= -1.f;
 					vertex_pos.z *= -1.f;
 					vertex_pos = vertex_pos.transform_point(final_mat, true);
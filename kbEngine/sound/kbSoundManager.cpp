@@ -27,8 +27,18 @@ kbWaveFile::~kbWaveFile() {}
 bool kbWaveFile::Load_Internal() {
 	HRESULT hr;
 
-	const LPSTR pFileName = (LPSTR)GetFullFileName().c_str();
-	m_hMMio = mmioOpen(pFileName, nullptr, MMIO_ALLOCBUF | MMIO_READ);
+	if (g_FileSystem.ReadFile(GetFullFileName(), m_FileData) == false) {
+		blk::warn("kbWaveFile::Load_Internal() - Failed to read %s", GetFullFileName().c_str());
+		return false;
+	}
+
+	// Open the wave as a memory file so it can come out of an archive
+	MMIOINFO mmioInfo;
+	ZeroMemory(&mmioInfo, sizeof(mmioInfo));
+	mmioInfo.fccIOProc = FOURCC_MEM;
+	mmioInfo.pchBuffer = (HPSTR)m_FileData.GetData();
+	mmioInfo.cchBuffer = (LONG)m_FileData.GetSize();
+	m_hMMio = mmioOpen(nullptr, &mmioInfo, MMIO_READ);
 
 	hr = ReadMMIO();
 	blk::error_check(SUCCEEDED(hr), "kbWaveFile::Load_Internal() - Failed to load wave %s", GetFullFileName().c_str());
@@ -55,11 +65,30 @@ void kbWaveFile::Release_Internal() {
 		mmioClose(m_hMMio, 0);
 		m_hMMio = nullptr;
 	}
+	m_FileData.Release();
 
 	delete[] m_pWaveDataBuffer;
 	m_pWaveDataBuffer = nullptr;
 }
 
+/// kbWaveFile::CreateStagingCopy
+kbResource* kbWaveFile::CreateStagingCopy() const {
+	return new kbWaveFile();
+}
+
+/// kbWaveFile::SwapStagedData
+void kbWaveFile::SwapStagedData(kbResource* const pStaged) {
+	kbWaveFile* const pWaveFile = (kbWaveFile*)pStaged;
+	m_FileData.Swap(pWaveFile->m_FileData);
+	std::swap(m_pWaveFormat, pWaveFile->m_pWaveFormat);
+	std::swap(m_hMMio, pWaveFile->m_hMMio);
+	std::swap(m_ck, pWaveFile->m_ck);
+	std::swap(m_ckRiff, pWaveFile->m_ckRiff);
+	std::swap(m_dwSize, pWaveFile->m_dwSize);
+	std::swap(m_cbWaveSize, pWaveFile->m_cbWaveSize);
+	std::swap(m_pWaveDataBuffer, pWaveFile->m_pWaveDataBuffer);
+}
+
 /// kbWaveFile::ReadMMIO
 HRESULT	kbWaveFile::ReadMMIO() {
 	MMCKINFO ckIn;           // chunk info. for general use.
@@ -9,6 +9,7 @@
 #include <mmreg.h>
 #include <XAudio2.h>
 #include "kbResourceManager.h"
+#include "blk_file_system.h"
 
 /// kbWaveFile
 class kbWaveFile : public kbResource {
@@ -27,11 +28,15 @@ private:
 	virtual bool Load_Internal();
 	virtual void Release_Internal();
 
+	virtual kbResource* CreateStagingCopy() const override;
+	virtual void SwapStagedData(kbResource* const pStaged) override;
+
 	HRESULT	ReadMMIO();
 
 	HRESULT	Read(BYTE* pBuffer, DWORD dwSizeToRead, DWORD* pdwSizeRead);
 	HRESULT	ResetFile();
 
+	kbFileData m_FileData;			// mmio reads straight out of this until Release_Internal()
 	WAVEFORMATEX* m_pWaveFormat;
 	HMMIO m_hMMio;
 	MMCKINFO m_ck;